@@ -2,6 +2,7 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <csignal>
+#include <future>
 #include <pthread.h>
 #include <unistd.h>
 #include <android/asset_manager_jni.h>
@@ -11,14 +12,21 @@
 #include "skyline/common/signal.h"
 #include "skyline/common/settings.h"
 #include "skyline/common/trace.h"
+#include "skyline/common/flight_recorder.h"
+#include "skyline/common/memory_accounting.h"
+#include "skyline/common/title_profile.h"
 #include "skyline/loader/loader.h"
 #include "skyline/vfs/android_asset_filesystem.h"
+#include "skyline/vfs/write_back_backing.h"
 #include "skyline/os.h"
 #include "skyline/jvm.h"
 #include "skyline/gpu.h"
 #include "skyline/audio.h"
 #include "skyline/input.h"
 #include "skyline/kernel/types/KProcess.h"
+#include "skyline/kernel/svc_statistics.h"
+#include "skyline/soc/gm20b/gpfifo.h"
+#include "skyline/services/service_statistics.h"
 
 jint Fps; //!< An approximation of the amount of frames being submitted every second
 jfloat AverageFrametimeMs; //!< The average time it takes for a frame to be rendered and presented in milliseconds
@@ -74,7 +82,8 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
     jint preferenceFd,
     jint systemLanguage,
     jstring appFilesPathJstring,
-    jobject assetManager
+    jobject assetManager,
+    jint benchmarkFrames
 ) {
     skyline::signal::ScopedStackBlocker stackBlocker; // We do not want anything to unwind past JNI code as there are invalid stack frames which can lead to a segmentation fault
     Fps = 0;
@@ -88,6 +97,7 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
 
     skyline::JniString appFilesPath(env, appFilesPathJstring);
     skyline::Logger::EmulationContext.Initialize(appFilesPath + "emulation.sklog");
+    skyline::trace::FlightRecorder::CrashDumpPath = appFilesPath + "emulation.skfr";
 
     auto start{std::chrono::steady_clock::now()};
 
@@ -98,6 +108,23 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
     perfetto::TrackEvent::Register();
 
     try {
+        // The ROM is opened and parsed while the OS is constructed as neither depends on the other, this overlaps key loading and NCA parsing with the creation of the Vulkan device and audio stream
+        auto loader{std::async(std::launch::async, [&]() {
+            pthread_setname_np(pthread_self(), "EmuLoader");
+            return skyline::kernel::OS::CreateLoader(romFd, static_cast<skyline::loader::RomFormat>(romType), appFilesPath, static_cast<size_t>(settings->sectorCacheSize) * 1024 * 1024);
+        }).share()};
+
+        // The tuned settings are read while the OS is constructed so the title must be known prior to it, this forgoes overlapping the loader with the OS
+        std::optional<skyline::TitleProfile> titleProfile;
+        if (settings->autoTune) {
+            if (auto &nacp{loader.get()->nacp}) {
+                titleProfile.emplace(appFilesPath + "title_profiles/", nacp->nacpContents.saveDataOwnerId);
+                titleProfile->Apply(*settings);
+            } else {
+                skyline::Logger::Info("Performance settings aren't tuned for titles without an ID");
+            }
+        }
+
         auto os{std::make_shared<skyline::kernel::OS>(
             jvmManager,
             settings,
@@ -112,9 +139,17 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
         InputWeak = os->state.input;
         jvmManager->InitializeControllers();
 
+        if (benchmarkFrames > 0) {
+            os->state.gpu->presentation.SetBenchmarkFrames(static_cast<skyline::u64>(benchmarkFrames));
+            skyline::Logger::InfoNoPrefix("Running a benchmark of {} frames", benchmarkFrames);
+        }
+
         skyline::Logger::InfoNoPrefix("Launching ROM {}", skyline::JniString(env, romUriJstring));
 
-        os->Execute(romFd, static_cast<skyline::loader::RomFormat>(romType));
+        os->Execute(loader.get());
+
+        if (titleProfile)
+            titleProfile->Record(os->state.gpu->statistics.GetSessionHistogram(), os->state.gpu->thermalGovernor.GetThrottleEvents());
     } catch (std::exception &e) {
         skyline::Logger::ErrorNoPrefix("An uncaught exception has occurred: {}", e.what());
     } catch (const skyline::signal::SignalException &e) {
@@ -125,11 +160,29 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
 
     perfetto::TrackEvent::Flush();
 
+    auto memoryStatistics{skyline::MemoryAccounting::GetSummary()};
+    if (!memoryStatistics.empty())
+        skyline::Logger::Write(skyline::Logger::LogLevel::Info, fmt::format("Memory usage at exit:\n{}", memoryStatistics)); // Any usage remaining once everything has been torn down is leaked
+
+    auto serviceStatistics{skyline::service::ServiceStatistics::GetSummary(20, false)};
+    if (!serviceStatistics.empty())
+        skyline::Logger::Write(skyline::Logger::LogLevel::Info, fmt::format("Service function statistics:\n{}", serviceStatistics));
+
     InputWeak.reset();
 
     auto end{std::chrono::steady_clock::now()};
     skyline::Logger::Write(skyline::Logger::LogLevel::Info, fmt::format("Emulation has ended in {}ms", std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()));
 
+    if (benchmarkFrames > 0) {
+        // The service statistics above already cover IPC, the remaining counters are reported here so a benchmark run can be evaluated from the log alone
+        skyline::Logger::Write(skyline::Logger::LogLevel::Info, fmt::format("Benchmark of {} frames: {}ms wall time, {} GPFIFO methods, {:.2f}ms average frametime", benchmarkFrames, std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(), skyline::soc::gm20b::ChannelGpfifo::TotalMethodCount.load(std::memory_order_relaxed), AverageFrametimeMs));
+        auto svcStatistics{skyline::kernel::svc::SvcStatistics::GetSummary(20)};
+        if (!svcStatistics.empty())
+            skyline::Logger::Write(skyline::Logger::LogLevel::Info, fmt::format("SVC statistics:\n{}", svcStatistics));
+    }
+
+    skyline::trace::FlightRecorder::Dump(skyline::trace::FlightRecorder::CrashDumpPath);
+
     skyline::Logger::EmulationContext.Finalize();
     close(romFd);
 }
@@ -153,6 +206,20 @@ extern "C" JNIEXPORT jboolean Java_emu_skyline_EmulationActivity_setSurface(JNIE
     return true;
 }
 
+extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_setPresentMode(JNIEnv *, jobject, jint mode) {
+    auto gpu{GpuWeak.lock()};
+    if (gpu)
+        gpu->presentation.SetPresentMode(static_cast<vk::PresentModeKHR>(mode));
+}
+
+extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_flushSaveData(JNIEnv *, jobject) {
+    try {
+        skyline::vfs::WriteBackCache::Get().Flush();
+    } catch (const std::exception &e) {
+        skyline::Logger::Error("Failed to flush save data: {}", e.what());
+    }
+}
+
 extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_changeAudioStatus(JNIEnv *, jobject, jboolean play) {
     auto audio{AudioWeak.lock()};
     if (audio)
@@ -181,6 +248,67 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_updatePerformanceSt
     if (!averageFrametimeDeviationField)
         averageFrametimeDeviationField = env->GetFieldID(clazz, "averageFrametimeDeviation", "F");
     env->SetFloatField(thiz, averageFrametimeDeviationField, AverageFrametimeDeviationMs);
+
+    skyline::gpu::FrameStatistics::Summary frameSummary{};
+    if (auto gpu{GpuWeak.lock()})
+        frameSummary = gpu->statistics.GetSummary();
+
+    static jfieldID frametimeP50Field{};
+    if (!frametimeP50Field)
+        frametimeP50Field = env->GetFieldID(clazz, "frametimeP50", "F");
+    env->SetFloatField(thiz, frametimeP50Field, frameSummary.frametimeP50);
+
+    static jfieldID frametimeP99Field{};
+    if (!frametimeP99Field)
+        frametimeP99Field = env->GetFieldID(clazz, "frametimeP99", "F");
+    env->SetFloatField(thiz, frametimeP99Field, frameSummary.frametimeP99);
+
+    static jfieldID cpuTimeField{};
+    if (!cpuTimeField)
+        cpuTimeField = env->GetFieldID(clazz, "cpuTime", "F");
+    env->SetFloatField(thiz, cpuTimeField, frameSummary.cpuTime);
+
+    static jfieldID gpuTimeField{};
+    if (!gpuTimeField)
+        gpuTimeField = env->GetFieldID(clazz, "gpuTime", "F");
+    env->SetFloatField(thiz, gpuTimeField, frameSummary.gpuTime);
+
+    static jfieldID gpuTimeP99Field{};
+    if (!gpuTimeP99Field)
+        gpuTimeP99Field = env->GetFieldID(clazz, "gpuTimeP99", "F");
+    env->SetFloatField(thiz, gpuTimeP99Field, frameSummary.gpuTimeP99);
+
+    static jfieldID presentLatencyField{};
+    if (!presentLatencyField)
+        presentLatencyField = env->GetFieldID(clazz, "presentLatency", "F");
+    env->SetFloatField(thiz, presentLatencyField, frameSummary.presentLatency);
+
+    static jfieldID audioLatencyField{};
+    if (!audioLatencyField)
+        audioLatencyField = env->GetFieldID(clazz, "audioLatency", "F");
+    auto audio{AudioWeak.lock()};
+    env->SetFloatField(thiz, audioLatencyField, audio ? static_cast<float>(audio->GetLatency()) : 0.0f);
+
+    static jfieldID svcStatisticsField{};
+    if (!svcStatisticsField)
+        svcStatisticsField = env->GetFieldID(clazz, "svcStatistics", "Ljava/lang/String;");
+    auto svcStatistics{env->NewStringUTF(skyline::kernel::svc::SvcStatistics::GetSummary(3).c_str())};
+    env->SetObjectField(thiz, svcStatisticsField, svcStatistics);
+    env->DeleteLocalRef(svcStatistics);
+
+    static jfieldID serviceStatisticsField{};
+    if (!serviceStatisticsField)
+        serviceStatisticsField = env->GetFieldID(clazz, "serviceStatistics", "Ljava/lang/String;");
+    auto serviceStatistics{env->NewStringUTF(skyline::service::ServiceStatistics::GetSummary(3).c_str())};
+    env->SetObjectField(thiz, serviceStatisticsField, serviceStatistics);
+    env->DeleteLocalRef(serviceStatistics);
+
+    static jfieldID memoryStatisticsField{};
+    if (!memoryStatisticsField)
+        memoryStatisticsField = env->GetFieldID(clazz, "memoryStatistics", "Ljava/lang/String;");
+    auto memoryStatistics{env->NewStringUTF(skyline::MemoryAccounting::GetSummary().c_str())};
+    env->SetObjectField(thiz, memoryStatisticsField, memoryStatistics);
+    env->DeleteLocalRef(memoryStatistics);
 }
 
 extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setController(JNIEnv *, jobject, jint index, jint type, jint partnerIndex) {
@@ -193,34 +321,12 @@ extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_updateContr
     InputWeak.lock()->npad.Update();
 }
 
-extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setButtonState(JNIEnv *, jobject, jint index, jlong mask, jboolean pressed) {
-    auto input{InputWeak.lock()};
-    if (!input)
-        return; // We don't mind if we miss button updates while input hasn't been initialized
-    auto device{input->npad.controllers[static_cast<size_t>(index)].device};
-    if (device)
-        device->SetButtonState(skyline::input::NpadButton{.raw = static_cast<skyline::u64>(mask)}, pressed);
-}
-
-extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setAxisValue(JNIEnv *, jobject, jint index, jint axis, jint value) {
-    auto input{InputWeak.lock()};
-    if (!input)
-        return; // We don't mind if we miss axis updates while input hasn't been initialized
-    auto device{input->npad.controllers[static_cast<size_t>(index)].device};
-    if (device)
-        device->SetAxisValue(static_cast<skyline::input::NpadAxisId>(axis), value);
-}
-
-extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setTouchState(JNIEnv *env, jobject, jintArray pointsJni) {
-    using Point = skyline::input::TouchScreenPoint;
-
+extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_commitInputState(JNIEnv *env, jobject, jobject snapshotBuffer) {
     auto input{InputWeak.lock()};
     if (!input)
-        return; // We don't mind if we miss touch updates while input hasn't been initialized
-    jboolean isCopy{false};
+        return; // We don't mind if we miss input updates while input hasn't been initialized
 
-    skyline::span<Point> points(reinterpret_cast<Point *>(env->GetIntArrayElements(pointsJni, &isCopy)),
-                                static_cast<size_t>(env->GetArrayLength(pointsJni)) / (sizeof(Point) / sizeof(jint)));
-    input->touch.SetState(points);
-    env->ReleaseIntArrayElements(pointsJni, reinterpret_cast<jint *>(points.data()), JNI_ABORT);
+    auto snapshot{reinterpret_cast<skyline::input::InputSnapshot *>(env->GetDirectBufferAddress(snapshotBuffer))};
+    if (snapshot && env->GetDirectBufferCapacity(snapshotBuffer) >= static_cast<jlong>(sizeof(skyline::input::InputSnapshot)))
+        input->CommitSnapshot(*snapshot);
 }
@@ -4,7 +4,9 @@
 #include "skyline/common/logger.h"
 #include "skyline/crypto/key_store.h"
 #include "skyline/vfs/nca.h"
+#include "skyline/vfs/mapped_backing.h"
 #include "skyline/vfs/os_backing.h"
+#include "skyline/vfs/compressed_backing.h"
 #include "skyline/loader/nro.h"
 #include "skyline/loader/nso.h"
 #include "skyline/loader/nca.h"
@@ -20,7 +22,7 @@ extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomFile_populate(JNIEn
     auto keyStore{std::make_shared<skyline::crypto::KeyStore>(skyline::JniString(env, appFilesPathJstring))};
     std::unique_ptr<skyline::loader::Loader> loader;
     try {
-        auto backing{std::make_shared<skyline::vfs::OsBacking>(fd)};
+        auto backing{skyline::vfs::CompressedBacking::Open(skyline::vfs::MappedBacking::Open(fd))};
 
         switch (format) {
             case skyline::loader::RomFormat::NRO:
@@ -33,10 +35,10 @@ extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomFile_populate(JNIEn
                 loader = std::make_unique<skyline::loader::NcaLoader>(backing, keyStore);
                 break;
             case skyline::loader::RomFormat::XCI:
-                loader = std::make_unique<skyline::loader::XciLoader>(backing, keyStore);
+                loader = std::make_unique<skyline::loader::XciLoader>(backing, keyStore, 0, true);
                 break;
             case skyline::loader::RomFormat::NSP:
-                loader = std::make_unique<skyline::loader::NspLoader>(backing, keyStore);
+                loader = std::make_unique<skyline::loader::NspLoader>(backing, keyStore, 0, true);
                 break;
             default:
                 return static_cast<jint>(skyline::loader::LoaderResult::ParsingError);
@@ -68,3 +70,41 @@ extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomFile_populate(JNIEn
 
     return static_cast<jint>(skyline::loader::LoaderResult::Success);
 }
+
+extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomCompressor_compress(JNIEnv *env, jobject, jint jformat, jint romFd, jint outputFd, jstring appFilesPathJstring) {
+    skyline::loader::RomFormat format{static_cast<skyline::loader::RomFormat>(jformat)};
+
+    skyline::Logger::SetContext(&skyline::Logger::LoaderContext);
+
+    auto keyStore{std::make_shared<skyline::crypto::KeyStore>(skyline::JniString(env, appFilesPathJstring))};
+    try {
+        auto backing{skyline::vfs::CompressedBacking::Open(skyline::vfs::MappedBacking::Open(romFd))};
+
+        // NSPs and NCAs are stored decrypted as compressing encrypted data is ineffective, XCIs aren't supported as their secure partition is nested inside another partition
+        std::shared_ptr<skyline::vfs::Backing> input;
+        switch (format) {
+            case skyline::loader::RomFormat::NRO:
+            case skyline::loader::RomFormat::NSO:
+                input = backing;
+                break;
+            case skyline::loader::RomFormat::NCA:
+                input = std::make_shared<skyline::vfs::OverlayBacking>(backing, skyline::vfs::NCA(backing, keyStore).GetDecryptedOverlays());
+                break;
+            case skyline::loader::RomFormat::NSP:
+                input = skyline::loader::NspLoader::CreateDecryptedView(backing, keyStore);
+                break;
+            default:
+                return static_cast<jint>(skyline::loader::LoaderResult::ParsingError);
+        }
+
+        skyline::vfs::OsBacking output(outputFd, false, {false, true, true});
+        skyline::vfs::CompressedBacking::Compress(*input, output);
+    } catch (const skyline::loader::loader_exception &e) {
+        return static_cast<jint>(e.error);
+    } catch (const std::exception &e) {
+        skyline::Logger::Error("Failed to compress ROM: {}", e.what());
+        return static_cast<jint>(skyline::loader::LoaderResult::ParsingError);
+    }
+
+    return static_cast<jint>(skyline::loader::LoaderResult::Success);
+}
@@ -1,24 +1,56 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <common/settings.h>
+#include <common/host_affinity.h>
 #include "audio.h"
 
 namespace skyline::audio {
-    Audio::Audio(const DeviceState &state) : oboe::AudioStreamCallback() {
+    Audio::Audio(const DeviceState &state) : oboe::AudioStreamCallback(), bufferBursts(static_cast<i32>(state.settings->audioBufferBursts)) {
         builder.setChannelCount(constant::ChannelCount);
         builder.setSampleRate(constant::SampleRate);
         builder.setFormat(constant::PcmFormat);
         builder.setFramesPerCallback(constant::MixBufferSize);
         builder.setUsage(oboe::Usage::Game);
         builder.setCallback(this);
-        builder.setSharingMode(oboe::SharingMode::Exclusive);
+        builder.setSharingMode(state.settings->audioExclusiveMode ? oboe::SharingMode::Exclusive : oboe::SharingMode::Shared);
         builder.setPerformanceMode(oboe::PerformanceMode::LowLatency);
 
+        std::scoped_lock lock{streamMutex};
+        OpenStream();
+    }
+
+    void Audio::OpenStream() {
         builder.openManagedStream(outputStream);
+
+        // The buffer is started small for the lowest latency and grown on underruns, this is the same approach as Oboe's LatencyTuner
+        outputStream->setBufferSizeInFrames(outputStream->getFramesPerBurst() * bufferBursts);
+        xRunCount.store(0, std::memory_order_relaxed);
+
+        Logger::Info("Opened audio stream: Sharing mode: {}, Performance mode: {}, Burst size: {}, Buffer size: {}/{}", outputStream->getSharingMode() == oboe::SharingMode::Exclusive ? "Exclusive" : "Shared", outputStream->getPerformanceMode() == oboe::PerformanceMode::LowLatency ? "Low Latency" : "Other", outputStream->getFramesPerBurst(), outputStream->getBufferSizeInFrames(), outputStream->getBufferCapacityInFrames());
+
         outputStream->requestStart();
     }
 
+    void Audio::AdjustBufferSize(oboe::AudioStream *audioStream) {
+        auto xRuns{audioStream->getXRunCount()};
+        if (!xRuns || xRuns.value() <= xRunCount.load(std::memory_order_relaxed))
+            return;
+        xRunCount.store(xRuns.value(), std::memory_order_relaxed);
+
+        auto bufferSize{audioStream->getBufferSizeInFrames() + audioStream->getFramesPerBurst()};
+        if (bufferSize <= audioStream->getBufferCapacityInFrames())
+            audioStream->setBufferSizeInFrames(bufferSize);
+    }
+
+    double Audio::GetLatency() {
+        std::scoped_lock lock{streamMutex};
+        auto latency{outputStream->calculateLatencyMillis()};
+        return latency ? latency.value() : 0.0;
+    }
+
     Audio::~Audio() {
+        std::scoped_lock lock{streamMutex};
         outputStream->requestStop();
     }
 
@@ -26,7 +58,9 @@ namespace skyline::audio {
         std::lock_guard trackGuard(trackLock);
 
         auto track{std::make_shared<AudioTrack>(channelCount, sampleRate, releaseCallback)};
-        audioTracks.push_back(track);
+        auto tracks{std::make_shared<TrackList>(*audioTracks)};
+        tracks->push_back(track);
+        std::atomic_store_explicit(&audioTracks, std::shared_ptr<const TrackList>{std::move(tracks)}, std::memory_order_release);
 
         return track;
     }
@@ -34,45 +68,62 @@ namespace skyline::audio {
     void Audio::CloseTrack(std::shared_ptr<AudioTrack> &track) {
         std::lock_guard trackGuard(trackLock);
 
-        audioTracks.erase(std::remove(audioTracks.begin(), audioTracks.end(), track), audioTracks.end());
+        auto tracks{std::make_shared<TrackList>(*audioTracks)};
+        tracks->erase(std::remove(tracks->begin(), tracks->end(), track), tracks->end());
+        std::atomic_store_explicit(&audioTracks, std::shared_ptr<const TrackList>{std::move(tracks)}, std::memory_order_seq_cst);
+
+        // A callback which started prior to the list being replaced may still be reading the buffers of the track, they're owned by the caller and may be freed after we return
+        u64 sequence{callbackSequence.load(std::memory_order_seq_cst)};
+        if (sequence & 1)
+            while (callbackSequence.load(std::memory_order_acquire) == sequence)
+                std::this_thread::yield();
         track.reset();
     }
 
     oboe::DataCallbackResult Audio::onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t numFrames) {
+        thread_local bool pinned{}; // The callback thread is owned by the audio stream, it's pinned on its first callback
+        if (!pinned) {
+            HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Emulation);
+            pinned = true;
+        }
+
         auto destBuffer{static_cast<i16 *>(audioData)};
         auto streamSamples{static_cast<size_t>(numFrames) * static_cast<size_t>(audioStream->getChannelCount())};
         size_t writtenSamples{};
 
+        callbackSequence.fetch_add(1, std::memory_order_seq_cst);
         {
-            std::lock_guard trackGuard(trackLock);
-
-            for (auto &track : audioTracks) {
-                if (track->playbackState == AudioOutState::Stopped)
+            auto tracks{std::atomic_load_explicit(&audioTracks, std::memory_order_seq_cst)}; // This must be ordered after entering the callback, CloseTrack relies on it to know if we could have loaded a list containing a closed track
+            for (auto &track : *tracks) {
+                if (track->playbackState.load(std::memory_order_relaxed) == AudioOutState::Stopped)
                     continue;
 
-                std::lock_guard bufferGuard(track->bufferLock);
-
-                auto trackSamples{track->samples.Read(span(destBuffer, streamSamples), [](i16 *source, i16 *destination) {
-                    *destination = Saturate<i16, i32>(static_cast<u32>(*destination) + static_cast<u32>(*source));
-                }, static_cast<ssize_t>(writtenSamples))};
+                auto trackSamples{track->Read(streamSamples, [&](span<i16> source, size_t offset) {
+                    // Samples which were already written by a prior track are mixed with them, the rest are copied as-is
+                    size_t mixSamples{std::min(source.size(), (writtenSamples > offset) ? (writtenSamples - offset) : 0)};
+                    MixSamples(destBuffer + offset, source.data(), mixSamples);
+                    std::memcpy(destBuffer + offset + mixSamples, source.data() + mixSamples, (source.size() - mixSamples) * sizeof(i16));
+                })};
 
                 writtenSamples = std::max(trackSamples, writtenSamples);
 
-                track->sampleCounter += trackSamples;
-                track->CheckReleasedBuffers();
+                track->CheckReleasedBuffers(trackSamples);
             }
         }
+        callbackSequence.fetch_add(1, std::memory_order_release);
 
         if (streamSamples > writtenSamples)
             memset(destBuffer + writtenSamples, 0, (streamSamples - writtenSamples) * sizeof(i16));
 
+        AdjustBufferSize(audioStream);
+
         return oboe::DataCallbackResult::Continue;
     }
 
     void Audio::onErrorAfterClose(oboe::AudioStream *audioStream, oboe::Result error) {
         if (error == oboe::Result::ErrorDisconnected) {
-            builder.openManagedStream(outputStream);
-            outputStream->requestStart();
+            std::scoped_lock lock{streamMutex};
+            OpenStream();
         }
     }
 }
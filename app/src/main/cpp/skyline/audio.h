@@ -12,9 +12,26 @@ namespace skyline::audio {
     class Audio : public oboe::AudioStreamCallback {
       private:
         oboe::AudioStreamBuilder builder;
+        std::mutex streamMutex; //!< Synchronizes access to the output stream as it's replaced on the callback thread when the stream is disconnected
         oboe::ManagedStream outputStream;
-        std::vector<std::shared_ptr<AudioTrack>> audioTracks;
+        i32 bufferBursts; //!< The initial size of the stream's buffer in bursts
+        std::atomic<i32> xRunCount{}; //!< The amount of underruns on the stream when its buffer size was last adjusted
+        using TrackList = std::vector<std::shared_ptr<AudioTrack>>;
+        std::shared_ptr<const TrackList> audioTracks{std::make_shared<TrackList>()}; //!< The audio tracks being mixed, the list is copied on every write so the audio callback can atomically load the current list without taking any locks, this must only be accessed with atomic shared_ptr operations
         std::mutex trackLock; //!< Synchronizes modifications to the audio tracks
+        std::atomic<u64> callbackSequence{}; //!< Incremented on entering and leaving the audio callback, it's odd while the callback is running
+
+        /**
+         * @brief Opens and starts the output stream with the initial buffer size
+         * @note 'streamMutex' **must** be locked prior to calling this
+         */
+        void OpenStream();
+
+        /**
+         * @brief Grows the stream's buffer by a burst if any underruns have occurred since it was last adjusted, this never shrinks the buffer as underruns are likely to recur
+         * @note This must only be called from the audio callback
+         */
+        void AdjustBufferSize(oboe::AudioStream *audioStream);
 
       public:
         Audio(const DeviceState &state);
@@ -22,13 +39,20 @@ namespace skyline::audio {
         ~Audio();
 
         void Pause() {
+            std::scoped_lock lock{streamMutex};
             outputStream->requestPause();
         }
 
         void Resume() {
+            std::scoped_lock lock{streamMutex};
             outputStream->requestStart();
         }
 
+        /**
+         * @return The latency between a sample being written to the stream and it being presented in milliseconds or 0 if it can't be measured
+         */
+        double GetLatency();
+
         /**
          * @brief Opens a new track that can be used to play sound
          * @param channelCount The amount channels that are present in the track
@@ -39,7 +63,8 @@ namespace skyline::audio {
         std::shared_ptr<AudioTrack> OpenTrack(u8 channelCount, u32 sampleRate, const std::function<void()> &releaseCallback);
 
         /**
-         * @brief Closes a track and frees its data
+         * @brief Closes a track and frees its data, this waits for any audio callback that may still be reading from the track to return
+         * @note The buffers appended to the track are read in place by the audio callback, they can be freed by the caller once this returns
          */
         void CloseTrack(std::shared_ptr<AudioTrack> &track);
 
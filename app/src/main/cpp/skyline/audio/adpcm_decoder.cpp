@@ -7,46 +7,65 @@
 namespace skyline::audio {
     AdpcmDecoder::AdpcmDecoder(std::vector<std::array<i16, 2>> coefficients) : coefficients(std::move(coefficients)) {}
 
-    std::vector<i16> AdpcmDecoder::Decode(span<u8> adpcmData) {
-        constexpr size_t BytesPerFrame{0x8};
-        constexpr size_t SamplesPerFrame{0xE};
+    void AdpcmDecoder::DecodeFrames(span<u8> adpcmData, i16 *output) {
+        for (size_t inputOffset{}; inputOffset + BytesPerFrame <= adpcmData.size(); inputOffset += BytesPerFrame) {
+            // The nibbles of the entire frame are sign-extended and scaled in vector registers, only the prediction is serially dependent
+            int8x8_t bytes{vreinterpret_s8_u8(vld1_u8(adpcmData.data() + inputOffset))};
+            FrameHeader header{static_cast<u8>(vget_lane_s8(bytes, 0))};
+            int8x8x2_t nibbles{vzip_s8(vshr_n_s8(bytes, 4), vshr_n_s8(vshl_n_s8(bytes, 4), 4))}; // High nibbles come first, the header's nibbles are in the first two lanes
+            int16x8_t nibblesLow{vmovl_s8(nibbles.val[0])}, nibblesHigh{vmovl_s8(nibbles.val[1])};
 
-        size_t remainingSamples{(adpcmData.size() / BytesPerFrame) * SamplesPerFrame};
+            int32x4_t shift{vdupq_n_s32(11 + header.scale)}, rounding{vdupq_n_s32(0x400)};
+            std::array<i32, SamplesPerFrame + 2> scaled;
+            vst1q_s32(scaled.data(), vaddq_s32(vshlq_s32(vmovl_s16(vget_low_s16(nibblesLow)), shift), rounding));
+            vst1q_s32(scaled.data() + 4, vaddq_s32(vshlq_s32(vmovl_s16(vget_high_s16(nibblesLow)), shift), rounding));
+            vst1q_s32(scaled.data() + 8, vaddq_s32(vshlq_s32(vmovl_s16(vget_low_s16(nibblesHigh)), shift), rounding));
+            vst1q_s32(scaled.data() + 12, vaddq_s32(vshlq_s32(vmovl_s16(vget_high_s16(nibblesHigh)), shift), rounding));
 
-        std::vector<i16> output;
-        output.reserve(remainingSamples);
-
-        size_t inputOffset{};
-
-        while (inputOffset < adpcmData.size()) {
-            FrameHeader header{adpcmData[inputOffset++]};
-
-            size_t frameSamples{std::min(SamplesPerFrame, remainingSamples)};
-
-            i32 ctx{};
+            const auto &coefficient{coefficients[header.coefficientIndex]};
+            for (size_t index{2}; index < scaled.size(); index++) {
+                i32 prediction{history[0] * coefficient[0] + history[1] * coefficient[1]};
+                auto saturated{audio::Saturate<i16, i32>((scaled[index] + prediction) >> 11)};
+                *output++ = saturated;
+                history[1] = history[0];
+                history[0] = saturated;
+            }
+        }
+    }
 
-            for (size_t index{}; index < frameSamples; index++) {
-                i32 sample{};
+    size_t AdpcmDecoder::Decode(span<u8> adpcmData, span<i16> output) {
+        size_t outputSize{GetOutputSize(adpcmData.size())};
+        if (output.size() < outputSize)
+            throw exception("ADPCM output buffer is too small: 0x{:X} (Required: 0x{:X})", output.size(), outputSize);
 
-                if (index & 1) {
-                    sample = (ctx << 28) >> 28;
-                } else {
-                    ctx = adpcmData[inputOffset++];
-                    sample = (ctx << 24) >> 28;
-                }
+        if (adpcmData.size() > MaxCachedBufferSize) {
+            DecodeFrames(adpcmData, output.data());
+            return outputSize;
+        }
 
-                i32 prediction{history[0] * coefficients[header.coefficientIndex][0] + history[1] * coefficients[header.coefficientIndex][1]};
-                sample = (sample * (0x800 << header.scale) + prediction + 0x400) >> 11;
+        size_t dataHash{util::Hash(std::string_view(reinterpret_cast<const char *>(adpcmData.data()), adpcmData.size()))};
+        auto it{cache.find(adpcmData.data())};
+        if (it != cache.end() && it->second.dataHash == dataHash && it->second.inputHistory == history && it->second.samples.size() == outputSize) {
+            std::memcpy(output.data(), it->second.samples.data(), outputSize * sizeof(i16));
+            history = it->second.outputHistory;
+            return outputSize;
+        }
 
-                auto saturated{audio::Saturate<i16, i32>(sample)};
-                output.push_back(saturated);
-                history[1] = history[0];
-                history[0] = saturated;
-            }
+        auto inputHistory{history};
+        DecodeFrames(adpcmData, output.data());
 
-            remainingSamples -= frameSamples;
+        if (it == cache.end()) {
+            if (cache.size() >= MaxCachedBuffers)
+                cache.clear();
+            it = cache.try_emplace(adpcmData.data()).first;
         }
 
-        return output;
+        auto &entry{it->second};
+        entry.dataHash = dataHash;
+        entry.inputHistory = inputHistory;
+        entry.outputHistory = history;
+        entry.samples.assign(output.begin(), output.begin() + static_cast<ssize_t>(outputSize));
+
+        return outputSize;
     }
 }
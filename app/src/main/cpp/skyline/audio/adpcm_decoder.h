@@ -11,6 +11,11 @@ namespace skyline::audio {
      */
     class AdpcmDecoder {
       private:
+        static constexpr size_t BytesPerFrame{0x8}; //!< The size of a frame including its header byte
+        static constexpr size_t SamplesPerFrame{0xE};
+        static constexpr size_t MaxCachedBufferSize{0x10000}; //!< The maximum size of an ADPCM buffer for it to be cached, only short buffers such as sound effects are replayed often enough for caching to be worthwhile
+        static constexpr size_t MaxCachedBuffers{16}; //!< The maximum amount of buffers in the cache before it's flushed
+
         union FrameHeader {
             u8 raw;
 
@@ -22,15 +27,40 @@ namespace skyline::audio {
         };
         static_assert(sizeof(FrameHeader) == 0x1);
 
+        /**
+         * @brief The decoded samples of a buffer alongside all state required to validate that decoding it again would produce identical output
+         */
+        struct CachedBuffer {
+            size_t dataHash; //!< A hash of the ADPCM data, the guest may reuse the same memory for different data
+            std::array<i32, 2> inputHistory; //!< The history prior to decoding the buffer
+            std::array<i32, 2> outputHistory; //!< The history after decoding the buffer
+            std::vector<i16> samples;
+        };
+
         std::array<i32, 2> history{}; //!< The previous samples for decoding the ADPCM stream
         std::vector<std::array<i16, 2>> coefficients; //!< The coefficients for decoding the ADPCM stream
+        std::unordered_map<const u8 *, CachedBuffer> cache; //!< A cache of decoded buffers keyed by the address of their ADPCM data
+
+        /**
+         * @brief Decodes all frames in the ADPCM data into the output buffer without consulting the cache
+         */
+        void DecodeFrames(span<u8> adpcmData, i16 *output);
 
       public:
         AdpcmDecoder(std::vector<std::array<i16, 2>> coefficients);
 
         /**
-         * @brief Decodes a buffer of ADPCM data into I16 PCM
+         * @return The amount of samples that decoding a buffer of the supplied size will produce
+         */
+        static constexpr size_t GetOutputSize(size_t adpcmSize) {
+            return (adpcmSize / BytesPerFrame) * SamplesPerFrame;
+        }
+
+        /**
+         * @brief Decodes a buffer of ADPCM data into I16 PCM, short buffers that are replayed with the same decoder state are copied from the cache rather than being decoded again
+         * @param output A buffer to write the decoded samples into, this must be at least as large as GetOutputSize
+         * @return The amount of samples written into the output buffer
          */
-        std::vector<i16> Decode(span <u8> adpcmData);
+        size_t Decode(span<u8> adpcmData, span<i16> output);
     };
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <arm_neon.h>
 #include <oboe/Oboe.h>
 #include <common.h>
 
@@ -34,7 +35,6 @@ namespace skyline {
         struct BufferIdentifier {
             u64 tag;
             u64 finalSample; //!< The final sample this buffer will be played in, after that the buffer can be safely released
-            bool released; //!< If the buffer has been released (fully played back)
         };
 
         /**
@@ -46,5 +46,17 @@ namespace skyline {
         inline Out Saturate(In value) {
             return static_cast<Out>(std::clamp(static_cast<Intermediate>(value), static_cast<Intermediate>(std::numeric_limits<Out>::min()), static_cast<Intermediate>(std::numeric_limits<Out>::max())));
         }
+
+        /**
+         * @brief Mixes the source samples into the destination samples with saturation, 8 samples are mixed at a time with a single saturating NEON add
+         */
+        inline void MixSamples(i16 *destination, const i16 *source, size_t count) {
+            size_t index{};
+            for (; index + 8 <= count; index += 8)
+                vst1q_s16(destination + index, vqaddq_s16(vld1q_s16(destination + index), vld1q_s16(source + index)));
+
+            for (; index < count; index++)
+                destination[index] = Saturate<i16, i32>(static_cast<i32>(destination[index]) + static_cast<i32>(source[index]));
+        }
     }
 }
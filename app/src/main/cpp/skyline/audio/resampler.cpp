@@ -6,14 +6,15 @@
 
 namespace skyline::audio {
     /**
-     * @brief The coefficients for each index of a single output frame
+     * @brief The coefficients for each index of a single output frame, these are stored as contiguous 16-bit values so they can be loaded directly into a NEON register
      */
     struct LutEntry {
-        i32 a;
-        i32 b;
-        i32 c;
-        i32 d;
+        i16 a;
+        i16 b;
+        i16 c;
+        i16 d;
     };
+    static_assert(sizeof(LutEntry) == sizeof(int16x4_t));
 
     // @fmt:off
     constexpr std::array<LutEntry, 128> CurveLut0{{
@@ -119,33 +120,58 @@ namespace skyline::audio {
         {-42, 3751, 26253, 2811},   {-38, 3608, 26270, 2936},   {-34, 3467, 26281, 3064},   {-32, 3329, 26287, 3195}}};
     // @fmt:on
 
-    std::vector<i16> Resampler::ResampleBuffer(span<i16> inputBuffer, double ratio, u8 channelCount) {
+    /**
+     * @return The filter bank to use for the supplied step, these are the polyphase filter banks HOS uses for upsampling, 4:3 downsampling and 3:2 downsampling
+     */
+    static const std::array<LutEntry, 128> &GetLut(u32 step) {
+        if (step > 0xAAAA)
+            return CurveLut0;
+        else if (step <= 0x8000)
+            return CurveLut1;
+        else
+            return CurveLut2;
+    }
+
+    size_t Resampler::GetOutputSize(size_t inputSize, double ratio, u8 channelCount) {
+        return static_cast<size_t>(static_cast<double>(inputSize / channelCount) / ratio) * channelCount;
+    }
+
+    size_t Resampler::ResampleBuffer(span<i16> inputBuffer, span<i16> outputBuffer, double ratio, u8 channelCount) {
         auto step{static_cast<u32>(ratio * 0x8000)};
-        auto outputSize{static_cast<size_t>(inputBuffer.size() / ratio)};
-        std::vector<i16> outputBuffer(outputSize);
+        auto outputSize{GetOutputSize(inputBuffer.size(), ratio, channelCount)};
+        if (outputBuffer.size() < outputSize)
+            throw exception("Resampler output buffer is too small: 0x{:X} (Required: 0x{:X})", outputBuffer.size(), outputSize);
 
-        const std::array<LutEntry, 128> &lut = [step] {
-            if (step > 0xAAAA)
-                return CurveLut0;
-            else if (step <= 0x8000)
-                return CurveLut1;
-            else
-                return CurveLut2;
-        }();
+        const auto &lut{GetLut(step)};
+        size_t inputFrames{inputBuffer.size() / channelCount};
+        const i16 *input{inputBuffer.data()};
+        i16 *output{outputBuffer.data()};
 
         for (size_t outIndex{}, inIndex{}; outIndex < outputSize; outIndex += channelCount) {
-            u32 lutIndex{fraction >> 8};
-
-            for (u8 channel{}; channel < channelCount; channel++) {
-                if (((inIndex + 3) * channelCount + channel) >= inputBuffer.size())
-                    continue;
+            const auto &entry{lut[fraction >> 8]};
 
-                i32 data{inputBuffer[(inIndex + 0) * channelCount + channel] * lut[lutIndex].a +
-                         inputBuffer[(inIndex + 1) * channelCount + channel] * lut[lutIndex].b +
-                         inputBuffer[(inIndex + 2) * channelCount + channel] * lut[lutIndex].c +
-                         inputBuffer[(inIndex + 3) * channelCount + channel] * lut[lutIndex].d};
+            if (inIndex + 3 >= inputFrames) [[unlikely]] {
+                // There aren't enough input frames left to apply the full filter
+                std::memset(output + outIndex, 0, channelCount * sizeof(i16));
+            } else if (channelCount == 2) {
+                // The 4 input frames are deinterleaved into a register per channel and the taps of both channels are reduced together
+                int16x4_t coefficients{vld1_s16(&entry.a)};
+                int16x4x2_t frames{vld2_s16(input + inIndex * 2)};
+                int32x4_t sums{vpaddq_s32(vmull_s16(frames.val[0], coefficients), vmull_s16(frames.val[1], coefficients))};
+                sums = vpaddq_s32(sums, sums);
+                vst1_lane_s32(reinterpret_cast<i32 *>(output + outIndex), vreinterpret_s32_s16(vqshrn_n_s32(sums, 15)), 0);
+            } else if (channelCount == 1) {
+                int32x4_t products{vmull_s16(vld1_s16(input + inIndex), vld1_s16(&entry.a))};
+                output[outIndex] = Saturate<i16, i32>(vaddvq_s32(products) >> 15);
+            } else {
+                for (u8 channel{}; channel < channelCount; channel++) {
+                    i32 data{input[(inIndex + 0) * channelCount + channel] * entry.a +
+                             input[(inIndex + 1) * channelCount + channel] * entry.b +
+                             input[(inIndex + 2) * channelCount + channel] * entry.c +
+                             input[(inIndex + 3) * channelCount + channel] * entry.d};
 
-                outputBuffer[outIndex + channel] = Saturate<i16, i32>(data >> 15);
+                    output[outIndex + channel] = Saturate<i16, i32>(data >> 15);
+                }
             }
 
             u32 newOffset{fraction + step};
@@ -153,6 +179,6 @@ namespace skyline::audio {
             fraction = newOffset & 0x7FFF;
         }
 
-        return outputBuffer;
+        return outputSize;
     }
 }
@@ -7,7 +7,7 @@
 
 namespace skyline::audio {
     /**
-     * @brief The Resampler class handles resampling audio PCM data
+     * @brief The Resampler class handles resampling audio PCM data with a 4-tap polyphase filter bank
      */
     class Resampler {
       private:
@@ -15,11 +15,18 @@ namespace skyline::audio {
 
       public:
         /**
-         * @brief Resamples the given sample buffer by the given ratio
+         * @return The amount of samples that resampling a buffer with the given parameters will produce
+         */
+        static size_t GetOutputSize(size_t inputSize, double ratio, u8 channelCount);
+
+        /**
+         * @brief Resamples the given sample buffer by the given ratio into the output buffer
          * @param inputBuffer A buffer containing PCM sample data
+         * @param outputBuffer A buffer to write the resampled data into, this must be at least as large as GetOutputSize
          * @param ratio The conversion ratio needed
          * @param channelCount The amount of channels the buffer contains
+         * @return The amount of samples written into the output buffer
          */
-        std::vector<i16> ResampleBuffer(span <i16> inputBuffer, double ratio, u8 channelCount);
+        size_t ResampleBuffer(span<i16> inputBuffer, span<i16> outputBuffer, double ratio, u8 channelCount);
     };
 }
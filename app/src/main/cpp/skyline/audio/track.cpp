@@ -16,61 +16,80 @@ namespace skyline::audio {
     }
 
     void AudioTrack::Stop() {
-        while (!identifiers.end()->released);
+        u64 finalSample{[&] {
+            std::lock_guard guard(bufferLock);
+            return appendedSamples;
+        }()};
+
+        while (playbackState == AudioOutState::Started && sampleCounter.load(std::memory_order_acquire) < finalSample)
+            std::this_thread::yield();
         playbackState = AudioOutState::Stopped;
     }
 
     bool AudioTrack::ContainsBuffer(u64 tag) {
-        // Iterate from front of queue as we don't want released samples
-        for (auto identifier{identifiers.crbegin()}; identifier != identifiers.crend(); identifier++) {
-            if (identifier->released)
-                return false;
+        std::lock_guard guard(bufferLock);
 
-            if (identifier->tag == tag)
-                return true;
-        }
+        u64 playedSamples{sampleCounter.load(std::memory_order_acquire)};
+        for (const auto &identifier : identifiers)
+            if (identifier.tag == tag)
+                return identifier.finalSample > playedSamples;
 
         return false;
     }
 
-    std::vector<u64> AudioTrack::GetReleasedBuffers(u32 max) {
-        std::vector<u64> bufferIds;
-        std::lock_guard trackGuard(bufferLock);
+    u32 AudioTrack::GetReleasedBuffers(span<u64> bufferIds) {
+        std::lock_guard guard(bufferLock);
 
-        for (u32 index{}; index < max; index++) {
-            if (identifiers.empty() || !identifiers.back().released)
+        u64 playedSamples{sampleCounter.load(std::memory_order_acquire)};
+        u32 count{};
+        for (; count < bufferIds.size(); count++) {
+            if (identifiers.empty() || identifiers.back().finalSample > playedSamples)
                 break;
-            bufferIds.push_back(identifiers.back().tag);
+            bufferIds[count] = identifiers.back().tag;
             identifiers.pop_back();
         }
 
-        return bufferIds;
+        return count;
     }
 
-    void AudioTrack::AppendBuffer(u64 tag, span<i16> buffer) {
-        BufferIdentifier identifier{
-            .released = false,
-            .tag = tag,
-            .finalSample = identifiers.empty() ? (buffer.size()) : (buffer.size() + identifiers.front().finalSample)
-        };
-
+    void AudioTrack::AppendBuffer(u64 tag, span<i16> buffer, bool copy) {
         std::lock_guard guard(bufferLock);
 
-        identifiers.push_front(identifier);
-        samples.Append(buffer);
+        appendedSamples += buffer.size();
+        identifiers.push_front(BufferIdentifier{
+            .tag = tag,
+            .finalSample = appendedSamples,
+        });
+
+        // The slot of a buffer can only be reused once the audio callback has released the buffer in it which implies it's done reading it
+        u64 index{appendedBuffers.load(std::memory_order_relaxed)};
+        while (index - playedBuffers.load(std::memory_order_acquire) == MaxPendingBuffers) [[unlikely]]
+            std::this_thread::yield();
+
+        auto slot{index % MaxPendingBuffers};
+        if (copy) {
+            auto &bufferCopy{bufferCopies[slot]};
+            bufferCopy.assign(buffer.begin(), buffer.end());
+            buffer = bufferCopy;
+        }
+
+        pendingBuffers[slot] = PendingBuffer{
+            .samples = buffer,
+            .finalSample = appendedSamples,
+        };
+        appendedBuffers.store(index + 1, std::memory_order_release);
     }
 
-    void AudioTrack::CheckReleasedBuffers() {
-        bool anyReleased{};
+    void AudioTrack::CheckReleasedBuffers(size_t playedSamples) {
+        u64 counter{sampleCounter.load(std::memory_order_relaxed) + playedSamples};
+        sampleCounter.store(counter, std::memory_order_release);
 
-        for (auto &identifier : identifiers) {
-            if (identifier.finalSample <= sampleCounter && !identifier.released) {
-                anyReleased = true;
-                identifier.released = true;
-            }
-        }
+        u64 played{playedBuffers.load(std::memory_order_relaxed)}, index{played};
+        for (u64 appended{appendedBuffers.load(std::memory_order_acquire)}; index != appended && pendingBuffers[index % MaxPendingBuffers].finalSample <= counter; index++);
 
-        if (anyReleased)
+        if (index != played) {
+            playedBuffers.store(index, std::memory_order_release);
             releaseCallback();
+        }
     }
 }
@@ -4,27 +4,45 @@
 #pragma once
 
 #include <kernel/types/KEvent.h>
-#include <common/circular_buffer.h>
 #include "common.h"
 
 namespace skyline::audio {
     /**
      * @brief The AudioTrack class manages the buffers for an audio stream
+     * @note The audio callback is the sole consumer of a track and never takes any locks, guest threads are the producers and are synchronized with each other by `bufferLock`
+     * @note Appended buffers are read in place by the audio callback rather than being copied into the track, a buffer must remain valid until it has been released or the track has been closed with Audio::CloseTrack
      */
     class AudioTrack {
       private:
+        static constexpr size_t MaxPendingBuffers{64}; //!< The maximum amount of buffers which can be pending release by the audio callback, this is double the amount of buffers HOS allows to be appended to a single audio out
+
         std::function<void()> releaseCallback; //!< Callback called when a buffer has been played
-        std::deque<BufferIdentifier> identifiers; //!< Queue of all appended buffer identifiers
+        std::deque<BufferIdentifier> identifiers; //!< Queue of all appended buffer identifiers, this must only be accessed with `bufferLock` held
+        u64 appendedSamples{}; //!< The total amount of samples appended to the track, this must only be accessed with `bufferLock` held
+
+        /**
+         * @brief A buffer which has been appended to the track but not released by the audio callback yet
+         */
+        struct PendingBuffer {
+            span<i16> samples; //!< The samples of the buffer, these are read in place by the audio callback
+            u64 finalSample; //!< The value of the sample counter once all samples of the buffer have been played
+        };
+
+        std::array<PendingBuffer, MaxPendingBuffers> pendingBuffers{}; //!< A ring of buffers which haven't been released by the audio callback yet
+        std::array<std::vector<i16>, MaxPendingBuffers> bufferCopies; //!< Copies of the samples of buffers which can't be read in place, these correspond to slots in `pendingBuffers` and their storage is reused across buffers
+        std::atomic<u64> appendedBuffers{}; //!< The total amount of buffers pushed into `pendingBuffers`, this is only written to by the producer
+        std::atomic<u64> playedBuffers{}; //!< The total amount of buffers popped from `pendingBuffers`, this is only written to by the audio callback
+        u64 readBuffer{}; //!< The index of the buffer in `pendingBuffers` which is currently being read, this must only be accessed by the audio callback
+        size_t readOffset{}; //!< The offset of the next sample to be read in the current buffer, this must only be accessed by the audio callback
 
         u8 channelCount;
         u32 sampleRate;
 
       public:
-        CircularBuffer<i16, constant::SampleRate * constant::ChannelCount * 10> samples; //!< A circular buffer with all appended audio samples
-        std::mutex bufferLock; //!< Synchronizes appending to audio buffers
+        std::mutex bufferLock; //!< Synchronizes guest threads appending and releasing buffers, this is never locked by the audio callback
 
-        AudioOutState playbackState{AudioOutState::Stopped}; //!< The current state of playback
-        u64 sampleCounter{}; //!< A counter used for tracking when buffers have been played and can be released
+        std::atomic<AudioOutState> playbackState{AudioOutState::Stopped}; //!< The current state of playback
+        std::atomic<u64> sampleCounter{}; //!< A counter of all played samples used for tracking when buffers have been played and can be released, this is only written to by the audio callback
 
         /**
          * @param channelCount The amount channels that will be present in the track
@@ -54,22 +72,49 @@ namespace skyline::audio {
 
         /**
          * @brief Gets the IDs of all newly released buffers
-         * @param max The maximum amount of buffers to return
-         * @return A vector containing the identifiers of the buffers
+         * @param bufferIds The span the identifiers of the buffers are written into, its size is the maximum amount of buffers to return
+         * @return The amount of identifiers that were written
          */
-        std::vector<u64> GetReleasedBuffers(u32 max);
+        u32 GetReleasedBuffers(span<u64> bufferIds);
 
         /**
-         * @brief Appends audio samples to the output buffer
+         * @brief Appends a buffer of audio samples to the track
          * @param tag The tag of the buffer
-         * @param buffer A span containing the source sample buffer
+         * @param buffer A span containing the source sample buffer, this is read in place and must not be modified until it's released unless `copy` is set
+         * @param copy If the samples should be copied into the track as the source buffer may be modified prior to the buffer being released
          */
-        void AppendBuffer(u64 tag, span<i16> buffer = {});
+        void AppendBuffer(u64 tag, span<i16> buffer = {}, bool copy = false);
+
+        /**
+         * @brief Consumes samples from appended buffers without copying them, the samples are supplied as contiguous spans in the order they were appended
+         * @param maxSize The maximum amount of samples to consume
+         * @param function A function called with each contiguous span of samples and the offset of its first sample from the start of the read
+         * @return The amount of samples consumed
+         * @note This must only be called by the audio callback
+         */
+        template<typename Function>
+        size_t Read(size_t maxSize, Function function) {
+            size_t size{};
+            for (u64 appended{appendedBuffers.load(std::memory_order_acquire)}; size < maxSize && readBuffer != appended;) {
+                auto &buffer{pendingBuffers[readBuffer % MaxPendingBuffers]};
+                size_t count{std::min(buffer.samples.size() - readOffset, maxSize - size)};
+                if (count)
+                    function(buffer.samples.subspan(readOffset, count), size);
+
+                size += count;
+                readOffset += count;
+                if (readOffset == buffer.samples.size()) {
+                    readBuffer++;
+                    readOffset = 0;
+                }
+            }
+            return size;
+        }
 
         /**
-         * @brief Checks if any buffers have been released and calls the appropriate callback for them
-         * @note bufferLock MUST be locked when calling this
+         * @brief Advances the sample counter by the amount of played samples and calls the release callback if any buffers have been released as a result
+         * @note This must only be called by the audio callback
          */
-        void CheckReleasedBuffers();
+        void CheckReleasedBuffers(size_t playedSamples);
     };
 }
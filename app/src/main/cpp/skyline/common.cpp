@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <future>
 #include "common.h"
+#include "common/host_affinity.h"
 #include "nce.h"
 #include "soc.h"
 #include "gpu.h"
@@ -12,10 +14,17 @@
 namespace skyline {
     DeviceState::DeviceState(kernel::OS *os, std::shared_ptr<JvmManager> jvmManager, std::shared_ptr<Settings> settings)
         : os(os), jvm(std::move(jvmManager)), settings(std::move(settings)) {
+        HostAffinity::SetEnabled(this->settings->hostThreadAffinity); // This must be set prior to any threads being created by the subsystems below
+
+        // Opening the audio stream and creating the Vulkan device are the slowest parts of this and are independent of each other, the audio stream is opened on another thread
+        auto audioFuture{std::async(std::launch::async, [this]() {
+            return std::make_shared<audio::Audio>(*this);
+        })};
+
         // We assign these later as they use the state in their constructor and we don't want null pointers
         gpu = std::make_shared<gpu::GPU>(*this);
         soc = std::make_shared<soc::SOC>(*this);
-        audio = std::make_shared<audio::Audio>(*this);
+        audio = audioFuture.get();
         nce = std::make_shared<nce::NCE>(*this);
         scheduler = std::make_shared<kernel::Scheduler>(*this);
         input = std::make_shared<input::Input>(*this);
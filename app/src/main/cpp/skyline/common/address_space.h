@@ -4,6 +4,9 @@
 #pragma once
 
 #include <concepts>
+#include <map>
+#include <set>
+#include <shared_mutex>
 #include <common.h>
 
 namespace skyline {
@@ -50,9 +53,12 @@ namespace skyline {
             }
         };
 
-        std::mutex blockMutex;
+        std::shared_mutex blockMutex; //!< Synchronizes access to the blocks, translations only need to take it shared so they don't contend with each other
         std::vector<Block> blocks{Block{}};
 
+        static inline std::atomic<u64> nextGeneration{1};
+        std::atomic<u64> generation{nextGeneration++}; //!< A value that uniquely identifies the current state of the mappings across all instances, this is changed by every Map/Unmap so cached translations can be invalidated without tracking them individually
+
         /**
          * @brief Maps a PA range into the given AS region
          * @note blockMutex MUST be locked when calling this
@@ -66,6 +72,16 @@ namespace skyline {
         void UnmapLocked(VaType virt, VaType size);
 
       public:
+        /**
+         * @brief A single mapping in a batch supplied to MapBatch
+         */
+        struct MapEntry {
+            VaType virt;
+            PaType phys;
+            VaType size;
+            ExtraBlockInfo extraInfo{};
+        };
+
         static constexpr VaType VaMaximum{(1ULL << (AddressSpaceBits - 1)) + ((1ULL << (AddressSpaceBits - 1)) - 1)}; //!< The maximum VA that this AS can technically reach
 
         VaType vaLimit{VaMaximum}; //!< A soft limit on the maximum VA of the AS
@@ -83,6 +99,13 @@ namespace skyline {
             std::scoped_lock lock(blockMutex);
             UnmapLocked(virt, size);
         }
+
+        /**
+         * @brief Maps all supplied PA ranges in a single pass over the blocks, this is equivalent to calling Map on each entry but only rebuilds the block vector once
+         * @param entries The mappings to apply, these **must** be sorted by VA and not overlap each other
+         * @note The unmap callback is called once for every contiguous run of VA covered by the entries rather than per-entry
+         */
+        void MapBatch(span<const MapEntry> entries);
     };
 
     /**
@@ -101,6 +124,47 @@ namespace skyline {
         static constexpr u64 SparseMapSize{0x400000000}; //!< 16GiB pool size for sparse mappings returned by TranslateRange, this number is arbritary and should be large enough to fit the largest sparse mapping in the AS
         u8 *sparseMap; //!< Pointer to a zero filled memory region that is returned by TranslateRange for sparse mappings
 
+        static constexpr size_t TlbPageBits{12}; //!< The log2 of the granularity that translations are cached at, this is independent of the page size of the AS
+        static constexpr VaType TlbPageMask{(1U << TlbPageBits) - 1};
+        static constexpr size_t TlbEntryCount{0x40};
+
+        /**
+         * @brief A cached translation of a single page that's entirely backed by a single non-sparse mapping
+         */
+        struct TlbEntry {
+            u64 generation; //!< The generation of the mappings at the time of translation, the entry is only valid while this matches the current generation
+            VaType page; //!< The VA of the page shifted right by TlbPageBits
+            u8 *phys; //!< The host address the start of the page is backed by
+        };
+
+        /**
+         * @brief A per-thread direct-mapped cache of translations, this is shared by all instances as the generation uniquely identifies the instance an entry is from
+         */
+        static inline thread_local std::array<TlbEntry, TlbEntryCount> tlb{};
+
+        /**
+         * @return The host address backing the supplied range if it's contained within a single page with a valid cached translation, nullptr otherwise
+         * @note This is lock-free, accesses to a region that race with it being remapped are inherently unordered
+         */
+        u8 *LookupTlb(VaType virt, VaType size) {
+            VaType page{virt >> TlbPageBits};
+            if (!size || ((virt + size - 1) >> TlbPageBits) != page)
+                return nullptr;
+
+            const auto &entry{tlb[page % TlbEntryCount]};
+            if (entry.page != page || entry.generation != this->generation.load(std::memory_order_acquire))
+                return nullptr;
+
+            return entry.phys + (virt & TlbPageMask);
+        }
+
+        /**
+         * @brief Caches the translation of the page containing the supplied address if the block it's in covers all of it
+         * @param successorVirt The VA of the block after the one containing the address
+         * @note blockMutex MUST be locked (shared or exclusively) when calling this
+         */
+        void FillTlb(VaType virt, const typename FlatMemoryManager::Block &block, VaType successorVirt);
+
       public:
         FlatMemoryManager();
 
@@ -118,6 +182,12 @@ namespace skyline {
          */
         std::vector<span<u8>> TranslateRange(VaType virt, VaType size);
 
+        /**
+         * @return A single span covering the supplied range if it's entirely backed by physically contiguous non-sparse mappings, an empty span otherwise
+         * @note This doesn't allocate unlike TranslateRange, it's intended for accessing guest memory in place with a fallback to Read
+         */
+        span<u8> TranslateContiguous(VaType virt, VaType size);
+
         void Read(u8 *destination, VaType virt, VaType size);
 
         template<typename T>
@@ -147,19 +217,44 @@ namespace skyline {
 
 
     /**
-     * @brief FlatMemoryManager specialises FlatAddressSpaceMap to work as an allocator, with an initial, fast linear pass and a subsequent slower pass that iterates until it finds a free block
+     * @brief FlatAllocator allocates regions of an AS, free regions are tracked by both their address and their size so allocations and frees are O(log n) in the amount of free regions
+     * @note Allocations are made linearly from the end of the previous linear allocation while possible to avoid reusing recently freed regions, the smallest free region that fits is used otherwise
      */
     template<typename VaType, VaType UnmappedVa, size_t AddressSpaceBits> requires AddressSpaceValid<VaType, AddressSpaceBits>
-    class FlatAllocator : public FlatAddressSpaceMap<VaType, UnmappedVa, bool, false, false, AddressSpaceBits> {
+    class FlatAllocator {
       private:
-        using Base = FlatAddressSpaceMap<VaType, UnmappedVa, bool, false, false, AddressSpaceBits>;
-
+        std::mutex mutex; //!< Synchronizes access to the free regions, this is independent of any AS map so allocations never block translations
+        using FreeRegionMap = std::map<VaType, VaType>;
+        FreeRegionMap freeRegions; //!< A map from the start of every free region to its end, adjacent free regions are always merged
+        std::set<std::pair<VaType, VaType>> freeSizes; //!< The size and start of every free region, this is ordered by size for best-fit searches
         VaType currentLinearAllocEnd; //!< The end address for the initial linear allocation pass, once this reaches the AS limit the slower allocation path will be used
 
+        /**
+         * @brief Inserts a free region without merging it with adjacent ones
+         * @note The mutex MUST be locked when calling this
+         */
+        void InsertFreeLocked(VaType start, VaType end);
+
+        /**
+         * @brief Erases a free region
+         * @return An iterator to the free region after the erased one
+         * @note The mutex MUST be locked when calling this
+         */
+        typename FreeRegionMap::iterator EraseFreeLocked(typename FreeRegionMap::iterator region);
+
+        /**
+         * @brief Removes the supplied range from any free regions it overlaps with, splitting them if necessary
+         * @note The mutex MUST be locked when calling this
+         */
+        void ReserveLocked(VaType start, VaType end);
+
       public:
+        static constexpr VaType VaMaximum{FlatAddressSpaceMap<VaType, UnmappedVa, bool, false, false, AddressSpaceBits>::VaMaximum}; //!< The maximum VA that this AS can technically reach
+
         VaType vaStart; //!< The base VA of the allocator, no allocations will be below this
+        VaType vaLimit; //!< A soft limit on the maximum VA of the AS, no allocations will extend past this
 
-        FlatAllocator(VaType vaStart, VaType vaLimit = Base::VaMaximum);
+        FlatAllocator(VaType vaStart, VaType vaLimit = VaMaximum);
 
         /**
          * @brief Allocates a region in the AS of the given size and returns its address
@@ -7,138 +7,102 @@
 
 namespace skyline {
     /**
-     * @brief An abstraction of an array into a circular buffer
+     * @brief An abstraction of an array into a lock-free single-producer single-consumer circular buffer
      * @tparam Type The type of elements stored in the buffer
      * @tparam Size The maximum size of the circular buffer
+     * @note All producers must be externally synchronized with each other, there can only be a single consumer
      * @url https://en.wikipedia.org/wiki/Circular_buffer
      */
     template<typename Type, size_t Size>
     class CircularBuffer {
       private:
+        static constexpr size_t CacheLineSize{64}; //!< The head and tail are on separate cache lines to avoid false sharing between the producer and consumer
+
         std::array<Type, Size> array{}; //!< The internal array holding the circular buffer
-        Type *start{array.begin()}; //!< The start/oldest element of the internal array
-        Type *end{array.begin()}; //!< The end/newest element of the internal array
-        bool empty{true}; //!< If the buffer is full or empty, as start == end can mean either
-        std::mutex mtx; //!< Synchronizes buffer operations so they don't overlap
+        alignas(CacheLineSize) std::atomic<u64> head{}; //!< The total amount of elements consumed, this is only written to by the consumer
+        alignas(CacheLineSize) std::atomic<u64> tail{}; //!< The total amount of elements appended, this is only written to by the producer
 
       public:
         /**
-         * @brief Reads data from this buffer into the specified buffer
-         * @param copyFunction If this is specified, then this is called rather than memcpy
-         * @param copyOffset The offset into the buffer after which to use memcpy rather than copyFunction, -1 will use it for the entire buffer
-         * @return The amount of data written into the input buffer in units of Type
+         * @brief Consumes data from this buffer without copying it, the data is supplied as at most two contiguous spans in the order it was appended
+         * @param maxSize The maximum amount of elements to consume
+         * @param function A function called with each contiguous span of elements and the offset of its first element from the start of the read
+         * @return The amount of elements consumed
+         * @note This must only be called by the consumer
          */
-        size_t Read(span <Type> buffer, void copyFunction(Type *, Type *) = {}, ssize_t copyOffset = -1) {
-            std::lock_guard guard(mtx);
-
-            if (empty)
+        template<typename Function>
+        size_t Read(size_t maxSize, Function function) {
+            u64 readIndex{head.load(std::memory_order_relaxed)};
+            size_t size{std::min(static_cast<size_t>(tail.load(std::memory_order_acquire) - readIndex), maxSize)};
+            if (!size)
                 return 0;
 
-            Type *pointer{buffer.data()};
-            ssize_t maxSize{static_cast<ssize_t>(buffer.size())}, size{}, sizeBegin{}, sizeEnd{};
-
-            if (start < end) {
-                sizeEnd = std::min(end - start, maxSize);
-
-                size = sizeEnd;
-            } else {
-                sizeEnd = std::min(array.end() - start, maxSize);
-                sizeBegin = std::min(end - array.begin(), maxSize - sizeEnd);
-
-                size = sizeBegin + sizeEnd;
-            }
-
-            if (copyFunction && copyOffset) {
-                auto sourceEnd{start + ((copyOffset != -1) ? copyOffset : sizeEnd)};
+            size_t offset{static_cast<size_t>(readIndex % Size)};
+            size_t sizeEnd{std::min(size, Size - offset)};
+            function(span<Type>(array.data() + offset, sizeEnd), size_t{});
 
-                for (auto source{start}, destination{pointer}; source < sourceEnd; source++, destination++)
-                    copyFunction(source, destination);
+            if (size > sizeEnd)
+                // The data wraps around, the rest of it is at the beginning of the array
+                function(span<Type>(array.data(), size - sizeEnd), sizeEnd);
 
-                if (copyOffset != -1) {
-                    std::memcpy(pointer + copyOffset, start + copyOffset, static_cast<size_t>(sizeEnd - copyOffset) * sizeof(Type));
-                    copyOffset -= sizeEnd;
-                }
-            } else {
-                std::memcpy(pointer, start, static_cast<size_t>(sizeEnd) * sizeof(Type));
-            }
-
-            pointer += sizeEnd;
-
-            if (sizeBegin) {
-                if (copyFunction && copyOffset) {
-                    auto sourceEnd{array.begin() + ((copyOffset != -1) ? copyOffset : sizeBegin)};
-
-                    for (auto source{array.begin()}, destination{pointer}; source < sourceEnd; source++, destination++)
-                        copyFunction(source, destination);
-
-                    if (copyOffset != -1)
-                        std::memcpy(array.begin() + copyOffset, pointer + copyOffset, static_cast<size_t>(sizeBegin - copyOffset) * sizeof(Type));
-                } else {
-                    std::memcpy(pointer, array.begin(), static_cast<size_t>(sizeBegin) * sizeof(Type));
-                }
-
-                start = array.begin() + sizeBegin;
-            } else {
-                start += sizeEnd;
-            }
-
-            if (start == end)
-                empty = true;
-
-            return static_cast<size_t>(size);
+            head.store(readIndex + size, std::memory_order_release); // The producer may only overwrite the consumed elements after we're done reading them
+            return size;
         }
 
         /**
-         * @brief Appends data from the specified buffer into this buffer
+         * @brief Reads data from this buffer into the specified buffer
+         * @return The amount of data written into the input buffer in units of Type
+         * @note This must only be called by the consumer
          */
-        void Append(span <Type> buffer) {
-            std::lock_guard guard(mtx);
-
-            Type *pointer{buffer.data()};
-            ssize_t size{static_cast<ssize_t>(buffer.size())};
-            while (size) {
-                if (start <= end && end != array.end()) {
-                    auto sizeEnd{std::min(array.end() - end, size)};
-                    std::memcpy(end, pointer, static_cast<size_t>(sizeEnd) * sizeof(Type));
-
-                    pointer += sizeEnd;
-                    size -= sizeEnd;
-
-                    end += sizeEnd;
-                } else {
-                    auto sizePreStart{(end == array.end()) ? std::min(start - array.begin(), size) : std::min(start - end, size)};
-                    auto sizePostStart{std::min(array.end() - start, size - sizePreStart)};
-
-                    if (sizePreStart)
-                        std::memcpy((end == array.end()) ? array.begin() : end, pointer, static_cast<size_t>(sizePreStart) * sizeof(Type));
-
-                    if (end == array.end())
-                        end = array.begin() + sizePreStart;
-                    else
-                        end += sizePreStart;
+        size_t Read(span<Type> buffer) {
+            return Read(buffer.size(), [&](span<Type> source, size_t offset) {
+                std::memcpy(buffer.data() + offset, source.data(), source.size_bytes());
+            });
+        }
 
-                    pointer += sizePreStart;
-                    size -= sizePreStart;
+        /**
+         * @brief Produces data into this buffer without an intermediate copy, the free space is supplied as at most two contiguous spans in the order they'll be consumed
+         * @param maxSize The maximum amount of elements to produce, this is clamped to the free space in the buffer
+         * @param function A function called with each contiguous span of free elements and the offset of its first element from the start of the write, it must fill the entire span
+         * @return The amount of elements produced
+         * @note This must only be called by the producer
+         */
+        template<typename Function>
+        size_t Write(size_t maxSize, Function function) {
+            u64 writeIndex{tail.load(std::memory_order_relaxed)};
+            size_t size{std::min(maxSize, Size - static_cast<size_t>(writeIndex - head.load(std::memory_order_acquire)))};
+            if (!size)
+                return 0;
 
-                    if (sizePostStart)
-                        std::memcpy(end, pointer, static_cast<size_t>(sizePostStart) * sizeof(Type));
+            size_t offset{static_cast<size_t>(writeIndex % Size)};
+            size_t sizeEnd{std::min(size, Size - offset)};
+            function(span<Type>(array.data() + offset, sizeEnd), size_t{});
 
-                    if (start == array.end())
-                        start = array.begin() + sizePostStart;
-                    else
-                        start += sizePostStart;
+            if (size > sizeEnd)
+                // The free space wraps around, the rest of it is at the beginning of the array
+                function(span<Type>(array.data(), size - sizeEnd), sizeEnd);
 
-                    if (end == array.end())
-                        end = array.begin() + sizePostStart;
-                    else
-                        end += sizePostStart;
+            tail.store(writeIndex + size, std::memory_order_release); // The consumer must observe the written data before the new tail
+            return size;
+        }
 
-                    pointer += sizePostStart;
-                    size -= sizePostStart;
-                }
+        /**
+         * @brief Appends data from the specified buffer into this buffer, any data that doesn't fit into the free space is dropped as unconsumed data can't be overwritten without racing with the consumer
+         * @return The amount of elements that were appended
+         * @note This must only be called by the producer
+         */
+        size_t Append(span<Type> buffer) {
+            return Write(buffer.size(), [&](span<Type> destination, size_t offset) {
+                std::memcpy(destination.data(), buffer.data() + offset, destination.size_bytes());
+            });
+        }
 
-                empty = false;
-            }
+        /**
+         * @return The amount of elements which have been appended but not consumed yet
+         * @note This is a lower bound when called by the consumer and an upper bound when called by the producer as the other side may concurrently append or consume elements
+         */
+        size_t GetSize() {
+            return static_cast<size_t>(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire));
         }
     };
 }
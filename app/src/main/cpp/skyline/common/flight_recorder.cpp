@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <fstream>
+#include <unistd.h>
+#include "flight_recorder.h"
+
+namespace skyline::trace {
+    struct FlightRecorder::ThreadRing {
+        std::array<Event, EventsPerThread> events;
+        std::atomic<u64> position; //!< The total amount of events recorded into this ring, this is only written to by the owning thread
+        std::atomic<pid_t> owner; //!< The TID of the thread which owns this ring or 0 if it's free for reuse
+        pid_t tid; //!< The TID of the thread which last owned this ring
+        ThreadRing *next; //!< The next ring in the list of all rings
+    };
+
+    static std::atomic<FlightRecorder::ThreadRing *> ringHead; //!< The head of a list of all rings, rings are never freed as a dump may be reading them at any point
+
+    /**
+     * @brief Releases the ring of a thread when it exits so it can be reused by another thread
+     */
+    struct RingOwner {
+        FlightRecorder::ThreadRing *ring{};
+
+        ~RingOwner();
+    };
+
+    RingOwner::~RingOwner() {
+        if (ring)
+            ring->owner.store(0, std::memory_order_release);
+    }
+
+    thread_local static RingOwner ringOwner;
+
+    FlightRecorder::ThreadRing &FlightRecorder::GetRing() {
+        if (ringOwner.ring) [[likely]]
+            return *ringOwner.ring;
+
+        pid_t tid{gettid()};
+        ThreadRing *ring{};
+        for (auto *it{ringHead.load(std::memory_order_acquire)}; it; it = it->next) {
+            pid_t expected{0};
+            if (it->owner.compare_exchange_strong(expected, tid, std::memory_order_acquire)) {
+                ring = it;
+                break;
+            }
+        }
+
+        if (ring) {
+            ring->position.store(0, std::memory_order_release);
+        } else {
+            ring = new ThreadRing{};
+            ring->owner.store(tid, std::memory_order_relaxed);
+            ring->next = ringHead.load(std::memory_order_relaxed);
+            while (!ringHead.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed));
+        }
+        ring->tid = tid;
+
+        ringOwner.ring = ring;
+        return *ring;
+    }
+
+    void FlightRecorder::Record(EventType type, u64 data0, u64 data1) {
+        auto &ring{GetRing()};
+        auto position{ring.position.load(std::memory_order_relaxed)};
+        ring.events[position & (EventsPerThread - 1)] = Event{
+            .timestamp = util::GetTimeTicks(),
+            .type = type,
+            .data0 = data0,
+            .data1 = data1,
+        };
+        ring.position.store(position + 1, std::memory_order_release);
+    }
+
+    void FlightRecorder::Dump(const std::string &path) {
+        struct ThreadDump {
+            ThreadHeader header;
+            std::vector<Event> events;
+        };
+        std::vector<ThreadDump> threads;
+        std::map<u64, std::string_view> strings;
+
+        for (auto *ring{ringHead.load(std::memory_order_acquire)}; ring; ring = ring->next) {
+            auto end{ring->position.load(std::memory_order_acquire)};
+            if (!end)
+                continue;
+
+            auto start{end > EventsPerThread ? end - EventsPerThread : 0};
+            std::vector<Event> events;
+            events.reserve(end - start);
+            for (auto position{start}; position < end; position++)
+                events.push_back(ring->events[position & (EventsPerThread - 1)]);
+
+            // Any events which were overwritten while we were copying them may be torn, they need to be discarded
+            auto newEnd{ring->position.load(std::memory_order_acquire)};
+            if (newEnd < end)
+                continue; // The ring was reused by another thread while we were copying it
+            if (newEnd > start + EventsPerThread)
+                events.erase(events.begin(), events.begin() + static_cast<ssize_t>(std::min(newEnd - start - EventsPerThread, events.size())));
+
+            ThreadDump thread{.header = {.tid = ring->tid, .name = {}, .eventCount = static_cast<u32>(events.size())}};
+            std::string name{"exited"};
+            if (ring->owner.load(std::memory_order_relaxed) == ring->tid) {
+                std::ifstream comm(fmt::format("/proc/self/task/{}/comm", ring->tid));
+                std::getline(comm, name);
+            }
+            std::strncpy(thread.header.name.data(), name.c_str(), thread.header.name.size() - 1);
+
+            for (const auto &event : events)
+                if (event.type == EventType::IpcRequest && event.data1)
+                    strings.try_emplace(event.data1, reinterpret_cast<const char *>(event.data1));
+
+            thread.events = std::move(events);
+            threads.push_back(std::move(thread));
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            Logger::Warn("Failed to open flight recorder dump at '{}'", path);
+            return;
+        }
+
+        u64 tickFrequency;
+        asm("MRS %0, CNTFRQ_EL0" : "=r"(tickFrequency));
+        DumpHeader header{
+            .threadCount = static_cast<u32>(threads.size()),
+            .stringCount = static_cast<u32>(strings.size()),
+            .tickFrequency = tickFrequency,
+        };
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        for (const auto &thread : threads) {
+            file.write(reinterpret_cast<const char *>(&thread.header), sizeof(thread.header));
+            file.write(reinterpret_cast<const char *>(thread.events.data()), static_cast<std::streamsize>(thread.events.size() * sizeof(Event)));
+        }
+
+        for (const auto &[pointer, string] : strings) {
+            StringEntry entry{.pointer = pointer, .length = static_cast<u32>(string.size())};
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            file.write(string.data(), static_cast<std::streamsize>(string.size()));
+        }
+
+        size_t eventCount{};
+        for (const auto &thread : threads)
+            eventCount += thread.events.size();
+        Logger::Info("Dumped {} events from {} threads into the flight recorder dump", eventCount, threads.size());
+    }
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::trace {
+    /**
+     * @brief An always-on flight recorder which keeps the most recent compact binary events of every thread in per-thread rings, these can be dumped into a file on a crash or at the end of emulation to provide a timeline for reports
+     * @note Recording an event is a handful of plain stores into a thread-owned ring, it never blocks or allocates after the first event on a thread
+     */
+    class FlightRecorder {
+      public:
+        enum class EventType : u8 {
+            SvcEnter, //!< data0: SVC ID
+            SvcExit, //!< data0: SVC ID
+            IpcRequest, //!< data0: Command ID, data1: A pointer to the static name of the service function (Resolved into the string table when dumping)
+            GpfifoEntry, //!< data0: The raw GpEntry
+            Present, //!< data0: The frame time in nanoseconds
+            FenceSignal, //!< data0: The address of the syncpoint, data1: The value it was incremented to
+        };
+
+        /**
+         * @brief A single event in the flight recorder, this is the format the event is dumped in
+         */
+        struct Event {
+            u64 timestamp; //!< The timestamp of the event in ticks of the system counter, see DumpHeader::tickFrequency
+            EventType type;
+            u8 _pad0_[7];
+            u64 data0;
+            u64 data1;
+        };
+        static_assert(sizeof(Event) == 0x20);
+
+        static constexpr size_t EventsPerThread{4096}; //!< The amount of most recent events retained for every thread, this must be a power of two
+
+        /**
+         * @brief The header of a dump, it's followed by ThreadHeader-prefixed events for every thread and then StringEntry-prefixed strings for every IPC request
+         */
+        struct DumpHeader {
+            u64 magic{util::MakeMagic<u64>("SKYFLREC")};
+            u32 version{1};
+            u32 threadCount;
+            u32 stringCount;
+            u32 _pad0_;
+            u64 tickFrequency; //!< The frequency of the counter event timestamps are in
+        };
+        static_assert(sizeof(DumpHeader) == 0x20);
+
+        struct ThreadHeader {
+            i32 tid;
+            std::array<char, 16> name; //!< The name of the thread or "exited" if it no longer exists
+            u32 eventCount; //!< The amount of events following this header, they're sorted from oldest to newest
+        };
+        static_assert(sizeof(ThreadHeader) == 0x18);
+
+        struct StringEntry {
+            u64 pointer; //!< The pointer used as data1 in IpcRequest events
+            u32 length; //!< The length of the string following this entry, it isn't null-terminated
+            u32 _pad0_;
+        };
+        static_assert(sizeof(StringEntry) == 0x10);
+
+        struct ThreadRing; //!< The ring of events for a single thread, this is opaque outside the implementation
+
+      private:
+        /**
+         * @return The ring for the calling thread, it's acquired on the first event from the thread
+         */
+        static ThreadRing &GetRing();
+
+      public:
+        static inline std::string CrashDumpPath; //!< The path the flight recorder is dumped to when the process is terminated due to an uncaught exception, nothing is dumped if this is empty
+
+        /**
+         * @brief Records an event into the ring of the calling thread
+         */
+        static void Record(EventType type, u64 data0 = 0, u64 data1 = 0);
+
+        /**
+         * @brief Writes out the contents of all rings into a file at the supplied path
+         * @note Threads can record events while this is running, events being written concurrently may be torn in the dump
+         */
+        static void Dump(const std::string &path);
+    };
+}
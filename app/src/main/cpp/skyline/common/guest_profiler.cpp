@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <cxxabi.h>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+#include <loader/loader.h>
+#include "signal.h"
+#include "guest_profiler.h"
+
+namespace skyline::trace {
+    /**
+     * @brief A slot in the ring of samples, a slot is only valid if its sequence is one past its position in the ring
+     * @note The fields are atomic as the aggregator may read a slot while it's being overwritten, it detects this by rechecking the sequence
+     */
+    struct Sample {
+        std::atomic<u64> sequence;
+        std::atomic<u64> pc; //!< The guest PC at the time of the sample or 0 if the thread was in host code
+        std::atomic<u64> lr;
+    };
+
+    static constexpr size_t SampleRingSize{1 << 14}; //!< The amount of samples that can be in flight prior to being aggregated, this must be a power of two
+    static std::array<Sample, SampleRingSize> sampleRing;
+    static std::atomic<u64> writePosition; //!< The total amount of samples recorded into the ring
+    static u64 readPosition; //!< The position of the next sample to be aggregated, this is only accessed by the aggregator
+    static u64 droppedSamples; //!< The amount of samples that were overwritten prior to being aggregated
+
+    static std::map<std::pair<u64, u64>, u64> sampleCounts; //!< A map from the PC and LR of a sample to the amount of times it was sampled, this is only accessed by the aggregator
+    static std::atomic<bool> active;
+    static std::thread aggregatorThread;
+
+    /**
+     * @brief Aggregates all samples in the ring which have been recorded so far
+     */
+    static void DrainSamples() {
+        auto end{writePosition.load(std::memory_order_acquire)};
+        for (; readPosition < end; readPosition++) {
+            auto &sample{sampleRing[readPosition & (SampleRingSize - 1)]};
+            auto sequence{sample.sequence.load(std::memory_order_acquire)};
+            if (sequence < readPosition + 1)
+                break; // The sample has been claimed but not written yet, it'll be aggregated on the next drain
+
+            u64 pc{sample.pc.load(std::memory_order_relaxed)}, lr{sample.lr.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence != readPosition + 1 || sample.sequence.load(std::memory_order_acquire) != sequence) {
+                droppedSamples++;
+                continue;
+            }
+
+            sampleCounts[{pc, lr}]++;
+        }
+    }
+
+    void GuestProfiler::Start() {
+        Stop(); // A session that wasn't stopped would leave the aggregator joinable, assigning over it would terminate
+        readPosition = writePosition.load(std::memory_order_acquire);
+        droppedSamples = 0;
+        sampleCounts.clear();
+        active = true;
+
+        aggregatorThread = std::thread([]() {
+            pthread_setname_np(pthread_self(), "GuestProfiler");
+            while (active.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                DrainSamples();
+            }
+        });
+        Logger::Info("Sampling guest threads every {}us of CPU time", SampleInterval.count());
+    }
+
+    bool GuestProfiler::IsActive() {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    void GuestProfiler::RegisterCurrentThread(timer_t &timer) {
+        signal::SetSignalHandler({SampleSignal}, SignalHandler);
+
+        struct sigevent event{
+            .sigev_signo = SampleSignal,
+            .sigev_notify = SIGEV_THREAD_ID,
+            .sigev_notify_thread_id = gettid(),
+        };
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer))
+            throw exception("timer_create has failed with '{}'", strerror(errno));
+
+        struct itimerspec spec{
+            .it_interval = {.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(SampleInterval).count()},
+            .it_value = {.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(SampleInterval).count()},
+        };
+        if (timer_settime(timer, 0, &spec, nullptr)) {
+            auto error{errno};
+            timer_delete(timer);
+            timer = {};
+            throw exception("timer_settime has failed with '{}'", strerror(error));
+        }
+    }
+
+    void GuestProfiler::UnregisterCurrentThread(timer_t &timer) {
+        if (timer) {
+            timer_delete(timer);
+            timer = {};
+        }
+    }
+
+    void GuestProfiler::SignalHandler(int signal, siginfo *info, ucontext *ctx, void **tls) {
+        auto position{writePosition.fetch_add(1, std::memory_order_relaxed)};
+        auto &sample{sampleRing[position & (SampleRingSize - 1)]};
+        sample.sequence.store(0, std::memory_order_relaxed); // The slot is invalidated while it's being written, the aggregator will discard it if it reads it in the meantime
+        std::atomic_thread_fence(std::memory_order_release);
+        if (*tls) { // If TLS was restored then this occurred in guest code
+            sample.pc.store(ctx->uc_mcontext.pc, std::memory_order_relaxed);
+            sample.lr.store(ctx->uc_mcontext.regs[30], std::memory_order_relaxed);
+        } else {
+            sample.pc.store(0, std::memory_order_relaxed);
+            sample.lr.store(0, std::memory_order_relaxed);
+        }
+        sample.sequence.store(position + 1, std::memory_order_release);
+    }
+
+    /**
+     * @return A name for the frame at the supplied guest address in the folded stack format
+     */
+    static std::string GetFrameName(loader::Loader &loader, u64 address) {
+        auto symbol{loader.ResolveSymbol(reinterpret_cast<void *>(address))};
+        if (symbol.name) {
+            int status{};
+            std::unique_ptr<char, decltype(&std::free)> demangled{abi::__cxa_demangle(symbol.name, nullptr, nullptr, &status), std::free};
+            return fmt::format("{}!{}", symbol.executableName, (status == 0) ? std::string_view(demangled.get()) : symbol.name);
+        } else if (!symbol.executableName.empty()) {
+            return fmt::format("{}!0x{:X}", symbol.executableName, address);
+        }
+        return fmt::format("0x{:X}", address);
+    }
+
+    void GuestProfiler::Stop() {
+        active = false;
+        if (aggregatorThread.joinable())
+            aggregatorThread.join();
+    }
+
+    void GuestProfiler::Stop(loader::Loader &loader, const std::string &path) {
+        Stop();
+        DrainSamples();
+
+        std::unordered_map<u64, std::string> frameNames; // Many samples share the same addresses, they're only symbolized once
+        auto getFrameName{[&](u64 address) -> const std::string & {
+            auto it{frameNames.find(address)};
+            if (it == frameNames.end())
+                it = frameNames.emplace(address, GetFrameName(loader, address)).first;
+            return it->second;
+        }};
+
+        std::map<std::string, u64> stacks; // Samples at different addresses in the same functions are folded into the same stack
+        u64 totalSamples{}, hostSamples{};
+        for (const auto &[addresses, count] : sampleCounts) {
+            auto [pc, lr]{addresses};
+            totalSamples += count;
+            if (!pc) {
+                hostSamples += count;
+                stacks["[host]"] += count;
+                continue;
+            }
+
+            const auto &function{getFrameName(pc)};
+            if (lr) {
+                const auto &caller{getFrameName(lr - sizeof(u32))}; // LR points to the instruction after the call, the call itself is used so a call at the end of a function resolves to it
+                if (caller != function) {
+                    stacks[caller + ';' + function] += count;
+                    continue;
+                }
+            }
+            stacks[function] += count;
+        }
+
+        std::ofstream file{path, std::ios::trunc};
+        if (!file)
+            throw exception("Failed to open guest profile '{}': {}", path, strerror(errno));
+        for (const auto &[stack, count] : stacks)
+            file << stack << ' ' << count << '\n';
+
+        Logger::Info("Wrote {} samples ({:.1f}% in host code, {} dropped) to the guest profile at {}", totalSamples, totalSamples ? (static_cast<double>(hostSamples) * 100.0 / static_cast<double>(totalSamples)) : 0.0, droppedSamples, path);
+        sampleCounts.clear();
+    }
+}
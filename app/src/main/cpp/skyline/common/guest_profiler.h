@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::loader {
+    class Loader;
+}
+
+namespace skyline::trace {
+    /**
+     * @brief A sampling profiler for guest code, guest threads are interrupted with a signal after every SampleInterval of CPU time they consume and the guest PC and LR at that point are recorded
+     * @note Samples taken while a thread is in host code (SVCs and HLE services) are attributed to the host as a whole, this separates HLE overhead from the CPU cost of the guest itself
+     * @note Samples are recorded into a lock-free ring from the signal handler and aggregated by a background thread, they're only symbolized when the profile is written out at the end of emulation
+     */
+    class GuestProfiler {
+      public:
+        static constexpr std::chrono::microseconds SampleInterval{500}; //!< The amount of CPU time a thread consumes between samples
+        inline static int SampleSignal{SIGRTMIN + 2}; //!< The signal used to interrupt threads to take a sample
+
+        /**
+         * @brief Stops the profiler without writing out a profile when destroyed, this ensures the aggregator is always joined even if emulation ends with an exception
+         */
+        struct ScopedStop {
+            ~ScopedStop() {
+                Stop();
+            }
+        };
+
+        /**
+         * @brief Starts aggregating samples, threads only register themselves for sampling if this was called prior to them starting
+         */
+        static void Start();
+
+        /**
+         * @return If the profiler has been started and not stopped yet
+         */
+        static bool IsActive();
+
+        /**
+         * @brief Sets up the calling guest thread to be sampled periodically
+         * @param timer The timer which sends the sample signal to the thread is written to this
+         */
+        static void RegisterCurrentThread(timer_t &timer);
+
+        /**
+         * @brief Stops sampling the thread that the supplied timer was created for, this must be called prior to the host thread being reused for another guest thread
+         * @note This does nothing if the timer wasn't created
+         */
+        static void UnregisterCurrentThread(timer_t &timer);
+
+        static void SignalHandler(int signal, siginfo *info, ucontext *ctx, void **tls);
+
+        /**
+         * @brief Stops aggregating samples and joins the aggregator, this does nothing if the profiler isn't active
+         */
+        static void Stop();
+
+        /**
+         * @brief Stops aggregating samples and writes all samples in the folded stack format with a caller;callee stack for each unique sample to the supplied path
+         * @param loader The loader of the profiled process, it's used to symbolize the guest addresses of samples
+         * @note The caller of a sample is derived from LR which isn't the return address of the sampled function after it has called any other function, the caller is omitted if LR points into the sampled function itself
+         */
+        static void Stop(loader::Loader &loader, const std::string &path);
+    };
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <fstream>
+#include "host_affinity.h"
+
+namespace skyline {
+    /**
+     * @return The value of a numeric sysfs attribute of a host core or 0 if it doesn't exist
+     */
+    static u64 ReadCoreAttribute(size_t core, std::string_view attribute) {
+        std::ifstream file(fmt::format("/sys/devices/system/cpu/cpu{}/{}", core, attribute));
+        u64 value{};
+        file >> value;
+        return file ? value : 0;
+    }
+
+    const HostAffinity::Topology &HostAffinity::GetTopology() {
+        static const Topology topology{[]() {
+            Topology topology{.coreCount = std::max(std::thread::hardware_concurrency(), 1U)};
+
+            // The capacity is the kernel's own measure of relative core performance, it accounts for differences in microarchitecture that frequency doesn't
+            std::vector<u64> capacities(topology.coreCount);
+            bool hasCapacity{true};
+            for (size_t core{}; core < topology.coreCount; core++)
+                hasCapacity &= (capacities[core] = ReadCoreAttribute(core, "cpu_capacity")) != 0;
+            if (!hasCapacity)
+                for (size_t core{}; core < topology.coreCount; core++)
+                    capacities[core] = ReadCoreAttribute(core, "cpufreq/cpuinfo_max_freq");
+
+            // If the capacities are unavailable or identical across all cores then all cores are treated as performance cores
+            auto [minCapacity, maxCapacity]{std::minmax_element(capacities.begin(), capacities.end())};
+            u64 efficiencyCapacity{(*minCapacity && *minCapacity != *maxCapacity) ? *minCapacity : 0};
+
+            CPU_ZERO(&topology.allCores);
+            CPU_ZERO(&topology.performanceCores);
+            CPU_ZERO(&topology.efficiencyCores);
+            for (size_t core{}; core < topology.coreCount; core++) {
+                CPU_SET(core, &topology.allCores);
+                CPU_SET(core, (efficiencyCapacity && capacities[core] == efficiencyCapacity) ? &topology.efficiencyCores : &topology.performanceCores);
+            }
+
+            Logger::Info("Host topology: {} cores ({} performance, {} efficiency)", topology.coreCount, CPU_COUNT(&topology.performanceCores), CPU_COUNT(&topology.efficiencyCores));
+            return topology;
+        }()};
+        return topology;
+    }
+
+    void HostAffinity::PinCurrentThread(ThreadClass threadClass) {
+        const auto &topology{GetTopology()};
+        const cpu_set_t *cores{&topology.allCores};
+        if (enabled.load(std::memory_order_relaxed)) {
+            if (threadClass == ThreadClass::Emulation)
+                cores = &topology.performanceCores;
+            else if (CPU_COUNT(&topology.efficiencyCores))
+                cores = &topology.efficiencyCores;
+        }
+
+        if (sched_setaffinity(0, sizeof(cpu_set_t), cores))
+            Logger::Warn("Failed to set the affinity of the current thread: {}", strerror(errno));
+    }
+}
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <sched.h>
+#include <common.h>
+
+namespace skyline {
+    /**
+     * @brief Determines the topology of the host's cores and places host threads onto the appropriate cluster of cores on big.LITTLE SoCs
+     * @note Threads are pinned to a whole cluster rather than a single core so the kernel can still balance them within it
+     */
+    class HostAffinity {
+      public:
+        /**
+         * @brief The class of work a host thread does, this determines which cluster it's placed on
+         */
+        enum class ThreadClass : u8 {
+            Emulation, //!< Threads on the critical path of emulation such as guest threads, GPFIFO processing and the audio callback, these are placed on performance cores
+            Background, //!< Threads which aren't latency-sensitive such as I/O and cache serialization, these are placed on efficiency cores
+        };
+
+        /**
+         * @brief The classification of the host's cores by their capacity
+         */
+        struct Topology {
+            size_t coreCount;
+            cpu_set_t allCores;
+            cpu_set_t performanceCores; //!< All cores which aren't in the cluster with the lowest capacity, this is all cores on a host without heterogeneous cores
+            cpu_set_t efficiencyCores; //!< The cores in the cluster with the lowest capacity, this is empty on a host without heterogeneous cores
+        };
+
+      private:
+        static inline std::atomic<bool> enabled{}; //!< If threads should be pinned to clusters, they're scheduled freely by the kernel otherwise
+
+      public:
+        /**
+         * @return The topology of the host's cores, it's determined on first use from the CPU capacity in sysfs or the maximum frequency of cores if that's unavailable
+         */
+        static const Topology &GetTopology();
+
+        /**
+         * @brief Sets if threads which start after this call should be pinned to clusters, this is configured from the settings at the start of emulation
+         */
+        static void SetEnabled(bool enable) {
+            enabled.store(enable, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Places the calling thread on the cluster for its class or allows it to run on all cores if pinning is disabled
+         * @note Threads which are reused across emulation sessions are unpinned by this when pinning is disabled
+         */
+        static void PinCurrentThread(ThreadClass threadClass);
+    };
+}
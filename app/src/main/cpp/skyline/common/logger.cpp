@@ -2,20 +2,26 @@
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <android/log.h>
+#include <condition_variable>
+#include <thread>
 #include "utils.h"
 #include "logger.h"
 
 namespace skyline {
     void Logger::LoggerContext::Initialize(const std::string &path) {
         start = util::GetTimeNs() / constant::NsInMillisecond;
+        std::lock_guard guard(mutex);
         logFile.open(path, std::ios::trunc);
     }
 
     void Logger::LoggerContext::Finalize() {
+        Logger::Flush();
+        std::lock_guard guard(mutex);
         logFile.close();
     }
 
     void Logger::LoggerContext::Flush() {
+        std::lock_guard guard(mutex);
         logFile.flush();
     }
 
@@ -39,25 +45,186 @@ namespace skyline {
         context = pContext;
     }
 
+    constexpr std::array<int, 5> LevelAlog{ANDROID_LOG_ERROR, ANDROID_LOG_WARN, ANDROID_LOG_INFO, ANDROID_LOG_DEBUG, ANDROID_LOG_VERBOSE}; //!< This corresponds to LogLevel and provides its equivalent for NDK Logging
+
     void Logger::WriteAndroid(LogLevel level, const std::string &str) {
-        constexpr std::array<int, 5> levelAlog{ANDROID_LOG_ERROR, ANDROID_LOG_WARN, ANDROID_LOG_INFO, ANDROID_LOG_DEBUG, ANDROID_LOG_VERBOSE}; // This corresponds to LogLevel and provides its equivalent for NDK Logging
         if (logTag.empty())
             UpdateTag();
 
-        __android_log_write(levelAlog[static_cast<u8>(level)], logTag.c_str(), str.c_str());
+        __android_log_write(LevelAlog[static_cast<u8>(level)], logTag.c_str(), str.c_str());
+    }
+
+    /**
+     * @brief A bounded lock-free multi-producer single-consumer queue of log records which are written out by a dedicated thread
+     * @url https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+     */
+    class LogQueue {
+      public:
+        struct Record {
+            Logger::LogLevel level;
+            i64 timestamp; //!< The timestamp of the record in milliseconds relative to the start of its context
+            Logger::LoggerContext *context;
+            std::string threadName; //!< A copy of the name of the thread which wrote the record, this always fits into the small string buffer
+            std::string message;
+            Logger::Decoder decoder; //!< A function which converts the message from raw data into text prior to it being written, this is nullptr if the message is already text
+        };
+
+      private:
+        static constexpr size_t Capacity{4096}; //!< The maximum amount of records in flight, this must be a power of two
+        static constexpr size_t CacheLineSize{64};
+
+        struct Slot {
+            std::atomic<size_t> sequence;
+            Record record;
+        };
+
+        std::array<Slot, Capacity> slots;
+        alignas(CacheLineSize) std::atomic<size_t> enqueuePosition{};
+        alignas(CacheLineSize) size_t dequeuePosition{}; //!< This is only accessed by the writer thread
+        std::atomic<size_t> writtenPosition{}; //!< The position up to which all records have been written out, this is used for flushing
+
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        std::atomic<bool> writerWaiting{};
+
+        bool TryPop(Record &record) {
+            auto &slot{slots[dequeuePosition & (Capacity - 1)]};
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+                return false;
+
+            record = std::move(slot.record);
+            slot.sequence.store(dequeuePosition + Capacity, std::memory_order_release);
+            dequeuePosition++;
+            return true;
+        }
+
+        void WriteRecord(const Record &record) {
+            constexpr std::array<char, 5> levelCharacter{'E', 'W', 'I', 'D', 'V'}; // The LogLevel as written out to a file
+
+            __android_log_write(LevelAlog[static_cast<u8>(record.level)], ("emu-cpp-" + record.threadName).c_str(), record.message.c_str());
+
+            if (record.context)
+                // We use RS (\036) and GS (\035) as our delimiters
+                record.context->Write(fmt::format("\036{}\035{}\035{}\035{}\n", levelCharacter[static_cast<u8>(record.level)], record.timestamp, record.threadName, record.message));
+        }
+
+        [[noreturn]] void WriterThread() {
+            pthread_setname_np(pthread_self(), "Logger");
+
+            Record record;
+            while (true) {
+                while (TryPop(record)) {
+                    if (record.decoder) {
+                        try {
+                            record.message = record.decoder(record.message);
+                        } catch (const std::exception &e) {
+                            record.message = fmt::format("Failed to decode message: {}", e.what());
+                        }
+                    }
+                    WriteRecord(record);
+                    writtenPosition.store(dequeuePosition, std::memory_order_release);
+                }
+
+                writerWaiting.store(true);
+                {
+                    std::unique_lock lock(wakeMutex);
+                    auto &slot{slots[dequeuePosition & (Capacity - 1)]};
+                    wakeCondition.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                        return slot.sequence.load(std::memory_order_acquire) == dequeuePosition + 1;
+                    });
+                }
+                writerWaiting.store(false);
+            }
+        }
+
+      public:
+        LogQueue() {
+            for (size_t index{}; index < Capacity; index++)
+                slots[index].sequence.store(index, std::memory_order_relaxed);
+
+            std::thread(&LogQueue::WriterThread, this).detach();
+        }
+
+        void Push(Record &&record) {
+            size_t position{enqueuePosition.load(std::memory_order_relaxed)};
+            while (true) {
+                auto &slot{slots[position & (Capacity - 1)]};
+                auto sequence{slot.sequence.load(std::memory_order_acquire)};
+                auto difference{static_cast<ssize_t>(sequence) - static_cast<ssize_t>(position)};
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.record = std::move(record);
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        break;
+                    }
+                } else if (difference < 0) {
+                    // The queue is full, we need to wait for the writer to free up a slot
+                    std::this_thread::yield();
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            if (writerWaiting.load()) {
+                std::lock_guard lock(wakeMutex);
+                wakeCondition.notify_one();
+            }
+        }
+
+        void Flush() {
+            auto target{enqueuePosition.load(std::memory_order_acquire)};
+            {
+                std::lock_guard lock(wakeMutex);
+                wakeCondition.notify_one();
+            }
+
+            while (writtenPosition.load(std::memory_order_acquire) < target)
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    };
+
+    /**
+     * @note The queue is constructed on first use so logging during static initialization is safe and is intentionally leaked so the same holds for static destruction
+     */
+    static LogQueue &GetLogQueue() {
+        static auto *logQueue{new LogQueue()};
+        return *logQueue;
+    }
+
+    void Logger::Write(LogLevel level, std::string str) {
+        if (logTag.empty())
+            UpdateTag();
+
+        GetLogQueue().Push(LogQueue::Record{
+            .level = level,
+            .timestamp = context ? (util::GetTimeNs() / constant::NsInMillisecond) - context->start : 0,
+            .context = context,
+            .threadName = threadName,
+            .message = std::move(str),
+        });
     }
 
-    void Logger::Write(LogLevel level, const std::string &str) {
-        constexpr std::array<char, 5> levelCharacter{'E', 'W', 'I', 'D', 'V'}; // The LogLevel as written out to a file
-        WriteAndroid(level, str);
+    void Logger::WriteDeferred(LogLevel level, std::string data, Decoder decoder) {
+        if (logTag.empty())
+            UpdateTag();
+
+        GetLogQueue().Push(LogQueue::Record{
+            .level = level,
+            .timestamp = context ? (util::GetTimeNs() / constant::NsInMillisecond) - context->start : 0,
+            .context = context,
+            .threadName = threadName,
+            .message = std::move(data),
+            .decoder = decoder,
+        });
+    }
 
-        if (context)
-            // We use RS (\036) and GS (\035) as our delimiters
-            context->Write(fmt::format("\036{}\035{}\035{}\035{}\n", levelCharacter[static_cast<u8>(level)], (util::GetTimeNs() / constant::NsInMillisecond) - context->start, threadName, str));
+    void Logger::Flush() {
+        GetLogQueue().Flush();
     }
 
     void Logger::LoggerContext::Write(const std::string &str) {
         std::lock_guard guard(mutex);
         logFile << str;
     }
-}
\ No newline at end of file
+}
@@ -7,9 +7,14 @@
 #include <mutex>
 #include "base.h"
 
+#ifndef SKYLINE_MAX_LOG_LEVEL
+#define SKYLINE_MAX_LOG_LEVEL 4 // Verbose
+#endif
+
 namespace skyline {
     /**
      * @brief A wrapper around writing logs into a log file and logcat using Android Log APIs
+     * @note Messages are formatted on the calling thread and queued into a lock-free ring, all I/O is done by a background writer thread
      */
     class Logger {
       private:
@@ -24,6 +29,7 @@ namespace skyline {
             Verbose,
         };
 
+        static constexpr LogLevel MaxLevel{static_cast<LogLevel>(SKYLINE_MAX_LOG_LEVEL)}; //!< The most verbose level of logs that's compiled in, any logging calls above this level are compiled out entirely including their formatting
         static inline LogLevel configLevel{LogLevel::Verbose}; //!< The minimum level of logs to write
 
         /**
@@ -38,10 +44,16 @@ namespace skyline {
 
             void Initialize(const std::string &path);
 
+            /**
+             * @brief Writes out all queued messages and closes the log file
+             */
             void Finalize();
 
             void Flush();
 
+            /**
+             * @note This is only called by the writer thread
+             */
             void Write(const std::string &str);
         };
         static inline LoggerContext EmulationContext, LoaderContext;
@@ -57,7 +69,23 @@ namespace skyline {
 
         static void WriteAndroid(LogLevel level, const std::string &str);
 
-        static void Write(LogLevel level, const std::string &str);
+        /**
+         * @brief Queues a message to be written by the writer thread
+         */
+        static void Write(LogLevel level, std::string str);
+
+        using Decoder = std::string (*)(std::string_view data); //!< A function which converts the data of a deferred message into the message itself
+
+        /**
+         * @brief Queues raw data to be decoded into a message by the supplied function on the writer thread and written
+         * @note This is used for messages which are expensive to decode and are written on hot paths, the decoder must not access any state that may change after this call
+         */
+        static void WriteDeferred(LogLevel level, std::string data, Decoder decoder);
+
+        /**
+         * @brief Blocks until all messages queued prior to this call have been written out
+         */
+        static void Flush();
 
         /**
          * @brief A wrapper around a string which captures the calling function using Clang source location builtins
@@ -78,92 +106,107 @@ namespace skyline {
 
         template<typename... Args>
         static void Error(FunctionString<const char *> formatString, Args &&... args) {
-            if (LogLevel::Error <= configLevel)
-                Write(LogLevel::Error, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Error <= MaxLevel)
+                if (LogLevel::Error <= configLevel)
+                    Write(LogLevel::Error, util::Format(*formatString, args...));
         }
 
         template<typename... Args>
         static void Error(FunctionString<std::string> formatString, Args &&... args) {
-            if (LogLevel::Error <= configLevel)
-                Write(LogLevel::Error, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Error <= MaxLevel)
+                if (LogLevel::Error <= configLevel)
+                    Write(LogLevel::Error, util::Format(*formatString, args...));
         }
 
         template<typename S, typename... Args>
         static void ErrorNoPrefix(S formatString, Args &&... args) {
-            if (LogLevel::Error <= configLevel)
-                Write(LogLevel::Error, util::Format(formatString, args...));
+            if constexpr (LogLevel::Error <= MaxLevel)
+                if (LogLevel::Error <= configLevel)
+                    Write(LogLevel::Error, util::Format(formatString, args...));
         }
 
         template<typename... Args>
         static void Warn(FunctionString<const char *> formatString, Args &&... args) {
-            if (LogLevel::Warn <= configLevel)
-                Write(LogLevel::Warn, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Warn <= MaxLevel)
+                if (LogLevel::Warn <= configLevel)
+                    Write(LogLevel::Warn, util::Format(*formatString, args...));
         }
 
         template<typename... Args>
         static void Warn(FunctionString<std::string> formatString, Args &&... args) {
-            if (LogLevel::Warn <= configLevel)
-                Write(LogLevel::Warn, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Warn <= MaxLevel)
+                if (LogLevel::Warn <= configLevel)
+                    Write(LogLevel::Warn, util::Format(*formatString, args...));
         }
 
         template<typename S, typename... Args>
         static void WarnNoPrefix(S formatString, Args &&... args) {
-            if (LogLevel::Warn <= configLevel)
-                Write(LogLevel::Warn, util::Format(formatString, args...));
+            if constexpr (LogLevel::Warn <= MaxLevel)
+                if (LogLevel::Warn <= configLevel)
+                    Write(LogLevel::Warn, util::Format(formatString, args...));
         }
 
         template<typename... Args>
         static void Info(FunctionString<const char *> formatString, Args &&... args) {
-            if (LogLevel::Info <= configLevel)
-                Write(LogLevel::Info, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Info <= MaxLevel)
+                if (LogLevel::Info <= configLevel)
+                    Write(LogLevel::Info, util::Format(*formatString, args...));
         }
 
         template<typename... Args>
         static void Info(FunctionString<std::string> formatString, Args &&... args) {
-            if (LogLevel::Info <= configLevel)
-                Write(LogLevel::Info, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Info <= MaxLevel)
+                if (LogLevel::Info <= configLevel)
+                    Write(LogLevel::Info, util::Format(*formatString, args...));
         }
 
         template<typename S, typename... Args>
         static void InfoNoPrefix(S formatString, Args &&... args) {
-            if (LogLevel::Info <= configLevel)
-                Write(LogLevel::Info, util::Format(formatString, args...));
+            if constexpr (LogLevel::Info <= MaxLevel)
+                if (LogLevel::Info <= configLevel)
+                    Write(LogLevel::Info, util::Format(formatString, args...));
         }
 
         template<typename... Args>
         static void Debug(FunctionString<const char *> formatString, Args &&... args) {
-            if (LogLevel::Debug <= configLevel)
-                Write(LogLevel::Debug, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Debug <= MaxLevel)
+                if (LogLevel::Debug <= configLevel)
+                    Write(LogLevel::Debug, util::Format(*formatString, args...));
         }
 
         template<typename... Args>
         static void Debug(FunctionString<std::string> formatString, Args &&... args) {
-            if (LogLevel::Debug <= configLevel)
-                Write(LogLevel::Debug, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Debug <= MaxLevel)
+                if (LogLevel::Debug <= configLevel)
+                    Write(LogLevel::Debug, util::Format(*formatString, args...));
         }
 
         template<typename S, typename... Args>
         static void DebugNoPrefix(S formatString, Args &&... args) {
-            if (LogLevel::Debug <= configLevel)
-                Write(LogLevel::Debug, util::Format(formatString, args...));
+            if constexpr (LogLevel::Debug <= MaxLevel)
+                if (LogLevel::Debug <= configLevel)
+                    Write(LogLevel::Debug, util::Format(formatString, args...));
         }
 
         template<typename... Args>
         static void Verbose(FunctionString<const char *> formatString, Args &&... args) {
-            if (LogLevel::Verbose <= configLevel)
-                Write(LogLevel::Verbose, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Verbose <= MaxLevel)
+                if (LogLevel::Verbose <= configLevel)
+                    Write(LogLevel::Verbose, util::Format(*formatString, args...));
         }
 
         template<typename... Args>
         static void Verbose(FunctionString<std::string> formatString, Args &&... args) {
-            if (LogLevel::Verbose <= configLevel)
-                Write(LogLevel::Verbose, util::Format(*formatString, args...));
+            if constexpr (LogLevel::Verbose <= MaxLevel)
+                if (LogLevel::Verbose <= configLevel)
+                    Write(LogLevel::Verbose, util::Format(*formatString, args...));
         }
 
         template<typename S, typename... Args>
         static void VerboseNoPrefix(S formatString, Args &&... args) {
-            if (LogLevel::Verbose <= configLevel)
-                Write(LogLevel::Verbose, util::Format(formatString, args...));
+            if constexpr (LogLevel::Verbose <= MaxLevel)
+                if (LogLevel::Verbose <= configLevel)
+                    Write(LogLevel::Verbose, util::Format(formatString, args...));
         }
     };
 }
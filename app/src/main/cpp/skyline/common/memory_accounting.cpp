@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "trace.h"
+#include "memory_accounting.h"
+
+namespace skyline {
+    /**
+     * @brief The names of the counter tracks for every category, these are treated as static strings by Perfetto
+     */
+    constexpr std::array<const char *, static_cast<size_t>(MemoryAccounting::Category::Count)> CategoryNames{
+        "Guest Memory",
+        "Shared Memory",
+        "Texture Memory",
+        "Buffer Memory",
+        "Staging Memory",
+        "Sector Cache Memory",
+    };
+
+    void MemoryAccounting::Update(Category category, i64 delta) {
+        auto index{static_cast<size_t>(category)};
+        auto value{usage[index].fetch_add(delta, std::memory_order_relaxed) + delta};
+        TRACE_COUNTER("memory", perfetto::CounterTrack(CategoryNames[index]), value);
+    }
+
+    std::string MemoryAccounting::GetSummary() {
+        std::string summary;
+        for (size_t index{}; index < CategoryNames.size(); index++) {
+            auto value{usage[index].load(std::memory_order_relaxed)};
+            if (value)
+                summary += fmt::format("{}{}: {:.1f} MiB", summary.empty() ? "" : "\n", CategoryNames[index], static_cast<double>(value) / (1024 * 1024));
+        }
+        return summary;
+    }
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline {
+    /**
+     * @brief Process-wide accounting of host memory by the subsystem that it was allocated for, the totals are exported as Perfetto counter tracks and can be queried for a summary
+     * @note This only covers the allocations which are explicitly reported to it, it attributes the bulk of memory usage rather than accounting for every allocation
+     */
+    class MemoryAccounting {
+      public:
+        enum class Category : u8 {
+            GuestMemory, //!< Private memory mapped into the guest address space, this is the mapped size rather than the resident size as pages are only backed once they're touched
+            SharedMemory, //!< Shared memory objects which are created by the kernel, this excludes transfer memory as it's backed by guest memory
+            Textures, //!< Images allocated by the GPU memory manager
+            Buffers, //!< Buffers allocated by the GPU memory manager
+            StagingBuffers, //!< Staging buffers allocated by the GPU memory manager, the staging ring is accounted in its entirety rather than by its suballocations
+            SectorCache, //!< Decrypted NCA pages cached by the VFS
+            Count,
+        };
+
+      private:
+        static inline std::array<std::atomic<i64>, static_cast<size_t>(Category::Count)> usage{}; //!< The current usage of every category in bytes
+
+      public:
+        /**
+         * @brief Adjusts the usage of a category by the supplied amount of bytes and emits the updated value to its counter track
+         */
+        static void Update(Category category, i64 delta);
+
+        /**
+         * @return The current usage of a category in bytes
+         */
+        static i64 GetUsage(Category category) {
+            return usage[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return A human-readable summary of the usage of every category
+         */
+        static std::string GetSummary();
+    };
+}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <common/trace.h>
+#include <common.h>
+
+namespace skyline {
+    /**
+     * @brief A bounded lock-free multi-producer multi-consumer queue, every slot carries a sequence number which determines if it's ready to be written or read so producers and consumers only contend on their respective positions
+     * @note Consumers only sleep on a futex when the queue is empty and producers only sleep when it's full, neither side takes any locks otherwise
+     * @note Type must be default constructible and assignable as slots are constructed upfront and items are assigned into them
+     * @url https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+     */
+    template<typename Type>
+    class MpmcQueue {
+      private:
+        static constexpr size_t CacheLineSize{64}; //!< The positions are on separate cache lines to avoid false sharing between producers and consumers
+
+        struct Slot {
+            std::atomic<u64> sequence; //!< The position this slot can be written at if it's equal to it or the position + 1 if it can be read at it
+            Type item;
+        };
+
+        size_t capacity; //!< The maximum amount of items in the queue
+        std::unique_ptr<Slot[]> slots;
+        alignas(CacheLineSize) std::atomic<u64> enqueuePosition{};
+        alignas(CacheLineSize) std::atomic<u64> dequeuePosition{};
+        alignas(CacheLineSize) std::atomic<u32> itemEpoch{}; //!< A futex word which is incremented when an item is pushed while any consumers are waiting
+        std::atomic<u32> consumersWaiting{};
+        alignas(CacheLineSize) std::atomic<u32> slotEpoch{}; //!< A futex word which is incremented when a slot is freed while any producers are waiting
+        std::atomic<u32> producersWaiting{};
+
+        Slot &GetSlot(u64 position) {
+            return slots[position % capacity];
+        }
+
+        /**
+         * @brief Sleeps on a futex epoch till it's incremented by the other side, the supplied predicate is rechecked after registering as a waiter to avoid missing a wake
+         */
+        template<typename Predicate>
+        static void Wait(std::atomic<u32> &epoch, std::atomic<u32> &waiting, Predicate shouldWait) {
+            waiting.fetch_add(1);
+            auto value{epoch.load()};
+            if (shouldWait())
+                syscall(SYS_futex, &epoch, FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Wakes all sleepers on the supplied futex epoch, this is a fence and a single atomic load if there are none
+         */
+        static void Wake(std::atomic<u32> &epoch, std::atomic<u32> &waiting) {
+            std::atomic_thread_fence(std::memory_order_seq_cst); // The prior publication of a slot must be ordered before checking for waiters to not miss one going to sleep
+            if (waiting.load(std::memory_order_relaxed)) {
+                epoch.fetch_add(1);
+                syscall(SYS_futex, &epoch, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+            }
+        }
+
+        bool IsFull() {
+            auto position{enqueuePosition.load()};
+            return static_cast<i64>(GetSlot(position).sequence.load() - position) < 0;
+        }
+
+        bool IsEmpty() {
+            auto position{dequeuePosition.load()};
+            return static_cast<i64>(GetSlot(position).sequence.load() - (position + 1)) < 0;
+        }
+
+      public:
+        MpmcQueue(size_t size) : capacity(size), slots(std::make_unique<Slot[]>(size)) {
+            for (size_t index{}; index < capacity; index++)
+                slots[index].sequence.store(index, std::memory_order_relaxed);
+        }
+
+        MpmcQueue(const MpmcQueue &) = delete;
+
+        MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+        /**
+         * @brief Pushes an item into the queue if there's a free slot without blocking or waking any consumers
+         * @return If the item was pushed
+         */
+        bool TryPush(const Type &item) {
+            auto position{enqueuePosition.load(std::memory_order_relaxed)};
+            while (true) {
+                auto &slot{GetSlot(position)};
+                auto difference{static_cast<i64>(slot.sequence.load(std::memory_order_acquire) - position)};
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.item = item;
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; // The slot hasn't been consumed since the last time around the queue, the queue is full
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed); // Another producer claimed this position before us
+                }
+            }
+        }
+
+        /**
+         * @brief Pops an item from the queue if there's one without blocking or waking any producers
+         * @return If an item was popped into the supplied reference
+         */
+        bool TryPop(Type &item) {
+            auto position{dequeuePosition.load(std::memory_order_relaxed)};
+            while (true) {
+                auto &slot{GetSlot(position)};
+                auto difference{static_cast<i64>(slot.sequence.load(std::memory_order_acquire) - (position + 1))};
+                if (difference == 0) {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        item = std::move(slot.item);
+                        slot.sequence.store(position + capacity, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; // The slot hasn't been written to yet, the queue is empty
+                } else {
+                    position = dequeuePosition.load(std::memory_order_relaxed); // Another consumer claimed this position before us
+                }
+            }
+        }
+
+        /**
+         * @brief A blocking for-each that runs on every item and waits till new items to run on them as well
+         * @param function A function that is called for each item (with the only parameter as a reference to that item)
+         * @note This can be called from multiple threads at once, every item is only supplied to one of them
+         */
+        template<typename F>
+        [[noreturn]] void Process(F function) {
+            TRACE_EVENT_BEGIN("containers", "MpmcQueue::Process");
+
+            Type item;
+            while (true) {
+                if (!TryPop(item)) {
+                    TRACE_EVENT_END("containers");
+                    Wait(itemEpoch, consumersWaiting, [this] { return IsEmpty(); });
+                    TRACE_EVENT_BEGIN("containers", "MpmcQueue::Process");
+                    continue;
+                }
+
+                Wake(slotEpoch, producersWaiting);
+                function(item);
+            }
+        }
+
+        void Push(const Type &item) {
+            while (!TryPush(item)) [[unlikely]]
+                Wait(slotEpoch, producersWaiting, [this] { return IsFull(); });
+            Wake(itemEpoch, consumersWaiting);
+        }
+
+        /**
+         * @brief Pushes all items in the buffer, consumers are only woken once all of them have been pushed unless the queue fills up
+         */
+        void Append(span<Type> buffer) {
+            for (const auto &item : buffer) {
+                while (!TryPush(item)) [[unlikely]] {
+                    Wake(itemEpoch, consumersWaiting); // Consumers must see the items pushed so far to free up space
+                    Wait(slotEpoch, producersWaiting, [this] { return IsFull(); });
+                }
+            }
+            Wake(itemEpoch, consumersWaiting);
+        }
+    };
+}
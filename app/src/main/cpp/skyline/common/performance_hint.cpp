@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <dlfcn.h>
+#include "performance_hint.h"
+
+namespace skyline {
+    namespace {
+        /**
+         * @brief The functions of the performance hint API, these are resolved on first use as the API isn't available at our minimum API level
+         */
+        struct PerformanceHintApi {
+            void *manager{}; //!< The APerformanceHintManager, this is nullptr if the API is unsupported
+            void *(*createSession)(void *, const i32 *, size_t, i64){};
+            int (*updateTargetWorkDuration)(void *, i64){};
+            int (*reportActualWorkDuration)(void *, i64){};
+            void (*closeSession)(void *){};
+            int (*setThreads)(void *, const i32 *, size_t){}; //!< This was introduced in Android 14, sessions are recreated when their threads change on prior versions
+
+            PerformanceHintApi() {
+                auto getManager{reinterpret_cast<void *(*)()>(dlsym(RTLD_DEFAULT, "APerformanceHint_getManager"))};
+                createSession = reinterpret_cast<decltype(createSession)>(dlsym(RTLD_DEFAULT, "APerformanceHint_createSession"));
+                updateTargetWorkDuration = reinterpret_cast<decltype(updateTargetWorkDuration)>(dlsym(RTLD_DEFAULT, "APerformanceHint_updateTargetWorkDuration"));
+                reportActualWorkDuration = reinterpret_cast<decltype(reportActualWorkDuration)>(dlsym(RTLD_DEFAULT, "APerformanceHint_reportActualWorkDuration"));
+                closeSession = reinterpret_cast<decltype(closeSession)>(dlsym(RTLD_DEFAULT, "APerformanceHint_closeSession"));
+                setThreads = reinterpret_cast<decltype(setThreads)>(dlsym(RTLD_DEFAULT, "APerformanceHint_setThreads"));
+                if (getManager && createSession && updateTargetWorkDuration && reportActualWorkDuration && closeSession)
+                    manager = getManager();
+            }
+        };
+
+        const PerformanceHintApi &GetApi() {
+            static const PerformanceHintApi api;
+            return api;
+        }
+    }
+
+    void PerformanceHint::RegisterCurrentThread() {
+        if (!GetApi().manager)
+            return;
+
+        std::scoped_lock lock(mutex);
+        threads.push_back(gettid());
+        threadsChanged = true;
+    }
+
+    void PerformanceHint::UnregisterCurrentThread() {
+        const auto &api{GetApi()};
+        if (!api.manager)
+            return;
+
+        std::scoped_lock lock(mutex);
+        auto it{std::find(threads.begin(), threads.end(), gettid())};
+        if (it == threads.end())
+            return;
+
+        threads.erase(it);
+        threadsChanged = true;
+        if (threads.empty() && session) {
+            // A session can't be left referencing threads which have exited as they may be replaced by unrelated threads with the same TID
+            api.closeSession(session);
+            session = nullptr;
+            threadsChanged = false;
+        }
+    }
+
+    void PerformanceHint::ReportFrame(i64 target, i64 actual) {
+        const auto &api{GetApi()};
+        if (!api.manager || target <= 0 || actual <= 0)
+            return;
+
+        if (boost.load(std::memory_order_relaxed))
+            target /= BoostTargetDivisor;
+
+        std::scoped_lock lock(mutex);
+        if (threadsChanged) {
+            threadsChanged = false;
+            if (session && (threads.empty() || !api.setThreads || api.setThreads(session, threads.data(), threads.size()))) {
+                api.closeSession(session);
+                session = nullptr;
+            }
+            if (!session && !threads.empty()) {
+                session = api.createSession(api.manager, threads.data(), threads.size(), target);
+                targetDuration = target;
+                if (!session)
+                    Logger::Warn("Failed to create a performance hint session for {} threads", threads.size());
+            }
+        }
+
+        if (!session)
+            return;
+
+        if (target != targetDuration) {
+            api.updateTargetWorkDuration(session, target);
+            targetDuration = target;
+        }
+        api.reportActualWorkDuration(session, actual);
+    }
+}
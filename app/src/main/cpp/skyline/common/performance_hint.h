@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline {
+    /**
+     * @brief Reports the work duration of every frame to the host through an Android Performance Hint session covering the threads which determine the frame rate, this lets the host raise clocks when emulation needs it rather than reacting to bursty load
+     * @note The performance hint API was introduced in Android 13 which is above our minimum API level, it's resolved at runtime and this is inert on prior versions
+     */
+    class PerformanceHint {
+      private:
+        static inline std::mutex mutex; //!< Synchronizes access to the registered threads and the session
+        static inline std::vector<pid_t> threads; //!< The TIDs of all threads which are registered for the session
+        static inline bool threadsChanged{}; //!< If the registered threads have changed since the session was last updated
+        static inline void *session{}; //!< The APerformanceHintSession for the registered threads, this is nullptr if there are none or the API is unsupported
+        static inline i64 targetDuration{}; //!< The target work duration that the session was last updated with in nanoseconds
+        static inline std::atomic<bool> boost{}; //!< If the guest has requested boosted clocks, the target duration is shortened while this is set
+        static constexpr i64 BoostTargetDivisor{2}; //!< The factor by which the target duration is shortened while boosted, this has the host raise clocks beyond what the frame rate alone requires
+
+      public:
+        /**
+         * @brief Adds the calling thread to the session, it's applied on the next reported frame
+         * @note UnregisterCurrentThread must be called prior to the thread exiting
+         */
+        static void RegisterCurrentThread();
+
+        /**
+         * @brief Removes the calling thread from the session, the session is closed once no threads remain
+         */
+        static void UnregisterCurrentThread();
+
+        /**
+         * @brief Sets if the guest has requested boosted clocks, this is the case for the CPU boost mode that games use during loading screens
+         */
+        static void SetBoost(bool enable) {
+            boost.store(enable, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Reports the duration of a frame to the session, the session is created or updated with the registered threads if they have changed prior to this
+         * @param target The duration that a frame should take in nanoseconds, this is the display refresh duration multiplied by the swap interval
+         * @param actual The duration that the frame took in nanoseconds
+         */
+        static void ReportFrame(i64 target, i64 actual);
+    };
+}
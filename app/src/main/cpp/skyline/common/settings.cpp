@@ -17,10 +17,24 @@ namespace skyline {
 
         std::tuple preferences{
             PREF_ELEM("log_level", logLevel, static_cast<Logger::LogLevel>(element.text().as_uint(static_cast<unsigned int>(Logger::LogLevel::Info)))),
+            PREF_ELEM("guest_logging", guestLogging, element.attribute("value").as_bool(true)),
             PREF_ELEM("username_value", username, element.text().as_string()),
             PREF_ELEM("operation_mode", operationMode, element.attribute("value").as_bool()),
             PREF_ELEM("force_triple_buffering", forceTripleBuffering, element.attribute("value").as_bool()),
-            PREF_ELEM("disable_frame_throttling", disableFrameThrottling, element.attribute("value").as_bool()),
+            PREF_ELEM("present_mode", presentMode, element.attribute("value").as_uint(2)), // Defaults to VK_PRESENT_MODE_FIFO_KHR
+            PREF_ELEM("render_scale", renderScale, static_cast<float>(element.attribute("value").as_uint(100)) / 100.0f),
+            PREF_ELEM("zero_copy_presentation", zeroCopyPresentation, element.attribute("value").as_bool()),
+            PREF_ELEM("thermal_governor", thermalGovernor, element.attribute("value").as_bool()),
+            PREF_ELEM("auto_tune", autoTune, element.attribute("value").as_bool()),
+            PREF_ELEM("work_stealing", workStealing, element.attribute("value").as_bool()),
+            PREF_ELEM("thread_handoff_spinning", threadHandoffSpinning, element.attribute("value").as_bool()),
+            PREF_ELEM("host_thread_affinity", hostThreadAffinity, element.attribute("value").as_bool()),
+            PREF_ELEM("prefault_heap", prefaultHeap, element.attribute("value").as_bool()),
+            PREF_ELEM("capture_gpfifo", captureGpfifo, element.attribute("value").as_bool()),
+            PREF_ELEM("guest_profiling", guestProfiling, element.attribute("value").as_bool()),
+            PREF_ELEM("sector_cache_size", sectorCacheSize, element.attribute("value").as_uint(32)),
+            PREF_ELEM("audio_exclusive_mode", audioExclusiveMode, element.attribute("value").as_bool()),
+            PREF_ELEM("audio_buffer_bursts", audioBufferBursts, std::max(element.attribute("value").as_uint(2), 1U)),
         };
 
         #undef PREF_ELEM
@@ -12,10 +12,24 @@ namespace skyline {
     class Settings {
       public:
         Logger::LogLevel logLevel; //!< The minimum level that logs need to be for them to be printed
+        bool guestLogging; //!< If messages logged by the guest through lm should be written to the log
         std::string username; //!< The name set by the user to be supplied to the guest
         bool operationMode; //!< If the emulated Switch should be handheld or docked
         bool forceTripleBuffering; //!< If the presentation engine should always triple buffer even if the swapchain supports double buffering
-        bool disableFrameThrottling; //!< Allow the guest to submit frames without any blocking calls
+        u32 presentMode; //!< The VkPresentModeKHR which is preferred for presentation, mailbox and immediate modes allow the guest to submit frames without being throttled to the display
+        float renderScale; //!< The factor by which the resolution of render targets is scaled relative to the guest resolution
+        bool zeroCopyPresentation; //!< If frames should be handed to the compositor directly from AHardwareBuffer-backed textures rather than being copied into swapchain images
+        bool thermalGovernor; //!< If the present rate should be lowered as the host approaches thermal throttling
+        bool autoTune; //!< If the tunable performance settings should be selected for every title from the frame times recorded in prior sessions of it
+        bool workStealing; //!< If idle cores should pull ready threads off busy cores
+        bool threadHandoffSpinning; //!< If guest threads waiting to be scheduled should busy-wait briefly before sleeping on the host
+        bool hostThreadAffinity; //!< If emulation threads should be pinned to performance cores and background threads to efficiency cores on big.LITTLE hosts
+        bool prefaultHeap; //!< If heap memory should be pre-faulted when it's allocated by the guest
+        bool captureGpfifo; //!< If all GpEntries and their pushbuffers should be recorded to a file for offline replay
+        bool guestProfiling; //!< If guest threads should be sampled periodically to write a profile of the guest functions they spend their time in
+        u32 sectorCacheSize; //!< The size of the cache of decrypted NCA sections in MiB, caching is disabled if this is 0
+        bool audioExclusiveMode; //!< If exclusive access to the audio device should be requested, this allows for lower latency with an MMAP stream on supported devices
+        u32 audioBufferBursts; //!< The initial size of the audio buffer in bursts, the buffer is grown past this if underruns occur
 
         /**
          * @param fd An FD to the preference XML file
@@ -5,6 +5,7 @@
 #include <dlfcn.h>
 #include <unwind.h>
 #include <fcntl.h>
+#include "flight_recorder.h"
 #include "signal.h"
 
 namespace skyline::signal {
@@ -31,6 +32,10 @@ namespace skyline::signal {
     }
 
     void TerminateHandler() {
+        Logger::Flush(); // Any queued logs would otherwise be lost if we end up terminating
+        if (!trace::FlightRecorder::CrashDumpPath.empty())
+            trace::FlightRecorder::Dump(trace::FlightRecorder::CrashDumpPath);
+
         auto exception{std::current_exception()};
         if (terminateHandler && exception && exception == SignalExceptionPtr) {
             StackFrame *frame;
@@ -126,6 +131,12 @@ namespace skyline::signal {
         TlsRestorer = function;
     }
 
+    static AccessViolationHandler AccessViolationHandlerFunction{};
+
+    void SetAccessViolationHandler(AccessViolationHandler function) {
+        AccessViolationHandlerFunction = function;
+    }
+
     struct DefaultSignalHandler {
         void (*function)(int, struct siginfo *, void *){};
 
@@ -158,7 +169,9 @@ namespace skyline::signal {
             tls = TlsRestorer();
 
         auto handler{ThreadSignalHandlers.at(static_cast<size_t>(signal))};
-        if (handler) {
+        if (signal == SIGSEGV && AccessViolationHandlerFunction && AccessViolationHandlerFunction(info->si_addr)) {
+            // The fault was resolved, returning from the signal handler will retry the faulting access
+        } else if (handler) {
             handler(signal, info, context, &tls);
         } else {
             auto defaultHandler{DefaultSignalHandlers.at(static_cast<size_t>(signal)).function};
@@ -75,6 +75,15 @@ namespace skyline::signal {
      */
     void SetTlsRestorer(void *(*function)());
 
+    /**
+     * @brief A function which is called on any SIGSEGV prior to the thread's signal handler, this allows faults caused by protections that the host intentionally applied to memory to be resolved
+     * @return If the fault was resolved and the faulting access should be retried, if not the thread's signal handler is called as usual
+     * @note This runs in signal context on the faulting thread, it must not do anything that the faulting thread could be in the middle of
+     */
+    using AccessViolationHandler = bool (*)(void *fault);
+
+    void SetAccessViolationHandler(AccessViolationHandler function);
+
     using SignalHandler = void (*)(int, struct siginfo *, ucontext *, void **);
 
     /**
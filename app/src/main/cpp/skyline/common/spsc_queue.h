@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <common/trace.h>
+#include <common.h>
+
+namespace skyline {
+    /**
+     * @brief A lock-free single-producer single-consumer queue, the consumer only sleeps on a futex when the queue is empty and the producer only sleeps when it's full so neither side needs to take any locks in the common case
+     * @note All producers must be externally synchronized with each other, there can only be a single consumer
+     */
+    template<typename Type>
+    class SpscQueue {
+      private:
+        static constexpr size_t CacheLineSize{64}; //!< The head and tail are on separate cache lines to avoid false sharing between the producer and consumer
+
+        std::vector<u8> vector; //!< The internal vector holding the queue's data, we use a byte vector due to the default item construction/destruction semantics not being appropriate for a ring buffer
+        size_t capacity; //!< The maximum amount of items in the queue
+        alignas(CacheLineSize) std::atomic<u64> head{}; //!< The total amount of items consumed, this is only written to by the consumer
+        alignas(CacheLineSize) std::atomic<u64> tail{}; //!< The total amount of items produced, this is only written to by the producer
+        std::atomic<u32> consumerWaiting{}; //!< A futex word which is set to 1 by the consumer prior to sleeping on it
+        std::atomic<u32> producerWaiting{}; //!< A futex word which is set to 1 by the producer prior to sleeping on it
+
+        Type *GetSlot(u64 index) {
+            return reinterpret_cast<Type *>(vector.data()) + (index % capacity);
+        }
+
+        /**
+         * @brief Sleeps on a futex word till it's cleared by the other side, the supplied predicate is rechecked after the word is set to avoid missing a wake
+         */
+        template<typename Predicate>
+        static void Wait(std::atomic<u32> &word, Predicate shouldWait) {
+            word.store(1);
+            if (shouldWait())
+                syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, 1, nullptr, nullptr, 0);
+            word.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Wakes the other side if it's sleeping on the supplied futex word, this is a single atomic load if it isn't
+         */
+        static void Wake(std::atomic<u32> &word) {
+            if (word.load() && word.exchange(0))
+                syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+
+        /**
+         * @brief Waits for a free slot and writes an item into it without publishing it to the consumer
+         */
+        void Write(u64 index, const Type &item) {
+            while (index - head.load(std::memory_order_acquire) == capacity) [[unlikely]]
+                Wait(producerWaiting, [&] { return index - head.load() == capacity; });
+            *GetSlot(index) = item;
+        }
+
+        void Publish(u64 newTail) {
+            tail.store(newTail); // This must be sequentially consistent with the load of the futex word in Wake to not miss a consumer going to sleep
+            Wake(consumerWaiting);
+        }
+
+      public:
+        SpscQueue(size_t size) : vector(size * sizeof(Type)), capacity(size) {}
+
+        SpscQueue(const SpscQueue &) = delete;
+
+        SpscQueue &operator=(const SpscQueue &) = delete;
+
+        /**
+         * @brief A blocking for-each that runs on every item and waits till new items to run on them as well
+         * @param function A function that is called for each item (with the only parameter as a reference to that item)
+         */
+        template<typename F>
+        [[noreturn]] void Process(F function) {
+            TRACE_EVENT_BEGIN("containers", "SpscQueue::Process");
+
+            u64 index{head.load(std::memory_order_relaxed)};
+            while (true) {
+                u64 end{tail.load(std::memory_order_acquire)};
+                if (index == end) {
+                    TRACE_EVENT_END("containers");
+                    Wait(consumerWaiting, [&] { return tail.load() == index; });
+                    TRACE_EVENT_BEGIN("containers", "SpscQueue::Process");
+                    continue;
+                }
+
+                for (; index != end; index++) {
+                    function(*GetSlot(index));
+                    head.store(index + 1);
+                }
+
+                Wake(producerWaiting);
+            }
+        }
+
+        /**
+         * @return The amount of items which have been pushed but not yet consumed, this is only an approximation when called concurrently with the other side
+         */
+        size_t Size() {
+            return static_cast<size_t>(tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed));
+        }
+
+        void Push(const Type &item) {
+            u64 index{tail.load(std::memory_order_relaxed)};
+            Write(index, item);
+            Publish(index + 1);
+        }
+
+        /**
+         * @brief Pushes all items in the buffer, they're published to the consumer together unless the queue fills up
+         */
+        void Append(span<Type> buffer) {
+            u64 index{tail.load(std::memory_order_relaxed)};
+            for (const auto &item : buffer) {
+                if (index - head.load(std::memory_order_acquire) == capacity) [[unlikely]]
+                    Publish(index); // The consumer must see the items written so far to free up space
+                Write(index++, item);
+            }
+            Publish(index);
+        }
+    };
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <deque>
+#include "host_affinity.h"
+#include "thread_pool.h"
+
+namespace skyline {
+    struct ThreadPool::Worker {
+        size_t index;
+        bool performance; //!< If the worker is affine to performance cores rather than efficiency cores
+        cpu_set_t affinity; //!< The cores in the cluster of the worker's core, the worker can be migrated between these by the kernel
+        std::mutex mutex; //!< Synchronizes access to the queues
+        std::array<std::deque<Job>, PriorityCount> queues; //!< The jobs queued on this worker for every priority, the owner pops from the back while stealers pop from the front
+    };
+
+    thread_local static ThreadPool::Worker *currentWorker{}; //!< The worker of the calling thread, this is nullptr for threads outside the pool
+
+    ThreadPool::ThreadPool() {
+        const auto &topology{HostAffinity::GetTopology()};
+        workers.reserve(topology.coreCount);
+        for (size_t core{}; core < topology.coreCount; core++) {
+            auto &worker{*workers.emplace_back(std::make_unique<Worker>())};
+            worker.index = core;
+            worker.performance = !CPU_ISSET(core, &topology.efficiencyCores);
+            worker.affinity = worker.performance ? topology.performanceCores : topology.efficiencyCores;
+            hasEfficiencyWorkers |= !worker.performance;
+        }
+
+        for (auto &worker : workers)
+            std::thread(&ThreadPool::Run, this, std::ref(*worker)).detach();
+    }
+
+    ThreadPool &ThreadPool::Get() {
+        static auto *pool{new ThreadPool()};
+        return *pool;
+    }
+
+    bool ThreadPool::CanRun(const Worker &worker, Priority priority) const {
+        if (priority == Priority::High)
+            return worker.performance;
+        else if (priority == Priority::Background)
+            return !worker.performance || !hasEfficiencyWorkers;
+        return true;
+    }
+
+    bool ThreadPool::FindJob(Worker &worker, Job &job) {
+        for (size_t priorityIndex{}; priorityIndex < PriorityCount; priorityIndex++) {
+            auto priority{static_cast<Priority>(priorityIndex)};
+            if (!CanRun(worker, priority) || !pendingJobs[priorityIndex].load(std::memory_order_acquire))
+                continue;
+
+            {
+                std::scoped_lock lock(worker.mutex);
+                auto &queue{worker.queues[priorityIndex]};
+                if (!queue.empty()) {
+                    job = std::move(queue.back());
+                    queue.pop_back();
+                    pendingJobs[priorityIndex].fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            // Stealing starts from the next worker to spread out contention between stealers
+            for (size_t offset{1}; offset < workers.size(); offset++) {
+                auto &victim{*workers[(worker.index + offset) % workers.size()]};
+                std::scoped_lock lock(victim.mutex);
+                auto &queue{victim.queues[priorityIndex]};
+                if (!queue.empty()) {
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                    pendingJobs[priorityIndex].fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void ThreadPool::Run(Worker &worker) {
+        pthread_setname_np(pthread_self(), fmt::format("Worker{}", worker.index).c_str());
+        if (sched_setaffinity(0, sizeof(cpu_set_t), &worker.affinity))
+            Logger::Warn("Failed to set the affinity of pool worker {}: {}", worker.index, strerror(errno));
+        currentWorker = &worker;
+
+        auto hasRunnableJob{[&]() {
+            for (size_t priorityIndex{}; priorityIndex < PriorityCount; priorityIndex++)
+                if (CanRun(worker, static_cast<Priority>(priorityIndex)) && pendingJobs[priorityIndex].load())
+                    return true;
+            return false;
+        }};
+
+        Job job;
+        while (true) {
+            if (FindJob(worker, job)) {
+                try {
+                    job();
+                } catch (const std::exception &e) {
+                    Logger::Error("Uncaught exception in pool job: {}", e.what());
+                }
+                job = nullptr; // Any state captured by the job is destroyed prior to sleeping
+                continue;
+            }
+
+            std::unique_lock lock(sleepMutex);
+            sleepingWorkers.fetch_add(1);
+            sleepCondition.wait(lock, hasRunnableJob);
+            sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void ThreadPool::Submit(Job &&job, Priority priority) {
+        auto priorityIndex{static_cast<size_t>(priority)};
+
+        Worker *target{currentWorker};
+        if (!target || !CanRun(*target, priority)) {
+            // Jobs from outside the pool are distributed round-robin across workers which can run them, this avoids stealers contending on a single queue
+            do
+                target = workers[nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()].get();
+            while (!CanRun(*target, priority));
+        }
+
+        // The job is counted prior to being queued so the count never drops below zero when it's stolen immediately, this must be sequentially consistent with the increment of the sleeping workers to not miss a worker going to sleep
+        pendingJobs[priorityIndex].fetch_add(1);
+        {
+            std::scoped_lock lock(target->mutex);
+            target->queues[priorityIndex].emplace_back(std::move(job));
+        }
+
+        if (sleepingWorkers.load()) {
+            std::scoped_lock lock(sleepMutex);
+            sleepCondition.notify_all();
+        }
+    }
+}
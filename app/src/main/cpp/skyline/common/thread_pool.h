@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <common.h>
+
+namespace skyline {
+    /**
+     * @brief A work-stealing pool of host worker threads which is shared by every subsystem that has parallelizable work, this avoids each of them spawning their own threads and oversubscribing the host's cores
+     * @note There's one worker per host core, workers are affine to the cluster of their core so latency-sensitive jobs stay on performance cores and background jobs stay off them on big.LITTLE SoCs
+     * @note Jobs must not block on anything other than other jobs in the pool, threads which block on guest or host events for extended durations should remain dedicated threads
+     */
+    class ThreadPool {
+      public:
+        enum class Priority : u8 {
+            High, //!< Latency-sensitive work that's on the critical path of a frame or an audio buffer, this only runs on performance cores
+            Normal, //!< Work that a thread is waiting on to make progress, such as parallel copies, decryption or decompression
+            Background, //!< Work that nothing is waiting on, this runs on efficiency cores if the host has any
+        };
+
+        using Job = std::function<void()>;
+
+        struct Worker; //!< A worker thread alongside its queue of jobs, this is opaque outside the implementation
+
+      private:
+        static constexpr size_t PriorityCount{3};
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        bool hasEfficiencyWorkers{}; //!< If any workers are affine to efficiency cores, background jobs are exclusive to them if so
+        std::atomic<size_t> nextWorker{}; //!< A counter used to distribute jobs submitted from outside the pool across workers
+        std::array<std::atomic<size_t>, PriorityCount> pendingJobs{}; //!< The amount of jobs of each priority which haven't been picked up by a worker yet
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition; //!< Signalled when a job is submitted while any workers are sleeping
+        std::atomic<u32> sleepingWorkers{};
+
+        ThreadPool();
+
+        /**
+         * @return If the supplied worker is allowed to run jobs of the supplied priority
+         */
+        bool CanRun(const Worker &worker, Priority priority) const;
+
+        /**
+         * @brief Pops a job which the supplied worker can run from its own queue or steals one from another worker's queue, higher priority jobs are always picked first
+         * @return If a job was found
+         */
+        bool FindJob(Worker &worker, Job &job);
+
+        [[noreturn]] void Run(Worker &worker);
+
+        /**
+         * @brief The state of a ParallelFor which is shared with any workers helping with it, workers may outlive the call and only access the function for indices they've claimed
+         */
+        struct ParallelState {
+            size_t count;
+            std::atomic<size_t> nextIndex{}; //!< The next index to be claimed
+            std::mutex mutex;
+            std::condition_variable condition; //!< Signalled when the last index has been completed
+            size_t completed{};
+            std::exception_ptr exception; //!< The first exception thrown by the function, this is rethrown on the calling thread
+
+            ParallelState(size_t count) : count(count) {}
+        };
+
+      public:
+        /**
+         * @return The process-wide thread pool, it's created on first use and is intentionally leaked as workers never exit
+         */
+        static ThreadPool &Get();
+
+        size_t GetWorkerCount() const {
+            return workers.size();
+        }
+
+        /**
+         * @brief Queues a job to be run asynchronously on a worker, jobs submitted from a worker are queued on that worker to be run or stolen in LIFO order
+         */
+        void Submit(Job &&job, Priority priority = Priority::Normal);
+
+        /**
+         * @brief Calls the supplied function with every index in [0, count) concurrently across the calling thread and the workers, returning once all calls have completed
+         * @param function A function which is called with a single index at a time, indices are claimed dynamically so uneven workloads are balanced across threads
+         * @note The calling thread always processes indices itself so this never depends on a worker being available, it's safe to call from a job
+         * @note If any call throws, the first exception is rethrown on the calling thread after all claimed indices have completed
+         */
+        template<typename Function>
+        void ParallelFor(size_t count, Function function, Priority priority = Priority::Normal) {
+            if (count <= 1) {
+                if (count)
+                    function(size_t{});
+                return;
+            }
+
+            auto parallelState{std::make_shared<ParallelState>(count)};
+            auto process{[parallelState, &function]() {
+                size_t index;
+                while ((index = parallelState->nextIndex.fetch_add(1, std::memory_order_relaxed)) < parallelState->count) {
+                    std::exception_ptr exception;
+                    try {
+                        function(index);
+                    } catch (...) {
+                        exception = std::current_exception();
+                    }
+
+                    std::scoped_lock lock(parallelState->mutex);
+                    if (exception && !parallelState->exception)
+                        parallelState->exception = exception;
+                    if (++parallelState->completed == parallelState->count)
+                        parallelState->condition.notify_all();
+                }
+            }};
+
+            for (size_t helper{}; helper < std::min(workers.size(), count - 1); helper++)
+                Submit(Job{process}, priority);
+            process();
+
+            std::unique_lock lock(parallelState->mutex);
+            parallelState->condition.wait(lock, [&]() { return parallelState->completed == parallelState->count; });
+            if (parallelState->exception)
+                std::rethrow_exception(parallelState->exception);
+        }
+    };
+}
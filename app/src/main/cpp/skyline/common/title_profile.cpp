@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <numeric>
+#include <vfs/os_filesystem.h>
+#include "title_profile.h"
+
+namespace skyline {
+    TitleProfile::Configuration TitleProfile::GetConfiguration(const Settings &settings) {
+        Configuration configuration{};
+        for (size_t index{}; index < TunableSettings.size(); index++)
+            if (settings.*TunableSettings[index].first)
+                configuration |= 1 << index;
+        return configuration;
+    }
+
+    std::string TitleProfile::GetConfigurationName(Configuration configuration) {
+        std::string name;
+        for (size_t index{}; index < TunableSettings.size(); index++) {
+            if (configuration & (1 << index)) {
+                if (!name.empty())
+                    name += ", ";
+                name += TunableSettings[index].second;
+            }
+        }
+        return name.empty() ? std::string("No Tunables") : name;
+    }
+
+    float TitleProfile::GetPercentile(const gpu::FrameStatistics::SessionHistogram &histogram, u64 frames, u64 percent) {
+        u64 target{((frames - 1) * percent) / 100}, count{};
+        for (size_t index{}; index < histogram.size(); index++) {
+            count += histogram[index];
+            if (count > target)
+                return static_cast<float>(static_cast<i64>(index + 1) * gpu::FrameStatistics::SessionBucketDuration) / constant::NsInMillisecond;
+        }
+        return static_cast<float>(static_cast<i64>(histogram.size()) * gpu::FrameStatistics::SessionBucketDuration) / constant::NsInMillisecond;
+    }
+
+    std::optional<float> TitleProfile::GetScore(Configuration configuration) {
+        auto &record{profile.records[configuration]};
+        if (record.frames < MinimumFrames)
+            return std::nullopt;
+
+        auto hours{static_cast<float>(record.duration) / (constant::NsInSecond * 60.0f * 60.0f)};
+        auto throttleRate{hours > 0.0f ? static_cast<float>(record.throttleEvents) / hours : 0.0f};
+        return GetPercentile(record.histogram, record.frames, 95) * (1.0f + (throttleRate * ThrottlePenalty));
+    }
+
+    TitleProfile::TitleProfile(const std::string &path, u64 titleId) : name(fmt::format("{:016X}.profile", titleId)) {
+        try {
+            profileFileSystem = std::make_shared<vfs::OsFileSystem>(path);
+        } catch (const std::exception &e) {
+            Logger::Warn("Title profiles are unavailable: {}", e.what());
+            return;
+        }
+
+        try {
+            if (profileFileSystem->FileExists(name)) {
+                auto backing{profileFileSystem->OpenFile(name)};
+                ProfileFile expected{};
+                if (backing->size != sizeof(ProfileFile) || backing->Read<u64>() != expected.magic)
+                    Logger::Info("Discarding title profile in an outdated format: {}", name);
+                else
+                    profile = backing->Read<ProfileFile>();
+            }
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to read title profile {}: {}", name, e.what());
+        }
+    }
+
+    void TitleProfile::Apply(Settings &settings) {
+        Configuration best{GetConfiguration(settings)};
+        std::optional<Configuration> unmeasured;
+        while (true) {
+            auto bestScore{GetScore(best)};
+            if (!bestScore) {
+                unmeasured = best;
+                break;
+            }
+
+            // Every configuration differing by a single setting is measured prior to moving to the best of them, this terminates as the score strictly decreases on every move
+            std::optional<Configuration> next;
+            float nextScore{*bestScore};
+            for (size_t index{}; index < TunableSettings.size(); index++) {
+                auto neighbour{static_cast<Configuration>(best ^ (1 << index))};
+                auto score{GetScore(neighbour)};
+                if (!score) {
+                    unmeasured = neighbour;
+                    break;
+                } else if (*score < nextScore) {
+                    next = neighbour;
+                    nextScore = *score;
+                }
+            }
+
+            if (unmeasured || !next)
+                break;
+            best = *next;
+        }
+
+        configuration = unmeasured.value_or(best);
+        for (size_t index{}; index < TunableSettings.size(); index++)
+            settings.*TunableSettings[index].first = configuration & (1 << index);
+        sessionStart = util::GetTimeNs();
+
+        if (unmeasured)
+            Logger::Info("Measuring configuration '{}' for title profile {} ({}/{} frames recorded)", GetConfigurationName(configuration), name, profile.records[configuration].frames, MinimumFrames);
+        else
+            Logger::Info("Using the best configuration '{}' from title profile {} (Score: {:.2f})", GetConfigurationName(configuration), name, *GetScore(configuration));
+    }
+
+    void TitleProfile::Record(const gpu::FrameStatistics::SessionHistogram &histogram, u32 throttleEvents) {
+        if (!profileFileSystem)
+            return;
+
+        u64 frames{std::accumulate(histogram.begin(), histogram.end(), u64{})};
+        if (!frames)
+            return; // Sessions which never presented a frame don't reflect the performance of the configuration
+
+        auto &record{profile.records[configuration]};
+        record.frames += frames;
+        record.duration += static_cast<u64>(util::GetTimeNs() - sessionStart);
+        record.throttleEvents += throttleEvents;
+        for (size_t index{}; index < histogram.size(); index++)
+            record.histogram[index] += histogram[index];
+
+        Logger::Info("Recorded {} frames under '{}' to title profile {}: {:.1f}ms P50, {:.1f}ms P95, {:.1f}ms P99, {} thermal throttling events", frames, GetConfigurationName(configuration), name, GetPercentile(histogram, frames, 50), GetPercentile(histogram, frames, 95), GetPercentile(histogram, frames, 99), throttleEvents);
+
+        try {
+            if (!profileFileSystem->CreateFile(name, sizeof(ProfileFile)))
+                throw exception("Failed to create file");
+            profileFileSystem->OpenFile(name, {false, true, false})->WriteObject(profile);
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to write title profile {}: {}", name, e.what());
+        }
+    }
+}
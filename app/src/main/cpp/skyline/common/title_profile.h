@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <gpu/frame_statistics.h>
+#include <vfs/filesystem.h>
+#include "settings.h"
+
+namespace skyline {
+    /**
+     * @brief A per-title store of the frame times and thermal throttling recorded under every combination of the tunable performance settings, it's used to select the best performing combination on later launches of the title
+     * @note Combinations are explored as a hill climb starting from the user's settings: the combinations which differ from the best measured one by a single setting are each measured for a session, the best one is used once none of them are better
+     * @note Profiles are stored in the private files of the application so they're implicitly specific to the device
+     */
+    class TitleProfile {
+      private:
+        using Configuration = u8; //!< A bitmask of the tunable settings which are enabled, bit N corresponds to TunableSettings[N]
+
+        /**
+         * @brief The settings which are tuned alongside a name for them, these only affect performance and are read when the subsystems are created
+         * @note Settings which affect the output such as the render scale or present mode are left to the user
+         */
+        static constexpr std::array<std::pair<bool Settings::*, std::string_view>, 4> TunableSettings{{
+            {&Settings::forceTripleBuffering, "Triple Buffering"},
+            {&Settings::workStealing, "Work Stealing"},
+            {&Settings::threadHandoffSpinning, "Handoff Spinning"},
+            {&Settings::hostThreadAffinity, "Thread Affinity"},
+        }};
+        static constexpr size_t ConfigurationCount{1 << TunableSettings.size()};
+        static constexpr u64 MinimumFrames{3600}; //!< The amount of frames a configuration must be measured for prior to it being compared, this is a minute at 60 FPS which averages out loading screens and shader compilation
+        static constexpr float ThrottlePenalty{0.02f}; //!< The fraction that the score of a configuration is raised by for every thermal throttling event per hour that it was measured for
+
+        /**
+         * @brief The telemetry accumulated over all sessions of the title under a single configuration
+         */
+        struct ConfigurationRecord {
+            u64 frames;
+            u64 duration; //!< The total duration of all sessions in nanoseconds
+            u32 throttleEvents; //!< The amount of times the thermal governor has lowered the present rate
+            gpu::FrameStatistics::SessionHistogram histogram;
+        };
+
+        /**
+         * @brief The layout of a profile file, the magic must be changed on any change to the layout or the histogram buckets
+         */
+        struct ProfileFile {
+            u64 magic{util::MakeMagic<u64>("SKYTPRF1")};
+            std::array<ConfigurationRecord, ConfigurationCount> records{};
+        };
+
+        std::shared_ptr<vfs::FileSystem> profileFileSystem; //!< The filesystem containing the profile file, this is nullptr if profiles are unavailable
+        std::string name; //!< The name of the profile file in the filesystem
+        ProfileFile profile{};
+        Configuration configuration{}; //!< The configuration which was applied for the current session
+        i64 sessionStart{}; //!< The time at which the configuration was applied
+
+        static Configuration GetConfiguration(const Settings &settings);
+
+        static std::string GetConfigurationName(Configuration configuration);
+
+        /**
+         * @return The supplied percentile of the frame times in the histogram in milliseconds, the upper bound of the bucket containing it is used
+         */
+        static float GetPercentile(const gpu::FrameStatistics::SessionHistogram &histogram, u64 frames, u64 percent);
+
+        /**
+         * @return A score for the configuration where lower is better, this is the 95th percentile frame time with a penalty for thermal throttling or std::nullopt if it hasn't been measured for MinimumFrames yet
+         */
+        std::optional<float> GetScore(Configuration configuration);
+
+      public:
+        /**
+         * @param path The path to the directory in which profiles are stored
+         */
+        TitleProfile(const std::string &path, u64 titleId);
+
+        /**
+         * @brief Overrides the tunable settings with the configuration that should be used for this session, this is either the best measured configuration or one that still needs to be measured
+         * @note This must be called prior to any subsystems being created as they read the settings during their construction
+         */
+        void Apply(Settings &settings);
+
+        /**
+         * @brief Adds the telemetry of the current session to the applied configuration and writes the profile to disk
+         * @param histogram The frame time histogram of the session
+         * @param throttleEvents The amount of times the present rate was lowered due to thermal throttling during the session
+         */
+        void Record(const gpu::FrameStatistics::SessionHistogram &histogram, u32 throttleEvents);
+    };
+}
@@ -14,7 +14,8 @@ PERFETTO_DEFINE_CATEGORIES(
     perfetto::Category("guest").SetDescription("Events relating to guest code"),
     perfetto::Category("gpu").SetDescription("Events from the emulated GPU"),
     perfetto::Category("service").SetDescription("Events from the HLE sysmodule implementations"),
-    perfetto::Category("containers").SetDescription("Events from custom container implementations")
+    perfetto::Category("containers").SetDescription("Events from custom container implementations"),
+    perfetto::Category("memory").SetDescription("Host memory usage by subsystem")
 );
 
 namespace skyline::trace {
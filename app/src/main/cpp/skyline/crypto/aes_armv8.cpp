@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include "aes_armv8.h"
+
+namespace skyline::crypto::armv8 {
+    bool IsSupported() {
+        static const bool supported{(getauxval(AT_HWCAP) & HWCAP_AES) != 0};
+        return supported;
+    }
+
+    /**
+     * @brief Applies the AES S-box to every byte of a word
+     * @note AESE with a zeroed key only performs ShiftRows and SubBytes, ShiftRows has no effect when all columns are the same
+     */
+    static u32 SubWord(u32 word) {
+        return vgetq_lane_u32(vreinterpretq_u32_u8(vaeseq_u8(vreinterpretq_u8_u32(vdupq_n_u32(word)), vdupq_n_u8(0))), 0);
+    }
+
+    void ExpandEncryptionKey(span<const u8> key, RoundKeys &roundKeys) {
+        constexpr std::array<u8, 10> RoundConstants{0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36};
+
+        std::array<u32, 44> words;
+        std::memcpy(words.data(), key.data(), BlockSize);
+        for (size_t i{4}; i < words.size(); i++) {
+            u32 word{words[i - 1]};
+            if (i % 4 == 0)
+                word = SubWord(std::rotr(word, 8)) ^ RoundConstants[(i / 4) - 1];
+            words[i] = words[i - 4] ^ word;
+        }
+
+        std::memcpy(roundKeys.data(), words.data(), sizeof(RoundKeys));
+    }
+
+    void InvertRoundKeys(const RoundKeys &encryptionKeys, RoundKeys &decryptionKeys) {
+        decryptionKeys.front() = encryptionKeys.back();
+        for (size_t i{1}; i < decryptionKeys.size() - 1; i++)
+            vst1q_u8(decryptionKeys[i].data(), vaesimcq_u8(vld1q_u8(encryptionKeys[encryptionKeys.size() - 1 - i].data())));
+        decryptionKeys.back() = encryptionKeys.front();
+    }
+
+    /**
+     * @brief The round keys loaded into registers for the duration of an operation
+     */
+    struct LoadedKeys {
+        std::array<uint8x16_t, 11> keys;
+
+        LoadedKeys(const RoundKeys &roundKeys) {
+            for (size_t i{}; i < keys.size(); i++)
+                keys[i] = vld1q_u8(roundKeys[i].data());
+        }
+
+        uint8x16_t Encrypt(uint8x16_t block) const {
+            for (size_t i{}; i < 9; i++)
+                block = vaesmcq_u8(vaeseq_u8(block, keys[i]));
+            return veorq_u8(vaeseq_u8(block, keys[9]), keys[10]);
+        }
+
+        uint8x16_t Decrypt(uint8x16_t block) const {
+            for (size_t i{}; i < 9; i++)
+                block = vaesimcq_u8(vaesdq_u8(block, keys[i]));
+            return veorq_u8(vaesdq_u8(block, keys[9]), keys[10]);
+        }
+    };
+
+    static void IncrementCounter(Block &counter) {
+        for (size_t i{BlockSize}; i-- > 0;)
+            if (++counter[i] != 0)
+                break;
+    }
+
+    void CtrDecrypt(const RoundKeys &roundKeys, Block &counter, const u8 *source, u8 *destination, size_t size) {
+        LoadedKeys keys{roundKeys};
+
+        // Four blocks are processed at once as the AES instructions have a latency of several cycles but can be pipelined
+        constexpr size_t Interleave{4};
+        while (size >= BlockSize * Interleave) {
+            std::array<uint8x16_t, Interleave> streams;
+            for (auto &stream : streams) {
+                stream = vld1q_u8(counter.data());
+                IncrementCounter(counter);
+            }
+
+            for (auto &stream : streams)
+                stream = keys.Encrypt(stream);
+
+            for (auto &stream : streams) {
+                vst1q_u8(destination, veorq_u8(vld1q_u8(source), stream));
+                source += BlockSize;
+                destination += BlockSize;
+            }
+            size -= BlockSize * Interleave;
+        }
+
+        while (size) {
+            auto stream{keys.Encrypt(vld1q_u8(counter.data()))};
+            IncrementCounter(counter);
+
+            if (size >= BlockSize) {
+                vst1q_u8(destination, veorq_u8(vld1q_u8(source), stream));
+                source += BlockSize;
+                destination += BlockSize;
+                size -= BlockSize;
+            } else {
+                Block streamBytes;
+                vst1q_u8(streamBytes.data(), stream);
+                for (size_t i{}; i < size; i++)
+                    destination[i] = source[i] ^ streamBytes[i];
+                size = 0;
+            }
+        }
+    }
+
+    /**
+     * @brief Multiplies the tweak by the primitive element x in GF(2^128) with the little-endian convention used by XTS
+     */
+    static uint8x16_t MultiplyTweak(uint8x16_t tweak) {
+        constexpr u64 ReductionPolynomial{0x87};
+
+        auto value{vreinterpretq_u64_u8(tweak)};
+        auto topBits{vshrq_n_u64(value, 63)};
+        auto carry{vextq_u64(topBits, topBits, 1)}; // The top bits of the high and low halves in the low and high lanes respectively
+        auto carryMask{vreinterpretq_u64_s64(vnegq_s64(vreinterpretq_s64_u64(carry)))};
+        auto reduction{vandq_u64(carryMask, vcombine_u64(vcreate_u64(ReductionPolynomial), vcreate_u64(1)))}; // The high half's carry is reduced by the polynomial while the low half's carries into the high half
+        return vreinterpretq_u8_u64(veorq_u64(vshlq_n_u64(value, 1), reduction));
+    }
+
+    void XtsDecrypt(const RoundKeys &dataKeys, const RoundKeys &tweakKeys, const Block &iv, const u8 *source, u8 *destination, size_t size) {
+        auto tweak{LoadedKeys{tweakKeys}.Encrypt(vld1q_u8(iv.data()))};
+
+        LoadedKeys keys{dataKeys};
+        for (; size >= BlockSize; size -= BlockSize) {
+            auto block{veorq_u8(vld1q_u8(source), tweak)};
+            vst1q_u8(destination, veorq_u8(keys.Decrypt(block), tweak));
+            tweak = MultiplyTweak(tweak);
+            source += BlockSize;
+            destination += BlockSize;
+        }
+    }
+}
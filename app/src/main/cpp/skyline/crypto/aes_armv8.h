@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+/**
+ * @brief An implementation of AES-128 in CTR and XTS mode using the ARMv8 Cryptography Extensions
+ * @note All functions other than IsSupported must only be called if IsSupported returns true, this translation unit is compiled with the extensions enabled
+ */
+namespace skyline::crypto::armv8 {
+    constexpr size_t BlockSize{0x10};
+    using Block = std::array<u8, BlockSize>;
+    using RoundKeys = std::array<Block, 11>; //!< The expanded round keys of AES-128
+
+    /**
+     * @return If the CPU supports the AES instructions from the ARMv8 Cryptography Extensions
+     */
+    bool IsSupported();
+
+    /**
+     * @brief Expands an AES-128 key into the round keys used for encryption
+     */
+    void ExpandEncryptionKey(span<const u8> key, RoundKeys &roundKeys);
+
+    /**
+     * @brief Converts encryption round keys into the equivalent inverse cipher round keys used for decryption
+     */
+    void InvertRoundKeys(const RoundKeys &encryptionKeys, RoundKeys &decryptionKeys);
+
+    /**
+     * @brief Decrypts data using AES-CTR, the counter is incremented for every block including a trailing partial block
+     * @param counter The big-endian 128-bit counter which is updated to the next unused value
+     * @note The source and destination can be the same
+     */
+    void CtrDecrypt(const RoundKeys &roundKeys, Block &counter, const u8 *source, u8 *destination, size_t size);
+
+    /**
+     * @brief Decrypts a single data unit with AES-XTS
+     * @param dataKeys The decryption round keys derived from the first half of the XTS key
+     * @param tweakKeys The encryption round keys derived from the second half of the XTS key
+     * @param iv The data unit number which is encrypted to form the initial tweak
+     * @note The size must be a multiple of the block size as ciphertext stealing isn't supported, the source and destination can be the same
+     */
+    void XtsDecrypt(const RoundKeys &dataKeys, const RoundKeys &tweakKeys, const Block &iv, const u8 *source, u8 *destination, size_t size);
+}
@@ -11,18 +11,49 @@ namespace skyline::crypto {
 
         if (mbedtls_cipher_setkey(&decryptContext, key.data(), static_cast<int>(key.size() * 8), MBEDTLS_DECRYPT) != 0)
             throw exception("Failed to set key for decryption context");
+
+        mode = mbedtls_cipher_get_cipher_mode(&decryptContext);
+        if (type == MBEDTLS_CIPHER_AES_128_CTR && armv8::IsSupported()) {
+            armv8::ExpandEncryptionKey(key, roundKeys);
+            hardwareAes = true;
+        } else if (type == MBEDTLS_CIPHER_AES_128_XTS && armv8::IsSupported()) {
+            armv8::RoundKeys dataKeys;
+            armv8::ExpandEncryptionKey(key.first(armv8::BlockSize), dataKeys);
+            armv8::InvertRoundKeys(dataKeys, roundKeys);
+            armv8::ExpandEncryptionKey(key.subspan(armv8::BlockSize), tweakRoundKeys);
+            hardwareAes = true;
+        }
     }
 
     AesCipher::~AesCipher() {
         mbedtls_cipher_free(&decryptContext);
     }
 
-    void AesCipher::SetIV(const std::array<u8, 0x10> &iv) {
-        if (mbedtls_cipher_set_iv(&decryptContext, iv.data(), iv.size()) != 0)
+    void AesCipher::SetIV(const std::array<u8, 0x10> &pIv) {
+        if (hardwareAes) {
+            iv = pIv;
+            return;
+        }
+
+        if (mbedtls_cipher_set_iv(&decryptContext, pIv.data(), pIv.size()) != 0)
             throw exception("Failed to set IV for decryption context");
     }
 
     void AesCipher::Decrypt(u8 *destination, u8 *source, size_t size) {
+        if (hardwareAes) {
+            if (mode == MBEDTLS_MODE_CTR) {
+                armv8::CtrDecrypt(roundKeys, iv, source, destination, size);
+                return;
+            } else if (size % armv8::BlockSize == 0) {
+                armv8::XtsDecrypt(roundKeys, tweakRoundKeys, iv, source, destination, size);
+                return;
+            }
+
+            // XTS with ciphertext stealing isn't supported by the hardware path, the IV must be supplied to mbedtls as it isn't set by SetIV
+            if (mbedtls_cipher_set_iv(&decryptContext, iv.data(), iv.size()) != 0)
+                throw exception("Failed to set IV for decryption context");
+        }
+
         constexpr size_t maxBufferSize = 1024 * 1024; //!< Buffer shouldn't grow larger than 1 MiB
 
         std::optional<std::vector<u8>> buf{};
@@ -43,7 +74,7 @@ namespace skyline::crypto {
         mbedtls_cipher_reset(&decryptContext);
 
         size_t outputSize{};
-        if (mbedtls_cipher_get_cipher_mode(&decryptContext) == MBEDTLS_MODE_XTS) {
+        if (mode == MBEDTLS_MODE_XTS) {
             mbedtls_cipher_update(&decryptContext, source, size, targetDestination, &outputSize);
         } else {
             u32 blockSize{mbedtls_cipher_get_block_size(&decryptContext)};
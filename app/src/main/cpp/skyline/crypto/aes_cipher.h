@@ -5,6 +5,7 @@
 
 #include <mbedtls/cipher.h>
 #include <common.h>
+#include "aes_armv8.h"
 
 namespace skyline::crypto {
     /**
@@ -15,6 +16,11 @@ namespace skyline::crypto {
       private:
         mbedtls_cipher_context_t decryptContext;
         std::vector<u8> buffer; //!< A buffer used to avoid constant memory allocation
+        mbedtls_cipher_mode_t mode;
+        bool hardwareAes{}; //!< If CTR and XTS operations are performed with the ARMv8 Cryptography Extensions rather than mbedtls, which is only used as a fallback
+        armv8::RoundKeys roundKeys; //!< The encryption round keys for CTR or the decryption round keys of the data key for XTS
+        armv8::RoundKeys tweakRoundKeys; //!< The encryption round keys of the tweak key for XTS
+        armv8::Block iv; //!< The current IV for CTR or the data unit number for XTS
 
         /**
          * @brief Calculates IV for XTS, basically just big to little endian conversion
@@ -1,16 +1,129 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <sys/stat.h>
 #include <vfs/os_filesystem.h>
+#include "aes_cipher.h"
 #include "key_store.h"
 
 namespace skyline::crypto {
     KeyStore::KeyStore(const std::string &rootPath) {
         vfs::OsFileSystem root(rootPath);
+        auto titleKeysStamp{GetFileStamp(rootPath + "title.keys")}, prodKeysStamp{GetFileStamp(rootPath + "prod.keys")};
+        if (!titleKeysStamp.modificationTime && !prodKeysStamp.modificationTime)
+            return;
+
+        std::string cacheName{KeyCacheName};
+        if (root.FileExists(cacheName) && ReadCache(root.OpenFile(cacheName), titleKeysStamp, prodKeysStamp))
+            return;
+
         if (root.FileExists("title.keys"))
             ReadPairs(root.OpenFile("title.keys"), &KeyStore::PopulateTitleKeys);
         if (root.FileExists("prod.keys"))
             ReadPairs(root.OpenFile("prod.keys"), &KeyStore::PopulateKeys);
+
+        try {
+            WriteCache(rootPath, titleKeysStamp, prodKeysStamp);
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to write the key cache: {}", e.what());
+        }
+    }
+
+    KeyStore::FileStamp KeyStore::GetFileStamp(const std::string &path) {
+        struct stat fileStat{};
+        if (stat(path.c_str(), &fileStat))
+            return {};
+        return {
+            .modificationTime = static_cast<i64>(fileStat.st_mtim.tv_sec) * 1'000'000'000 + fileStat.st_mtim.tv_nsec,
+            .size = static_cast<u64>(fileStat.st_size),
+        };
+    }
+
+    std::array<KeyStore::IndexedKeys128 *, 4> KeyStore::GetIndexedKeys() {
+        return {&titleKek, &areaKeyApplication, &areaKeyOcean, &areaKeySystem};
+    }
+
+    bool KeyStore::ReadCache(const std::shared_ptr<vfs::Backing> &backing, const FileStamp &titleKeysStamp, const FileStamp &prodKeysStamp) {
+        if (backing->size < sizeof(KeyCacheHeader))
+            return false;
+
+        auto cacheHeader{backing->Read<KeyCacheHeader>()};
+        if (cacheHeader.magic != util::MakeMagic<u32>("SKKC") || cacheHeader.version != KeyCacheVersion || cacheHeader.titleKeysStamp != titleKeysStamp || cacheHeader.prodKeysStamp != prodKeysStamp)
+            return false;
+
+        constexpr size_t OptionalKey128Size{sizeof(u8) + sizeof(Key128)};
+        size_t expectedSize{sizeof(u8) + sizeof(Key256) + (GetIndexedKeys().size() * std::tuple_size_v<IndexedKeys128> * OptionalKey128Size) + (cacheHeader.titleKeyCount * sizeof(Key128) * 2)};
+        if (backing->size - sizeof(KeyCacheHeader) != expectedSize)
+            return false;
+
+        std::vector<u8> data(expectedSize);
+        backing->Read(span(data), sizeof(KeyCacheHeader));
+
+        auto cursor{data.begin()};
+        auto readKey{[&cursor]<typename KeyType>(KeyType &key) {
+            std::copy_n(cursor, key.size(), key.begin());
+            cursor += static_cast<ssize_t>(key.size());
+        }};
+
+        if (*cursor++)
+            readKey(headerKey.emplace());
+        else
+            cursor += sizeof(Key256);
+
+        for (auto indexedKeys : GetIndexedKeys()) {
+            for (auto &key : *indexedKeys) {
+                if (*cursor++)
+                    readKey(key.emplace());
+                else
+                    cursor += sizeof(Key128);
+            }
+        }
+
+        for (u32 i{}; i < cacheHeader.titleKeyCount; i++) {
+            Key128 rightsId, titleKey;
+            readKey(rightsId);
+            readKey(titleKey);
+            titleKeys.emplace(rightsId, titleKey);
+        }
+
+        return true;
+    }
+
+    void KeyStore::WriteCache(const std::string &rootPath, const FileStamp &titleKeysStamp, const FileStamp &prodKeysStamp) {
+        KeyCacheHeader cacheHeader{
+            .magic = util::MakeMagic<u32>("SKKC"),
+            .version = KeyCacheVersion,
+            .titleKeysStamp = titleKeysStamp,
+            .prodKeysStamp = prodKeysStamp,
+            .titleKeyCount = static_cast<u32>(titleKeys.size()),
+        };
+
+        std::vector<u8> data(reinterpret_cast<u8 *>(&cacheHeader), reinterpret_cast<u8 *>(&cacheHeader) + sizeof(KeyCacheHeader));
+        auto writeOptionalKey{[&data]<typename KeyType>(const std::optional<KeyType> &key) {
+            data.push_back(key.has_value());
+            KeyType value{key.value_or(KeyType{})};
+            data.insert(data.end(), value.begin(), value.end());
+        }};
+
+        writeOptionalKey(headerKey);
+        for (auto indexedKeys : GetIndexedKeys())
+            for (const auto &key : *indexedKeys)
+                writeOptionalKey(key);
+
+        for (const auto &[rightsId, titleKey] : titleKeys) {
+            data.insert(data.end(), rightsId.begin(), rightsId.end());
+            data.insert(data.end(), titleKey.begin(), titleKey.end());
+        }
+
+        // The cache is written to a temporary file which replaces the old one atomically, this avoids other KeyStore instances reading a partially written cache
+        vfs::OsFileSystem root(rootPath);
+        std::string cacheName{KeyCacheName}, temporaryName{cacheName + ".tmp"};
+        if (!root.CreateFile(temporaryName, data.size()))
+            throw exception("Failed to create the temporary key cache");
+        root.OpenFile(temporaryName, {false, true, false})->Write(span(data));
+
+        if (std::rename((rootPath + temporaryName).c_str(), (rootPath + cacheName).c_str()))
+            throw exception("Failed to replace the key cache: {}", strerror(errno));
     }
 
     void KeyStore::ReadPairs(const std::shared_ptr<vfs::Backing> &backing, ReadPairsCallback callback) {
@@ -43,6 +156,23 @@ namespace skyline::crypto {
             titleKeys.emplace(keyName, value);
     }
 
+    KeyStore::Key128 KeyStore::DecryptKey(Key128 kek, Key128 encryptedKey) {
+        Key256 memoKey;
+        std::copy(kek.begin(), kek.end(), memoKey.begin());
+        std::copy(encryptedKey.begin(), encryptedKey.end(), memoKey.begin() + kek.size());
+
+        std::scoped_lock lock{decryptedKeysMutex};
+        auto it{decryptedKeys.find(memoKey)};
+        if (it != decryptedKeys.end())
+            return it->second;
+
+        Key128 decryptedKey;
+        AesCipher cipher(kek, MBEDTLS_CIPHER_AES_128_ECB);
+        cipher.Decrypt(decryptedKey.data(), encryptedKey.data(), decryptedKey.size());
+        decryptedKeys.emplace(memoKey, decryptedKey);
+        return decryptedKey;
+    }
+
     void KeyStore::PopulateKeys(std::string_view keyName, std::string_view value) {
         {
             auto it{key256Names.find(keyName)};
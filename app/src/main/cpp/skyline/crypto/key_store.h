@@ -9,6 +9,7 @@ namespace skyline::crypto {
     /**
      * @brief The KeyStore class looks for title.keys and prod.keys files in rootPath
      * @note Both files are created on kotlin side, prod.keys contains keys that are used to decrypt ROMs and title key, decrypted title keys are used for ctr backing.
+     * @note The parsed keys are stored in a binary cache (keys.bin) alongside the key files, it is used instead of parsing them while their size and modification time are unchanged
      */
     class KeyStore {
       public:
@@ -27,6 +28,32 @@ namespace skyline::crypto {
       private:
         std::map<Key128, Key128> titleKeys;
 
+        std::mutex decryptedKeysMutex;
+        std::map<Key256, Key128> decryptedKeys; //!< A memo of keys decrypted by DecryptKey, indexed by the KEK followed by the encrypted key
+
+        /**
+         * @brief The size and modification time of a key file, these are used to detect if the key cache is stale
+         */
+        struct FileStamp {
+            i64 modificationTime; //!< The modification time in nanoseconds, this is 0 if the file doesn't exist
+            u64 size;
+
+            bool operator==(const FileStamp &) const = default;
+        };
+
+        struct KeyCacheHeader {
+            u32 magic; //!< The magic of the key cache: 'SKKC'
+            u32 version; //!< The version of the key cache layout, caches with a different version are discarded
+            FileStamp titleKeysStamp;
+            FileStamp prodKeysStamp;
+            u32 titleKeyCount; //!< The amount of title key pairs following the prod keys
+            u32 _pad_;
+        };
+        static_assert(sizeof(KeyCacheHeader) == 0x30);
+
+        static constexpr u32 KeyCacheVersion{1};
+        static constexpr std::string_view KeyCacheName{"keys.bin"};
+
         std::unordered_map<std::string_view, std::optional<Key256> &> key256Names{
             {"header_key", headerKey},
         };
@@ -46,6 +73,20 @@ namespace skyline::crypto {
 
         void PopulateKeys(std::string_view keyName, std::string_view value);
 
+        static FileStamp GetFileStamp(const std::string &path);
+
+        /**
+         * @return All indexed keys in the order they're serialized in the key cache
+         */
+        std::array<IndexedKeys128 *, 4> GetIndexedKeys();
+
+        /**
+         * @return If the cache was valid for the supplied stamps and all keys were loaded from it
+         */
+        bool ReadCache(const std::shared_ptr<vfs::Backing> &backing, const FileStamp &titleKeysStamp, const FileStamp &prodKeysStamp);
+
+        void WriteCache(const std::string &rootPath, const FileStamp &titleKeysStamp, const FileStamp &prodKeysStamp);
+
       public:
         std::optional<Key128> GetTitleKey(const Key128 &title) {
             auto it{titleKeys.find(title)};
@@ -58,5 +99,11 @@ namespace skyline::crypto {
          * @note Any title keys which are already in the store will not have their values updated
          */
         void PopulateTitleKey(Key128 keyName, Key128 value);
+
+        /**
+         * @brief Decrypts a key that is encrypted with AES-128-ECB using the supplied KEK, this is used for title keys and key area keys
+         * @note The results are memoized as every section of an NCA and every NCA of a title decrypts the same keys
+         */
+        Key128 DecryptKey(Key128 kek, Key128 encryptedKey);
     };
 }
@@ -2,10 +2,11 @@
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <jvm.h>
+#include <common/settings.h>
 #include "gpu.h"
 
 namespace skyline::gpu {
-    vk::raii::Instance GPU::CreateInstance(const DeviceState &state, const vk::raii::Context &context) {
+    vk::raii::Instance DeviceContext::CreateInstance(const DeviceState &state, const vk::raii::Context &context) {
         vk::ApplicationInfo applicationInfo{
             .pApplicationName = "Skyline",
             .applicationVersion = static_cast<uint32_t>(state.jvm->GetVersionCode()), // Get the application version from JNI
@@ -66,14 +67,14 @@ namespace skyline::gpu {
         });
     }
 
-    vk::raii::DebugReportCallbackEXT GPU::CreateDebugReportCallback(const vk::raii::Instance &instance) {
+    vk::raii::DebugReportCallbackEXT DeviceContext::CreateDebugReportCallback(const vk::raii::Instance &instance) {
         return vk::raii::DebugReportCallbackEXT(instance, vk::DebugReportCallbackCreateInfoEXT{
             .flags = vk::DebugReportFlagBitsEXT::eError | vk::DebugReportFlagBitsEXT::eWarning | vk::DebugReportFlagBitsEXT::ePerformanceWarning | vk::DebugReportFlagBitsEXT::eInformation | vk::DebugReportFlagBitsEXT::eDebug,
             .pfnCallback = reinterpret_cast<PFN_vkDebugReportCallbackEXT>(&DebugCallback),
         });
     }
 
-    VkBool32 GPU::DebugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType, uint64_t object, size_t location, int32_t messageCode, const char *layerPrefix, const char *message) {
+    VkBool32 DeviceContext::DebugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType, uint64_t object, size_t location, int32_t messageCode, const char *layerPrefix, const char *message) {
         constexpr std::array<Logger::LogLevel, 5> severityLookup{
             Logger::LogLevel::Info,  // VK_DEBUG_REPORT_INFORMATION_BIT_EXT
             Logger::LogLevel::Warn,  // VK_DEBUG_REPORT_WARNING_BIT_EXT
@@ -115,11 +116,11 @@ namespace skyline::gpu {
         return VK_FALSE;
     }
 
-    vk::raii::PhysicalDevice GPU::CreatePhysicalDevice(const vk::raii::Instance &instance) {
+    vk::raii::PhysicalDevice DeviceContext::CreatePhysicalDevice(const vk::raii::Instance &instance) {
         return std::move(vk::raii::PhysicalDevices(instance).front()); // We just select the first device as we aren't expecting multiple GPUs
     }
 
-    vk::raii::Device GPU::CreateDevice(const vk::raii::PhysicalDevice &physicalDevice, typeof(vk::DeviceQueueCreateInfo::queueCount) &vkQueueFamilyIndex) {
+    vk::raii::Device DeviceContext::CreateDevice(const vk::raii::PhysicalDevice &physicalDevice, typeof(vk::DeviceQueueCreateInfo::queueCount) &vkQueueFamilyIndex, std::optional<u32> &transferQueueFamilyIndex, bool &displayTiming, bool &hardwareBuffers, u32 &maxPushDescriptors, vk::DeviceSize &hostImportAlignment, bool &extendedDynamicState, bool &imageFormatList) {
         auto properties{physicalDevice.getProperties()}; // We should check for required properties here, if/when we have them
 
         // auto features{physicalDevice.getFeatures()}; // Same as above
@@ -135,6 +136,48 @@ namespace skyline::gpu {
                 throw exception("Cannot find Vulkan device extension: \"{}\"", requiredExtension);
         }
 
+        auto hasExtension{[&](std::string_view name) {
+            return std::any_of(deviceExtensions.begin(), deviceExtensions.end(), [&](const vk::ExtensionProperties &deviceExtension) {
+                return std::string_view(deviceExtension.extensionName) == name;
+            });
+        }};
+
+        std::vector<const char *> enabledDeviceExtensions(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end());
+        displayTiming = hasExtension(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+        if (displayTiming)
+            enabledDeviceExtensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+
+        hardwareBuffers = hasExtension(VK_ANDROID_EXTERNAL_MEMORY_ANDROID_HARDWARE_BUFFER_EXTENSION_NAME) && hasExtension(VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME);
+        if (hardwareBuffers) {
+            enabledDeviceExtensions.push_back(VK_ANDROID_EXTERNAL_MEMORY_ANDROID_HARDWARE_BUFFER_EXTENSION_NAME);
+            enabledDeviceExtensions.push_back(VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME);
+        }
+
+        if (hasExtension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+            enabledDeviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+            maxPushDescriptors = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePushDescriptorPropertiesKHR>().get<vk::PhysicalDevicePushDescriptorPropertiesKHR>().maxPushDescriptors;
+        } else {
+            maxPushDescriptors = 0;
+        }
+
+        if (hasExtension(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+            enabledDeviceExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+            hostImportAlignment = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>().get<vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>().minImportedHostPointerAlignment;
+        } else {
+            hostImportAlignment = 0;
+        }
+
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+        extendedDynamicState = hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) && physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;
+        if (extendedDynamicState) {
+            enabledDeviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+            extendedDynamicStateFeatures.extendedDynamicState = true;
+        }
+
+        imageFormatList = hasExtension(VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME);
+        if (imageFormatList)
+            enabledDeviceExtensions.push_back(VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME);
+
         auto queueFamilies{physicalDevice.getQueueFamilyProperties()};
         float queuePriority{1.0f}; //!< The priority of the only queue we use, it's set to the maximum of 1.0
         vk::DeviceQueueCreateInfo queue{[&] {
@@ -153,6 +196,25 @@ namespace skyline::gpu {
             throw exception("Cannot find a queue family with both eGraphics and eCompute bits set");
         }()};
 
+        std::array<vk::DeviceQueueCreateInfo, 2> queues{queue};
+        u32 queueCount{1};
+        {
+            // A dedicated transfer queue family doesn't support graphics or compute, it's only used if it can copy at a texel granularity as uploads aren't aligned to anything larger
+            typeof(vk::DeviceQueueCreateInfo::queueFamilyIndex) index{};
+            for (const auto &queueFamily : queueFamilies) {
+                if (queueFamily.queueFlags & vk::QueueFlagBits::eTransfer && !(queueFamily.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)) && queueFamily.minImageTransferGranularity == vk::Extent3D{1, 1, 1}) {
+                    transferQueueFamilyIndex = index;
+                    queues[queueCount++] = vk::DeviceQueueCreateInfo{
+                        .queueFamilyIndex = index,
+                        .queueCount = 1,
+                        .pQueuePriorities = &queuePriority,
+                    };
+                    break;
+                }
+                index++;
+            }
+        }
+
         if (Logger::configLevel >= Logger::LogLevel::Info) {
             std::string extensionString;
             for (const auto &extension : deviceExtensions)
@@ -161,18 +223,40 @@ namespace skyline::gpu {
             std::string queueString;
             u32 familyIndex{};
             for (const auto &queueFamily : queueFamilies)
-                queueString += util::Format("\n* {}x{}{}{}{}{}: TSB{} MIG({}x{}x{}){}", queueFamily.queueCount, queueFamily.queueFlags & vk::QueueFlagBits::eGraphics ? 'G' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eCompute ? 'C' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eTransfer ? 'T' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eSparseBinding ? 'S' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eProtected ? 'P' : '-', queueFamily.timestampValidBits, queueFamily.minImageTransferGranularity.width, queueFamily.minImageTransferGranularity.height, queueFamily.minImageTransferGranularity.depth, familyIndex++ == vkQueueFamilyIndex ? " <--" : "");
+                queueString += util::Format("\n* {}x{}{}{}{}{}: TSB{} MIG({}x{}x{}){}", queueFamily.queueCount, queueFamily.queueFlags & vk::QueueFlagBits::eGraphics ? 'G' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eCompute ? 'C' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eTransfer ? 'T' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eSparseBinding ? 'S' : '-', queueFamily.queueFlags & vk::QueueFlagBits::eProtected ? 'P' : '-', queueFamily.timestampValidBits, queueFamily.minImageTransferGranularity.width, queueFamily.minImageTransferGranularity.height, queueFamily.minImageTransferGranularity.depth, familyIndex == vkQueueFamilyIndex ? " <--" : (familyIndex == transferQueueFamilyIndex ? " <-- (Transfer)" : ""));
+                familyIndex++;
 
             Logger::Info("Vulkan Device:\nName: {}\nType: {}\nVulkan Version: {}.{}.{}\nDriver Version: {}.{}.{}\nQueues:{}\nExtensions:{}", properties.deviceName, vk::to_string(properties.deviceType), VK_VERSION_MAJOR(properties.apiVersion), VK_VERSION_MINOR(properties.apiVersion), VK_VERSION_PATCH(properties.apiVersion), VK_VERSION_MAJOR(properties.driverVersion), VK_VERSION_MINOR(properties.driverVersion), VK_VERSION_PATCH(properties.driverVersion), queueString, extensionString);
         }
 
         return vk::raii::Device(physicalDevice, vk::DeviceCreateInfo{
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &queue,
-            .enabledExtensionCount = requiredDeviceExtensions.size(),
-            .ppEnabledExtensionNames = requiredDeviceExtensions.data(),
+            .pNext = extendedDynamicState ? &extendedDynamicStateFeatures : nullptr,
+            .queueCreateInfoCount = queueCount,
+            .pQueueCreateInfos = queues.data(),
+            .enabledExtensionCount = static_cast<u32>(enabledDeviceExtensions.size()),
+            .ppEnabledExtensionNames = enabledDeviceExtensions.data(),
         });
     }
 
-    GPU::GPU(const DeviceState &state) : vkInstance(CreateInstance(state, vkContext)), vkDebugReportCallback(CreateDebugReportCallback(vkInstance)), vkPhysicalDevice(CreatePhysicalDevice(vkInstance)), vkDevice(CreateDevice(vkPhysicalDevice, vkQueueFamilyIndex)), vkQueue(vkDevice, vkQueueFamilyIndex, 0), memory(*this), scheduler(*this), presentation(state, *this), texture(*this) {}
+    DeviceContext::DeviceContext(const DeviceState &state) : vkInstance(CreateInstance(state, vkContext)), vkDebugReportCallback(CreateDebugReportCallback(vkInstance)), vkPhysicalDevice(CreatePhysicalDevice(vkInstance)), vkDevice(CreateDevice(vkPhysicalDevice, vkQueueFamilyIndex, vkTransferQueueFamilyIndex, supportsDisplayTiming, supportsHardwareBuffers, maxPushDescriptors, hostImportAlignment, supportsExtendedDynamicState, supportsImageFormatList)), vkQueue(vkDevice, vkQueueFamilyIndex, 0), vkTransferQueue([&]() -> std::optional<vk::raii::Queue> {
+        if (vkTransferQueueFamilyIndex) {
+            vkQueueFamilyIndices = {vkQueueFamilyIndex, *vkTransferQueueFamilyIndex};
+            return vk::raii::Queue(vkDevice, *vkTransferQueueFamilyIndex, 0);
+        }
+        return std::nullopt;
+    }()) {}
+
+    std::shared_ptr<DeviceContext> DeviceContext::Get(const DeviceState &state) {
+        static std::mutex mutex;
+        static std::shared_ptr<DeviceContext> context;
+
+        std::scoped_lock lock{mutex};
+        if (!context)
+            context = std::make_shared<DeviceContext>(state);
+        else
+            Logger::Info("Reusing the Vulkan device from a prior emulation session");
+        return context;
+    }
+
+    GPU::GPU(const DeviceState &state) : deviceContext(DeviceContext::Get(state)), memory(*this), renderPassCache(*this), samplerCache(*this), pipelineCache(*this), pipelineCompiler(*this), shaderCache(*this), thermalGovernor(state.settings->thermalGovernor), scheduler(*this), presentation(state, *this), texture(*this), buffer(*this), descriptor(*this), textureDecoder(*this) {}
 }
@@ -4,15 +4,26 @@
 #pragma once
 
 #include "gpu/memory_manager.h"
+#include "gpu/frame_statistics.h"
+#include "gpu/thermal_governor.h"
 #include "gpu/command_scheduler.h"
 #include "gpu/presentation_engine.h"
+#include "gpu/render_pass_cache.h"
+#include "gpu/sampler_cache.h"
+#include "gpu/pipeline_cache.h"
+#include "gpu/pipeline_compiler.h"
+#include "gpu/shader_cache.h"
 #include "gpu/texture_manager.h"
+#include "gpu/buffer_manager.h"
+#include "gpu/descriptor_allocator.h"
+#include "gpu/texture_decoder.h"
 
 namespace skyline::gpu {
     /**
-     * @brief An interface to host GPU structures, anything concerning host GPU/Presentation APIs is encapsulated by this
+     * @brief The Vulkan instance, device and queues alongside the capabilities of the device, these are created once per process and shared by the GPU of every emulation session as creating them is one of the slowest parts of starting emulation
+     * @note All work submitted to the queues by a session must be completed prior to the session's GPU being destroyed as the device outlives it
      */
-    class GPU {
+    class DeviceContext {
       private:
         static vk::raii::Instance CreateInstance(const DeviceState &state, const vk::raii::Context &context);
 
@@ -22,26 +33,108 @@ namespace skyline::gpu {
 
         static vk::raii::PhysicalDevice CreatePhysicalDevice(const vk::raii::Instance &instance);
 
-        static vk::raii::Device CreateDevice(const vk::raii::PhysicalDevice &physicalDevice, typeof(vk::DeviceQueueCreateInfo::queueCount)& queueConfiguration);
+        /**
+         * @param transferQueueFamilyIndex The index of a queue family dedicated to transfers, this is set to std::nullopt if the device doesn't expose a suitable one
+         * @param displayTiming If VK_GOOGLE_display_timing is supported by the device, it's enabled if so
+         * @param hardwareBuffers If importing AHardwareBuffers is supported by the device, the required extensions are enabled if so
+         * @param maxPushDescriptors The maximum amount of push descriptors in a set if VK_KHR_push_descriptor is supported by the device and 0 otherwise, it's enabled if supported
+         * @param hostImportAlignment The alignment of imported host pointers if VK_EXT_external_memory_host is supported by the device and 0 otherwise, it's enabled if supported
+         * @param extendedDynamicState If VK_EXT_extended_dynamic_state is supported by the device, it's enabled if so
+         * @param imageFormatList If VK_KHR_image_format_list is supported by the device, it's enabled if so
+         */
+        static vk::raii::Device CreateDevice(const vk::raii::PhysicalDevice &physicalDevice, typeof(vk::DeviceQueueCreateInfo::queueCount)& queueConfiguration, std::optional<u32> &transferQueueFamilyIndex, bool &displayTiming, bool &hardwareBuffers, u32 &maxPushDescriptors, vk::DeviceSize &hostImportAlignment, bool &extendedDynamicState, bool &imageFormatList);
 
       public:
         static constexpr u32 VkApiVersion{VK_API_VERSION_1_1}; //!< The version of core Vulkan that we require
 
         vk::raii::Context vkContext;
         vk::raii::Instance vkInstance;
-        vk::raii::DebugReportCallbackEXT vkDebugReportCallback; //!< An RAII Vulkan debug report manager which calls into 'GPU::DebugCallback'
+        vk::raii::DebugReportCallbackEXT vkDebugReportCallback; //!< An RAII Vulkan debug report manager which calls into 'DeviceContext::DebugCallback'
         vk::raii::PhysicalDevice vkPhysicalDevice;
         u32 vkQueueFamilyIndex{};
+        std::optional<u32> vkTransferQueueFamilyIndex; //!< The index of the queue family of the transfer queue, this is std::nullopt if there's no dedicated transfer queue
+        std::array<u32, 2> vkQueueFamilyIndices{}; //!< The graphics and transfer queue family indices for resources which are shared between both queues
+        bool supportsDisplayTiming{}; //!< If VK_GOOGLE_display_timing is enabled, this allows scheduling presents at specific times and reading back when they were displayed
+        bool supportsHardwareBuffers{}; //!< If VK_ANDROID_external_memory_android_hardware_buffer is enabled, this allows images to be backed by AHardwareBuffers which can be handed to the compositor directly
+        u32 maxPushDescriptors{}; //!< The maximum amount of descriptors in a push descriptor set if VK_KHR_push_descriptor is enabled and 0 otherwise
+        vk::DeviceSize hostImportAlignment{}; //!< The alignment of the address and size of host memory imported with VK_EXT_external_memory_host if it's enabled and 0 otherwise
+        bool supportsExtendedDynamicState{}; //!< If VK_EXT_extended_dynamic_state is enabled, this allows the viewport and scissor counts to be set dynamically rather than being part of pipelines
+        bool supportsImageFormatList{}; //!< If VK_KHR_image_format_list is enabled, this allows the formats that a mutable-format image will be viewed in to be supplied at creation so the driver can keep it compressed
         vk::raii::Device vkDevice;
         std::mutex queueMutex; //!< Synchronizes access to the queue as it is externally synchronized
         vk::raii::Queue vkQueue; //!< A Vulkan Queue supporting graphics and compute operations
+        std::mutex transferQueueMutex; //!< Synchronizes access to the transfer queue
+        std::optional<vk::raii::Queue> vkTransferQueue; //!< A Vulkan Queue from a queue family dedicated to transfers, texture uploads and readbacks are submitted to it so they can run asynchronously to rendering
+
+        DeviceContext(const DeviceState &state);
+
+        /**
+         * @return The process-wide device context, it's created on the first call and reused by every emulation session after that
+         */
+        static std::shared_ptr<DeviceContext> Get(const DeviceState &state);
+    };
+
+    /**
+     * @brief An interface to host GPU structures, anything concerning host GPU/Presentation APIs is encapsulated by this
+     * @note This is scoped to an emulation session while the Vulkan device it uses is process-wide, all caches and session state are recreated alongside it
+     */
+    class GPU {
+      private:
+        std::shared_ptr<DeviceContext> deviceContext; //!< This must be declared prior to all other members as they reference it
+
+      public:
+        static constexpr u32 VkApiVersion{DeviceContext::VkApiVersion};
+
+        vk::raii::Instance &vkInstance{deviceContext->vkInstance};
+        vk::raii::PhysicalDevice &vkPhysicalDevice{deviceContext->vkPhysicalDevice};
+        const u32 &vkQueueFamilyIndex{deviceContext->vkQueueFamilyIndex};
+        const std::optional<u32> &vkTransferQueueFamilyIndex{deviceContext->vkTransferQueueFamilyIndex};
+        const bool &supportsDisplayTiming{deviceContext->supportsDisplayTiming};
+        const bool &supportsHardwareBuffers{deviceContext->supportsHardwareBuffers};
+        const u32 &maxPushDescriptors{deviceContext->maxPushDescriptors};
+        const vk::DeviceSize &hostImportAlignment{deviceContext->hostImportAlignment};
+        const bool &supportsExtendedDynamicState{deviceContext->supportsExtendedDynamicState};
+        const bool &supportsImageFormatList{deviceContext->supportsImageFormatList};
+        vk::raii::Device &vkDevice{deviceContext->vkDevice};
+        std::mutex &queueMutex{deviceContext->queueMutex};
+        vk::raii::Queue &vkQueue{deviceContext->vkQueue};
+        std::mutex &transferQueueMutex{deviceContext->transferQueueMutex};
+        std::optional<vk::raii::Queue> &vkTransferQueue{deviceContext->vkTransferQueue};
 
         memory::MemoryManager memory;
+        RenderPassCache renderPassCache; //!< This must outlive all textures as they evict their framebuffers from it on destruction
+        SamplerCache samplerCache;
+        PipelineCache pipelineCache;
+        PipelineCompiler pipelineCompiler; //!< This must be destroyed prior to the pipeline cache as its workers compile pipelines into it
+        ShaderCache shaderCache;
+        FrameStatistics statistics; //!< This must outlive the scheduler and presentation engine as they record into it
+        ThermalGovernor thermalGovernor;
         CommandScheduler scheduler;
         PresentationEngine presentation;
 
+        GuestWriteTracker writeTracker;
         TextureManager texture;
+        BufferManager buffer;
+        DescriptorAllocator descriptor;
+        TextureDecoder textureDecoder;
 
         GPU(const DeviceState &state);
+
+        /**
+         * @brief Sets the sharing mode of a resource such that it can be used on both the graphics and the transfer queue without any queue family ownership transfers
+         * @note Resources are only shared concurrently when there's a dedicated transfer queue, they're exclusive to the graphics queue family otherwise
+         */
+        template<typename CreateInfo>
+        void SetQueueSharing(CreateInfo &createInfo) const {
+            if (vkTransferQueue) {
+                createInfo.sharingMode = vk::SharingMode::eConcurrent;
+                createInfo.queueFamilyIndexCount = static_cast<u32>(deviceContext->vkQueueFamilyIndices.size());
+                createInfo.pQueueFamilyIndices = deviceContext->vkQueueFamilyIndices.data();
+            } else {
+                createInfo.sharingMode = vk::SharingMode::eExclusive;
+                createInfo.queueFamilyIndexCount = 1;
+                createInfo.pQueueFamilyIndices = &vkQueueFamilyIndex;
+            }
+        }
     };
 }
@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <common/trace.h>
+#include "buffer_manager.h"
+
+namespace skyline::gpu {
+    BufferManager::Block::Block(memory::Buffer &&pBacking) : backing(std::move(pBacking)) {
+        freeRanges.emplace(0, backing.size());
+    }
+
+    std::optional<vk::DeviceSize> BufferManager::Block::Allocate(vk::DeviceSize size) {
+        std::scoped_lock lock(mutex);
+        for (auto it{freeRanges.begin()}; it != freeRanges.end(); it++) {
+            auto [offset, rangeSize]{*it};
+            if (rangeSize >= size) {
+                freeRanges.erase(it);
+                if (rangeSize != size)
+                    freeRanges.emplace(offset + size, rangeSize - size);
+                return offset;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void BufferManager::Block::Free(vk::DeviceSize offset, vk::DeviceSize size) {
+        std::scoped_lock lock(mutex);
+        auto it{freeRanges.emplace(offset, size).first};
+
+        auto next{std::next(it)};
+        if (next != freeRanges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            freeRanges.erase(next);
+        }
+
+        if (it != freeRanges.begin()) {
+            auto previous{std::prev(it)};
+            if (previous->first + previous->second == it->first) {
+                previous->second += it->second;
+                freeRanges.erase(it);
+            }
+        }
+    }
+
+    BufferManager::BufferManager(GPU &gpu) : gpu(gpu), streamBuffer(gpu.memory.AllocateBuffer(StreamBufferSize)) {
+        auto limits{gpu.vkPhysicalDevice.getProperties().limits};
+        alignment = std::max({limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, vk::DeviceSize{sizeof(u32)}});
+
+        for (auto &chunk : streamChunks)
+            chunk = std::make_shared<StreamChunk>();
+    }
+
+    BufferView BufferManager::Find(span<u8> range) {
+        std::scoped_lock lock(mutex);
+        auto hostBufferIt{buffers.upper_bound(range.data())};
+        while (hostBufferIt != buffers.begin() && (--hostBufferIt)->second->guest.mappings.front().end() > range.begin()) {
+            auto &hostBuffer{hostBufferIt->second};
+            auto &hostMappings{hostBuffer->guest.mappings};
+            if (hostMappings.size() == 1 && hostMappings.front().contains(range))
+                return BufferView{hostBuffer, static_cast<vk::DeviceSize>(range.data() - hostMappings.front().data()), range.size()};
+        }
+
+        return BufferView{};
+    }
+
+    void BufferManager::SynchronizeRange(span<u8> range) {
+        std::scoped_lock lock(mutex);
+        auto hostBufferIt{buffers.lower_bound(range.data() + range.size())};
+        while (hostBufferIt != buffers.begin() && (--hostBufferIt)->second->guest.mappings.front().end() > range.begin()) {
+            auto &hostBuffer{hostBufferIt->second};
+            std::scoped_lock bufferLock(*hostBuffer);
+            hostBuffer->SynchronizeHostRange(range);
+        }
+    }
+
+    BufferView BufferManager::FindOrCreate(const GuestBuffer &guestBuffer) {
+        auto guestMapping{guestBuffer.mappings.front()};
+
+        // Iterate over all buffers that overlap with the first mapping of the guest buffer, a buffer can be reused if:
+        // 1) It has a single mapping which contains the guest buffer's only mapping, this is the case for a subrange of a buffer being bound
+        // 2) All of its mappings match up with the guest buffer's mappings exactly
+        std::scoped_lock lock(mutex);
+        auto hostBufferIt{buffers.upper_bound(guestMapping.data())};
+        while (hostBufferIt != buffers.begin() && (--hostBufferIt)->second->guest.mappings.front().end() > guestMapping.begin()) {
+            auto &hostBuffer{hostBufferIt->second};
+            auto &hostMappings{hostBuffer->guest.mappings};
+            if (hostMappings.size() == 1 && guestBuffer.mappings.size() == 1 && hostMappings.front().contains(guestMapping))
+                return BufferView{hostBuffer, static_cast<vk::DeviceSize>(guestMapping.data() - hostMappings.front().data()), guestMapping.size()};
+
+            if (std::equal(hostMappings.begin(), hostMappings.end(), guestBuffer.mappings.begin(), guestBuffer.mappings.end(), [](const span<u8> &lhs, const span<u8> &rhs) {
+                return lhs.data() == rhs.data() && lhs.size() == rhs.size();
+            }))
+                return BufferView{hostBuffer, 0, guestBuffer.Size()};
+        }
+
+        // Suballocated buffers with a single mapping which partially overlap the guest buffer are merged into the new buffer, it covers the union of their ranges and they're removed from the mappings so any guest range is backed by a single buffer
+        // Buffers which are still in use remain alive till they're released but they aren't returned by any further lookups, the merged buffer is uploaded from guest memory in its entirety on its initial synchronization
+        GuestBuffer mergedBuffer{guestBuffer};
+        vk::DeviceSize viewOffset{};
+        if (guestBuffer.mappings.size() == 1) {
+            auto mergedBegin{guestMapping.data()}, mergedEnd{guestMapping.data() + guestMapping.size()};
+            boost::container::small_vector<decltype(buffers)::iterator, 4> overlaps;
+            auto overlapIt{buffers.lower_bound(mergedEnd)};
+            while (overlapIt != buffers.begin() && (--overlapIt)->second->guest.mappings.front().end() > guestMapping.begin()) {
+                auto &hostBuffer{overlapIt->second};
+                auto &hostMappings{hostBuffer->guest.mappings};
+                if (hostMappings.size() != 1 || hostBuffer->imported)
+                    continue;
+
+                mergedBegin = std::min(mergedBegin, hostMappings.front().data());
+                mergedEnd = std::max(mergedEnd, hostMappings.front().data() + hostMappings.front().size());
+                overlaps.push_back(overlapIt);
+            }
+
+            if (!overlaps.empty()) {
+                for (auto &overlap : overlaps)
+                    buffers.erase(overlap);
+                mergedBuffer = GuestBuffer{GuestBuffer::Mappings{span<u8>(mergedBegin, mergedEnd)}};
+                viewOffset = static_cast<vk::DeviceSize>(guestMapping.data() - mergedBegin);
+            }
+        }
+        auto mergedMapping{mergedBuffer.mappings.front()};
+
+        // Guest memory is imported directly when possible, the range is expanded to the import alignment and the offset of the guest buffer in it must satisfy the alignment of bindings
+        if (gpu.hostImportAlignment && mergedBuffer.mappings.size() == 1 && importedBufferCount < MaxImportedBufferCount) {
+            auto importBegin{util::AlignDown(mergedMapping.data(), gpu.hostImportAlignment)};
+            auto importEnd{util::AlignUp(mergedMapping.data() + mergedMapping.size(), gpu.hostImportAlignment)};
+            auto importOffset{static_cast<vk::DeviceSize>(mergedMapping.data() - importBegin)};
+            if (importOffset % alignment == 0) {
+                if (auto imported{gpu.memory.ImportBuffer(span<u8>(importBegin, importEnd))}) {
+                    importedBufferCount++;
+                    auto buffer{std::make_shared<Buffer>(std::move(*imported), importOffset, mergedBuffer)};
+                    buffers.emplace(mergedMapping.data(), buffer);
+                    return BufferView{buffer, viewOffset, guestBuffer.Size()};
+                }
+            }
+        }
+
+        // Create a buffer as we cannot find one that contains the guest buffer, it's suballocated from the first block with enough free space or a new block if there's none
+        auto allocationSize{util::AlignUp(static_cast<vk::DeviceSize>(mergedBuffer.Size()), alignment)};
+        std::shared_ptr<Block> block;
+        std::optional<vk::DeviceSize> offset;
+        for (auto &candidate : blocks) {
+            if ((offset = candidate->Allocate(allocationSize))) {
+                block = candidate;
+                break;
+            }
+        }
+
+        if (!block) {
+            block = blocks.emplace_back(std::make_shared<Block>(gpu.memory.AllocateBuffer(std::max(BlockSize, allocationSize))));
+            offset = block->Allocate(allocationSize);
+        }
+
+        auto buffer{std::make_shared<Buffer>(std::move(block), *offset, allocationSize, mergedBuffer)};
+        buffers.emplace(mergedMapping.data(), buffer);
+        return BufferView{buffer, viewOffset, guestBuffer.Size()};
+    }
+
+    StreamView BufferManager::Stream(span<const u8> data) {
+        auto reference{std::make_shared<StreamReference>()};
+        vk::DeviceSize size{util::AlignUp(static_cast<vk::DeviceSize>(data.size()), alignment)};
+
+        if (size <= StreamChunkSize) {
+            std::scoped_lock lock(streamMutex);
+            auto offset{streamOffset};
+            if ((offset % StreamChunkSize) + size > StreamChunkSize)
+                offset = util::AlignUp(offset, StreamChunkSize) % StreamBufferSize; // The upload would cross into the next chunk so we move to its start
+
+            // If we've moved into a new chunk then all prior uploads to it must have been consumed by the GPU, this is the case when the ring holds the only reference to it
+            auto &chunk{streamChunks[offset / StreamChunkSize]};
+            if ((offset % StreamChunkSize) != 0 || chunk.use_count() == 1) {
+                reference->chunk = chunk;
+                streamOffset = (offset + size) % StreamBufferSize;
+
+                std::memcpy(streamBuffer.data() + offset, data.data(), data.size());
+                return StreamView{streamBuffer.vkBuffer, offset, data.size(), std::move(reference)};
+            }
+        }
+
+        // The ring is full or the data is too large for it, we fall back to a dedicated buffer for the upload
+        auto &dedicated{reference->dedicated.emplace(gpu.memory.AllocateBuffer(size))};
+        std::memcpy(dedicated.data(), data.data(), data.size());
+        return StreamView{dedicated.vkBuffer, 0, data.size(), std::move(reference)};
+    }
+
+    Buffer::Buffer(std::shared_ptr<BufferManager::Block> pBlock, vk::DeviceSize offset, vk::DeviceSize allocationSize, GuestBuffer guest)
+        : block(std::move(pBlock)),
+          allocationSize(allocationSize),
+          hostMapping(block->backing.data() + offset, guest.Size()),
+          guest(std::move(guest)),
+          backing(block->backing.vkBuffer),
+          offset(offset) {}
+
+    Buffer::Buffer(memory::ImportedBuffer &&pImported, vk::DeviceSize offset, GuestBuffer guest)
+        : imported(std::move(pImported)),
+          allocationSize(guest.Size()),
+          guest(std::move(guest)),
+          backing(*imported->vkBuffer),
+          offset(offset) {}
+
+    Buffer::~Buffer() {
+        std::scoped_lock lock{*this};
+        WaitOnFence();
+        if (block)
+            block->Free(offset, allocationSize);
+    }
+
+    void Buffer::WaitOnFence() {
+        TRACE_EVENT("gpu", "Buffer::WaitOnFence");
+
+        auto lCycle{cycle.lock()};
+        if (lCycle) {
+            lCycle->Wait();
+            cycle.reset();
+        }
+    }
+
+    void Buffer::SynchronizeHost(const std::shared_ptr<FenceCycle> &pCycle) {
+        TRACE_EVENT("gpu", "Buffer::SynchronizeHost");
+
+        if (cycle.lock() != pCycle) {
+            WaitOnFence();
+            pCycle->AttachObject(shared_from_this());
+            cycle = pCycle;
+        }
+
+        if (imported)
+            return; // The GPU reads guest memory directly
+
+        // The shadow is empty prior to the first synchronization, the entire buffer is uploaded in that case
+        bool initialUpload{shadow.empty()};
+        if (initialUpload)
+            shadow.resize(hostMapping.size());
+
+        size_t mappingOffset{};
+        for (const auto &mapping : guest.mappings) {
+            if (initialUpload || std::memcmp(shadow.data() + mappingOffset, mapping.data(), mapping.size()) != 0) {
+                std::memcpy(shadow.data() + mappingOffset, mapping.data(), mapping.size());
+                std::memcpy(hostMapping.data() + mappingOffset, mapping.data(), mapping.size());
+            }
+            mappingOffset += mapping.size();
+        }
+    }
+
+    void Buffer::SynchronizeHostRange(span<u8> range) {
+        if (shadow.empty() || imported)
+            return; // The entire buffer will be uploaded on the initial synchronization regardless and imported buffers are never uploaded
+
+        auto lCycle{cycle.lock()};
+        if (lCycle && !lCycle->Poll())
+            return;
+
+        size_t mappingOffset{};
+        for (const auto &mapping : guest.mappings) {
+            auto begin{std::max(mapping.data(), range.data())}, end{std::min(mapping.data() + mapping.size(), range.data() + range.size())};
+            if (begin < end) {
+                size_t offset{mappingOffset + static_cast<size_t>(begin - mapping.data())};
+                std::memcpy(shadow.data() + offset, begin, static_cast<size_t>(end - begin));
+                std::memcpy(hostMapping.data() + offset, begin, static_cast<size_t>(end - begin));
+            }
+            mappingOffset += mapping.size();
+        }
+    }
+}
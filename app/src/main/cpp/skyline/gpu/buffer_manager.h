@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <map>
+#include <boost/container/small_vector.hpp>
+#include "memory_manager.h"
+
+namespace skyline::gpu {
+    class Buffer;
+
+    /**
+     * @brief The guest memory backing a buffer, this is the CPU mappings of a range of the guest GPU address space
+     */
+    struct GuestBuffer {
+        using Mappings = boost::container::small_vector<span<u8>, 3>;
+        Mappings mappings; //!< Spans to CPU memory for the underlying buffer data in the order they're mapped in the GPU address space
+
+        GuestBuffer() = default;
+
+        GuestBuffer(Mappings mappings) : mappings(std::move(mappings)) {}
+
+        /**
+         * @return The total size of all mappings of the buffer in bytes
+         */
+        size_t Size() const {
+            size_t size{};
+            for (const auto &mapping : mappings)
+                size += mapping.size();
+            return size;
+        }
+    };
+
+    /**
+     * @brief A range of a host buffer which corresponds to a guest buffer or a subrange of one
+     */
+    struct BufferView {
+        std::shared_ptr<Buffer> buffer;
+        vk::DeviceSize offset; //!< The offset of the view relative to the start of the buffer
+        vk::DeviceSize size;
+    };
+
+    /**
+     * @brief A transient upload into the streaming ring buffer, it's only valid for the submission it's used in
+     */
+    struct StreamView {
+        vk::Buffer buffer;
+        vk::DeviceSize offset; //!< The offset of the data into the Vulkan buffer
+        vk::DeviceSize size;
+        std::shared_ptr<FenceCycleDependency> dependency; //!< The reference to the upload's memory, it must be attached to the fence cycle of the submission that reads from it
+    };
+
+    /**
+     * @brief The Buffer Manager is responsible for maintaining host buffers for guest vertex, index and constant buffers, these are suballocated from large host buffers rather than each being a separate Vulkan buffer
+     * @note When VK_EXT_external_memory_host is supported, guest buffers with a single mapping are backed by imported guest memory instead which the GPU accesses directly without any copies
+     * @note Small and frequently updated data such as inline constant buffer updates should be uploaded with Stream() instead, this writes it into a ring buffer which doesn't need to wait on the GPU
+     */
+    class BufferManager {
+      private:
+        static constexpr vk::DeviceSize BlockSize{32 * 1024 * 1024}; //!< The size of a single host buffer that guest buffers are suballocated from, larger buffers are allocated a dedicated block
+        static constexpr vk::DeviceSize StreamChunkSize{512 * 1024}; //!< The size of a single chunk of the streaming ring buffer, chunks are the granularity at which the GPU's usage of the ring is tracked
+        static constexpr size_t StreamChunkCount{16}; //!< The amount of chunks in the streaming ring buffer
+        static constexpr vk::DeviceSize StreamBufferSize{StreamChunkSize * StreamChunkCount};
+        static constexpr size_t MaxImportedBufferCount{1024}; //!< The maximum amount of buffers backed by imported guest memory, every one of them is a separate device memory allocation which drivers only allow a limited amount of
+
+        /**
+         * @brief A large host buffer which guest buffers are suballocated from
+         */
+        struct Block {
+            std::mutex mutex; //!< Synchronizes access to the free ranges
+            memory::Buffer backing;
+            std::map<vk::DeviceSize, vk::DeviceSize> freeRanges; //!< A map from the offset of every free range in the block to its size, adjacent ranges are always coalesced
+
+            Block(memory::Buffer &&backing);
+
+            /**
+             * @return The offset of a free range of the supplied size with a first-fit strategy or std::nullopt if there's none
+             */
+            std::optional<vk::DeviceSize> Allocate(vk::DeviceSize size);
+
+            /**
+             * @brief Returns a range to the block, it's coalesced with any adjacent free ranges
+             */
+            void Free(vk::DeviceSize offset, vk::DeviceSize size);
+        };
+
+        /**
+         * @brief A chunk of the streaming ring buffer, the GPU is done with a chunk when there are no references to it outside of the ring
+         */
+        struct StreamChunk {};
+
+        /**
+         * @brief A reference to the memory of a single upload to the streaming ring buffer which is kept alive by the fence cycle of the submission using it
+         */
+        struct StreamReference : public FenceCycleDependency {
+            std::shared_ptr<StreamChunk> chunk; //!< The chunk of the ring that the upload is in
+            std::optional<memory::Buffer> dedicated; //!< A dedicated buffer for the upload when it couldn't fit in the ring
+        };
+
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes access to the buffer mappings and blocks
+        vk::DeviceSize alignment; //!< The alignment of all suballocations, this satisfies the offset alignment requirements of every binding type
+        std::vector<std::shared_ptr<Block>> blocks;
+        std::multimap<u8 *, std::shared_ptr<Buffer>> buffers; //!< All buffers keyed by the start address of their first mapping
+        size_t importedBufferCount{}; //!< The amount of buffers backed by imported guest memory, buffers are never destroyed while the manager is alive so this is never decremented
+
+        std::mutex streamMutex; //!< Synchronizes access to the streaming ring buffer
+        memory::Buffer streamBuffer; //!< The backing of the streaming ring buffer
+        std::array<std::shared_ptr<StreamChunk>, StreamChunkCount> streamChunks;
+        vk::DeviceSize streamOffset{}; //!< The offset in the ring buffer at which the next upload will be written
+
+        friend Buffer;
+
+      public:
+        BufferManager(GPU &gpu);
+
+        /**
+         * @return A view into a pre-existing or newly created buffer which contains the supplied guest buffer
+         * @note The buffer is only synchronized with the guest when it's attached to a CommandExecutor
+         */
+        BufferView FindOrCreate(const GuestBuffer &guestBuffer);
+
+        /**
+         * @return A view into a pre-existing buffer with a single mapping which contains the supplied range or a view with a null buffer if there's none, this never creates a buffer
+         */
+        BufferView Find(span<u8> range);
+
+        /**
+         * @brief Updates any buffers containing the supplied range of guest memory after it has been written to by the emulated GPU, only the range is copied rather than the entire mapping it's in being reuploaded on the next synchronization
+         */
+        void SynchronizeRange(span<u8> range);
+
+        /**
+         * @brief Copies the supplied data into the streaming ring buffer, if the ring is full or the data doesn't fit in a single chunk then a dedicated buffer is allocated for it
+         * @return A view of the uploaded data which must be attached to the fence cycle of the submission that consumes it
+         */
+        StreamView Stream(span<const u8> data);
+    };
+
+    /**
+     * @brief A host buffer which is suballocated from a larger Vulkan buffer or backed by imported guest memory and backs a guest buffer
+     * @note Changes in the guest buffer are detected by comparing it to a shadow copy of the contents last uploaded to the host rather than by protecting guest memory, buffers are generally small and tend to share pages with other frequently written data
+     * @note Buffers backed by imported guest memory are never synchronized as the GPU reads guest memory directly, guest writes are visible to it immediately as they would be on the guest GPU
+     */
+    class Buffer : public std::enable_shared_from_this<Buffer>, public FenceCycleDependency {
+      private:
+        std::mutex mutex; //!< Synchronizes any mutations to the buffer or its backing
+        std::shared_ptr<BufferManager::Block> block; //!< The block that the buffer is suballocated from, this is nullptr for imported buffers
+        std::optional<memory::ImportedBuffer> imported; //!< The imported guest memory backing the buffer, if any
+        vk::DeviceSize allocationSize; //!< The size of the suballocation, this is the guest size aligned to the suballocation alignment
+        span<u8> hostMapping; //!< The CPU mapping of the buffer's backing
+        std::vector<u8> shadow; //!< The guest contents as of the last upload to the host
+
+        friend BufferManager;
+
+      public:
+        std::weak_ptr<FenceCycle> cycle; //!< A fence cycle for when any host operation reading the buffer has completed, it must be waited on prior to any mutations to the backing
+        GuestBuffer guest;
+        vk::Buffer backing; //!< The Vulkan buffer that the buffer is suballocated from
+        vk::DeviceSize offset; //!< The offset of the buffer in the Vulkan buffer
+
+        Buffer(std::shared_ptr<BufferManager::Block> block, vk::DeviceSize offset, vk::DeviceSize allocationSize, GuestBuffer guest);
+
+        /**
+         * @param offset The offset of the guest buffer in the imported memory, the imported range is aligned to the import alignment
+         */
+        Buffer(memory::ImportedBuffer &&imported, vk::DeviceSize offset, GuestBuffer guest);
+
+        ~Buffer();
+
+        /**
+         * @brief Acquires an exclusive lock on the buffer for the calling thread
+         */
+        void lock() {
+            mutex.lock();
+        }
+
+        /**
+         * @brief Relinquishes an existing lock on the buffer by the calling thread
+         */
+        void unlock() {
+            mutex.unlock();
+        }
+
+        /**
+         * @brief Waits on a fence cycle if it exists till it's signalled and resets it after
+         * @note The buffer **must** be locked prior to calling this
+         */
+        void WaitOnFence();
+
+        /**
+         * @brief Uploads any changes in the guest buffer to the host and attaches the buffer to the supplied fence cycle
+         * @note Any previous fence cycle is waited on prior to doing so as the backing is written to directly
+         * @note The buffer **must** be locked prior to calling this
+         */
+        void SynchronizeHost(const std::shared_ptr<FenceCycle> &cycle);
+
+        /**
+         * @brief Copies the part of the supplied guest range which overlaps the buffer into the shadow and the backing
+         * @note This is skipped while the GPU is using the buffer as the backing can't be written to then, the next synchronization picks up the changes by comparing with the shadow instead
+         * @note The buffer **must** be locked prior to calling this
+         */
+        void SynchronizeHostRange(span<u8> range);
+    };
+}
@@ -2,57 +2,309 @@
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <gpu.h>
+#include <common/trace.h>
 #include "command_scheduler.h"
 
 namespace skyline::gpu {
-    CommandScheduler::CommandBufferSlot::CommandBufferSlot(vk::raii::Device &device, vk::CommandBuffer commandBuffer, vk::raii::CommandPool &pool)
+    CommandScheduler::CommandBufferSlot::CommandBufferSlot(vk::raii::Device &device, vk::CommandBuffer commandBuffer, vk::raii::CommandPool &vkPool, CommandPool &pool)
         : device(device),
-          commandBuffer(device, commandBuffer, pool),
+          commandBuffer(device, commandBuffer, vkPool),
           fence(device, vk::FenceCreateInfo{}),
-          cycle(std::make_shared<FenceCycle>(device, *fence)) {}
-
-    bool CommandScheduler::CommandBufferSlot::AllocateIfFree(CommandScheduler::CommandBufferSlot &slot) {
-        if (!slot.active.test_and_set(std::memory_order_acq_rel)) {
-            if (slot.cycle->Poll()) {
-                slot.commandBuffer.reset();
-                slot.cycle = std::make_shared<FenceCycle>(slot.device, *slot.fence);
-                return true;
-            } else {
-                slot.active.clear(std::memory_order_release);
-            }
+          cycle(std::make_shared<FenceCycle>(device, *fence)),
+          pool(pool) {}
+
+    CommandScheduler::CommandPool::~CommandPool() {
+        std::unique_lock lock(scheduler.waiterMutex);
+        scheduler.waiterCondition.wait(lock, [this]() { return inFlight == 0; });
+    }
+
+    void CommandScheduler::CommandPool::PushFreeSlot(CommandBufferSlot &slot) {
+        slot.nextFree = freeSlots.load(std::memory_order_relaxed);
+        while (!freeSlots.compare_exchange_weak(slot.nextFree, &slot, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    CommandScheduler::CommandBufferSlot *CommandScheduler::CommandPool::PopFreeSlot() {
+        // There's only a single thread popping from the stack so a slot can't be popped and pushed back between us loading it and swapping it out, this avoids the ABA problem
+        auto slot{freeSlots.load(std::memory_order_acquire)};
+        while (slot && !freeSlots.compare_exchange_weak(slot, slot->nextFree, std::memory_order_acquire));
+        return slot;
+    }
+
+    CommandScheduler::TimestampQueries::TimestampQueries(GPU &gpu, u32 validBits)
+        : pool(gpu.vkDevice, vk::QueryPoolCreateInfo{
+              .queryType = vk::QueryType::eTimestamp,
+              .queryCount = TimestampSlotCount * 2,
+          }),
+          commandPool(gpu.vkDevice, vk::CommandPoolCreateInfo{
+              .queueFamilyIndex = gpu.vkQueueFamilyIndex,
+          }),
+          commandBuffers(gpu.vkDevice, vk::CommandBufferAllocateInfo{
+              .commandPool = *commandPool,
+              .level = vk::CommandBufferLevel::ePrimary,
+              .commandBufferCount = TimestampSlotCount * 2,
+          }),
+          period(gpu.vkPhysicalDevice.getProperties().limits.timestampPeriod),
+          mask(validBits >= 64 ? std::numeric_limits<u64>::max() : (1ULL << validBits) - 1) {
+        // The command buffers aren't one-time submit as they're resubmitted by every segment which uses their slot
+        for (u32 slot{}; slot < TimestampSlotCount; slot++) {
+            auto &start{commandBuffers[slot * 2]};
+            start.begin(vk::CommandBufferBeginInfo{});
+            start.resetQueryPool(*pool, slot * 2, 2);
+            start.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *pool, slot * 2);
+            start.end();
+
+            auto &end{commandBuffers[(slot * 2) + 1]};
+            end.begin(vk::CommandBufferBeginInfo{});
+            end.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *pool, (slot * 2) + 1);
+            end.end();
+
+            freeSlots.push_back(slot);
         }
-        return false;
     }
 
-    CommandScheduler::CommandScheduler(GPU &pGpu) : gpu(pGpu), pool(std::ref(pGpu.vkDevice), vk::CommandPoolCreateInfo{
+    CommandScheduler::CommandScheduler(GPU &pGpu) : gpu(pGpu), pool(std::ref(*this), std::ref(pGpu.vkDevice), vk::CommandPoolCreateInfo{
         .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
         .queueFamilyIndex = pGpu.vkQueueFamilyIndex,
-    }) {}
+    }), transferPool(std::ref(*this), std::ref(pGpu.vkDevice), vk::CommandPoolCreateInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = pGpu.vkTransferQueueFamilyIndex.value_or(pGpu.vkQueueFamilyIndex),
+    }), secondaryPool(std::ref(*this), std::ref(pGpu.vkDevice), vk::CommandPoolCreateInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = pGpu.vkQueueFamilyIndex,
+    }), waiterThread(&CommandScheduler::FenceWaiter, this) {
+        if (auto validBits{gpu.vkPhysicalDevice.getQueueFamilyProperties().at(gpu.vkQueueFamilyIndex).timestampValidBits})
+            timestamps.emplace(gpu, validBits);
+    }
+
+    CommandScheduler::~CommandScheduler() {
+        Flush();
+        {
+            std::scoped_lock lock(waiterMutex);
+            exiting = true;
+        }
+        waiterCondition.notify_all();
+        if (waiterThread.joinable())
+            waiterThread.join();
+    }
+
+    void CommandScheduler::FenceWaiter() {
+        pthread_setname_np(pthread_self(), "GPU-FenceWaiter");
+        std::vector<Segment> segments;
+        std::vector<vk::Fence> fences;
+        std::unique_lock lock(waiterMutex);
+        while (true) {
+            waiterCondition.wait(lock, [this]() { return !submittedSegments.empty() || exiting; });
+            if (submittedSegments.empty())
+                return; // We only exit once all submitted segments have been retired
 
-    CommandScheduler::ActiveCommandBuffer CommandScheduler::AllocateCommandBuffer() {
-        auto slot{std::find_if(pool->buffers.begin(), pool->buffers.end(), CommandBufferSlot::AllocateIfFree)};
-        auto slotId{std::distance(pool->buffers.begin(), slot)};
-        if (slot != pool->buffers.end())
+            // We take all submitted segments out of the queue so they can be waited on without the lock held, any segments submitted while waiting are picked up after the timeout
+            for (auto &segment : submittedSegments)
+                segments.emplace_back(std::move(segment));
+            submittedSegments.clear();
+            lock.unlock();
+
+            TRACE_EVENT("gpu", "CommandScheduler::FenceWaiter");
+
+            for (const auto &segment : segments)
+                fences.push_back(segment.fence);
+            std::ignore = gpu.vkDevice.waitForFences(fences, false, std::chrono::duration_cast<std::chrono::nanoseconds>(WaiterTimeout).count());
+            fences.clear();
+
+            // Any signalled cycles have their dependencies destroyed on this thread while polling them, this includes running any writebacks to the guest
+            auto signalled{std::stable_partition(segments.begin(), segments.end(), [](Segment &segment) {
+                return !segment.cycle->Poll();
+            })};
+
+            for (auto it{signalled}; it != segments.end(); it++) {
+                if (it->timestampSlot != NoTimestampSlot) {
+                    // The segment has completed so its timestamps are available without waiting on them
+                    std::array<u64, 2> values{};
+                    auto result{(*gpu.vkDevice).getQueryPoolResults(*timestamps->pool, it->timestampSlot * 2, 2, sizeof(values), values.data(), sizeof(u64), vk::QueryResultFlagBits::e64, *gpu.vkDevice.getDispatcher())};
+                    if (result == vk::Result::eSuccess)
+                        gpu.statistics.AddGpuTime(static_cast<i64>(static_cast<float>((values[1] - values[0]) & timestamps->mask) * timestamps->period));
+                }
+            }
+
+            lock.lock();
+            for (auto it{signalled}; it != segments.end(); it++) {
+                for (auto slot : it->slots) {
+                    slot->pool.PushFreeSlot(*slot);
+                    slot->pool.inFlight--;
+                }
+                if (it->timestampSlot != NoTimestampSlot)
+                    timestamps->freeSlots.push_back(it->timestampSlot);
+            }
+            pendingSegments -= static_cast<size_t>(segments.end() - signalled);
+            TRACE_COUNTER("gpu", "Fence Cycle Backlog", pendingSegments);
+            submittedSegments.insert(submittedSegments.begin(), std::make_move_iterator(segments.begin()), std::make_move_iterator(signalled)); // Unsignalled segments are put back in front of any newly submitted ones to retain submission order
+            segments.clear();
+            waiterCondition.notify_all();
+        }
+    }
+
+    CommandScheduler::SecondarySlot::SecondarySlot(CommandScheduler &scheduler, CommandBufferSlot &slot) : scheduler(scheduler), slot(slot) {}
+
+    CommandScheduler::SecondarySlot::~SecondarySlot() {
+        {
+            std::scoped_lock lock(scheduler.waiterMutex);
+            slot.pool.PushFreeSlot(slot);
+            slot.pool.inFlight--;
+        }
+        scheduler.waiterCondition.notify_all();
+    }
+
+    CommandScheduler::ActiveCommandBuffer CommandScheduler::AllocateCommandBuffer(CommandPool &commandPool, vk::CommandBufferLevel level) {
+        if (auto slot{commandPool.PopFreeSlot()}) {
+            // Slots are only returned to the free list once their cycle has been signalled or if they were never submitted, the cycle of an unsubmitted slot may be shared with a segment so it's always replaced
+            slot->commandBuffer.reset();
+            slot->cycle = std::make_shared<FenceCycle>(slot->device, *slot->fence);
             return ActiveCommandBuffer(*slot);
+        }
 
         vk::CommandBuffer commandBuffer;
         vk::CommandBufferAllocateInfo commandBufferAllocateInfo{
-            .commandPool = *pool->vkCommandPool,
-            .level = vk::CommandBufferLevel::ePrimary,
+            .commandPool = *commandPool.vkCommandPool,
+            .level = level,
             .commandBufferCount = 1,
         };
 
         auto result{(*gpu.vkDevice).allocateCommandBuffers(&commandBufferAllocateInfo, &commandBuffer, *gpu.vkDevice.getDispatcher())};
         if (result != vk::Result::eSuccess)
             vk::throwResultException(result, __builtin_FUNCTION());
-        return ActiveCommandBuffer(pool->buffers.emplace_back(gpu.vkDevice, commandBuffer, pool->vkCommandPool));
+        return ActiveCommandBuffer(commandPool.buffers.emplace_back(gpu.vkDevice, commandBuffer, commandPool.vkCommandPool, commandPool));
     }
 
-    void CommandScheduler::SubmitCommandBuffer(const vk::raii::CommandBuffer &commandBuffer, vk::Fence fence) {
-        std::scoped_lock lock(gpu.queueMutex);
-        gpu.vkQueue.submit(vk::SubmitInfo{
-            .commandBufferCount = 1,
-            .pCommandBuffers = &*commandBuffer,
-        }, fence);
+    void CommandScheduler::RetainSecondary(ActiveCommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle) {
+        {
+            std::scoped_lock lock(waiterMutex);
+            commandBuffer.GetSlot().pool.inFlight++;
+        }
+        commandBuffer.MarkSubmitted();
+        cycle->AttachObject(std::make_shared<SecondarySlot>(*this, commandBuffer.GetSlot()));
+    }
+
+    bool CommandScheduler::HasTransferQueue() {
+        return gpu.vkTransferQueue.has_value();
+    }
+
+    void CommandScheduler::JoinSegment(Segment &target, ActiveCommandBuffer &commandBuffer) {
+        auto &slot{commandBuffer.GetSlot()};
+        if (target.cycle) {
+            slot.cycle = target.cycle;
+        } else {
+            target.cycle = slot.cycle;
+            target.fence = *slot.fence;
+        }
+    }
+
+    bool CommandScheduler::JoinOpenSegment(ActiveCommandBuffer &commandBuffer) {
+        bool opened{!segment.cycle};
+        JoinSegment(segment, commandBuffer);
+        if (opened)
+            segment.cycle->Defer([this, cycle = segment.cycle.get()]() { FlushSegment(cycle); }); // A raw pointer is captured as the cycle would otherwise keep itself alive
+        return opened;
+    }
+
+    CommandScheduler::Segment CommandScheduler::TakeOpenSegment(ActiveCommandBuffer &commandBuffer) {
+        Segment pending;
+        {
+            std::scoped_lock lock(segmentMutex);
+            pending = std::exchange(segment, {});
+        }
+        JoinSegment(pending, commandBuffer);
+        return pending;
+    }
+
+    void CommandScheduler::FlushSegment(FenceCycle *cycle) {
+        std::scoped_lock lock(segmentMutex);
+        if (segment.cycle.get() == cycle) {
+            SubmitSegment(segment);
+            segment = {};
+        }
+        // If the cycle isn't that of the open segment then it's been taken by a thread recording a command buffer into it, the wait will block till it's submitted
+    }
+
+    void CommandScheduler::Flush() {
+        std::scoped_lock lock(segmentMutex);
+        if (segment.cycle) {
+            SubmitSegment(segment);
+            segment = {};
+        }
+    }
+
+    void CommandScheduler::SubmitSegment(Segment &pending, bool transfer) {
+        TRACE_EVENT("gpu", "CommandScheduler::SubmitSegment");
+
+        boost::container::small_vector<vk::CommandBuffer, 8> commandBuffers;
+        for (auto slot : pending.slots)
+            commandBuffers.push_back(*slot->commandBuffer);
+
+        if (transfer) {
+            auto transferSemaphore{std::make_shared<TransferSemaphore>(gpu.vkDevice)};
+            {
+                std::scoped_lock lock(gpu.transferQueueMutex);
+                gpu.vkTransferQueue->submit(vk::SubmitInfo{
+                    .commandBufferCount = static_cast<u32>(commandBuffers.size()),
+                    .pCommandBuffers = commandBuffers.data(),
+                    .signalSemaphoreCount = 1,
+                    .pSignalSemaphores = &*transferSemaphore->semaphore,
+                }, pending.fence);
+            }
+
+            // The semaphore must only be added after the submission as a wait on a binary semaphore can't be submitted prior to its signal
+            std::scoped_lock lock(transferSemaphoreMutex);
+            transferSemaphores.emplace_back(std::move(transferSemaphore));
+        } else {
+            std::vector<std::shared_ptr<TransferSemaphore>> waitSemaphores;
+            {
+                std::scoped_lock lock(transferSemaphoreMutex);
+                waitSemaphores.swap(transferSemaphores);
+            }
+
+            if (timestamps) {
+                std::scoped_lock lock(waiterMutex);
+                if (!timestamps->freeSlots.empty()) {
+                    pending.timestampSlot = timestamps->freeSlots.back();
+                    timestamps->freeSlots.pop_back();
+                }
+            }
+
+            if (pending.timestampSlot != NoTimestampSlot) {
+                // The segment is bracketed by the command buffers writing its timestamps
+                commandBuffers.insert(commandBuffers.begin(), *timestamps->commandBuffers[pending.timestampSlot * 2]);
+                commandBuffers.push_back(*timestamps->commandBuffers[(pending.timestampSlot * 2) + 1]);
+            }
+
+            boost::container::small_vector<vk::Semaphore, 4> semaphores;
+            boost::container::small_vector<vk::PipelineStageFlags, 4> waitStages;
+            for (const auto &waitSemaphore : waitSemaphores) {
+                semaphores.push_back(*waitSemaphore->semaphore);
+                waitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+                pending.cycle->AttachObject(waitSemaphore);
+            }
+
+            std::scoped_lock lock(gpu.queueMutex);
+            gpu.vkQueue.submit(vk::SubmitInfo{
+                .waitSemaphoreCount = static_cast<u32>(semaphores.size()),
+                .pWaitSemaphores = semaphores.data(),
+                .pWaitDstStageMask = waitStages.data(),
+                .commandBufferCount = static_cast<u32>(commandBuffers.size()),
+                .pCommandBuffers = commandBuffers.data(),
+            }, pending.fence);
+        }
+        pending.cycle->MarkSubmitted();
+
+        {
+            std::scoped_lock lock(waiterMutex);
+            for (auto slot : pending.slots)
+                slot->pool.inFlight++;
+            submittedSegments.push_back(pending);
+            TRACE_COUNTER("gpu", "Fence Cycle Backlog", ++pendingSegments);
+        }
+        waiterCondition.notify_all();
+    }
+
+    void CommandScheduler::RecordCpuTime(i64 startTime) {
+        gpu.statistics.AddCpuTime(util::GetTimeNs() - startTime);
     }
 }
@@ -3,6 +3,10 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <boost/container/small_vector.hpp>
 #include <common/thread_local.h>
 #include "fence_cycle.h"
 
@@ -12,37 +16,46 @@ namespace skyline::gpu {
      */
     class CommandScheduler {
       private:
+        struct CommandPool;
+
         /**
          * @brief A wrapper around a command buffer which tracks its state to avoid concurrent usage
          */
         struct CommandBufferSlot {
-            std::atomic_flag active{true}; //!< If the command buffer is currently being recorded to
             const vk::raii::Device &device;
             vk::raii::CommandBuffer commandBuffer;
             vk::raii::Fence fence; //!< A fence used for tracking all submits of a buffer
             std::shared_ptr<FenceCycle> cycle; //!< The latest cycle on the fence, all waits must be performed through this
+            CommandPool &pool; //!< The pool which the command buffer was allocated from and which the slot is returned to once it's free
+            CommandBufferSlot *nextFree{}; //!< The next slot in the free list of the pool, this is only valid while the slot is in the free list
 
-            CommandBufferSlot(vk::raii::Device &device, vk::CommandBuffer commandBuffer, vk::raii::CommandPool &pool);
-
-            /**
-             * @brief Attempts to allocate the buffer if it is free (Not being recorded/executing)
-             * @return If the allocation was successful or not
-             */
-            static bool AllocateIfFree(CommandBufferSlot &slot);
+            CommandBufferSlot(vk::raii::Device &device, vk::CommandBuffer commandBuffer, vk::raii::CommandPool &vkPool, CommandPool &pool);
         };
 
         /**
-         * @brief An active command buffer occupies a slot and ensures that its status is updated correctly
+         * @brief An active command buffer occupies a slot and ensures that it's returned to its pool correctly
          */
         class ActiveCommandBuffer {
           private:
             CommandBufferSlot &slot;
+            bool submitted{}; //!< If the command buffer was submitted, the slot is returned to the pool by the fence waiter in that case
 
           public:
             constexpr ActiveCommandBuffer(CommandBufferSlot &slot) : slot(slot) {}
 
+            ActiveCommandBuffer(const ActiveCommandBuffer &) = delete;
+
             ~ActiveCommandBuffer() {
-                slot.active.clear(std::memory_order_release);
+                if (!submitted)
+                    slot.pool.PushFreeSlot(slot); // The command buffer was never submitted so it can be reused immediately
+            }
+
+            CommandBufferSlot &GetSlot() {
+                return slot;
+            }
+
+            void MarkSubmitted() {
+                submitted = true;
             }
 
             vk::Fence GetFence() {
@@ -69,65 +82,296 @@ namespace skyline::gpu {
          * @note If we utilized a single global pool there would need to be a mutex around command buffer recording which would incur significant costs
          */
         struct CommandPool {
+            CommandScheduler &scheduler;
             vk::raii::CommandPool vkCommandPool;
             std::list<CommandBufferSlot> buffers;
+            std::atomic<CommandBufferSlot *> freeSlots{}; //!< A lock-free stack of slots which are free for allocation, only the owning thread pops from it
+            size_t inFlight{}; //!< The amount of slots which have been submitted and haven't been returned to the free list yet, this is protected by the scheduler's waiter mutex
 
             template<typename... Args>
-            constexpr CommandPool(Args &&... args) : vkCommandPool(std::forward<Args>(args)...) {}
+            CommandPool(CommandScheduler &scheduler, Args &&... args) : scheduler(scheduler), vkCommandPool(std::forward<Args>(args)...) {}
+
+            /**
+             * @brief Waits for all in-flight slots to be returned by the fence waiter as it references the pool
+             */
+            ~CommandPool();
+
+            /**
+             * @brief Pushes a slot onto the free list, this is safe to call concurrently from any thread
+             */
+            void PushFreeSlot(CommandBufferSlot &slot);
+
+            /**
+             * @return A slot popped off the free list or nullptr if it's empty
+             * @note This must only be called by the thread owning the pool
+             */
+            CommandBufferSlot *PopFreeSlot();
+        };
+
+        /**
+         * @brief A group of command buffers which share a single fence cycle and are submitted together in a single vkQueueSubmit
+         */
+        struct Segment {
+            std::shared_ptr<FenceCycle> cycle; //!< The fence cycle shared by all command buffers in the segment, it's the cycle of the first command buffer added to it
+            vk::Fence fence; //!< The fence of the first command buffer in the segment, it's signalled once all command buffers in the segment have completed
+            boost::container::small_vector<CommandBufferSlot *, 8> slots;
+            u32 timestampSlot{NoTimestampSlot}; //!< The slot of the timestamp queries which the GPU execution of the segment is timed with
+        };
+
+        static constexpr u32 NoTimestampSlot{std::numeric_limits<u32>::max()}; //!< A sentinel value for a segment which isn't timed
+        static constexpr u32 TimestampSlotCount{64}; //!< The maximum amount of segments which can be timed concurrently, any segments submitted beyond this aren't timed
+
+        /**
+         * @brief Timestamp queries written at the start and end of graphics queue submissions to measure GPU execution time
+         * @note Each slot has a pair of queries and pre-recorded command buffers to reset and write them, these are reused once the segment using the slot has been retired
+         */
+        struct TimestampQueries {
+            vk::raii::QueryPool pool;
+            vk::raii::CommandPool commandPool;
+            vk::raii::CommandBuffers commandBuffers; //!< The command buffers for writing the start and end timestamps of each slot, they're interleaved by slot
+            float period; //!< The amount of nanoseconds per timestamp tick
+            u64 mask; //!< A mask of the valid bits in a timestamp
+            std::vector<u32> freeSlots; //!< The slots which aren't being used by any submitted segment, this is protected by the scheduler's waiter mutex
+
+            TimestampQueries(GPU &gpu, u32 validBits);
+        };
+
+        std::optional<TimestampQueries> timestamps; //!< This is only present if the graphics queue supports timestamps
+
+        static constexpr std::chrono::milliseconds WaiterTimeout{2}; //!< The longest duration the fence waiter waits on a set of fences prior to picking up any segments submitted in the meantime
+
+        std::mutex waiterMutex; //!< Synchronizes access to the submitted segments and pushes to the free list from the fence waiter
+        std::condition_variable waiterCondition; //!< Signalled when a segment has been submitted, when a slot has been returned to its pool or when the scheduler is being destroyed
+        std::deque<Segment> submittedSegments; //!< All segments which have been submitted but haven't been waited on by the fence waiter yet, in submission order
+        size_t pendingSegments{}; //!< The amount of segments which have been submitted and haven't been signalled yet, this is only used for tracing the fence cycle backlog
+        bool exiting{};
+        ThreadLocal<CommandPool> pool; //!< This must be destroyed prior to the waiter state as pools wait on their in-flight slots during destruction
+        ThreadLocal<CommandPool> transferPool; //!< A pool of command buffers from the transfer queue family, this is only used if there's a dedicated transfer queue
+        ThreadLocal<CommandPool> secondaryPool; //!< A pool of secondary command buffers, these're recorded on worker threads and executed by a primary command buffer
+        std::thread waiterThread; //!< A thread which waits on the fences of all submitted segments and destroys their dependencies and returns their slots to their pools as soon as each one is signalled
+
+        static constexpr size_t MaxSegmentSize{32}; //!< The maximum amount of deferred command buffers in a segment, the segment is submitted once it reaches this size
+
+        std::mutex segmentMutex; //!< Synchronizes access to the open segment, it's held while any deferred command buffer is being recorded
+        Segment segment; //!< The segment that deferred command buffers are added to, it's open if it has a cycle
+
+        /**
+         * @brief A semaphore signalled by a submission to the transfer queue which the next submission to the graphics queue waits on
+         * @note It's attached to the cycle of the graphics queue submission which waits on it so it's destroyed after the wait has completed
+         */
+        struct TransferSemaphore : public FenceCycleDependency {
+            vk::raii::Semaphore semaphore;
+
+            TransferSemaphore(const vk::raii::Device &device) : semaphore(device, vk::SemaphoreCreateInfo{}) {}
+        };
+
+        std::mutex transferSemaphoreMutex; //!< Synchronizes access to the transfer semaphores
+        std::vector<std::shared_ptr<TransferSemaphore>> transferSemaphores; //!< The semaphores of all transfer queue submissions which haven't been waited on by the graphics queue yet
+
+        /**
+         * @brief Waits on the fences of all submitted segments together and retires any that have been signalled, this releases the dependencies of cycles as soon as possible rather than when they're next waited on or polled
+         * @note Segments on different queues can complete out of order so they're waited on as a set rather than in submission order
+         */
+        void FenceWaiter();
+
+        /**
+         * @brief Adds the command buffer to the target segment by replacing its cycle with that of the segment, the segment takes on the command buffer's cycle and fence if it's empty
+         */
+        static void JoinSegment(Segment &target, ActiveCommandBuffer &commandBuffer);
+
+        /**
+         * @brief Adds the command buffer to the open segment, the segment is opened with the command buffer's cycle if there's none
+         * @return If the command buffer opened the segment
+         * @note The segment mutex must be locked prior to calling this
+         */
+        bool JoinOpenSegment(ActiveCommandBuffer &commandBuffer);
+
+        /**
+         * @return The open segment with the command buffer added to it, a new segment is opened for any subsequent deferred command buffers
+         */
+        Segment TakeOpenSegment(ActiveCommandBuffer &commandBuffer);
+
+        /**
+         * @brief Submits the open segment if its cycle is the supplied one, this is called when a deferred cycle is waited on
+         */
+        void FlushSegment(FenceCycle *cycle);
+
+        /**
+         * @brief Returns a secondary command buffer to its pool once the fence cycle of the primary command buffer executing it has been signalled
+         */
+        struct SecondarySlot : public FenceCycleDependency {
+            CommandScheduler &scheduler;
+            CommandBufferSlot &slot;
+
+            SecondarySlot(CommandScheduler &scheduler, CommandBufferSlot &slot);
+
+            ~SecondarySlot();
         };
-        ThreadLocal<CommandPool> pool;
 
         /**
-         * @brief Allocates an existing or new primary command buffer from the pool
+         * @brief Allocates an existing or new command buffer of the supplied level from the supplied pool, a pool must only be used for a single level
+         */
+        ActiveCommandBuffer AllocateCommandBuffer(CommandPool &commandPool, vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
+
+        /**
+         * @brief Transfers the ownership of a recorded secondary command buffer to the supplied cycle
+         */
+        void RetainSecondary(ActiveCommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle);
+
+        /**
+         * @return If the device has a dedicated transfer queue which transfers are submitted to
+         */
+        bool HasTransferQueue();
+
+        /**
+         * @brief Submits all command buffers in a segment to the GPU queue with the segment's fence, the slots are handed off to the fence waiter after submission
+         * @param transfer If the segment should be submitted to the transfer queue, it signals a semaphore which the next graphics queue submission waits on in that case
          */
-        ActiveCommandBuffer AllocateCommandBuffer();
+        void SubmitSegment(Segment &segment, bool transfer = false);
 
         /**
-         * @brief Submits a single command buffer to the GPU queue with an optional fence
+         * @brief Records the CPU time spent recording and submitting command buffers since the supplied timestamp into the frame statistics
          */
-        void SubmitCommandBuffer(const vk::raii::CommandBuffer &commandBuffer, vk::Fence fence = {});
+        void RecordCpuTime(i64 startTime);
 
       public:
         CommandScheduler(GPU &gpu);
 
+        ~CommandScheduler();
+
         /**
          * @brief Submits a command buffer recorded with the supplied function synchronously
+         * @note Any command buffers in the open segment are submitted along with it in the same submission
          */
         template<typename RecordFunction>
         std::shared_ptr<FenceCycle> Submit(RecordFunction recordFunction) {
-            auto commandBuffer{AllocateCommandBuffer()};
+            return SubmitWithCycle([&](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &) {
+                recordFunction(commandBuffer);
+            });
+        }
+
+        /**
+         * @note Same as Submit but with FenceCycle as an argument rather than return value
+         */
+        template<typename RecordFunction>
+        std::shared_ptr<FenceCycle> SubmitWithCycle(RecordFunction recordFunction) {
+            auto startTime{util::GetTimeNs()};
+            auto commandBuffer{AllocateCommandBuffer(*pool)};
+            auto pending{TakeOpenSegment(commandBuffer)};
+            try {
+                commandBuffer->begin(vk::CommandBufferBeginInfo{
+                    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+                });
+                recordFunction(*commandBuffer, commandBuffer.GetFenceCycle());
+                commandBuffer->end();
+            } catch (...) {
+                if (pending.slots.empty())
+                    commandBuffer.GetFenceCycle()->Cancel();
+                else
+                    SubmitSegment(pending); // The deferred command buffers must still be submitted as their cycle is shared with other objects
+                std::rethrow_exception(std::current_exception());
+            }
+
+            pending.slots.push_back(&commandBuffer.GetSlot());
+            commandBuffer.MarkSubmitted();
+            SubmitSegment(pending);
+            RecordCpuTime(startTime);
+            return pending.cycle;
+        }
+
+        /**
+         * @brief Records a command buffer with the supplied function into the open segment, it's submitted in a single submission with all other command buffers in the segment
+         * @return The fence cycle of the segment, waiting on it submits the segment if it hasn't been submitted yet
+         * @note The segment is submitted by the next call to Submit, SubmitWithCycle or Flush or once it's full
+         * @note The record function must not wait on any fence cycle as the segment mutex is held while it runs
+         */
+        template<typename RecordFunction>
+        std::shared_ptr<FenceCycle> SubmitDeferred(RecordFunction recordFunction) {
+            auto startTime{util::GetTimeNs()};
+            std::scoped_lock lock(segmentMutex);
+            auto commandBuffer{AllocateCommandBuffer(*pool)};
+            bool opened{JoinOpenSegment(commandBuffer)};
             try {
                 commandBuffer->begin(vk::CommandBufferBeginInfo{
                     .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
                 });
                 recordFunction(*commandBuffer);
                 commandBuffer->end();
-                SubmitCommandBuffer(*commandBuffer, commandBuffer.GetFence());
-                return commandBuffer.GetFenceCycle();
             } catch (...) {
-                commandBuffer.GetFenceCycle()->Cancel();
+                if (opened) {
+                    segment.cycle->Cancel();
+                    segment = {};
+                }
                 std::rethrow_exception(std::current_exception());
             }
+
+            segment.slots.push_back(&commandBuffer.GetSlot());
+            commandBuffer.MarkSubmitted(); // The slot is owned by the segment now, it's handed off to the fence waiter when the segment is submitted
+
+            auto cycle{segment.cycle};
+            if (segment.slots.size() >= MaxSegmentSize) {
+                SubmitSegment(segment);
+                segment = {};
+            }
+            RecordCpuTime(startTime);
+            return cycle;
         }
 
         /**
-         * @note Same as Submit but with FenceCycle as an argument rather than return value
+         * @brief Submits a command buffer recorded with the supplied function to the dedicated transfer queue, the next submission to the graphics queue waits on it to complete
+         * @note This falls back to SubmitDeferred if the device doesn't have a dedicated transfer queue
+         * @note The record function must only record commands which are supported by a transfer queue and it must not wait on any fence cycle
          */
         template<typename RecordFunction>
-        std::shared_ptr<FenceCycle> SubmitWithCycle(RecordFunction recordFunction) {
-            auto commandBuffer{AllocateCommandBuffer()};
+        std::shared_ptr<FenceCycle> SubmitTransfer(RecordFunction recordFunction) {
+            if (!HasTransferQueue())
+                return SubmitDeferred(std::move(recordFunction));
+
+            auto startTime{util::GetTimeNs()};
+            auto commandBuffer{AllocateCommandBuffer(*transferPool)};
+            Segment pending;
+            JoinSegment(pending, commandBuffer);
             try {
                 commandBuffer->begin(vk::CommandBufferBeginInfo{
                     .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
                 });
-                recordFunction(*commandBuffer, commandBuffer.GetFenceCycle());
+                recordFunction(*commandBuffer);
                 commandBuffer->end();
-                SubmitCommandBuffer(*commandBuffer, commandBuffer.GetFence());
-                return commandBuffer.GetFenceCycle();
             } catch (...) {
                 commandBuffer.GetFenceCycle()->Cancel();
                 std::rethrow_exception(std::current_exception());
             }
+
+            pending.slots.push_back(&commandBuffer.GetSlot());
+            commandBuffer.MarkSubmitted();
+            SubmitSegment(pending, true);
+            RecordCpuTime(startTime);
+            return pending.cycle;
+        }
+
+        /**
+         * @brief Records a secondary command buffer with the supplied function on the calling thread, this can be called concurrently from any amount of threads as every thread records from its own pool
+         * @param inheritance The render pass state that the command buffer inherits from the primary command buffer executing it
+         * @param cycle The fence cycle of the primary command buffer that executes the secondary command buffer, it's returned to its pool once this has been signalled
+         * @return The recorded command buffer, it must be executed by a primary command buffer submitted with the supplied cycle
+         */
+        template<typename RecordFunction>
+        vk::CommandBuffer RecordSecondary(const vk::CommandBufferInheritanceInfo &inheritance, const std::shared_ptr<FenceCycle> &cycle, RecordFunction recordFunction) {
+            auto commandBuffer{AllocateCommandBuffer(*secondaryPool, vk::CommandBufferLevel::eSecondary)};
+            commandBuffer->begin(vk::CommandBufferBeginInfo{
+                .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                .pInheritanceInfo = &inheritance,
+            });
+            recordFunction(*commandBuffer);
+            commandBuffer->end();
+
+            RetainSecondary(commandBuffer, cycle);
+            return **commandBuffer;
         }
+
+        /**
+         * @brief Submits all command buffers in the open segment if there are any
+         */
+        void Flush();
     };
 }
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include "descriptor_allocator.h"
+
+namespace skyline::gpu {
+    DescriptorAllocator::Pool::Pool(vk::raii::DescriptorPool &&pool) : pool(std::move(pool)) {}
+
+    DescriptorAllocator::PoolReference::PoolReference(std::shared_ptr<Pool> pool) : pool(std::move(pool)) {}
+
+    std::shared_ptr<DescriptorAllocator::Pool> DescriptorAllocator::CreatePool() {
+        constexpr std::array<vk::DescriptorPoolSize, 8> poolSizes{
+            vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eSampler, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eUniformTexelBuffer, PoolDescriptorCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eStorageTexelBuffer, PoolDescriptorCount},
+        };
+
+        return std::make_shared<Pool>(vk::raii::DescriptorPool(gpu.vkDevice, vk::DescriptorPoolCreateInfo{
+            .maxSets = PoolSetCount,
+            .poolSizeCount = static_cast<u32>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data(),
+        }));
+    }
+
+    void DescriptorAllocator::AdvancePool() {
+        poolIndex = (poolIndex + 1) % pools.size();
+        auto &pool{pools[poolIndex]};
+        if (pool.use_count() == 1) {
+            pool->pool.reset();
+            pool->sets.clear();
+        } else {
+            pools.insert(pools.begin() + static_cast<ssize_t>(poolIndex), CreatePool());
+        }
+    }
+
+    DescriptorAllocator::DescriptorAllocator(GPU &gpu) : gpu(gpu) {
+        pools.emplace_back(CreatePool());
+    }
+
+    std::shared_ptr<DescriptorSetLayout> DescriptorAllocator::CreateLayout(span<const vk::DescriptorSetLayoutBinding> bindings, span<const vk::DescriptorUpdateTemplateEntry> entries) {
+        u32 descriptorCount{};
+        for (const auto &binding : bindings)
+            descriptorCount += binding.descriptorCount;
+        bool push{gpu.maxPushDescriptors > 0 && descriptorCount <= gpu.maxPushDescriptors}; // A maximum of 0 denotes VK_KHR_push_descriptor being unsupported, this must be checked explicitly as a layout without any descriptors would satisfy the bound otherwise
+
+        auto layout{std::make_shared<DescriptorSetLayout>(DescriptorSetLayout{
+            .layout = vk::raii::DescriptorSetLayout(gpu.vkDevice, vk::DescriptorSetLayoutCreateInfo{
+                .flags = push ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR : vk::DescriptorSetLayoutCreateFlags{},
+                .bindingCount = static_cast<u32>(bindings.size()),
+                .pBindings = bindings.data(),
+            }),
+            .entries = std::vector<vk::DescriptorUpdateTemplateEntry>(entries.begin(), entries.end()),
+            .push = push,
+        })};
+
+        if (!push)
+            layout->updateTemplate.emplace(gpu.vkDevice, vk::DescriptorUpdateTemplateCreateInfo{
+                .descriptorUpdateEntryCount = static_cast<u32>(layout->entries.size()),
+                .pDescriptorUpdateEntries = layout->entries.data(),
+                .templateType = vk::DescriptorUpdateTemplateType::eDescriptorSet,
+                .descriptorSetLayout = *layout->layout,
+            });
+
+        return layout;
+    }
+
+    vk::raii::DescriptorUpdateTemplate DescriptorAllocator::CreatePushTemplate(const DescriptorSetLayout &layout, vk::PipelineLayout pipelineLayout, u32 set, vk::PipelineBindPoint bindPoint) {
+        if (!layout.push)
+            throw exception("Cannot create a push descriptor template for a layout which isn't a push layout");
+
+        return vk::raii::DescriptorUpdateTemplate(gpu.vkDevice, vk::DescriptorUpdateTemplateCreateInfo{
+            .descriptorUpdateEntryCount = static_cast<u32>(layout.entries.size()),
+            .pDescriptorUpdateEntries = layout.entries.data(),
+            .templateType = vk::DescriptorUpdateTemplateType::ePushDescriptorsKHR,
+            .descriptorSetLayout = *layout.layout,
+            .pipelineBindPoint = bindPoint,
+            .pipelineLayout = pipelineLayout,
+            .set = set,
+        });
+    }
+
+    DescriptorSet DescriptorAllocator::Allocate(const DescriptorSetLayout &layout, span<const u8> data) {
+        if (layout.push)
+            throw exception("Cannot allocate a descriptor set of a push layout");
+
+        // The key is the layout handle followed by the template data, this is compared in its entirety so sets are never shared on a hash collision
+        VkDescriptorSetLayout layoutHandle{*layout.layout};
+        std::string key(sizeof(layoutHandle) + data.size(), '\0');
+        std::memcpy(key.data(), &layoutHandle, sizeof(layoutHandle));
+        std::memcpy(key.data() + sizeof(layoutHandle), data.data(), data.size());
+
+        std::scoped_lock lock{mutex};
+        auto setIt{pools[poolIndex]->sets.find(key)};
+        if (setIt != pools[poolIndex]->sets.end())
+            return DescriptorSet{setIt->second, std::make_shared<PoolReference>(pools[poolIndex])};
+
+        vk::DescriptorSet set;
+        auto allocate{[&]() {
+            vk::DescriptorSetAllocateInfo allocateInfo{
+                .descriptorPool = *pools[poolIndex]->pool,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &*layout.layout,
+            };
+            return (*gpu.vkDevice).allocateDescriptorSets(&allocateInfo, &set, *gpu.vkDevice.getDispatcher());
+        }};
+
+        auto result{allocate()};
+        if (result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool) {
+            AdvancePool();
+            result = allocate();
+        }
+        if (result != vk::Result::eSuccess)
+            throw exception("Failed to allocate descriptor set: {}", vk::to_string(result));
+
+        (*gpu.vkDevice).updateDescriptorSetWithTemplate(set, **layout.updateTemplate, data.data(), *gpu.vkDevice.getDispatcher());
+
+        auto &pool{pools[poolIndex]};
+        pool->sets.emplace(std::move(key), set);
+        return DescriptorSet{set, std::make_shared<PoolReference>(pool)};
+    }
+}
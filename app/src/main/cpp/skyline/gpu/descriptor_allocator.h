@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <common.h>
+#include "fence_cycle.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief A descriptor set layout alongside the update template entries that write all of its descriptors from a single block of data
+     */
+    struct DescriptorSetLayout {
+        vk::raii::DescriptorSetLayout layout;
+        std::vector<vk::DescriptorUpdateTemplateEntry> entries; //!< The entries of the update template, these are retained for creating push descriptor templates
+        bool push; //!< If descriptors of this layout are pushed into the command buffer rather than written to allocated sets, this is the case when push descriptors are supported and the layout has few enough descriptors for them
+        std::optional<vk::raii::DescriptorUpdateTemplate> updateTemplate; //!< The update template for allocated sets, this is std::nullopt for push layouts as their templates depend on the pipeline layout
+    };
+
+    /**
+     * @brief A descriptor set allocated from the pool ring, it's only valid for the submission it's used in
+     */
+    struct DescriptorSet {
+        vk::DescriptorSet set;
+        std::shared_ptr<FenceCycleDependency> dependency; //!< The reference to the pool of the set, it must be attached to the fence cycle of the submission that uses the set
+    };
+
+    /**
+     * @brief The Descriptor Allocator allocates descriptor sets from a ring of pools, a pool is reset in its entirety once the GPU is done with all sets from it rather than sets being freed individually
+     * @note Sets are written with update templates and cached on their contents within a pool, draws with identical bindings share a single set
+     */
+    class DescriptorAllocator {
+      private:
+        static constexpr u32 PoolSetCount{512}; //!< The maximum amount of sets in a single pool
+        static constexpr u32 PoolDescriptorCount{2048}; //!< The amount of descriptors of every type in a single pool
+
+        /**
+         * @brief A pool in the ring, every submission using a set from it holds a reference to it so it's only reset once the ring holds the only reference
+         */
+        struct Pool {
+            vk::raii::DescriptorPool pool;
+            std::unordered_map<std::string, vk::DescriptorSet> sets; //!< A map from the layout and contents of every set allocated from the pool to the set
+
+            Pool(vk::raii::DescriptorPool &&pool);
+        };
+
+        /**
+         * @brief A reference to a pool which is kept alive by the fence cycle of a submission using a set from it
+         */
+        struct PoolReference : public FenceCycleDependency {
+            std::shared_ptr<Pool> pool;
+
+            PoolReference(std::shared_ptr<Pool> pool);
+        };
+
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes access to the pool ring
+        std::vector<std::shared_ptr<Pool>> pools; //!< The ring of pools, a pool is inserted when the ring runs into a pool that's still in use
+        size_t poolIndex{}; //!< The index of the pool in the ring that sets are currently allocated from
+
+        std::shared_ptr<Pool> CreatePool();
+
+        /**
+         * @brief Moves onto the next pool in the ring, it's reset if the GPU is done with it and a new pool is inserted in front of it otherwise
+         */
+        void AdvancePool();
+
+      public:
+        DescriptorAllocator(GPU &gpu);
+
+        /**
+         * @return A descriptor set layout with the supplied bindings which is written with the supplied update template entries
+         * @note The layout is created for push descriptors when possible, sets of it must then be pushed with a template from CreatePushTemplate rather than being allocated
+         */
+        std::shared_ptr<DescriptorSetLayout> CreateLayout(span<const vk::DescriptorSetLayoutBinding> bindings, span<const vk::DescriptorUpdateTemplateEntry> entries);
+
+        /**
+         * @return An update template for pushing descriptors of a push layout into a command buffer at the supplied set index of the pipeline layout
+         */
+        vk::raii::DescriptorUpdateTemplate CreatePushTemplate(const DescriptorSetLayout &layout, vk::PipelineLayout pipelineLayout, u32 set, vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
+
+        /**
+         * @return A descriptor set of the supplied layout written with the supplied data by the update template of the layout, a set with identical contents from the current pool is reused if there's one
+         * @note The layout must not be a push layout
+         */
+        DescriptorSet Allocate(const DescriptorSetLayout &layout, span<const u8> data);
+    };
+}
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <forward_list>
+#include <functional>
 #include <vulkan/vulkan_raii.hpp>
 #include <common.h>
 
@@ -27,9 +28,11 @@ namespace skyline::gpu {
     struct FenceCycle {
       private:
         std::atomic_flag signalled;
+        std::atomic_flag deferred; //!< If the work which signals the fence has been deferred and not submitted yet
         const vk::raii::Device &device;
         vk::Fence fence;
         std::shared_ptr<FenceCycleDependency> list;
+        std::function<void()> flush; //!< A function which submits the deferred work signalling the fence, it's called prior to any blocking wait while the cycle is deferred
 
         /**
          * @brief Sequentially iterate through the shared_ptr linked list of dependencies and reset all pointers in a thread-safe atomic manner
@@ -44,8 +47,16 @@ namespace skyline::gpu {
             }
         }
 
+        /**
+         * @brief Submits the work signalling the fence if it's been deferred, it would never be signalled otherwise
+         */
+        void Flush() {
+            if (deferred.test(std::memory_order_acquire))
+                flush();
+        }
+
       public:
-        FenceCycle(const vk::raii::Device &device, vk::Fence fence) : signalled(false), device(device), fence(fence) {
+        FenceCycle(const vk::raii::Device &device, vk::Fence fence) : signalled(false), deferred(false), device(device), fence(fence) {
             device.resetFences(fence);
         }
 
@@ -53,6 +64,22 @@ namespace skyline::gpu {
             Wait();
         }
 
+        /**
+         * @brief Marks the work signalling the fence as deferred, the supplied function is called to submit it if the cycle is waited on prior to it being submitted
+         * @note This must be called prior to the cycle being shared with any other thread
+         */
+        void Defer(std::function<void()> pFlush) {
+            flush = std::move(pFlush);
+            deferred.test_and_set(std::memory_order_release);
+        }
+
+        /**
+         * @brief Marks the deferred work signalling the fence as submitted, this must be called after it has been submitted to the queue
+         */
+        void MarkSubmitted() {
+            deferred.clear(std::memory_order_release);
+        }
+
         /**
          * @brief Signals this fence regardless of if the underlying fence has been signalled or not
          */
@@ -67,6 +94,7 @@ namespace skyline::gpu {
         void Wait() {
             if (signalled.test(std::memory_order_consume))
                 return;
+            Flush();
             while (device.waitForFences(fence, false, std::numeric_limits<u64>::max()) != vk::Result::eSuccess);
             if (!signalled.test_and_set(std::memory_order_release))
                 DestroyDependencies();
@@ -79,6 +107,7 @@ namespace skyline::gpu {
         bool Wait(std::chrono::duration<u64, std::nano> timeout) {
             if (signalled.test(std::memory_order_consume))
                 return true;
+            Flush();
             if (device.waitForFences(fence, false, timeout.count()) == vk::Result::eSuccess) {
                 if (!signalled.test_and_set(std::memory_order_release))
                     DestroyDependencies();
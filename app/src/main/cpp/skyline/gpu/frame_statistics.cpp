@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/trace.h>
+#include "frame_statistics.h"
+
+namespace skyline::gpu {
+    void FrameStatistics::EndFrame(i64 frametime, i64 presentLatency) {
+        FrameRecord record{
+            .frametime = frametime,
+            .cpuTime = cpuTime.exchange(0, std::memory_order_relaxed),
+            .gpuTime = gpuTime.exchange(0, std::memory_order_relaxed),
+            .presentLatency = presentLatency,
+        };
+
+        TRACE_COUNTER("gpu", "CPU Submit Time", record.cpuTime);
+        TRACE_COUNTER("gpu", "GPU Time", record.gpuTime);
+
+        std::scoped_lock lock(mutex);
+        history[historyIndex] = record;
+        historyIndex = (historyIndex + 1) % HistorySize;
+        historyCount = std::min(historyCount + 1, HistorySize);
+        sessionHistogram[std::min(static_cast<size_t>(std::max(frametime, i64{}) / SessionBucketDuration), SessionBucketCount - 1)]++;
+    }
+
+    FrameStatistics::Summary FrameStatistics::GetSummary() {
+        std::array<i64, HistorySize> frametimes, gpuTimes;
+        i64 cpuTimeSum{}, gpuTimeSum{}, presentLatencySum{};
+        size_t count;
+        {
+            std::scoped_lock lock(mutex);
+            count = historyCount;
+            for (size_t index{}; index < count; index++) {
+                auto &record{history[index]};
+                frametimes[index] = record.frametime;
+                gpuTimes[index] = record.gpuTime;
+                cpuTimeSum += record.cpuTime;
+                gpuTimeSum += record.gpuTime;
+                presentLatencySum += record.presentLatency;
+            }
+        }
+
+        if (!count)
+            return {};
+
+        auto percentile{[count](std::array<i64, HistorySize> &values, size_t percent) {
+            auto nth{values.begin() + ((count - 1) * percent) / 100};
+            std::nth_element(values.begin(), nth, values.begin() + count);
+            return *nth;
+        }};
+
+        auto toMs{[](auto value) {
+            return static_cast<float>(value) / constant::NsInMillisecond;
+        }};
+
+        auto frameCount{static_cast<i64>(count)};
+        return {
+            .frametimeP50 = toMs(percentile(frametimes, 50)),
+            .frametimeP99 = toMs(percentile(frametimes, 99)),
+            .cpuTime = toMs(cpuTimeSum / frameCount),
+            .gpuTime = toMs(gpuTimeSum / frameCount),
+            .gpuTimeP99 = toMs(percentile(gpuTimes, 99)),
+            .presentLatency = toMs(presentLatencySum / frameCount),
+        };
+    }
+
+    FrameStatistics::SessionHistogram FrameStatistics::GetSessionHistogram() {
+        std::scoped_lock lock(mutex);
+        return sessionHistogram;
+    }
+}
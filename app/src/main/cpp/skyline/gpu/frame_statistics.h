@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief Collects the CPU submission time, GPU execution time and presentation latency of every frame alongside its frame time, this is used to determine if a title is CPU or GPU bound
+     * @note CPU and GPU time is accumulated from any thread while frames are only ended by the presentation engine
+     */
+    class FrameStatistics {
+      public:
+        /**
+         * @brief A summary of the frames in the history window, all values are in milliseconds
+         */
+        struct Summary {
+            float frametimeP50; //!< The median frame time
+            float frametimeP99; //!< The 99th percentile frame time, this captures stutters which aren't visible in the average
+            float cpuTime; //!< The average time spent recording and submitting command buffers to the GPU per frame
+            float gpuTime; //!< The average time spent by the GPU executing command buffers per frame
+            float gpuTimeP99; //!< The 99th percentile GPU time
+            float presentLatency; //!< The average time from a frame being queued to it being displayed, this is 0 if it can't be measured
+        };
+
+        static constexpr size_t SessionBucketCount{128}; //!< The amount of buckets in the session histogram, frame times beyond the last bucket are counted in it
+        static constexpr i64 SessionBucketDuration{constant::NsInMillisecond / 2}; //!< The range of frame times covered by each bucket of the session histogram in nanoseconds
+
+        /**
+         * @brief A histogram of the frame times of every frame in the session, unlike the history window this retains the full distribution of frame times with a constant amount of memory
+         */
+        using SessionHistogram = std::array<u32, SessionBucketCount>;
+
+      private:
+        struct FrameRecord {
+            i64 frametime;
+            i64 cpuTime;
+            i64 gpuTime;
+            i64 presentLatency;
+        };
+
+        static constexpr size_t HistorySize{256}; //!< The amount of frames the summary is calculated over, this is a few seconds worth of frames at common refresh rates
+
+        std::atomic<i64> cpuTime{}; //!< The CPU time accumulated for the current frame in nanoseconds
+        std::atomic<i64> gpuTime{}; //!< The GPU time accumulated for the current frame in nanoseconds
+        std::mutex mutex; //!< Synchronizes access to the history
+        std::array<FrameRecord, HistorySize> history{}; //!< A circular buffer of the most recent frames
+        size_t historyIndex{}; //!< The index in the history that the next frame is written to
+        size_t historyCount{}; //!< The amount of valid frames in the history
+        SessionHistogram sessionHistogram{}; //!< This is synchronized with the history
+
+      public:
+        void AddCpuTime(i64 duration) {
+            cpuTime.fetch_add(duration, std::memory_order_relaxed);
+        }
+
+        /**
+         * @note GPU time is attributed to the frame during which the work was retired rather than when it was submitted, this lags behind by the depth of the GPU queue
+         */
+        void AddGpuTime(i64 duration) {
+            gpuTime.fetch_add(duration, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Records a frame with all CPU and GPU time accumulated since the previous frame
+         * @param frametime The time since the previous frame in nanoseconds
+         * @param presentLatency The current estimate of the presentation latency in nanoseconds, 0 if it's unknown
+         */
+        void EndFrame(i64 frametime, i64 presentLatency);
+
+        /**
+         * @return A summary of the frames in the history window
+         */
+        Summary GetSummary();
+
+        /**
+         * @return A histogram of the frame times of all frames ended so far
+         */
+        SessionHistogram GetSessionHistogram();
+    };
+}
@@ -2,26 +2,140 @@
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <gpu.h>
+#include <common/host_affinity.h>
+#include <kernel/types/KProcess.h>
 #include "command_executor.h"
 
 namespace skyline::gpu::interconnect {
-    CommandExecutor::CommandExecutor(const DeviceState &state) : gpu(*state.gpu) {}
+    CommandExecutor::CommandExecutor(const DeviceState &state) : state(state), gpu(*state.gpu), recordThread(&CommandExecutor::RecordThread, this) {}
 
-    bool CommandExecutor::CreateRenderPass(vk::Rect2D renderArea) {
-        if (renderPass && renderPass->renderArea != renderArea) {
-            nodes.emplace_back(std::in_place_type_t<node::RenderPassEndNode>());
-            renderPass = nullptr;
+    CommandExecutor::~CommandExecutor() {
+        {
+            std::scoped_lock lock(batchMutex);
+            exiting = true;
+        }
+        batchCondition.notify_all();
+        if (recordThread.joinable())
+            recordThread.join();
+
+        // Completions of submitted batches refer to the executor, we need to wait for the GPU to finish them
+        std::unique_lock lock(batchMutex);
+        batchCondition.wait(lock, [this]() { return pendingBatches == 0; });
+    }
+
+    CommandExecutor::BatchCompletion::BatchCompletion(CommandExecutor &executor, std::vector<std::function<void()>> &&callbacks) : executor(executor), callbacks(std::move(callbacks)) {}
+
+    CommandExecutor::BatchCompletion::~BatchCompletion() {
+        for (auto &callback : callbacks)
+            callback();
+
+        {
+            std::scoped_lock lock(executor.batchMutex);
+            executor.pendingBatches--;
+        }
+        executor.batchCondition.notify_all();
+    }
+
+    void CommandExecutor::QueueBatch(std::unique_ptr<Batch> batch) {
+        std::unique_lock lock(batchMutex);
+        batchCondition.wait(lock, [this]() { return pendingBatches < MaxPendingBatches; });
+        pendingBatches++;
+        batches.emplace_back(std::move(batch));
+        lock.unlock();
+        batchCondition.notify_all();
+    }
+
+    void CommandExecutor::ExecuteBatch(Batch &batch) {
+        auto completion{std::make_shared<BatchCompletion>(*this, std::move(batch.completionCallbacks))};
+
+        if (!batch.nodes.empty()) {
+            TRACE_EVENT("gpu", "CommandExecutor::Execute");
+
+            gpu.scheduler.SubmitWithCycle([&](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle) {
+                cycle->AttachObject(completion);
+
+                for (auto texture : batch.syncTextures) {
+                    std::scoped_lock lock(*texture);
+                    texture->SynchronizeHostWithBuffer(commandBuffer, cycle);
+                }
+
+                for (auto buffer : batch.syncBuffers) {
+                    std::scoped_lock lock(*buffer);
+                    buffer->SynchronizeHost(cycle);
+                }
+
+                for (auto &dependency : batch.dependencies)
+                    cycle->AttachObject(dependency);
+
+                batch.nodes.Execute(commandBuffer, cycle, gpu);
+
+                for (auto texture : batch.syncTextures) {
+                    std::scoped_lock lock(*texture);
+                    texture->SynchronizeGuestWithBuffer(commandBuffer, cycle);
+                }
+            });
+        } else if (auto previous{lastCompletion.lock()}) {
+            // A batch without any commands completes alongside the previous batch, it's chained onto its completion so the callbacks run in order
+            previous->next = completion;
+        }
+
+        lastCompletion = completion; // If there's nothing it could be attached to then the callbacks are run when the completion is destroyed on returning
+    }
+
+    void CommandExecutor::RecordThread() {
+        pthread_setname_np(pthread_self(), "GPU-Record");
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Emulation);
+        try {
+            while (true) {
+                std::unique_ptr<Batch> batch;
+                {
+                    std::unique_lock lock(batchMutex);
+                    batchCondition.wait(lock, [this]() { return !batches.empty() || exiting; });
+                    if (batches.empty())
+                        return; // We only exit once all queued batches have been executed
+                    batch = std::move(batches.front());
+                    batches.pop_front();
+                }
+
+                ExecuteBatch(*batch);
+                batch->nodes.Reset();
+                auto stream{std::move(batch->nodes)};
+                batch.reset(); // The batch holds references to textures and buffers which shouldn't outlive its recording
+
+                std::scoped_lock lock(batchMutex);
+                recycledStreams.emplace_back(std::move(stream));
+            }
+        } catch (const std::exception &e) {
+            Logger::Error(e.what());
+            state.process->Kill(false);
         }
+    }
+
+    bool CommandExecutor::CreateRenderPass(vk::Rect2D renderArea) {
+        if (renderPass && renderPass->renderArea != renderArea)
+            EndRenderPass();
 
         bool newRenderPass{renderPass == nullptr};
-        if (newRenderPass)
+        if (newRenderPass) {
             // We need to create a render pass if one doesn't already exist or the current one isn't compatible
-            renderPass = &std::get<node::RenderPassNode>(nodes.emplace_back(std::in_place_type_t<node::RenderPassNode>(), renderArea));
+            renderPass = &nodes.Emplace<node::RenderPassNode>(renderArea);
+            renderPassMarker = nodes.GetLastMarker();
+            renderPassNodeCount = nodes.size();
+        }
 
         return newRenderPass;
     }
 
-    void CommandExecutor::AddSubpass(const std::function<void(vk::raii::CommandBuffer &, const std::shared_ptr<FenceCycle> &, GPU &)> &function, vk::Rect2D renderArea, std::vector<TextureView> inputAttachments, std::vector<TextureView> colorAttachments, std::optional<TextureView> depthStencilAttachment) {
+    void CommandExecutor::EndRenderPass() {
+        // Only render passes with a single subpass are recorded into secondary command buffers as every subpass would need its own set of them otherwise
+        if (renderPass->subpassDescriptions.size() == 1 && nodes.size() - renderPassNodeCount >= SecondaryRecordThreshold)
+            renderPass->body = nodes.Detach(renderPassMarker);
+
+        nodes.Emplace<node::RenderPassEndNode>();
+        renderPass = nullptr;
+    }
+
+    bool CommandExecutor::AddSubpassAttachments(vk::Rect2D renderArea, std::vector<TextureView> &inputAttachments, std::vector<TextureView> &colorAttachments, std::optional<TextureView> &depthStencilAttachment) {
         for (const auto &attachments : {inputAttachments, colorAttachments})
             for (const auto &attachment : attachments)
                 syncTextures.emplace(attachment.backing.get());
@@ -29,22 +143,21 @@ namespace skyline::gpu::interconnect {
             syncTextures.emplace(depthStencilAttachment->backing.get());
 
         bool newRenderPass{CreateRenderPass(renderArea)};
-        renderPass->AddSubpass(inputAttachments, colorAttachments, depthStencilAttachment ? &*depthStencilAttachment : nullptr);
-        if (newRenderPass)
-            nodes.emplace_back(std::in_place_type_t<node::FunctionNode>(), function);
-        else
-            nodes.emplace_back(std::in_place_type_t<node::NextSubpassFunctionNode>(), function);
+        bool newSubpass{renderPass->AddSubpass(inputAttachments, colorAttachments, depthStencilAttachment ? &*depthStencilAttachment : nullptr)};
+        return newSubpass && !newRenderPass;
     }
 
     void CommandExecutor::AddClearColorSubpass(TextureView attachment, const vk::ClearColorValue &value) {
         bool newRenderPass{CreateRenderPass(vk::Rect2D{
             .extent = attachment.backing->dimensions,
         })};
-        renderPass->AddSubpass({}, attachment, nullptr);
+        bool newSubpass{renderPass->AddSubpass({}, attachment, nullptr)};
+        bool nextSubpass{newSubpass && !newRenderPass};
 
-        if (renderPass->ClearColorAttachment(0, value)) {
-            if (!newRenderPass)
-                nodes.emplace_back(std::in_place_type_t<node::NextSubpassNode>());
+        // The clear can only be folded into the load operation if nothing prior in the render pass has used the attachment, this can't be the case if the subpass was reused
+        if (newSubpass && renderPass->ClearColorAttachment(0, value)) {
+            if (nextSubpass)
+                nodes.Emplace<node::NextSubpassNode>();
         } else {
             auto function{[scissor = attachment.backing->dimensions, value](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &, GPU &) {
                 commandBuffer.clearAttachments(vk::ClearAttachment{
@@ -58,45 +171,79 @@ namespace skyline::gpu::interconnect {
                 });
             }};
 
-            if (newRenderPass)
-                nodes.emplace_back(std::in_place_type_t<node::FunctionNode>(), function);
+            if (nextSubpass)
+                nodes.Emplace<node::NextSubpassFunctionNode<decltype(function)>>(function);
             else
-                nodes.emplace_back(std::in_place_type_t<node::NextSubpassFunctionNode>(), function);
+                nodes.Emplace<node::FunctionNode<decltype(function)>>(function);
         }
     }
 
-    void CommandExecutor::Execute() {
+    void CommandExecutor::AttachTexture(Texture *texture) {
+        syncTextures.emplace(texture);
+    }
+
+    void CommandExecutor::AttachBuffer(const BufferView &view) {
+        syncBuffers.emplace(view.buffer.get());
+    }
+
+    void CommandExecutor::AttachDependency(std::shared_ptr<FenceCycleDependency> dependency) {
+        dependencies.emplace_back(std::move(dependency));
+    }
+
+    void CommandExecutor::AddCompletionCallback(std::function<void()> callback) {
         if (!nodes.empty()) {
-            TRACE_EVENT("gpu", "CommandExecutor::Execute");
+            completionCallbacks.emplace_back(std::move(callback));
+            return;
+        }
 
-            if (renderPass) {
-                nodes.emplace_back(std::in_place_type_t<node::RenderPassEndNode>());
-                renderPass = nullptr;
-            }
+        std::unique_lock lock(batchMutex);
+        if (pendingBatches) {
+            // The callback needs to run after the pending batches, a batch without any nodes is queued for it to preserve ordering
+            lock.unlock();
+            auto batch{std::make_unique<Batch>()};
+            batch->completionCallbacks.emplace_back(std::move(callback));
+            QueueBatch(std::move(batch));
+        } else {
+            lock.unlock();
+            callback();
+        }
+    }
 
-            gpu.scheduler.SubmitWithCycle([this](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle) {
-                for (auto texture : syncTextures)
-                    texture->SynchronizeHostWithBuffer(commandBuffer, cycle);
+    void CommandExecutor::Execute() {
+        if (!nodes.empty()) {
+            if (renderPass)
+                EndRenderPass();
 
-                using namespace node;
-                for (NodeVariant &node : nodes) {
-                    #define NODE(name) [&](name& node) { node(commandBuffer, cycle, gpu); }
-                    std::visit(VariantVisitor{
-                        NODE(FunctionNode),
-                        NODE(RenderPassNode),
-                        NODE(NextSubpassNode),
-                        NODE(NextSubpassFunctionNode),
-                        NODE(RenderPassEndNode),
-                    }, node);
-                    #undef NODE
-                }
+            TRACE_COUNTER("gpu", "Command Executor Nodes", nodes.size());
 
-                for (auto texture : syncTextures)
-                    texture->SynchronizeGuestWithBuffer(commandBuffer, cycle);
-            })->Wait();
+            auto batch{std::make_unique<Batch>()};
+            batch->nodes = std::move(nodes);
+            batch->syncTextures = std::move(syncTextures);
+            batch->syncBuffers = std::move(syncBuffers);
+            batch->dependencies = std::move(dependencies);
+            batch->completionCallbacks = std::move(completionCallbacks);
 
-            nodes.clear();
             syncTextures.clear();
+            syncBuffers.clear();
+            dependencies.clear();
+            completionCallbacks.clear();
+
+            {
+                std::scoped_lock lock(batchMutex);
+                if (!recycledStreams.empty()) {
+                    nodes = std::move(recycledStreams.back());
+                    recycledStreams.pop_back();
+                }
+            }
+
+            QueueBatch(std::move(batch));
         }
     }
+
+    void CommandExecutor::ExecuteAndWait() {
+        Execute();
+
+        std::unique_lock lock(batchMutex);
+        batchCondition.wait(lock, [this]() { return pendingBatches == 0; });
+    }
 }
@@ -3,7 +3,9 @@
 
 #pragma once
 
-#include <boost/container/stable_vector.hpp>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include <unordered_set>
 #include "command_nodes.h"
 
@@ -14,24 +16,99 @@ namespace skyline::gpu::interconnect {
      */
     class CommandExecutor {
       private:
+        /**
+         * @brief All state required to record and submit a set of commands, these are handed off from the thread adding commands to the recording thread
+         */
+        struct Batch {
+            CommandStream nodes;
+            std::unordered_set<Texture *> syncTextures;
+            std::unordered_set<Buffer *> syncBuffers;
+            std::vector<std::shared_ptr<FenceCycleDependency>> dependencies;
+            std::vector<std::function<void()>> completionCallbacks;
+        };
+
+        /**
+         * @brief Runs the completion callbacks of a batch and retires it from the pending batches when destroyed, this is attached to the fence cycle of the batch so it's destroyed as soon as the GPU has finished executing it
+         * @note This is attached to the cycle before anything else so it's destroyed after all other dependencies of the cycle, such as ones that write results back to the guest
+         */
+        struct BatchCompletion : public FenceCycleDependency {
+            CommandExecutor &executor;
+            std::vector<std::function<void()>> callbacks;
+            std::shared_ptr<BatchCompletion> next; //!< The completion of a batch without any commands queued after this one, it's destroyed after the callbacks of this batch have run to preserve their order
+
+            BatchCompletion(CommandExecutor &executor, std::vector<std::function<void()>> &&callbacks);
+
+            ~BatchCompletion();
+        };
+
+        static constexpr size_t SecondaryRecordThreshold{node::RenderPassNode::SecondaryChunkSize * 2}; //!< The minimum amount of commands in a render pass for them to be recorded into secondary command buffers across worker threads rather than inline
+        static constexpr size_t MaxPendingBatches{2}; //!< The maximum amount of batches that can be pending recording or execution before Execute() blocks, this bounds how far the thread adding commands can run ahead of the GPU
+
+        const DeviceState &state;
         GPU &gpu;
-        boost::container::stable_vector<node::NodeVariant> nodes;
+        CommandStream nodes;
         node::RenderPassNode *renderPass{};
+        CommandStream::Marker renderPassMarker; //!< A marker referencing the node of the current render pass, the commands after it are the body of the render pass
+        size_t renderPassNodeCount{}; //!< The amount of nodes in the stream after the node of the current render pass was added
         std::unordered_set<Texture*> syncTextures; //!< All textures that need to be synced prior to and after execution
+        std::unordered_set<Buffer*> syncBuffers; //!< All buffers that need to be synced prior to execution
+        std::vector<std::shared_ptr<FenceCycleDependency>> dependencies; //!< All objects which need to be kept alive till the pending commands have completed execution
+        std::vector<std::function<void()>> completionCallbacks; //!< Callbacks to run in order after the pending commands have completed execution
+
+        std::mutex batchMutex; //!< Synchronizes access to the pending batches
+        std::condition_variable batchCondition; //!< Signalled when a batch is queued, when a batch has completed or when the executor is being destroyed
+        std::deque<std::unique_ptr<Batch>> batches; //!< Batches which have been queued but haven't been picked up by the recording thread yet
+        size_t pendingBatches{}; //!< The amount of batches which have been queued but haven't completed execution on the GPU yet
+        std::vector<CommandStream> recycledStreams; //!< Command streams of completed batches which have been reset, these are reused to avoid reallocating their blocks
+        bool exiting{};
+        std::weak_ptr<BatchCompletion> lastCompletion; //!< The completion of the last batch executed by the recording thread, this is only accessed by it
+        std::thread recordThread; //!< The thread which records and submits batches in the order they were queued, it doesn't wait on their completion
+
+        /**
+         * @brief Queues a batch for the recording thread, this blocks while there are MaxPendingBatches batches pending already
+         */
+        void QueueBatch(std::unique_ptr<Batch> batch);
+
+        /**
+         * @brief Records and submits a batch, its completion callbacks are run once the GPU has completed it without blocking the recording thread
+         */
+        void ExecuteBatch(Batch &batch);
+
+        void RecordThread();
 
         /**
          * @return If a new render pass was created by the function or the current one was reused as it was compatible
          */
         bool CreateRenderPass(vk::Rect2D renderArea);
 
+        /**
+         * @brief Ends the current render pass, its body is detached to be recorded into secondary command buffers if it's large enough
+         */
+        void EndRenderPass();
+
+        /**
+         * @brief Adds a subpass with the supplied attachments to the current render pass or a new one, the last subpass is reused if its attachments are identical
+         * @return If the render pass needs to progress to the next subpass prior to any commands in the subpass
+         */
+        bool AddSubpassAttachments(vk::Rect2D renderArea, std::vector<TextureView> &inputAttachments, std::vector<TextureView> &colorAttachments, std::optional<TextureView> &depthStencilAttachment);
+
       public:
         CommandExecutor(const DeviceState &state);
 
+        ~CommandExecutor();
+
         /**
          * @brief Adds a command that needs to be executed inside a subpass configured with certain attachments
          * @note Any texture supplied to this **must** be locked by the calling thread, it should also undergo no persistent layout transitions till execution
+         * @note The command may be recorded into a secondary command buffer on a worker thread concurrently with other commands in the render pass, it must not mutate any state shared with them
          */
-        void AddSubpass(const std::function<void(vk::raii::CommandBuffer &, const std::shared_ptr<FenceCycle> &, GPU &)> &function, vk::Rect2D renderArea, std::vector<TextureView> inputAttachments = {}, std::vector<TextureView> colorAttachments = {}, std::optional<TextureView> depthStencilAttachment = {});
+        template<typename Function>
+        void AddSubpass(Function &&function, vk::Rect2D renderArea, std::vector<TextureView> inputAttachments = {}, std::vector<TextureView> colorAttachments = {}, std::optional<TextureView> depthStencilAttachment = {}) {
+            if (AddSubpassAttachments(renderArea, inputAttachments, colorAttachments, depthStencilAttachment))
+                nodes.Emplace<node::NextSubpassFunctionNode<std::decay_t<Function>>>(std::forward<Function>(function));
+            else
+                nodes.Emplace<node::FunctionNode<std::decay_t<Function>>>(std::forward<Function>(function));
+        }
 
         /**
          * @brief Adds a subpass that clears the entirety of the specified attachment with a value, it may utilize VK_ATTACHMENT_LOAD_OP_CLEAR for a more efficient clear when possible
@@ -40,8 +117,50 @@ namespace skyline::gpu::interconnect {
         void AddClearColorSubpass(TextureView attachment, const vk::ClearColorValue& value);
 
         /**
-         * @brief Execute all the nodes and submit the resulting command buffer to the GPU
+         * @brief Adds a command that needs to be executed outside the scope of a render pass such as a transfer, any render pass that's currently open is ended prior to it
+         * @note Any texture used by the command should be attached with AttachTexture and must be kept alive by the command till execution
+         */
+        template<typename Function>
+        void AddOutsideRpCommand(Function &&function) {
+            if (renderPass)
+                EndRenderPass();
+
+            nodes.Emplace<node::FunctionNode<std::decay_t<Function>>>(std::forward<Function>(function));
+        }
+
+        /**
+         * @brief Attaches a texture to the pending commands, it's synchronized with the guest prior to and after execution
+         * @note The texture must be kept alive by a reference held by one of the pending commands till execution
+         */
+        void AttachTexture(Texture *texture);
+
+        /**
+         * @brief Attaches a buffer to the pending commands, any changes to the guest buffer are uploaded to the host prior to execution
+         * @note The buffer must be kept alive by a reference held by one of the pending commands till execution
+         */
+        void AttachBuffer(const BufferView &view);
+
+        /**
+         * @brief Attaches the lifetime of an object to the GPU completing execution of the pending commands, this is used for streamed uploads
+         */
+        void AttachDependency(std::shared_ptr<FenceCycleDependency> dependency);
+
+        /**
+         * @brief Adds a callback which is run once all commands added prior to it have completed execution on the GPU, this allows results to be written back to the guest without flushing the pending commands
+         * @note The callback is run immediately if there are no pending commands or batches as all prior work has completed already, it's run on the recording thread otherwise
+         */
+        void AddCompletionCallback(std::function<void()> callback);
+
+        /**
+         * @brief Hands off all the nodes to the recording thread which records them and submits the resulting command buffer to the GPU
+         * @note This doesn't wait for the commands to be recorded or executed, any work that depends on their completion should be done in a completion callback
          */
         void Execute();
+
+        /**
+         * @brief Executes all pending commands and blocks till they and all previously queued batches have completed execution on the GPU, this includes writing back their results to guest memory
+         * @note This must be used prior to the CPU accessing guest memory in the GPU's stead as pending commands would otherwise overwrite its accesses or be read stale by it
+         */
+        void ExecuteAndWait();
     };
 }
@@ -1,18 +1,10 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <common/thread_pool.h>
 #include "command_nodes.h"
 
 namespace skyline::gpu::interconnect::node {
-    RenderPassNode::Storage::~Storage() {
-        if (device) {
-            if (framebuffer)
-                (**device).destroy(framebuffer, nullptr, *device->getDispatcher());
-            if (renderPass)
-                (**device).destroy(renderPass, nullptr, *device->getDispatcher());
-        }
-    }
-
     u32 RenderPassNode::AddAttachment(TextureView &view) {
         auto &textures{storage->textures};
         auto texture{std::find(textures.begin(), textures.end(), view.backing)};
@@ -97,7 +89,34 @@ namespace skyline::gpu::interconnect::node {
         }
     }
 
-    void RenderPassNode::AddSubpass(span<TextureView> inputAttachments, span<TextureView> colorAttachments, TextureView *depthStencilAttachment) {
+    bool RenderPassNode::MatchesLastSubpass(span<TextureView> inputAttachments, span<TextureView> colorAttachments, TextureView *depthStencilAttachment) {
+        if (subpassDescriptions.empty())
+            return false;
+
+        auto &subpassDescription{subpassDescriptions.back()};
+        if (subpassDescription.inputAttachmentCount != inputAttachments.size() || subpassDescription.colorAttachmentCount != colorAttachments.size() || (reinterpret_cast<uintptr_t>(subpassDescription.pDepthStencilAttachment) != NoDepthStencil) != (depthStencilAttachment != nullptr))
+            return false;
+
+        // All attachment references of a subpass are contiguous and in the order of input, color and depth stencil attachments
+        auto reference{attachmentReferences.begin() + static_cast<ptrdiff_t>(reinterpret_cast<uintptr_t>(subpassDescription.pInputAttachments) / sizeof(vk::AttachmentReference))};
+        auto matches{[&](TextureView &view) {
+            auto &current{*reference++};
+            return attachments[current.attachment] == view.GetView() && current.layout == view.backing->layout;
+        }};
+
+        for (auto &attachment : inputAttachments)
+            if (!matches(attachment))
+                return false;
+        for (auto &attachment : colorAttachments)
+            if (!matches(attachment))
+                return false;
+        return !depthStencilAttachment || matches(*depthStencilAttachment);
+    }
+
+    bool RenderPassNode::AddSubpass(span<TextureView> inputAttachments, span<TextureView> colorAttachments, TextureView *depthStencilAttachment) {
+        if (MatchesLastSubpass(inputAttachments, colorAttachments, depthStencilAttachment))
+            return false; // Consecutive subpasses with the same attachments are merged as there's no need for any dependency between them
+
         attachmentReferences.reserve(attachmentReferences.size() + inputAttachments.size() + colorAttachments.size() + (depthStencilAttachment ? 1 : 0));
 
         auto inputAttachmentsOffset{attachmentReferences.size() * sizeof(vk::AttachmentReference)};
@@ -135,6 +154,7 @@ namespace skyline::gpu::interconnect::node {
             .pColorAttachments = reinterpret_cast<vk::AttachmentReference *>(colorAttachmentsOffset),
             .pDepthStencilAttachment = reinterpret_cast<vk::AttachmentReference *>(depthStencilAttachment ? depthStencilAttachmentOffset : NoDepthStencil),
         });
+        return true;
     }
 
     bool RenderPassNode::ClearColorAttachment(u32 colorAttachment, const vk::ClearColorValue &value) {
@@ -161,8 +181,6 @@ namespace skyline::gpu::interconnect::node {
     }
 
     void RenderPassNode::operator()(vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu) {
-        storage->device = &gpu.vkDevice;
-
         auto preserveAttachmentIt{preserveAttachmentReferences.begin()};
         for (auto &subpassDescription : subpassDescriptions) {
             subpassDescription.pInputAttachments = RebasePointer(attachmentReferences, subpassDescription.pInputAttachments);
@@ -186,25 +204,23 @@ namespace skyline::gpu::interconnect::node {
                 texture->WaitOnFence();
         }
 
-        auto renderPass{(*gpu.vkDevice).createRenderPass(vk::RenderPassCreateInfo{
+        auto renderPass{gpu.renderPassCache.GetRenderPass(vk::RenderPassCreateInfo{
             .attachmentCount = static_cast<u32>(attachmentDescriptions.size()),
             .pAttachments = attachmentDescriptions.data(),
             .subpassCount = static_cast<u32>(subpassDescriptions.size()),
             .pSubpasses = subpassDescriptions.data(),
             .dependencyCount = static_cast<u32>(subpassDependencies.size()),
             .pDependencies = subpassDependencies.data(),
-        }, nullptr, *gpu.vkDevice.getDispatcher())};
-        storage->renderPass = renderPass;
+        })};
 
-        auto framebuffer{(*gpu.vkDevice).createFramebuffer(vk::FramebufferCreateInfo{
+        auto framebuffer{gpu.renderPassCache.GetFramebuffer(vk::FramebufferCreateInfo{
             .renderPass = renderPass,
             .attachmentCount = static_cast<u32>(attachments.size()),
             .pAttachments = attachments.data(),
             .width = renderArea.extent.width,
             .height = renderArea.extent.height,
             .layers = 1,
-        }, nullptr, *gpu.vkDevice.getDispatcher())};
-        storage->framebuffer = framebuffer;
+        })};
 
         commandBuffer.beginRenderPass(vk::RenderPassBeginInfo{
             .renderPass = renderPass,
@@ -212,7 +228,7 @@ namespace skyline::gpu::interconnect::node {
             .renderArea = renderArea,
             .clearValueCount = static_cast<u32>(clearValues.size()),
             .pClearValues = clearValues.data(),
-        }, vk::SubpassContents::eInline);
+        }, body.empty() ? vk::SubpassContents::eInline : vk::SubpassContents::eSecondaryCommandBuffers);
 
         cycle->AttachObjects(storage);
 
@@ -220,5 +236,24 @@ namespace skyline::gpu::interconnect::node {
             texture->unlock();
             texture->cycle = cycle;
         }
+
+        if (!body.empty()) {
+            // The body is split into chunks which are recorded concurrently from per-thread pools and executed in order, the render pass is ended by the following RenderPassEndNode
+            auto chunks{body.Split(SecondaryChunkSize)};
+            std::vector<vk::CommandBuffer> secondaries(chunks.size());
+            vk::CommandBufferInheritanceInfo inheritance{
+                .renderPass = renderPass,
+                .subpass = 0,
+                .framebuffer = framebuffer,
+            };
+
+            ThreadPool::Get().ParallelFor(chunks.size(), [&](size_t index) {
+                secondaries[index] = gpu.scheduler.RecordSecondary(inheritance, cycle, [&](vk::raii::CommandBuffer &secondary) {
+                    chunks[index].Execute(secondary, cycle, gpu);
+                });
+            }, ThreadPool::Priority::High);
+
+            commandBuffer.executeCommands(secondaries);
+        }
     }
 }
@@ -4,25 +4,21 @@
 #pragma once
 
 #include <gpu.h>
+#include "command_stream.h"
 
 namespace skyline::gpu::interconnect::node {
     /**
-     * @brief A generic node for simply executing a function
+     * @brief A generic node for simply executing a function, the function is stored inline in the node rather than being type-erased
      */
-    template<typename FunctionSignature = void(vk::raii::CommandBuffer &, const std::shared_ptr<FenceCycle> &, GPU &)>
-    struct FunctionNodeBase {
-        std::function<FunctionSignature> function;
+    template<typename Function>
+    struct FunctionNode {
+        Function function;
 
-        FunctionNodeBase(std::function<FunctionSignature> function) : function(function) {}
-
-        template<class... Args>
-        void operator()(Args &&... args) {
-            function(std::forward<Args>(args)...);
+        void operator()(vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu) {
+            function(commandBuffer, cycle, gpu);
         }
     };
 
-    using FunctionNode = FunctionNodeBase<>;
-
     /**
      * @brief Creates and begins a VkRenderPass alongside managing all resources bound to it and to the subpasses inside it
      */
@@ -30,14 +26,10 @@ namespace skyline::gpu::interconnect::node {
       private:
         /**
          * @brief Storage for all resources in the VkRenderPass that have their lifetimes bond to the completion fence
+         * @note The VkRenderPass and VkFramebuffer themselves are owned by the RenderPassCache
          */
         struct Storage : public FenceCycleDependency {
-            vk::raii::Device *device{};
-            vk::Framebuffer framebuffer{};
-            vk::RenderPass renderPass{};
             std::vector<std::shared_ptr<Texture>> textures;
-
-            ~Storage();
         };
 
         std::shared_ptr<Storage> storage;
@@ -65,6 +57,9 @@ namespace skyline::gpu::interconnect::node {
         vk::Rect2D renderArea;
         std::vector<vk::ClearValue> clearValues;
 
+        static constexpr size_t SecondaryChunkSize{64}; //!< The amount of commands recorded into a single secondary command buffer
+        CommandStream::Range body; //!< The commands inside the render pass if they were detached from the stream to be recorded into secondary command buffers across worker threads, they must be safe to record concurrently with each other
+
         RenderPassNode(vk::Rect2D renderArea) : storage(std::make_shared<Storage>()), renderArea(renderArea) {}
 
         /**
@@ -74,9 +69,15 @@ namespace skyline::gpu::interconnect::node {
         u32 AddAttachment(TextureView &view);
 
         /**
-         * @brief Creates a subpass with the attachments bound in the specified order
+         * @return If the attachments are identical to those of the last subpass, commands using them can be recorded into it rather than a new subpass
          */
-        void AddSubpass(span<TextureView> inputAttachments, span<TextureView> colorAttachments, TextureView *depthStencilAttachment);
+        bool MatchesLastSubpass(span<TextureView> inputAttachments, span<TextureView> colorAttachments, TextureView *depthStencilAttachment);
+
+        /**
+         * @brief Creates a subpass with the attachments bound in the specified order, the last subpass is reused if it has identical attachments
+         * @return If a new subpass was created, the render pass must progress to it unless it's the first subpass
+         */
+        bool AddSubpass(span<TextureView> inputAttachments, span<TextureView> colorAttachments, TextureView *depthStencilAttachment);
 
         /**
          * @brief Clears a color attachment in the current subpass with VK_ATTACHMENT_LOAD_OP_LOAD
@@ -101,12 +102,13 @@ namespace skyline::gpu::interconnect::node {
     /**
      * @brief A FunctionNode which progresses to the next subpass prior to calling the function
      */
-    struct NextSubpassFunctionNode : private FunctionNode {
-        using FunctionNode::FunctionNode;
+    template<typename Function>
+    struct NextSubpassFunctionNode {
+        Function function;
 
         void operator()(vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu) {
             commandBuffer.nextSubpass(vk::SubpassContents::eInline);
-            FunctionNode::operator()(commandBuffer, cycle, gpu);
+            function(commandBuffer, cycle, gpu);
         }
     };
 
@@ -118,6 +120,4 @@ namespace skyline::gpu::interconnect::node {
             commandBuffer.endRenderPass();
         }
     };
-
-    using NodeVariant = std::variant<FunctionNode, RenderPassNode, NextSubpassNode, NextSubpassFunctionNode, RenderPassEndNode>; //!< A variant encompassing all command nodes types
 }
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <gpu/fence_cycle.h>
+
+namespace skyline::gpu {
+    class GPU;
+}
+
+namespace skyline::gpu::interconnect {
+    /**
+     * @brief A linear stream of heterogeneous commands which are constructed in place in bump-allocated blocks, this avoids any heap allocations per-command and keeps commands contiguous in memory for iteration
+     * @note Any callable with the signature void(vk::raii::CommandBuffer &, const std::shared_ptr<FenceCycle> &, GPU &) can be a command, commands must not move once constructed and are never moved by the stream
+     * @note Blocks are retained across resets so a stream which is reused doesn't allocate once it has grown to the size of the largest set of commands recorded into it
+     */
+    class CommandStream {
+      private:
+        using ExecuteFunction = void (*)(void *command, vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu);
+        using DestroyFunction = void (*)(void *command);
+
+        /**
+         * @brief The header prior to every command in the stream which links it to the next command
+         */
+        struct Header {
+            ExecuteFunction execute;
+            DestroyFunction destroy; //!< The destructor of the command, this is nullptr for trivially destructible commands
+            Header *next; //!< The next command to be executed, this is nullptr for the last command in the stream or a detached range
+            Header *nextAllocated; //!< The next command in the order of construction, this includes commands in detached ranges so they can be destroyed
+        };
+
+        static constexpr size_t BlockSize{0x10000}; //!< The size of a single block of commands
+        static constexpr size_t CommandAlignment{16}; //!< The alignment of every command in a block, this is the alignment of the blocks themselves
+        static constexpr size_t PayloadOffset{util::AlignUp(sizeof(Header), CommandAlignment)}; //!< The offset of a command from its header
+
+        std::vector<std::unique_ptr<u8[]>> blocks;
+        size_t blockIndex{}; //!< The index of the block which commands are currently being allocated from
+        size_t blockOffset{}; //!< The offset in the current block at which the next command will be allocated
+        Header *head{};
+        Header *tail{};
+        Header *allocatedHead{}; //!< The first command constructed in the stream, this differs from `head` if the commands at the start were detached
+        Header *allocatedTail{}; //!< The last command constructed in the stream
+        size_t count{}; //!< The amount of commands in the stream, this doesn't include any detached commands
+
+        static void *GetPayload(Header *header) {
+            return reinterpret_cast<u8 *>(header) + PayloadOffset;
+        }
+
+        /**
+         * @return A pointer to space for a command of the supplied size in the current block or a new one
+         */
+        u8 *Allocate(size_t size) {
+            size = util::AlignUp(PayloadOffset + size, CommandAlignment);
+            if (blocks.empty() || blockOffset + size > BlockSize) {
+                if (!blocks.empty())
+                    blockIndex++;
+                if (blockIndex == blocks.size())
+                    blocks.emplace_back(new u8[BlockSize]);
+                blockOffset = 0;
+            }
+
+            auto pointer{blocks[blockIndex].get() + blockOffset};
+            blockOffset += size;
+            return pointer;
+        }
+
+      public:
+        /**
+         * @brief An opaque reference to a command in the stream which is used to detach all commands after it
+         */
+        class Marker {
+          private:
+            friend CommandStream;
+            Header *header{};
+
+          public:
+            Marker() = default;
+
+            explicit operator bool() const {
+                return header != nullptr;
+            }
+        };
+
+        /**
+         * @brief A contiguous range of commands which has been detached from the stream, it's executed separately from the stream but remains valid till the stream is reset
+         */
+        class Range {
+          private:
+            friend CommandStream;
+            Header *first{};
+            size_t count{};
+
+          public:
+            bool empty() const {
+                return count == 0;
+            }
+
+            size_t size() const {
+                return count;
+            }
+
+            /**
+             * @brief Runs all commands in the range in the order they were added
+             */
+            void Execute(vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu) const {
+                auto header{first};
+                for (size_t index{}; index < count; index++, header = header->next)
+                    header->execute(GetPayload(header), commandBuffer, cycle, gpu);
+            }
+
+            /**
+             * @brief Splits the range into consecutive subranges of at most the supplied amount of commands
+             */
+            std::vector<Range> Split(size_t maxSize) const {
+                std::vector<Range> ranges;
+                ranges.reserve((count + maxSize - 1) / maxSize);
+                auto header{first};
+                for (size_t remaining{count}; remaining;) {
+                    Range &range{ranges.emplace_back()};
+                    range.first = header;
+                    range.count = std::min(remaining, maxSize);
+                    for (size_t index{}; index < range.count; index++)
+                        header = header->next;
+                    remaining -= range.count;
+                }
+                return ranges;
+            }
+        };
+
+        CommandStream() = default;
+
+        CommandStream(const CommandStream &) = delete;
+
+        CommandStream(CommandStream &&other)
+            : blocks(std::move(other.blocks)),
+              blockIndex(std::exchange(other.blockIndex, 0)),
+              blockOffset(std::exchange(other.blockOffset, 0)),
+              head(std::exchange(other.head, nullptr)),
+              tail(std::exchange(other.tail, nullptr)),
+              allocatedHead(std::exchange(other.allocatedHead, nullptr)),
+              allocatedTail(std::exchange(other.allocatedTail, nullptr)),
+              count(std::exchange(other.count, 0)) {}
+
+        CommandStream &operator=(const CommandStream &) = delete;
+
+        CommandStream &operator=(CommandStream &&other) {
+            Reset();
+            blocks = std::move(other.blocks);
+            blockIndex = std::exchange(other.blockIndex, 0);
+            blockOffset = std::exchange(other.blockOffset, 0);
+            head = std::exchange(other.head, nullptr);
+            tail = std::exchange(other.tail, nullptr);
+            allocatedHead = std::exchange(other.allocatedHead, nullptr);
+            allocatedTail = std::exchange(other.allocatedTail, nullptr);
+            count = std::exchange(other.count, 0);
+            return *this;
+        }
+
+        ~CommandStream() {
+            Reset();
+        }
+
+        /**
+         * @brief Constructs a command at the end of the stream
+         * @return A reference to the command which remains valid till the stream is reset
+         */
+        template<typename Command, typename... Args>
+        Command &Emplace(Args &&... args) {
+            static_assert(alignof(Command) <= CommandAlignment);
+            static_assert(PayloadOffset + sizeof(Command) <= BlockSize);
+
+            auto header{new (Allocate(sizeof(Command))) Header{
+                .execute = [](void *command, vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu) {
+                    (*static_cast<Command *>(command))(commandBuffer, cycle, gpu);
+                },
+                .destroy = std::is_trivially_destructible_v<Command> ? nullptr : static_cast<DestroyFunction>([](void *command) {
+                    static_cast<Command *>(command)->~Command();
+                }),
+            }};
+            auto command{new (GetPayload(header)) Command{std::forward<Args>(args)...}};
+
+            if (tail)
+                tail->next = header;
+            else
+                head = header;
+            tail = header;
+
+            if (allocatedTail)
+                allocatedTail->nextAllocated = header;
+            else
+                allocatedHead = header;
+            allocatedTail = header;
+            count++;
+
+            return *command;
+        }
+
+        /**
+         * @return A marker referencing the last command in the stream, this must not be used after any commands including it have been detached
+         */
+        Marker GetLastMarker() const {
+            Marker marker;
+            marker.header = tail;
+            return marker;
+        }
+
+        /**
+         * @brief Detaches all commands after the command referenced by the marker from the stream, they're no longer executed by Execute and any further commands are added after the marked command
+         */
+        Range Detach(Marker marker) {
+            Range range;
+            for (auto header{marker.header->next}; header; header = header->next) {
+                if (!range.first)
+                    range.first = header;
+                range.count++;
+            }
+
+            marker.header->next = nullptr;
+            tail = marker.header;
+            count -= range.count;
+            return range;
+        }
+
+        bool empty() const {
+            return head == nullptr;
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        /**
+         * @brief Runs all commands in the order they were added
+         */
+        void Execute(vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &cycle, GPU &gpu) {
+            for (auto header{head}; header; header = header->next)
+                header->execute(GetPayload(header), commandBuffer, cycle, gpu);
+        }
+
+        /**
+         * @brief Destroys all commands in the stream while retaining its blocks for reuse
+         */
+        void Reset() {
+            for (auto header{allocatedHead}; header; header = header->nextAllocated)
+                if (header->destroy)
+                    header->destroy(GetPayload(header));
+            head = tail = nullptr;
+            allocatedHead = allocatedTail = nullptr;
+            count = 0;
+            blockIndex = 0;
+            blockOffset = 0;
+        }
+    };
+}
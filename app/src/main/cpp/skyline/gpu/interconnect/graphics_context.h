@@ -22,6 +22,15 @@ namespace skyline::gpu::interconnect {
         GPU &gpu;
         soc::gm20b::ChannelContext &channelCtx;
         gpu::interconnect::CommandExecutor &executor;
+        float renderScale; //!< The factor by which render targets are scaled relative to the guest, all guest coordinates in render target space are scaled by it
+
+        /**
+         * @return The supplied guest coordinate in render target space scaled to the host render target resolution
+         */
+        template<typename Type>
+        Type ScaleToHost(Type value) const {
+            return static_cast<Type>(static_cast<float>(value) * renderScale);
+        }
 
         struct RenderTarget {
             bool disabled{true}; //!< If this RT has been disabled and will be an unbound attachment instead
@@ -34,7 +43,10 @@ namespace skyline::gpu::interconnect {
             };
             u32 widthBytes; //!< The width in bytes for linear textures
             GuestTexture guest;
-            std::optional<TextureView> view;
+            bool dirty{true}; //!< If the guest texture may have been modified since the view was last resolved
+            std::optional<TextureView> view; //!< The view resolved for viewGuest, it's reused as long as the guest texture is unchanged
+            GuestTexture viewGuest; //!< The guest texture which the view was resolved for
+            u64 viewGeneration{}; //!< The generation of the texture manager at which the view was resolved
 
             RenderTarget() {
                 guest.dimensions = texture::Dimensions(1, 1, 1); // We want the depth to be 1 by default (It cannot be set by the application)
@@ -44,6 +56,7 @@ namespace skyline::gpu::interconnect {
         std::array<RenderTarget, maxwell3d::RenderTargetCount> renderTargets{}; //!< The target textures to render into as color attachments
         maxwell3d::RenderTargetControl renderTargetControl{};
         std::array<vk::Viewport, maxwell3d::ViewportCount> viewports;
+        u32 viewportCount{1}; //!< The amount of viewports from the first one that have been written by the guest, only these are supplied to the host
         vk::ClearColorValue clearColorValue{}; //!< The value written to a color buffer being cleared
         std::array<vk::Rect2D, maxwell3d::ViewportCount> scissors; //!< The scissors applied to viewports/render targets for masking writes during draws or clears
         constexpr static vk::Rect2D DefaultScissor{
@@ -51,9 +64,84 @@ namespace skyline::gpu::interconnect {
             .extent.width = std::numeric_limits<i32>::max(),
         }; //!< A scissor which displays the entire viewport, utilized when the viewport scissor is disabled
 
+        /**
+         * @brief A constant buffer which is bound to a pipeline stage, its contents are read from guest memory when a draw uses it
+         */
+        struct ConstantBuffer {
+            u64 iova;
+            u32 size;
+        };
+
+        std::array<std::array<std::optional<ConstantBuffer>, maxwell3d::PerStageConstantBufferCount>, maxwell3d::ShaderStageCount> boundConstantBuffers{};
 
       public:
-        GraphicsContext(GPU &gpu, soc::gm20b::ChannelContext &channelCtx, gpu::interconnect::CommandExecutor &executor) : gpu(gpu), channelCtx(channelCtx), executor(executor) {
+        /**
+         * @return The host format corresponding to the supplied guest color format, this is also used for surfaces of the 2D engine which share the same formats
+         * @note An empty format is returned for ColorFormat::None and for any format that isn't supported
+         */
+        static texture::Format GetRenderTargetFormat(maxwell3d::RenderTarget::ColorFormat format) {
+            switch (format) {
+                case maxwell3d::RenderTarget::ColorFormat::None:
+                    return {};
+                case maxwell3d::RenderTarget::ColorFormat::R32B32G32A32Float:
+                    return format::R32B32G32A32Float;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Unorm:
+                    return format::R16G16B16A16Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Snorm:
+                    return format::R16G16B16A16Snorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Sint:
+                    return format::R16G16B16A16Sint;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Uint:
+                    return format::R16G16B16A16Uint;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Float:
+                    return format::R16G16B16A16Float;
+                case maxwell3d::RenderTarget::ColorFormat::A2B10G10R10Unorm:
+                    return format::A2B10G10R10Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::R8G8B8A8Unorm:
+                    return format::R8G8B8A8Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::A8B8G8R8Srgb:
+                    return format::A8B8G8R8Srgb;
+                case maxwell3d::RenderTarget::ColorFormat::A8B8G8R8Snorm:
+                    return format::A8B8G8R8Snorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16Unorm:
+                    return format::R16G16Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16Snorm:
+                    return format::R16G16Snorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16Sint:
+                    return format::R16G16Sint;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16Uint:
+                    return format::R16G16Uint;
+                case maxwell3d::RenderTarget::ColorFormat::R16G16Float:
+                    return format::R16G16Float;
+                case maxwell3d::RenderTarget::ColorFormat::B10G11R11Float:
+                    return format::B10G11R11Float;
+                case maxwell3d::RenderTarget::ColorFormat::R32Float:
+                    return format::R32Float;
+                case maxwell3d::RenderTarget::ColorFormat::R8G8Unorm:
+                    return format::R8G8Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::R8G8Snorm:
+                    return format::R8G8Snorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16Unorm:
+                    return format::R16Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::R16Float:
+                    return format::R16Float;
+                case maxwell3d::RenderTarget::ColorFormat::R8Unorm:
+                    return format::R8Unorm;
+                case maxwell3d::RenderTarget::ColorFormat::R8Snorm:
+                    return format::R8Snorm;
+                case maxwell3d::RenderTarget::ColorFormat::R8Sint:
+                    return format::R8Sint;
+                case maxwell3d::RenderTarget::ColorFormat::R8Uint:
+                    return format::R8Uint;
+                default:
+                    return {};
+            }
+        }
+
+        /**
+         * @param renderScale The factor by which render targets are scaled relative to the guest resolution, this trades image quality for GPU throughput
+         */
+        GraphicsContext(GPU &gpu, soc::gm20b::ChannelContext &channelCtx, gpu::interconnect::CommandExecutor &executor, float renderScale) : gpu(gpu), channelCtx(channelCtx), executor(executor), renderScale(renderScale) {
             scissors.fill(DefaultScissor);
         }
 
@@ -63,14 +151,14 @@ namespace skyline::gpu::interconnect {
             auto &renderTarget{renderTargets.at(index)};
             renderTarget.gpuAddressHigh = high;
             renderTarget.guest.mappings.clear();
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetAddressLow(size_t index, u32 low) {
             auto &renderTarget{renderTargets.at(index)};
             renderTarget.gpuAddressLow = low;
             renderTarget.guest.mappings.clear();
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetWidth(size_t index, u32 value) {
@@ -79,81 +167,26 @@ namespace skyline::gpu::interconnect {
             if (renderTarget.guest.tileConfig.mode == texture::TileMode::Linear && renderTarget.guest.format)
                 value /= renderTarget.guest.format->bpb; // Width is in bytes rather than format units for linear textures
             renderTarget.guest.dimensions.width = value;
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetHeight(size_t index, u32 value) {
             auto &renderTarget{renderTargets.at(index)};
             renderTarget.guest.dimensions.height = value;
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetFormat(size_t index, maxwell3d::RenderTarget::ColorFormat format) {
             auto &renderTarget{renderTargets.at(index)};
-            renderTarget.guest.format = [&]() -> texture::Format {
-                switch (format) {
-                    case maxwell3d::RenderTarget::ColorFormat::None:
-                        return {};
-                    case maxwell3d::RenderTarget::ColorFormat::R32B32G32A32Float:
-                        return format::R32B32G32A32Float;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Unorm:
-                        return format::R16G16B16A16Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Snorm:
-                        return format::R16G16B16A16Snorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Sint:
-                        return format::R16G16B16A16Sint;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Uint:
-                        return format::R16G16B16A16Uint;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16B16A16Float:
-                        return format::R16G16B16A16Float;
-                    case maxwell3d::RenderTarget::ColorFormat::A2B10G10R10Unorm:
-                        return format::A2B10G10R10Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R8G8B8A8Unorm:
-                        return format::R8G8B8A8Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::A8B8G8R8Srgb:
-                        return format::A8B8G8R8Srgb;
-                    case maxwell3d::RenderTarget::ColorFormat::A8B8G8R8Snorm:
-                        return format::A8B8G8R8Snorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16Unorm:
-                        return format::R16G16Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16Snorm:
-                        return format::R16G16Snorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16Sint:
-                        return format::R16G16Sint;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16Uint:
-                        return format::R16G16Uint;
-                    case maxwell3d::RenderTarget::ColorFormat::R16G16Float:
-                        return format::R16G16Float;
-                    case maxwell3d::RenderTarget::ColorFormat::B10G11R11Float:
-                        return format::B10G11R11Float;
-                    case maxwell3d::RenderTarget::ColorFormat::R32Float:
-                        return format::R32Float;
-                    case maxwell3d::RenderTarget::ColorFormat::R8G8Unorm:
-                        return format::R8G8Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R8G8Snorm:
-                        return format::R8G8Snorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16Unorm:
-                        return format::R16Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R16Float:
-                        return format::R16Float;
-                    case maxwell3d::RenderTarget::ColorFormat::R8Unorm:
-                        return format::R8Unorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R8Snorm:
-                        return format::R8Snorm;
-                    case maxwell3d::RenderTarget::ColorFormat::R8Sint:
-                        return format::R8Sint;
-                    case maxwell3d::RenderTarget::ColorFormat::R8Uint:
-                        return format::R8Uint;
-                    default:
-                        throw exception("Cannot translate the supplied RT format: 0x{:X}", static_cast<u32>(format));
-                }
-            }();
+            renderTarget.guest.format = GetRenderTargetFormat(format);
+            if (!renderTarget.guest.format && format != maxwell3d::RenderTarget::ColorFormat::None)
+                throw exception("Cannot translate the supplied RT format: 0x{:X}", static_cast<u32>(format));
 
             if (renderTarget.guest.tileConfig.mode == texture::TileMode::Linear && renderTarget.guest.format)
                 renderTarget.guest.dimensions.width = renderTarget.widthBytes / renderTarget.guest.format->bpb;
 
             renderTarget.disabled = !renderTarget.guest.format;
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetTileMode(size_t index, maxwell3d::RenderTarget::TileMode mode) {
@@ -177,7 +210,7 @@ namespace skyline::gpu::interconnect {
                     .blockDepth = static_cast<u8>(1U << mode.blockDepthLog2),
                 };
             }
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetArrayMode(size_t index, maxwell3d::RenderTarget::ArrayMode mode) {
@@ -185,13 +218,13 @@ namespace skyline::gpu::interconnect {
             renderTarget.guest.layerCount = mode.layerCount;
             if (mode.volume)
                 throw exception("RT Array Volumes are not supported (with layer count = {})", mode.layerCount);
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetLayerStride(size_t index, u32 layerStrideLsr2) {
             auto &renderTarget{renderTargets.at(index)};
             renderTarget.guest.layerStride = layerStrideLsr2 << 2;
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         void SetRenderTargetBaseLayer(size_t index, u32 baseArrayLayer) {
@@ -200,14 +233,17 @@ namespace skyline::gpu::interconnect {
                 throw exception("Base array layer ({}) exceeds the range of array count ({}) (with layer count = {})", baseArrayLayer, std::numeric_limits<u16>::max(), renderTarget.guest.layerCount);
 
             renderTarget.guest.baseArrayLayer = static_cast<u16>(baseArrayLayer);
-            renderTarget.view.reset();
+            renderTarget.dirty = true;
         }
 
         const TextureView *GetRenderTarget(size_t index) {
             auto &renderTarget{renderTargets.at(index)};
             if (renderTarget.disabled)
                 return nullptr;
-            else if (renderTarget.view)
+
+            // The texture manager is only consulted when the guest texture or the texture mappings have changed since the last lookup, games tend to rebind the same render targets every frame
+            auto generation{gpu.texture.GetGeneration()};
+            if (!renderTarget.dirty && renderTarget.view && renderTarget.viewGeneration == generation)
                 return &*renderTarget.view;
 
             if (renderTarget.guest.mappings.empty()) {
@@ -217,8 +253,13 @@ namespace skyline::gpu::interconnect {
             }
 
             renderTarget.guest.type = static_cast<texture::TextureType>(renderTarget.guest.dimensions.GetType());
+            renderTarget.dirty = false;
 
-            renderTarget.view = gpu.texture.FindOrCreate(renderTarget.guest);
+            if (!renderTarget.view || renderTarget.viewGeneration != generation || !(renderTarget.viewGuest == renderTarget.guest)) {
+                renderTarget.view = gpu.texture.FindOrCreate(renderTarget.guest, renderScale);
+                renderTarget.viewGuest = renderTarget.guest;
+                renderTarget.viewGeneration = gpu.texture.GetGeneration();
+            }
             return &renderTarget.view.value();
         }
 
@@ -234,14 +275,16 @@ namespace skyline::gpu::interconnect {
          */
         void SetViewportX(size_t index, float scale, float translate) {
             auto &viewport{viewports.at(index)};
-            viewport.x = scale - translate; // Counteract the addition of the half of the width (o_x) to the host translation
-            viewport.width = scale * 2.0f; // Counteract the division of the width (p_x) by 2 for the host scale
+            viewportCount = std::max(viewportCount, static_cast<u32>(index + 1));
+            viewport.x = (scale - translate) * renderScale; // Counteract the addition of the half of the width (o_x) to the host translation
+            viewport.width = scale * 2.0f * renderScale; // Counteract the division of the width (p_x) by 2 for the host scale
         }
 
         void SetViewportY(size_t index, float scale, float translate) {
             auto &viewport{viewports.at(index)};
-            viewport.y = scale - translate; // Counteract the addition of the half of the height (p_y/2 is center) to the host translation (o_y)
-            viewport.height = scale * 2.0f; // Counteract the division of the height (p_y) by 2 for the host scale
+            viewportCount = std::max(viewportCount, static_cast<u32>(index + 1));
+            viewport.y = (scale - translate) * renderScale; // Counteract the addition of the half of the height (p_y/2 is center) to the host translation (o_y)
+            viewport.height = scale * 2.0f * renderScale; // Counteract the division of the height (p_y) by 2 for the host scale
         }
 
         void SetViewportZ(size_t index, float scale, float translate) {
@@ -250,6 +293,54 @@ namespace skyline::gpu::interconnect {
             viewport.maxDepth = scale + translate; // Counteract the subtraction of the maxDepth (p_z - o_z) by minDepth (o_z) for the host scale
         }
 
+        /* Dynamic State */
+
+        /**
+         * @brief A snapshot of the state which is recorded as dynamic state rather than being baked into pipelines, this avoids a pipeline permutation for every combination of it
+         * @note With VK_EXT_extended_dynamic_state the viewport and scissor counts are dynamic as well, otherwise pipelines are created with a single viewport and scissor
+         */
+        struct DynamicState {
+            std::array<vk::Viewport, maxwell3d::ViewportCount> viewports;
+            std::array<vk::Rect2D, maxwell3d::ViewportCount> scissors;
+            u32 viewportCount;
+            bool withCount; //!< If the viewport and scissor counts are set dynamically
+
+            static constexpr std::array<vk::DynamicState, 2> States{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+            static constexpr std::array<vk::DynamicState, 2> StatesWithCount{vk::DynamicState::eViewportWithCountEXT, vk::DynamicState::eScissorWithCountEXT};
+
+            /**
+             * @return The dynamic states that graphics pipelines must be created with, the viewport and scissor counts of the pipeline must be 0 if the counts are dynamic
+             */
+            span<const vk::DynamicState> GetStates() const {
+                return withCount ? span<const vk::DynamicState>(StatesWithCount) : span<const vk::DynamicState>(States);
+            }
+
+            /**
+             * @brief Records the state into the supplied command buffer, this must be done after binding the pipeline of every draw
+             */
+            void Record(const vk::raii::CommandBuffer &commandBuffer) const {
+                if (withCount) {
+                    commandBuffer.setViewportWithCountEXT(vk::ArrayProxy<const vk::Viewport>(viewportCount, viewports.data()));
+                    commandBuffer.setScissorWithCountEXT(vk::ArrayProxy<const vk::Rect2D>(viewportCount, scissors.data()));
+                } else {
+                    commandBuffer.setViewport(0, viewports.front());
+                    commandBuffer.setScissor(0, scissors.front());
+                }
+            }
+        };
+
+        /**
+         * @return The current dynamic state, it's copied so it can be recorded into a deferred command buffer after the context has been modified further
+         */
+        DynamicState GetDynamicState() const {
+            return DynamicState{
+                .viewports = viewports,
+                .scissors = scissors,
+                .viewportCount = gpu.supportsExtendedDynamicState ? viewportCount : 1,
+                .withCount = gpu.supportsExtendedDynamicState,
+            };
+        }
+
         /* Buffer Clears */
 
         void UpdateClearColorValue(size_t index, u32 value) {
@@ -308,23 +399,46 @@ namespace skyline::gpu::interconnect {
 
         void SetScissor(size_t index, std::optional<maxwell3d::Scissor> scissor) {
             scissors.at(index) = scissor ? vk::Rect2D{
-                .offset.x = scissor->horizontal.minimum,
-                .extent.width = static_cast<u32>(scissor->horizontal.maximum - scissor->horizontal.minimum),
-                .offset.y = scissor->vertical.minimum,
-                .extent.height = static_cast<u32>(scissor->horizontal.maximum - scissor->vertical.minimum),
-            } : DefaultScissor;
+                .offset.x = ScaleToHost<i32>(scissor->horizontal.minimum),
+                .extent.width = ScaleToHost(static_cast<u32>(scissor->horizontal.maximum - scissor->horizontal.minimum)),
+                .offset.y = ScaleToHost<i32>(scissor->vertical.minimum),
+                .extent.height = ScaleToHost(static_cast<u32>(scissor->horizontal.maximum - scissor->vertical.minimum)),
+            } : DefaultScissor; // The default scissor isn't scaled as it already covers the entire render target
         }
 
         void SetScissorHorizontal(size_t index, maxwell3d::Scissor::ScissorBounds bounds) {
             auto &scissor{scissors.at(index)};
-            scissor.offset.x = bounds.minimum;
-            scissor.extent.width = bounds.maximum - bounds.minimum;
+            scissor.offset.x = ScaleToHost<i32>(bounds.minimum);
+            scissor.extent.width = ScaleToHost<u32>(bounds.maximum - bounds.minimum);
         }
 
         void SetScissorVertical(size_t index, maxwell3d::Scissor::ScissorBounds bounds) {
             auto &scissor{scissors.at(index)};
-            scissor.offset.y = bounds.minimum;
-            scissor.extent.height = bounds.maximum - bounds.minimum;
+            scissor.offset.y = ScaleToHost<i32>(bounds.minimum);
+            scissor.extent.height = ScaleToHost<u32>(bounds.maximum - bounds.minimum);
+        }
+
+        /* Constant Buffers */
+
+        /**
+         * @brief Writes the supplied data into a constant buffer, a batch of updates is written to guest memory with a single write
+         */
+        void UpdateConstantBuffer(u64 iova, u32 size, u32 offset, span<u32> data) {
+            auto bytes{data.cast<u8>()};
+            if (static_cast<size_t>(offset) + bytes.size() > size) [[unlikely]] {
+                Logger::Warn("Constant buffer update out of bounds: 0x{:X} + 0x{:X} > 0x{:X}", offset, bytes.size(), size);
+                return;
+            }
+
+            channelCtx.asCtx->gmmu.Write(iova + offset, bytes.data(), bytes.size());
+        }
+
+        void BindConstantBuffer(size_t stage, u32 index, u64 iova, u32 size) {
+            boundConstantBuffers.at(stage).at(index) = ConstantBuffer{iova, size};
+        }
+
+        void UnbindConstantBuffer(size_t stage, u32 index) {
+            boundConstantBuffers.at(stage).at(index) = std::nullopt;
         }
     };
 }
@@ -2,6 +2,7 @@
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <gpu.h>
+#include <common/memory_accounting.h>
 #include "memory_manager.h"
 
 namespace skyline::gpu::memory {
@@ -13,9 +14,69 @@ namespace skyline::gpu::memory {
             vk::throwResultException(vk::Result(result), function);
     }
 
+    StagingRing::StagingRing(VmaAllocator vmaAllocator, vk::Buffer vkBuffer, VmaAllocation vmaAllocation, span<u8> mapping)
+        : vmaAllocator(vmaAllocator),
+          vkBuffer(vkBuffer),
+          vmaAllocation(vmaAllocation),
+          mapping(mapping) {}
+
+    StagingRing::~StagingRing() {
+        vmaDestroyBuffer(vmaAllocator, vkBuffer, vmaAllocation);
+        MemoryAccounting::Update(MemoryAccounting::Category::StagingBuffers, -static_cast<i64>(mapping.size())); // The ring's allocation is accounted in its entirety when it's allocated as a dedicated staging buffer
+    }
+
+    std::shared_ptr<StagingBuffer> StagingRing::Allocate(vk::DeviceSize size) {
+        std::scoped_lock lock(mutex);
+        auto alignedSize{util::AlignUp(size, Alignment)};
+
+        // The free space in the ring is between the head and the offset of the oldest unreclaimed region, the head and tail only coincide when the ring is empty or full
+        vk::DeviceSize capacity{mapping.size()};
+        std::optional<vk::DeviceSize> offset;
+        if (regions.empty()) {
+            head = 0;
+            if (alignedSize <= capacity)
+                offset = 0;
+        } else if (auto tail{regions.front().offset}; head > tail) {
+            if (capacity - head >= alignedSize)
+                offset = head;
+            else if (tail >= alignedSize)
+                offset = 0; // The space at the end of the ring is skipped as the region would be split otherwise, it's implicitly reclaimed with the region prior to it
+        } else if (head < tail && tail - head >= alignedSize) {
+            offset = head;
+        }
+
+        if (!offset)
+            return nullptr;
+
+        head = *offset + alignedSize;
+        if (head == capacity)
+            head = 0;
+
+        auto &region{regions.emplace_back(Region{*offset, false})};
+        return std::make_shared<StagingBuffer>(mapping.data() + *offset, size, *this, region);
+    }
+
+    void StagingRing::Release(Region &region) {
+        std::scoped_lock lock(mutex);
+        region.released = true;
+        while (!regions.empty() && regions.front().released)
+            regions.pop_front();
+    }
+
     StagingBuffer::~StagingBuffer() {
-        if (vmaAllocator && vmaAllocation && vkBuffer)
+        if (ring) {
+            ring->Release(*region);
+        } else if (vmaAllocator && vmaAllocation && vkBuffer) {
+            vmaDestroyBuffer(vmaAllocator, vkBuffer, vmaAllocation);
+            MemoryAccounting::Update(MemoryAccounting::Category::StagingBuffers, -static_cast<i64>(size()));
+        }
+    }
+
+    Buffer::~Buffer() {
+        if (vmaAllocator && vmaAllocation && vkBuffer) {
             vmaDestroyBuffer(vmaAllocator, vkBuffer, vmaAllocation);
+            MemoryAccounting::Update(MemoryAccounting::Category::Buffers, -static_cast<i64>(size()));
+        }
     }
 
     Image::~Image() {
@@ -24,6 +85,10 @@ namespace skyline::gpu::memory {
                 vmaUnmapMemory(vmaAllocator, vmaAllocation);
             vmaDestroyImage(vmaAllocator, vkImage, vmaAllocation);
         }
+        if (usage) {
+            usage->fetch_sub(size, std::memory_order_relaxed);
+            MemoryAccounting::Update(MemoryAccounting::Category::Textures, -static_cast<i64>(size));
+        }
     }
 
     u8 *Image::data() {
@@ -69,23 +134,54 @@ namespace skyline::gpu::memory {
         };
         ThrowOnFail(vmaCreateAllocator(&allocatorCreateInfo, &vmaAllocator));
         // TODO: Use VK_KHR_dedicated_allocation when available (Should be on Adreno GPUs)
+
+        auto ringBuffer{AllocateDedicatedStagingBuffer(StagingRingSize)};
+        stagingRing.emplace(std::exchange(ringBuffer->vmaAllocator, nullptr), std::exchange(ringBuffer->vkBuffer, {}), std::exchange(ringBuffer->vmaAllocation, nullptr), *ringBuffer); // The ring takes ownership of the allocation
     }
 
     MemoryManager::~MemoryManager() {
+        stagingRing.reset();
         vmaDestroyAllocator(vmaAllocator);
     }
 
     std::shared_ptr<StagingBuffer> MemoryManager::AllocateStagingBuffer(vk::DeviceSize size) {
+        if (size <= StagingRingSize / 2)
+            if (auto stagingBuffer{stagingRing->Allocate(size)})
+                return stagingBuffer;
+        return AllocateDedicatedStagingBuffer(size);
+    }
+
+    std::shared_ptr<StagingBuffer> MemoryManager::AllocateDedicatedStagingBuffer(vk::DeviceSize size) {
         vk::BufferCreateInfo bufferCreateInfo{
             .size = size,
-            .usage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+            .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst, // Staging buffers are read by compute shaders when textures are decoded on the host GPU
+        };
+        gpu.SetQueueSharing(bufferCreateInfo); // Staging buffers are used for copies on the transfer queue
+        VmaAllocationCreateInfo allocationCreateInfo{
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_ONLY,
+        };
+
+        VkBuffer buffer;
+        VmaAllocation allocation;
+        VmaAllocationInfo allocationInfo;
+        ThrowOnFail(vmaCreateBuffer(vmaAllocator, &static_cast<const VkBufferCreateInfo &>(bufferCreateInfo), &allocationCreateInfo, &buffer, &allocation, &allocationInfo));
+
+        MemoryAccounting::Update(MemoryAccounting::Category::StagingBuffers, static_cast<i64>(allocationInfo.size));
+        return std::make_shared<memory::StagingBuffer>(reinterpret_cast<u8 *>(allocationInfo.pMappedData), allocationInfo.size, vmaAllocator, buffer, allocation);
+    }
+
+    Buffer MemoryManager::AllocateBuffer(vk::DeviceSize size) {
+        vk::BufferCreateInfo bufferCreateInfo{
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
             .sharingMode = vk::SharingMode::eExclusive,
             .queueFamilyIndexCount = 1,
             .pQueueFamilyIndices = &gpu.vkQueueFamilyIndex,
         };
         VmaAllocationCreateInfo allocationCreateInfo{
             .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
-            .usage = VMA_MEMORY_USAGE_CPU_ONLY,
+            .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
         };
 
         VkBuffer buffer;
@@ -93,7 +189,8 @@ namespace skyline::gpu::memory {
         VmaAllocationInfo allocationInfo;
         ThrowOnFail(vmaCreateBuffer(vmaAllocator, &static_cast<const VkBufferCreateInfo &>(bufferCreateInfo), &allocationCreateInfo, &buffer, &allocation, &allocationInfo));
 
-        return std::make_shared<memory::StagingBuffer>(reinterpret_cast<u8 *>(allocationInfo.pMappedData), allocationInfo.size, vmaAllocator, buffer, allocation);
+        MemoryAccounting::Update(MemoryAccounting::Category::Buffers, static_cast<i64>(allocationInfo.size));
+        return Buffer(reinterpret_cast<u8 *>(allocationInfo.pMappedData), allocationInfo.size, vmaAllocator, buffer, allocation);
     }
 
     Image MemoryManager::AllocateImage(const vk::ImageCreateInfo &createInfo) {
@@ -106,7 +203,9 @@ namespace skyline::gpu::memory {
         VmaAllocationInfo allocationInfo;
         ThrowOnFail(vmaCreateImage(vmaAllocator, &static_cast<const VkImageCreateInfo &>(createInfo), &allocationCreateInfo, &image, &allocation, &allocationInfo));
 
-        return Image(vmaAllocator, image, allocation);
+        imageMemoryUsage.fetch_add(allocationInfo.size, std::memory_order_relaxed);
+        MemoryAccounting::Update(MemoryAccounting::Category::Textures, static_cast<i64>(allocationInfo.size));
+        return Image(vmaAllocator, image, allocation, imageMemoryUsage, allocationInfo.size);
     }
 
     Image MemoryManager::AllocateMappedImage(const vk::ImageCreateInfo &createInfo) {
@@ -120,6 +219,126 @@ namespace skyline::gpu::memory {
         VmaAllocationInfo allocationInfo;
         ThrowOnFail(vmaCreateImage(vmaAllocator, &static_cast<const VkImageCreateInfo &>(createInfo), &allocationCreateInfo, &image, &allocation, &allocationInfo));
 
-        return Image(vmaAllocator, image, allocation);
+        imageMemoryUsage.fetch_add(allocationInfo.size, std::memory_order_relaxed);
+        MemoryAccounting::Update(MemoryAccounting::Category::Textures, static_cast<i64>(allocationInfo.size));
+        return Image(vmaAllocator, image, allocation, imageMemoryUsage, allocationInfo.size);
+    }
+
+    HardwareBufferImage MemoryManager::AllocateHardwareBufferImage(const vk::ImageCreateInfo &createInfo) {
+        if (createInfo.format != vk::Format::eR8G8B8A8Unorm || createInfo.tiling != vk::ImageTiling::eOptimal || createInfo.arrayLayers != 1)
+            throw exception("Cannot allocate an AHardwareBuffer-backed image with format '{}', tiling '{}' and {} layers", vk::to_string(createInfo.format), vk::to_string(createInfo.tiling), createInfo.arrayLayers);
+
+        AHardwareBuffer_Desc description{
+            .width = createInfo.extent.width,
+            .height = createInfo.extent.height,
+            .layers = 1,
+            .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+            .usage = AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT | AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_COMPOSER_OVERLAY,
+        };
+        AHardwareBuffer *rawBuffer{};
+        if (int result{AHardwareBuffer_allocate(&description, &rawBuffer)})
+            throw exception("Allocating an AHardwareBuffer ({}x{}) failed with {}", description.width, description.height, result);
+        std::unique_ptr<AHardwareBuffer, decltype(&AHardwareBuffer_release)> buffer{rawBuffer, &AHardwareBuffer_release}; // The buffer must be released if importing it fails
+
+        auto properties{gpu.vkDevice.getAndroidHardwareBufferPropertiesANDROID(*buffer)};
+
+        vk::StructureChain<vk::ImageCreateInfo, vk::ExternalMemoryImageCreateInfo> imageCreateInfo{createInfo, vk::ExternalMemoryImageCreateInfo{
+            .handleTypes = vk::ExternalMemoryHandleTypeFlagBits::eAndroidHardwareBufferANDROID,
+        }};
+        vk::raii::Image image(gpu.vkDevice, imageCreateInfo.get<vk::ImageCreateInfo>());
+
+        // Memory imported from an AHardwareBuffer must be a dedicated allocation for the image using it
+        vk::StructureChain<vk::MemoryAllocateInfo, vk::MemoryDedicatedAllocateInfo, vk::ImportAndroidHardwareBufferInfoANDROID> allocateInfo{
+            vk::MemoryAllocateInfo{
+                .allocationSize = properties.allocationSize,
+                .memoryTypeIndex = static_cast<u32>(std::countr_zero(properties.memoryTypeBits)),
+            },
+            vk::MemoryDedicatedAllocateInfo{
+                .image = *image,
+            },
+            vk::ImportAndroidHardwareBufferInfoANDROID{
+                .buffer = buffer.get(),
+            },
+        };
+        vk::raii::DeviceMemory memory(gpu.vkDevice, allocateInfo.get<vk::MemoryAllocateInfo>());
+        image.bindMemory(*memory, 0);
+
+        return HardwareBufferImage(buffer.release(), std::move(memory), std::move(image));
+    }
+
+    std::optional<ImportedBuffer> MemoryManager::ImportBuffer(span<u8> memory) {
+        vk::MemoryHostPointerPropertiesEXT hostPointerProperties;
+        if ((*gpu.vkDevice).getMemoryHostPointerPropertiesEXT(vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT, memory.data(), &hostPointerProperties, *gpu.vkDevice.getDispatcher()) != vk::Result::eSuccess)
+            return std::nullopt;
+
+        vk::StructureChain<vk::BufferCreateInfo, vk::ExternalMemoryBufferCreateInfo> bufferCreateInfo{
+            vk::BufferCreateInfo{
+                .size = memory.size(),
+                .usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = 1,
+                .pQueueFamilyIndices = &gpu.vkQueueFamilyIndex,
+            },
+            vk::ExternalMemoryBufferCreateInfo{
+                .handleTypes = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT,
+            },
+        };
+        vk::raii::Buffer buffer(gpu.vkDevice, bufferCreateInfo.get<vk::BufferCreateInfo>());
+
+        // The memory type must be host-coherent as the guest writes to the memory at any point without flushing it
+        const VkPhysicalDeviceMemoryProperties *memoryProperties;
+        vmaGetMemoryProperties(vmaAllocator, &memoryProperties);
+        u32 memoryTypeBits{hostPointerProperties.memoryTypeBits & buffer.getMemoryRequirements().memoryTypeBits};
+        std::optional<u32> memoryTypeIndex;
+        for (u32 index{}; index < memoryProperties->memoryTypeCount; index++) {
+            if ((memoryTypeBits & (1U << index)) && (memoryProperties->memoryTypes[index].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                memoryTypeIndex = index;
+                break;
+            }
+        }
+        if (!memoryTypeIndex)
+            return std::nullopt;
+
+        vk::StructureChain<vk::MemoryAllocateInfo, vk::ImportMemoryHostPointerInfoEXT> allocateInfo{
+            vk::MemoryAllocateInfo{
+                .allocationSize = memory.size(),
+                .memoryTypeIndex = *memoryTypeIndex,
+            },
+            vk::ImportMemoryHostPointerInfoEXT{
+                .handleType = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT,
+                .pHostPointer = memory.data(),
+            },
+        };
+        try {
+            // Drivers may reject importing the host pointer even with a supported memory type, such as for memory which isn't backed by anonymous pages
+            vk::raii::DeviceMemory deviceMemory(gpu.vkDevice, allocateInfo.get<vk::MemoryAllocateInfo>());
+            buffer.bindMemory(*deviceMemory, 0);
+            return ImportedBuffer{std::move(deviceMemory), std::move(buffer)};
+        } catch (const vk::SystemError &e) {
+            Logger::Debug("Failed to import host memory at 0x{:X} (0x{:X} bytes): {}", reinterpret_cast<uintptr_t>(memory.data()), memory.size(), e.what());
+            return std::nullopt;
+        }
+    }
+
+    vk::DeviceSize MemoryManager::GetDeviceLocalHeapSize() const {
+        const VkPhysicalDeviceMemoryProperties *memoryProperties;
+        vmaGetMemoryProperties(vmaAllocator, &memoryProperties);
+
+        vk::DeviceSize heapSize{};
+        for (u32 index{}; index < memoryProperties->memoryHeapCount; index++)
+            if (memoryProperties->memoryHeaps[index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                heapSize = std::max(heapSize, memoryProperties->memoryHeaps[index].size);
+        return heapSize;
+    }
+
+    bool MemoryManager::IsUnifiedMemory() const {
+        const VkPhysicalDeviceMemoryProperties *memoryProperties;
+        vmaGetMemoryProperties(vmaAllocator, &memoryProperties);
+
+        constexpr VkMemoryPropertyFlags UnifiedFlags{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        for (u32 index{}; index < memoryProperties->memoryTypeCount; index++)
+            if ((memoryProperties->memoryTypes[index].propertyFlags & UnifiedFlags) == UnifiedFlags)
+                return true;
+        return false;
     }
 }
@@ -3,18 +3,71 @@
 
 #pragma once
 
+#include <deque>
+#include <android/hardware_buffer.h>
 #include <vk_mem_alloc.h>
 #include "fence_cycle.h"
 
 namespace skyline::gpu::memory {
+    struct StagingBuffer;
+
+    /**
+     * @brief A persistently mapped buffer which staging buffers are suballocated from in FIFO order, space is reclaimed in allocation order once the staging buffers using it have been destroyed
+     * @note Staging buffers are generally attached to the fence cycle of the submission that uses them, their space is reclaimed when the cycle is signalled
+     */
+    class StagingRing {
+      public:
+        /**
+         * @brief A range of the ring which has been handed out to a staging buffer
+         */
+        struct Region {
+            vk::DeviceSize offset;
+            bool released; //!< If the staging buffer owning the region has been destroyed, the region is reclaimed once all regions allocated prior to it are released as well
+        };
+
+        static constexpr vk::DeviceSize Alignment{0x100}; //!< The alignment of every region, this satisfies the buffer offset requirements of copies for any format
+
+      private:
+        std::mutex mutex; //!< Synchronizes access to the regions
+        std::deque<Region> regions; //!< All regions which haven't been reclaimed yet in allocation order
+        vk::DeviceSize head{}; //!< The offset at which the next region will be allocated
+
+      public:
+        VmaAllocator vmaAllocator;
+        VmaAllocation vmaAllocation;
+        vk::Buffer vkBuffer;
+        span<u8> mapping;
+
+        StagingRing(VmaAllocator vmaAllocator, vk::Buffer vkBuffer, VmaAllocation vmaAllocation, span<u8> mapping);
+
+        StagingRing(const StagingRing &) = delete;
+
+        StagingRing &operator=(const StagingRing &) = delete;
+
+        ~StagingRing();
+
+        /**
+         * @return A staging buffer suballocated from the ring or nullptr if there isn't enough free space in it
+         */
+        std::shared_ptr<StagingBuffer> Allocate(vk::DeviceSize size);
+
+        /**
+         * @brief Marks a region as released and reclaims all released regions at the tail of the ring
+         */
+        void Release(Region &region);
+    };
+
     /**
-     * @brief A view into a CPU mapping of a Vulkan buffer
+     * @brief A view into a CPU mapping of a Vulkan buffer, this is either suballocated from a StagingRing or is a dedicated allocation
      * @note The mapping **should not** be used after the lifetime of the object has ended
      */
     struct StagingBuffer : public span<u8>, public FenceCycleDependency {
         VmaAllocator vmaAllocator;
         VmaAllocation vmaAllocation;
         vk::Buffer vkBuffer;
+        vk::DeviceSize offset{}; //!< The offset of the staging buffer in the Vulkan buffer, this is only non-zero for staging buffers suballocated from a ring
+        StagingRing *ring{}; //!< The ring that the staging buffer was suballocated from, if any
+        StagingRing::Region *region{}; //!< The region of the ring that the staging buffer occupies
 
         constexpr StagingBuffer(u8 *pointer, size_t size, VmaAllocator vmaAllocator, vk::Buffer vkBuffer, VmaAllocation vmaAllocation)
             : vmaAllocator(vmaAllocator),
@@ -22,12 +75,24 @@ namespace skyline::gpu::memory {
               vmaAllocation(vmaAllocation),
               span(pointer, size) {}
 
+        constexpr StagingBuffer(u8 *pointer, size_t size, StagingRing &ring, StagingRing::Region &region)
+            : vmaAllocator(ring.vmaAllocator),
+              vmaAllocation(ring.vmaAllocation),
+              vkBuffer(ring.vkBuffer),
+              offset(region.offset),
+              ring(&ring),
+              region(&region),
+              span(pointer, size) {}
+
         StagingBuffer(const StagingBuffer &) = delete;
 
         constexpr StagingBuffer(StagingBuffer &&other)
             : vmaAllocator(std::exchange(other.vmaAllocator, nullptr)),
               vmaAllocation(std::exchange(other.vmaAllocation, nullptr)),
-              vkBuffer(std::exchange(other.vkBuffer, {})) {}
+              vkBuffer(std::exchange(other.vkBuffer, {})),
+              offset(std::exchange(other.offset, 0)),
+              ring(std::exchange(other.ring, nullptr)),
+              region(std::exchange(other.region, nullptr)) {}
 
         StagingBuffer &operator=(const StagingBuffer &) = delete;
 
@@ -36,6 +101,35 @@ namespace skyline::gpu::memory {
         ~StagingBuffer();
     };
 
+    /**
+     * @brief A Vulkan buffer which VMA allocates and manages the backing memory for, it's persistently mapped on the CPU for its entire lifetime
+     */
+    struct Buffer : public span<u8> {
+        VmaAllocator vmaAllocator;
+        VmaAllocation vmaAllocation;
+        vk::Buffer vkBuffer;
+
+        constexpr Buffer(u8 *pointer, size_t size, VmaAllocator vmaAllocator, vk::Buffer vkBuffer, VmaAllocation vmaAllocation)
+            : vmaAllocator(vmaAllocator),
+              vkBuffer(vkBuffer),
+              vmaAllocation(vmaAllocation),
+              span(pointer, size) {}
+
+        Buffer(const Buffer &) = delete;
+
+        constexpr Buffer(Buffer &&other)
+            : vmaAllocator(std::exchange(other.vmaAllocator, nullptr)),
+              vmaAllocation(std::exchange(other.vmaAllocation, nullptr)),
+              vkBuffer(std::exchange(other.vkBuffer, {})),
+              span(other) {}
+
+        Buffer &operator=(const Buffer &) = delete;
+
+        Buffer &operator=(Buffer &&) = default;
+
+        ~Buffer();
+    };
+
     /**
      * @brief A Vulkan image which VMA allocates and manages the backing memory for
      * @note Any images created with VMA_ALLOCATION_CREATE_MAPPED_BIT must not be utilized with this since it'll unconditionally unmap when a pointer is present which is illegal when an image was created with that flag as unmapping will be automatically performed on image deletion
@@ -43,6 +137,8 @@ namespace skyline::gpu::memory {
     struct Image {
       private:
         u8 *pointer{};
+        std::atomic<vk::DeviceSize> *usage{}; //!< The counter of the MemoryManager which this image's allocation is accounted in, if any
+        vk::DeviceSize size{}; //!< The size of the image's allocation in bytes
 
       public:
         VmaAllocator vmaAllocator;
@@ -54,6 +150,13 @@ namespace skyline::gpu::memory {
               vkImage(vkImage),
               vmaAllocation(vmaAllocation) {}
 
+        constexpr Image(VmaAllocator vmaAllocator, vk::Image vkImage, VmaAllocation vmaAllocation, std::atomic<vk::DeviceSize> &usage, vk::DeviceSize size)
+            : usage(&usage),
+              size(size),
+              vmaAllocator(vmaAllocator),
+              vkImage(vkImage),
+              vmaAllocation(vmaAllocation) {}
+
         constexpr Image(u8 *pointer, VmaAllocator vmaAllocator, vk::Image vkImage, VmaAllocation vmaAllocation)
             : pointer(pointer),
               vmaAllocator(vmaAllocator),
@@ -64,6 +167,8 @@ namespace skyline::gpu::memory {
 
         constexpr Image(Image &&other)
             : pointer(std::exchange(other.pointer, nullptr)),
+              usage(std::exchange(other.usage, nullptr)),
+              size(std::exchange(other.size, 0)),
               vmaAllocator(std::exchange(other.vmaAllocator, nullptr)),
               vmaAllocation(std::exchange(other.vmaAllocation, nullptr)),
               vkImage(std::exchange(other.vkImage, {})) {}
@@ -81,13 +186,62 @@ namespace skyline::gpu::memory {
         u8 *data();
     };
 
+    /**
+     * @brief A Vulkan image which is backed by an AHardwareBuffer, it can be handed to the Android compositor directly without being copied into a swapchain image
+     */
+    struct HardwareBufferImage {
+        AHardwareBuffer *buffer{};
+        vk::raii::DeviceMemory vkMemory; //!< The imported memory of the AHardwareBuffer, this must outlive the image bound to it
+        vk::raii::Image vkImage;
+
+        HardwareBufferImage(AHardwareBuffer *buffer, vk::raii::DeviceMemory &&vkMemory, vk::raii::Image &&vkImage)
+            : buffer(buffer),
+              vkMemory(std::move(vkMemory)),
+              vkImage(std::move(vkImage)) {}
+
+        HardwareBufferImage(const HardwareBufferImage &) = delete;
+
+        HardwareBufferImage(HardwareBufferImage &&other)
+            : buffer(std::exchange(other.buffer, nullptr)),
+              vkMemory(std::move(other.vkMemory)),
+              vkImage(std::move(other.vkImage)) {}
+
+        HardwareBufferImage &operator=(const HardwareBufferImage &) = delete;
+
+        HardwareBufferImage &operator=(HardwareBufferImage &&other) {
+            if (buffer)
+                AHardwareBuffer_release(buffer);
+            buffer = std::exchange(other.buffer, nullptr);
+            vkImage = std::move(other.vkImage);
+            vkMemory = std::move(other.vkMemory);
+            return *this;
+        }
+
+        ~HardwareBufferImage() {
+            if (buffer)
+                AHardwareBuffer_release(buffer);
+        }
+    };
+
+    /**
+     * @brief A Vulkan buffer which is backed by imported host memory rather than memory allocated by the driver, the GPU accesses the host memory directly
+     */
+    struct ImportedBuffer {
+        vk::raii::DeviceMemory vkMemory; //!< The imported host memory, this must outlive the buffer bound to it
+        vk::raii::Buffer vkBuffer;
+    };
+
     /**
      * @brief An abstraction over memory operations done in Vulkan, it's used for all allocations on the host GPU
      */
     class MemoryManager {
       private:
+        static constexpr vk::DeviceSize StagingRingSize{32 * 1024 * 1024}; //!< The size of the staging ring, any staging buffers larger than half of it are always dedicated allocations
+
         const GPU &gpu;
         VmaAllocator vmaAllocator{VK_NULL_HANDLE};
+        std::optional<StagingRing> stagingRing; //!< The ring that transient staging buffers are suballocated from
+        std::atomic<vk::DeviceSize> imageMemoryUsage{}; //!< The total size of all live images allocated by the manager in bytes
 
       public:
         MemoryManager(const GPU &gpu);
@@ -95,10 +249,21 @@ namespace skyline::gpu::memory {
         ~MemoryManager();
 
         /**
-         * @brief Creates a buffer which is optimized for staging (Transfer Source)
+         * @brief Creates a buffer which is optimized for staging (Transfer Source), it's suballocated from the staging ring when possible
+         * @note The buffer should be short-lived such as by only being attached to the fence cycle it's used in, the ring can't reclaim any space allocated after it till it's destroyed
          */
         std::shared_ptr<StagingBuffer> AllocateStagingBuffer(vk::DeviceSize size);
 
+        /**
+         * @brief Creates a buffer which is optimized for staging (Transfer Source) with a dedicated allocation, this should be used for any staging buffers which may be retained for an indeterminate amount of time
+         */
+        std::shared_ptr<StagingBuffer> AllocateDedicatedStagingBuffer(vk::DeviceSize size);
+
+        /**
+         * @brief Creates a buffer which is mapped on the CPU and can be used for any vertex, index, uniform or storage buffer binding
+         */
+        Buffer AllocateBuffer(vk::DeviceSize size);
+
         /**
          * @brief Creates an image which is allocated and deallocated using RAII
          */
@@ -108,5 +273,35 @@ namespace skyline::gpu::memory {
          * @brief Creates an image which is allocated and deallocated using RAII and is optimal for being mapped on the CPU
          */
         Image AllocateMappedImage(const vk::ImageCreateInfo &createInfo);
+
+        /**
+         * @brief Creates an image which is backed by a newly allocated AHardwareBuffer that can be composited directly
+         * @note Only single-layer R8G8B8A8Unorm images with optimal tiling are supported, GPU::supportsHardwareBuffers must be set
+         */
+        HardwareBufferImage AllocateHardwareBufferImage(const vk::ImageCreateInfo &createInfo);
+
+        /**
+         * @brief Creates a buffer which can be used for any vertex, index, uniform or storage buffer binding backed by the supplied host memory with VK_EXT_external_memory_host
+         * @note The address and size of the memory must be aligned to GPU::hostImportAlignment, the memory must remain mapped for the lifetime of the buffer
+         * @return The imported buffer or std::nullopt if the memory can't be imported as host-coherent memory
+         */
+        std::optional<ImportedBuffer> ImportBuffer(span<u8> memory);
+
+        /**
+         * @return The total size of all images allocated by the manager which are still alive in bytes
+         */
+        vk::DeviceSize GetImageMemoryUsage() const {
+            return imageMemoryUsage.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return The size of the largest device-local memory heap in bytes
+         */
+        vk::DeviceSize GetDeviceLocalHeapSize() const;
+
+        /**
+         * @return If the device has memory which is device-local, host-visible and host-coherent as is the case on UMA GPUs, mapped images can only be allocated if so
+         */
+        bool IsUnifiedMemory() const;
     };
 }
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/host_affinity.h>
+#include <vfs/os_filesystem.h>
+#include <gpu.h>
+#include "pipeline_cache.h"
+
+namespace skyline::gpu {
+    static u64 HashData(const std::vector<u8> &data) {
+        return util::Hash(std::string_view(reinterpret_cast<const char *>(data.data()), data.size()));
+    }
+
+    PipelineCache::PipelineCache(GPU &gpu) : gpu(gpu), vkPipelineCache(gpu.vkDevice, vk::PipelineCacheCreateInfo{}) {}
+
+    PipelineCache::~PipelineCache() {
+        {
+            std::scoped_lock lock(mutex);
+            exiting = true;
+        }
+        condition.notify_all();
+        if (saveThread.joinable())
+            saveThread.join();
+        Save();
+    }
+
+    PipelineCache::CacheHeader PipelineCache::GetHeader() {
+        auto properties{gpu.vkPhysicalDevice.getProperties()};
+        CacheHeader header{
+            .vendorId = properties.vendorID,
+            .deviceId = properties.deviceID,
+            .driverVersion = properties.driverVersion,
+        };
+        std::copy(std::begin(properties.pipelineCacheUUID), std::end(properties.pipelineCacheUUID), header.pipelineCacheUuid.begin());
+        return header;
+    }
+
+    void PipelineCache::Open(const std::string &path, u64 titleId) {
+        std::scoped_lock lock(mutex);
+        try {
+            cacheFileSystem = std::make_shared<vfs::OsFileSystem>(path);
+        } catch (const std::exception &e) {
+            Logger::Warn("Pipeline cache is unavailable: {}", e.what());
+            return;
+        }
+        name = fmt::format("{:016X}.cache", titleId);
+
+        try {
+            if (cacheFileSystem->FileExists(name)) {
+                auto backing{cacheFileSystem->OpenFile(name)};
+                auto header{backing->Read<CacheHeader>()};
+                auto expected{GetHeader()};
+                if (header.magic != expected.magic || header.vendorId != expected.vendorId || header.deviceId != expected.deviceId || header.driverVersion != expected.driverVersion || header.pipelineCacheUuid != expected.pipelineCacheUuid || header.dataSize != backing->size - sizeof(CacheHeader)) {
+                    Logger::Info("Discarding pipeline cache from a different device or driver: {}", name);
+                } else {
+                    std::vector<u8> data(header.dataSize);
+                    backing->Read(span(data), sizeof(CacheHeader));
+                    if (HashData(data) != header.dataHash)
+                        throw exception("Hash mismatch");
+
+                    vkPipelineCache = vk::raii::PipelineCache(gpu.vkDevice, vk::PipelineCacheCreateInfo{
+                        .initialDataSize = data.size(),
+                        .pInitialData = data.data(),
+                    });
+                    savedSize = data.size();
+                    Logger::Info("Loaded pipeline cache {} (0x{:X} bytes)", name, data.size());
+                }
+            }
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to read pipeline cache {}: {}", name, e.what());
+        }
+
+        saveThread = std::thread(&PipelineCache::SaveThread, this);
+    }
+
+    void PipelineCache::Save() {
+        std::scoped_lock lock(mutex);
+        if (!cacheFileSystem)
+            return;
+
+        try {
+            auto data{vkPipelineCache.getData()};
+            if (data.size() == savedSize)
+                return; // Pipeline caches only grow as pipelines are added so an unchanged size implies unchanged contents
+
+            auto header{GetHeader()};
+            header.dataSize = data.size();
+            header.dataHash = HashData(data);
+
+            std::vector<u8> buffer(sizeof(CacheHeader) + data.size());
+            std::memcpy(buffer.data(), &header, sizeof(CacheHeader));
+            std::memcpy(buffer.data() + sizeof(CacheHeader), data.data(), data.size());
+
+            if (!cacheFileSystem->CreateFile(name, buffer.size()))
+                throw exception("Failed to create file");
+            cacheFileSystem->OpenFile(name, {false, true, false})->Write(buffer);
+            savedSize = data.size();
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to write pipeline cache {}: {}", name, e.what());
+        }
+    }
+
+    void PipelineCache::SaveThread() {
+        pthread_setname_np(pthread_self(), "GPU-PipeCache");
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Background);
+        std::unique_lock lock(mutex);
+        while (!condition.wait_for(lock, SaveInterval, [this]() { return exiting; })) {
+            lock.unlock();
+            Save();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <thread>
+#include <vulkan/vulkan_raii.hpp>
+#include <vfs/filesystem.h>
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief A Vulkan pipeline cache which is persisted to disk for every title, this avoids compiling pipelines which have been compiled in a prior session again
+     * @note The cache is empty till Open is called as the title isn't known when the GPU is created
+     */
+    class PipelineCache {
+      private:
+        /**
+         * @brief The header of a cache file, it's followed by the data retrieved from the Vulkan pipeline cache
+         * @note Some drivers don't validate cache data correctly so the cache is discarded on any change to the device or driver rather than relying on the driver to reject it
+         */
+        struct CacheHeader {
+            u64 magic{util::MakeMagic<u64>("SKYPLCAC")};
+            u32 vendorId;
+            u32 deviceId;
+            u32 driverVersion;
+            std::array<u8, VK_UUID_SIZE> pipelineCacheUuid;
+            u64 dataSize; //!< The size of the cache data following the header
+            u64 dataHash; //!< A hash of the cache data, this catches any truncated or corrupted files
+        };
+
+        static constexpr std::chrono::seconds SaveInterval{60}; //!< The interval at which the cache is written to disk if it has changed, this limits the loss of cached pipelines if the process is killed
+
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes saving the cache
+        std::shared_ptr<vfs::FileSystem> cacheFileSystem; //!< The filesystem containing the cache file, this is nullptr if the cache hasn't been opened or is unavailable
+        std::string name; //!< The name of the cache file in the filesystem
+        size_t savedSize{}; //!< The size of the cache data when it was last loaded or saved, the cache isn't written if it's unchanged
+        std::condition_variable condition; //!< Signalled when the cache is being destroyed
+        bool exiting{};
+        std::thread saveThread; //!< A thread which periodically writes the cache to disk
+
+        CacheHeader GetHeader();
+
+        void SaveThread();
+
+      public:
+        vk::raii::PipelineCache vkPipelineCache;
+
+        PipelineCache(GPU &gpu);
+
+        ~PipelineCache();
+
+        /**
+         * @brief Loads a previously saved cache for a title if it's still valid and starts periodically saving it
+         * @param path The path to the directory in which caches are stored
+         * @param titleId The ID of the title, titles without an ID all share a single cache
+         * @note This must be called prior to any pipelines being created as it replaces the Vulkan pipeline cache
+         */
+        void Open(const std::string &path, u64 titleId);
+
+        /**
+         * @brief Writes the cache to disk if it has been opened and has changed since it was last written
+         */
+        void Save();
+    };
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <common/trace.h>
+#include "pipeline_compiler.h"
+
+namespace skyline::gpu {
+    void CompiledPipeline::Complete(std::optional<vk::raii::Pipeline> &&pPipeline, std::exception_ptr pException) {
+        {
+            std::scoped_lock lock(mutex);
+            pipeline = std::move(pPipeline);
+            exception = std::move(pException);
+            ready.store(true, std::memory_order_release);
+        }
+        condition.notify_all();
+    }
+
+    void CompiledPipeline::Wait() {
+        if (Ready())
+            return;
+
+        TRACE_EVENT("gpu", "CompiledPipeline::Wait");
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this]() { return Ready(); });
+    }
+
+    vk::Pipeline CompiledPipeline::Get() {
+        Wait();
+        if (exception)
+            std::rethrow_exception(exception);
+        return **pipeline;
+    }
+
+    PipelineCompiler::PipelineCompiler(GPU &gpu) : gpu(gpu) {
+        // Compilation is spread over a fraction of the cores as the remaining cores are needed by guest threads and the GPU threads
+        auto workerCount{std::clamp(std::thread::hardware_concurrency() / 4, 1U, 4U)};
+        workers.reserve(workerCount);
+        for (size_t index{}; index < workerCount; index++)
+            workers.emplace_back(&PipelineCompiler::Worker, this, index);
+    }
+
+    PipelineCompiler::~PipelineCompiler() {
+        {
+            std::scoped_lock lock(mutex);
+            exiting = true;
+        }
+        condition.notify_all();
+        for (auto &worker : workers)
+            if (worker.joinable())
+                worker.join();
+    }
+
+    void PipelineCompiler::Worker(size_t index) {
+        pthread_setname_np(pthread_self(), fmt::format("GPU-Compile{}", index).c_str());
+        std::unique_lock lock(mutex);
+        while (true) {
+            condition.wait(lock, [this]() { return !jobs.empty() || exiting; });
+            if (jobs.empty())
+                return; // We only exit once all queued jobs have been compiled as there may be threads waiting on them
+
+            auto job{std::move(jobs.front())};
+            jobs.pop_front();
+            TRACE_COUNTER("gpu", perfetto::CounterTrack("Pipeline Compile Queue"), jobs.size());
+            lock.unlock();
+
+            {
+                TRACE_EVENT("gpu", "PipelineCompiler::Compile");
+                try {
+                    job.pipeline->Complete(job.function(gpu.vkDevice, gpu.pipelineCache.vkPipelineCache), nullptr);
+                } catch (...) {
+                    job.pipeline->Complete(std::nullopt, std::current_exception());
+                }
+            }
+
+            lock.lock();
+        }
+    }
+
+    std::shared_ptr<CompiledPipeline> PipelineCompiler::Compile(CompileFunction function) {
+        auto pipeline{std::make_shared<CompiledPipeline>()};
+        {
+            std::scoped_lock lock(mutex);
+            jobs.push_back(Job{std::move(function), pipeline});
+            TRACE_COUNTER("gpu", perfetto::CounterTrack("Pipeline Compile Queue"), jobs.size());
+        }
+        condition.notify_one();
+        return pipeline;
+    }
+}
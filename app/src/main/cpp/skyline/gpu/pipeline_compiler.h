@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vulkan/vulkan_raii.hpp>
+#include <common.h>
+
+namespace skyline::gpu {
+    class GPU;
+
+    /**
+     * @brief A pipeline which is compiled asynchronously by the PipelineCompiler, it can be polled without blocking to check if compilation has completed
+     */
+    class CompiledPipeline {
+      private:
+        std::mutex mutex; //!< Synchronizes waiting on the pipeline with its completion
+        std::condition_variable condition; //!< Signalled when compilation has completed
+        std::atomic<bool> ready{}; //!< If compilation has completed, successfully or otherwise
+        std::optional<vk::raii::Pipeline> pipeline;
+        std::exception_ptr exception; //!< The exception thrown during compilation, if any
+
+        friend class PipelineCompiler;
+
+        void Complete(std::optional<vk::raii::Pipeline> &&pipeline, std::exception_ptr exception);
+
+      public:
+        /**
+         * @return If compilation has completed, this doesn't block so a draw can be skipped or use a fallback pipeline while it's still compiling
+         */
+        bool Ready() const {
+            return ready.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Blocks till compilation has completed
+         */
+        void Wait();
+
+        /**
+         * @return The compiled pipeline, this blocks till compilation has completed
+         * @note Any exception thrown during compilation is rethrown by this
+         */
+        vk::Pipeline Get();
+    };
+
+    /**
+     * @brief A pool of worker threads which compile pipelines so pipeline compilation never blocks the thread submitting GPU work
+     * @note The amount of queued jobs is reported as a Perfetto counter to allow tuning the amount of workers
+     */
+    class PipelineCompiler {
+      public:
+        using CompileFunction = std::function<vk::raii::Pipeline(const vk::raii::Device &, const vk::raii::PipelineCache &)>; //!< A function which creates the pipeline, it must hold all the state required to do so
+
+      private:
+        struct Job {
+            CompileFunction function;
+            std::shared_ptr<CompiledPipeline> pipeline;
+        };
+
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes access to the queued jobs
+        std::condition_variable condition; //!< Signalled when a job is queued or when the compiler is being destroyed
+        std::deque<Job> jobs;
+        bool exiting{};
+        std::vector<std::thread> workers;
+
+        void Worker(size_t index);
+
+      public:
+        PipelineCompiler(GPU &gpu);
+
+        ~PipelineCompiler();
+
+        /**
+         * @brief Queues a pipeline for compilation on a worker thread
+         * @return A handle to the pipeline which becomes ready once it has been compiled
+         */
+        std::shared_ptr<CompiledPipeline> Compile(CompileFunction function);
+    };
+}
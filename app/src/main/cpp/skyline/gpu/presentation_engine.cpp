@@ -1,10 +1,13 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <poll.h>
 #include <android/native_window_jni.h>
 #include <android/choreographer.h>
 #include <common/settings.h>
 #include <common/signal.h>
+#include <common/flight_recorder.h>
+#include <common/performance_hint.h>
 #include <jvm.h>
 #include <gpu.h>
 #include <loader/loader.h>
@@ -24,15 +27,33 @@ namespace skyline::gpu {
         : state(state),
           gpu(gpu),
           acquireFence(gpu.vkDevice, vk::FenceCreateInfo{}),
+          requestedPresentMode(static_cast<vk::PresentModeKHR>(state.settings->presentMode)),
           presentationTrack(static_cast<u64>(trace::TrackIds::Presentation), perfetto::ProcessTrack::Current()),
           choreographerThread(&PresentationEngine::ChoreographerThread, this),
           vsyncEvent(std::make_shared<kernel::type::KEvent>(state, true)) {
         auto desc{presentationTrack.Serialize()};
         desc.set_name("Presentation");
         perfetto::TrackEvent::SetTrackDescriptor(presentationTrack, desc);
+
+        presentThread = std::thread(&PresentationEngine::PresentThread, this);
     }
 
     PresentationEngine::~PresentationEngine() {
+        {
+            std::scoped_lock lock(presentMutex);
+            presentStop = true;
+        }
+        presentCondition.notify_all();
+        presentQueueCondition.notify_all();
+        {
+            std::scoped_lock lock(mutex); // The present thread may be waiting on a surface which is woken up here rather than being signalled by a new surface
+        }
+        surfaceCondition.notify_all();
+        if (presentThread.joinable())
+            presentThread.join();
+
+        DestroySurfaceControl();
+
         auto env{state.jvm->GetEnv()};
         if (!env->IsSameObject(jSurface, nullptr))
             env->DeleteGlobalRef(jSurface);
@@ -86,6 +107,55 @@ namespace skyline::gpu {
         }
     }
 
+    void PresentationEngine::PresentThread() {
+        pthread_setname_np(pthread_self(), "GPU-Present");
+        PerformanceHint::RegisterCurrentThread();
+        try {
+            signal::SetSignalHandler({SIGINT, SIGILL, SIGTRAP, SIGBUS, SIGFPE, SIGSEGV}, signal::ExceptionalSignalHandler);
+            while (true) {
+                PresentRequest request;
+                {
+                    std::unique_lock lock(presentMutex);
+                    presentCondition.wait(lock, [this]() { return !presentQueue.empty() || presentStop; });
+                    if (presentStop)
+                        break;
+
+                    request = std::move(presentQueue.front());
+                    presentQueue.pop_front();
+                    presentingTexture = request.texture.get();
+                }
+                presentQueueCondition.notify_all();
+
+                bool presented{PresentFrame(request)};
+                {
+                    std::scoped_lock lock(presentMutex);
+                    presentingTexture = nullptr;
+                }
+                presentQueueCondition.notify_all();
+                if (!presented)
+                    break;
+
+                if (benchmarkFrames && ++benchmarkPresentedFrames == benchmarkFrames) {
+                    Logger::Info("Benchmark run has reached {} frames, stopping emulation", benchmarkFrames);
+                    state.process->Kill(false, false, true);
+                }
+            }
+        } catch (const signal::SignalException &e) {
+            Logger::Error("{}\nStack Trace:{}", e.what(), state.loader->GetStackTrace(e.frames));
+            if (state.process)
+                state.process->Kill(false);
+            else
+                std::rethrow_exception(std::current_exception());
+        } catch (const std::exception &e) {
+            Logger::Error(e.what());
+            if (state.process)
+                state.process->Kill(false);
+            else
+                std::rethrow_exception(std::current_exception());
+        }
+        PerformanceHint::UnregisterCurrentThread();
+    }
+
     NativeWindowTransform GetAndroidTransform(vk::SurfaceTransformFlagBitsKHR transform) {
         using NativeWindowTransform = NativeWindowTransform;
         switch (transform) {
@@ -109,8 +179,39 @@ namespace skyline::gpu {
         }
     }
 
+    vk::PresentModeKHR PresentationEngine::SelectPresentMode() {
+        // FIFO is the only mode which is guaranteed to be supported, it's the last resort for every mode
+        auto fallbacks{[&]() -> std::initializer_list<vk::PresentModeKHR> {
+            switch (requestedPresentMode) {
+                case vk::PresentModeKHR::eImmediate:
+                    return {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+                case vk::PresentModeKHR::eMailbox:
+                    return {vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+                case vk::PresentModeKHR::eFifoRelaxed:
+                    return {vk::PresentModeKHR::eFifoRelaxed};
+                default:
+                    return {};
+            }
+        }()};
+
+        auto modes{gpu.vkPhysicalDevice.getSurfacePresentModesKHR(**vkSurface)};
+        for (auto mode : fallbacks) {
+            if (std::find(modes.begin(), modes.end(), mode) != modes.end()) {
+                if (mode != requestedPresentMode)
+                    Logger::Warn("Surface doesn't support present mode '{}', falling back to '{}'", vk::to_string(requestedPresentMode), vk::to_string(mode));
+                return mode;
+            }
+        }
+
+        if (requestedPresentMode != vk::PresentModeKHR::eFifo)
+            Logger::Warn("Surface doesn't support present mode '{}', falling back to '{}'", vk::to_string(requestedPresentMode), vk::to_string(vk::PresentModeKHR::eFifo));
+        return vk::PresentModeKHR::eFifo;
+    }
+
     void PresentationEngine::UpdateSwapchain(texture::Format format, texture::Dimensions extent) {
-        auto minImageCount{std::max(vkSurfaceCapabilities.minImageCount, state.settings->forceTripleBuffering ? 3U : 2U)};
+        auto presentMode{SelectPresentMode()};
+        // Mailbox requires a third image as the last queued image is retained while another is being rendered to, it'd block on acquisition otherwise
+        auto minImageCount{std::max(vkSurfaceCapabilities.minImageCount, (state.settings->forceTripleBuffering || presentMode == vk::PresentModeKHR::eMailbox) ? 3U : 2U)};
         if (minImageCount > MaxSwapchainImageCount)
             throw exception("Requesting swapchain with higher image count ({}) than maximum slot count ({})", minImageCount, MaxSwapchainImageCount);
 
@@ -130,11 +231,6 @@ namespace skyline::gpu {
         if ((capabilities.supportedUsageFlags & presentUsage) != presentUsage)
             throw exception("Swapchain doesn't support image usage '{}': {}", vk::to_string(presentUsage), vk::to_string(capabilities.supportedUsageFlags));
 
-        auto requestedMode{state.settings->disableFrameThrottling ? vk::PresentModeKHR::eMailbox : vk::PresentModeKHR::eFifo};
-        auto modes{gpu.vkPhysicalDevice.getSurfacePresentModesKHR(**vkSurface)};
-        if (std::find(modes.begin(), modes.end(), requestedMode) == modes.end())
-            throw exception("Swapchain doesn't support present mode: {}", vk::to_string(requestedMode));
-
         vkSwapchain.emplace(gpu.vkDevice, vk::SwapchainCreateInfoKHR{
             .surface = **vkSurface,
             .minImageCount = minImageCount,
@@ -145,7 +241,7 @@ namespace skyline::gpu {
             .imageUsage = presentUsage,
             .imageSharingMode = vk::SharingMode::eExclusive,
             .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eInherit,
-            .presentMode = requestedMode,
+            .presentMode = presentMode,
             .clipped = true,
         });
 
@@ -164,6 +260,53 @@ namespace skyline::gpu {
 
         swapchainFormat = format;
         swapchainExtent = extent;
+        swapchainPresentMode = presentMode;
+    }
+
+    void PresentationEngine::SetPresentMode(vk::PresentModeKHR mode) {
+        std::lock_guard guard(mutex);
+        if (requestedPresentMode == mode)
+            return;
+
+        requestedPresentMode = mode;
+        if (vkSwapchain && SelectPresentMode() != swapchainPresentMode) {
+            Logger::Info("Recreating swapchain with present mode '{}'", vk::to_string(mode));
+            UpdateSwapchain(swapchainFormat, swapchainExtent);
+        }
+    }
+
+    void PresentationEngine::SetBenchmarkFrames(u64 frames) {
+        std::scoped_lock lock(presentMutex); // The present thread only reads this after taking a frame off the queue with the mutex held
+        benchmarkFrames = frames;
+        benchmarkPresentedFrames = 0;
+    }
+
+    void PresentationEngine::UpdatePresentLatency() {
+        for (const auto &timing : vkSwapchain->getPastPresentationTimingGOOGLE()) {
+            if (presentId - timing.presentID > PresentHistorySize)
+                continue; // The queue time of the frame has been overwritten by a newer one
+
+            auto latency{static_cast<i64>(timing.earliestPresentTime) - presentQueueTimes[timing.presentID % PresentHistorySize]};
+            if (latency < 0)
+                continue;
+
+            // We use the earliest rather than the actual present time as the latter is delayed by the scheduling itself, the latency would grow indefinitely otherwise
+            constexpr i64 LatencySampleWeight{8};
+            presentLatency = presentLatency ? (((LatencySampleWeight - 1) * presentLatency) + latency) / LatencySampleWeight : latency;
+        }
+    }
+
+    i64 PresentationEngine::GetTargetPresentTime(i64 now, i64 timestamp, u64 swapInterval) {
+        i64 target{std::max(now + presentLatency, timestamp)};
+        if (swapInterval && lastTargetPresentTime)
+            target = std::max(target, lastTargetPresentTime + (refreshCycleDuration * static_cast<i64>(swapInterval)));
+
+        // Round up to the next refresh on the Choreographer's timeline, scheduling a frame between refreshes would only delay it till the next one
+        if (refreshCycleDuration && lastChoreographerTime && target > lastChoreographerTime)
+            target = lastChoreographerTime + (((target - lastChoreographerTime) + refreshCycleDuration - 1) / refreshCycleDuration) * refreshCycleDuration;
+
+        lastTargetPresentTime = target;
+        return target;
     }
 
     void PresentationEngine::UpdateSurface(jobject newSurface) {
@@ -178,6 +321,7 @@ namespace skyline::gpu {
             jSurface = env->NewGlobalRef(newSurface);
 
         vkSwapchain.reset();
+        DestroySurfaceControl();
 
         if (jSurface) {
             window = ANativeWindow_fromSurface(env, jSurface);
@@ -209,6 +353,10 @@ namespace skyline::gpu {
             if ((result = window->perform(window, NATIVE_WINDOW_ENABLE_FRAME_TIMESTAMPS, true)))
                 throw exception("Enabling frame timestamps failed with {}", result);
 
+            if (state.settings->zeroCopyPresentation && gpu.supportsHardwareBuffers)
+                if (!(surfaceControl = ASurfaceControl_createFromWindow(window, "Skyline Presentation")))
+                    Logger::Warn("Failed to create a surface control for zero-copy presentation, falling back to the swapchain");
+
             surfaceCondition.notify_all();
         } else {
             vkSurface.reset();
@@ -216,13 +364,78 @@ namespace skyline::gpu {
         }
     }
 
-    void PresentationEngine::Present(const std::shared_ptr<Texture> &texture, i64 timestamp, u64 swapInterval, AndroidRect crop, NativeWindowScalingMode scalingMode, NativeWindowTransform transform, u64 &frameId) {
+    void PresentationEngine::Present(const std::shared_ptr<Texture> &texture, i64 timestamp, u64 swapInterval, AndroidRect crop, NativeWindowScalingMode scalingMode, NativeWindowTransform transform, std::shared_ptr<FenceCycleDependency> release) {
+        {
+            std::unique_lock lock(presentMutex);
+            presentQueueCondition.wait(lock, [this]() { return presentQueue.size() < MaxQueuedFrames || presentStop; });
+            if (presentStop)
+                return;
+
+            presentQueue.push_back(PresentRequest{
+                .texture = texture,
+                .timestamp = timestamp,
+                .swapInterval = swapInterval,
+                .crop = crop,
+                .scalingMode = scalingMode,
+                .transform = transform,
+                .release = std::move(release),
+            });
+        }
+        presentCondition.notify_one();
+    }
+
+    bool PresentationEngine::PresentFrame(PresentRequest &request) {
+        TRACE_EVENT("gpu", "PresentationEngine::PresentFrame");
+        auto &[texture, timestamp, swapInterval, crop, scalingMode, transform, release]{request};
+
         std::unique_lock lock(mutex);
-        surfaceCondition.wait(lock, [this]() { return vkSurface.has_value(); });
+        auto waitForSurface{[&]() {
+            surfaceCondition.wait(lock, [this]() { return vkSurface.has_value() || presentStop; });
+            return !presentStop;
+        }};
+        if (benchmarkFrames && !vkSurface) {
+            // Benchmark runs discard frames while there's no surface so they can run headless, they're still counted in the statistics as that's what the benchmark measures
+            UpdateFrameStatistics(swapInterval);
+            return true;
+        }
+        if (!waitForSurface())
+            return false;
+
+        std::unique_lock textureLock(*texture);
+
+        if (auto minimumSwapInterval{gpu.thermalGovernor.GetMinimumSwapInterval()})
+            swapInterval = std::max(swapInterval, static_cast<u64>(minimumSwapInterval));
 
         if (texture->format != swapchainFormat || texture->dimensions != swapchainExtent)
             UpdateSwapchain(texture->format, texture->dimensions);
 
+        if (crop && texture->IsScaled()) {
+            // The crop is in guest coordinates while the texture is at the scaled host resolution
+            auto &guestDimensions{texture->guest->dimensions};
+            auto scaleCrop{[](u32 value, u32 host, u32 guest) {
+                return static_cast<u32>((static_cast<u64>(value) * host) / guest);
+            }};
+            crop.left = scaleCrop(crop.left, texture->dimensions.width, guestDimensions.width);
+            crop.right = scaleCrop(crop.right, texture->dimensions.width, guestDimensions.width);
+            crop.top = scaleCrop(crop.top, texture->dimensions.height, guestDimensions.height);
+            crop.bottom = scaleCrop(crop.bottom, texture->dimensions.height, guestDimensions.height);
+        }
+
+        if (surfaceControl && texture->GetHardwareBuffer()) {
+            PresentHardwareBuffer(texture, timestamp, swapInterval, crop, transform);
+            UpdateFrameStatistics(swapInterval);
+            return true; // The release object is destroyed with the request as the compositor's release of the buffer is tracked separately
+        }
+
+        if (surfaceControlVisible) {
+            // The layer is hidden when falling back to the swapchain so it doesn't cover it, the last buffer on it is retained till it's replaced
+            auto transaction{ASurfaceTransaction_create()};
+            ASurfaceTransaction_setVisibility(transaction, surfaceControl, ASURFACE_TRANSACTION_VISIBILITY_HIDE);
+            ASurfaceTransaction_apply(transaction);
+            ASurfaceTransaction_delete(transaction);
+            surfaceControlVisible = false;
+        }
+
         int result;
         if (crop && crop != windowCrop) {
             if ((result = window->perform(window, NATIVE_WINDOW_SET_CROP, &crop)))
@@ -246,67 +459,87 @@ namespace skyline::gpu {
 
         std::pair<vk::Result, u32> nextImage;
         while (nextImage = vkSwapchain->acquireNextImage(std::numeric_limits<u64>::max(), {}, *acquireFence), nextImage.first != vk::Result::eSuccess) [[unlikely]] {
-            if (nextImage.first == vk::Result::eSuboptimalKHR)
-                surfaceCondition.wait(lock, [this]() { return vkSurface.has_value(); });
-            else
+            if (nextImage.first == vk::Result::eSuboptimalKHR) {
+                if (!waitForSurface())
+                    return false;
+            } else
                 throw exception("vkAcquireNextImageKHR returned an unhandled result '{}'", vk::to_string(nextImage.first));
         }
 
         std::ignore = gpu.vkDevice.waitForFences(*acquireFence, true, std::numeric_limits<u64>::max());
-        images.at(nextImage.second)->CopyFrom(texture, vk::ImageSubresourceRange{
+        auto &image{images.at(nextImage.second)};
+        image->CopyFrom(texture, vk::ImageSubresourceRange{
             .aspectMask = vk::ImageAspectFlagBits::eColor,
             .levelCount = 1,
             .layerCount = 1,
         });
+        image->cycle.lock()->AttachObject(std::move(release)); // The cycle of the copy is that of the swapchain image, the texture is only read by it
+        textureLock.unlock();
+
+        // Note: It's important we do this right before present as going past the timestamp could lead to fewer Binder IPC calls
+        timestamp = ToMonotonicTime(timestamp);
+
+        std::optional<vk::PresentTimeGOOGLE> presentTime;
+        if (gpu.supportsDisplayTiming) {
+            // We schedule the frame for the refresh it's predicted to be ready by, this paces frames to the display rather than to when the guest queues them
+            timespec time;
+            if (clock_gettime(CLOCK_MONOTONIC, &time))
+                throw exception("Failed to clock_gettime with '{}'", strerror(errno));
+            i64 now{(time.tv_sec * constant::NsInSecond) + time.tv_nsec};
+
+            UpdatePresentLatency();
+            auto target{GetTargetPresentTime(now, timestamp, swapInterval)};
+
+            presentQueueTimes[presentId % PresentHistorySize] = now;
+            presentTime = vk::PresentTimeGOOGLE{
+                .presentID = presentId++,
+                .desiredPresentTime = static_cast<u64>(std::max(target - (refreshCycleDuration / 2), i64{})), // Half a refresh of slack is left so jitter in the timeline doesn't push the frame back by an entire refresh
+            };
+        } else {
+            if (swapInterval > 1)
+                // If we have a swap interval above 1 we have to adjust the timestamp to emulate the swap interval
+                timestamp = std::max(timestamp, lastChoreographerTime + (refreshCycleDuration * static_cast<i64>(swapInterval) * 2));
 
-        if (timestamp) {
-            // If the timestamp is specified, we need to convert it from the util::GetTimeNs base to the CLOCK_MONOTONIC one
-            // We do so by getting an offset from the current time in nanoseconds and then adding it to the current time in CLOCK_MONOTONIC
-            // Note: It's important we do this right before present as going past the timestamp could lead to fewer Binder IPC calls
-            i64 current{util::GetTimeNs()};
-            if (current < timestamp) {
-                timespec time;
-                if (clock_gettime(CLOCK_MONOTONIC, &time))
-                    throw exception("Failed to clock_gettime with '{}'", strerror(errno));
-                timestamp = ((time.tv_sec * constant::NsInSecond) + time.tv_nsec) + (timestamp - current);
-            } else {
-                timestamp = 0;
-            }
-        }
-
-        if (swapInterval > 1)
-            // If we have a swap interval above 1 we have to adjust the timestamp to emulate the swap interval
-            timestamp = std::max(timestamp, lastChoreographerTime + (refreshCycleDuration * static_cast<i64>(swapInterval) * 2));
-
-        auto lastTimestamp{std::exchange(windowLastTimestamp, timestamp)};
-        if (!timestamp && lastTimestamp)
-            // We need to nullify the timestamp if it transitioned from being specified (non-zero) to unspecified (zero)
-            timestamp = NativeWindowTimestampAuto;
-
-        if (timestamp && (result = window->perform(window, NATIVE_WINDOW_SET_BUFFERS_TIMESTAMP, timestamp)))
-            throw exception("Setting the buffer timestamp to {} failed with {}", timestamp, result);
+            auto lastTimestamp{std::exchange(windowLastTimestamp, timestamp)};
+            if (!timestamp && lastTimestamp)
+                // We need to nullify the timestamp if it transitioned from being specified (non-zero) to unspecified (zero)
+                timestamp = NativeWindowTimestampAuto;
 
-        if ((result = window->perform(window, NATIVE_WINDOW_GET_NEXT_FRAME_ID, &frameId)))
-            throw exception("Retrieving the next frame's ID failed with {}", result);
+            if (timestamp && (result = window->perform(window, NATIVE_WINDOW_SET_BUFFERS_TIMESTAMP, timestamp)))
+                throw exception("Setting the buffer timestamp to {} failed with {}", timestamp, result);
+        }
 
         {
             std::lock_guard queueLock(gpu.queueMutex);
+            vk::PresentTimesInfoGOOGLE presentTimesInfo{
+                .swapchainCount = 1,
+                .pTimes = presentTime ? &*presentTime : nullptr,
+            };
             std::ignore = gpu.vkQueue.presentKHR(vk::PresentInfoKHR{
+                .pNext = presentTime ? &presentTimesInfo : nullptr,
                 .swapchainCount = 1,
                 .pSwapchains = &**vkSwapchain,
                 .pImageIndices = &nextImage.second,
             }); // We don't care about suboptimal images as they are caused by not respecting the transform hint, we handle transformations externally
         }
 
+        UpdateFrameStatistics(swapInterval);
+        return true;
+    }
+
+    void PresentationEngine::UpdateFrameStatistics(u64 swapInterval) {
         if (frameTimestamp) {
             i64 now{util::GetTimeNs()};
-            i64 sampleWeight{swapInterval ? constant::NsInSecond / (refreshCycleDuration * static_cast<i64>(swapInterval)) : 10}; //!< The weight of each sample in calculating the average, we arbitrarily average 10 samples for unlocked FPS
+            i64 sampleWeight{swapInterval && refreshCycleDuration ? constant::NsInSecond / (refreshCycleDuration * static_cast<i64>(swapInterval)) : 10}; //!< The weight of each sample in calculating the average, we arbitrarily average 10 samples for unlocked FPS or when the refresh rate isn't known yet such as in headless benchmark runs
 
             auto weightedAverage{[](auto weight, auto previousAverage, auto current) {
                 return (((weight - 1) * previousAverage) + current) / weight;
             }}; //!< Modified moving average (https://en.wikipedia.org/wiki/Moving_average#Modified_moving_average)
 
             i64 currentFrametime{now - frameTimestamp};
+            gpu.statistics.EndFrame(currentFrametime, presentLatency); // The latency is only measured with VK_GOOGLE_display_timing, it stays 0 otherwise
+            gpu.thermalGovernor.Update(gpu.statistics, refreshCycleDuration);
+            PerformanceHint::ReportFrame(refreshCycleDuration * static_cast<i64>(std::max<u64>(swapInterval, 1)), currentFrametime); // The frame time is used as the work duration as it's what the emulation threads must fit inside
             averageFrametimeNs = weightedAverage(sampleWeight, averageFrametimeNs, currentFrametime);
             AverageFrametimeMs = static_cast<jfloat>(averageFrametimeNs) / constant::NsInMillisecond;
 
@@ -317,11 +550,155 @@ namespace skyline::gpu {
             Fps = static_cast<jint>(std::round(static_cast<float>(constant::NsInSecond) / static_cast<float>(averageFrametimeNs)));
 
             TRACE_EVENT_INSTANT("gpu", "Present", presentationTrack, "FrameTimeNs", now - frameTimestamp, "Fps", Fps);
+            trace::FlightRecorder::Record(trace::FlightRecorder::EventType::Present, static_cast<u64>(now - frameTimestamp));
 
             frameTimestamp = now;
         } else {
             frameTimestamp = util::GetTimeNs();
         }
+
+        gpu.texture.AdvanceFrame();
+    }
+
+    i64 PresentationEngine::ToMonotonicTime(i64 timestamp) {
+        if (!timestamp)
+            return 0;
+
+        // We need to convert the timestamp from the util::GetTimeNs base to the CLOCK_MONOTONIC one
+        // We do so by getting an offset from the current time in nanoseconds and then adding it to the current time in CLOCK_MONOTONIC
+        i64 current{util::GetTimeNs()};
+        if (current >= timestamp)
+            return 0;
+
+        timespec time;
+        if (clock_gettime(CLOCK_MONOTONIC, &time))
+            throw exception("Failed to clock_gettime with '{}'", strerror(errno));
+        return ((time.tv_sec * constant::NsInSecond) + time.tv_nsec) + (timestamp - current);
+    }
+
+    void PresentationEngine::PresentHardwareBuffer(const std::shared_ptr<Texture> &texture, i64 timestamp, u64 swapInterval, AndroidRect crop, NativeWindowTransform transform) {
+        // The compositor can't wait on a Vulkan fence so we wait for all GPU work on the texture to complete prior to handing it over
+        texture->WaitOnFence();
+
+        auto buffer{texture->GetHardwareBuffer()};
+        ARect source{
+            .left = static_cast<i32>(crop.left),
+            .top = static_cast<i32>(crop.top),
+            .right = static_cast<i32>(crop ? crop.right : texture->dimensions.width),
+            .bottom = static_cast<i32>(crop ? crop.bottom : texture->dimensions.height),
+        };
+        ARect destination{
+            .right = ANativeWindow_getWidth(window),
+            .bottom = ANativeWindow_getHeight(window),
+        };
+
+        if (swapInterval > 1)
+            // The layer has no notion of swap intervals so we emulate them with a desired present time, this is the same as the swapchain path without display timing
+            timestamp = std::max(timestamp, lastChoreographerTime + (refreshCycleDuration * static_cast<i64>(swapInterval) * 2));
+
+        auto transaction{ASurfaceTransaction_create()};
+        ASurfaceTransaction_setBuffer(transaction, surfaceControl, buffer, -1);
+        ASurfaceTransaction_setBufferTransparency(transaction, surfaceControl, ASURFACE_TRANSACTION_TRANSPARENCY_OPAQUE);
+        ASurfaceTransaction_setGeometry(transaction, surfaceControl, source, destination, static_cast<i32>(transform) & (ANATIVEWINDOW_TRANSFORM_MIRROR_HORIZONTAL | ANATIVEWINDOW_TRANSFORM_MIRROR_VERTICAL | ANATIVEWINDOW_TRANSFORM_ROTATE_90)); // NativeWindowTransform shares the bit layout of ANativeWindowTransform, InvertDisplay has no equivalent
+        if (!surfaceControlVisible) {
+            ASurfaceTransaction_setVisibility(transaction, surfaceControl, ASURFACE_TRANSACTION_VISIBILITY_SHOW);
+            surfaceControlVisible = true;
+        }
+        if (timestamp)
+            ASurfaceTransaction_setDesiredPresentTime(transaction, timestamp);
+
+        auto previousBuffer{std::exchange(surfaceControlBuffer, buffer)};
+        if (previousBuffer && previousBuffer != buffer) {
+            // The previous buffer is only released by the compositor once this transaction has been applied, its release fence is supplied to the completion callback
+            {
+                std::scoped_lock trackerLock(releaseTracker->mutex);
+                auto &fence{releaseTracker->fences[previousBuffer]};
+                if (fence >= 0)
+                    close(fence);
+                fence = ReleaseTracker::PendingFence;
+            }
+
+            struct CallbackContext {
+                std::shared_ptr<ReleaseTracker> tracker;
+                ASurfaceControl *surfaceControl;
+                AHardwareBuffer *buffer;
+            };
+
+            ASurfaceTransaction_setOnComplete(transaction, new CallbackContext{releaseTracker, surfaceControl, previousBuffer}, [](void *pContext, ASurfaceTransactionStats *stats) {
+                std::unique_ptr<CallbackContext> context{static_cast<CallbackContext *>(pContext)};
+                int fd{ASurfaceTransactionStats_getPreviousReleaseFenceFd(stats, context->surfaceControl)};
+
+                auto &tracker{*context->tracker};
+                std::scoped_lock trackerLock(tracker.mutex);
+                auto it{tracker.fences.find(context->buffer)};
+                if (it != tracker.fences.end() && it->second == ReleaseTracker::PendingFence) {
+                    it->second = fd;
+                    tracker.condition.notify_all();
+                } else if (fd >= 0) {
+                    close(fd); // The fence is no longer being tracked as the surface control was destroyed
+                }
+            });
+        }
+
+        ASurfaceTransaction_apply(transaction);
+        ASurfaceTransaction_delete(transaction);
+    }
+
+    void PresentationEngine::DestroySurfaceControl() {
+        if (!surfaceControl)
+            return;
+
+        ASurfaceControl_release(std::exchange(surfaceControl, nullptr));
+        surfaceControlBuffer = nullptr;
+        surfaceControlVisible = false;
+
+        std::scoped_lock trackerLock(releaseTracker->mutex);
+        for (auto [buffer, fence] : releaseTracker->fences)
+            if (fence >= 0)
+                close(fence);
+        releaseTracker->fences.clear();
+        releaseTracker->condition.notify_all();
+    }
+
+    void PresentationEngine::WaitForRelease(Texture &texture) {
+        auto buffer{texture.GetHardwareBuffer()};
+        if (!buffer)
+            return;
+
+        {
+            std::unique_lock lock(presentMutex);
+            presentQueueCondition.wait(lock, [&]() {
+                return presentStop || (presentingTexture != &texture && std::none_of(presentQueue.begin(), presentQueue.end(), [&](const PresentRequest &request) { return request.texture.get() == &texture; }));
+            });
+        }
+
+        int fence;
+        {
+            std::unique_lock trackerLock(releaseTracker->mutex);
+            auto it{releaseTracker->fences.find(buffer)};
+            if (it == releaseTracker->fences.end())
+                return;
+
+            releaseTracker->condition.wait(trackerLock, [&]() {
+                it = releaseTracker->fences.find(buffer);
+                return it == releaseTracker->fences.end() || it->second != ReleaseTracker::PendingFence;
+            });
+            if (it == releaseTracker->fences.end())
+                return;
+
+            fence = it->second;
+            releaseTracker->fences.erase(it);
+        }
+
+        if (fence >= 0) {
+            TRACE_EVENT("gpu", "PresentationEngine::WaitForRelease");
+            pollfd pollFd{
+                .fd = fence,
+                .events = POLLIN,
+            };
+            while (poll(&pollFd, 1, -1) < 0 && errno == EINTR);
+            close(fence);
+        }
     }
 
     NativeWindowTransform PresentationEngine::GetTransformHint() {
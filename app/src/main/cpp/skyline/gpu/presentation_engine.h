@@ -3,8 +3,10 @@
 
 #pragma once
 
+#include <deque>
 #include <jni.h>
 #include <android/looper.h>
+#include <android/surface_control.h>
 #include <common/trace.h>
 #include <kernel/types/KEvent.h>
 #include <services/hosbinder/GraphicBufferProducer.h>
@@ -37,6 +39,8 @@ namespace skyline::gpu {
         vk::raii::Fence acquireFence; //!< A fence for acquiring an image from the swapchain
         texture::Format swapchainFormat{}; //!< The image format of the textures in the current swapchain
         texture::Dimensions swapchainExtent{}; //!< The extent of images in the current swapchain
+        vk::PresentModeKHR requestedPresentMode; //!< The present mode which should be used if the surface supports it
+        vk::PresentModeKHR swapchainPresentMode{}; //!< The present mode of the current swapchain, this may differ from the requested mode if it's unsupported
 
         static constexpr size_t MaxSwapchainImageCount{6}; //!< The maximum amount of swapchain textures, this affects the amount of images that can be in the swapchain
         std::array<std::shared_ptr<Texture>, MaxSwapchainImageCount> images; //!< All the swapchain textures in the same order as supplied by the host swapchain
@@ -52,6 +56,62 @@ namespace skyline::gpu {
         i64 refreshCycleDuration{}; //!< The duration of a single refresh cycle for the display in nanoseconds
         bool choreographerStop{}; //!< If the Choreographer thread should stop on the next ALooper_wake()
 
+        static constexpr size_t PresentHistorySize{8}; //!< The amount of frames which the queue times are retained for to correlate them with presentation timing readouts
+        std::array<i64, PresentHistorySize> presentQueueTimes{}; //!< The CLOCK_MONOTONIC time at which each of the last frames were queued, indexed by their present ID modulo the size
+        u32 presentId{}; //!< The ID of the next frame presented with VK_GOOGLE_display_timing
+        i64 presentLatency{}; //!< The average time from a frame being queued to the earliest time it could've been displayed at in nanoseconds, this covers both GPU and compositor latency
+        i64 lastTargetPresentTime{}; //!< The CLOCK_MONOTONIC time of the refresh at which the last frame was scheduled to be displayed
+
+        /**
+         * @brief The release fences of AHardwareBuffers which were handed to the compositor, this is shared with transaction callbacks which may outlive the engine
+         */
+        struct ReleaseTracker {
+            std::mutex mutex;
+            std::condition_variable condition; //!< Signalled when the compositor reports the release fence of a buffer
+            std::unordered_map<AHardwareBuffer *, int> fences; //!< A map from buffers which have been replaced on the layer to their release fence FD, this is -1 if there's no fence and PendingFence if it hasn't been reported yet
+            static constexpr int PendingFence{-2};
+        };
+
+        ASurfaceControl *surfaceControl{}; //!< A layer parented to the window which AHardwareBuffer-backed textures are directly presented on, this is only created when zero-copy presentation is enabled and supported
+        AHardwareBuffer *surfaceControlBuffer{}; //!< The buffer which is currently set on the layer
+        bool surfaceControlVisible{}; //!< If the layer is currently shown on top of the swapchain
+        std::shared_ptr<ReleaseTracker> releaseTracker{std::make_shared<ReleaseTracker>()};
+
+        /**
+         * @brief A frame which has been queued by the guest and is yet to be presented by the present thread
+         */
+        struct PresentRequest {
+            std::shared_ptr<Texture> texture;
+            i64 timestamp;
+            u64 swapInterval;
+            service::hosbinder::AndroidRect crop;
+            service::hosbinder::NativeWindowScalingMode scalingMode;
+            service::hosbinder::NativeWindowTransform transform;
+            std::shared_ptr<FenceCycleDependency> release; //!< An object which is retained till the host GPU has finished reading from the texture
+        };
+
+        static constexpr size_t MaxQueuedFrames{2}; //!< The maximum amount of frames that can be queued for presentation, queueing any further frames blocks till one has been presented which paces the guest to the host
+        std::mutex presentMutex; //!< Synchronizes access to the present queue
+        std::condition_variable presentCondition; //!< Signalled when a frame is queued or when the present thread should stop
+        std::condition_variable presentQueueCondition; //!< Signalled when a frame has been taken off the present queue
+        std::deque<PresentRequest> presentQueue;
+        Texture *presentingTexture{}; //!< The texture of the frame that the present thread is currently presenting, if any
+        std::atomic<bool> presentStop{}; //!< If the present thread should stop, any frames left in the queue are dropped
+        std::thread presentThread; //!< A thread which presents queued frames so swapchain acquires, queue submissions and presentation stalls don't block the guest
+        u64 benchmarkFrames{}; //!< The amount of frames after which emulation is stopped for a benchmark run, this is 0 outside of benchmark runs
+        u64 benchmarkPresentedFrames{}; //!< The amount of frames which have been presented or discarded during the benchmark run, this is only accessed by the present thread
+
+        /**
+         * @brief The entry point for the present thread, it presents frames from the present queue in order till the engine is destroyed
+         */
+        void PresentThread();
+
+        /**
+         * @brief Presents a single frame on the present thread, this blocks on the swapchain and the compositor as required
+         * @return If the frame was presented, this is false if the engine is being destroyed
+         */
+        bool PresentFrame(PresentRequest &request);
+
         /**
          * @url https://developer.android.com/ndk/reference/group/choreographer#achoreographer_postframecallback64
          */
@@ -67,6 +127,49 @@ namespace skyline::gpu {
          */
         void UpdateSwapchain(texture::Format format, texture::Dimensions extent);
 
+        /**
+         * @return The requested present mode if it's supported by the surface, otherwise the closest supported mode to it
+         * @note 'PresentationEngine::mutex' **must** be locked prior to calling this
+         */
+        vk::PresentModeKHR SelectPresentMode();
+
+        /**
+         * @brief Updates the presentation latency estimate with timing readouts for any frames that have been displayed since the last call
+         * @note 'PresentationEngine::mutex' **must** be locked prior to calling this
+         */
+        void UpdatePresentLatency();
+
+        /**
+         * @brief Predicts the display refresh at which a frame queued now can be displayed at while respecting the guest's constraints on it
+         * @param now The current CLOCK_MONOTONIC time
+         * @param timestamp The earliest CLOCK_MONOTONIC time at which the frame may be displayed, 0 if unconstrained
+         * @param swapInterval The minimum amount of refreshes between the previous frame and this one
+         * @return The CLOCK_MONOTONIC time of the refresh which the frame should be displayed at
+         */
+        i64 GetTargetPresentTime(i64 now, i64 timestamp, u64 swapInterval);
+
+        /**
+         * @return The CLOCK_MONOTONIC equivalent of a timestamp relative to skyline::util::GetTimeNs or 0 if it has already passed
+         */
+        static i64 ToMonotonicTime(i64 timestamp);
+
+        /**
+         * @brief Hands an AHardwareBuffer-backed texture to the compositor directly by setting it on the layer
+         * @note 'PresentationEngine::mutex' **must** be locked prior to calling this
+         */
+        void PresentHardwareBuffer(const std::shared_ptr<Texture> &texture, i64 timestamp, u64 swapInterval, service::hosbinder::AndroidRect crop, service::hosbinder::NativeWindowTransform transform);
+
+        /**
+         * @brief Releases the layer along with any tracked release fences, any waiters on them are woken up
+         * @note 'PresentationEngine::mutex' **must** be locked prior to calling this
+         */
+        void DestroySurfaceControl();
+
+        /**
+         * @brief Updates the frame time statistics, ends the frame in GPU::statistics and advances the texture manager to the next frame, this should be called on every presented frame
+         */
+        void UpdateFrameStatistics(u64 swapInterval);
+
       public:
         std::shared_ptr<kernel::type::KEvent> vsyncEvent; //!< Signalled every time a frame is drawn
 
@@ -80,16 +183,35 @@ namespace skyline::gpu {
         void UpdateSurface(jobject newSurface);
 
         /**
-         * @brief Queue the supplied texture to be presented to the screen
+         * @brief Changes the present mode of the swapchain, the swapchain is recreated on the calling thread if the resulting mode differs from the current one
+         */
+        void SetPresentMode(vk::PresentModeKHR mode);
+
+        /**
+         * @brief Configures a benchmark run which stops emulation after the supplied amount of frames, frames are discarded rather than waiting for a surface during it so it can run without a visible window
+         * @note This must be called prior to the guest presenting any frames
+         */
+        void SetBenchmarkFrames(u64 frames);
+
+        /**
+         * @brief Queue the supplied texture to be presented to the screen, this returns once the frame has been queued and it's presented asynchronously by the present thread
          * @param timestamp The earliest timestamp (relative to skyline::util::GetTickNs) at which the frame must be presented, it should be 0 when it doesn't matter
          * @param swapInterval The amount of display refreshes that must take place prior to presenting this image
          * @param crop A rectangle with bounds that the image will be cropped to
          * @param scalingMode The mode by which the image must be scaled up to the surface
          * @param transform A transformation that should be performed on the image
-         * @param frameId The ID of this frame for correlating it with presentation timing readouts
-         * @note The texture **must** be locked prior to calling this
+         * @param release An object which is destroyed once the host GPU has finished reading from the texture, if the texture is handed to the compositor directly this is as soon as it has been handed over and WaitForRelease must be used
+         * @note This blocks if MaxQueuedFrames frames are already queued till one of them has been presented
+         * @note The texture must not be locked by the calling thread as it's locked by the present thread
+         */
+        void Present(const std::shared_ptr<Texture> &texture, i64 timestamp, u64 swapInterval, service::hosbinder::AndroidRect crop, service::hosbinder::NativeWindowScalingMode scalingMode, service::hosbinder::NativeWindowTransform transform, std::shared_ptr<FenceCycleDependency> release);
+
+        /**
+         * @brief Blocks till the compositor has released the texture if it was directly presented, this must be done prior to the guest writing into it again
+         * @note Any queued frames of the texture are waited on to be handed to the compositor prior to this
+         * @note The buffer currently shown on the layer isn't waited on as it's only released once it's replaced
          */
-        void Present(const std::shared_ptr<Texture> &texture, i64 timestamp, u64 swapInterval, service::hosbinder::AndroidRect crop, service::hosbinder::NativeWindowScalingMode scalingMode, service::hosbinder::NativeWindowTransform transform, u64 &frameId);
+        void WaitForRelease(Texture &texture);
 
         /**
          * @return A transform that the application should render with to elide costly transforms later
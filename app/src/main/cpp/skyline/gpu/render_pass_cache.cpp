@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include "render_pass_cache.h"
+
+namespace skyline::gpu {
+    namespace {
+        /**
+         * @brief Appends the raw bytes of an array of trivially copyable objects to a key
+         */
+        template<typename Type>
+        void AppendToKey(std::string &key, const Type *objects, size_t count) {
+            static_assert(std::is_trivially_copyable_v<Type>);
+            key.append(reinterpret_cast<const char *>(objects), count * sizeof(Type));
+        }
+
+        template<typename Type>
+        void AppendToKey(std::string &key, const Type &object) {
+            AppendToKey(key, &object, 1);
+        }
+    }
+
+    RenderPassCache::RenderPassCache(GPU &gpu) : gpu(gpu) {}
+
+    vk::RenderPass RenderPassCache::GetRenderPass(const vk::RenderPassCreateInfo &createInfo) {
+        // All structures serialized here consist entirely of 32-bit fields and have no padding, pointers are serialized as the contents they point to
+        std::string key;
+        AppendToKey(key, createInfo.attachmentCount);
+        AppendToKey(key, createInfo.pAttachments, createInfo.attachmentCount);
+
+        AppendToKey(key, createInfo.subpassCount);
+        for (const auto &subpass : span(createInfo.pSubpasses, createInfo.subpassCount)) {
+            AppendToKey(key, subpass.pipelineBindPoint);
+            AppendToKey(key, subpass.inputAttachmentCount);
+            AppendToKey(key, subpass.pInputAttachments, subpass.inputAttachmentCount);
+            AppendToKey(key, subpass.colorAttachmentCount);
+            AppendToKey(key, subpass.pColorAttachments, subpass.colorAttachmentCount);
+            if (subpass.pResolveAttachments)
+                AppendToKey(key, subpass.pResolveAttachments, subpass.colorAttachmentCount);
+            u32 hasDepthStencil{subpass.pDepthStencilAttachment != nullptr};
+            AppendToKey(key, hasDepthStencil);
+            if (hasDepthStencil)
+                AppendToKey(key, *subpass.pDepthStencilAttachment);
+            AppendToKey(key, subpass.preserveAttachmentCount);
+            AppendToKey(key, subpass.pPreserveAttachments, subpass.preserveAttachmentCount);
+        }
+
+        AppendToKey(key, createInfo.dependencyCount);
+        AppendToKey(key, createInfo.pDependencies, createInfo.dependencyCount);
+
+        std::scoped_lock lock(mutex);
+        auto it{renderPasses.find(key)};
+        if (it == renderPasses.end())
+            it = renderPasses.emplace(std::move(key), vk::raii::RenderPass(gpu.vkDevice, createInfo)).first;
+        return *it->second;
+    }
+
+    vk::Framebuffer RenderPassCache::GetFramebuffer(const vk::FramebufferCreateInfo &createInfo) {
+        std::string key;
+        AppendToKey(key, static_cast<VkRenderPass>(createInfo.renderPass));
+        AppendToKey(key, createInfo.width);
+        AppendToKey(key, createInfo.height);
+        AppendToKey(key, createInfo.layers);
+        AppendToKey(key, createInfo.pAttachments, createInfo.attachmentCount);
+
+        std::scoped_lock lock(mutex);
+        auto it{framebuffers.find(key)};
+        if (it == framebuffers.end())
+            it = framebuffers.emplace(std::move(key), Framebuffer{
+                .attachments = std::vector<vk::ImageView>(createInfo.pAttachments, createInfo.pAttachments + createInfo.attachmentCount),
+                .framebuffer = vk::raii::Framebuffer(gpu.vkDevice, createInfo),
+            }).first;
+        return *it->second.framebuffer;
+    }
+
+    void RenderPassCache::EvictFramebuffers(span<const vk::ImageView> views) {
+        std::scoped_lock lock(mutex);
+        std::erase_if(framebuffers, [&](const auto &entry) {
+            const auto &attachments{entry.second.attachments};
+            return std::find_first_of(attachments.begin(), attachments.end(), views.begin(), views.end()) != attachments.end();
+        });
+    }
+}
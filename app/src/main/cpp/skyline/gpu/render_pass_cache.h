@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief A cache of Vulkan render passes and framebuffers, the same set of attachments is generally used every frame so this avoids creating and destroying them for every render pass that is executed
+     * @note Render passes are cached on their complete description and are retained for the lifetime of the cache while framebuffers are cached on their render pass, attachments and extent then evicted when any of their attachments are destroyed
+     */
+    class RenderPassCache {
+      private:
+        /**
+         * @brief A cached framebuffer alongside the attachments it was created with for eviction
+         */
+        struct Framebuffer {
+            std::vector<vk::ImageView> attachments;
+            vk::raii::Framebuffer framebuffer;
+        };
+
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes access to the cached objects
+        std::unordered_map<std::string, vk::raii::RenderPass> renderPasses; //!< A map from a serialized render pass description to the render pass
+        std::unordered_map<std::string, Framebuffer> framebuffers; //!< A map from a serialized framebuffer description to the framebuffer
+
+      public:
+        RenderPassCache(GPU &gpu);
+
+        /**
+         * @return A pre-existing or newly created render pass which matches the supplied description
+         * @note All pointers in the create info are followed for the comparison, the render pass will be returned for any create info with equivalent contents
+         */
+        vk::RenderPass GetRenderPass(const vk::RenderPassCreateInfo &createInfo);
+
+        /**
+         * @return A pre-existing or newly created framebuffer which matches the supplied description
+         * @note The returned framebuffer is only valid till any of its attachments are destroyed
+         */
+        vk::Framebuffer GetFramebuffer(const vk::FramebufferCreateInfo &createInfo);
+
+        /**
+         * @brief Destroys all framebuffers that use any of the supplied image views as attachments, this must be called prior to the destruction of any image view that may have been used as an attachment
+         * @note The GPU must be done with any framebuffers using the views, this is the case when the texture owning them has been waited on
+         */
+        void EvictFramebuffers(span<const vk::ImageView> views);
+    };
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include "sampler_cache.h"
+
+namespace skyline::gpu {
+    SamplerCache::SamplerCache(GPU &gpu) : gpu(gpu) {}
+
+    vk::Sampler SamplerCache::GetSampler(const vk::SamplerCreateInfo &createInfo) {
+        if (createInfo.pNext)
+            throw exception("Cannot cache samplers with extension structures");
+
+        // Every member following pNext is a 32-bit field without any padding, these are serialized as-is
+        constexpr size_t DescriptionOffset{offsetof(VkSamplerCreateInfo, flags)};
+        static_assert(std::is_trivially_copyable_v<vk::SamplerCreateInfo> && sizeof(vk::SamplerCreateInfo) == sizeof(VkSamplerCreateInfo));
+        std::string key(reinterpret_cast<const char *>(&createInfo) + DescriptionOffset, sizeof(vk::SamplerCreateInfo) - DescriptionOffset);
+
+        std::scoped_lock lock(mutex);
+        auto it{samplers.find(key)};
+        if (it == samplers.end())
+            it = samplers.emplace(std::move(key), vk::raii::Sampler(gpu.vkDevice, createInfo)).first;
+        return *it->second;
+    }
+}
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief A global cache of Vulkan samplers, guest sampler pools contain many identical entries and the same samplers are rebound constantly so this deduplicates them across all pools and channels
+     * @note Samplers are cached on their complete description and are retained for the lifetime of the cache, drivers only allow a limited amount of samplers to exist at once which deduplication keeps the amount far below
+     */
+    class SamplerCache {
+      private:
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes access to the cached samplers
+        std::unordered_map<std::string, vk::raii::Sampler> samplers; //!< A map from a serialized sampler description to the sampler
+
+      public:
+        SamplerCache(GPU &gpu);
+
+        /**
+         * @return A pre-existing or newly created sampler which matches the supplied description
+         * @note Extension structures chained into the create info aren't supported as they aren't part of the comparison
+         */
+        vk::Sampler GetSampler(const vk::SamplerCreateInfo &createInfo);
+    };
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/host_affinity.h>
+#include <vfs/os_filesystem.h>
+#include <gpu.h>
+#include "shader_cache.h"
+
+namespace skyline::gpu {
+    static u64 HashData(span<const u8> data) {
+        return util::Hash(std::string_view(reinterpret_cast<const char *>(data.data()), data.size()));
+    }
+
+    ShaderCache::ShaderCache(GPU &gpu) : gpu(gpu) {}
+
+    ShaderCache::~ShaderCache() {
+        {
+            std::scoped_lock lock(mutex);
+            exiting = true;
+        }
+        if (preloadThread.joinable())
+            preloadThread.join();
+    }
+
+    u64 ShaderCache::GetKey(span<const u8> program, span<const u8> translationState) {
+        return HashData(program) ^ (HashData(translationState) * 0x9E3779B97F4A7C15); // The state hash is scrambled so identical program and state data don't cancel out
+    }
+
+    vk::ShaderModule ShaderCache::GetModule(Entry &entry) {
+        if (!entry.module)
+            entry.module.emplace(gpu.vkDevice, vk::ShaderModuleCreateInfo{
+                .codeSize = entry.spirv.size() * sizeof(u32),
+                .pCode = entry.spirv.data(),
+            });
+        return **entry.module;
+    }
+
+    void ShaderCache::Open(const std::string &path, u64 titleId) {
+        std::scoped_lock lock(mutex);
+        std::shared_ptr<vfs::FileSystem> cacheFileSystem;
+        try {
+            cacheFileSystem = std::make_shared<vfs::OsFileSystem>(path);
+        } catch (const std::exception &e) {
+            Logger::Warn("Shader cache is unavailable: {}", e.what());
+            return;
+        }
+        auto name{fmt::format("{:016X}.cache", titleId)};
+
+        try {
+            if (cacheFileSystem->FileExists(name)) {
+                backing = cacheFileSystem->OpenFile(name, {true, true, true});
+                auto header{backing->Read<CacheHeader>()};
+                CacheHeader expected{};
+                if (header.magic != expected.magic || header.version != expected.version) {
+                    Logger::Info("Discarding shader cache from a different version: {}", name);
+                    backing->Resize(0);
+                } else {
+                    // Entries are read till the end of the file or the first invalid entry, anything after it is truncated as it'd be from an interrupted write
+                    size_t offset{sizeof(CacheHeader)};
+                    while (offset + sizeof(EntryHeader) <= backing->size) {
+                        auto entryHeader{backing->Read<EntryHeader>(offset)};
+                        if (entryHeader.size % sizeof(u32) || entryHeader.size > backing->size - offset - sizeof(EntryHeader))
+                            break;
+
+                        std::vector<u32> spirv(entryHeader.size / sizeof(u32));
+                        backing->Read(span(spirv), offset + sizeof(EntryHeader));
+                        if (HashData(span(spirv).cast<u8>()) != entryHeader.hash)
+                            break;
+
+                        if (entries.try_emplace(entryHeader.key, Entry{std::move(spirv)}).second)
+                            preloadKeys.push_back(entryHeader.key);
+                        offset += sizeof(EntryHeader) + entryHeader.size;
+                    }
+
+                    if (offset != backing->size) {
+                        Logger::Warn("Truncating shader cache {} at an invalid entry: 0x{:X}/0x{:X}", name, offset, backing->size);
+                        backing->Resize(offset);
+                    }
+                    Logger::Info("Loaded shader cache {} ({} shaders)", name, entries.size());
+                }
+            } else {
+                if (!cacheFileSystem->CreateFile(name, 0))
+                    throw exception("Failed to create file");
+                backing = cacheFileSystem->OpenFile(name, {true, true, true});
+            }
+
+            if (backing->size == 0)
+                backing->WriteObject(CacheHeader{});
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to open shader cache {}: {}", name, e.what());
+            backing = nullptr;
+        }
+
+        if (!preloadKeys.empty())
+            preloadThread = std::thread(&ShaderCache::PreloadThread, this);
+    }
+
+    void ShaderCache::PreloadThread() {
+        pthread_setname_np(pthread_self(), "GPU-ShaderLoad");
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Background);
+
+        // Modules are created one at a time with the mutex unlocked in between so lookups from the GPU thread are never held up for long
+        for (size_t index{};; index++) {
+            std::scoped_lock lock(mutex);
+            if (exiting || index == preloadKeys.size())
+                break;
+
+            try {
+                GetModule(entries.at(preloadKeys[index]));
+            } catch (const std::exception &e) {
+                Logger::Warn("Failed to create shader module for 0x{:016X}: {}", preloadKeys[index], e.what());
+            }
+        }
+
+        std::scoped_lock lock(mutex);
+        preloadKeys.clear();
+        preloadKeys.shrink_to_fit();
+    }
+
+    std::optional<vk::ShaderModule> ShaderCache::Find(u64 key) {
+        std::scoped_lock lock(mutex);
+        auto it{entries.find(key)};
+        if (it == entries.end())
+            return std::nullopt;
+        return GetModule(it->second);
+    }
+
+    vk::ShaderModule ShaderCache::Insert(u64 key, std::vector<u32> &&spirv) {
+        std::scoped_lock lock(mutex);
+        auto [it, inserted]{entries.try_emplace(key, Entry{std::move(spirv)})};
+        if (inserted && backing) {
+            auto &entrySpirv{it->second.spirv};
+            auto data{span(entrySpirv).cast<u8>()};
+            EntryHeader entryHeader{
+                .key = key,
+                .size = data.size(),
+                .hash = HashData(data),
+            };
+
+            try {
+                size_t offset{backing->size};
+                backing->WriteObject(entryHeader, offset);
+                backing->Write(data, offset + sizeof(EntryHeader));
+            } catch (const std::exception &e) {
+                Logger::Warn("Failed to write shader cache entry: {}", e.what());
+            }
+        }
+        return GetModule(it->second);
+    }
+}
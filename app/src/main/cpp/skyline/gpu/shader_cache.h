@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <thread>
+#include <vulkan/vulkan_raii.hpp>
+#include <vfs/filesystem.h>
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief A cache of guest shaders translated to SPIR-V which is persisted to disk for every title, this avoids translating shaders which have been translated in a prior session again
+     * @note The cache only contains SPIR-V and is independent of the host GPU and driver, a cache file can be transferred between devices for the same title
+     * @note Entries are loaded when the cache is opened and their shader modules are created on a background thread so they're ready by the time they're first used
+     */
+    class ShaderCache {
+      private:
+        /**
+         * @brief The header of a cache file, it's followed by entries till the end of the file
+         */
+        struct CacheHeader {
+            u64 magic{util::MakeMagic<u64>("SKYSHCAC")};
+            u32 version{Version};
+            u32 _pad_{};
+        };
+
+        /**
+         * @brief The header of a single entry in the cache file, it's followed by the SPIR-V of the entry
+         */
+        struct EntryHeader {
+            u64 key;
+            u64 size; //!< The size of the SPIR-V in bytes
+            u64 hash; //!< A hash of the SPIR-V, this catches any entries which were partially written or corrupted
+        };
+
+        struct Entry {
+            std::vector<u32> spirv;
+            std::optional<vk::raii::ShaderModule> module; //!< The shader module created from the SPIR-V, this is created lazily on the first lookup if it hasn't been preloaded yet
+        };
+
+        static constexpr u32 Version{1}; //!< The version of the cache format and the shader translation, this must be incremented whenever translation output changes as all caches with a different version are discarded
+
+        GPU &gpu;
+        std::mutex mutex; //!< Synchronizes access to the entries and the cache file
+        std::unordered_map<u64, Entry> entries;
+        std::shared_ptr<vfs::Backing> backing; //!< The cache file which new entries are appended to, this is nullptr if the cache hasn't been opened or is unavailable
+        std::vector<u64> preloadKeys; //!< The keys of all entries loaded from the cache file, their modules are created by the preload thread
+        bool exiting{};
+        std::thread preloadThread;
+
+        /**
+         * @return The shader module for an entry, it's created from the SPIR-V if it doesn't exist yet
+         * @note The mutex must be locked prior to calling this
+         */
+        vk::ShaderModule GetModule(Entry &entry);
+
+        void PreloadThread();
+
+      public:
+        ShaderCache(GPU &gpu);
+
+        ~ShaderCache();
+
+        /**
+         * @return The key of a guest shader program which was translated with the supplied state, any state that affects the translation must be supplied as it's part of the key
+         */
+        static u64 GetKey(span<const u8> program, span<const u8> translationState);
+
+        /**
+         * @brief Loads a previously saved cache for a title and starts creating shader modules for its entries in the background
+         * @param path The path to the directory in which caches are stored
+         * @param titleId The ID of the title, titles without an ID all share a single cache
+         */
+        void Open(const std::string &path, u64 titleId);
+
+        /**
+         * @return The shader module for a previously translated shader or std::nullopt if the shader needs to be translated
+         */
+        std::optional<vk::ShaderModule> Find(u64 key);
+
+        /**
+         * @brief Inserts a newly translated shader into the cache and appends it to the cache file
+         * @return The shader module for the shader
+         */
+        vk::ShaderModule Insert(u64 key, std::vector<u32> &&spirv);
+    };
+}
@@ -3,99 +3,133 @@
 
 #pragma once
 
+#include <arm_neon.h>
+#include <common/thread_pool.h>
 #include "texture.h"
 
 namespace skyline::gpu {
-    /**
-     * @brief Copies the contents of a blocklinear guest texture to a linear output buffer
-     */
-    void CopyBlockLinearToLinear(GuestTexture &guest, u8 *guestInput, u8 *linearOutput) {
+    namespace detail {
         // Reference on Block-linear tiling: https://gist.github.com/PixelyIon/d9c35050af0ef5690566ca9f0965bc32
         constexpr u8 SectorWidth{16}; // The width of a sector in bytes
         constexpr u8 SectorHeight{2}; // The height of a sector in lines
         constexpr u8 GobWidth{64}; // The width of a GOB in bytes
         constexpr u8 GobHeight{8}; // The height of a GOB in lines
+        constexpr u32 GobSize{GobWidth * GobHeight}; // The size of a GOB in bytes
+
+        /**
+         * @brief Copies a single GOB between block-linear and linear memory
+         * @note The Morton-swizzled sectors of a GOB are laid out such that every 64 bytes of it are 32 contiguous bytes of two consecutive lines, as a result each 64 byte chunk is moved with a single 4-register load/store and two 2-register stores/loads
+         * @param linear A pointer to the top-left corner of the GOB in linear memory
+         * @param linearStride The distance between two lines in linear memory
+         */
+        template<bool BlockLinearToLinear>
+        inline void CopyGob(u8 *blockLinear, u8 *linear, u32 linearStride) {
+            constexpr u32 ChunkSize{SectorWidth * SectorHeight * 2}; // Two horizontally adjacent sectors
+            for (u32 chunk{}; chunk < GobSize / ChunkSize; chunk++, blockLinear += ChunkSize) {
+                u8 *line{linear + ((chunk & 0b11) * SectorHeight * linearStride) + ((chunk & 0b100) ? (GobWidth / 2) : 0)}; // Chunks 0-3 cover the left half of the GOB and chunks 4-7 cover the right half
+                if constexpr (BlockLinearToLinear) {
+                    auto sectors{vld1q_u8_x4(blockLinear)};
+                    vst1q_u8_x2(line, uint8x16x2_t{{sectors.val[0], sectors.val[2]}});
+                    vst1q_u8_x2(line + linearStride, uint8x16x2_t{{sectors.val[1], sectors.val[3]}});
+                } else {
+                    auto upper{vld1q_u8_x2(line)}, lower{vld1q_u8_x2(line + linearStride)};
+                    vst1q_u8_x4(blockLinear, uint8x16x4_t{{upper.val[0], lower.val[0], upper.val[1], lower.val[1]}});
+                }
+            }
+        }
 
-        u32 blockHeight{guest.tileConfig.blockHeight}; //!< The height of the blocks in GOBs
-        u32 robHeight{GobHeight * blockHeight}; //!< The height of a single ROB (Row of Blocks) in lines
-        u32 surfaceHeight{guest.dimensions.height / guest.format->blockHeight}; //!< The height of the surface in lines
-        u32 surfaceHeightRobs{util::AlignUp(surfaceHeight, robHeight) / robHeight}; //!< The height of the surface in ROBs (Row Of Blocks)
-        u32 robWidthBytes{util::AlignUp((guest.dimensions.width / guest.format->blockWidth) * guest.format->bpb, GobWidth)}; //!< The width of a ROB in bytes
-        u32 robWidthBlocks{robWidthBytes / GobWidth}; //!< The width of a ROB in blocks (and GOBs because block width == 1 on the Tegra X1)
-        u32 robBytes{robWidthBytes * robHeight}; //!< The size of a ROB in bytes
-        u32 gobYOffset{robWidthBytes * GobHeight}; //!< The offset of the next Y-axis GOB from the current one in linear space
-
-        auto inputSector{guestInput};
-        auto outputRob{linearOutput};
-
-        for (u32 rob{}, y{}, paddingY{}; rob < surfaceHeightRobs; rob++) { // Every Surface contains `surfaceHeightRobs` ROBs
-            auto outputBlock{outputRob}; // We iterate through a block independently of the ROB
-            for (u32 block{}; block < robWidthBlocks; block++) { // Every ROB contains `surfaceWidthBlocks` Blocks
-                auto outputGob{outputBlock}; // We iterate through a GOB independently of the block
-                for (u32 gobY{}; gobY < blockHeight; gobY++) { // Every Block contains `blockHeight` Y-axis GOBs
-                    for (u32 index{}; index < SectorWidth * SectorHeight; index++) { // Every Y-axis GOB contains `sectorWidth * sectorHeight` sectors
-                        u32 xT{((index << 3) & 0b10000) | ((index << 1) & 0b100000)}; // Morton-Swizzle on the X-axis
-                        u32 yT{((index >> 1) & 0b110) | (index & 0b1)}; // Morton-Swizzle on the Y-axis
-                        std::memcpy(outputGob + (yT * robWidthBytes) + xT, inputSector, SectorWidth);
-                        inputSector += SectorWidth; // `sectorWidth` bytes are of sequential image data
+        /**
+         * @return The distance between layers of a block-linear guest texture in bytes, this is derived from the layer size when the guest doesn't supply it
+         */
+        inline size_t GetBlockLinearLayerStride(const GuestTexture &guest) {
+            if (guest.layerStride)
+                return guest.layerStride;
+
+            u32 robHeight{GobHeight * guest.tileConfig.blockHeight};
+            u32 surfaceHeight{guest.dimensions.height / guest.format->blockHeight};
+            u32 robWidthBytes{util::AlignUp((guest.dimensions.width / guest.format->blockWidth) * guest.format->bpb, GobWidth)};
+            return static_cast<size_t>(robWidthBytes) * robHeight * (util::AlignUp(surfaceHeight, robHeight) / robHeight);
+        }
+
+        constexpr size_t ParallelCopyChunkSize{0x200000}; //!< The minimum amount of bytes that each thread copies for a block-linear texture to be copied concurrently, this amortizes the cost of spawning threads
+
+        /**
+         * @brief Copies the contents of a range of layers of a blocklinear guest texture from or to a linear buffer with tightly packed layers
+         * @param blockLinear A pointer to the first layer of the guest texture
+         * @param linear A pointer to the linear buffer, it starts at the base layer of the range
+         * @param layerCount The amount of layers to copy, all layers from the base layer are copied if this is 0
+         * @note Large textures are split into ranges of ROBs across all layers which are copied concurrently across host threads, these are joined prior to returning
+         */
+        template<bool BlockLinearToLinear>
+        void CopyBlockLinear(GuestTexture &guest, u8 *blockLinear, u8 *linear, u32 baseLayer, u32 layerCount) {
+            u32 blockHeight{guest.tileConfig.blockHeight}; //!< The height of the blocks in GOBs
+            u32 robHeight{GobHeight * blockHeight}; //!< The height of a single ROB (Row of Blocks) in lines
+            u32 surfaceHeight{guest.dimensions.height / guest.format->blockHeight}; //!< The height of the surface in lines
+            u32 surfaceHeightRobs{util::AlignUp(surfaceHeight, robHeight) / robHeight}; //!< The height of the surface in ROBs (Row Of Blocks)
+            u32 robWidthBytes{util::AlignUp((guest.dimensions.width / guest.format->blockWidth) * guest.format->bpb, GobWidth)}; //!< The width of a ROB in bytes
+            u32 robWidthBlocks{robWidthBytes / GobWidth}; //!< The width of a ROB in blocks (and GOBs because block width == 1 on the Tegra X1)
+            u32 robBytes{robWidthBytes * robHeight}; //!< The size of a ROB in bytes
+            u32 gobYOffset{robWidthBytes * GobHeight}; //!< The offset of the next Y-axis GOB from the current one in linear space
+
+            if (!layerCount)
+                layerCount = std::max<u32>(guest.layerCount, 1) - baseLayer;
+            size_t blockLinearLayerStride{GetBlockLinearLayerStride(guest)}; //!< The distance between layers in block-linear memory
+            size_t linearLayerStride{guest.format->GetSize(guest.dimensions)}; //!< The distance between layers in the linear buffer, layers are tightly packed as expected by buffer <-> image copies
+            blockLinear += baseLayer * blockLinearLayerStride;
+
+            // Every ROB is at the same offset in block-linear and linear memory within a layer as blocks are always fully sized in block-linear memory, this allows copying any ROB of any layer independently
+            auto copyRobs{[&](u32 firstRob, u32 endRob) {
+                for (u32 index{firstRob}; index < endRob; index++) { // Every layer contains `surfaceHeightRobs` ROBs
+                    u32 layer{index / surfaceHeightRobs}, rob{index % surfaceHeightRobs};
+                    u32 gobCount{rob ? std::min(blockHeight, (surfaceHeight - (rob * robHeight)) / GobHeight) : blockHeight}; // The amount of Y GOBs which aren't padding
+                    u32 paddingY{(blockHeight - gobCount) * GobSize}; // The amount of padding between contiguous GOBs
+
+                    auto gob{blockLinear + (layer * blockLinearLayerStride) + (static_cast<size_t>(rob) * robBytes)};
+                    auto linearBlock{linear + (layer * linearLayerStride) + (static_cast<size_t>(rob) * robBytes)}; // We iterate through a block independently of the ROB
+                    for (u32 block{}; block < robWidthBlocks; block++) { // Every ROB contains `surfaceWidthBlocks` Blocks
+                        auto linearGob{linearBlock}; // We iterate through a GOB independently of the block
+                        for (u32 gobY{}; gobY < gobCount; gobY++) { // Every Block contains `blockHeight` Y-axis GOBs
+                            CopyGob<BlockLinearToLinear>(gob, linearGob, robWidthBytes);
+                            gob += GobSize; // GOBs are sequential in block-linear memory
+                            linearGob += gobYOffset; // Increment the linear GOB to the next Y-axis GOB
+                        }
+                        gob += paddingY; // Skip over the GOBs in the block which are padding
+                        linearBlock += GobWidth; // Increment the linear block to the next block (As Block Width = 1 GOB Width)
                     }
-                    outputGob += gobYOffset; // Increment the output GOB to the next Y-axis GOB
                 }
-                inputSector += paddingY; // Increment the input sector to the next sector
-                outputBlock += GobWidth; // Increment the output block to the next block (As Block Width = 1 GOB Width)
+            }};
+
+            u32 robCount{surfaceHeightRobs * layerCount};
+            size_t threadCount{std::clamp<size_t>((static_cast<size_t>(robBytes) * robCount) / ParallelCopyChunkSize, 1, std::min(ThreadPool::Get().GetWorkerCount(), static_cast<size_t>(robCount)))};
+            if (layerCount > 1 && linearLayerStride < static_cast<size_t>(robBytes) * surfaceHeightRobs)
+                threadCount = 1; // Unaligned layers overlap in the linear buffer, they need to be copied in order for later layers to overwrite the padding of earlier ones
+            if (threadCount == 1) {
+                copyRobs(0, robCount);
+                return;
             }
-            outputRob += robBytes; // Increment the output block to the next ROB
 
-            y += robHeight; // Increment the Y position to the next ROB
-            blockHeight = static_cast<u8>(std::min(static_cast<u32>(blockHeight), (surfaceHeight - y) / GobHeight)); // Calculate the amount of Y GOBs which aren't padding
-            paddingY = (guest.tileConfig.blockHeight - blockHeight) * (SectorWidth * SectorWidth * SectorHeight); // Calculate the amount of padding between contiguous sectors
+            u32 robsPerThread{(robCount + static_cast<u32>(threadCount) - 1) / static_cast<u32>(threadCount)};
+            ThreadPool::Get().ParallelFor((robCount + robsPerThread - 1) / robsPerThread, [&](size_t range) {
+                u32 firstRob{static_cast<u32>(range) * robsPerThread};
+                copyRobs(firstRob, std::min(firstRob + robsPerThread, robCount));
+            });
         }
     }
 
     /**
      * @brief Copies the contents of a blocklinear guest texture to a linear output buffer
+     * @param baseLayer The first layer to copy, the output buffer starts at this layer
+     * @param layerCount The amount of layers to copy, all layers from the base layer are copied if this is 0
      */
-    void CopyLinearToBlockLinear(GuestTexture &guest, u8 *linearInput, u8 *guestOutput) {
-        // Reference on Block-linear tiling: https://gist.github.com/PixelyIon/d9c35050af0ef5690566ca9f0965bc32
-        constexpr u8 SectorWidth{16}; // The width of a sector in bytes
-        constexpr u8 SectorHeight{2}; // The height of a sector in lines
-        constexpr u8 GobWidth{64}; // The width of a GOB in bytes
-        constexpr u8 GobHeight{8}; // The height of a GOB in lines
-
-        u32 blockHeight{guest.tileConfig.blockHeight}; //!< The height of the blocks in GOBs
-        u32 robHeight{GobHeight * blockHeight}; //!< The height of a single ROB (Row of Blocks) in lines
-        u32 surfaceHeight{guest.dimensions.height / guest.format->blockHeight}; //!< The height of the surface in lines
-        u32 surfaceHeightRobs{util::AlignUp(surfaceHeight, robHeight) / robHeight}; //!< The height of the surface in ROBs (Row Of Blocks)
-        u32 robWidthBytes{util::AlignUp((guest.dimensions.width / guest.format->blockWidth) * guest.format->bpb, GobWidth)}; //!< The width of a ROB in bytes
-        u32 robWidthBlocks{robWidthBytes / GobWidth}; //!< The width of a ROB in blocks (and GOBs because block width == 1 on the Tegra X1)
-        u32 robBytes{robWidthBytes * robHeight}; //!< The size of a ROB in bytes
-        u32 gobYOffset{robWidthBytes * GobHeight}; //!< The offset of the next Y-axis GOB from the current one in linear space
-
-        auto outputSector{guestOutput};
-        auto inputRob{linearInput};
-
-        for (u32 rob{}, y{}, paddingY{}; rob < surfaceHeightRobs; rob++) { // Every Surface contains `surfaceHeightRobs` ROBs
-            auto outputBlock{inputRob}; // We iterate through a block independently of the ROB
-            for (u32 block{}; block < robWidthBlocks; block++) { // Every ROB contains `surfaceWidthBlocks` Blocks
-                auto inputGob{outputBlock}; // We iterate through a GOB independently of the block
-                for (u32 gobY{}; gobY < blockHeight; gobY++) { // Every Block contains `blockHeight` Y-axis GOBs
-                    for (u32 index{}; index < SectorWidth * SectorHeight; index++) { // Every Y-axis GOB contains `sectorWidth * sectorHeight` sectors
-                        u32 xT{((index << 3) & 0b10000) | ((index << 1) & 0b100000)}; // Morton-Swizzle on the X-axis
-                        u32 yT{((index >> 1) & 0b110) | (index & 0b1)}; // Morton-Swizzle on the Y-axis
-                        std::memcpy(outputSector, inputGob + (yT * robWidthBytes) + xT, SectorWidth);
-                        outputSector += SectorWidth; // `sectorWidth` bytes are of sequential image data
-                    }
-                    inputGob += gobYOffset; // Increment the output GOB to the next Y-axis GOB
-                }
-                outputSector += paddingY; // Increment the input sector to the next sector
-                outputBlock += GobWidth; // Increment the output block to the next block (As Block Width = 1 GOB Width)
-            }
-            inputRob += robBytes; // Increment the output block to the next ROB
+    inline void CopyBlockLinearToLinear(GuestTexture &guest, u8 *guestInput, u8 *linearOutput, u32 baseLayer = 0, u32 layerCount = 0) {
+        detail::CopyBlockLinear<true>(guest, guestInput, linearOutput, baseLayer, layerCount);
+    }
 
-            y += robHeight; // Increment the Y position to the next ROB
-            blockHeight = static_cast<u8>(std::min(static_cast<u32>(blockHeight), (surfaceHeight - y) / GobHeight)); // Calculate the amount of Y GOBs which aren't padding
-            paddingY = (guest.tileConfig.blockHeight - blockHeight) * (SectorWidth * SectorWidth * SectorHeight); // Calculate the amount of padding between contiguous sectors
-        }
+    /**
+     * @brief Copies the contents of a linear buffer to a blocklinear guest texture
+     */
+    inline void CopyLinearToBlockLinear(GuestTexture &guest, u8 *linearInput, u8 *guestOutput) {
+        detail::CopyBlockLinear<false>(guest, guestOutput, linearInput, 0, 0);
     }
 
     /**
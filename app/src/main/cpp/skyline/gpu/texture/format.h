@@ -40,6 +40,22 @@ namespace skyline::gpu::format {
     constexpr Format R16G16B16A16Sint{sizeof(u16) * 4, vkf::eR16G16B16A16Sint};
     constexpr Format R16G16B16A16Uint{sizeof(u16) * 4, vkf::eR16G16B16A16Uint};
     constexpr Format R16G16B16A16Float{sizeof(u16) * 4, vkf::eR16G16B16A16Sfloat};
+    constexpr Format BC1Unorm{sizeof(u64), vkf::eBc1RgbaUnormBlock, .blockHeight = 4, .blockWidth = 4};
+    constexpr Format BC2Unorm{sizeof(u64) * 2, vkf::eBc2UnormBlock, .blockHeight = 4, .blockWidth = 4};
+    constexpr Format BC3Unorm{sizeof(u64) * 2, vkf::eBc3UnormBlock, .blockHeight = 4, .blockWidth = 4};
+    constexpr Format BC4Unorm{sizeof(u64), vkf::eBc4UnormBlock, .blockHeight = 4, .blockWidth = 4};
+    constexpr Format BC5Unorm{sizeof(u64) * 2, vkf::eBc5UnormBlock, .blockHeight = 4, .blockWidth = 4};
+    constexpr Format BC7Unorm{sizeof(u64) * 2, vkf::eBc7UnormBlock, .blockHeight = 4, .blockWidth = 4};
+
+    /**
+     * @brief All formats above, this is used to determine the formats a mutable-format texture may be viewed in
+     */
+    constexpr std::array<const Format *, 32> AllFormats{
+        &R8G8B8A8Unorm, &R5G6B5Unorm, &A2B10G10R10Unorm, &A8B8G8R8Srgb, &A8B8G8R8Snorm, &R16G16Unorm, &R16G16Snorm, &R16G16Sint, &R16G16Uint, &R16G16Float, &B10G11R11Float, &R32Float,
+        &R8G8Unorm, &R8G8Snorm, &R16Unorm, &R16Float, &R8Unorm, &R8Snorm, &R8Sint, &R8Uint, &R32B32G32A32Float,
+        &R16G16B16A16Unorm, &R16G16B16A16Snorm, &R16G16B16A16Sint, &R16G16B16A16Uint, &R16G16B16A16Float,
+        &BC1Unorm, &BC2Unorm, &BC3Unorm, &BC4Unorm, &BC5Unorm, &BC7Unorm,
+    };
 
     /**
      * @brief Converts a Vulkan format to a Skyline format
@@ -96,6 +112,18 @@ namespace skyline::gpu::format {
                 return R16G16B16A16Uint;
             case vk::Format::eR16G16B16A16Sfloat:
                 return R16G16B16A16Float;
+            case vk::Format::eBc1RgbaUnormBlock:
+                return BC1Unorm;
+            case vk::Format::eBc2UnormBlock:
+                return BC2Unorm;
+            case vk::Format::eBc3UnormBlock:
+                return BC3Unorm;
+            case vk::Format::eBc4UnormBlock:
+                return BC4Unorm;
+            case vk::Format::eBc5UnormBlock:
+                return BC5Unorm;
+            case vk::Format::eBc7UnormBlock:
+                return BC7Unorm;
             default:
                 throw exception("Vulkan format not supported: '{}'", vk::to_string(format));
         }
@@ -5,19 +5,56 @@
 #include <common/trace.h>
 #include <kernel/types/KProcess.h>
 #include "texture.h"
+#include "format.h"
 #include "copy.h"
 
 namespace skyline::gpu {
-    std::shared_ptr<memory::StagingBuffer> Texture::SynchronizeHostImpl(const std::shared_ptr<FenceCycle> &pCycle) {
+    u64 Texture::GetGuestLayerMask(u8 *pointer, size_t size) {
+        if (!guest || guest->mappings.size() != 1 || layerCount <= 1 || guest->tileConfig.mode != texture::TileMode::Block)
+            return AllLayers;
+
+        auto mapping{guest->mappings[0]};
+        auto begin{std::max(pointer, mapping.data())}, end{std::min(pointer + size, mapping.data() + mapping.size())};
+        if (begin >= end)
+            return 0;
+
+        // Any padding after a layer is attributed to it, writes to it are conservatively treated as writes to the layer
+        auto layerStride{detail::GetBlockLinearLayerStride(*guest)};
+        if (!layerStride)
+            return AllLayers;
+        auto firstLayer{std::min<size_t>(static_cast<size_t>(begin - mapping.data()) / layerStride, 63)};
+        auto lastLayer{std::min<size_t>(static_cast<size_t>(end - mapping.data() - 1) / layerStride, 63)};
+        return (lastLayer == 63 ? AllLayers : ((1ULL << (lastLayer + 1)) - 1)) & ~((1ULL << firstLayer) - 1);
+    }
+
+    std::shared_ptr<memory::StagingBuffer> Texture::SynchronizeHostImpl(const std::shared_ptr<FenceCycle> &pCycle, u32 &baseLayer, u32 &syncLayerCount) {
         if (!guest)
             throw exception("Synchronization of host textures requires a valid guest texture to synchronize from");
-        else if (guest->dimensions != dimensions)
-            throw exception("Guest and host dimensions being different is not supported currently");
+        else if (IsScaled())
+            return nullptr; // Scaled textures are only written to by the host, any guest writes to them are discarded
         else if (guest->mappings.size() > 1)
             throw exception("Synchronizing textures across {} mappings is not supported", guest->mappings.size());
 
+        auto dirtyLayers{gpu.writeTracker.Protect(*this)};
+        if (!dirtyLayers)
+            return nullptr; // The guest hasn't written to the texture since it was last synchronized
+
+        // Only the range of layers spanning all dirty layers is synchronized, decoded textures are always decoded in their entirety
+        baseLayer = 0;
+        syncLayerCount = layerCount;
+        if (dirtyLayers != AllLayers && !decoded && guest->tileConfig.mode == texture::TileMode::Block) {
+            baseLayer = static_cast<u32>(std::countr_zero(dirtyLayers));
+            u32 lastLayer{static_cast<u32>(63 - std::countl_zero(dirtyLayers))};
+            syncLayerCount = (lastLayer == 63 ? layerCount : std::min(lastLayer + 1, layerCount)) - std::min(baseLayer, layerCount);
+            if (!syncLayerCount) {
+                baseLayer = 0;
+                syncLayerCount = layerCount;
+            }
+        }
+
         auto pointer{guest->mappings[0].data()};
-        auto size{format->GetSize(dimensions)};
+        auto layerSize{guest->format->GetSize(dimensions)}; // The guest format is used as the host format differs for decoded textures
+        auto size{layerSize * syncLayerCount};
 
         WaitOnBacking();
 
@@ -30,7 +67,7 @@ namespace skyline::gpu {
                 return stagingBuffer;
             } else if (tiling == vk::ImageTiling::eLinear) {
                 // We can optimize linear texture sync on a UMA by mapping the texture onto the CPU and copying directly into it rather than a staging buffer
-                bufferData = std::get<memory::Image>(backing).data();
+                bufferData = std::get<memory::Image>(backing).data() + (layerSize * baseLayer);
                 if (cycle.lock() != pCycle)
                     WaitOnFence();
                 return nullptr;
@@ -40,7 +77,7 @@ namespace skyline::gpu {
         }()};
 
         if (guest->tileConfig.mode == texture::TileMode::Block)
-            CopyBlockLinearToLinear(*guest, pointer, bufferData);
+            CopyBlockLinearToLinear(*guest, pointer, bufferData, baseLayer, syncLayerCount);
         else if (guest->tileConfig.mode == texture::TileMode::Pitch)
             CopyPitchLinearToLinear(*guest, pointer, bufferData);
         else if (guest->tileConfig.mode == texture::TileMode::Linear)
@@ -52,7 +89,7 @@ namespace skyline::gpu {
         return stagingBuffer;
     }
 
-    void Texture::CopyFromStagingBuffer(const vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<memory::StagingBuffer> &stagingBuffer) {
+    void Texture::CopyFromStagingBuffer(const vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<memory::StagingBuffer> &stagingBuffer, u32 baseLayer, u32 copyLayerCount, std::vector<std::shared_ptr<FenceCycleDependency>> &dependencies) {
         auto image{GetBacking()};
         if (layout == vk::ImageLayout::eUndefined)
             commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, vk::ImageMemoryBarrier{
@@ -70,11 +107,18 @@ namespace skyline::gpu {
                 },
             });
 
+        if (decoded) {
+            gpu.textureDecoder.Decode(commandBuffer, *this, *stagingBuffer, dependencies);
+            return;
+        }
+
         commandBuffer.copyBufferToImage(stagingBuffer->vkBuffer, image, layout, vk::BufferImageCopy{
+            .bufferOffset = stagingBuffer->offset,
             .imageExtent = dimensions,
             .imageSubresource = {
                 .aspectMask = format->vkAspect,
-                .layerCount = layerCount,
+                .baseArrayLayer = baseLayer,
+                .layerCount = copyLayerCount,
             },
         });
     }
@@ -97,6 +141,7 @@ namespace skyline::gpu {
         });
 
         commandBuffer.copyImageToBuffer(image, layout, stagingBuffer->vkBuffer, vk::BufferImageCopy{
+            .bufferOffset = stagingBuffer->offset,
             .imageExtent = dimensions,
             .imageSubresource = {
                 .aspectMask = format->vkAspect,
@@ -110,12 +155,12 @@ namespace skyline::gpu {
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .buffer = stagingBuffer->vkBuffer,
-            .offset = 0,
+            .offset = stagingBuffer->offset,
             .size = stagingBuffer->size(),
         }, {});
     }
 
-    void Texture::CopyToGuest(u8 *hostBuffer) {
+    void Texture::CopyToGuestImpl(u8 *hostBuffer) {
         auto guestOutput{guest->mappings[0].data()};
         auto size{format->GetSize(dimensions)};
 
@@ -127,10 +172,28 @@ namespace skyline::gpu {
             std::memcpy(hostBuffer, guestOutput, format->GetSize(dimensions));
     }
 
+    void Texture::CopyToGuest(u8 *hostBuffer) {
+        gpu.writeTracker.Unprotect(*this);
+        CopyToGuestImpl(hostBuffer);
+        gpu.writeTracker.Protect(*this); // The guest memory now matches the host texture, only overlapping textures need to be synchronized from it
+    }
+
     Texture::TextureBufferCopy::TextureBufferCopy(std::shared_ptr<Texture> texture, std::shared_ptr<memory::StagingBuffer> stagingBuffer) : texture(std::move(texture)), stagingBuffer(std::move(stagingBuffer)) {}
 
     Texture::TextureBufferCopy::~TextureBufferCopy() {
-        texture->CopyToGuest(stagingBuffer ? stagingBuffer->data() : std::get<memory::Image>(texture->backing).data());
+        if (stagingBuffer)
+            texture->gpu.writeTracker.DeferWriteback(*texture, std::move(stagingBuffer)); // The guest rarely reads back render targets on the CPU, the writeback only happens once it accesses them
+        else
+            texture->CopyToGuest(std::get<memory::Image>(texture->backing).data());
+    }
+
+    static std::atomic<i64> liveTextureCount{}; //!< The amount of textures which are currently alive, this is only used for tracing
+
+    /**
+     * @brief Adjusts the live texture count by the supplied amount and emits the updated value to the trace
+     */
+    static void UpdateTextureCount(i64 delta) {
+        TRACE_COUNTER("gpu", "Texture Count", liveTextureCount.fetch_add(delta, std::memory_order_relaxed) + delta);
     }
 
     Texture::Texture(GPU &gpu, BackingType &&backing, GuestTexture guest, texture::Dimensions dimensions, texture::Format format, vk::ImageLayout layout, vk::ImageTiling tiling, u32 mipLevels, u32 layerCount, vk::SampleCountFlagBits sampleCount)
@@ -144,8 +207,10 @@ namespace skyline::gpu {
           mipLevels(mipLevels),
           layerCount(layerCount),
           sampleCount(sampleCount) {
+        gpu.writeTracker.Track(*this);
         if (GetBacking())
             SynchronizeHost();
+        UpdateTextureCount(1);
     }
 
     Texture::Texture(GPU &gpu, BackingType &&backing, texture::Dimensions dimensions, texture::Format format, vk::ImageLayout layout, vk::ImageTiling tiling, u32 mipLevels, u32 layerCount, vk::SampleCountFlagBits sampleCount)
@@ -157,34 +222,106 @@ namespace skyline::gpu {
           tiling(tiling),
           mipLevels(mipLevels),
           layerCount(layerCount),
-          sampleCount(sampleCount) {}
+          sampleCount(sampleCount) {
+        UpdateTextureCount(1);
+    }
+
+    /**
+     * @return The supplied dimensions with the width and height scaled by the supplied factor, depth is never scaled
+     */
+    static texture::Dimensions ScaleDimensions(texture::Dimensions dimensions, float scale) {
+        if (scale == 1.0f)
+            return dimensions;
+
+        auto scaleDimension{[scale](u32 value) {
+            return std::max(static_cast<u32>(std::lround(static_cast<float>(value) * scale)), 1U);
+        }};
+        return texture::Dimensions(scaleDimension(dimensions.width), dimensions.height > 1 ? scaleDimension(dimensions.height) : dimensions.height, dimensions.depth);
+    }
 
-    Texture::Texture(GPU &pGpu, GuestTexture pGuest)
+    Texture::Texture(GPU &pGpu, GuestTexture pGuest, float scale, bool presentable)
         : gpu(pGpu),
           guest(std::move(pGuest)),
-          dimensions(guest->dimensions),
+          dimensions(ScaleDimensions(guest->dimensions, scale)),
           format(guest->format),
           layout(vk::ImageLayout::eUndefined),
           tiling((guest->tileConfig.mode == texture::TileMode::Block) ? vk::ImageTiling::eOptimal : vk::ImageTiling::eLinear),
           mipLevels(1),
           layerCount(guest->layerCount),
           sampleCount(vk::SampleCountFlagBits::e1) {
+        gpu.writeTracker.Track(*this);
+
+        // Compressed formats which the host GPU can't sample are decoded into an uncompressed format by a compute shader which writes to the image directly
+        vk::ImageUsageFlags usage{vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst};
+        if (format->IsCompressed()) {
+            if (auto decodedFormat{TextureDecoder::GetDecodedFormat(format)}; decodedFormat && !gpu.textureDecoder.IsSupported(format)) {
+                format = decodedFormat;
+                tiling = vk::ImageTiling::eOptimal; // Decoded textures are always uploaded through a staging buffer
+                decoded = true;
+                usage |= vk::ImageUsageFlagBits::eStorage;
+            }
+            usage |= vk::ImageUsageFlagBits::eSampled;
+        } else {
+            usage |= vk::ImageUsageFlagBits::eColorAttachment;
+        }
+
+        // Small block-linear textures are backed by linear images in device-local host-visible memory on UMA GPUs, they're deswizzled directly into the mapping of the image on every synchronization rather than into a staging buffer that's copied into the image
+        bool blockLinear{guest->tileConfig.mode == texture::TileMode::Block};
+        if (blockLinear && !presentable && !format->IsCompressed() && guest->layerCount == 1 && guest->dimensions.GetType() == vk::ImageType::e2D && !IsScaled()) {
+            bool aligned{format->GetSize(dimensions.width, 1) % detail::GobWidth == 0 && dimensions.height % detail::GobHeight == 0}; // The deswizzle writes entire GOBs, rows must be tightly packed and the image must end on a GOB boundary
+            if (aligned && format->GetSize(dimensions) <= LinearBackingMaxSize && gpu.memory.IsUnifiedMemory()) {
+                constexpr vk::FormatFeatureFlags RequiredFeatures{vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eTransferSrc | vk::FormatFeatureFlagBits::eTransferDst};
+                if ((gpu.vkPhysicalDevice.getFormatProperties(format->vkFormat).linearTilingFeatures & RequiredFeatures) == RequiredFeatures)
+                    tiling = vk::ImageTiling::eLinear;
+            }
+        }
+
+        // Uncompressed textures are created with a mutable format so a guest texture sampled as a different texel-compatible format (as is common with render targets in post-processing) is only a view in that format rather than a copy
+        // The formats it can be viewed in are supplied so the driver doesn't need to disable any framebuffer compression on the image to support arbitrary formats
+        bool hardwareBuffer{presentable && gpu.supportsHardwareBuffers && tiling == vk::ImageTiling::eOptimal && guest->format->vkFormat == vk::Format::eR8G8B8A8Unorm && guest->layerCount == 1};
+        mutableFormat = !decoded && !guest->format->IsCompressed() && !hardwareBuffer; // Decoded textures are viewed through the guest format by callers but their backing is in the decoded format, they can't be viewed in any other format
+        std::vector<vk::Format> viewFormats;
+        if (mutableFormat && gpu.supportsImageFormatList) {
+            viewFormats.push_back(format->vkFormat);
+            for (auto viewFormat : format::AllFormats)
+                if (*viewFormat != *format && viewFormat->IsCompatible(*format))
+                    viewFormats.push_back(viewFormat->vkFormat);
+        }
+        vk::ImageFormatListCreateInfoKHR formatList{
+            .viewFormatCount = static_cast<u32>(viewFormats.size()),
+            .pViewFormats = viewFormats.data(),
+        };
+
         vk::ImageCreateInfo imageCreateInfo{
+            .pNext = viewFormats.empty() ? nullptr : &formatList,
+            .flags = mutableFormat ? vk::ImageCreateFlagBits::eMutableFormat : vk::ImageCreateFlags{},
             .imageType = guest->dimensions.GetType(),
-            .format = *guest->format,
-            .extent = guest->dimensions,
+            .format = *format,
+            .extent = dimensions,
             .mipLevels = 1,
             .arrayLayers = guest->layerCount,
             .samples = vk::SampleCountFlagBits::e1,
             .tiling = tiling,
-            .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .queueFamilyIndexCount = 1,
-            .pQueueFamilyIndices = &gpu.vkQueueFamilyIndex,
+            .usage = usage,
             .initialLayout = layout,
         };
-        backing = tiling != vk::ImageTiling::eLinear ? gpu.memory.AllocateImage(imageCreateInfo) : gpu.memory.AllocateMappedImage(imageCreateInfo);
+        gpu.SetQueueSharing(imageCreateInfo);
+        if (hardwareBuffer)
+            backing = gpu.memory.AllocateHardwareBufferImage(imageCreateInfo);
+        else
+            backing = tiling != vk::ImageTiling::eLinear ? gpu.memory.AllocateImage(imageCreateInfo) : gpu.memory.AllocateMappedImage(imageCreateInfo);
+
+        if (blockLinear && tiling == vk::ImageTiling::eLinear) {
+            // The driver may pad the rows of linear images, the image is reallocated with optimal tiling if the layout doesn't match the deswizzled data
+            auto subresourceLayout{(*gpu.vkDevice).getImageSubresourceLayout(GetBacking(), vk::ImageSubresource{.aspectMask = format->vkAspect}, *gpu.vkDevice.getDispatcher())};
+            if (subresourceLayout.offset != 0 || subresourceLayout.rowPitch != format->GetSize(dimensions.width, 1)) {
+                tiling = imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
+                backing = gpu.memory.AllocateImage(imageCreateInfo);
+            }
+        }
+
         TransitionLayout(vk::ImageLayout::eGeneral);
+        UpdateTextureCount(1);
     }
 
     Texture::Texture(GPU &gpu, texture::Dimensions dimensions, texture::Format format, vk::ImageLayout initialLayout, vk::ImageUsageFlags usage, vk::ImageTiling tiling, u32 mipLevels, u32 layerCount, vk::SampleCountFlagBits sampleCount)
@@ -205,14 +342,13 @@ namespace skyline::gpu {
             .samples = sampleCount,
             .tiling = tiling,
             .usage = usage | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .queueFamilyIndexCount = 1,
-            .pQueueFamilyIndices = &gpu.vkQueueFamilyIndex,
             .initialLayout = layout,
         };
+        gpu.SetQueueSharing(imageCreateInfo);
         backing = tiling != vk::ImageTiling::eLinear ? gpu.memory.AllocateImage(imageCreateInfo) : gpu.memory.AllocateMappedImage(imageCreateInfo);
         if (initialLayout != layout)
             TransitionLayout(initialLayout);
+        UpdateTextureCount(1);
     }
 
     bool Texture::WaitOnBacking() {
@@ -254,7 +390,7 @@ namespace skyline::gpu {
         TRACE_EVENT("gpu", "Texture::TransitionLayout");
 
         if (layout != pLayout)
-            cycle = gpu.scheduler.Submit([&](vk::raii::CommandBuffer &commandBuffer) {
+            cycle = gpu.scheduler.SubmitDeferred([&](vk::raii::CommandBuffer &commandBuffer) {
                 commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, vk::ImageMemoryBarrier{
                     .image = GetBacking(),
                     .srcAccessMask = vk::AccessFlagBits::eNoneKHR,
@@ -275,12 +411,20 @@ namespace skyline::gpu {
     void Texture::SynchronizeHost() {
         TRACE_EVENT("gpu", "Texture::SynchronizeHost");
 
-        auto stagingBuffer{SynchronizeHostImpl(nullptr)};
+        u32 baseLayer, syncLayerCount;
+        auto stagingBuffer{SynchronizeHostImpl(nullptr, baseLayer, syncLayerCount)};
         if (stagingBuffer) {
-            auto lCycle{gpu.scheduler.Submit([&](vk::raii::CommandBuffer &commandBuffer) {
-                CopyFromStagingBuffer(commandBuffer, stagingBuffer);
-            })};
+            if (gpu.vkTransferQueue && !decoded)
+                WaitOnFence(); // The transfer queue isn't ordered with the graphics queue so any prior usage of the texture must have completed
+
+            std::vector<std::shared_ptr<FenceCycleDependency>> dependencies;
+            auto record{[&](vk::raii::CommandBuffer &commandBuffer) {
+                CopyFromStagingBuffer(commandBuffer, stagingBuffer, baseLayer, syncLayerCount, dependencies);
+            }};
+            auto lCycle{decoded ? gpu.scheduler.SubmitDeferred(record) : gpu.scheduler.SubmitTransfer(record)}; // Decoding requires a queue with compute support which the transfer queue lacks
             lCycle->AttachObjects(stagingBuffer, shared_from_this());
+            for (const auto &dependency : dependencies)
+                lCycle->AttachObject(dependency);
             cycle = lCycle;
         }
     }
@@ -288,10 +432,14 @@ namespace skyline::gpu {
     void Texture::SynchronizeHostWithBuffer(const vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<FenceCycle> &pCycle) {
         TRACE_EVENT("gpu", "Texture::SynchronizeHostWithBuffer");
 
-        auto stagingBuffer{SynchronizeHostImpl(pCycle)};
+        u32 baseLayer, syncLayerCount;
+        auto stagingBuffer{SynchronizeHostImpl(pCycle, baseLayer, syncLayerCount)};
         if (stagingBuffer) {
-            CopyFromStagingBuffer(commandBuffer, stagingBuffer);
+            std::vector<std::shared_ptr<FenceCycleDependency>> dependencies;
+            CopyFromStagingBuffer(commandBuffer, stagingBuffer, baseLayer, syncLayerCount, dependencies);
             pCycle->AttachObjects(stagingBuffer, shared_from_this());
+            for (const auto &dependency : dependencies)
+                pCycle->AttachObject(dependency);
             cycle = pCycle;
         }
     }
@@ -306,21 +454,22 @@ namespace skyline::gpu {
 
         TRACE_EVENT("gpu", "Texture::SynchronizeGuest");
 
-        if (layout == vk::ImageLayout::eUndefined)
-            return; // We don't need to synchronize the image if it is in an undefined state on the host
+        if (layout == vk::ImageLayout::eUndefined || IsScaled() || decoded)
+            return; // We don't need to synchronize the image if it is in an undefined state on the host or if it can't be represented at the guest resolution or in the guest format
 
         WaitOnBacking();
         WaitOnFence();
 
         if (tiling == vk::ImageTiling::eOptimal || !std::holds_alternative<memory::Image>(backing)) {
-            auto size{format->GetSize(dimensions)};
-            auto stagingBuffer{gpu.memory.AllocateStagingBuffer(size)};
+            auto size{format->GetSize(dimensions) * layerCount};
+            auto stagingBuffer{gpu.memory.AllocateDedicatedStagingBuffer(size)}; // The writeback may be deferred indefinitely so this can't be suballocated from the staging ring
 
-            auto lCycle{gpu.scheduler.Submit([&](vk::raii::CommandBuffer &commandBuffer) {
+            auto lCycle{gpu.scheduler.SubmitTransfer([&](vk::raii::CommandBuffer &commandBuffer) {
                 CopyIntoStagingBuffer(commandBuffer, stagingBuffer);
             })};
             lCycle->AttachObject(std::make_shared<TextureBufferCopy>(shared_from_this(), stagingBuffer));
             cycle = lCycle;
+            gpu.scheduler.Flush(); // The readback is deferred if there's no transfer queue, it needs to be submitted promptly as the guest may be waiting on its contents
         } else if (tiling == vk::ImageTiling::eLinear) {
             // We can optimize linear texture sync on a UMA by mapping the texture onto the CPU and copying directly from it rather than using a staging buffer
             CopyToGuest(std::get<memory::Image>(backing).data());
@@ -339,7 +488,7 @@ namespace skyline::gpu {
 
         TRACE_EVENT("gpu", "Texture::SynchronizeGuestWithBuffer");
 
-        if (layout == vk::ImageLayout::eUndefined)
+        if (layout == vk::ImageLayout::eUndefined || IsScaled() || decoded)
             return;
 
         WaitOnBacking();
@@ -347,8 +496,8 @@ namespace skyline::gpu {
             WaitOnFence();
 
         if (tiling == vk::ImageTiling::eOptimal || !std::holds_alternative<memory::Image>(backing)) {
-            auto size{format->GetSize(dimensions)};
-            auto stagingBuffer{gpu.memory.AllocateStagingBuffer(size)};
+            auto size{format->GetSize(dimensions) * layerCount};
+            auto stagingBuffer{gpu.memory.AllocateDedicatedStagingBuffer(size)}; // The writeback may be deferred indefinitely so this can't be suballocated from the staging ring
 
             CopyIntoStagingBuffer(commandBuffer, stagingBuffer);
             pCycle->AttachObject(std::make_shared<TextureBufferCopy>(shared_from_this(), stagingBuffer));
@@ -451,8 +600,34 @@ namespace skyline::gpu {
         cycle = lCycle;
     }
 
+    size_t Texture::ViewKeyHash::operator()(const ViewKey &key) const {
+        size_t hash{std::hash<VkImage>{}(static_cast<VkImage>(key.image))};
+        auto combine{[&](auto value) {
+            hash ^= std::hash<decltype(value)>{}(value) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+        }};
+        combine(static_cast<u32>(key.type));
+        combine(static_cast<u32>(key.format));
+        combine((static_cast<u32>(key.mapping.r) << 24) | (static_cast<u32>(key.mapping.g) << 16) | (static_cast<u32>(key.mapping.b) << 8) | static_cast<u32>(key.mapping.a));
+        combine(static_cast<u32>(key.range.aspectMask));
+        combine((static_cast<u64>(key.range.baseMipLevel) << 32) | key.range.levelCount);
+        combine((static_cast<u64>(key.range.baseArrayLayer) << 32) | key.range.layerCount);
+        return hash;
+    }
+
     Texture::~Texture() {
         WaitOnFence();
+        if (guest)
+            gpu.writeTracker.Untrack(*this);
+
+        if (!views.empty()) {
+            std::vector<vk::ImageView> viewHandles;
+            viewHandles.reserve(views.size());
+            for (const auto &view : views)
+                viewHandles.push_back(*view.second);
+            gpu.renderPassCache.EvictFramebuffers(viewHandles); // Any cached framebuffers using our views must be destroyed prior to the views
+        }
+
+        UpdateTextureCount(-1);
     }
 
     TextureView::TextureView(std::shared_ptr<Texture> backing, vk::ImageViewType type, vk::ImageSubresourceRange range, texture::Format format, vk::ComponentMapping mapping) : backing(std::move(backing)), type(type), format(format), mapping(mapping), range(range) {}
@@ -472,21 +647,28 @@ namespace skyline::gpu {
             }
         }()};
 
-        vk::ImageViewCreateInfo createInfo{
+        Texture::ViewKey key{
             .image = backing->GetBacking(),
-            .viewType = viewType,
-            .format = format ? *format : *backing->format,
-            .components = mapping,
-            .subresourceRange = range,
+            .type = viewType,
+            .format = format && backing->mutableFormat ? *format : *backing->format, // Textures that can't be viewed in other formats (such as decoded textures) are always viewed in their own format
+            .mapping = mapping,
+            .range = range,
         };
 
+        if (key.format != backing->format->vkFormat && !format->IsCompatible(*backing->format))
+            throw exception("Cannot view texture in {} as it's incompatible with its format {}", vk::to_string(key.format), vk::to_string(backing->format->vkFormat));
+
         auto &views{backing->views};
-        auto iterator{std::find_if(views.begin(), views.end(), [&](const std::pair<vk::ImageViewCreateInfo, vk::raii::ImageView> &item) {
-            return item.first == createInfo;
-        })};
+        auto iterator{views.find(key)};
         if (iterator != views.end())
             return *iterator->second;
 
-        return *views.emplace_back(createInfo, vk::raii::ImageView(backing->gpu.vkDevice, createInfo)).second;
+        return *views.emplace(key, vk::raii::ImageView(backing->gpu.vkDevice, vk::ImageViewCreateInfo{
+            .image = key.image,
+            .viewType = key.type,
+            .format = key.format,
+            .components = key.mapping,
+            .subresourceRange = key.range,
+        })).first->second;
     }
 }
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <gpu/memory_manager.h>
+#include "write_tracker.h"
 
 namespace skyline::gpu {
     namespace texture {
@@ -149,9 +150,12 @@ namespace skyline::gpu {
             }
 
             /**
-             * @return If the supplied format is texel-layout compatible with the current format
+             * @return If the supplied format is texel-layout compatible with the current format, an image in one can be viewed in the other if it was created with a mutable format
+             * @note Compressed formats are only compatible with themselves as every block compression scheme is its own compatibility class in Vulkan
              */
             constexpr bool IsCompatible(const FormatBase &other) const {
+                if (IsCompressed() || other.IsCompressed())
+                    return vkFormat == other.vkFormat;
                 return bpb == other.bpb && blockHeight == other.blockHeight && blockWidth == other.blockWidth;
             }
         };
@@ -284,6 +288,12 @@ namespace skyline::gpu {
               baseArrayLayer(baseArrayLayer),
               layerCount(layerCount),
               layerStride(layerStride) {}
+
+        bool operator==(const GuestTexture &other) const {
+            return std::equal(mappings.begin(), mappings.end(), other.mappings.begin(), other.mappings.end(), [](const span<u8> &lhs, const span<u8> &rhs) {
+                return lhs.data() == rhs.data() && lhs.size() == rhs.size();
+            }) && dimensions == other.dimensions && format == other.format && tileConfig == other.tileConfig && type == other.type && baseArrayLayer == other.baseArrayLayer && layerCount == other.layerCount && layerStride == other.layerStride;
+        }
     };
 
     class TextureManager;
@@ -326,24 +336,58 @@ namespace skyline::gpu {
         GPU &gpu;
         std::mutex mutex; //!< Synchronizes any mutations to the texture or its backing
         std::condition_variable backingCondition; //!< Signalled when a valid backing has been swapped in
-        using BackingType = std::variant<vk::Image, vk::raii::Image, memory::Image>;
+        using BackingType = std::variant<vk::Image, vk::raii::Image, memory::Image, memory::HardwareBufferImage>;
         BackingType backing; //!< The Vulkan image that backs this texture, it is nullable
 
-        std::vector<std::pair<vk::ImageViewCreateInfo, vk::raii::ImageView>> views; //!< VkImageView(s) that have been constructed from this Texture, utilized for caching
+        /**
+         * @brief The parameters of an image view which uniquely identify it, this is used as the key for caching views
+         */
+        struct ViewKey {
+            vk::Image image; //!< The backing that the view was created from, views aren't reused across backings
+            vk::ImageViewType type;
+            vk::Format format;
+            vk::ComponentMapping mapping;
+            vk::ImageSubresourceRange range;
+
+            bool operator==(const ViewKey &) const = default;
+        };
+
+        struct ViewKeyHash {
+            size_t operator()(const ViewKey &key) const;
+        };
+
+        std::unordered_map<ViewKey, vk::raii::ImageView, ViewKeyHash> views; //!< VkImageView(s) that have been constructed from this Texture, utilized for caching
+
+        static constexpr size_t LinearBackingMaxSize{0x40000}; //!< The maximum size of block-linear textures which are backed by linear images on UMA GPUs, accessing larger linear images on the GPU is slow enough to outweigh the cheaper synchronization
+
+        std::atomic<bool> guestDirty{true}; //!< If the guest texture's memory has been written to by the CPU since it was last synchronized to the host, this is maintained by the GuestWriteTracker
+        static constexpr u64 AllLayers{~0ULL};
+        std::atomic<u64> guestDirtyLayers{AllLayers}; //!< A mask of the layers which have been written to alongside guestDirty, layers past the 64th share the last bit
+        std::shared_ptr<memory::StagingBuffer> pendingWriteback; //!< A staging buffer with the contents of the texture which are yet to be written back to the guest, this is maintained by the GuestWriteTracker
 
         friend TextureManager;
         friend TextureView;
+        friend GuestWriteTracker;
+
+        /**
+         * @return A mask of the layers with guest memory overlapping the supplied range in the format of guestDirtyLayers, this is all layers if the texture can't be synchronized partially
+         */
+        u64 GetGuestLayerMask(u8 *pointer, size_t size);
 
         /**
          * @brief An implementation function for guest -> host texture synchronization, it allocates and copies data into a staging buffer or directly into a linear host texture
-         * @return If a staging buffer was required for the texture sync, it's returned filled with guest texture data and must be copied to the host texture by the callee
+         * @param baseLayer The first layer that was synchronized, only layers which were written to by the guest are synchronized where possible
+         * @param syncLayerCount The amount of layers that were synchronized
+         * @return If a staging buffer was required for the texture sync, it's returned filled with guest texture data starting at the base layer and must be copied to the host texture by the callee
          */
-        std::shared_ptr<memory::StagingBuffer> SynchronizeHostImpl(const std::shared_ptr<FenceCycle> &pCycle);
+        std::shared_ptr<memory::StagingBuffer> SynchronizeHostImpl(const std::shared_ptr<FenceCycle> &pCycle, u32 &baseLayer, u32 &syncLayerCount);
 
         /**
-         * @brief Records commands for copying data from a staging buffer to the texture's backing into the supplied command buffer
+         * @brief Records commands for copying data from a staging buffer to a range of layers of the texture's backing into the supplied command buffer, decoded textures are decoded from it instead
+         * @param dependencies Dependencies of the recorded commands are appended to this, they must be attached to the fence cycle of the command buffer
+         * @note Decoded textures are always synchronized in their entirety so the staging buffer must contain all layers for them
          */
-        void CopyFromStagingBuffer(const vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<memory::StagingBuffer> &stagingBuffer);
+        void CopyFromStagingBuffer(const vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<memory::StagingBuffer> &stagingBuffer, u32 baseLayer, u32 copyLayerCount, std::vector<std::shared_ptr<FenceCycleDependency>> &dependencies);
 
         /**
          * @brief Records commands for copying data from the texture's backing to a staging buffer into the supplied command buffer
@@ -351,6 +395,12 @@ namespace skyline::gpu {
          */
         void CopyIntoStagingBuffer(const vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<memory::StagingBuffer> &stagingBuffer);
 
+        /**
+         * @brief Copies data from the supplied host buffer into the guest texture without any write tracking
+         * @note The host buffer must be contain the entire image
+         */
+        void CopyToGuestImpl(u8 *hostBuffer);
+
         /**
          * @brief Copies data from the supplied host buffer into the guest texture
          * @note The host buffer must be contain the entire image
@@ -358,7 +408,7 @@ namespace skyline::gpu {
         void CopyToGuest(u8 *hostBuffer);
 
         /**
-         * @brief A FenceCycleDependency that copies the contents of a staging buffer or mapped image backing the texture to the guest texture
+         * @brief A FenceCycleDependency that copies the contents of a mapped image backing the texture to the guest texture or defers writing back the contents of a staging buffer till the guest accesses them
          */
         struct TextureBufferCopy : public FenceCycleDependency {
             std::shared_ptr<Texture> texture;
@@ -379,12 +429,19 @@ namespace skyline::gpu {
         u32 mipLevels;
         u32 layerCount; //!< The amount of array layers in the image, utilized for efficient binding (Not to be confused with the depth or faces in a cubemap)
         vk::SampleCountFlagBits sampleCount;
+        bool decoded{}; //!< If the guest format can't be sampled by the host GPU and the texture is decoded into the host format with a compute shader, it's never synchronized back to the guest in that case
+        bool mutableFormat{}; //!< If the backing was created with VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT, views of it in compatible formats are only valid if so
 
         Texture(GPU &gpu, BackingType &&backing, GuestTexture guest, texture::Dimensions dimensions, texture::Format format, vk::ImageLayout layout, vk::ImageTiling tiling, u32 mipLevels = 1, u32 layerCount = 1, vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1);
 
         Texture(GPU &gpu, BackingType &&backing, texture::Dimensions dimensions, texture::Format format, vk::ImageLayout layout, vk::ImageTiling tiling, u32 mipLevels = 1, u32 layerCount = 1, vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1);
 
-        Texture(GPU &gpu, GuestTexture guest);
+        /**
+         * @param scale The factor by which the width and height of the host texture are scaled relative to the guest texture
+         * @param presentable If the texture should be backed by an AHardwareBuffer when possible so it can be handed to the compositor without a copy
+         * @note Scaled textures are never synchronized with the guest as their contents are at a different resolution
+         */
+        Texture(GPU &gpu, GuestTexture guest, float scale = 1.0f, bool presentable = false);
 
         /**
          * @brief Creates and allocates memory for the backing to creates a texture object wrapping it
@@ -402,9 +459,25 @@ namespace skyline::gpu {
                 [](vk::Image image) { return image; },
                 [](const vk::raii::Image &image) { return *image; },
                 [](const memory::Image &image) { return image.vkImage; },
+                [](const memory::HardwareBufferImage &image) { return *image.vkImage; },
             }, backing);
         }
 
+        /**
+         * @return The AHardwareBuffer backing this texture or nullptr if it isn't backed by one
+         */
+        AHardwareBuffer *GetHardwareBuffer() {
+            auto image{std::get_if<memory::HardwareBufferImage>(&backing)};
+            return image ? image->buffer : nullptr;
+        }
+
+        /**
+         * @return If the host texture is at a different resolution than the guest texture, its contents are only ever written by the host in that case
+         */
+        bool IsScaled() const {
+            return guest && guest->dimensions != dimensions;
+        }
+
         /**
          * @brief Acquires an exclusive lock on the texture for the calling thread
          * @note Naming is in accordance to the BasicLockable named requirement
@@ -454,11 +527,6 @@ namespace skyline::gpu {
          */
         void TransitionLayout(vk::ImageLayout layout);
 
-        /**
-         * @brief Converts the texture to have the specified format
-         */
-        void SetFormat(texture::Format format);
-
         /**
          * @brief Synchronizes the host texture with the guest after it has been modified
          * @param commandBuffer An optional command buffer that the command will be recorded into rather than creating one as necessary
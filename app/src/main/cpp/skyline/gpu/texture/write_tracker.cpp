@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <common/signal.h>
+#include "texture.h"
+#include "write_tracker.h"
+
+namespace skyline::gpu {
+    template<typename Function>
+    void GuestWriteTracker::ForEachPage(Texture &texture, Function function) {
+        for (auto &mapping : texture.guest->mappings)
+            for (auto page{util::AlignDown(mapping.data(), PAGE_SIZE)}; page < mapping.data() + mapping.size(); page += PAGE_SIZE)
+                function(page);
+    }
+
+    void GuestWriteTracker::SetProtection(u8 *page, Page &entry, Protection protection) {
+        if (entry.protection.exchange(protection) == protection)
+            return;
+
+        // Guest memory backing textures is always mapped as RW, restoring that is sufficient to undo the protection
+        int hostProtection{protection == Protection::ReadWrite ? (PROT_READ | PROT_WRITE) : (protection == Protection::ReadOnly ? PROT_READ : PROT_NONE)};
+        if (mprotect(page, PAGE_SIZE, hostProtection))
+            Logger::Warn("Failed to change the protection of guest texture page at 0x{:X} to {}: {}", reinterpret_cast<uintptr_t>(page), hostProtection, strerror(errno));
+    }
+
+    void GuestWriteTracker::FlushPageWritebacks(Page &entry) {
+        if (entry.protection == Protection::None)
+            for (auto texture : entry.textures)
+                if (texture->pendingWriteback)
+                    FlushWriteback(*texture);
+    }
+
+    void GuestWriteTracker::UnprotectPage(u8 *page, Page &entry) {
+        FlushPageWritebacks(entry);
+
+        for (auto texture : entry.textures) {
+            texture->guestDirtyLayers.fetch_or(texture->GetGuestLayerMask(page, PAGE_SIZE), std::memory_order_relaxed);
+            texture->guestDirty.store(true, std::memory_order_release);
+        }
+        SetProtection(page, entry, Protection::ReadWrite);
+    }
+
+    void GuestWriteTracker::FlushWriteback(Texture &texture) {
+        auto stagingBuffer{std::exchange(texture.pendingWriteback, nullptr)};
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it != pages.end())
+                UnprotectPage(page, it->second); // This recursively flushes any other textures with pending writebacks on the same pages
+        });
+
+        texture.CopyToGuestImpl(stagingBuffer->data());
+
+        texture.guestDirtyLayers.store(0, std::memory_order_relaxed);
+        texture.guestDirty.store(false, std::memory_order_release);
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it != pages.end())
+                SetProtection(page, it->second, Protection::ReadOnly);
+        });
+    }
+
+    bool GuestWriteTracker::ResolveFault(u8 *page) {
+        {
+            std::shared_lock lock{mutex};
+            auto it{pages.find(page)};
+            if (it == pages.end())
+                return false; // This isn't a fault we've caused, it needs to be handled as usual
+
+            if (it->second.protection != Protection::None) {
+                // The textures are marked dirty prior to unprotecting the page so a sync racing with this will see them as dirty
+                for (auto texture : it->second.textures) {
+                    texture->guestDirtyLayers.fetch_or(texture->GetGuestLayerMask(page, PAGE_SIZE), std::memory_order_relaxed);
+                    texture->guestDirty.store(true, std::memory_order_release);
+                }
+                SetProtection(page, it->second, Protection::ReadWrite);
+                return true; // If another thread unprotected the page concurrently this will just retry the access
+            }
+        }
+
+        // The page has pending writebacks, these need to be flushed with the mutex held exclusively as they mutate the state of other pages
+        // If the access was a write, it'll fault again on the now read-only page and be handled as a regular write
+        std::unique_lock lock{mutex};
+        auto it{pages.find(page)};
+        if (it != pages.end())
+            FlushPageWritebacks(it->second);
+        return true;
+    }
+
+    void GuestWriteTracker::FaultThread() {
+        pthread_setname_np(pthread_self(), "WriteTracker");
+        faultThreadId = gettid();
+
+        while (true) {
+            u32 sequence{faultSequence.load()};
+            for (auto &slot : faultSlots) {
+                if (slot.state.load(std::memory_order_acquire) != FaultState::Pending)
+                    continue;
+
+                bool handled{};
+                try {
+                    handled = ResolveFault(slot.page);
+                } catch (const std::exception &e) {
+                    Logger::Error("Failed to resolve a fault on guest texture page at 0x{:X}: {}", reinterpret_cast<uintptr_t>(slot.page), e.what());
+                }
+
+                slot.state.store(handled ? FaultState::Handled : FaultState::Unhandled, std::memory_order_release);
+                syscall(SYS_futex, &slot.state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+
+            if (faultThreadStop.load())
+                return;
+
+            // Any fault handed off after the slots were scanned will have changed the sequence, the wait returns immediately in that case
+            syscall(SYS_futex, &faultSequence, FUTEX_WAIT_PRIVATE, sequence, nullptr, nullptr, 0);
+        }
+    }
+
+    bool GuestWriteTracker::HandleAccessViolation(void *fault) {
+        auto tracker{instance};
+        if (!tracker || gettid() == tracker->faultThreadId.load(std::memory_order_relaxed))
+            return false; // The fault thread only accesses guest memory after unprotecting it, any fault on it is a genuine one
+
+        FaultSlot *slot{};
+        while (!slot) {
+            for (auto &candidate : tracker->faultSlots) {
+                auto expected{FaultState::Free};
+                if (candidate.state.compare_exchange_strong(expected, FaultState::Claimed, std::memory_order_acquire)) {
+                    slot = &candidate;
+                    break;
+                }
+            }
+
+            if (!slot) [[unlikely]]
+                sched_yield();
+        }
+
+        slot->page = util::AlignDown(reinterpret_cast<u8 *>(fault), PAGE_SIZE);
+        slot->state.store(FaultState::Pending, std::memory_order_release);
+        tracker->faultSequence.fetch_add(1);
+        syscall(SYS_futex, &tracker->faultSequence, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+
+        FaultState state;
+        while ((state = slot->state.load(std::memory_order_acquire)) == FaultState::Pending)
+            syscall(SYS_futex, &slot->state, FUTEX_WAIT_PRIVATE, static_cast<u32>(FaultState::Pending), nullptr, nullptr, 0); // This may return early due to a signal, the state is rechecked regardless
+
+        slot->state.store(FaultState::Free, std::memory_order_release);
+        return state == FaultState::Handled;
+    }
+
+    GuestWriteTracker::GuestWriteTracker() : faultThread(&GuestWriteTracker::FaultThread, this) {
+        instance = this;
+        signal::SetAccessViolationHandler(&GuestWriteTracker::HandleAccessViolation);
+    }
+
+    GuestWriteTracker::~GuestWriteTracker() {
+        signal::SetAccessViolationHandler(nullptr);
+        instance = nullptr;
+
+        faultThreadStop = true;
+        faultSequence.fetch_add(1);
+        syscall(SYS_futex, &faultSequence, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        faultThread.join();
+
+        std::unique_lock lock{mutex};
+        for (auto &[page, entry] : pages)
+            SetProtection(page, entry, Protection::ReadWrite);
+    }
+
+    void GuestWriteTracker::Track(Texture &texture) {
+        std::unique_lock lock{mutex};
+        texture.guestDirtyLayers = Texture::AllLayers;
+        texture.guestDirty = true;
+        ForEachPage(texture, [&](u8 *page) {
+            auto &textures{pages[page].textures};
+            if (std::find(textures.begin(), textures.end(), &texture) == textures.end())
+                textures.push_back(&texture);
+        });
+    }
+
+    void GuestWriteTracker::Untrack(Texture &texture) {
+        std::unique_lock lock{mutex};
+        if (texture.pendingWriteback)
+            FlushWriteback(texture);
+
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it == pages.end())
+                return;
+
+            auto &textures{it->second.textures};
+            textures.erase(std::remove(textures.begin(), textures.end(), &texture), textures.end());
+            if (textures.empty()) {
+                SetProtection(page, it->second, Protection::ReadWrite);
+                pages.erase(it);
+            }
+        });
+    }
+
+    void GuestWriteTracker::InvalidateRange(span<u8> range) {
+        std::unique_lock lock{mutex};
+        for (auto page{util::AlignDown(range.data(), PAGE_SIZE)}; page < range.data() + range.size(); page += PAGE_SIZE) {
+            auto it{pages.find(page)};
+            if (it != pages.end() && it->second.protection != Protection::ReadWrite)
+                UnprotectPage(page, it->second);
+        }
+    }
+
+    u64 GuestWriteTracker::Protect(Texture &texture) {
+        std::unique_lock lock{mutex};
+        if (texture.pendingWriteback)
+            return 0; // The host contents are newer than the guest's, the guest can't have written to it as any access would have flushed the writeback
+
+        // Other textures may have pending writebacks on our pages, downgrading them to read-only would let the CPU read stale contents so they're flushed first, this dirties the texture if it overlaps them
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it != pages.end())
+                FlushPageWritebacks(it->second);
+        });
+
+        if (!texture.guestDirty.exchange(false, std::memory_order_acq_rel))
+            return 0; // A clean texture always has all of its pages protected as unprotecting a page dirties every texture on it
+
+        // Faults mark layers while holding the mutex as shared, the mask can't change between consuming it and reprotecting the pages
+        auto dirtyLayers{texture.guestDirtyLayers.exchange(0, std::memory_order_relaxed)};
+
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it != pages.end())
+                SetProtection(page, it->second, Protection::ReadOnly);
+        });
+        return dirtyLayers ? dirtyLayers : Texture::AllLayers;
+    }
+
+    void GuestWriteTracker::Unprotect(Texture &texture) {
+        std::unique_lock lock{mutex};
+        texture.pendingWriteback = nullptr; // The host is writing the latest contents of the texture, any pending writeback is stale
+
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it != pages.end())
+                UnprotectPage(page, it->second);
+        });
+    }
+
+    void GuestWriteTracker::DeferWriteback(Texture &texture, std::shared_ptr<memory::StagingBuffer> stagingBuffer) {
+        std::unique_lock lock{mutex};
+        texture.pendingWriteback = nullptr; // Our own prior writeback is superseded, it mustn't be flushed below
+
+        // Writebacks of other textures on our pages would otherwise be flushed in an arbitrary order relative to ours on the next access, they're all flushed prior to protecting any page as flushing changes the protection of every page of the flushed texture
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it != pages.end())
+                FlushPageWritebacks(it->second);
+        });
+
+        ForEachPage(texture, [&](u8 *page) {
+            auto it{pages.find(page)};
+            if (it == pages.end())
+                return;
+
+            for (auto other : it->second.textures) {
+                if (other != &texture) {
+                    other->guestDirtyLayers.fetch_or(other->GetGuestLayerMask(page, PAGE_SIZE), std::memory_order_relaxed);
+                    other->guestDirty.store(true, std::memory_order_release);
+                }
+            }
+            SetProtection(page, it->second, Protection::None);
+        });
+        texture.pendingWriteback = std::move(stagingBuffer);
+    }
+}
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <shared_mutex>
+#include <thread>
+#include <boost/container/small_vector.hpp>
+#include <common.h>
+
+namespace skyline::gpu {
+    namespace memory {
+        struct StagingBuffer;
+    }
+
+    class Texture;
+
+    /**
+     * @brief Tracks CPU accesses to the guest memory backing textures by protecting its pages and catching the resulting faults, this allows textures to only be synchronized from the guest when their memory has actually been written to and writebacks to the guest to be deferred till their memory is actually accessed
+     * @note A page is unprotected on the first write to it after which all textures overlapping it are dirty, it's protected again when any of them is synchronized
+     * @note The layers overlapping a written page are tracked alongside, textures are only synchronized from the first to the last written layer
+     * @note A page with a deferred writeback is inaccessible, the first access to it writes back all textures with pending writebacks on it
+     * @note The signal handler can't take locks or allocate as the faulting thread may be in the middle of doing so, faults are handed off to a dedicated thread which resolves them while the faulting thread sleeps
+     */
+    class GuestWriteTracker {
+      private:
+        enum class Protection : u8 {
+            ReadWrite, //!< The page isn't protected
+            ReadOnly, //!< Writes to the page are tracked
+            None, //!< The page has a pending writeback, all accesses to it are tracked
+        };
+
+        /**
+         * @brief A single page of guest memory which backs at least one tracked texture
+         */
+        struct Page {
+            boost::container::small_vector<Texture *, 2> textures; //!< All tracked textures with mappings overlapping the page
+            std::atomic<Protection> protection{Protection::ReadWrite}; //!< The current protection of the page
+        };
+
+        enum class FaultState : u32 {
+            Free, //!< The slot isn't being used by any fault
+            Claimed, //!< The slot has been claimed by a faulting thread which is filling it in
+            Pending, //!< The fault is waiting on the fault thread to resolve it
+            Handled, //!< The fault was caused by the tracker and has been resolved, the access can be retried
+            Unhandled, //!< The fault wasn't caused by the tracker and needs to be handled as usual
+        };
+        static_assert(sizeof(std::atomic<FaultState>) == sizeof(u32)); // The state is used as a futex word
+
+        /**
+         * @brief A fault which has been handed off from the signal handler to the fault thread
+         */
+        struct FaultSlot {
+            std::atomic<FaultState> state{FaultState::Free};
+            u8 *page{}; //!< The base address of the faulting page, this is written prior to the slot being pending
+        };
+
+        static constexpr size_t FaultSlotCount{32}; //!< The amount of faults that can be pending at once, any further faulting threads yield till a slot is freed
+
+        static inline GuestWriteTracker *instance{}; //!< The tracker that faults are delegated to, there's only a single one as it's owned by the GPU
+
+        std::shared_mutex mutex; //!< Synchronizes access to the pages and pending writebacks, faults only take this as shared unless they need to write back a texture
+        std::unordered_map<u8 *, Page> pages; //!< All tracked pages keyed by their base address
+
+        std::array<FaultSlot, FaultSlotCount> faultSlots{};
+        std::atomic<u32> faultSequence{}; //!< Incremented whenever a fault is handed off or the fault thread should stop, the fault thread sleeps on this futex word while there's nothing to do
+        std::atomic<pid_t> faultThreadId{}; //!< The TID of the fault thread, faults on it can't be handed off to itself
+        std::atomic<bool> faultThreadStop{};
+        std::thread faultThread;
+
+        /**
+         * @brief Calls the supplied function with the base address of every page overlapped by the texture's guest mappings
+         */
+        template<typename Function>
+        static void ForEachPage(Texture &texture, Function function);
+
+        /**
+         * @brief Sets the protection of a page, this is a no-op if the page already has the requested protection
+         */
+        static void SetProtection(u8 *page, Page &entry, Protection protection);
+
+        /**
+         * @brief Writes back all textures with pending writebacks on the page, this must be done prior to changing the protection of a page in the None state as they'd otherwise be lost or written back out of order
+         * @note The mutex must be held exclusively
+         */
+        void FlushPageWritebacks(Page &entry);
+
+        /**
+         * @brief Marks every texture on the page as dirty and unprotects the page, any pending writebacks on it are flushed beforehand
+         * @note The mutex must be held exclusively
+         */
+        void UnprotectPage(u8 *page, Page &entry);
+
+        /**
+         * @brief Writes back the pending contents of the texture to the guest and write-protects its pages, overlapping textures are marked as dirty
+         * @note The mutex must be held exclusively
+         */
+        void FlushWriteback(Texture &texture);
+
+        /**
+         * @brief Resolves a fault on the supplied page, this takes the mutex and may write back textures so it must not run in signal context
+         * @return If the fault was caused by the tracker and the access can be retried
+         */
+        bool ResolveFault(u8 *page);
+
+        /**
+         * @brief Resolves faults handed off by HandleAccessViolation till the tracker is destroyed
+         */
+        void FaultThread();
+
+        /**
+         * @brief Hands the fault off to the fault thread and sleeps till it's resolved, this only uses atomics and syscalls as it runs in signal context
+         */
+        static bool HandleAccessViolation(void *fault);
+
+      public:
+        GuestWriteTracker();
+
+        ~GuestWriteTracker();
+
+        /**
+         * @brief Starts tracking CPU writes to the texture's guest mappings, the texture is considered dirty till it's first protected
+         */
+        void Track(Texture &texture);
+
+        /**
+         * @brief Stops tracking the texture, any pending writeback is flushed and pages which aren't backing other textures are unprotected
+         */
+        void Untrack(Texture &texture);
+
+        /**
+         * @brief Marks the texture as clean and write-protects its guest mappings if it was dirty, this must be done prior to reading from guest memory so any concurrent writes are caught
+         * @return A mask of the layers that were written to since the texture was last protected and need to be synchronized (See Texture::guestDirtyLayers), this is 0 if the texture is clean and is always 0 while a writeback is pending as the host contents are newer than the guest's
+         */
+        u64 Protect(Texture &texture);
+
+        /**
+         * @brief Unprotects the texture's guest mappings for writes from the host, all overlapping textures (including the supplied one) are marked as dirty as their contents will change
+         * @note Protect should be called on the texture after the write to not treat it as dirty
+         */
+        void Unprotect(Texture &texture);
+
+        /**
+         * @brief Marks all textures overlapping the range as dirty and unprotects its pages ahead of a write to it by the emulated GPU, this avoids faulting on every page of the write
+         * @note Any pending writebacks on the pages are flushed so they don't overwrite the contents written after this
+         */
+        void InvalidateRange(span<u8> range);
+
+        /**
+         * @brief Defers writing back the contents of a staging buffer to the texture's guest memory till the CPU accesses it, any prior pending writeback of the texture is discarded
+         * @note Pending writebacks of overlapping textures are flushed beforehand and the overlapping textures are marked as dirty as their guest contents will change
+         * @note The staging buffer must be filled with the contents of the texture by the time this is called
+         */
+        void DeferWriteback(Texture &texture, std::shared_ptr<memory::StagingBuffer> stagingBuffer);
+    };
+}
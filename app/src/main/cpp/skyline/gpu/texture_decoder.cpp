@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <gpu/texture/format.h>
+#include "texture_decoder.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief The SPIR-V of the BCn decoder, this is compiled from gpu/texture/shaders/bcn_decode.comp at build time
+     */
+    constexpr u32 BcnDecodeSpirv[]{
+        #include "bcn_decode.comp.inc"
+    };
+
+    static constexpr u32 DecodeGroupSize{8}; //!< The width and height of the workgroups of the decoder in blocks
+
+    TextureDecoder::TextureDecoder(GPU &gpu) : gpu(gpu), descriptorLayout([&]() {
+        constexpr std::array<vk::DescriptorSetLayoutBinding, 2> bindings{
+            vk::DescriptorSetLayoutBinding{
+                .binding = 0,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            },
+            vk::DescriptorSetLayoutBinding{
+                .binding = 1,
+                .descriptorType = vk::DescriptorType::eStorageImage,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            },
+        };
+        constexpr std::array<vk::DescriptorUpdateTemplateEntry, 2> entries{
+            vk::DescriptorUpdateTemplateEntry{
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .offset = offsetof(DescriptorData, input),
+            },
+            vk::DescriptorUpdateTemplateEntry{
+                .dstBinding = 1,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageImage,
+                .offset = offsetof(DescriptorData, output),
+            },
+        };
+        return gpu.descriptor.CreateLayout(bindings, entries);
+    }()), pipelineLayout(gpu.vkDevice, [&]() {
+        static constexpr vk::PushConstantRange pushConstantRange{
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .size = sizeof(PushConstants),
+        };
+        return vk::PipelineLayoutCreateInfo{
+            .setLayoutCount = 1,
+            .pSetLayouts = &*descriptorLayout->layout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange,
+        };
+    }()), bcnModule(gpu.vkDevice, vk::ShaderModuleCreateInfo{
+        .codeSize = sizeof(BcnDecodeSpirv),
+        .pCode = BcnDecodeSpirv,
+    }) {
+        if (descriptorLayout->push)
+            pushTemplate.emplace(gpu.descriptor.CreatePushTemplate(*descriptorLayout, *pipelineLayout, 0, vk::PipelineBindPoint::eCompute));
+    }
+
+    vk::Pipeline TextureDecoder::GetPipeline(texture::Format format) {
+        std::scoped_lock lock{mutex};
+        auto pipelineIt{pipelines.find(format->vkFormat)};
+        if (pipelineIt != pipelines.end())
+            return *pipelineIt->second;
+
+        u32 bcnFormat{[&]() -> u32 {
+            switch (format->vkFormat) {
+                case vk::Format::eBc1RgbaUnormBlock:
+                    return 1;
+                case vk::Format::eBc2UnormBlock:
+                    return 2;
+                case vk::Format::eBc3UnormBlock:
+                    return 3;
+                case vk::Format::eBc4UnormBlock:
+                    return 4;
+                case vk::Format::eBc5UnormBlock:
+                    return 5;
+                case vk::Format::eBc7UnormBlock:
+                    return 7;
+                default:
+                    throw exception("Cannot decode textures in format: '{}'", vk::to_string(format->vkFormat));
+            }
+        }()};
+
+        constexpr vk::SpecializationMapEntry specializationEntry{
+            .constantID = 0,
+            .offset = 0,
+            .size = sizeof(u32),
+        };
+        vk::SpecializationInfo specializationInfo{
+            .mapEntryCount = 1,
+            .pMapEntries = &specializationEntry,
+            .dataSize = sizeof(bcnFormat),
+            .pData = &bcnFormat,
+        };
+
+        return *pipelines.emplace(format->vkFormat, vk::raii::Pipeline(gpu.vkDevice, nullptr, vk::ComputePipelineCreateInfo{
+            .stage = {
+                .stage = vk::ShaderStageFlagBits::eCompute,
+                .module = *bcnModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializationInfo,
+            },
+            .layout = *pipelineLayout,
+        })).first->second;
+    }
+
+    bool TextureDecoder::IsSupported(texture::Format format) {
+        return static_cast<bool>(gpu.vkPhysicalDevice.getFormatProperties(format->vkFormat).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+    }
+
+    texture::Format TextureDecoder::GetDecodedFormat(texture::Format format) {
+        switch (format->vkFormat) {
+            case vk::Format::eBc1RgbaUnormBlock:
+            case vk::Format::eBc2UnormBlock:
+            case vk::Format::eBc3UnormBlock:
+            case vk::Format::eBc4UnormBlock:
+            case vk::Format::eBc5UnormBlock:
+            case vk::Format::eBc7UnormBlock:
+                return format::R8G8B8A8Unorm;
+            default:
+                return {};
+        }
+    }
+
+    void TextureDecoder::Decode(const vk::raii::CommandBuffer &commandBuffer, Texture &texture, const memory::StagingBuffer &stagingBuffer, std::vector<std::shared_ptr<FenceCycleDependency>> &dependencies) {
+        auto guestFormat{texture.guest->format};
+        auto image{texture.GetBacking()};
+        vk::ImageSubresourceRange range{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .levelCount = 1,
+            .layerCount = texture.layerCount,
+        };
+
+        // The staging buffer is written by the host prior to submission which makes it implicitly visible, only prior accesses to the image need to be waited on
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, vk::ImageMemoryBarrier{
+            .image = image,
+            .srcAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .subresourceRange = range,
+        });
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, GetPipeline(guestFormat));
+
+        PushConstants constants{
+            .widthBlocks = texture.dimensions.width / guestFormat->blockWidth,
+            .heightBlocks = texture.dimensions.height / guestFormat->blockHeight,
+        };
+        auto layerWords{static_cast<u32>(guestFormat->GetSize(texture.dimensions) / sizeof(u32))};
+
+        // Every layer is decoded separately through a 2D view of it as the layers are contiguous in the staging buffer
+        for (u32 layer{}; layer < texture.layerCount; layer++) {
+            TextureView view(texture.shared_from_this(), vk::ImageViewType::e2D, vk::ImageSubresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .baseArrayLayer = layer,
+                .layerCount = 1,
+            });
+
+            DescriptorData data{
+                .input = {
+                    .buffer = stagingBuffer.vkBuffer,
+                    .offset = stagingBuffer.offset,
+                    .range = stagingBuffer.size(),
+                },
+                .output = {
+                    .imageView = view.GetView(),
+                    .imageLayout = vk::ImageLayout::eGeneral,
+                },
+            };
+
+            if (pushTemplate) {
+                commandBuffer.pushDescriptorSetWithTemplateKHR(**pushTemplate, *pipelineLayout, 0, &data);
+            } else {
+                auto set{gpu.descriptor.Allocate(*descriptorLayout, span<const DescriptorData>(&data, 1).cast<const u8>())};
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, set.set, {});
+                dependencies.emplace_back(std::move(set.dependency));
+            }
+
+            constants.wordOffset = layer * layerWords;
+            commandBuffer.pushConstants<PushConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+            commandBuffer.dispatch(util::AlignUp(constants.widthBlocks, DecodeGroupSize) / DecodeGroupSize, util::AlignUp(constants.heightBlocks, DecodeGroupSize) / DecodeGroupSize, 1);
+        }
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, vk::ImageMemoryBarrier{
+            .image = image,
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eMemoryRead,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .subresourceRange = range,
+        });
+    }
+}
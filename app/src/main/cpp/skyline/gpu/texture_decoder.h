@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "texture/texture.h"
+#include "descriptor_allocator.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief The Texture Decoder decodes textures in compressed formats which the host GPU can't sample into uncompressed images with compute shaders
+     * @note Decoding is recorded alongside the upload of the texture from its staging buffer, the decoded image is retained by the texture so a texture is only decoded again after the guest writes to it
+     */
+    class TextureDecoder {
+      private:
+        /**
+         * @brief The push constants of the BCn decoder, these must match the layout of the constants in the shader
+         */
+        struct PushConstants {
+            u32 wordOffset; //!< The offset of the layer that is decoded from the start of the staging buffer in words
+            u32 widthBlocks;
+            u32 heightBlocks;
+        };
+
+        /**
+         * @brief The descriptors of the decoder in the layout that the update template writes them from
+         */
+        struct DescriptorData {
+            vk::DescriptorBufferInfo input;
+            vk::DescriptorImageInfo output;
+        };
+
+        GPU &gpu;
+        std::shared_ptr<DescriptorSetLayout> descriptorLayout;
+        vk::raii::PipelineLayout pipelineLayout;
+        std::optional<vk::raii::DescriptorUpdateTemplate> pushTemplate; //!< The template for pushing descriptors, this is only used when the descriptor layout is a push layout
+        vk::raii::ShaderModule bcnModule;
+        std::mutex mutex; //!< Synchronizes access to the pipelines
+        std::unordered_map<vk::Format, vk::raii::Pipeline> pipelines; //!< A map from the guest format to the decoder pipeline specialized for it
+
+        /**
+         * @return The pipeline which decodes the supplied format, it's created on the first use of the format
+         */
+        vk::Pipeline GetPipeline(texture::Format format);
+
+      public:
+        TextureDecoder(GPU &gpu);
+
+        /**
+         * @return If the supplied compressed format can be sampled by the host GPU, textures in it don't need to be decoded in that case
+         */
+        bool IsSupported(texture::Format format);
+
+        /**
+         * @return The format that textures in the supplied compressed format are decoded into or an invalid format if there's no decoder for it
+         */
+        static texture::Format GetDecodedFormat(texture::Format format);
+
+        /**
+         * @brief Records the decoding of the supplied texture from a staging buffer containing the linear guest texture into the supplied command buffer
+         * @param dependencies Dependencies of the recorded commands are appended to this, they must be attached to the fence cycle of the command buffer
+         * @note The texture must be in the general layout and locked by the calling thread
+         */
+        void Decode(const vk::raii::CommandBuffer &commandBuffer, Texture &texture, const memory::StagingBuffer &stagingBuffer, std::vector<std::shared_ptr<FenceCycleDependency>> &dependencies);
+    };
+}
@@ -1,12 +1,66 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <gpu.h>
 #include "texture_manager.h"
 
 namespace skyline::gpu {
-    TextureManager::TextureManager(GPU &gpu) : gpu(gpu) {}
+    TextureManager::TextureManager(GPU &gpu) : gpu(gpu), budget(gpu.memory.GetDeviceLocalHeapSize() / 2) {}
 
-    TextureView TextureManager::FindOrCreate(const GuestTexture &guestTexture) {
+    void TextureManager::MarkUsed(Texture *texture) {
+        auto entry{lruEntries.at(texture)};
+        entry->lastUsedFrame = frame.load(std::memory_order_relaxed);
+        lru.splice(lru.begin(), lru, entry);
+    }
+
+    void TextureManager::EvictTextures() {
+        u64 currentFrame{frame.load(std::memory_order_relaxed)};
+        auto it{lru.end()};
+        while (it != lru.begin() && gpu.memory.GetImageMemoryUsage() > budget) {
+            --it;
+            if (currentFrame - it->lastUsedFrame < EvictionFrameThreshold)
+                break; // All textures prior to this one in the list were used more recently than it
+
+            auto &texture{it->texture};
+            if (static_cast<size_t>(texture.use_count()) != texture->guest->mappings.size() + 1)
+                continue; // The texture is referenced by a view or a dependency outside of the manager's own references
+
+            auto cycle{texture->cycle.lock()};
+            if (cycle && !cycle->Poll())
+                continue; // The GPU is still using the texture
+
+            for (const auto &mapping : texture->guest->mappings) {
+                auto [begin, end]{textures.equal_range(mapping.data())};
+                for (auto mappingIt{begin}; mappingIt != end; mappingIt++) {
+                    if (mappingIt->second.texture == texture) {
+                        textures.erase(mappingIt);
+                        break;
+                    }
+                }
+            }
+
+            Logger::Debug("Evicting texture: 0x{:X} ({}x{}x{})", reinterpret_cast<uintptr_t>(texture->guest->mappings.front().data()), texture->dimensions.width, texture->dimensions.height, texture->dimensions.depth);
+            lruEntries.erase(texture.get());
+            it = lru.erase(it); // This destroys the texture as the LRU entry holds the last reference to it
+            generation.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    std::shared_ptr<Texture> TextureManager::Find(u8 *address) {
+        std::scoped_lock lock(mutex);
+        auto [begin, end]{textures.equal_range(address)};
+        for (auto it{begin}; it != end; it++) {
+            auto &texture{it->second.texture};
+            if (it->second.iterator == texture->guest->mappings.begin() && !texture->IsScaled()) {
+                MarkUsed(texture.get());
+                return texture;
+            }
+        }
+
+        return nullptr;
+    }
+
+    TextureView TextureManager::FindOrCreate(const GuestTexture &guestTexture, float scale, bool presentable) {
         auto guestMapping{guestTexture.mappings.front()};
 
         // Iterate over all textures that overlap with the first mapping of the guest texture and compare the mappings:
@@ -23,8 +77,9 @@ namespace skyline::gpu {
 
         std::scoped_lock lock(mutex);
         std::shared_ptr<Texture> match{};
-        auto mappingEnd{std::upper_bound(textures.begin(), textures.end(), guestMapping)}, hostMapping{mappingEnd};
-        while (hostMapping != textures.begin() && (--hostMapping)->end() > guestMapping.begin()) {
+        auto mappingEnd{textures.upper_bound(guestMapping.data())}, hostMappingIt{mappingEnd};
+        while (hostMappingIt != textures.begin() && (--hostMappingIt)->second.end() > guestMapping.begin()) {
+            auto hostMapping{&hostMappingIt->second};
             auto &hostMappings{hostMapping->texture->guest->mappings};
             if (!hostMapping->contains(guestMapping))
                 continue;
@@ -45,6 +100,7 @@ namespace skyline::gpu {
                 auto &matchGuestTexture{*hostMapping->texture->guest};
                 if (matchGuestTexture.format->IsCompatible(*guestTexture.format) && matchGuestTexture.dimensions == guestTexture.dimensions && matchGuestTexture.tileConfig == guestTexture.tileConfig) {
                     auto &texture{hostMapping->texture};
+                    MarkUsed(texture.get());
                     return TextureView(texture, static_cast<vk::ImageViewType>(guestTexture.type), vk::ImageSubresourceRange{
                         .aspectMask = guestTexture.format->vkAspect,
                         .levelCount = texture->mipLevels,
@@ -65,21 +121,31 @@ namespace skyline::gpu {
             } */
         }
 
-        // Create a texture as we cannot find one that matches
-        auto texture{std::make_shared<Texture>(gpu, guestTexture)};
+        // Create a texture as we cannot find one that matches, unused textures are evicted beforehand if we're over the memory budget
+        if (gpu.memory.GetImageMemoryUsage() > budget) {
+            EvictTextures();
+            mappingEnd = textures.upper_bound(guestMapping.data()); // Eviction may have invalidated the hint
+        }
+
+        auto texture{std::make_shared<Texture>(gpu, guestTexture, scale, presentable)};
+        lru.push_front(LruEntry{texture, frame.load(std::memory_order_relaxed)});
+        lruEntries.emplace(texture.get(), lru.begin());
+
         auto it{texture->guest->mappings.begin()};
-        textures.emplace(mappingEnd, TextureMapping{texture, it, guestMapping});
+        textures.emplace_hint(mappingEnd, guestMapping.data(), TextureMapping{texture, it, guestMapping});
         while ((++it) != texture->guest->mappings.end()) {
             guestMapping = *it;
-            auto mapping{std::upper_bound(textures.begin(), textures.end(), guestMapping)};
             // TODO: Delete overlapping textures that aren't in texture pool
-            textures.emplace(mapping, TextureMapping{texture, it, guestMapping});
+            textures.emplace(guestMapping.data(), TextureMapping{texture, it, guestMapping});
         }
+        generation.fetch_add(1, std::memory_order_release);
 
-        return TextureView(texture, static_cast<vk::ImageViewType>(guestTexture.type), vk::ImageSubresourceRange{
+        TextureView view(texture, static_cast<vk::ImageViewType>(guestTexture.type), vk::ImageSubresourceRange{
             .aspectMask = guestTexture.format->vkAspect,
             .levelCount = texture->mipLevels,
             .layerCount = texture->layerCount,
         }, guestTexture.format);
+        view.GetView(); // The view matching the guest texture is pre-created as the texture will almost certainly be bound with it
+        return view;
     }
 }
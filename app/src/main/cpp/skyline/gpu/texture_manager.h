@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <map>
+#include <list>
 #include "texture/texture.h"
 #include <random>
 
@@ -26,16 +28,64 @@ namespace skyline::gpu {
                   iterator(iterator) {}
         };
 
+        /**
+         * @brief An entry in the LRU list of textures which tracks when the texture was last looked up
+         */
+        struct LruEntry {
+            std::shared_ptr<Texture> texture;
+            u64 lastUsedFrame; //!< The frame the texture was last looked up in
+        };
+
+        static constexpr u64 EvictionFrameThreshold{60}; //!< The minimum amount of frames a texture must not have been used for to be considered for eviction
+
         GPU &gpu;
         std::mutex mutex; //!< Synchronizes access to the texture mappings
-        std::vector<TextureMapping> textures; //!< A sorted vector of all texture mappings
+        std::multimap<u8 *, TextureMapping> textures; //!< All texture mappings keyed by their start address, this is an ordered tree so lookups and insertions are O(log n) in the amount of live mappings
+        std::list<LruEntry> lru; //!< All textures in the mappings ordered from the most to the least recently used
+        std::unordered_map<Texture *, std::list<LruEntry>::iterator> lruEntries; //!< A map from a texture to its entry in the LRU list
+        vk::DeviceSize budget; //!< The amount of image memory after which unused textures are evicted, this is a fraction of the largest device-local heap
+        std::atomic<u64> frame{}; //!< The amount of frames that have been presented so far
+        std::atomic<u64> generation{}; //!< Incremented whenever a texture is created or evicted, a texture resolved by a lookup is only guaranteed to be what the same lookup would resolve to while this is unchanged
+
+        /**
+         * @brief Moves the entry of a texture to the front of the LRU list and timestamps it with the current frame
+         */
+        void MarkUsed(Texture *texture);
+
+        /**
+         * @brief Evicts the least recently used textures which haven't been used for EvictionFrameThreshold frames and aren't referenced outside the manager till image memory usage is within the budget
+         * @note The mutex must be locked by the calling thread
+         * @note Any pending writebacks to the guest are flushed by the destruction of an evicted texture
+         */
+        void EvictTextures();
 
       public:
         TextureManager(GPU &gpu);
 
         /**
+         * @brief Advances the frame counter used to determine how recently textures were used, this should be called on every presented frame
+         */
+        void AdvanceFrame() {
+            frame.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @return The current generation of the texture mappings, a cached result of FindOrCreate can be reused without another lookup if this hasn't changed since
+         */
+        u64 GetGeneration() const {
+            return generation.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @param scale The factor by which a newly created texture is scaled relative to the guest texture, pre-existing textures are returned regardless of their scale
+         * @param presentable If a newly created texture should be backed by memory that can be composited directly, this has no effect on pre-existing textures
          * @return A pre-existing or newly created Texture object which matches the specified criteria
          */
-        TextureView FindOrCreate(const GuestTexture &guestTexture);
+        TextureView FindOrCreate(const GuestTexture &guestTexture, float scale = 1.0f, bool presentable = false);
+
+        /**
+         * @return A pre-existing unscaled texture which has its first mapping starting at the supplied address or nullptr if there's none, this never creates a texture
+         */
+        std::shared_ptr<Texture> Find(u8 *address);
     };
 }
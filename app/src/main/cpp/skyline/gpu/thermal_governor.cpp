@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <dlfcn.h>
+#include <common/trace.h>
+#include "thermal_governor.h"
+
+namespace skyline::gpu {
+    ThermalGovernor::ThermalGovernor(bool enabled) {
+        if (!enabled)
+            return;
+
+        // The thermal API was introduced in Android 11 which is above our minimum API level, it's resolved at runtime rather than being linked against
+        auto acquireManager{reinterpret_cast<AcquireManagerFunction>(dlsym(RTLD_DEFAULT, "AThermal_acquireManager"))};
+        releaseManager = reinterpret_cast<ReleaseManagerFunction>(dlsym(RTLD_DEFAULT, "AThermal_releaseManager"));
+        getThermalHeadroom = reinterpret_cast<GetThermalHeadroomFunction>(dlsym(RTLD_DEFAULT, "AThermal_getThermalHeadroom"));
+        if (!acquireManager || !releaseManager || !getThermalHeadroom) {
+            Logger::Info("Thermal headroom is unavailable, the thermal governor is disabled");
+            return;
+        }
+
+        manager = acquireManager();
+    }
+
+    ThermalGovernor::~ThermalGovernor() {
+        if (manager)
+            releaseManager(manager);
+    }
+
+    void ThermalGovernor::Update(FrameStatistics &statistics, i64 refreshCycleDuration) {
+        if (!manager || !refreshCycleDuration)
+            return;
+
+        i64 now{util::GetTimeNs()};
+        if (now - lastUpdate < UpdateInterval)
+            return;
+        lastUpdate = now;
+
+        float headroom{getThermalHeadroom(manager, ForecastSeconds)};
+        if (std::isnan(headroom))
+            return;
+        TRACE_COUNTER("gpu", "Thermal Headroom", headroom);
+
+        u32 interval{minimumSwapInterval.load(std::memory_order_relaxed)};
+        if (headroom >= ThrottleHeadroom && interval < MaxSwapInterval) {
+            interval = interval ? interval + 1 : 2;
+            throttleEvents.fetch_add(1, std::memory_order_relaxed);
+        } else if (headroom <= RecoverHeadroom && interval) {
+            // The rate is only raised if the GPU can sustain it, otherwise it'd only heat the device up again without yielding any more frames
+            u32 raisedInterval{interval > 2 ? interval - 1 : 1};
+            auto budget{static_cast<float>(refreshCycleDuration * raisedInterval) / constant::NsInMillisecond};
+            if (statistics.GetSummary().gpuTime > budget * RecoverBudgetFraction)
+                return;
+            interval = interval > 2 ? interval - 1 : 0;
+        } else {
+            return;
+        }
+
+        minimumSwapInterval.store(interval, std::memory_order_relaxed);
+        Logger::Info("Thermal headroom is {:.2f}, {}", headroom, interval ? util::Format("presenting at most every {} refreshes", interval) : std::string("lifted the present rate limit"));
+    }
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "frame_statistics.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief Limits the present rate in steps as the host approaches thermal throttling and lifts the limit once it has cooled down, this trades frame rate for sustained performance rather than letting the device throttle hard
+     * @note Thermal headroom is read with AThermal_getThermalHeadroom which is only available on Android 11 and above, the governor is inert on prior versions
+     */
+    class ThermalGovernor {
+      private:
+        using AcquireManagerFunction = void *(*)();
+        using ReleaseManagerFunction = void (*)(void *);
+        using GetThermalHeadroomFunction = float (*)(void *, int);
+
+        static constexpr i64 UpdateInterval{constant::NsInSecond}; //!< The interval at which headroom is read, the platform returns NaN if it's read more frequently than this
+        static constexpr int ForecastSeconds{10}; //!< How far ahead the headroom is forecast, this allows reacting prior to the device throttling
+        static constexpr float ThrottleHeadroom{0.9f}; //!< The headroom at which the present rate is lowered by a step, a headroom of 1.0 corresponds to severe throttling
+        static constexpr float RecoverHeadroom{0.7f}; //!< The headroom below which the present rate is raised by a step
+        static constexpr float RecoverBudgetFraction{0.8f}; //!< The fraction of the frame time budget at the raised present rate which the GPU time must be within for it to be raised
+        static constexpr u32 MaxSwapInterval{3}; //!< The largest minimum swap interval the present rate is lowered to
+
+        ReleaseManagerFunction releaseManager{};
+        GetThermalHeadroomFunction getThermalHeadroom{};
+        void *manager{}; //!< The AThermalManager which headroom is read from, this is nullptr if the governor is disabled or unsupported
+        i64 lastUpdate{}; //!< The time at which headroom was last read
+        std::atomic<u32> minimumSwapInterval{}; //!< The minimum amount of refreshes between presented frames, this is 0 when the present rate isn't limited
+        std::atomic<u32> throttleEvents{}; //!< The amount of times the present rate has been lowered
+
+      public:
+        ThermalGovernor(bool enabled);
+
+        ~ThermalGovernor();
+
+        /**
+         * @brief Reads the thermal headroom and adjusts the present rate limit if the last read was at least UpdateInterval ago, this should be called on every presented frame
+         * @param refreshCycleDuration The duration of a single display refresh in nanoseconds
+         */
+        void Update(FrameStatistics &statistics, i64 refreshCycleDuration);
+
+        /**
+         * @return The minimum swap interval that frames should be presented at, this is 0 when the present rate isn't limited
+         */
+        u32 GetMinimumSwapInterval() const {
+            return minimumSwapInterval.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return The amount of times the present rate has been lowered due to a lack of thermal headroom
+         */
+        u32 GetThrottleEvents() const {
+            return throttleEvents.load(std::memory_order_relaxed);
+        }
+    };
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "input.h"
+
+namespace skyline::input {
+    Input::Input(const DeviceState &state)
+        : state(state),
+          kHid(std::make_shared<kernel::type::KSharedMemory>(state, sizeof(HidSharedMemory))),
+          hid(reinterpret_cast<HidSharedMemory *>(kHid->host.ptr)),
+          npad(state, hid),
+          touch(state, hid) {
+        samplingThread = std::thread(&Input::SamplingThread, this);
+    }
+
+    Input::~Input() {
+        stopSampling.store(true, std::memory_order_relaxed);
+        if (samplingThread.joinable())
+            samplingThread.join();
+    }
+
+    void Input::SamplingThread() {
+        pthread_setname_np(pthread_self(), "InputSampler");
+
+        std::optional<NpadEvent> deferredNpadEvent;
+        std::optional<TouchEvent> deferredTouchEvent;
+        size_t touchPointCount{};
+
+        auto nextSample{std::chrono::steady_clock::now()};
+        while (!stopSampling.load(std::memory_order_relaxed)) {
+            // HID services only hold the NPad mutex while reconfiguring controllers, the sampler never waits on them and defers its events to the next sample instead
+            if (std::unique_lock guard{npad.mutex, std::try_to_lock}) {
+                std::array<u64, constant::ControllerCount> changedButtons{}; // The buttons on each controller which have been changed during this sample
+                auto applyNpadEvent{[&](const NpadEvent &event) {
+                    auto device{npad.controllers[event.index].device};
+                    if (event.type == NpadEvent::Type::Button) {
+                        if (changedButtons[event.index] & event.mask.raw)
+                            return false;
+                        changedButtons[event.index] |= event.mask.raw;
+
+                        if (device)
+                            device->SetButtonState(event.mask, event.pressed);
+                    } else if (device) {
+                        device->SetAxisValue(event.axis, event.value);
+                    }
+                    return true;
+                }};
+
+                if (deferredNpadEvent && applyNpadEvent(*deferredNpadEvent))
+                    deferredNpadEvent.reset();
+
+                NpadEvent event;
+                while (!deferredNpadEvent && npadEvents.Read(span<NpadEvent>(event)))
+                    if (!applyNpadEvent(event))
+                        deferredNpadEvent = event;
+
+                for (auto &device : npad.npads)
+                    device.UpdateSharedMemory();
+            }
+
+            bool touchCountChanged{};
+            auto applyTouchEvent{[&](TouchEvent &event) {
+                if (event.pointCount != touchPointCount) {
+                    if (touchCountChanged)
+                        return false;
+                    touchCountChanged = true;
+                    touchPointCount = event.pointCount;
+                }
+
+                touch.SetState(span(event.points).first(event.pointCount));
+                return true;
+            }};
+
+            if (deferredTouchEvent && applyTouchEvent(*deferredTouchEvent))
+                deferredTouchEvent.reset();
+
+            TouchEvent touchEvent;
+            while (!deferredTouchEvent && touchEvents.Read(span<TouchEvent>(touchEvent)))
+                if (!applyTouchEvent(touchEvent))
+                    deferredTouchEvent = touchEvent;
+
+            touch.UpdateSharedMemory();
+
+            nextSample += SamplePeriod;
+            auto now{std::chrono::steady_clock::now()};
+            if (nextSample < now)
+                nextSample = now; // We don't want to write a burst of samples to catch up after being descheduled
+            std::this_thread::sleep_until(nextSample);
+        }
+    }
+
+    void Input::SetButtonState(size_t index, NpadButton mask, bool pressed) {
+        NpadEvent event{
+            .type = NpadEvent::Type::Button,
+            .index = static_cast<u8>(index),
+            .pressed = pressed,
+            .mask = mask,
+        };
+        if (!npadEvents.Append(span<NpadEvent>(event)))
+            Logger::Warn("Dropping button event as the input queue is full");
+    }
+
+    void Input::SetAxisValue(size_t index, NpadAxisId axis, i32 value) {
+        NpadEvent event{
+            .type = NpadEvent::Type::Axis,
+            .index = static_cast<u8>(index),
+            .axis = axis,
+            .value = value,
+        };
+        if (!npadEvents.Append(span<NpadEvent>(event)))
+            Logger::Warn("Dropping axis event as the input queue is full");
+    }
+
+    void Input::SetTouchState(span<const TouchScreenPoint> points) {
+        TouchEvent event{.pointCount = std::min(points.size(), TouchManager::MaxPoints)};
+        std::copy_n(points.begin(), event.pointCount, event.points.begin());
+        if (!touchEvents.Append(span<TouchEvent>(event)))
+            Logger::Warn("Dropping touch event as the input queue is full");
+    }
+
+    void Input::CommitSnapshot(const InputSnapshot &snapshot) {
+        for (size_t index{}; index < snapshot.controllers.size(); index++) {
+            const auto &controller{snapshot.controllers[index]};
+            const auto &lastController{lastSnapshot.controllers[index]};
+
+            u64 changedButtons{controller.buttons ^ lastController.buttons};
+            if (u64 pressed{changedButtons & controller.buttons})
+                SetButtonState(index, NpadButton{.raw = pressed}, true);
+            if (u64 released{changedButtons & lastController.buttons})
+                SetButtonState(index, NpadButton{.raw = released}, false);
+
+            for (size_t axis{}; axis < controller.axes.size(); axis++)
+                if (controller.axes[axis] != lastController.axes[axis])
+                    SetAxisValue(index, static_cast<NpadAxisId>(axis), controller.axes[axis]);
+        }
+
+        auto touchPoints{span(snapshot.touchPoints).first(std::min<size_t>(snapshot.touchPointCount, TouchManager::MaxPoints))};
+        auto lastTouchPoints{span(lastSnapshot.touchPoints).first(std::min<size_t>(lastSnapshot.touchPointCount, TouchManager::MaxPoints))};
+        if (!std::equal(touchPoints.begin(), touchPoints.end(), lastTouchPoints.begin(), lastTouchPoints.end(), [](const TouchScreenPoint &a, const TouchScreenPoint &b) {
+            return std::memcmp(&a, &b, sizeof(TouchScreenPoint)) == 0;
+        }))
+            SetTouchState(touchPoints);
+
+        lastSnapshot = snapshot;
+    }
+}
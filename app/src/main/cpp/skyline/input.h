@@ -3,20 +3,92 @@
 
 #pragma once
 
+#include <thread>
 #include "common.h"
+#include "common/circular_buffer.h"
 #include "kernel/types/KSharedMemory.h"
 #include "input/shared_mem.h"
 #include "input/npad.h"
 #include "input/touch.h"
 
 namespace skyline::input {
+    /**
+     * @brief The state of all host input as written by the Kotlin InputSnapshot class into a direct buffer
+     */
+    struct InputSnapshot {
+        struct Controller {
+            u64 buttons; //!< A mask of all pressed buttons as an NpadButton
+            std::array<i32, 4> axes; //!< The value of every axis, indexed by NpadAxisId
+        };
+        static_assert(sizeof(Controller) == 0x18);
+
+        std::array<Controller, constant::ControllerCount> controllers;
+        u32 touchPointCount;
+        std::array<TouchScreenPoint, TouchManager::MaxPoints> touchPoints;
+    };
+    static_assert(sizeof(InputSnapshot) == 0x208);
+
     /**
      * @brief The Input class manages components responsible for translating host input to guest input
+     * @note Host input is queued by CommitSnapshot without taking any locks and is applied by a dedicated thread which samples it into HID Shared Memory at a fixed rate
      */
     class Input {
       private:
         const DeviceState &state;
 
+        static constexpr std::chrono::milliseconds SamplePeriod{4}; //!< The interval at which host input is sampled into HID Shared Memory
+
+        /**
+         * @brief A change to the state of a single guest controller
+         */
+        struct NpadEvent {
+            enum class Type : u8 {
+                Button,
+                Axis,
+            } type;
+            u8 index; //!< The index of the guest controller
+            bool pressed; //!< If the buttons were pressed or released (Button)
+            NpadAxisId axis; //!< The axis being set (Axis)
+            i32 value; //!< The value of the axis (Axis)
+            NpadButton mask; //!< The buttons being changed (Button)
+        };
+
+        /**
+         * @brief A snapshot of all points on the touch screen
+         */
+        struct TouchEvent {
+            size_t pointCount;
+            std::array<TouchScreenPoint, TouchManager::MaxPoints> points;
+        };
+
+        InputSnapshot lastSnapshot{}; //!< The last snapshot passed into CommitSnapshot, this is only accessed by the committing thread
+        CircularBuffer<NpadEvent, 512> npadEvents; //!< Controller events from the host which haven't been sampled yet
+        CircularBuffer<TouchEvent, 32> touchEvents; //!< Touch screen events from the host which haven't been sampled yet
+        std::atomic<bool> stopSampling{}; //!< If the sampling thread should exit
+        std::thread samplingThread; //!< The thread which drains the event queues and writes HID Shared Memory
+
+        /**
+         * @brief The entry point of the sampling thread, this applies all queued events and writes a single entry for every device once per SamplePeriod
+         * @note If HID services are reconfiguring NPads during a sample, queued controller events are left for the next sample rather than waiting on them
+         * @note A button change which overlaps a prior change of the same button in a sample or a touch event changing the point count for a second time in a sample is deferred to the next sample, this ensures the guest observes short presses and taps
+         */
+        void SamplingThread();
+
+        /**
+         * @brief Queues a change to the state of buttons on a guest controller
+         */
+        void SetButtonState(size_t index, NpadButton mask, bool pressed);
+
+        /**
+         * @brief Queues a change to the value of an axis on a guest controller
+         */
+        void SetAxisValue(size_t index, NpadAxisId axis, i32 value);
+
+        /**
+         * @brief Queues a change to the points on the touch screen, any points beyond TouchManager::MaxPoints are ignored
+         */
+        void SetTouchState(span<const TouchScreenPoint> points);
+
       public:
         std::shared_ptr<kernel::type::KSharedMemory> kHid; //!< The kernel shared memory object for HID Shared Memory
         HidSharedMemory *hid; //!< A pointer to HID Shared Memory on the host
@@ -24,11 +96,14 @@ namespace skyline::input {
         NpadManager npad;
         TouchManager touch;
 
-        Input(const DeviceState &state)
-            : state(state),
-              kHid(std::make_shared<kernel::type::KSharedMemory>(state, sizeof(HidSharedMemory))),
-              hid(reinterpret_cast<HidSharedMemory *>(kHid->host.ptr)),
-              npad(state, hid),
-              touch(state, hid) {}
+        Input(const DeviceState &state);
+
+        ~Input();
+
+        /**
+         * @brief Queues events for all differences between the supplied snapshot and the prior one
+         * @note This must always be called from the same thread, it never blocks
+         */
+        void CommitSnapshot(const InputSnapshot &snapshot);
     };
 }
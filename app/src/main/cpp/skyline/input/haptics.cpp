@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <jvm.h>
+#include "haptics.h"
+
+namespace skyline::input {
+    constexpr jlong MsInSecond{1000}; //!< The amount of milliseconds in a single second of time
+    constexpr jint AmplitudeMax{std::numeric_limits<u8>::max()}; //!< The maximum amplitude for Android Vibration APIs
+
+    struct VibrationInfo {
+        jlong period;
+        jint amplitude;
+        jlong start; //!< The timestamp to (re)start the vibration at
+        jlong end; //!< The timestamp to end the vibration at
+
+        VibrationInfo() = default;
+
+        VibrationInfo(float frequency, float amplitude)
+            : period(static_cast<jlong>(MsInSecond / frequency)),
+              amplitude(static_cast<jint>(amplitude)),
+              start(0), end(period) {}
+    };
+
+    HapticsManager::HapticsManager(const DeviceState &state) : state(state) {
+        thread = std::thread(&HapticsManager::Run, this);
+    }
+
+    HapticsManager::~HapticsManager() {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        condition.notify_all();
+
+        if (thread.joinable())
+            thread.join();
+    }
+
+    void HapticsManager::Run() {
+        pthread_setname_np(pthread_self(), "Haptics");
+
+        std::array<Vibration, constant::ControllerCount> applied{}; // The last vibration applied to each device, this is only accessed by this thread
+        std::array<std::optional<Vibration>, constant::ControllerCount> pending;
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [&]() {
+                    return stop || std::any_of(slots.begin(), slots.end(), [](const DeviceSlot &slot) { return slot.pending; });
+                });
+                if (stop)
+                    return;
+
+                for (size_t index{}; index < slots.size(); index++) {
+                    if (slots[index].pending) {
+                        pending[index] = slots[index].vibration;
+                        slots[index].pending = false;
+                    }
+                }
+            }
+
+            for (size_t index{}; index < pending.size(); index++) {
+                if (pending[index] && *pending[index] != applied[index]) {
+                    applied[index] = *pending[index];
+                    Apply(index, applied[index]);
+                }
+                pending[index].reset();
+            }
+
+            // Any vibrations submitted while sleeping are coalesced into the latest one for each device
+            std::this_thread::sleep_for(ApplyPeriod);
+        }
+    }
+
+    void HapticsManager::Apply(size_t deviceIndex, const Vibration &vibration) {
+        auto &jvm{state.jvm};
+
+        jint totalAmplitude{};
+        std::array<VibrationInfo, MaxBands> vibrationStorage;
+        auto vibrations{span(vibrationStorage).first(vibration.bandCount)};
+        for (size_t band{}; band < vibration.bandCount; band++) {
+            vibrations[band] = VibrationInfo{vibration.bands[band].frequency, vibration.bands[band].amplitude};
+            totalAmplitude += vibrations[band].amplitude;
+        }
+
+        if (totalAmplitude == 0) {
+            jvm->ClearVibrationDevice(static_cast<jint>(deviceIndex)); // If a null vibration was submitted then we just clear vibrations on the device
+            return;
+        }
+
+        // We output an approximation of the combined + linearized vibration data into these arrays, larger arrays would allow for more accurate reproduction of data
+        std::array<jlong, 50> timings;
+        std::array<jint, 50> amplitudes;
+
+        // We are essentially unrolling the bands into a linear sequence, due to the data not being always linearizable there will be inaccuracies at the ends unless there's a pattern that's repeatable which will happen when all band's frequencies are factors of each other
+        jint currentAmplitude{}; //!< The accumulated amplitude from adding up and subtracting the amplitude of individual bands
+        jlong currentTime{}; //!< The accumulated time passed by adding up all the periods prior to the current vibration cycle
+        size_t index{};
+        for (; index < timings.size(); index++) {
+            jlong cyclePeriod{}; //!< The length of this cycle, calculated as the largest period with the same amplitude
+            size_t bandStartCount{}; //!< The amount of bands that start their vibration cycles in this time slot
+
+            for (auto &vibrationBand : vibrations) {
+                // Iterate over every band to calculate the amplitude for this time slot
+                if (currentTime <= vibrationBand.start) {
+                    // If the time to start has arrived then start the vibration
+                    vibrationBand.end = vibrationBand.start + vibrationBand.period;
+                    currentAmplitude += vibrationBand.amplitude;
+                    auto vibrationPeriodLeft{vibrationBand.end - currentTime};
+                    cyclePeriod = cyclePeriod ? std::min(vibrationPeriodLeft, cyclePeriod) : vibrationPeriodLeft;
+
+                    bandStartCount++;
+                } else if (currentTime <= vibrationBand.end) {
+                    // If the time to end the vibration has arrived then end it
+                    vibrationBand.start = vibrationBand.end + vibrationBand.period;
+                    currentAmplitude -= vibrationBand.amplitude;
+                    auto vibrationPeriodLeft{vibrationBand.start - currentTime};
+                    cyclePeriod = cyclePeriod ? std::min(vibrationPeriodLeft, cyclePeriod) : vibrationPeriodLeft;
+                }
+            }
+
+            if (index && bandStartCount == vibrations.size())
+                break; // If all bands start again at this point then we can end the pattern here and just loop over the pattern
+
+            currentTime += cyclePeriod;
+            timings[index] = cyclePeriod;
+
+            amplitudes[index] = std::min(currentAmplitude, AmplitudeMax);
+        }
+
+        jvm->VibrateDevice(static_cast<jint>(deviceIndex), span(timings.begin(), timings.begin() + index), span(amplitudes.begin(), amplitudes.begin() + index));
+    }
+
+    void HapticsManager::Submit(i8 index, span<const VibrationBand> bands) {
+        if (index < 0 || static_cast<size_t>(index) >= slots.size())
+            return;
+
+        {
+            std::lock_guard lock(mutex);
+            auto &slot{slots[static_cast<size_t>(index)]};
+            slot.vibration.bandCount = std::min(bands.size(), MaxBands);
+            std::copy_n(bands.begin(), slot.vibration.bandCount, slot.vibration.bands.begin());
+            slot.pending = true;
+        }
+        condition.notify_one();
+    }
+}
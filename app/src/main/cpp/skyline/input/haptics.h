@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <thread>
+#include "shared_mem.h"
+
+namespace skyline::input {
+    /**
+     * @brief A single band of vibration which is played back on a host device
+     */
+    struct VibrationBand {
+        float frequency; //!< The frequency of the band in Hz
+        float amplitude; //!< The amplitude of the band scaled to the range of Android's vibration amplitude
+
+        constexpr bool operator==(const VibrationBand &) const = default;
+    };
+
+    /**
+     * @brief The HapticsManager class applies guest vibration to host devices on a dedicated thread, this keeps JNI calls off the guest thread which submits vibration values
+     * @note Only the latest vibration submitted for a device is applied, submissions between applications are coalesced and those identical to the last applied one are skipped
+     */
+    class HapticsManager {
+      public:
+        static constexpr size_t MaxBands{4}; //!< The maximum amount of bands in a single vibration
+
+      private:
+        const DeviceState &state;
+
+        static constexpr std::chrono::milliseconds ApplyPeriod{10}; //!< The minimum interval between applications of vibration to host devices
+
+        struct Vibration {
+            std::array<VibrationBand, MaxBands> bands{};
+            size_t bandCount{};
+
+            bool operator==(const Vibration &other) const {
+                return bandCount == other.bandCount && std::equal(bands.begin(), bands.begin() + static_cast<ssize_t>(bandCount), other.bands.begin());
+            }
+        };
+
+        /**
+         * @brief A slot holding the latest vibration submitted for a host device
+         */
+        struct DeviceSlot {
+            Vibration vibration; //!< The latest vibration submitted by the guest
+            bool pending{}; //!< If the vibration hasn't been picked up by the haptics thread yet
+        };
+
+        std::mutex mutex; //!< Synchronizes access to the slots and stopping the thread
+        std::condition_variable condition; //!< Signalled when a vibration is submitted or the thread should stop
+        std::array<DeviceSlot, constant::ControllerCount> slots;
+        bool stop{};
+        std::thread thread;
+
+        /**
+         * @brief The entry point of the haptics thread, this applies pending vibrations at most once per ApplyPeriod
+         */
+        void Run();
+
+        /**
+         * @brief Linearizes the bands of a vibration into a pattern and plays it back on the supplied host device
+         */
+        void Apply(size_t index, const Vibration &vibration);
+
+      public:
+        HapticsManager(const DeviceState &state);
+
+        ~HapticsManager();
+
+        /**
+         * @brief Replaces any pending vibration for the supplied host device with the supplied bands, this never calls into the JVM
+         * @param index The index of the host device, negative indices are ignored
+         */
+        void Submit(i8 index, span<const VibrationBand> bands);
+    };
+}
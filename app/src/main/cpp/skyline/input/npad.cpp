@@ -5,7 +5,7 @@
 #include "npad.h"
 
 namespace skyline::input {
-    NpadManager::NpadManager(const DeviceState &state, input::HidSharedMemory *hid) : state(state), npads
+    NpadManager::NpadManager(const DeviceState &state, input::HidSharedMemory *hid) : state(state), haptics(state), npads
         {NpadDevice{*this, hid->npad[0], NpadId::Player1}, {*this, hid->npad[1], NpadId::Player2},
          {*this, hid->npad[2], NpadId::Player3}, {*this, hid->npad[3], NpadId::Player4},
          {*this, hid->npad[4], NpadId::Player5}, {*this, hid->npad[5], NpadId::Player6},
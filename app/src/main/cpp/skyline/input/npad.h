@@ -22,6 +22,7 @@ namespace skyline::input {
       private:
         const DeviceState &state;
         bool activated{};
+        HapticsManager haptics; //!< Applies vibration from all NPads to host devices
 
         friend NpadDevice;
 
@@ -1,7 +1,6 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
-#include <jvm.h>
 #include "npad_device.h"
 #include "npad.h"
 
@@ -146,8 +145,10 @@ namespace skyline::input {
         type = newType;
         controllerInfo = &GetControllerInfo();
 
-        GetNextEntry(*controllerInfo);
-        GetNextEntry(section.defaultController);
+        controllerState = {};
+        defaultState = {};
+        WriteNextEntry(*controllerInfo, controllerState);
+        WriteNextEntry(section.defaultController, defaultState);
         globalTimestamp++;
 
         updateEvent->Signal();
@@ -186,33 +187,40 @@ namespace skyline::input {
         }
     }
 
-    NpadControllerState &NpadDevice::GetNextEntry(NpadControllerInfo &info) {
-        auto &lastEntry{info.state.at(info.header.currentEntry)};
+    void NpadDevice::WriteNextEntry(NpadControllerInfo &info, const NpadControllerState &state) {
+        const auto &lastEntry{info.state.at(info.header.currentEntry)};
+        auto entryIndex{(info.header.currentEntry != constant::HidEntryCount - 1) ? info.header.currentEntry + 1 : 0};
+        auto &entry{info.state.at(entryIndex)};
+
+        entry.globalTimestamp = globalTimestamp;
+        entry.localTimestamp = lastEntry.localTimestamp + 1;
+        entry.buttons = state.buttons;
+        entry.leftX = state.leftX;
+        entry.leftY = state.leftY;
+        entry.rightX = state.rightX;
+        entry.rightY = state.rightY;
+        entry.status.raw = connectionState.raw;
 
         info.header.timestamp = util::GetTimeTicks();
         info.header.entryCount = std::min(static_cast<u8>(info.header.entryCount + 1), constant::HidEntryCount);
         info.header.maxEntry = info.header.entryCount;
-        info.header.currentEntry = (info.header.currentEntry != constant::HidEntryCount - 1) ? info.header.currentEntry + 1 : 0;
-
-        auto &entry{info.state.at(info.header.currentEntry)};
+        std::atomic_ref(info.header.currentEntry).store(entryIndex, std::memory_order_release);
+    }
 
-        entry.globalTimestamp = globalTimestamp;
-        entry.localTimestamp = lastEntry.localTimestamp + 1;
-        entry.buttons = lastEntry.buttons;
-        entry.leftX = lastEntry.leftX;
-        entry.leftY = lastEntry.leftY;
-        entry.rightX = lastEntry.rightX;
-        entry.rightY = lastEntry.rightY;
-        entry.status.raw = connectionState.raw;
+    void NpadDevice::UpdateSharedMemory() {
+        if (!connectionState.connected)
+            return;
 
-        return entry;
+        WriteNextEntry(*controllerInfo, controllerState);
+        WriteNextEntry(section.defaultController, defaultState);
+        globalTimestamp++;
     }
 
     void NpadDevice::SetButtonState(NpadButton mask, bool pressed) {
         if (!connectionState.connected)
             return;
 
-        auto &entry{GetNextEntry(*controllerInfo)};
+        auto &entry{controllerState};
 
         if (pressed)
             entry.buttons.raw |= mask.raw;
@@ -252,21 +260,19 @@ namespace skyline::input {
             mask = orientedMask;
         }
 
-        auto &defaultEntry{GetNextEntry(section.defaultController)};
+        auto &defaultEntry{defaultState};
         if (pressed)
             defaultEntry.buttons.raw |= mask.raw;
         else
             defaultEntry.buttons.raw &= ~mask.raw;
-
-        globalTimestamp++;
     }
 
     void NpadDevice::SetAxisValue(NpadAxisId axis, i32 value) {
         if (!connectionState.connected)
             return;
 
-        auto &controllerEntry{GetNextEntry(*controllerInfo)};
-        auto &defaultEntry{GetNextEntry(section.defaultController)};
+        auto &controllerEntry{controllerState};
+        auto &defaultEntry{defaultState};
 
         constexpr i16 threshold{std::numeric_limits<i16>::max() / 2}; // A 50% deadzone for the stick buttons
 
@@ -353,85 +359,16 @@ namespace skyline::input {
                     break;
             }
         }
-
-        globalTimestamp++;
     }
 
-    constexpr jlong MsInSecond{1000}; //!< The amount of milliseconds in a single second of time
-    constexpr jint AmplitudeMax{std::numeric_limits<u8>::max()}; //!< The maximum amplitude for Android Vibration APIs
-
-    struct VibrationInfo {
-        jlong period;
-        jint amplitude;
-        jlong start; //!< The timestamp to (re)start the vibration at
-        jlong end; //!< The timestamp to end the vibration at
-
-        VibrationInfo(float frequency, float amplitude)
-            : period(static_cast<jlong>(MsInSecond / frequency)),
-              amplitude(static_cast<jint>(amplitude)),
-              start(0), end(period) {}
-    };
-
-    template<size_t Size>
-    void VibrateDevice(const std::shared_ptr<JvmManager> &jvm, i8 deviceIndex, std::array<VibrationInfo, Size> vibrations) {
-        jint totalAmplitude{};
-        for (const auto &vibration : vibrations)
-            totalAmplitude += vibration.amplitude;
-        if (totalAmplitude == 0) {
-            jvm->ClearVibrationDevice(deviceIndex); // If a null vibration was submitted then we just clear vibrations on the device
-            return;
-        }
-
-        // We output an approximation of the combined + linearized vibration data into these arrays, larger arrays would allow for more accurate reproduction of data
-        std::array<jlong, 50> timings;
-        std::array<jint, 50> amplitudes;
-
-        // We are essentially unrolling the bands into a linear sequence, due to the data not being always linearizable there will be inaccuracies at the ends unless there's a pattern that's repeatable which will happen when all band's frequencies are factors of each other
-        jint currentAmplitude{}; //!< The accumulated amplitude from adding up and subtracting the amplitude of individual bands
-        jlong currentTime{}; //!< The accumulated time passed by adding up all the periods prior to the current vibration cycle
-        size_t index{};
-        for (; index < timings.size(); index++) {
-            jlong cyclePeriod{}; //!< The length of this cycle, calculated as the largest period with the same amplitude
-            size_t bandStartCount{}; //!< The amount of bands that start their vibration cycles in this time slot
-
-            for (size_t vibrationIndex{}; vibrationIndex < vibrations.size(); vibrationIndex++) {
-                // Iterate over every band to calculate the amplitude for this time slot
-                VibrationInfo &vibration{vibrations[vibrationIndex]};
-                if (currentTime <= vibration.start) {
-                    // If the time to start has arrived then start the vibration
-                    vibration.end = vibration.start + vibration.period;
-                    currentAmplitude += vibration.amplitude;
-                    auto vibrationPeriodLeft{vibration.end - currentTime};
-                    cyclePeriod = cyclePeriod ? std::min(vibrationPeriodLeft, cyclePeriod) : vibrationPeriodLeft;
-
-                    bandStartCount++;
-                } else if (currentTime <= vibration.end) {
-                    // If the time to end the vibration has arrived then end it
-                    vibration.start = vibration.end + vibration.period;
-                    currentAmplitude -= vibration.amplitude;
-                    auto vibrationPeriodLeft{vibration.start - currentTime};
-                    cyclePeriod = cyclePeriod ? std::min(vibrationPeriodLeft, cyclePeriod) : vibrationPeriodLeft;
-                }
-            }
-
-            if (index && bandStartCount == vibrations.size())
-                break; // If all bands start again at this point then we can end the pattern here and just loop over the pattern
-
-            currentTime += cyclePeriod;
-            timings[index] = cyclePeriod;
-
-            amplitudes[index] = std::min(currentAmplitude, AmplitudeMax);
-        }
-
-        jvm->VibrateDevice(deviceIndex, span(timings.begin(), timings.begin() + index), span(amplitudes.begin(), amplitudes.begin() + index));
-    }
+    constexpr i32 AmplitudeMax{std::numeric_limits<u8>::max()}; //!< The maximum amplitude for Android Vibration APIs
 
-    void VibrateDevice(const std::shared_ptr<JvmManager> &jvm, i8 index, const NpadVibrationValue &value) {
-        std::array<VibrationInfo, 2> vibrations{
-            VibrationInfo{value.frequencyLow, value.amplitudeLow * (AmplitudeMax / 2)},
-            VibrationInfo{value.frequencyHigh, value.amplitudeHigh * (AmplitudeMax / 2)},
+    static void VibrateDevice(HapticsManager &haptics, i8 index, const NpadVibrationValue &value) {
+        std::array<VibrationBand, 2> bands{
+            VibrationBand{value.frequencyLow, value.amplitudeLow * (AmplitudeMax / 2)},
+            VibrationBand{value.frequencyHigh, value.amplitudeHigh * (AmplitudeMax / 2)},
         };
-        VibrateDevice(jvm, index, vibrations);
+        haptics.Submit(index, bands);
     }
 
     void NpadDevice::Vibrate(const NpadVibrationValue &left, const NpadVibrationValue &right) {
@@ -442,16 +379,16 @@ namespace skyline::input {
         vibrationRight = right;
 
         if (partnerIndex == NpadDevice::NullIndex) {
-            std::array<VibrationInfo, 4> vibrations{
-                VibrationInfo{left.frequencyLow, left.amplitudeLow * (AmplitudeMax / 4)},
-                VibrationInfo{left.frequencyHigh, left.amplitudeHigh * (AmplitudeMax / 4)},
-                VibrationInfo{right.frequencyLow, right.amplitudeLow * (AmplitudeMax / 4)},
-                VibrationInfo{right.frequencyHigh, right.amplitudeHigh * (AmplitudeMax / 4)},
+            std::array<VibrationBand, 4> bands{
+                VibrationBand{left.frequencyLow, left.amplitudeLow * (AmplitudeMax / 4)},
+                VibrationBand{left.frequencyHigh, left.amplitudeHigh * (AmplitudeMax / 4)},
+                VibrationBand{right.frequencyLow, right.amplitudeLow * (AmplitudeMax / 4)},
+                VibrationBand{right.frequencyHigh, right.amplitudeHigh * (AmplitudeMax / 4)},
             };
-            VibrateDevice(manager.state.jvm, index, vibrations);
+            manager.haptics.Submit(index, bands);
         } else {
-            VibrateDevice(manager.state.jvm, index, left);
-            VibrateDevice(manager.state.jvm, partnerIndex, right);
+            VibrateDevice(manager.haptics, index, left);
+            VibrateDevice(manager.haptics, partnerIndex, right);
         }
     }
 
@@ -469,6 +406,6 @@ namespace skyline::input {
         if (vibrationRight)
             Vibrate(vibrationLeft, *vibrationRight);
         else
-            VibrateDevice(manager.state.jvm, index, value);
+            VibrateDevice(manager.haptics, index, value);
     }
 }
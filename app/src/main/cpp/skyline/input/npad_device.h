@@ -5,6 +5,7 @@
 
 #include <kernel/types/KEvent.h>
 #include "shared_mem.h"
+#include "haptics.h"
 
 namespace skyline::input {
     /**
@@ -116,13 +117,14 @@ namespace skyline::input {
         NpadSection &section; //!< The section in HID shared memory for this controller
         NpadControllerInfo *controllerInfo{}; //!< The NpadControllerInfo for this controller's type
         u64 globalTimestamp{}; //!< An incrementing timestamp that's common across all sections
+        NpadControllerState controllerState{}; //!< The host state of the controller for its type, this is written into shared memory on every sample
+        NpadControllerState defaultState{}; //!< The host state of the controller for the default section, this is written into shared memory on every sample
 
         /**
-         * @brief Updates the headers and creates a new entry in HID Shared Memory
-         * @param info The controller info of the NPad that needs to be updated
-         * @return The next entry that has been created with values from the last entry
+         * @brief Creates a new entry in HID Shared Memory with the inputs from the supplied host state
+         * @note The entry is completely written before it's published in the header, the guest reads shared memory concurrently and must never observe a partially written entry
          */
-        NpadControllerState &GetNextEntry(NpadControllerInfo &info);
+        void WriteNextEntry(NpadControllerInfo &info, const NpadControllerState &state);
 
         /**
          * @return The NpadControllerInfo for this controller based on its type
@@ -160,8 +162,14 @@ namespace skyline::input {
          */
         void Disconnect();
 
+        /**
+         * @brief Writes a sample of the current host state of the controller into HID Shared Memory
+         */
+        void UpdateSharedMemory();
+
         /**
          * @brief Changes the state of buttons to the specified state
+         * @note The change is only visible to the guest after the next call to UpdateSharedMemory
          * @param mask A bit-field mask of all the buttons to change
          * @param pressed If the buttons were pressed or released
          */
@@ -169,6 +177,7 @@ namespace skyline::input {
 
         /**
          * @brief Sets the value of an axis to the specified value
+         * @note The change is only visible to the guest after the next call to UpdateSharedMemory
          * @param axis The axis to set the value of
          * @param value The value to set
          */
@@ -9,24 +9,35 @@ namespace skyline::input {
     }
 
     void TouchManager::Activate() {
+        std::lock_guard guard(mutex);
         if (!activated) {
             activated = true;
-            SetState({});
+            pointCount = 0;
+            WriteNextEntry();
         }
     }
 
-    void TouchManager::SetState(const span<TouchScreenPoint> &points) {
-        if (!activated)
-            return;
+    void TouchManager::SetState(span<TouchScreenPoint> newPoints) {
+        std::lock_guard guard(mutex);
+        pointCount = std::min(newPoints.size(), MaxPoints);
+        std::copy_n(newPoints.begin(), pointCount, points.begin());
+    }
+
+    void TouchManager::UpdateSharedMemory() {
+        std::lock_guard guard(mutex);
+        if (activated)
+            WriteNextEntry();
+    }
 
+    void TouchManager::WriteNextEntry() {
         const auto &lastEntry{section.entries[section.header.currentEntry]};
         auto entryIndex{(section.header.currentEntry != constant::HidEntryCount - 1) ? section.header.currentEntry + 1 : 0};
         auto &entry{section.entries[entryIndex]};
         entry.globalTimestamp = lastEntry.globalTimestamp + 1;
         entry.localTimestamp = lastEntry.localTimestamp + 1;
-        entry.touchCount = points.size();
+        entry.touchCount = pointCount;
 
-        for (size_t i{}; i < points.size(); i++) {
+        for (size_t i{}; i < pointCount; i++) {
             const auto &host{points[i]};
             auto &guest{entry.data[i]};
             guest.index = static_cast<u32>(i);
@@ -40,6 +51,6 @@ namespace skyline::input {
         section.header.timestamp = util::GetTimeTicks();
         section.header.entryCount = std::min(static_cast<u8>(section.header.entryCount + 1), constant::HidEntryCount);
         section.header.maxEntry = section.header.entryCount;
-        section.header.currentEntry = entryIndex;
+        std::atomic_ref(section.header.currentEntry).store(entryIndex, std::memory_order_release); // The entry must be completely written prior to being published
     }
 }
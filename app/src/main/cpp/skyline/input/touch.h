@@ -24,10 +24,21 @@ namespace skyline::input {
      * @brief This class is used to manage the shared memory responsible for touch-screen data
      */
     class TouchManager {
+      public:
+        static constexpr size_t MaxPoints{16}; //!< The maximum amount of points that can be reported in a single entry
+
       private:
         const DeviceState &state;
+        std::mutex mutex; //!< Synchronizes activation by HID services with updates from the input thread
         bool activated{};
         TouchScreenSection &section;
+        std::array<TouchScreenPoint, MaxPoints> points{}; //!< The host touch points which are written into shared memory on every sample
+        size_t pointCount{}; //!< The amount of valid points in the points array
+
+        /**
+         * @brief Creates a new entry in HID Shared Memory with the current host touch points
+         */
+        void WriteNextEntry();
 
       public:
         /**
@@ -37,6 +48,15 @@ namespace skyline::input {
 
         void Activate();
 
-        void SetState(const span<TouchScreenPoint> &points);
+        /**
+         * @brief Sets the touch points that will be reported to the guest, any points beyond MaxPoints are ignored
+         * @note The change is only visible to the guest after the next call to UpdateSharedMemory
+         */
+        void SetState(span<TouchScreenPoint> newPoints);
+
+        /**
+         * @brief Writes a sample of the current host touch points into HID Shared Memory
+         */
+        void UpdateSharedMemory();
     };
 }
@@ -133,7 +133,7 @@ namespace skyline::kernel::ipc {
         memset(tls, 0, constant::TlsIpcSize);
 
         auto header{reinterpret_cast<CommandHeader *>(pointer)};
-        header->rawSize = static_cast<u32>((sizeof(PayloadHeader) + payload.size() + (domainObjects.size() * sizeof(KHandle)) + constant::IpcPaddingSum + (isDomain ? sizeof(DomainHeaderRequest) : 0)) / sizeof(u32)); // Size is in 32-bit units because Nintendo
+        header->rawSize = static_cast<u32>((sizeof(PayloadHeader) + payloadSize + (domainObjects.size() * sizeof(KHandle)) + constant::IpcPaddingSum + (isDomain ? sizeof(DomainHeaderRequest) : 0)) / sizeof(u32)); // Size is in 32-bit units because Nintendo
         header->handleDesc = (!copyHandles.empty() || !moveHandles.empty());
         pointer += sizeof(CommandHeader);
 
@@ -170,9 +170,11 @@ namespace skyline::kernel::ipc {
         payloadHeader->value = errorCode;
         pointer += sizeof(PayloadHeader);
 
-        if (!payload.empty())
-            std::memcpy(pointer, payload.data(), payload.size());
-        pointer += payload.size();
+        if (static_cast<size_t>(pointer - tls) + payloadSize + (isDomain ? domainObjects.size() * sizeof(KHandle) : 0) > constant::TlsIpcSize) [[unlikely]]
+            throw exception("IPC response doesn't fit in the command buffer: payload 0x{:X}, domain objects {}", payloadSize, domainObjects.size());
+
+        std::memcpy(pointer, payload.data(), payloadSize);
+        pointer += payloadSize;
 
         if (isDomain) {
             for (auto &domainObject : domainObjects) {
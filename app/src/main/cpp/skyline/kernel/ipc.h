@@ -247,7 +247,19 @@ namespace skyline {
         class IpcResponse {
           private:
             const DeviceState &state;
-            std::vector<u8> payload; //!< The contents to be pushed to the data payload
+            std::array<u8, constant::TlsIpcSize> payload; //!< The contents to be pushed to the data payload, this is bounded by the size of the command buffer so it's stored inline rather than on the heap
+            size_t payloadSize{}; //!< The amount of bytes that have been pushed to the payload
+
+            /**
+             * @return A pointer to the next free byte in the payload with the supplied size reserved
+             */
+            u8 *ReservePayload(size_t size) {
+                if (payloadSize + size > payload.size()) [[unlikely]]
+                    throw exception("IPC response payload exceeds the size of the command buffer: 0x{:X} + 0x{:X}", payloadSize, size);
+                u8 *pointer{payload.data() + payloadSize};
+                payloadSize += size;
+                return pointer;
+            }
 
           public:
             Result errorCode{}; //!< The error code to respond with, it's 0 (Success) by default
@@ -264,9 +276,7 @@ namespace skyline {
              */
             template<typename ValueType>
             void Push(const ValueType &value) {
-                auto size{payload.size()};
-                payload.resize(size + sizeof(ValueType));
-                std::memcpy(payload.data() + size, reinterpret_cast<const u8 *>(&value), sizeof(ValueType));
+                std::memcpy(ReservePayload(sizeof(ValueType)), reinterpret_cast<const u8 *>(&value), sizeof(ValueType));
             }
 
             /**
@@ -274,9 +284,7 @@ namespace skyline {
              * @param string The string to write to the payload
              */
             void Push(std::string_view string) {
-                auto size{payload.size()};
-                payload.resize(size + string.size());
-                std::memcpy(payload.data() + size, string.data(), string.size());
+                std::memcpy(ReservePayload(string.size()), string.data(), string.size());
             }
 
             /**
@@ -1,15 +1,22 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <linux/falloc.h>
+#include <linux/memfd.h>
+#include <sys/syscall.h>
 #include "memory.h"
 #include "types/KProcess.h"
 
 namespace skyline::kernel {
+    constexpr int MadvisePopulateWrite{23}; //!< MADV_POPULATE_WRITE, this was added in Linux 5.14 and isn't in the NDK headers
+
     MemoryManager::MemoryManager(const DeviceState &state) : state(state) {}
 
     MemoryManager::~MemoryManager() {
         if (base.address && base.size)
             munmap(reinterpret_cast<void *>(base.address), base.size);
+        if (memoryFd >= 0)
+            close(memoryFd);
     }
 
     constexpr size_t RegionAlignment{1ULL << 21}; //!< The minimum alignment of a HOS memory region
@@ -61,26 +68,35 @@ namespace skyline::kernel {
         if (!base.address)
             throw exception("Cannot find a suitable carveout for the guest address space");
 
-        auto result{mmap(reinterpret_cast<void *>(base.address), base.size, PROT_NONE, MAP_FIXED | MAP_ANONYMOUS | MAP_PRIVATE, -1, 0)};
+        // The guest AS is backed by a memfd rather than anonymous memory so svcMapMemory can alias pages at another address rather than copying them, it's sparse so only touched pages are allocated
+        memoryFd = static_cast<int>(syscall(__NR_memfd_create, "HOS-AS", MFD_CLOEXEC));
+        if (memoryFd < 0)
+            throw exception("Failed to create guest memory backing: {}", strerror(errno));
+        if (ftruncate(memoryFd, static_cast<off_t>(base.size)) < 0)
+            throw exception("Failed to resize guest memory backing: {}", strerror(errno));
+
+        auto result{mmap(reinterpret_cast<void *>(base.address), base.size, PROT_NONE, MAP_FIXED | MAP_SHARED, memoryFd, 0)};
         if (result == MAP_FAILED)
             throw exception("Failed to mmap guest address space: {}", strerror(errno));
 
+        auto reservedLow{reinterpret_cast<u8 *>(addressSpace.address)}, unmapped{reinterpret_cast<u8 *>(base.address)}, reservedHigh{reinterpret_cast<u8 *>(base.address + base.size)};
         chunks = {
-            ChunkDescriptor{
-                .ptr = reinterpret_cast<u8 *>(addressSpace.address),
+            {reservedLow, ChunkDescriptor{
+                .ptr = reservedLow,
                 .size = base.address - addressSpace.address,
                 .state = memory::states::Reserved,
-            },
-            ChunkDescriptor{
-                .ptr = reinterpret_cast<u8 *>(base.address),
+            }},
+            {unmapped, ChunkDescriptor{
+                .ptr = unmapped,
                 .size = base.size,
                 .state = memory::states::Unmapped,
-            },
-            ChunkDescriptor{
-                .ptr = reinterpret_cast<u8 *>(base.address + base.size),
+            }},
+            {reservedHigh, ChunkDescriptor{
+                .ptr = reservedHigh,
                 .size = addressSpace.size - (base.address + base.size),
                 .state = memory::states::Reserved,
-            }};
+            }}};
+        std::atomic_store(&snapshot, std::shared_ptr<const ChunkSnapshot>{});
     }
 
     void MemoryManager::InitializeRegions(u8 *codeStart, u64 size) {
@@ -131,77 +147,165 @@ namespace skyline::kernel {
         if (size > code.size)
             throw exception("Code region ({}) is smaller than mapped code size ({})", code.size, size);
 
+        // The heap is the largest and most randomly accessed region, backing it with transparent huge pages where available significantly cuts down on TLB misses
+        if (madvise(reinterpret_cast<void *>(heap.address), heap.size, MADV_HUGEPAGE) < 0)
+            Logger::Debug("Transparent huge pages are unavailable for the heap region: {}", strerror(errno));
+
         Logger::Debug("Region Map:\nVMM Base: 0x{:X}\nCode Region: 0x{:X} - 0x{:X} (Size: 0x{:X})\nAlias Region: 0x{:X} - 0x{:X} (Size: 0x{:X})\nHeap Region: 0x{:X} - 0x{:X} (Size: 0x{:X})\nStack Region: 0x{:X} - 0x{:X} (Size: 0x{:X})\nTLS/IO Region: 0x{:X} - 0x{:X} (Size: 0x{:X})", base.address, code.address, code.address + code.size, code.size, alias.address, alias.address + alias.size, alias.size, heap.address, heap
             .address + heap.size, heap.size, stack.address, stack.address + stack.size, stack.size, tlsIo.address, tlsIo.address + tlsIo.size, tlsIo.size);
     }
 
+    off_t MemoryManager::GetBackingOffset(u8 *ptr) {
+        if (!base.IsInside(ptr))
+            throw exception("Address isn't inside guest address space: 0x{:X}", ptr);
+        return static_cast<off_t>(ptr - reinterpret_cast<u8 *>(base.address));
+    }
+
+    void MemoryManager::MapAlias(u8 *destination, u8 *source, size_t size, memory::Permission permission) {
+        if (!base.IsInside(source + size - 1))
+            throw exception("Aliased range isn't inside guest address space: 0x{:X} - 0x{:X}", source, source + size);
+
+        if (mmap(destination, size, permission.Get(), MAP_SHARED | MAP_FIXED, memoryFd, GetBackingOffset(source)) == MAP_FAILED)
+            throw exception("Failed to alias 0x{:X} - 0x{:X} at 0x{:X}: {}", source, source + size, destination, strerror(errno));
+    }
+
+    void MemoryManager::RestoreBacking(u8 *ptr, size_t size, int protection) {
+        if (!base.IsInside(ptr + size - 1))
+            throw exception("Restored range isn't inside guest address space: 0x{:X} - 0x{:X}", ptr, ptr + size);
+
+        auto offset{GetBackingOffset(ptr)};
+        if (fallocate(memoryFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, static_cast<off_t>(size)) < 0)
+            throw exception("Failed to release guest memory backing at 0x{:X} - 0x{:X}: {}", ptr, ptr + size, strerror(errno));
+
+        if (mmap(ptr, size, protection, MAP_SHARED | MAP_FIXED, memoryFd, offset) == MAP_FAILED)
+            throw exception("Failed to restore guest memory backing at 0x{:X} - 0x{:X}: {}", ptr, ptr + size, strerror(errno));
+    }
+
+    void MemoryManager::FreeBacking(u8 *ptr, size_t size) {
+        if (!size || !base.IsInside(ptr) || !base.IsInside(ptr + size - 1)) [[unlikely]]
+            return;
+
+        if (fallocate(memoryFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, GetBackingOffset(ptr), static_cast<off_t>(size)) < 0)
+            Logger::Warn("Failed to release guest memory backing at 0x{:X} - 0x{:X}: {}", ptr, ptr + size, strerror(errno));
+    }
+
+    std::map<u8 *, ChunkDescriptor>::iterator MemoryManager::MoveChunkStart(std::map<u8 *, ChunkDescriptor>::iterator chunk, u8 *ptr) {
+        auto end{chunk->second.ptr + chunk->second.size};
+        auto node{chunks.extract(chunk)};
+        node.key() = ptr;
+        node.mapped().ptr = ptr;
+        node.mapped().size = static_cast<size_t>(end - ptr);
+        return chunks.insert(std::move(node)).position;
+    }
+
     void MemoryManager::InsertChunk(const ChunkDescriptor &chunk) {
         std::unique_lock lock(mutex);
 
-        auto upper{std::upper_bound(chunks.begin(), chunks.end(), chunk.ptr, [](const u8 *ptr, const ChunkDescriptor &chunk) -> bool { return ptr < chunk.ptr; })};
+        // Any snapshot is now stale and readers need to fall back to the map till a new one is taken
+        std::atomic_store(&snapshot, std::shared_ptr<const ChunkSnapshot>{});
+        snapshotMisses = 0;
+
+        auto chunkEnd{chunk.ptr + chunk.size};
+        auto upper{chunks.upper_bound(chunk.ptr)};
         if (upper == chunks.begin())
-            throw exception("InsertChunk: Chunk inserted outside address space: 0x{:X} - 0x{:X} and 0x{:X} - 0x{:X}", upper->ptr, upper->ptr + upper->size, chunk.ptr, chunk.ptr + chunk.size);
+            throw exception("InsertChunk: Chunk inserted outside address space: 0x{:X} - 0x{:X} and 0x{:X} - 0x{:X}", upper->second.ptr, upper->second.ptr + upper->second.size, chunk.ptr, chunkEnd);
 
-        upper = chunks.erase(upper, std::upper_bound(upper, chunks.end(), chunk.ptr + chunk.size, [](const u8 *ptr, const ChunkDescriptor &chunk) -> bool { return ptr < chunk.ptr + chunk.size; }));
-        if (upper != chunks.end() && upper->ptr < chunk.ptr + chunk.size) {
-            auto end{upper->ptr + upper->size};
-            upper->ptr = chunk.ptr + chunk.size;
-            upper->size = static_cast<size_t>(end - upper->ptr);
+        // Remove all chunks that are entirely covered by the new chunk and trim the start of any chunk that's partially covered by it
+        while (upper != chunks.end() && upper->first < chunkEnd) {
+            if (upper->second.ptr + upper->second.size <= chunkEnd) {
+                upper = chunks.erase(upper);
+            } else {
+                upper = MoveChunkStart(upper, chunkEnd);
+                break;
+            }
         }
 
         auto lower{std::prev(upper)};
-        if (lower->ptr == chunk.ptr && lower->size == chunk.size) {
-            lower->state = chunk.state;
-            lower->permission = chunk.permission;
-            lower->attributes = chunk.attributes;
-        } else if (lower->ptr + lower->size > chunk.ptr + chunk.size) {
-            auto lowerExtension{*lower};
-            lowerExtension.ptr = chunk.ptr + chunk.size;
-            lowerExtension.size = static_cast<size_t>((lower->ptr + lower->size) - lowerExtension.ptr);
-
-            lower->size = static_cast<size_t>(chunk.ptr - lower->ptr);
-            if (lower->size) {
-                upper = chunks.insert(upper, lowerExtension);
-                chunks.insert(upper, chunk);
+        auto &lowerChunk{lower->second};
+        auto lowerEnd{lowerChunk.ptr + lowerChunk.size};
+        if (lowerChunk.ptr == chunk.ptr && lowerChunk.size == chunk.size) {
+            lowerChunk.state = chunk.state;
+            lowerChunk.permission = chunk.permission;
+            lowerChunk.attributes = chunk.attributes;
+        } else if (lowerEnd > chunkEnd) {
+            // The new chunk is entirely inside the lower chunk, the lower chunk needs to be split around it
+            auto lowerExtension{lowerChunk};
+            lowerExtension.ptr = chunkEnd;
+            lowerExtension.size = static_cast<size_t>(lowerEnd - chunkEnd);
+            chunks.emplace_hint(upper, chunkEnd, lowerExtension);
+
+            lowerChunk.size = static_cast<size_t>(chunk.ptr - lowerChunk.ptr);
+            if (lowerChunk.size) {
+                chunks.emplace_hint(upper, chunk.ptr, chunk);
+            } else if (lower != chunks.begin() && chunk.IsCompatible(std::prev(lower)->second)) {
+                auto &lower2{std::prev(lower)->second};
+                lower2.size = static_cast<size_t>(chunkEnd - lower2.ptr);
+                chunks.erase(lower);
             } else {
-                auto lower2{std::prev(lower)};
-                if (chunk.IsCompatible(*lower2) && lower2->ptr + lower2->size >= chunk.ptr) {
-                    lower2->size = static_cast<size_t>(chunk.ptr + chunk.size - lower2->ptr);
-                    upper = chunks.erase(lower);
-                } else {
-                    *lower = chunk;
-                }
-                upper = chunks.insert(upper, lowerExtension);
+                lowerChunk = chunk;
             }
-        } else if (chunk.IsCompatible(*lower) && lower->ptr + lower->size >= chunk.ptr) {
-            lower->size = static_cast<size_t>(chunk.ptr + chunk.size - lower->ptr);
+        } else if (chunk.IsCompatible(lowerChunk) && lowerEnd >= chunk.ptr) {
+            lowerChunk.size = static_cast<size_t>(chunkEnd - lowerChunk.ptr);
         } else {
-            if (lower->ptr + lower->size > chunk.ptr)
-                lower->size = static_cast<size_t>(chunk.ptr - lower->ptr);
-            if (upper != chunks.end() && chunk.IsCompatible(*upper) && chunk.ptr + chunk.size >= upper->ptr) {
-                upper->ptr = chunk.ptr;
-                upper->size = chunk.size + upper->size;
-            } else {
-                chunks.insert(upper, chunk);
-            }
+            if (lowerEnd > chunk.ptr)
+                lowerChunk.size = static_cast<size_t>(chunk.ptr - lowerChunk.ptr);
+            if (!lowerChunk.size)
+                chunks.erase(lower); // The lower chunk started at the same address as the new chunk and has been entirely replaced by it
+
+            if (upper != chunks.end() && chunk.IsCompatible(upper->second) && chunkEnd >= upper->second.ptr)
+                MoveChunkStart(upper, chunk.ptr);
+            else
+                chunks.emplace_hint(upper, chunk.ptr, chunk);
         }
     }
 
     std::optional<ChunkDescriptor> MemoryManager::Get(void *ptr) {
+        auto address{reinterpret_cast<u8 *>(ptr)};
+        if (auto chunkSnapshot{std::atomic_load(&snapshot)}) {
+            auto chunk{std::upper_bound(chunkSnapshot->begin(), chunkSnapshot->end(), address, [](const u8 *ptr, const ChunkDescriptor &chunk) -> bool { return ptr < chunk.ptr; })};
+            if (chunk-- != chunkSnapshot->begin())
+                if ((chunk->ptr + chunk->size) > address)
+                    return *chunk;
+
+            return std::nullopt;
+        }
+
         std::shared_lock lock(mutex);
+        if (++snapshotMisses == SnapshotRebuildThreshold) {
+            // We only take a snapshot after a certain amount of lookups without any mutations as it requires copying all chunks
+            auto chunkSnapshot{std::make_shared<ChunkSnapshot>()};
+            chunkSnapshot->reserve(chunks.size());
+            for (const auto &[chunkPtr, chunk] : chunks)
+                chunkSnapshot->push_back(chunk);
+            std::atomic_store(&snapshot, std::shared_ptr<const ChunkSnapshot>{std::move(chunkSnapshot)});
+        }
 
-        auto chunk{std::upper_bound(chunks.begin(), chunks.end(), reinterpret_cast<u8 *>(ptr), [](const u8 *ptr, const ChunkDescriptor &chunk) -> bool { return ptr < chunk.ptr; })};
+        auto chunk{chunks.upper_bound(address)};
         if (chunk-- != chunks.begin())
-            if ((chunk->ptr + chunk->size) > ptr)
-                return std::make_optional(*chunk);
+            if ((chunk->second.ptr + chunk->second.size) > address)
+                return chunk->second;
 
         return std::nullopt;
     }
 
+    void MemoryManager::Populate(span<u8> range) {
+        if (range.empty())
+            return;
+
+        auto start{util::AlignDown(range.data(), PAGE_SIZE)}, end{util::AlignUp(range.data() + range.size(), PAGE_SIZE)};
+        if (madvise(start, static_cast<size_t>(end - start), MadvisePopulateWrite) == 0)
+            return;
+
+        for (auto page{start}; page < end; page += PAGE_SIZE) {
+            auto pointer{reinterpret_cast<volatile u8 *>(page)};
+            *pointer = *pointer;
+        }
+    }
+
     size_t MemoryManager::GetUserMemoryUsage() {
         std::shared_lock lock(mutex);
         size_t size{};
-        for (const auto &chunk : chunks)
+        for (const auto &[chunkPtr, chunk] : chunks)
             if (chunk.state == memory::states::Heap)
                 size += chunk.size;
         return size + code.size + state.process->mainThreadStack->size;
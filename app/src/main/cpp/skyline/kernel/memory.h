@@ -3,8 +3,9 @@
 
 #pragma once
 
-#include <common.h>
+#include <map>
 #include <sys/mman.h>
+#include <common.h>
 
 namespace skyline {
     namespace memory {
@@ -215,7 +216,19 @@ namespace skyline {
         class MemoryManager {
           private:
             const DeviceState &state;
-            std::vector<ChunkDescriptor> chunks;
+            int memoryFd{-1}; //!< A memfd which backs the entirety of the guest address space at offsets relative to its base, this allows the same pages to be mapped at multiple guest addresses
+            std::map<u8 *, ChunkDescriptor> chunks; //!< All chunks keyed by their base address, these cover the entire address space without any gaps or overlaps
+
+            using ChunkSnapshot = std::vector<ChunkDescriptor>;
+            std::shared_ptr<const ChunkSnapshot> snapshot; //!< An immutable sorted copy of the chunks which is used by Get without taking the lock, this must only be accessed atomically and is nullptr if the chunks have been mutated since it was taken
+            std::atomic<u32> snapshotMisses{}; //!< The amount of calls to Get since the last mutation which couldn't use the snapshot
+            static constexpr u32 SnapshotRebuildThreshold{32}; //!< The amount of calls to Get without mutations in between after which a new snapshot is taken, this amortizes the cost of copying all chunks
+
+            /**
+             * @brief Moves the start of the supplied chunk to a new address while retaining its end
+             * @return An iterator to the moved chunk
+             */
+            std::map<u8 *, ChunkDescriptor>::iterator MoveChunkStart(std::map<u8 *, ChunkDescriptor>::iterator chunk, u8 *ptr);
 
           public:
             memory::Region addressSpace{}; //!< The entire address space
@@ -239,10 +252,49 @@ namespace skyline {
 
             void InitializeRegions(u8 *codeStart, u64 size);
 
+            /**
+             * @brief Maps the pages backing the source range at the destination as well, so that accesses through either range are coherent without any copies
+             * @param permission The permission of the source range, the destination is mapped with it so the alias can't be used to write to or execute memory which the guest can't otherwise
+             */
+            void MapAlias(u8 *destination, u8 *source, size_t size, memory::Permission permission);
+
+            /**
+             * @brief Maps the range back onto its own pages in the backing after it was aliased or had foreign memory mapped into it, these pages are zeroed and released to the host
+             */
+            void RestoreBacking(u8 *ptr, size_t size, int protection = PROT_NONE);
+
+            /**
+             * @brief Releases the pages backing a range of guest memory to the host, they'll be zero-filled on their next access
+             * @note This doesn't change the mapping or the protection of the range, a failure is only logged as the range remains usable
+             */
+            void FreeBacking(u8 *ptr, size_t size);
+
+            int GetBackingFd() {
+                return memoryFd;
+            }
+
+            /**
+             * @return The offset of the pages backing the supplied guest address in the memfd backing the guest address space
+             */
+            off_t GetBackingOffset(u8 *ptr);
+
+            /**
+             * @brief Inserts a chunk into the map, splitting or replacing any chunks it overlaps and coalescing it with any compatible adjacent chunks
+             * @note This is O(log n) in the amount of chunks in addition to the amount of chunks that are entirely replaced by it
+             */
             void InsertChunk(const ChunkDescriptor &chunk);
 
+            /**
+             * @note This doesn't lock the VMM when an up-to-date snapshot of the chunks is available
+             */
             std::optional<ChunkDescriptor> Get(void *ptr);
 
+            /**
+             * @brief Pre-faults the supplied range of host memory for writing, so that it doesn't need to be faulted in one page at a time on its first access
+             * @note This uses MADV_POPULATE_WRITE when it's supported by the host kernel and falls back to touching every page otherwise, the contents of the memory are retained
+             */
+            static void Populate(span<u8> range);
+
             /**
              * @return The cumulative size of all heap (Physical Memory + Process Heap) memory mappings, the code region and the main thread stack in bytes
              */
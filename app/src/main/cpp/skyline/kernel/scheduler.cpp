@@ -1,16 +1,202 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <bit>
 #include <unistd.h>
 #include <common/signal.h>
+#include <common/settings.h>
 #include <common/trace.h>
 #include "types/KThread.h"
 #include "scheduler.h"
 
 namespace skyline::kernel {
+    void RunQueue::PushLevelBack(type::KThread *thread) {
+        auto &node{thread->runQueueNode};
+        node.priority = static_cast<u8>(thread->priority.load());
+        node.previous = tails[node.priority];
+        node.next = nullptr;
+        if (node.previous)
+            node.previous->runQueueNode.next = thread;
+        else
+            heads[node.priority] = thread;
+        tails[node.priority] = thread;
+        presentMask.fetch_or(1ULL << node.priority, std::memory_order_relaxed);
+    }
+
+    void RunQueue::PushLevelFront(type::KThread *thread) {
+        auto &node{thread->runQueueNode};
+        node.priority = static_cast<u8>(thread->priority.load());
+        node.previous = nullptr;
+        node.next = heads[node.priority];
+        if (node.next)
+            node.next->runQueueNode.previous = thread;
+        else
+            tails[node.priority] = thread;
+        heads[node.priority] = thread;
+        presentMask.fetch_or(1ULL << node.priority, std::memory_order_relaxed);
+    }
+
+    void RunQueue::Unlink(type::KThread *thread) {
+        auto &node{thread->runQueueNode};
+        if (node.previous)
+            node.previous->runQueueNode.next = node.next;
+        else
+            heads[node.priority] = node.next;
+
+        if (node.next)
+            node.next->runQueueNode.previous = node.previous;
+        else
+            tails[node.priority] = node.previous;
+
+        if (!heads[node.priority])
+            presentMask.fetch_and(~(1ULL << node.priority), std::memory_order_relaxed);
+
+        node.previous = node.next = nullptr;
+    }
+
+    void RunQueue::PopFront() {
+        auto next{GetNext()};
+        if (next)
+            Unlink(next);
+        front.store(next, std::memory_order_release);
+    }
+
+    bool RunQueue::Contains(const type::KThread *thread) const {
+        return thread->runQueueNode.queue == this;
+    }
+
+    type::KThread *RunQueue::GetNext() const {
+        u64 mask{presentMask.load(std::memory_order_relaxed)};
+        return mask ? heads[static_cast<size_t>(std::countr_zero(mask))] : nullptr;
+    }
+
+    void RunQueue::Insert(type::KThread *thread) {
+        thread->runQueueNode.queue = this;
+        if (!GetFront())
+            front.store(thread, std::memory_order_release);
+        else
+            PushLevelBack(thread);
+    }
+
+    void RunQueue::InsertNext(type::KThread *thread) {
+        thread->runQueueNode.queue = this;
+        if (!GetFront())
+            front.store(thread, std::memory_order_release);
+        else
+            PushLevelFront(thread);
+    }
+
+    void RunQueue::PushFront(type::KThread *thread) {
+        thread->runQueueNode.queue = this;
+        if (auto previousFront{GetFront()})
+            PushLevelBack(previousFront);
+        front.store(thread, std::memory_order_release);
+    }
+
+    void RunQueue::Rotate() {
+        auto previousFront{GetFront()};
+        if (!previousFront)
+            return;
+        PushLevelBack(previousFront);
+        PopFront();
+    }
+
+    void RunQueue::Remove(type::KThread *thread) {
+        if (GetFront() == thread)
+            PopFront();
+        else
+            Unlink(thread);
+        thread->runQueueNode.queue = nullptr;
+    }
+
     Scheduler::CoreContext::CoreContext(u8 id, i8 preemptionPriority) : id(id), preemptionPriority(preemptionPriority) {}
 
-    Scheduler::Scheduler(const DeviceState &state) : state(state) {}
+    Scheduler::Scheduler(const DeviceState &state) : state(state), workStealing(state.settings->workStealing) {
+        // Spinning threads would compete with the threads they're waiting on if the host can't run every guest core concurrently alongside them
+        if (state.settings->threadHandoffSpinning && std::thread::hardware_concurrency() > constant::CoreCount) {
+            u64 frequency;
+            asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+            handoffSpinTicks = (frequency * static_cast<u64>(HandoffSpinDuration.count())) / 1'000'000;
+        }
+    }
+
+    Scheduler::CoreStatistics Scheduler::GetCoreStatistics(u8 coreId) {
+        auto &core{cores.at(coreId)};
+        return {
+            .busyTicks = core.busyTicks.load(std::memory_order_relaxed),
+            .stolenThreads = core.stolenThreads.load(std::memory_order_relaxed),
+        };
+    }
+
+    /**
+     * @brief The names of the Perfetto counter tracks for the statistics of each core
+     */
+    struct CoreTrackNames {
+        const char *busyTicks;
+        const char *stolenThreads;
+    };
+
+    constexpr std::array<CoreTrackNames, constant::CoreCount> CoreTracks{{
+        {"C0 Busy Ticks", "C0 Stolen Threads"},
+        {"C1 Busy Ticks", "C1 Stolen Threads"},
+        {"C2 Busy Ticks", "C2 Stolen Threads"},
+        {"C3 Busy Ticks", "C3 Stolen Threads"},
+    }};
+
+    bool Scheduler::NeedsPreemption(const type::KThread &thread, const CoreContext &core) {
+        i8 priority{thread.priority};
+        return priority == core.preemptionPriority && (core.queue.GetPresentMask() & (1ULL << priority));
+    }
+
+    void Scheduler::EndTimeslice(type::KThread &thread, CoreContext &core) {
+        auto now{util::GetTimeTicks()};
+        thread.averageTimeslice = (thread.averageTimeslice / 4) + (3 * (now - thread.timesliceStart / 4));
+
+        if (thread.timesliceStart) {
+            u64 ticks{now - thread.timesliceStart};
+            TRACE_COUNTER("scheduler", perfetto::CounterTrack(CoreTracks[core.id].busyTicks), core.busyTicks.fetch_add(ticks, std::memory_order_relaxed) + ticks);
+        }
+    }
+
+    void Scheduler::StealThread(CoreContext &idleCore) {
+        for (auto &victimCore : cores) {
+            if (!idleCore.queue.Empty())
+                return; // Another thread has been scheduled on the core in the meantime, it isn't idle anymore
+
+            if (&victimCore == &idleCore || !victimCore.queue.GetPresentMask())
+                continue; // We can skip any cores with no ready threads without locking them
+
+            std::unique_lock victimLock(victimCore.mutex);
+            u64 levels{victimCore.queue.GetPresentMask()};
+            while (levels) {
+                auto priority{static_cast<u8>(std::countr_zero(levels))};
+                levels &= levels - 1;
+                for (auto thread{victimCore.queue.GetLevelHead(priority)}; thread; thread = thread->runQueueNode.next) {
+                    // The core migration mutex must be locked prior to the core mutex, we can only try to lock it here to avoid deadlocks
+                    if (!thread->affinityMask.test(idleCore.id) || !thread->coreMigrationMutex.try_lock())
+                        continue;
+                    std::lock_guard migrationLock(thread->coreMigrationMutex, std::adopt_lock);
+
+                    // The thread will notice its resident core changing when it's woken up in WaitSchedule/TimedWaitSchedule
+                    victimCore.queue.Remove(thread);
+                    thread->coreId = idleCore.id;
+                    victimLock.unlock();
+
+                    Logger::Debug("Work Stealing T{}: C{} -> C{}", thread->id, victimCore.id, idleCore.id);
+                    TRACE_COUNTER("scheduler", perfetto::CounterTrack(CoreTracks[idleCore.id].stolenThreads), idleCore.stolenThreads.fetch_add(1, std::memory_order_relaxed) + 1);
+                    InsertThread(thread->shared_from_this());
+                    return;
+                }
+            }
+        }
+    }
+
+    void Scheduler::SpinForSchedule(const type::KThread &thread, const CoreContext &core) {
+        TRACE_EVENT("scheduler", "SpinForSchedule");
+        auto deadline{util::GetTimeTicks() + handoffSpinTicks};
+        while (core.queue.GetFront() != &thread && thread.coreId == core.id && util::GetTimeTicks() < deadline)
+            asm volatile("YIELD");
+    }
 
     void Scheduler::SignalHandler(int signal, siginfo *info, ucontext *ctx, void **tls) {
         if (*tls) {
@@ -30,7 +216,7 @@ namespace skyline::kernel {
     Scheduler::CoreContext &Scheduler::GetOptimalCoreForThread(const std::shared_ptr<type::KThread> &thread) {
         auto *currentCore{&cores.at(thread->coreId)};
 
-        if (!currentCore->queue.empty() && thread->affinityMask.count() != 1) {
+        if (!currentCore->queue.Empty() && thread->affinityMask.count() != 1) {
             // Select core where the current thread will be scheduled the earliest based off average timeslice durations for resident threads
             // There's a preference for the current core as migration isn't free
             size_t minTimeslice{};
@@ -39,12 +225,10 @@ namespace skyline::kernel {
                 if (thread->affinityMask.test(candidateCore.id)) {
                     u64 timeslice{};
 
-                    if (!candidateCore.queue.empty()) {
+                    if (!candidateCore.queue.Empty()) {
                         std::lock_guard coreLock(candidateCore.mutex);
 
-                        auto threadIterator{candidateCore.queue.cbegin()};
-                        if (threadIterator != candidateCore.queue.cend()) {
-                            const auto &runningThread{*threadIterator};
+                        if (auto runningThread{candidateCore.queue.GetFront()}) {
                             timeslice += [&]() {
                                 if (runningThread->averageTimeslice)
                                     return std::min(runningThread->averageTimeslice - (util::GetTimeTicks() - runningThread->timesliceStart), 1UL);
@@ -54,9 +238,12 @@ namespace skyline::kernel {
                                     return 1UL;
                             }();
 
-                            while (++threadIterator != candidateCore.queue.cend()) {
-                                const auto &residentThread{*threadIterator};
-                                if (residentThread->priority <= thread->priority)
+                            // Only the priority levels which are equal to or higher than the thread's priority are relevant
+                            u64 levels{candidateCore.queue.GetPresentMask() & (std::numeric_limits<u64>::max() >> ((RunQueue::PriorityLevelCount - 1) - thread->priority))};
+                            while (levels) {
+                                auto priority{static_cast<u8>(std::countr_zero(levels))};
+                                levels &= levels - 1;
+                                for (auto residentThread{candidateCore.queue.GetLevelHead(priority)}; residentThread; residentThread = residentThread->runQueueNode.next)
                                     timeslice += residentThread->averageTimeslice ? residentThread->averageTimeslice : 1UL;
                             }
                         }
@@ -82,21 +269,43 @@ namespace skyline::kernel {
         return *currentCore;
     }
 
+    bool Scheduler::IsScheduled(const type::KThread &thread) {
+        auto coreId{thread.coreId};
+        return coreId < constant::CoreCount && cores[coreId].queue.GetFront() == &thread;
+    }
+
     void Scheduler::InsertThread(const std::shared_ptr<type::KThread> &thread) {
         auto &core{cores.at(thread->coreId)};
         std::unique_lock lock(core.mutex);
-        auto nextThread{std::upper_bound(core.queue.begin(), core.queue.end(), thread->priority.load(), type::KThread::IsHigherPriority)};
-        if (nextThread == core.queue.begin()) {
-            if (nextThread != core.queue.end()) {
+        InsertThreadLocked(thread, core);
+    }
+
+    void Scheduler::InsertThreads(span<std::shared_ptr<type::KThread>> threads) {
+        // Threads are inserted in order of priority with each core locked once, only the highest priority thread on a core can displace its front this way
+        // Inserting them in arbitrary order could result in a thread becoming the front and being woken only to be immediately displaced and sent a yield signal by the next thread
+        std::stable_sort(threads.begin(), threads.end(), [](const std::shared_ptr<type::KThread> &lhs, const std::shared_ptr<type::KThread> &rhs) {
+            return lhs->coreId != rhs->coreId ? lhs->coreId < rhs->coreId : lhs->priority < rhs->priority;
+        });
+
+        for (auto it{threads.begin()}; it != threads.end();) {
+            auto &core{cores.at((*it)->coreId)};
+            std::unique_lock lock(core.mutex);
+            for (; it != threads.end() && (*it)->coreId == core.id; it++)
+                InsertThreadLocked(*it, core);
+        }
+    }
+
+    void Scheduler::InsertThreadLocked(const std::shared_ptr<type::KThread> &thread, CoreContext &core) {
+        auto front{core.queue.GetFront()};
+        if (!front || thread->priority < front->priority) {
+            if (front) {
                 // If the inserted thread has a higher priority than the currently running thread (and the queue isn't empty)
                 // We can yield the thread which is currently scheduled on the core by sending it a signal
                 // It is optimized to avoid waiting for the thread to yield on receiving the signal which serializes the entire pipeline
-                auto front{core.queue.front()};
                 front->forceYield = true;
-                core.queue.splice(std::upper_bound(core.queue.begin(), core.queue.end(), front->priority.load(), type::KThread::IsHigherPriority), core.queue, core.queue.begin());
-                core.queue.push_front(thread);
+                core.queue.PushFront(thread.get());
 
-                if (state.thread != front) {
+                if (state.thread.get() != front) {
                     // If the calling thread isn't at the front, we need to send it an OS signal to yield
                     if (!front->pendingYield) {
                         // We only want to yield the thread if it hasn't already been sent a signal to yield in the past
@@ -110,24 +319,28 @@ namespace skyline::kernel {
                     YieldPending = true;
                 }
             } else {
-                core.queue.push_front(thread);
+                core.queue.Insert(thread.get());
             }
             if (thread != state.thread)
                 thread->scheduleCondition.notify_one(); // We only want to trigger the conditional variable if the current thread isn't inserting itself
         } else {
-            core.queue.insert(nextThread, thread);
+            core.queue.Insert(thread.get());
+
+            // The running thread only has its preemption timer armed while another thread of its priority is ready, this may be the first such thread
+            if (!front->isPreempted && NeedsPreemption(*front, core))
+                front->ArmPreemptionTimer(PreemptiveTimeslice);
         }
     }
 
     void Scheduler::MigrateToCore(const std::shared_ptr<type::KThread> &thread, CoreContext *&currentCore, CoreContext *targetCore, std::unique_lock<std::mutex> &lock) {
         // We need to check if the thread was in its resident core's queue
         // If it was, we need to remove it from the queue
-        auto it{std::find(currentCore->queue.begin(), currentCore->queue.end(), thread)};
-        bool wasInserted{it != currentCore->queue.end()};
+        bool wasInserted{currentCore->queue.Contains(thread.get())};
         if (wasInserted) {
-            it = currentCore->queue.erase(it);
-            if (it == currentCore->queue.begin() && it != currentCore->queue.end())
-                (*it)->scheduleCondition.notify_one();
+            bool wasFront{currentCore->queue.GetFront() == thread.get()};
+            currentCore->queue.Remove(thread.get());
+            if (auto front{currentCore->queue.GetFront()}; wasFront && front)
+                front->scheduleCondition.notify_one();
         }
         lock.unlock();
 
@@ -146,6 +359,13 @@ namespace skyline::kernel {
         std::unique_lock lock(core->mutex);
 
         auto wakeFunction{[&]() {
+            if (thread->coreId != core->id) [[unlikely]] {
+                // The thread has been stolen by another core while waiting, we need to follow it to its new resident core
+                lock.unlock();
+                core = &cores.at(thread->coreId);
+                lock = std::unique_lock(core->mutex);
+            }
+
             if (!thread->affinityMask.test(thread->coreId)) [[unlikely]] {
                 lock.unlock(); // If the core migration mutex is locked by a thread seeking the core mutex, it'll result in a deadlock
                 std::lock_guard migrationLock(thread->coreMigrationMutex);
@@ -153,10 +373,16 @@ namespace skyline::kernel {
                 if (!thread->affinityMask.test(thread->coreId)) // We need to retest in case the thread was migrated while the core was unlocked
                     MigrateToCore(thread, core, &cores.at(thread->idealCore), lock);
             }
-            return !core->queue.empty() && core->queue.front() == thread;
+            return core->queue.GetFront() == thread.get();
         }};
 
         TRACE_EVENT("scheduler", "WaitSchedule");
+        if (handoffSpinTicks && !wakeFunction()) {
+            lock.unlock();
+            SpinForSchedule(*thread, *core);
+            lock.lock();
+        }
+
         if (loadBalance && thread->affinityMask.count() > 1) {
             std::chrono::milliseconds loadBalanceThreshold{PreemptiveTimeslice * 2}; //!< The amount of time that needs to pass unscheduled for a thread to attempt load balancing
             while (!thread->scheduleCondition.wait_for(lock, loadBalanceThreshold, wakeFunction)) {
@@ -173,7 +399,7 @@ namespace skyline::kernel {
             thread->scheduleCondition.wait(lock, wakeFunction);
         }
 
-        if (thread->priority == core->preemptionPriority)
+        if (NeedsPreemption(*thread, *core))
             // If the thread needs to be preempted then arm its preemption timer
             thread->ArmPreemptionTimer(PreemptiveTimeslice);
 
@@ -185,23 +411,55 @@ namespace skyline::kernel {
         auto *core{&cores.at(thread->coreId)};
 
         TRACE_EVENT("scheduler", "TimedWaitSchedule");
-        std::unique_lock lock(core->mutex);
-        if (thread->scheduleCondition.wait_for(lock, timeout, [&]() {
-            if (!thread->affinityMask.test(thread->coreId)) [[unlikely]] {
-                std::lock_guard migrationLock(thread->coreMigrationMutex);
-                MigrateToCore(thread, core, &cores.at(thread->idealCore), lock);
+
+        bool timedOut{}; // This is only accessed with the mutex of the thread's resident core held
+        TimerWheel::Timer timer{.callback = [this, waiter = thread.get(), &timedOut]() {
+            // The resident core can change while we're acquiring its mutex, the waiter only rechecks its predicate with the mutex of its current resident core held
+            while (true) {
+                auto &waiterCore{cores.at(waiter->coreId)};
+                std::lock_guard lock(waiterCore.mutex);
+                if (waiter->coreId == waiterCore.id) {
+                    timedOut = true;
+                    waiter->scheduleCondition.notify_one();
+                    return;
+                }
             }
-            return !core->queue.empty() && core->queue.front() == thread;
-        })) {
-            if (thread->priority == core->preemptionPriority)
-                thread->ArmPreemptionTimer(PreemptiveTimeslice);
+        }};
 
-            thread->timesliceStart = util::GetTimeTicks();
+        bool scheduled;
+        try {
+            timerWheel.Add(timer, timeout);
 
-            return true;
-        } else {
-            return false;
+            std::unique_lock lock(core->mutex);
+            thread->scheduleCondition.wait(lock, [&]() {
+                if (thread->coreId != core->id) [[unlikely]] {
+                    lock.unlock();
+                    core = &cores.at(thread->coreId);
+                    lock = std::unique_lock(core->mutex);
+                }
+
+                if (!thread->affinityMask.test(thread->coreId)) [[unlikely]] {
+                    std::lock_guard migrationLock(thread->coreMigrationMutex);
+                    MigrateToCore(thread, core, &cores.at(thread->idealCore), lock);
+                }
+                return core->queue.GetFront() == thread.get() || timedOut;
+            });
+
+            scheduled = core->queue.GetFront() == thread.get();
+            if (scheduled) {
+                if (NeedsPreemption(*thread, *core))
+                    thread->ArmPreemptionTimer(PreemptiveTimeslice);
+
+                thread->timesliceStart = util::GetTimeTicks();
+            }
+        } catch (...) {
+            timerWheel.Cancel(timer);
+            throw;
         }
+
+        // The core mutex must not be held while cancelling as the timer callback acquires it with the wheel's mutex held
+        timerWheel.Cancel(timer);
+        return scheduled;
     }
 
     void Scheduler::Rotate(bool cooperative) {
@@ -210,45 +468,77 @@ namespace skyline::kernel {
 
         std::unique_lock lock(core.mutex);
 
-        if (core.queue.front() == thread) {
+        if (!cooperative && core.queue.GetFront() == thread.get() && !(core.queue.GetPresentMask() & ((2ULL << thread->priority) - 1))) {
+            // A preemptive yield can't change which thread runs if no thread of the same or a higher priority is ready, the thread continues its timeslice
+            thread->pendingYield = false;
+            return;
+        }
+
+        if (core.queue.GetFront() == thread.get()) {
             // If this thread is at the front of the thread queue then we need to rotate the thread
             // In the case where this thread was forcefully yielded, we don't need to do this as it's done by the thread which yielded to this thread
-            // Splice the linked element from the beginning of the queue to where its priority is present
-            core.queue.splice(std::upper_bound(core.queue.begin(), core.queue.end(), thread->priority.load(), type::KThread::IsHigherPriority), core.queue, core.queue.begin());
+            // The thread is moved to the back of its priority level and the first thread of the highest priority level becomes the front
+            core.queue.Rotate();
 
-            auto &front{core.queue.front()};
-            if (front != thread)
+            auto front{core.queue.GetFront()};
+            if (front != thread.get())
                 front->scheduleCondition.notify_one(); // If we aren't at the front of the queue, only then should we wake the thread at the front up
         } else if (!thread->forceYield) {
             throw exception("T{} called Rotate while not being in C{}'s queue", thread->id, thread->coreId);
         }
 
-        thread->averageTimeslice = (thread->averageTimeslice / 4) + (3 * (util::GetTimeTicks() - thread->timesliceStart / 4));
+        EndTimeslice(*thread, core);
 
         thread->DisarmPreemptionTimer(); // If a preemptive thread did a cooperative yield then we need to disarm the preemptive timer
         thread->pendingYield = false;
         thread->forceYield = false;
     }
 
+    bool Scheduler::CanSkipYield(YieldType type) {
+        auto &thread{state.thread};
+        auto &core{cores.at(thread->coreId)};
+        if (core.queue.GetFront() != thread.get())
+            return false;
+
+        // The present mask excludes the front of the queue which is the calling thread, it only contains the levels of other ready threads
+        auto presentMask{core.queue.GetPresentMask()};
+        switch (type) {
+            case YieldType::WithoutCoreMigration:
+                return !(presentMask & ((2ULL << thread->priority) - 1));
+
+            case YieldType::WithCoreMigration:
+                return !(presentMask & ((2ULL << thread->priority) - 1)) && parkedQueue.Empty();
+
+            case YieldType::ToAnyThread:
+                return !presentMask && parkedQueue.Empty();
+        }
+    }
+
     void Scheduler::RemoveThread() {
         auto &thread{state.thread};
         auto &core{cores.at(thread->coreId)};
+        bool isIdle{};
         {
             std::unique_lock lock(core.mutex);
-            auto it{std::find(core.queue.begin(), core.queue.end(), thread)};
-            if (it != core.queue.end()) {
-                it = core.queue.erase(it);
-                if (it == core.queue.begin()) {
+            if (core.queue.Contains(thread.get())) {
+                bool wasFront{core.queue.GetFront() == thread.get()};
+                core.queue.Remove(thread.get());
+                if (wasFront) {
                     // We need to update the averageTimeslice accordingly, if we've been unscheduled by this
                     if (thread->timesliceStart)
-                        thread->averageTimeslice = (thread->averageTimeslice / 4) + (3 * (util::GetTimeTicks() - thread->timesliceStart / 4));
+                        EndTimeslice(*thread, core);
 
-                    if (it != core.queue.end())
-                        (*it)->scheduleCondition.notify_one(); // We need to wake the thread at the front of the queue, if we were at the front previously
+                    if (auto front{core.queue.GetFront()})
+                        front->scheduleCondition.notify_one(); // We need to wake the thread at the front of the queue, if we were at the front previously
+                    else
+                        isIdle = true;
                 }
             }
         }
 
+        if (isIdle && workStealing)
+            StealThread(core);
+
         thread->DisarmPreemptionTimer();
         thread->pendingYield = false;
         thread->forceYield = false;
@@ -260,37 +550,37 @@ namespace skyline::kernel {
         auto *core{&cores.at(thread->coreId)};
         std::unique_lock coreLock(core->mutex);
 
-        auto currentIt{std::find(core->queue.begin(), core->queue.end(), thread)}, nextIt{std::next(currentIt)};
-        if (currentIt == core->queue.end()) {
+        auto front{core->queue.GetFront()};
+        if (!core->queue.Contains(thread.get())) {
             return;
-        } else if (currentIt == core->queue.begin()) {
+        } else if (front == thread.get()) {
             // Alternatively, if it's currently running then we'd just want to yield if there's a higher priority thread to run instead
-            if (nextIt != core->queue.end() && (*nextIt)->priority < thread->priority) {
+            auto next{core->queue.GetNext()};
+            if (next && next->priority < thread->priority) {
                 if (!thread->pendingYield) {
                     thread->SendSignal(YieldSignal);
                     thread->pendingYield = true;
                 }
-            } else if (!thread->isPreempted && thread->priority == core->preemptionPriority) {
+            } else if (!thread->isPreempted && NeedsPreemption(*thread, *core)) {
                 // If the thread needs to be preempted due to its new priority then arm its preemption timer
                 thread->ArmPreemptionTimer(PreemptiveTimeslice);
-            } else if (thread->isPreempted && thread->priority != core->preemptionPriority) {
+            } else if (thread->isPreempted && !NeedsPreemption(*thread, *core)) {
                 // If the thread no longer needs to be preempted due to its new priority then disarm its preemption timer
                 thread->DisarmPreemptionTimer();
             }
-        } else if (thread->priority < (*std::prev(currentIt))->priority || (nextIt != core->queue.end() && thread->priority > (*nextIt)->priority)) {
-            // If the thread is in the queue and it's position is affected by the priority change then need to remove and re-insert the thread
-            core->queue.erase(currentIt);
-
-            auto targetIt{std::upper_bound(core->queue.begin(), core->queue.end(), thread->priority.load(), type::KThread::IsHigherPriority)};
-            if (targetIt == core->queue.begin() && targetIt != core->queue.end()) {
-                core->queue.insert(std::next(core->queue.begin()), thread);
-                auto front{core->queue.front()};
+        } else if (thread->runQueueNode.priority != thread->priority) {
+            // If the thread is in the queue and its priority level has changed then we need to remove and re-insert the thread
+            core->queue.Remove(thread.get());
+
+            if (thread->priority < front->priority) {
+                // If the thread has a higher priority than the running thread then it should be scheduled next and the running thread should yield to it
+                core->queue.InsertNext(thread.get());
                 if (!front->pendingYield) {
                     front->SendSignal(YieldSignal);
                     front->pendingYield = true;
                 }
             } else {
-                core->queue.insert(targetIt, thread);
+                core->queue.Insert(thread.get());
             }
         }
     }
@@ -298,7 +588,7 @@ namespace skyline::kernel {
     void Scheduler::UpdateCore(const std::shared_ptr<type::KThread> &thread) {
         auto *core{&cores.at(thread->coreId)};
         std::lock_guard coreLock(core->mutex);
-        if (core->queue.front() == thread)
+        if (core->queue.GetFront() == thread.get())
             thread->SendSignal(YieldSignal);
         else
             thread->scheduleCondition.notify_one();
@@ -311,28 +601,37 @@ namespace skyline::kernel {
 
         auto originalCoreId{thread->coreId};
         thread->coreId = constant::ParkedCoreId;
-        for (auto &core : cores)
-            if (originalCoreId != core.id && thread->affinityMask.test(core.id) && (core.queue.empty() || core.queue.front()->priority > thread->priority))
+        for (auto &core : cores) {
+            auto front{core.queue.GetFront()}; // This is a lock-free peek at the front of the queue, it may be stale but that only affects the choice of core
+            if (originalCoreId != core.id && thread->affinityMask.test(core.id) && (!front || front->priority > thread->priority))
                 thread->coreId = core.id;
+        }
 
         if (thread->coreId == constant::ParkedCoreId) {
             std::unique_lock lock(parkedMutex);
-            parkedQueue.insert(std::upper_bound(parkedQueue.begin(), parkedQueue.end(), thread->priority.load(), type::KThread::IsHigherPriority), thread);
-            thread->scheduleCondition.wait(lock, [&]() { return parkedQueue.front() == thread && thread->coreId != constant::ParkedCoreId; });
+            auto parkedFront{parkedQueue.GetFront()};
+            if (parkedFront && thread->priority < parkedFront->priority)
+                parkedQueue.PushFront(thread.get());
+            else
+                parkedQueue.Insert(thread.get());
+            thread->scheduleCondition.wait(lock, [&]() { return parkedQueue.GetFront() == thread.get() && thread->coreId != constant::ParkedCoreId; });
+            parkedQueue.Remove(thread.get());
         }
 
         InsertThread(thread);
     }
 
     void Scheduler::WakeParkedThread() {
+        if (parkedQueue.Empty()) // This is a lock-free peek to avoid contending on the mutex in the common case of no parked threads, a thread parked concurrently is woken by a later yield
+            return;
+
         std::unique_lock parkedLock(parkedMutex);
-        if (!parkedQueue.empty()) {
+        if (auto parkedThread{parkedQueue.GetFront()}) {
             auto &thread{state.thread};
             auto &core{cores.at(thread->coreId)};
             std::unique_lock coreLock(core.mutex);
-            auto nextThread{core.queue.size() > 1 ? *std::next(core.queue.begin()) : nullptr};
-            nextThread = nextThread->priority == thread->priority ? nextThread : nullptr; // If the next thread doesn't have the same priority then it won't be scheduled next
-            auto parkedThread{parkedQueue.front()};
+            auto nextThread{core.queue.GetNext()};
+            nextThread = (nextThread && nextThread->priority == thread->priority) ? nextThread : nullptr; // If the next thread doesn't have the same priority then it won't be scheduled next
 
             // We need to be conservative about waking up a parked thread, it should only be done if its priority is higher than the current thread
             // Alternatively, it should be done if its priority is equivalent to the current thread's priority but the next thread had been scheduled prior or if there is no next thread (Current thread would be rescheduled)
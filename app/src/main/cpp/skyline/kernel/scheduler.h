@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <condition_variable>
+#include "timer_wheel.h"
 
 namespace skyline {
     namespace constant {
@@ -35,6 +36,102 @@ namespace skyline {
             }
         };
 
+        /**
+         * @brief An intrusive run queue with a FIFO list of threads for each of the 64 priority levels alongside a bitmask of non-empty levels, similar to the one used by HOS
+         * @note The front of the queue is the thread which is currently scheduled, it's held separately from the priority levels as it isn't necessarily the highest priority thread in the queue till it yields
+         * @note All mutations must be externally synchronized, only GetFront, Empty and GetPresentMask can be used without synchronization
+         */
+        class RunQueue {
+          public:
+            static constexpr u8 PriorityLevelCount{64};
+
+            /**
+             * @brief The intrusive state of a thread which is inserted into a run queue, this must only be accessed with the queue's synchronization held
+             */
+            struct Node {
+                type::KThread *previous{}; //!< The previous thread in the same priority level
+                type::KThread *next{}; //!< The next thread in the same priority level
+                RunQueue *queue{}; //!< The queue which the thread is inserted into, this is nullptr if it isn't inserted into any queue
+                u8 priority{}; //!< The priority level that the thread was inserted into, this may differ from the thread's current priority
+            };
+
+          private:
+            std::atomic<type::KThread *> front{}; //!< The thread at the front of the queue, this isn't a part of any priority level
+            std::atomic<u64> presentMask{}; //!< A bitmask of priority levels which contain at least one thread
+            std::array<type::KThread *, PriorityLevelCount> heads{}; //!< The first thread in each priority level
+            std::array<type::KThread *, PriorityLevelCount> tails{}; //!< The last thread in each priority level
+
+            void PushLevelBack(type::KThread *thread);
+
+            void PushLevelFront(type::KThread *thread);
+
+            void Unlink(type::KThread *thread);
+
+            /**
+             * @brief Removes the first thread of the highest priority level and makes it the front of the queue, the front will be nullptr if the queue has no other threads
+             */
+            void PopFront();
+
+          public:
+            type::KThread *GetFront() const {
+                return front.load(std::memory_order_acquire);
+            }
+
+            bool Empty() const {
+                return !GetFront();
+            }
+
+            /**
+             * @return If the supplied thread is inserted into this queue
+             */
+            bool Contains(const type::KThread *thread) const;
+
+            /**
+             * @return The thread that will be scheduled after the front of the queue, this is nullptr if there's no such thread
+             */
+            type::KThread *GetNext() const;
+
+            /**
+             * @return A bitmask of the priority levels which contain at least one thread, this excludes the front of the queue
+             * @note This is only a hint when used without synchronization as it may be stale
+             */
+            u64 GetPresentMask() const {
+                return presentMask.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return The first thread in the supplied priority level, subsequent threads can be iterated on through Node::next
+             */
+            type::KThread *GetLevelHead(u8 priority) const {
+                return heads[priority];
+            }
+
+            /**
+             * @brief Inserts the thread at the back of its priority level or at the front if the queue is empty
+             */
+            void Insert(type::KThread *thread);
+
+            /**
+             * @brief Inserts the thread at the front of its priority level or at the front of the queue if the queue is empty, this makes it the next thread to be scheduled if no threads of a higher priority are queued
+             */
+            void InsertNext(type::KThread *thread);
+
+            /**
+             * @brief Makes the thread the front of the queue, the previous front is moved to the back of its priority level
+             */
+            void PushFront(type::KThread *thread);
+
+            /**
+             * @brief Moves the front of the queue to the back of its priority level and makes the next thread the front
+             */
+            void Rotate();
+
+            /**
+             * @brief Removes the thread from the queue, if it was at the front then the next thread becomes the front
+             */
+            void Remove(type::KThread *thread);
+        };
+
         /**
          * @brief The Scheduler is responsible for determining which threads should run on which virtual cores and when they should be scheduled
          * @note We tend to stray a lot from HOS in our scheduler design as we've designed it around our 1 host thread per guest thread which leads to scheduling from the perspective of threads while the HOS scheduler deals with scheduling from the perspective of cores, not doing this would lead to missing out on key optimizations and serialization of scheduling
@@ -47,15 +144,21 @@ namespace skyline {
                 u8 id;
                 i8 preemptionPriority; //!< The priority at which this core becomes preemptive as opposed to cooperative
                 std::mutex mutex; //!< Synchronizes all operations on the queue
-                std::list<std::shared_ptr<type::KThread>> queue; //!< A queue of threads which are running or to be run on this core
+                RunQueue queue; //!< A queue of threads which are running or to be run on this core
+                std::atomic<u64> busyTicks{}; //!< The total amount of host counter ticks that threads have spent scheduled on this core
+                std::atomic<u64> stolenThreads{}; //!< The total amount of threads that this core has stolen from other cores while idle
 
                 CoreContext(u8 id, i8 preemptionPriority);
             };
 
             std::array<CoreContext, constant::CoreCount> cores{CoreContext(0, 59), CoreContext(1, 59), CoreContext(2, 59), CoreContext(3, 63)};
 
+            bool workStealing; //!< If idle cores should steal ready threads from other cores, this is the value of Settings::workStealing
+            static constexpr std::chrono::microseconds HandoffSpinDuration{20}; //!< The maximum duration a thread busy-waits for being scheduled before sleeping, this is on the order of a futex wake and host reschedule
+            u64 handoffSpinTicks{}; //!< HandoffSpinDuration in host counter ticks or 0 if threads shouldn't busy-wait, this is determined by Settings::threadHandoffSpinning
+
             std::mutex parkedMutex; //!< Synchronizes all operations on the queue of parked threads
-            std::list<std::shared_ptr<type::KThread>> parkedQueue; //!< A queue of threads which are parked and waiting on core migration
+            RunQueue parkedQueue; //!< A queue of threads which are parked and waiting on core migration
 
             /**
              * @brief Migrate a thread from its resident core to its ideal core
@@ -64,14 +167,59 @@ namespace skyline {
              */
             void MigrateToCore(const std::shared_ptr<type::KThread> &thread, CoreContext *&currentCore, CoreContext *targetCore, std::unique_lock<std::mutex> &lock);
 
+            /**
+             * @brief Inserts a thread into the queue of the supplied core which must be its resident core
+             * @note The mutex of the core **must** be locked by the calling thread
+             */
+            void InsertThreadLocked(const std::shared_ptr<type::KThread> &thread, CoreContext &core);
+
+            /**
+             * @brief Accounts for the end of a thread's timeslice on its resident core
+             */
+            void EndTimeslice(type::KThread &thread, CoreContext &core);
+
+            /**
+             * @return If the supplied thread at the front of the core's queue should have its preemption timer armed, this is only the case when another thread of the same priority is ready as preempting it can't change which thread runs otherwise
+             * @note The core's mutex must be held by the calling thread
+             */
+            static bool NeedsPreemption(const type::KThread &thread, const CoreContext &core);
+
+            /**
+             * @brief Steals the highest priority ready thread that can run on the supplied idle core from another core
+             * @note No core mutexes should be held by the calling thread
+             * @note This is a no-op if the core isn't idle anymore or if there are no threads that can be stolen
+             */
+            void StealThread(CoreContext &idleCore);
+
+            /**
+             * @brief Busy-waits without any locks held for the supplied thread to be at the front of its resident core or for it to be moved to another core, it gives up after HandoffSpinDuration
+             * @note Most context switches are a handoff from the thread running on the core which yields or blocks shortly after waking the next thread, catching it by spinning avoids sleeping on a futex and the host reschedule that follows
+             */
+            void SpinForSchedule(const type::KThread &thread, const CoreContext &core);
+
           public:
             static constexpr std::chrono::milliseconds PreemptiveTimeslice{10}; //!< The duration of time a preemptive thread can run before yielding
             inline static int YieldSignal{SIGRTMIN}; //!< The signal used to cause a non-cooperative yield in running threads
             inline static int PreemptionSignal{SIGRTMIN + 1}; //!< The signal used to cause a preemptive yield in running threads
             inline static thread_local bool YieldPending{}; //!< A flag denoting if a yield is pending on this thread, it's checked prior to entering guest code as signals cannot interrupt host code
 
+            TimerWheel timerWheel; //!< The timer wheel used for all kernel timeouts, this is destroyed prior to the cores as its timers may reference them
+
             Scheduler(const DeviceState &state);
 
+            /**
+             * @brief Statistics on the utilization of a single core
+             */
+            struct CoreStatistics {
+                u64 busyTicks; //!< The total amount of host counter ticks that threads have spent scheduled on the core
+                u64 stolenThreads; //!< The total amount of threads the core has stolen from other cores
+            };
+
+            /**
+             * @return Cumulative utilization statistics for the supplied core
+             */
+            CoreStatistics GetCoreStatistics(u8 coreId);
+
             /**
              * @brief A signal handler designed to cause a non-cooperative yield for preemption and higher priority threads being inserted
              */
@@ -85,11 +233,23 @@ namespace skyline {
              */
             CoreContext &GetOptimalCoreForThread(const std::shared_ptr<type::KThread> &thread);
 
+            /**
+             * @return If the supplied thread is currently scheduled on its resident core
+             * @note This is a lock-free peek at the core's queue, the result may be stale by the time it's used so it should only be used as a hint
+             */
+            bool IsScheduled(const type::KThread &thread);
+
             /**
              * @brief Inserts the specified thread into the scheduler queue at the appropriate location based on its priority
              */
             void InsertThread(const std::shared_ptr<type::KThread> &thread);
 
+            /**
+             * @brief Inserts all the specified threads into their resident core's queues in a single pass, this is used to wake all waiters of a broadcast
+             * @note The supplied threads are reordered by their resident core and priority
+             */
+            void InsertThreads(span<std::shared_ptr<type::KThread>> threads);
+
             /**
              * @brief Wait for the calling thread to be scheduled on its resident core
              * @param loadBalance If the thread is appropriate for load balancing then if to load balance it occassionally or not
@@ -101,6 +261,7 @@ namespace skyline {
              * @brief Wait for the calling thread to be scheduled on its resident core or for the timeout to expire
              * @return If the thread has been scheduled (true) or if the timer expired before it could be (false)
              * @note This will never load balance as it uses the timeout itself as a result this shouldn't be used as a replacement for regular waits
+             * @note The timeout is tracked by the timer wheel rather than a host timeout, it may expire up to a wheel tick late
              */
             bool TimedWaitSchedule(std::chrono::nanoseconds timeout);
 
@@ -110,6 +271,21 @@ namespace skyline {
              */
             void Rotate(bool cooperative = true);
 
+            /**
+             * @brief The variants of yields that a guest thread can perform with svcSleepThread
+             */
+            enum class YieldType {
+                WithoutCoreMigration, //!< The thread is rotated behind the other threads of its priority on its core
+                WithCoreMigration, //!< A parked thread may be woken to run on the core of the thread prior to it being rotated
+                ToAnyThread, //!< The thread is parked and relinquishes its core to threads of any priority
+            };
+
+            /**
+             * @return If a yield by the calling thread can be skipped as it wouldn't change which thread runs on its core, spin-wait loops yield far more often than this isn't the case
+             * @note This is a lock-free peek at the queues, a thread which becomes ready concurrently is scheduled at the next yield or preemption instead
+             */
+            bool CanSkipYield(YieldType type);
+
             /**
              * @brief Removes the calling thread from its resident core queue
              */
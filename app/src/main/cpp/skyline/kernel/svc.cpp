@@ -5,6 +5,7 @@
 #include <nce.h>
 #include <kernel/types/KProcess.h>
 #include <common/trace.h>
+#include <common/settings.h>
 #include <vfs/npdm.h>
 #include "results.h"
 #include "svc.h"
@@ -22,7 +23,10 @@ namespace skyline::kernel::svc {
         }
 
         auto &heap{state.process->heap};
+        auto previousSize{heap->size};
         heap->Resize(size);
+        if (state.settings->prefaultHeap && size > previousSize)
+            MemoryManager::Populate(span(heap->ptr + previousSize, size - previousSize));
 
         state.ctx->gpr.w0 = Result{};
         state.ctx->gpr.x1 = reinterpret_cast<u64>(heap->ptr);
@@ -115,7 +119,7 @@ namespace skyline::kernel::svc {
         }
 
         state.process->NewHandle<type::KPrivateMemory>(destination, size, chunk->permission, memory::states::Stack);
-        std::memcpy(destination, source, size);
+        state.process->memory.MapAlias(destination, source, size, chunk->permission);
 
         auto object{state.process->GetMemoryObject(source)};
         if (!object)
@@ -170,12 +174,12 @@ namespace skyline::kernel::svc {
 
         destObject->item->UpdatePermission(destination, size, sourceChunk->permission);
 
-        std::memcpy(source, destination, size);
-
         auto sourceObject{state.process->GetMemoryObject(source)};
         if (!sourceObject)
             throw exception("svcUnmapMemory: Cannot find source memory object in handle table for address 0x{:X}", source);
 
+        // Any writes through the alias are already visible at the destination, it only needs to be detached from the destination's pages
+        state.process->memory.RestoreBacking(source, size);
         state.process->CloseHandle(sourceObject->handle);
 
         Logger::Debug("Unmapped range 0x{:X} - 0x{:X} to 0x{:X} - 0x{:X} (Size: 0x{:X} bytes)", source, source + size, destination, destination + size, size);
@@ -291,16 +295,14 @@ namespace skyline::kernel::svc {
             Logger::Debug("Sleeping for {}ns", in);
             TRACE_EVENT("kernel", "SleepThread", "duration", in);
 
-            struct timespec spec{
-                .tv_sec = static_cast<time_t>(in / 1000000000),
-                .tv_nsec = static_cast<long>(in % 1000000000),
-            };
-
             SchedulerScopedLock schedulerLock(state);
-            nanosleep(&spec, nullptr);
+            state.scheduler->timerWheel.Sleep(std::chrono::nanoseconds(in));
         } else {
             switch (in) {
                 case yieldWithCoreMigration: {
+                    if (state.scheduler->CanSkipYield(Scheduler::YieldType::WithCoreMigration))
+                        break;
+
                     Logger::Debug("Waking any appropriate parked threads and yielding");
                     TRACE_EVENT("kernel", "YieldWithCoreMigration");
                     state.scheduler->WakeParkedThread();
@@ -310,6 +312,9 @@ namespace skyline::kernel::svc {
                 }
 
                 case yieldWithoutCoreMigration: {
+                    if (state.scheduler->CanSkipYield(Scheduler::YieldType::WithoutCoreMigration))
+                        break;
+
                     Logger::Debug("Cooperative yield");
                     TRACE_EVENT("kernel", "YieldWithoutCoreMigration");
                     state.scheduler->Rotate();
@@ -318,6 +323,9 @@ namespace skyline::kernel::svc {
                 }
 
                 case yieldToAnyThread: {
+                    if (state.scheduler->CanSkipYield(Scheduler::YieldType::ToAnyThread))
+                        break;
+
                     Logger::Debug("Parking current thread");
                     TRACE_EVENT("kernel", "YieldToAnyThread");
                     state.scheduler->ParkThread();
@@ -357,17 +365,17 @@ namespace skyline::kernel::svc {
         try {
             auto thread{state.process->GetHandle<type::KThread>(handle)};
             Logger::Debug("Setting thread #{}'s priority to {}", thread->id, priority);
-            if (thread->priority != priority) {
-                thread->basePriority = priority;
-                i8 newPriority{};
-                do {
-                    // Try to CAS the priority of the thread with its new base priority
-                    // If the new priority is equivalent to the current priority then we don't need to CAS
-                    newPriority = thread->priority.load();
-                    newPriority = std::min(newPriority, priority);
-                } while (newPriority != priority && thread->priority.compare_exchange_strong(newPriority, priority));
-                state.scheduler->UpdatePriority(thread);
-                thread->UpdatePriorityInheritance();
+            if (thread->basePriority.exchange(priority) != priority) {
+                bool changed;
+                {
+                    // The effective priority can't drop below that of any thread waiting on this thread
+                    std::lock_guard lock(thread->waiterMutex);
+                    changed = thread->RecalculatePriority();
+                }
+                if (changed) {
+                    state.scheduler->UpdatePriority(thread);
+                    thread->UpdatePriorityInheritance();
+                }
             }
             state.ctx->gpr.w0 = Result{};
         } catch (const std::out_of_range &) {
@@ -649,9 +657,7 @@ namespace skyline::kernel::svc {
 
         TRACE_EVENT_FMT("kernel", waitHandles.size() == 1 ? "WaitSynchronization 0x{:X}" : "WaitSynchronizationMultiple 0x{:X}", waitHandles[0]);
 
-        std::unique_lock lock(type::KSyncObject::syncObjectMutex);
-        if (state.thread->cancelSync) {
-            state.thread->cancelSync = false;
+        if (state.thread->cancelSync.exchange(false)) {
             state.ctx->gpr.w0 = result::Cancelled;
             return;
         }
@@ -673,65 +679,88 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        auto priority{state.thread->priority.load()};
-        for (const auto &object : objectTable)
-            object->syncObjectWaiters.insert(std::upper_bound(object->syncObjectWaiters.begin(), object->syncObjectWaiters.end(), priority, type::KThread::IsHigherPriority), state.thread);
-
-        state.thread->isCancellable = true;
-        state.thread->wakeObject = nullptr;
+        // The thread is removed from the scheduler prior to arming its wake token as any object can wake it up from the moment it's armed
         state.scheduler->RemoveThread();
+        state.thread->wakeObject = nullptr;
+        state.thread->isCancellable = true;
+
+        // Every object is locked individually while inserting the thread as a waiter, if an object is found to be signalled during this then the thread claims its own wake token
+        // The cancellation flag is rechecked after arming the token as CancelSynchronization might've missed the token being armed
+        bool selfWoken{};
+        size_t insertedCount{};
+        auto priority{state.thread->priority.load()};
+        if (state.thread->cancelSync && state.thread->isCancellable.exchange(false)) {
+            selfWoken = true;
+        } else {
+            for (const auto &object : objectTable) {
+                std::lock_guard lock(object->syncObjectMutex);
+                if (object->signalled) {
+                    if (state.thread->isCancellable.exchange(false)) {
+                        state.thread->wakeObject = object.get();
+                        selfWoken = true;
+                    }
+                    break; // If we failed to claim the token then another object has already woken this thread up
+                }
+                object->syncObjectWaiters.insert(std::upper_bound(object->syncObjectWaiters.begin(), object->syncObjectWaiters.end(), priority, type::KThread::IsHigherPriority), state.thread);
+                insertedCount++;
+            }
+        }
 
-        lock.unlock();
-        if (timeout > 0)
-            state.scheduler->TimedWaitSchedule(std::chrono::nanoseconds(timeout));
-        else
+        if (selfWoken) {
+            state.scheduler->InsertThread(state.thread);
+            state.scheduler->WaitSchedule();
+        } else if (timeout > 0) {
+            if (!state.scheduler->TimedWaitSchedule(std::chrono::nanoseconds(timeout))) {
+                // If the token is claimed by another thread while we're timing out, it'll insert the thread into the scheduler so we need to wait for it to be scheduled
+                if (state.thread->isCancellable.exchange(false)) {
+                    state.scheduler->InsertThread(state.thread);
+                    state.scheduler->WaitSchedule();
+                } else {
+                    state.scheduler->WaitSchedule(false);
+                }
+            }
+        } else {
             state.scheduler->WaitSchedule(false);
-        lock.lock();
+        }
 
-        state.thread->isCancellable = false;
         auto wakeObject{state.thread->wakeObject};
 
         u32 wakeIndex{};
-        index = 0;
-        for (const auto &object : objectTable) {
+        for (index = 0; index < objectTable.size(); index++) {
+            const auto &object{objectTable[index]};
             if (object.get() == wakeObject)
                 wakeIndex = index;
 
+            if (index >= insertedCount)
+                continue;
+
+            std::lock_guard lock(object->syncObjectMutex);
             auto it{std::find(object->syncObjectWaiters.begin(), object->syncObjectWaiters.end(), state.thread)};
             if (it != object->syncObjectWaiters.end())
                 object->syncObjectWaiters.erase(it);
             else
                 throw exception("svcWaitSynchronization: An object (0x{:X}) has been removed from the syncObjectWaiters queue incorrectly", waitHandles[index]);
-
-            index++;
         }
 
         if (wakeObject) {
             Logger::Debug("Signalled 0x{:X}", waitHandles[wakeIndex]);
             state.ctx->gpr.w0 = Result{};
             state.ctx->gpr.w1 = wakeIndex;
-        } else if (state.thread->cancelSync) {
-            state.thread->cancelSync = false;
+        } else if (state.thread->cancelSync.exchange(false)) {
             Logger::Debug("Wait has been cancelled");
             state.ctx->gpr.w0 = result::Cancelled;
         } else {
             Logger::Debug("Wait has timed out");
             state.ctx->gpr.w0 = result::TimedOut;
-            lock.unlock();
-            state.scheduler->InsertThread(state.thread);
-            state.scheduler->WaitSchedule();
         }
     }
 
     void CancelSynchronization(const DeviceState &state) {
         try {
-            std::unique_lock lock(type::KSyncObject::syncObjectMutex);
             auto thread{state.process->GetHandle<type::KThread>(state.ctx->gpr.w0)};
             thread->cancelSync = true;
-            if (thread->isCancellable) {
-                thread->isCancellable = false;
+            if (thread->isCancellable.exchange(false))
                 state.scheduler->InsertThread(thread);
-            }
             state.ctx->gpr.w0 = Result{};
         } catch (const std::out_of_range &) {
             Logger::Warn("'handle' invalid: 0x{:X}", static_cast<u32>(state.ctx->gpr.w0));
@@ -841,6 +870,7 @@ namespace skyline::kernel::svc {
     }
 
     void SendSyncRequest(const DeviceState &state) {
+        // The HLE handler runs on this host thread while the guest thread is descheduled, this is equivalent to the thread waiting on a server while its core runs other threads
         SchedulerScopedLock schedulerLock(state);
         state.os->serviceManager.SyncRequestHandler(static_cast<KHandle>(state.ctx->gpr.x0));
         state.ctx->gpr.w0 = Result{};
@@ -1106,7 +1136,7 @@ namespace skyline::kernel::svc {
             case ArbitrationType::WaitIfLessThan:
                 Logger::Debug("Waiting on 0x{:X} if less than {} for {}ns", address, value, timeout);
                 result = state.process->WaitForAddress(address, value, timeout, [](u32 *address, u32 value) {
-                    return *address < value;
+                    return __atomic_load_n(address, __ATOMIC_SEQ_CST) < value;
                 });
                 break;
 
@@ -1125,7 +1155,7 @@ namespace skyline::kernel::svc {
             case ArbitrationType::WaitIfEqual:
                 Logger::Debug("Waiting on 0x{:X} if equal to {} for {}ns", address, value, timeout);
                 result = state.process->WaitForAddress(address, value, timeout, [](u32 *address, u32 value) {
-                    return *address == value;
+                    return __atomic_load_n(address, __ATOMIC_SEQ_CST) == value;
                 });
                 break;
 
@@ -1172,15 +1202,25 @@ namespace skyline::kernel::svc {
 
             case SignalType::SignalAndIncrementIfEqual:
                 Logger::Debug("Signalling 0x{:X} and incrementing if equal to {} for {} waiters", address, value, count);
-                result = state.process->SignalToAddress(address, value, count, [](u32 *address, u32 value, u32) {
+                result = state.process->SignalToAddress(address, value, count, [](u32 *address, u32 value, i32, u32) {
                     return __atomic_compare_exchange_n(address, &value, value + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
                 });
                 break;
 
             case SignalType::SignalAndModifyBasedOnWaitingThreadCountIfEqual:
                 Logger::Debug("Signalling 0x{:X} and setting to waiting thread count if equal to {} for {} waiters", address, value, count);
-                result = state.process->SignalToAddress(address, value, count, [](u32 *address, u32 value, u32 waiterCount) {
-                    return __atomic_compare_exchange_n(address, &value, waiterCount, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+                result = state.process->SignalToAddress(address, value, count, [](u32 *address, u32 value, i32 amount, u32 waiterCount) {
+                    // The value is adjusted based on how many waiters will remain after the signal, this matches HOS
+                    u32 newValue;
+                    if (amount <= 0)
+                        newValue = waiterCount ? value - 2 : value + 1;
+                    else if (!waiterCount)
+                        newValue = value + 1;
+                    else if (waiterCount <= static_cast<u32>(amount))
+                        newValue = value - 1;
+                    else
+                        newValue = value;
+                    return __atomic_compare_exchange_n(address, &value, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
                 });
                 break;
 
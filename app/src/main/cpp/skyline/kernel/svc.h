@@ -4,6 +4,7 @@
 #pragma once
 
 #include <common.h>
+#include <nce/guest.h>
 
 namespace skyline::kernel::svc {
     /**
@@ -182,6 +183,7 @@ namespace skyline::kernel::svc {
 
     /**
      * @brief Send a synchronous IPC request to a service
+     * @note The calling thread is removed from its resident core's queue for the duration of the HLE handler, other guest threads can run on the core while a handler blocks
      * @url https://switchbrew.org/wiki/SVC#SendSyncRequest
      */
     void SendSyncRequest(const DeviceState &state);
@@ -241,6 +243,8 @@ namespace skyline::kernel::svc {
     struct SvcDescriptor {
         void (*function)(const DeviceState &); //!< A function pointer to a HLE implementation of the SVC
         const char* name; //!< A pointer to a static string of the SVC name, the underlying data should not be mutated
+        void (*leafFunction)(){}; //!< An optional pointer to guest code implementing the SVC solely with registers and the ThreadContext, it's inlined into the per-SVC trampoline to avoid switching to the host context
+        size_t leafSize{}; //!< The size of the leaf function in 32-bit ARMv8 instructions
 
         operator bool() {
             return function;
@@ -250,6 +254,7 @@ namespace skyline::kernel::svc {
     #define SVC_NONE SvcDescriptor{} //!< A macro with a placeholder value for the SVC not being implemented or not existing
     #define SVC_STRINGIFY(name) #name
     #define SVC_ENTRY(function) SvcDescriptor{function, SVC_STRINGIFY(Svc ## function)} //!< A macro which automatically stringifies the function name as the name to prevent pointless duplication
+    #define SVC_LEAF_ENTRY(function) SvcDescriptor{function, SVC_STRINGIFY(Svc ## function), &nce::guest::Svc ## function ## Leaf, nce::guest::Svc ## function ## LeafSize} //!< SVC_ENTRY for an SVC with a leaf implementation in guest code, the HLE implementation is used when the leaf function falls back to it
 
     /**
      * @brief The SVC table maps all SVCs to their corresponding functions
@@ -285,14 +290,14 @@ namespace skyline::kernel::svc {
         SVC_ENTRY(ArbitrateUnlock), // 0x1B
         SVC_ENTRY(WaitProcessWideKeyAtomic), // 0x1C
         SVC_ENTRY(SignalProcessWideKey), // 0x1D
-        SVC_ENTRY(GetSystemTick), // 0x1E
+        SVC_LEAF_ENTRY(GetSystemTick), // 0x1E
         SVC_ENTRY(ConnectToNamedPort), // 0x1F
         SVC_NONE, // 0x20
         SVC_ENTRY(SendSyncRequest), // 0x21
         SVC_NONE, // 0x22
         SVC_NONE, // 0x23
         SVC_NONE, // 0x24
-        SVC_ENTRY(GetThreadId), // 0x25
+        SVC_LEAF_ENTRY(GetThreadId), // 0x25
         SVC_ENTRY(Break), // 0x26
         SVC_ENTRY(OutputDebugString), // 0x27
         SVC_NONE, // 0x28
@@ -388,4 +393,5 @@ namespace skyline::kernel::svc {
     #undef SVC_NONE
     #undef SVC_STRINGIFY
     #undef SVC_ENTRY
+    #undef SVC_LEAF_ENTRY
 }
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/trace.h>
+#include "svc.h"
+#include "svc_statistics.h"
+
+namespace skyline::kernel::svc {
+    static_assert(SvcStatistics::SvcCount == SvcTable.size());
+
+    namespace {
+        /**
+         * @brief The global totals of a single SVC, these are only written to when a thread flushes its statistics
+         */
+        struct GlobalHistogram {
+            std::atomic<u64> count;
+            std::atomic<u64> totalTicks;
+            std::array<std::atomic<u64>, SvcStatistics::LatencyBucketCount> buckets;
+        };
+
+        std::array<GlobalHistogram, SvcStatistics::SvcCount> GlobalHistograms{};
+
+        /**
+         * @brief The names of the Perfetto counter tracks for every SVC, these need to outlive any usage of them by Perfetto as they're treated as static strings
+         */
+        struct CounterTrackNames {
+            std::array<std::string, SvcStatistics::SvcCount> calls;
+            std::array<std::string, SvcStatistics::SvcCount> latency;
+
+            CounterTrackNames() {
+                for (size_t id{}; id < SvcStatistics::SvcCount; id++) {
+                    const char *name{SvcTable[id].name ? SvcTable[id].name : "Unknown"};
+                    calls[id] = fmt::format("{} Calls", name);
+                    latency[id] = fmt::format("{} Average Latency (ns)", name);
+                }
+            }
+        };
+
+        const CounterTrackNames &GetCounterTrackNames() {
+            static CounterTrackNames names;
+            return names;
+        }
+
+        u64 TicksToNs(u64 ticks) {
+            static const u64 frequency{[] {
+                u64 frequency;
+                asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+                return frequency;
+            }()};
+            return ((ticks / frequency) * constant::NsInSecond) + (((ticks % frequency) * constant::NsInSecond) / frequency);
+        }
+    }
+
+    void SvcStatistics::Flush(ThreadStatistics &statistics, u64 nowTicks) {
+        statistics.lastFlushTicks = nowTicks;
+
+        for (size_t id{}; id < SvcCount; id++) {
+            auto &local{statistics.histograms[id]};
+            if (!local.count)
+                continue;
+
+            auto &global{GlobalHistograms[id]};
+            u64 count{global.count.fetch_add(local.count, std::memory_order_relaxed) + local.count};
+            u64 totalTicks{global.totalTicks.fetch_add(local.totalTicks, std::memory_order_relaxed) + local.totalTicks};
+            for (size_t bucket{}; bucket < LatencyBucketCount; bucket++)
+                if (local.buckets[bucket])
+                    global.buckets[bucket].fetch_add(local.buckets[bucket], std::memory_order_relaxed);
+
+            local = {};
+
+            // Counter tracks are shared across threads so only the cumulative global values are emitted
+            const auto &names{GetCounterTrackNames()};
+            TRACE_COUNTER("kernel", perfetto::CounterTrack(names.calls[id].c_str()), count);
+            TRACE_COUNTER("kernel", perfetto::CounterTrack(names.latency[id].c_str()), TicksToNs(totalTicks / count));
+        }
+    }
+
+    SvcStatistics::Histogram SvcStatistics::GetHistogram(u16 svcId) {
+        auto &global{GlobalHistograms.at(svcId)};
+        Histogram histogram{
+            .count = global.count.load(std::memory_order_relaxed),
+            .totalTicks = global.totalTicks.load(std::memory_order_relaxed),
+        };
+        for (size_t bucket{}; bucket < LatencyBucketCount; bucket++)
+            histogram.buckets[bucket] = global.buckets[bucket].load(std::memory_order_relaxed);
+        return histogram;
+    }
+
+    std::string SvcStatistics::GetSummary(size_t count) {
+        static std::mutex mutex;
+        static std::array<Histogram, SvcCount> previous{}; //!< The totals at the time of the last summary, the summary only covers calls made after it
+        std::scoped_lock lock{mutex};
+
+        std::array<Histogram, SvcCount> deltas{};
+        std::array<u16, SvcCount> order{};
+        for (u16 id{}; id < SvcCount; id++) {
+            auto current{GetHistogram(id)};
+            auto &delta{deltas[id]};
+            delta.count = current.count - previous[id].count;
+            delta.totalTicks = current.totalTicks - previous[id].totalTicks;
+            for (size_t bucket{}; bucket < LatencyBucketCount; bucket++)
+                delta.buckets[bucket] = current.buckets[bucket] - previous[id].buckets[bucket];
+            previous[id] = current;
+            order[id] = id;
+        }
+
+        count = std::min(count, SvcCount);
+        std::partial_sort(order.begin(), order.begin() + static_cast<ssize_t>(count), order.end(), [&](u16 a, u16 b) {
+            return deltas[a].totalTicks > deltas[b].totalTicks;
+        });
+
+        auto toUs{[](u64 ticks) { return static_cast<double>(TicksToNs(ticks)) / constant::NsInMicrosecond; }};
+        std::string summary;
+        for (size_t index{}; index < count; index++) {
+            auto id{order[index]};
+            const auto &delta{deltas[id]};
+            if (!delta.count)
+                break;
+
+            // The 99th percentile is approximated by the upper bound of the bucket it falls into
+            u64 threshold{delta.count - (delta.count / 100)}, accumulated{};
+            size_t p99Bucket{};
+            for (; p99Bucket < LatencyBucketCount - 1; p99Bucket++) {
+                accumulated += delta.buckets[p99Bucket];
+                if (accumulated >= threshold)
+                    break;
+            }
+
+            if (!summary.empty())
+                summary += '\n';
+            summary += fmt::format("{}: {} calls, {:.1f}us avg, p99 {} {:.1f}us", SvcTable[id].name ? SvcTable[id].name : "Unknown", delta.count, toUs(delta.totalTicks / delta.count), p99Bucket == LatencyBucketCount - 1 ? ">=" : "<", toUs(p99Bucket == LatencyBucketCount - 1 ? 1ULL << (LatencyBucketCount - 2) : 1ULL << p99Bucket));
+        }
+        return summary;
+    }
+}
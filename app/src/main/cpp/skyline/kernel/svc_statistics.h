@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <bit>
+#include <common.h>
+
+namespace skyline::kernel::svc {
+    /**
+     * @brief Always-on per-SVC call counts and latency histograms, these are accumulated into thread-local arrays in the SVC dispatch path and are periodically merged into global totals which are also exported as Perfetto counter tracks
+     * @note Leaf SVCs which are inlined into their trampolines never reach the SVC handler and as a result aren't accounted for
+     */
+    class SvcStatistics {
+      public:
+        static constexpr size_t SvcCount{0x80}; //!< The amount of SVCs, this matches the size of the SVC table
+        static constexpr size_t LatencyBucketCount{24}; //!< The amount of log2-sized latency buckets, bucket N holds latencies below 2^N host counter ticks with the last bucket holding everything above that
+
+        /**
+         * @brief The aggregated statistics of a single SVC
+         */
+        struct Histogram {
+            u64 count; //!< The amount of times the SVC was called
+            u64 totalTicks; //!< The total amount of host counter ticks spent in the SVC
+            std::array<u64, LatencyBucketCount> buckets; //!< The amount of calls which fell into each latency bucket
+        };
+
+      private:
+        /**
+         * @brief The minimum interval at which thread-local statistics are merged into the global totals in host counter ticks, this is 100ms
+         */
+        static inline const u64 FlushIntervalTicks{[] {
+            u64 frequency;
+            asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+            return frequency / 10;
+        }()};
+
+        /**
+         * @brief The statistics accumulated by a single thread since its last flush
+         */
+        struct ThreadStatistics {
+            u64 lastFlushTicks; //!< The host counter value at the time of the last flush
+            std::array<Histogram, SvcCount> histograms;
+        };
+
+        static inline thread_local ThreadStatistics localStatistics{};
+
+        /**
+         * @brief Merges the supplied thread-local statistics into the global totals, emits Perfetto counters for any SVCs that were called and resets them
+         */
+        static void Flush(ThreadStatistics &statistics, u64 nowTicks);
+
+      public:
+        /**
+         * @brief Records a single call to an SVC into the calling thread's statistics
+         * @param startTicks The host counter value at the start of the SVC
+         * @param endTicks The host counter value at the end of the SVC
+         */
+        static void Record(u16 svcId, u64 startTicks, u64 endTicks) {
+            auto &statistics{localStatistics};
+            auto &histogram{statistics.histograms[svcId]};
+            u64 ticks{endTicks - startTicks};
+            histogram.count++;
+            histogram.totalTicks += ticks;
+            histogram.buckets[std::min<size_t>(static_cast<size_t>(std::bit_width(ticks)), LatencyBucketCount - 1)]++;
+
+            if (endTicks - statistics.lastFlushTicks >= FlushIntervalTicks) [[unlikely]]
+                Flush(statistics, endTicks);
+        }
+
+        /**
+         * @return A copy of the global totals for the supplied SVC, this excludes any calls that haven't been flushed yet
+         */
+        static Histogram GetHistogram(u16 svcId);
+
+        /**
+         * @return A human-readable summary of the SVCs which the most time has been spent in since the last call
+         * @param count The maximum amount of SVCs to include in the summary
+         */
+        static std::string GetSummary(size_t count);
+    };
+}
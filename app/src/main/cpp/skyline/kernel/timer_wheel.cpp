@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/trace.h>
+#include "timer_wheel.h"
+
+namespace skyline::kernel {
+    TimerWheel::TimerWheel() : currentTick(GetTick(Clock::now())), thread(&TimerWheel::Run, this) {}
+
+    TimerWheel::~TimerWheel() {
+        {
+            std::lock_guard lock(mutex);
+            exiting = true;
+        }
+        condition.notify_all();
+        thread.join();
+    }
+
+    u64 TimerWheel::GetTick(Clock::time_point time) {
+        return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()) >> TickShift;
+    }
+
+    void TimerWheel::Link(Timer &timer) {
+        constexpr u64 WheelRange{1ULL << (SlotBits * LevelCount)}; //!< The amount of ticks covered by all levels of the wheel
+
+        u64 tick{std::max(timer.tick, currentTick)};
+        u64 delta{tick - currentTick};
+        if (delta >= WheelRange)
+            tick = currentTick + WheelRange - 1; // The timer will be relinked with its actual expiry when the last level cascades
+
+        size_t level{};
+        while (level < LevelCount - 1 && delta >= (1ULL << (SlotBits * (level + 1))))
+            level++;
+
+        auto &head{slots[level][(tick >> (SlotBits * level)) & (SlotCount - 1)]};
+        timer.head = &head;
+        timer.previous = nullptr;
+        timer.next = head;
+        if (head)
+            head->previous = &timer;
+        head = &timer;
+    }
+
+    void TimerWheel::Unlink(Timer &timer) {
+        if (timer.previous)
+            timer.previous->next = timer.next;
+        else
+            *timer.head = timer.next;
+        if (timer.next)
+            timer.next->previous = timer.previous;
+        timer.head = nullptr;
+    }
+
+    void TimerWheel::Cascade(size_t level, size_t slot) {
+        // The slot is detached prior to relinking as timers may be relinked into the same slot
+        Timer *timer{std::exchange(slots[level][slot], nullptr)};
+        while (timer) {
+            Timer *next{timer->next};
+            Link(*timer);
+            timer = next;
+        }
+    }
+
+    void TimerWheel::Fire(Timer &timer) {
+        timer.head = nullptr;
+        pendingCount--;
+        timer.callback();
+    }
+
+    void TimerWheel::Advance(u64 tick) {
+        if (tick < currentTick)
+            return;
+
+        if (tick - currentTick >= SlotCount) {
+            // Processing every tick would be slower than just relinking every timer at its expiry relative to the new tick
+            Timer *timers{};
+            for (auto &level : slots) {
+                for (auto &head : level) {
+                    while (head) {
+                        Timer *timer{head};
+                        head = timer->next;
+                        timer->next = timers;
+                        timers = timer;
+                    }
+                }
+            }
+
+            currentTick = tick + 1;
+            while (timers) {
+                Timer *next{timers->next};
+                if (timers->tick < currentTick)
+                    Fire(*timers);
+                else
+                    Link(*timers);
+                timers = next;
+            }
+            return;
+        }
+
+        for (; currentTick <= tick; currentTick++) {
+            // Higher levels are cascaded first as their timers may be cascaded into a lower level slot which is cascaded on this tick as well
+            size_t topLevel{};
+            while (topLevel < LevelCount - 1 && !(currentTick & ((1ULL << (SlotBits * (topLevel + 1))) - 1)))
+                topLevel++;
+            for (size_t level{topLevel}; level > 0; level--)
+                Cascade(level, (currentTick >> (SlotBits * level)) & (SlotCount - 1));
+
+            Timer *timer{std::exchange(slots[0][currentTick & (SlotCount - 1)], nullptr)};
+            while (timer) {
+                Timer *next{timer->next};
+                Fire(*timer);
+                timer = next;
+            }
+        }
+    }
+
+    u64 TimerWheel::GetEarliestTick() {
+        u64 earliest{std::numeric_limits<u64>::max()};
+        for (auto &level : slots)
+            for (auto head : level)
+                for (auto timer{head}; timer; timer = timer->next)
+                    earliest = std::min(earliest, timer->tick);
+        return std::max(earliest, currentTick);
+    }
+
+    void TimerWheel::Run() {
+        pthread_setname_np(pthread_self(), "TimerWheel");
+
+        std::unique_lock lock(mutex);
+        while (!exiting) {
+            Advance(GetTick(Clock::now()));
+
+            if (!pendingCount) {
+                wakeTick = std::numeric_limits<u64>::max();
+                condition.wait(lock, [this]() { return exiting || pendingCount; });
+                continue;
+            }
+
+            wakeTick = GetEarliestTick();
+            TRACE_EVENT("kernel", "TimerWheel::Wait", "pending", pendingCount);
+            condition.wait_until(lock, Clock::time_point{std::chrono::nanoseconds{wakeTick << TickShift}});
+        }
+    }
+
+    void TimerWheel::Insert(Timer &timer, std::chrono::nanoseconds timeout) {
+        auto expiry{std::chrono::duration_cast<std::chrono::nanoseconds>((Clock::now() + timeout).time_since_epoch()).count()};
+        timer.tick = (static_cast<u64>(expiry) + (1ULL << TickShift) - 1) >> TickShift; // The expiry is rounded up so the timer never fires early
+        Link(timer);
+        pendingCount++;
+
+        if (timer.tick < wakeTick) {
+            wakeTick = timer.tick;
+            condition.notify_one();
+        }
+    }
+
+    void TimerWheel::Add(Timer &timer, std::chrono::nanoseconds timeout) {
+        std::lock_guard lock(mutex);
+        Insert(timer, timeout);
+    }
+
+    bool TimerWheel::Cancel(Timer &timer) {
+        std::lock_guard lock(mutex);
+        if (!timer.Pending())
+            return false;
+
+        Unlink(timer);
+        pendingCount--;
+        return true;
+    }
+
+    void TimerWheel::Sleep(std::chrono::nanoseconds duration) {
+        std::condition_variable sleepCondition;
+        Timer timer{.callback = [&sleepCondition]() { sleepCondition.notify_one(); }};
+        try {
+            std::unique_lock lock(mutex);
+            Insert(timer, duration);
+            sleepCondition.wait(lock, [&timer]() { return !timer.Pending(); });
+        } catch (...) {
+            Cancel(timer); // The timer must not be left in the wheel if we're unwinding due to the thread being killed
+            throw;
+        }
+    }
+}
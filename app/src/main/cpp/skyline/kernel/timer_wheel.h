@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <thread>
+#include <common.h>
+
+namespace skyline::kernel {
+    /**
+     * @brief A hierarchical timer wheel serviced by a single host thread, this batches the expiry of kernel timeouts so every waiting thread doesn't need its own host timeout
+     * @note Timers are rounded up to the resolution of the wheel, they'll never fire early but can fire up to a tick late
+     */
+    class TimerWheel {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr u8 TickShift{16}; //!< The log2 of the duration of a single tick in nanoseconds, a tick is ~65.5us
+        static constexpr u8 SlotBits{6}; //!< The log2 of the amount of slots in every level of the wheel
+        static constexpr size_t SlotCount{1 << SlotBits};
+        static constexpr size_t LevelCount{4}; //!< The amount of levels in the wheel, timers beyond the range of the last level are re-inserted when it cascades
+
+        /**
+         * @brief A single timer which is linked into the wheel, it's owned by its user and must outlive its time in the wheel
+         */
+        struct Timer {
+            std::function<void()> callback; //!< The function to call on expiry, this is called on the wheel thread with the wheel's mutex held so it must be short and must not call into the wheel
+            u64 tick{}; //!< The tick at which the timer expires
+            Timer *next{};
+            Timer *previous{};
+            Timer **head{}; //!< The head of the slot the timer is linked into, this is nullptr if the timer isn't pending
+
+            /**
+             * @return If the timer is linked into the wheel and hasn't expired yet
+             * @note The wheel's mutex must be held or the timer must be cancelled for this to be accurate
+             */
+            bool Pending() const {
+                return head;
+            }
+        };
+
+      private:
+        std::mutex mutex; //!< Synchronizes all operations on the wheel and the timers linked into it
+        std::condition_variable condition; //!< Signalled when a timer expiring before the current wake-up is added or when the wheel is being destroyed
+        std::array<std::array<Timer *, SlotCount>, LevelCount> slots{};
+        u64 currentTick; //!< The next tick to be processed by the wheel thread
+        u64 wakeTick{std::numeric_limits<u64>::max()}; //!< The tick which the wheel thread is waiting for
+        size_t pendingCount{}; //!< The amount of timers linked into the wheel
+        bool exiting{};
+        std::thread thread;
+
+        static u64 GetTick(Clock::time_point time);
+
+        /**
+         * @brief Adds a timer to the wheel, the wheel's mutex must be held by the caller
+         */
+        void Insert(Timer &timer, std::chrono::nanoseconds timeout);
+
+        /**
+         * @brief Links the timer into the slot corresponding to its expiry relative to currentTick
+         */
+        void Link(Timer &timer);
+
+        void Unlink(Timer &timer);
+
+        /**
+         * @brief Unlinks all timers from a slot and re-links them at their expiry relative to currentTick, this moves them into lower levels as they get closer to expiring
+         */
+        void Cascade(size_t level, size_t slot);
+
+        void Fire(Timer &timer);
+
+        /**
+         * @brief Processes all ticks up till and including the supplied tick, if the wheel has fallen far behind then all timers are reinserted rather than every tick being processed
+         */
+        void Advance(u64 tick);
+
+        /**
+         * @return The earliest tick that any pending timer expires at
+         */
+        u64 GetEarliestTick();
+
+        void Run();
+
+      public:
+        TimerWheel();
+
+        ~TimerWheel();
+
+        /**
+         * @brief Adds a timer which expires after the supplied timeout
+         * @note The timer must not be pending already
+         */
+        void Add(Timer &timer, std::chrono::nanoseconds timeout);
+
+        /**
+         * @brief Removes a timer from the wheel if it hasn't expired yet, after this returns the callback is guaranteed to not be running or to be run
+         * @return If the timer was pending prior to being cancelled
+         */
+        bool Cancel(Timer &timer);
+
+        /**
+         * @brief Blocks the calling thread for at least the supplied duration
+         */
+        void Sleep(std::chrono::nanoseconds duration);
+    };
+}
@@ -4,6 +4,7 @@
 #include <android/sharedmem.h>
 #include <asm/unistd.h>
 #include <unistd.h>
+#include <common/memory_accounting.h>
 #include "KPrivateMemory.h"
 #include "KProcess.h"
 
@@ -28,19 +29,25 @@ namespace skyline::kernel::type {
             .permission = permission,
             .state = memState,
         });
+        MemoryAccounting::Update(MemoryAccounting::Category::GuestMemory, static_cast<i64>(size));
     }
 
     void KPrivateMemory::Resize(size_t nSize) {
-        if (mprotect(ptr, nSize, PROT_READ | PROT_WRITE | PROT_EXEC) < 0)
-            throw exception("An occurred while resizing private memory: {}", strerror(errno));
-
+        // Only the difference between the sizes is reprotected, the rest of the mapping is untouched and the chunk map update is logarithmic so this is independent of the size of the allocation
         if (nSize < size) {
+            if (mprotect(ptr + nSize, size - nSize, PROT_NONE) < 0)
+                throw exception("An error occurred while shrinking private memory: {}", strerror(errno));
+            state.process->memory.FreeBacking(ptr + nSize, size - nSize); // Memory freed by the guest is returned to the host rather than lingering till the process exits
+
             state.process->memory.InsertChunk(ChunkDescriptor{
                 .ptr = ptr + nSize,
                 .size = size - nSize,
                 .state = memory::states::Unmapped,
             });
         } else if (size < nSize) {
+            if (mprotect(ptr + size, nSize - size, PROT_READ | PROT_WRITE | PROT_EXEC) < 0)
+                throw exception("An error occurred while growing private memory: {}", strerror(errno));
+
             state.process->memory.InsertChunk(ChunkDescriptor{
                 .ptr = ptr + size,
                 .size = nSize - size,
@@ -49,6 +56,7 @@ namespace skyline::kernel::type {
             });
         }
 
+        MemoryAccounting::Update(MemoryAccounting::Category::GuestMemory, static_cast<i64>(nSize) - static_cast<i64>(size));
         size = nSize;
     }
 
@@ -76,6 +84,10 @@ namespace skyline::kernel::type {
         if (memoryState == memory::states::CodeStatic && pPermission.w)
             memoryState = memory::states::CodeMutable;
 
+        // Aliases in the stack region are mapped with the guest permission on the host (See MemoryManager::MapAlias), they need to be reprotected to match it
+        if (memoryState == memory::states::Stack && pSize && mprotect(pPtr, pSize, pPermission.Get()) < 0)
+            throw exception("Failed to change the permission of 0x{:X} - 0x{:X}: {}", pPtr, pPtr + pSize, strerror(errno));
+
         state.process->memory.InsertChunk(ChunkDescriptor{
             .ptr = pPtr,
             .size = pSize,
@@ -86,10 +98,12 @@ namespace skyline::kernel::type {
 
     KPrivateMemory::~KPrivateMemory() {
         mprotect(ptr, size, PROT_NONE);
+        state.process->memory.FreeBacking(ptr, size);
         state.process->memory.InsertChunk(ChunkDescriptor{
             .ptr = ptr,
             .size = size,
             .state = memory::states::Unmapped,
         });
+        MemoryAccounting::Update(MemoryAccounting::Category::GuestMemory, -static_cast<i64>(size));
     }
 }
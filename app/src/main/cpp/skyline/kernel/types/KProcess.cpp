@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <bit>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <nce.h>
 #include <os.h>
 #include <common/trace.h>
@@ -53,6 +56,13 @@ namespace skyline::kernel::type {
 
     u8 *KProcess::AllocateTlsSlot() {
         std::lock_guard lock(tlsMutex);
+        if (!freeTlsSlots.empty()) {
+            u8 *slot{freeTlsSlots.back()};
+            freeTlsSlots.pop_back();
+            std::memset(slot, 0, constant::TlsSlotSize);
+            return slot;
+        }
+
         u8 *slot;
         for (auto &tlsPage: tlsPages)
             if ((slot = tlsPage->ReserveSlot()))
@@ -64,6 +74,11 @@ namespace skyline::kernel::type {
         return tlsPage->ReserveSlot();
     }
 
+    void KProcess::FreeTlsSlot(u8 *slot) {
+        std::lock_guard lock(tlsMutex);
+        freeTlsSlots.push_back(slot);
+    }
+
     std::shared_ptr<KThread> KProcess::CreateThread(void *entry, u64 argument, void *stackTop, std::optional<i8> priority, std::optional<u8> idealCore) {
         std::lock_guard guard(threadMutex);
         if (disableThreadCreation)
@@ -79,11 +94,55 @@ namespace skyline::kernel::type {
         return thread;
     }
 
+    KHandle KProcess::ReserveHandle() {
+        u16 index;
+        if (freeHandleHead != constant::HandleTableSize) {
+            index = freeHandleHead;
+            freeHandleHead = handleTable[index].nextFree;
+        } else if (handleTableEnd != constant::HandleTableSize) {
+            index = handleTableEnd++;
+        } else {
+            throw exception("The handle table is full: {} handles", constant::HandleTableSize);
+        }
+
+        auto &entry{handleTable[index]};
+        entry.generation = static_cast<u16>((entry.generation % ((1U << constant::HandleGenerationBits) - 1)) + 1); // The generation is never 0 so a handle can never be 0
+        return (static_cast<KHandle>(entry.generation) << constant::HandleIndexBits) | index;
+    }
+
+    void KProcess::PublishHandle(KHandle handle, std::shared_ptr<KObject> object) {
+        auto &entry{handleTable[GetHandleIndex(handle)]};
+        u64 tag{handle | (static_cast<u64>(object->objectType) << 32)};
+        std::atomic_store_explicit(&entry.object, std::move(object), std::memory_order_release);
+        entry.tag.store(tag, std::memory_order_release);
+    }
+
+    std::shared_ptr<KObject> KProcess::ReleaseHandle(KHandle handle) {
+        u16 index{GetHandleIndex(handle)};
+        auto &entry{handleTable[index]};
+        entry.tag.store(0, std::memory_order_release);
+        auto object{std::atomic_exchange_explicit(&entry.object, std::shared_ptr<KObject>{}, std::memory_order_acq_rel)};
+        entry.nextFree = freeHandleHead;
+        freeHandleHead = index;
+        return object;
+    }
+
+    void KProcess::CloseHandle(KHandle handle) {
+        std::shared_ptr<KObject> object; // The object is destroyed after the lock is released
+        std::lock_guard lock(handleMutex);
+        u16 index{GetHandleIndex(handle)};
+        if (index >= constant::HandleTableSize || static_cast<KHandle>(handleTable[index].tag.load(std::memory_order_relaxed)) != handle)
+            throw std::out_of_range(fmt::format("CloseHandle was called with an invalid or closed handle: 0x{:X}", handle));
+        object = ReleaseHandle(handle);
+    }
+
     std::optional<KProcess::HandleOut<KMemory>> KProcess::GetMemoryObject(u8 *ptr) {
-        std::shared_lock lock(handleMutex);
+        std::lock_guard lock(handleMutex);
 
-        for (KHandle index{}; index < handles.size(); index++) {
-            auto &object{handles[index]};
+        for (u16 index{}; index < handleTableEnd; index++) {
+            auto &entry{handleTable[index]};
+            u64 tag{entry.tag.load(std::memory_order_relaxed)};
+            auto object{tag ? std::atomic_load_explicit(&entry.object, std::memory_order_relaxed) : nullptr};
             if (object) {
                 switch (object->objectType) {
                     case type::KType::KPrivateMemory:
@@ -91,7 +150,7 @@ namespace skyline::kernel::type {
                     case type::KType::KTransferMemory: {
                         auto mem{std::static_pointer_cast<type::KMemory>(object)};
                         if (mem->IsInside(ptr))
-                            return std::make_optional<KProcess::HandleOut<KMemory>>({mem, constant::BaseHandleIndex + index});
+                            return std::make_optional<KProcess::HandleOut<KMemory>>({mem, static_cast<KHandle>(tag)});
                     }
 
                     default:
@@ -103,12 +162,49 @@ namespace skyline::kernel::type {
     }
 
     void KProcess::ClearHandleTable() {
-        std::shared_lock lock(handleMutex);
-        handles.clear();
+        std::vector<std::shared_ptr<KObject>> objects; // The objects are destroyed after the lock is released
+        std::lock_guard lock(handleMutex);
+        for (u16 index{}; index < handleTableEnd; index++) {
+            auto &entry{handleTable[index]};
+            if (entry.tag.load(std::memory_order_relaxed))
+                objects.push_back(ReleaseHandle(static_cast<KHandle>(entry.tag.load(std::memory_order_relaxed))));
+        }
     }
 
     constexpr u32 HandleWaitersBit{1UL << 30}; //!< A bit which denotes if a mutex psuedo-handle has waiters or not
 
+    std::optional<Result> KProcess::SpinMutexLock(u32 *mutex, KHandle ownerHandle, KHandle tag, const KThread &owner) {
+        i64 deadline{util::GetTimeNs() + MutexSpinDurationNs};
+        std::optional<Result> result;
+
+        mutexSpinners++;
+        while (true) {
+            u32 value{};
+            if (__atomic_compare_exchange_n(mutex, &value, tag, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                result = Result{};
+                break;
+            }
+
+            if (value != (ownerHandle | HandleWaitersBit)) {
+                // The mutex has changed owners, the guest will retry the lock with the new owner
+                result = result::InvalidCurrentMemory;
+                break;
+            }
+
+            // Spinning is only worthwhile while the owner is running as it can't release the mutex otherwise
+            i64 remaining{deadline - util::GetTimeNs()};
+            if (remaining <= 0 || !state.scheduler->IsScheduled(owner))
+                break;
+
+            // MutexUnlock will wake us if it releases the mutex without any waiters, a spurious wake or EINTR from a yield signal just causes the mutex to be rechecked
+            timespec timeout{.tv_nsec = remaining};
+            syscall(SYS_futex, mutex, FUTEX_WAIT_PRIVATE, value, &timeout, nullptr, 0);
+        }
+        mutexSpinners--;
+
+        return result;
+    }
+
     Result KProcess::MutexLock(u32 *mutex, KHandle ownerHandle, KHandle tag) {
         TRACE_EVENT_FMT("kernel", "MutexLock 0x{:X}", mutex);
 
@@ -122,6 +218,9 @@ namespace skyline::kernel::type {
             return result::InvalidHandle;
         }
 
+        if (auto result{SpinMutexLock(mutex, ownerHandle, tag, *owner)})
+            return *result;
+
         bool isHighestPriority;
         {
             std::lock_guard lock(owner->waiterMutex);
@@ -176,42 +275,28 @@ namespace skyline::kernel::type {
                 }
             }
 
-            if (!waiters.empty()) {
-                // If there are threads still waiting on us then try to inherit their priority
-                auto highestPriorityThread{waiters.front()};
-                i8 newPriority, basePriority;
-                do {
-                    basePriority = state.thread->basePriority.load();
-                    newPriority = std::min(basePriority, highestPriorityThread->priority.load());
-                } while (basePriority != newPriority && state.thread->priority.compare_exchange_strong(basePriority, newPriority));
+            // Any priority inherited from the waiters which were moved is dropped while any inherited from the remaining waiters is retained
+            if (state.thread->RecalculatePriority())
                 state.scheduler->UpdatePriority(state.thread);
-            } else {
-                i8 priority, basePriority;
-                do {
-                    basePriority = state.thread->basePriority.load();
-                    priority = state.thread->priority.load();
-                } while (priority != basePriority && !state.thread->priority.compare_exchange_strong(priority, basePriority));
-                if (priority != basePriority)
-                    state.scheduler->UpdatePriority(state.thread);
-            }
 
-            if (nextWaiter) {
-                // If there is a waiter on the new owner then try to inherit its priority
-                i8 priority, ownerPriority;
-                do {
-                    ownerPriority = nextOwner->priority.load();
-                    priority = std::min(ownerPriority, nextWaiter->priority.load());
-                } while (ownerPriority != priority && nextOwner->priority.compare_exchange_strong(ownerPriority, priority));
+            // The next owner inherits the priority of the waiters that were moved to it, it isn't scheduled yet so it's inserted with that priority
+            nextOwner->RecalculatePriority();
 
+            if (nextWaiter) {
                 __atomic_store_n(mutex, nextOwner->waitTag | HandleWaitersBit, __ATOMIC_SEQ_CST);
             } else {
                 __atomic_store_n(mutex, nextOwner->waitTag, __ATOMIC_SEQ_CST);
             }
 
+            if (mutexSpinners)
+                syscall(SYS_futex, mutex, FUTEX_WAKE_PRIVATE, std::numeric_limits<i32>::max(), nullptr, nullptr, 0); // Any spinners need to observe the change in ownership
+
             // Finally, schedule the next owner accordingly
             state.scheduler->InsertThread(nextOwner);
         } else {
             __atomic_store_n(mutex, 0, __ATOMIC_SEQ_CST);
+            if (mutexSpinners)
+                syscall(SYS_futex, mutex, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0); // Only a single spinner can acquire the mutex
         }
     }
 
@@ -259,39 +344,58 @@ namespace skyline::kernel::type {
     void KProcess::ConditionalVariableSignal(u32 *key, i32 amount) {
         TRACE_EVENT_FMT("kernel", "ConditionalVariableSignal 0x{:X}", key);
 
+        // Waiters set the key prior to releasing their mutex, if it's unset then there are no waiters that could've been ordered before this signal
+        if (!__atomic_load_n(key, __ATOMIC_SEQ_CST))
+            return;
+
         std::lock_guard lock(syncWaiterMutex);
         auto queue{syncWaiters.equal_range(key)};
 
         auto it{queue.first};
+        boost::container::small_vector<std::shared_ptr<KThread>, 4> wokenWaiters;
         for (i32 waiterCount{amount}; it != queue.second && (amount <= 0 || waiterCount); it = syncWaiters.erase(it), waiterCount--)
-            state.scheduler->InsertThread(it->second);
+            wokenWaiters.push_back(std::move(it->second));
+        state.scheduler->InsertThreads(span(wokenWaiters.data(), wokenWaiters.size()));
 
         if (it == queue.second)
             __atomic_store_n(key, false, __ATOMIC_SEQ_CST); // We need to update the boolean flag denoting that there are no more threads waiting on this conditional variable
     }
 
+    KProcess::ArbiterBucket &KProcess::GetArbiterBucket(u32 *address) {
+        // Fibonacci hashing of the word index spreads adjacent addresses and addresses with common alignments across buckets
+        constexpr u64 FibonacciMultiplier{0x9E3779B97F4A7C15};
+        return arbiterBuckets[((reinterpret_cast<u64>(address) >> 2) * FibonacciMultiplier) >> (64 - std::countr_zero(ArbiterBucketCount))];
+    }
+
     Result KProcess::WaitForAddress(u32 *address, u32 value, i64 timeout, bool (*arbitrationFunction)(u32 *, u32)) {
         TRACE_EVENT_FMT("kernel", "WaitForAddress 0x{:X}", address);
 
+        auto &bucket{GetArbiterBucket(address)};
         {
-            std::lock_guard lock(syncWaiterMutex);
-            if (!arbitrationFunction(address, value)) [[unlikely]]
+            std::lock_guard lock(bucket.mutex);
+
+            // The waiter is counted prior to checking the value so a signaller which changed the value beforehand can't miss it, this must be sequentially consistent with the value load
+            bucket.waiterCount.fetch_add(1);
+            if (!arbitrationFunction(address, value)) [[unlikely]] {
+                bucket.waiterCount.fetch_sub(1, std::memory_order_relaxed);
                 return result::InvalidState;
+            }
 
-            auto queue{syncWaiters.equal_range(address)};
-            syncWaiters.insert(std::upper_bound(queue.first, queue.second, state.thread->priority.load(), [](const i8 priority, const SyncWaiters::value_type &it) { return it.second->priority > priority; }), {address, state.thread});
+            auto queue{bucket.waiters.equal_range(address)};
+            bucket.waiters.insert(std::upper_bound(queue.first, queue.second, state.thread->priority.load(), [](const i8 priority, const SyncWaiters::value_type &it) { return it.second->priority > priority; }), {address, state.thread});
 
             state.scheduler->RemoveThread();
         }
 
         if (timeout > 0 && !state.scheduler->TimedWaitSchedule(std::chrono::nanoseconds(timeout))) {
             {
-                std::lock_guard lock(syncWaiterMutex);
-                auto queue{syncWaiters.equal_range(address)};
+                std::lock_guard lock(bucket.mutex);
+                auto queue{bucket.waiters.equal_range(address)};
                 auto iterator{std::find(queue.first, queue.second, SyncWaiters::value_type{address, state.thread})};
-                if (iterator != queue.second)
-                    if (syncWaiters.erase(iterator) == queue.second)
-                        __atomic_store_n(address, false, __ATOMIC_SEQ_CST);
+                if (iterator != queue.second) {
+                    bucket.waiters.erase(iterator);
+                    bucket.waiterCount.fetch_sub(1, std::memory_order_relaxed);
+                }
             }
 
             state.scheduler->InsertThread(state.thread);
@@ -305,19 +409,31 @@ namespace skyline::kernel::type {
         return {};
     }
 
-    Result KProcess::SignalToAddress(u32 *address, u32 value, i32 amount, bool(*mutateFunction)(u32 *address, u32 value, u32 waiterCount)) {
+    Result KProcess::SignalToAddress(u32 *address, u32 value, i32 amount, bool(*mutateFunction)(u32 *address, u32 value, i32 amount, u32 waiterCount)) {
         TRACE_EVENT_FMT("kernel", "SignalToAddress 0x{:X}", address);
 
-        std::lock_guard lock(syncWaiterMutex);
-        auto queue{syncWaiters.equal_range(address)};
+        auto &bucket{GetArbiterBucket(address)};
+        if (!mutateFunction) {
+            // The guest's store to the address must be ordered before checking for waiters, any waiter that isn't counted yet will observe the new value
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!bucket.waiterCount.load(std::memory_order_relaxed))
+                return {};
+        }
+
+        std::lock_guard lock(bucket.mutex);
+        auto queue{bucket.waiters.equal_range(address)};
 
         if (mutateFunction)
-            if (!mutateFunction(address, value, (amount <= 0) ? 0 : std::min(static_cast<u32>(std::distance(queue.first, queue.second) - amount), 0U))) [[unlikely]]
+            if (!mutateFunction(address, value, amount, static_cast<u32>(std::distance(queue.first, queue.second)))) [[unlikely]]
                 return result::InvalidState;
 
         i32 waiterCount{amount};
-        for (auto it{queue.first}; it != queue.second && (amount <= 0 || waiterCount); it = syncWaiters.erase(it), waiterCount--)
-            state.scheduler->InsertThread(it->second);
+        boost::container::small_vector<std::shared_ptr<KThread>, 4> wokenWaiters;
+        for (auto it{queue.first}; it != queue.second && (amount <= 0 || waiterCount); it = bucket.waiters.erase(it), waiterCount--) {
+            bucket.waiterCount.fetch_sub(1, std::memory_order_relaxed);
+            wokenWaiters.push_back(std::move(it->second));
+        }
+        state.scheduler->InsertThreads(span(wokenWaiters.data(), wokenWaiters.size()));
 
         return {};
     }
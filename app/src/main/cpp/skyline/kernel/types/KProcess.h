@@ -13,7 +13,9 @@ namespace skyline {
     namespace constant {
         constexpr u16 TlsSlotSize{0x200}; //!< The size of a single TLS slot
         constexpr u8 TlsSlots{PAGE_SIZE / TlsSlotSize}; //!< The amount of TLS slots in a single page
-        constexpr KHandle BaseHandleIndex{0xD000}; //!< The index of the base handle
+        constexpr size_t HandleTableSize{0x2000}; //!< The maximum amount of handles in a process handle table
+        constexpr u8 HandleIndexBits{15}; //!< The amount of low bits in a handle which hold its index in the handle table
+        constexpr u8 HandleGenerationBits{15}; //!< The amount of bits above the index which hold the generation of the handle table entry, this leaves the mutex waiters bit clear
     }
 
     namespace kernel::type {
@@ -30,9 +32,25 @@ namespace skyline {
             std::atomic_bool alreadyKilled{}; //!< If the process has already been killed prior so there's no need to redundantly kill it again
             std::vector<std::shared_ptr<KThread>> threads;
 
+            std::atomic<u32> mutexSpinners{}; //!< The amount of threads spinning on a mutex word in MutexLock, this is used to avoid redundant futex wakes in MutexUnlock
+
             using SyncWaiters = std::multimap<void *, std::shared_ptr<KThread>>;
             std::mutex syncWaiterMutex; //!< Synchronizes all mutations to the map to prevent races
-            SyncWaiters syncWaiters; //!< All threads waiting on process-wide synchronization primitives (Atomic keys + Address Arbiter)
+            SyncWaiters syncWaiters; //!< All threads waiting on process-wide conditional variables
+
+            /**
+             * @brief A bucket of threads waiting on the address arbiter, addresses are hashed into a fixed set of buckets so waits and signals on unrelated addresses don't contend on a single lock
+             */
+            struct ArbiterBucket {
+                std::mutex mutex; //!< Synchronizes all mutations to the waiters
+                std::atomic<u32> waiterCount{}; //!< The amount of threads which are waiting or about to wait in this bucket, a plain signal skips locking the bucket if this is zero
+                SyncWaiters waiters; //!< The threads waiting in this bucket, sorted by priority within each address
+            };
+
+            static constexpr size_t ArbiterBucketCount{64}; //!< The amount of address arbiter buckets, this must be a power of two
+            std::array<ArbiterBucket, ArbiterBucketCount> arbiterBuckets;
+
+            ArbiterBucket &GetArbiterBucket(u32 *address);
 
             /**
             * @brief The status of a single TLS page (A page is 4096 bytes on ARMv8)
@@ -57,13 +75,77 @@ namespace skyline {
             u8 *tlsExceptionContext{}; //!< A pointer to the TLS exception handling context slot
             std::mutex tlsMutex; //!< A mutex to synchronize allocation of TLS pages to prevent extra pages from being created
             std::vector<std::shared_ptr<TlsPage>> tlsPages; //!< All TLS pages allocated by this process
+            std::vector<u8 *> freeTlsSlots; //!< TLS slots which were released by exited threads and can be reused without reserving a new slot
             std::shared_ptr<KPrivateMemory> mainThreadStack; //!< The stack memory of the main thread stack is owned by the KProcess itself
             std::shared_ptr<KPrivateMemory> heap;
             vfs::NPDM npdm;
 
           private:
-            std::shared_mutex handleMutex;
-            std::vector<std::shared_ptr<KObject>> handles;
+            /**
+             * @brief A single entry in the handle table, the tag is checked by readers before and after they acquire the object so they don't require any locking
+             */
+            struct HandleEntry {
+                std::atomic<u64> tag{}; //!< The handle of the entry in the lower 32 bits and the KType of its object in the upper 32 bits, this is 0 while the entry is free
+                std::shared_ptr<KObject> object; //!< The object the entry refers to, this must only be accessed with the atomic shared_ptr functions
+                u16 generation{}; //!< The generation of the current or last object in the entry, this is bumped on every reuse so stale handles are rejected
+                u16 nextFree{}; //!< The index of the next entry in the free list while this entry is free
+            };
+
+            std::mutex handleMutex; //!< Synchronizes all mutations of the handle table, lookups don't require it
+            std::array<HandleEntry, constant::HandleTableSize> handleTable;
+            u16 handleTableEnd{}; //!< The index past the last entry which has ever been used
+            u16 freeHandleHead{constant::HandleTableSize}; //!< The index of the first entry in the free list, this is HandleTableSize if the free list is empty
+
+            /**
+             * @brief Reserves a free entry in the handle table, it must be published with PublishHandle or released with ReleaseHandle after this
+             * @note handleMutex must be held by the caller
+             */
+            KHandle ReserveHandle();
+
+            /**
+             * @brief Makes the supplied object visible to lookups at a handle reserved with ReserveHandle
+             * @note handleMutex must be held by the caller
+             */
+            void PublishHandle(KHandle handle, std::shared_ptr<KObject> object);
+
+            /**
+             * @brief Pushes the entry of the supplied handle onto the free list and returns the object in it, the object should be destroyed after handleMutex is released as its destructor may access the handle table
+             * @note handleMutex must be held by the caller
+             */
+            std::shared_ptr<KObject> ReleaseHandle(KHandle handle);
+
+            static constexpr u16 GetHandleIndex(KHandle handle) {
+                return static_cast<u16>(handle & ((1U << constant::HandleIndexBits) - 1));
+            }
+
+            /**
+             * @brief Looks up an object in the handle table without taking any locks
+             * @param type The type which the object must be of, this is checked against the entry tag prior to acquiring a reference to the object
+             */
+            std::shared_ptr<KObject> LookupHandle(KHandle handle, std::optional<KType> type = std::nullopt) {
+                u16 index{GetHandleIndex(handle)};
+                if (index < constant::HandleTableSize) {
+                    auto &entry{handleTable[index]};
+                    u64 tag{entry.tag.load(std::memory_order_acquire)};
+                    if (static_cast<KHandle>(tag) == handle) {
+                        if (type && static_cast<KType>(tag >> 32) != *type)
+                            throw exception("Tried to get kernel object (0x{:X}) with different type: {} when object is {}", handle, *type, static_cast<KType>(tag >> 32));
+
+                        auto object{std::atomic_load_explicit(&entry.object, std::memory_order_acquire)};
+                        if (object && entry.tag.load(std::memory_order_acquire) == tag)
+                            return object;
+                    }
+                }
+                throw std::out_of_range(fmt::format("GetHandle was called with an invalid or closed handle: 0x{:X}", handle));
+            }
+
+            static constexpr i64 MutexSpinDurationNs{constant::NsInMicrosecond * 50}; //!< The maximum duration to spin on a contended mutex before falling back to blocking on the HLE scheduler
+
+            /**
+             * @brief Spins on the mutex word with a host futex while the owner is running on another core, this avoids the HLE scheduler entirely for briefly contended mutexes
+             * @return The result of the lock if it was resolved while spinning, std::nullopt if the owner isn't running or we've spun for too long
+             */
+            std::optional<Result> SpinMutexLock(u32 *mutex, KHandle ownerHandle, KHandle tag, const KThread &owner);
 
           public:
             KProcess(const DeviceState &state);
@@ -91,6 +173,12 @@ namespace skyline {
              */
             u8 *AllocateTlsSlot();
 
+            /**
+             * @brief Releases a TLS slot allocated with AllocateTlsSlot so it can be reused by a future thread
+             * @note The slot is zeroed when it's reused rather than when it's released
+             */
+            void FreeTlsSlot(u8 *slot);
+
             /**
              * @return A shared pointer to a KThread initialized with the specified values or nullptr, if thread creation has been disabled
              * @note The default values are for the main thread and will use values from the NPDM
@@ -114,15 +202,22 @@ namespace skyline {
              */
             template<typename objectClass, typename ...objectArgs>
             HandleOut<objectClass> NewHandle(objectArgs... args) {
+                std::shared_ptr<objectClass> item;
+                std::shared_ptr<KObject> released; // If construction fails, this must outlive the lock
                 std::unique_lock lock(handleMutex);
 
-                std::shared_ptr<objectClass> item;
-                if constexpr (std::is_same<objectClass, KThread>())
-                    item = std::make_shared<objectClass>(state, constant::BaseHandleIndex + handles.size(), args...);
-                else
-                    item = std::make_shared<objectClass>(state, args...);
-                handles.push_back(std::static_pointer_cast<KObject>(item));
-                return {item, static_cast<KHandle>((constant::BaseHandleIndex + handles.size()) - 1)};
+                KHandle handle{ReserveHandle()};
+                try {
+                    if constexpr (std::is_same<objectClass, KThread>())
+                        item = std::make_shared<objectClass>(state, handle, args...);
+                    else
+                        item = std::make_shared<objectClass>(state, args...);
+                } catch (...) {
+                    released = ReleaseHandle(handle);
+                    throw;
+                }
+                PublishHandle(handle, std::static_pointer_cast<KObject>(item));
+                return {item, handle};
             }
 
             /**
@@ -133,14 +228,13 @@ namespace skyline {
             KHandle InsertItem(std::shared_ptr<objectClass> &item) {
                 std::unique_lock lock(handleMutex);
 
-                handles.push_back(std::static_pointer_cast<KObject>(item));
-                return static_cast<KHandle>((constant::BaseHandleIndex + handles.size()) - 1);
+                KHandle handle{ReserveHandle()};
+                PublishHandle(handle, std::static_pointer_cast<KObject>(item));
+                return handle;
             }
 
             template<typename objectClass = KObject>
             std::shared_ptr<objectClass> GetHandle(KHandle handle) {
-                std::shared_lock lock(handleMutex);
-
                 KType objectType;
                 if constexpr(std::is_same<objectClass, KThread>()) {
                     constexpr KHandle threadSelf{0xFFFF8000}; // The handle used by threads to refer to themselves
@@ -165,27 +259,12 @@ namespace skyline {
                 } else {
                     throw exception("KProcess::GetHandle couldn't determine object type");
                 }
-                try {
-                    auto &item{handles.at(handle - constant::BaseHandleIndex)};
-                    if (item != nullptr && item->objectType == objectType)
-                        return std::static_pointer_cast<objectClass>(item);
-                    else if (item == nullptr)
-                        throw exception("GetHandle was called with a deleted handle: 0x{:X}", handle);
-                    else
-                        throw exception("Tried to get kernel object (0x{:X}) with different type: {} when object is {}", handle, objectType, item->objectType);
-                } catch (const std::out_of_range &) {
-                    throw std::out_of_range(fmt::format("GetHandle was called with an invalid handle: 0x{:X}", handle));
-                }
+                return std::static_pointer_cast<objectClass>(LookupHandle(handle, objectType));
             }
 
             template<>
             std::shared_ptr<KObject> GetHandle<KObject>(KHandle handle) {
-                std::shared_lock lock(handleMutex);
-                auto &item{handles.at(handle - constant::BaseHandleIndex)};
-                if (item != nullptr)
-                    return item;
-                else
-                    throw std::out_of_range(fmt::format("GetHandle was called with a deleted handle: 0x{:X}", handle));
+                return LookupHandle(handle);
             }
 
             /**
@@ -197,10 +276,9 @@ namespace skyline {
 
             /**
              * @brief Closes a handle in the handle table
+             * @throw std::out_of_range If the handle is invalid or was already closed
              */
-            void CloseHandle(KHandle handle) {
-                handles.at(handle - constant::BaseHandleIndex) = nullptr;
-            }
+            void CloseHandle(KHandle handle);
 
             /**
              * @brief Clear the process handle table
@@ -237,8 +315,10 @@ namespace skyline {
 
             /**
              * @brief Signals a variable amount of waiters at the supplied address
+             * @param mutateFunction A function which atomically modifies the value at the address, it's supplied the amount of threads waiting on the address and is called with the address's bucket locked so no threads can start waiting concurrently
+             * @note A plain signal doesn't take any locks when there are no waiters on any address in the same bucket
              */
-            Result SignalToAddress(u32 *address, u32 value, i32 amount, bool(*mutateFunction)(u32 *address, u32 value, u32 waiterCount) = nullptr);
+            Result SignalToAddress(u32 *address, u32 value, i32 amount, bool(*mutateFunction)(u32 *address, u32 value, i32 amount, u32 waiterCount) = nullptr);
         };
     }
 }
@@ -4,6 +4,7 @@
 #include <android/sharedmem.h>
 #include <unistd.h>
 #include <asm/unistd.h>
+#include <common/memory_accounting.h>
 #include "KSharedMemory.h"
 #include "KProcess.h"
 
@@ -20,6 +21,23 @@ namespace skyline::kernel::type {
             throw exception("An occurred while mapping shared memory: {}", strerror(errno));
 
         host.size = size;
+        MemoryAccounting::Update(MemoryAccounting::Category::SharedMemory, static_cast<i64>(size));
+    }
+
+    KSharedMemory::KSharedMemory(const DeviceState &state, u8 *ptr, size_t size, memory::MemoryState memState, KType type)
+        : memoryState(memState),
+          KMemory(state, type) {
+        if (!state.process->memory.base.IsInside(ptr) || !state.process->memory.base.IsInside(ptr + size - 1))
+            throw exception("KSharedMemory mirror isn't inside guest address space: 0x{:X} - 0x{:X}", ptr, ptr + size);
+
+        fd = state.process->memory.GetBackingFd();
+        fdOffset = state.process->memory.GetBackingOffset(ptr);
+
+        host.ptr = static_cast<u8 *>(mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, fdOffset));
+        if (host.ptr == MAP_FAILED)
+            throw exception("An error occurred while mirroring guest memory: {}", strerror(errno));
+
+        host.size = size;
     }
 
     u8 *KSharedMemory::Map(u8 *ptr, u64 size, memory::Permission permission) {
@@ -30,7 +48,7 @@ namespace skyline::kernel::type {
         if (guest.Valid())
             throw exception("Mapping KSharedMemory multiple times on guest is not supported: Requested Mapping: 0x{:X} - 0x{:X} (0x{:X}), Current Mapping: 0x{:X} - 0x{:X} (0x{:X})", ptr, ptr + size, size, guest.ptr, guest.ptr + guest.size, guest.size);
 
-        guest.ptr = static_cast<u8 *>(mmap(ptr, size, permission.Get(), MAP_SHARED | (ptr ? MAP_FIXED : 0), fd, 0));
+        guest.ptr = static_cast<u8 *>(mmap(ptr, size, permission.Get(), MAP_SHARED | (ptr ? MAP_FIXED : 0), fd, fdOffset));
         if (guest.ptr == MAP_FAILED)
             throw exception("An error occurred while mapping shared memory in guest: {}", strerror(errno));
         guest.size = size;
@@ -56,8 +74,12 @@ namespace skyline::kernel::type {
         if (guest.ptr != ptr && guest.size != size)
             throw exception("Unmapping KSharedMemory partially is not supported: Requested Unmap: 0x{:X} - 0x{:X} (0x{:X}), Current Mapping: 0x{:X} - 0x{:X} (0x{:X})", ptr, ptr + size, size, guest.ptr, guest.ptr + guest.size, guest.size);
 
-        if (mmap(ptr, size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED, 0, 0) == MAP_FAILED)
-            throw exception("An error occurred while unmapping shared memory in guest: {}", strerror(errno));
+        if (objectType != KType::KTransferMemory) {
+            state.process->memory.RestoreBacking(ptr, size);
+        } else if (mprotect(ptr, size, PROT_NONE) < 0) {
+            // The pages of transfer memory belong to the guest memory it was created from, they must be retained
+            throw exception("An error occurred while unmapping transfer memory in guest: {}", strerror(errno));
+        }
 
         guest = {};
         state.process->memory.InsertChunk(ChunkDescriptor{
@@ -91,7 +113,11 @@ namespace skyline::kernel::type {
     KSharedMemory::~KSharedMemory() {
         if (state.process && guest.Valid()) {
             if (objectType != KType::KTransferMemory) {
-                mmap(guest.ptr, guest.size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0); // It doesn't particularly matter if this fails as it shouldn't really affect anything
+                try {
+                    state.process->memory.RestoreBacking(guest.ptr, guest.size);
+                } catch (const std::exception &e) {
+                    Logger::Warn("{}", e.what()); // It doesn't particularly matter if this fails as it shouldn't really affect anything
+                }
                 state.process->memory.InsertChunk(ChunkDescriptor{
                     .ptr = guest.ptr,
                     .size = guest.size,
@@ -101,12 +127,9 @@ namespace skyline::kernel::type {
                 // KTransferMemory remaps the region with R/W permissions during destruction
                 constexpr memory::Permission UnborrowPermission{true, true, false};
 
-                if (mmap(guest.ptr, guest.size, UnborrowPermission.Get(), MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED, -1, 0) == MAP_FAILED)
-                    Logger::Warn("An error occurred while remapping transfer memory as anonymous memory in guest: {}", strerror(errno));
-                else if (!host.Valid())
-                    Logger::Warn("Expected host mapping of transfer memory to be valid during KTransferMemory destruction");
-
-                std::memcpy(guest.ptr, host.ptr, host.size);
+                // The guest mapping is backed by the same pages as the host mirror so any writes from the host are already visible
+                if (mprotect(guest.ptr, guest.size, UnborrowPermission.Get()) < 0)
+                    Logger::Warn("An error occurred while reprotecting transfer memory in guest: {}", strerror(errno));
 
                 state.process->memory.InsertChunk(ChunkDescriptor{
                     .ptr = guest.ptr,
@@ -123,6 +146,9 @@ namespace skyline::kernel::type {
         if (host.Valid())
             munmap(host.ptr, host.size);
 
-        close(fd);
+        if (objectType != KType::KTransferMemory) {
+            close(fd);
+            MemoryAccounting::Update(MemoryAccounting::Category::SharedMemory, -static_cast<i64>(host.size));
+        }
     }
 }
@@ -11,7 +11,8 @@ namespace skyline::kernel::type {
      */
     class KSharedMemory : public KMemory {
       private:
-        int fd; //!< A file descriptor to the underlying shared memory
+        int fd; //!< A file descriptor to the underlying shared memory, this is the guest memory backing for transfer memory and isn't owned by the object in that case
+        off_t fdOffset{}; //!< The offset of the underlying shared memory in the file descriptor
         memory::MemoryState memoryState; //!< The state of the memory as supplied initially, this is retained for any mappings
 
       public:
@@ -24,6 +25,14 @@ namespace skyline::kernel::type {
             }
         } host, guest{}; //!< We keep two mirrors of the underlying shared memory for guest access and host access, the host mirror is persistently mapped and should be used by anything accessing the memory on the host
 
+      protected:
+        /**
+         * @brief Creates a host mirror of existing guest memory rather than allocating new memory, both mirrors are backed by the same pages so no copies are required in either direction
+         * @note 'ptr' needs to be in guest-reserved address space
+         */
+        KSharedMemory(const DeviceState &state, u8 *ptr, size_t size, memory::MemoryState memState, KType type);
+
+      public:
         KSharedMemory(const DeviceState &state, size_t size, memory::MemoryState memState = memory::states::SharedMemory, KType type = KType::KSharedMemory);
 
         /**
@@ -8,21 +8,19 @@ namespace skyline::kernel::type {
     void KSyncObject::Signal() {
         std::lock_guard lock(syncObjectMutex);
         signalled = true;
+        boost::container::small_vector<std::shared_ptr<KThread>, 4> wokenWaiters;
         for (auto &waiter : syncObjectWaiters) {
-            if (waiter->isCancellable) {
-                waiter->isCancellable = false;
+            // Only a single object (or a cancellation) can claim the wake token of a waiter, this ensures it's only woken once even if it waits on multiple objects
+            if (waiter->isCancellable.exchange(false)) {
                 waiter->wakeObject = this;
-                state.scheduler->InsertThread(waiter);
+                wokenWaiters.push_back(waiter);
             }
         }
+
+        state.scheduler->InsertThreads(span(wokenWaiters.data(), wokenWaiters.size()));
     }
 
     bool KSyncObject::ResetSignal() {
-        std::lock_guard lock(syncObjectMutex);
-        if (signalled) [[likely]] {
-            signalled = false;
-            return true;
-        }
-        return false;
+        return signalled.exchange(false);
     }
 }
@@ -12,9 +12,9 @@ namespace skyline::kernel::type {
      */
     class KSyncObject : public KObject {
       public:
-        inline static std::mutex syncObjectMutex; //!< A global lock used for locking all signalling to avoid races
+        std::mutex syncObjectMutex; //!< Synchronizes all operations on syncObjectWaiters, waits on multiple objects only ever hold one of these at a time as a waiter is woken by atomically claiming its KThread::isCancellable token
         std::list<std::shared_ptr<KThread>> syncObjectWaiters; //!< A list of threads waiting on this object to be signalled
-        bool signalled; //!< If the current object is signalled (An object stays signalled till the signal has been explicitly reset)
+        std::atomic<bool> signalled; //!< If the current object is signalled (An object stays signalled till the signal has been explicitly reset)
 
         /**
          * @param presignalled If this object should be signalled initially or not
@@ -5,12 +5,76 @@
 #include <unistd.h>
 #include <common/signal.h>
 #include <common/trace.h>
+#include <common/host_affinity.h>
+#include <common/performance_hint.h>
+#include <common/guest_profiler.h>
 #include <nce.h>
 #include <os.h>
 #include "KProcess.h"
 #include "KThread.h"
 
 namespace skyline::kernel::type {
+    namespace {
+        /**
+         * @brief A pool of host threads which guest threads are run on, this avoids mapping a new host stack and creating a new host thread for every guest thread
+         * @note Idle threads exit after a timeout so the pool doesn't outlive a burst of guest threads by much
+         */
+        class HostThreadPool {
+          private:
+            static constexpr std::chrono::seconds IdleTimeout{10}; //!< The duration a host thread waits for a job before exiting
+
+            std::mutex mutex;
+            std::condition_variable condition; //!< Signalled on a job being pushed into the queue
+            std::vector<std::function<void()>> jobs;
+            size_t idleThreads{}; //!< The amount of host threads waiting on a job
+
+            void Run() {
+                pthread_setname_np(pthread_self(), "HostThreadPool");
+
+                // Guest threads may block signals on their way out, this mask is restored prior to each job so they don't leak into the next one
+                sigset_t signalMask;
+                signal::Sigprocmask(SIG_BLOCK, {}, &signalMask);
+
+                std::unique_lock lock(mutex);
+                while (true) {
+                    idleThreads++;
+                    bool hasJob{condition.wait_for(lock, IdleTimeout, [this]() { return !jobs.empty(); })};
+                    idleThreads--;
+                    if (!hasJob)
+                        return;
+
+                    auto job{std::move(jobs.back())};
+                    jobs.pop_back();
+                    lock.unlock();
+
+                    signal::Sigprocmask(SIG_SETMASK, signalMask);
+                    job();
+                    job = nullptr; // Any state held by the job must be released prior to waiting for the next one
+
+                    lock.lock();
+                }
+            }
+
+          public:
+            /**
+             * @brief Runs the supplied job on an idle host thread or a new one if there are none
+             */
+            void Submit(std::function<void()> &&job) {
+                std::lock_guard lock(mutex);
+                jobs.push_back(std::move(job));
+                if (idleThreads >= jobs.size())
+                    condition.notify_one();
+                else
+                    std::thread(&HostThreadPool::Run, this).detach();
+            }
+        };
+
+        HostThreadPool &GetHostThreadPool() {
+            static auto *pool{new HostThreadPool()}; // The pool is intentionally leaked as detached threads may still be waiting on it during static destruction
+            return *pool;
+        }
+    }
+
     KThread::KThread(const DeviceState &state, KHandle handle, KProcess *parent, size_t id, void *entry, u64 argument, void *stackTop, i8 priority, u8 idealCore)
         : handle(handle),
           parent(parent),
@@ -28,10 +92,9 @@ namespace skyline::kernel::type {
 
     KThread::~KThread() {
         Kill(true);
-        if (thread.joinable())
-            thread.join();
         if (preemptionTimer)
             timer_delete(preemptionTimer);
+        trace::GuestProfiler::UnregisterCurrentThread(profilerTimer);
     }
 
     void KThread::StartThread() {
@@ -39,17 +102,26 @@ namespace skyline::kernel::type {
         pthread_getname_np(pthread, threadName.data(), threadName.size());
         pthread_setname_np(pthread, fmt::format("HOS-{}", id).c_str());
         Logger::UpdateTag();
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Emulation);
 
         if (!ctx.tpidrroEl0)
             ctx.tpidrroEl0 = parent->AllocateTlsSlot();
 
         ctx.state = &state;
+        ctx.threadId = id;
+        ctx.counterScale = nce::NCE::GetCounterRescale().scale;
         state.ctx = &ctx;
         state.thread = shared_from_this();
 
         if (setjmp(originalCtx)) { // Returns 1 if it's returning from guest, 0 otherwise
+            PerformanceHint::UnregisterCurrentThread();
+            trace::GuestProfiler::UnregisterCurrentThread(profilerTimer); // The host thread may be reused for another guest thread, it must not keep being sampled
             state.scheduler->RemoveThread();
 
+            // The TLS slot is released prior to the thread being marked as stopped as the process may be destroyed after that
+            parent->FreeTlsSlot(ctx.tpidrroEl0);
+            ctx.tpidrroEl0 = nullptr;
+
             {
                 std::lock_guard lock(statusMutex);
                 running = false;
@@ -75,6 +147,10 @@ namespace skyline::kernel::type {
         if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &preemptionTimer))
             throw exception("timer_create has failed with '{}'", strerror(errno));
 
+        PerformanceHint::RegisterCurrentThread(); // This is done after any early failures as the thread is only unregistered on returning from the guest
+        if (trace::GuestProfiler::IsActive())
+            trace::GuestProfiler::RegisterCurrentThread(profilerTimer);
+
         signal::SetSignalHandler({SIGINT, SIGILL, SIGTRAP, SIGBUS, SIGFPE, SIGSEGV}, nce::NCE::SignalHandler);
         signal::SetSignalHandler({Scheduler::YieldSignal, Scheduler::PreemptionSignal}, Scheduler::SignalHandler, false); // We want futexes to fail and their predicates rechecked
 
@@ -214,8 +290,14 @@ namespace skyline::kernel::type {
                 lock.unlock();
                 StartThread();
             } else {
-                thread = std::thread(&KThread::StartThread, this);
-                pthread = thread.native_handle();
+                GetHostThreadPool().Submit([thread = shared_from_this()]() {
+                    thread->pthread = pthread_self();
+                    thread->StartThread();
+
+                    // The host thread is reused for other guest threads so any references to this one have to be dropped
+                    DeviceState::thread = nullptr;
+                    DeviceState::ctx = nullptr;
+                });
             }
         }
     }
@@ -267,35 +349,42 @@ namespace skyline::kernel::type {
         }
     }
 
+    bool KThread::RecalculatePriority() {
+        i8 newPriority{basePriority.load()};
+        if (!waiters.empty())
+            newPriority = std::min(newPriority, waiters.front()->priority.load());
+        return priority.exchange(newPriority) != newPriority;
+    }
+
     void KThread::UpdatePriorityInheritance() {
-        auto waitingOn{waitThread};
-        i8 currentPriority{priority.load()};
-        while (waitingOn) {
-            i8 ownerPriority;
-            do {
-                // Try to CAS the priority of the owner with the current thread
-                // If the new priority is equivalent to the current priority then we don't need to CAS
-                ownerPriority = waitingOn->priority.load();
-                if (ownerPriority <= currentPriority)
-                    return;
-            } while (waitingOn->priority.compare_exchange_strong(ownerPriority, currentPriority));
-
-            if (ownerPriority != currentPriority) {
-                std::lock_guard waiterLock(waitingOn->waiterMutex);
-                auto nextThread{waitingOn->waitThread};
-                if (nextThread) {
-                    // We need to update the location of the owner thread in the waiter queue of the thread it's waiting on
-                    std::lock_guard nextWaiterLock(nextThread->waiterMutex);
-                    auto &piWaiters{nextThread->waiters};
-                    piWaiters.erase(std::find(piWaiters.begin(), piWaiters.end(), waitingOn));
-                    piWaiters.insert(std::upper_bound(piWaiters.begin(), piWaiters.end(), currentPriority, KThread::IsHigherPriority), waitingOn);
-                    break;
-                }
-                state.scheduler->UpdatePriority(waitingOn);
-                waitingOn = nextThread;
-            } else {
-                break;
+        auto waiter{shared_from_this()};
+        while (true) {
+            std::shared_ptr<KThread> owner;
+            {
+                std::lock_guard lock(waiter->waiterMutex);
+                owner = waiter->waitThread;
             }
+            if (!owner)
+                return;
+
+            {
+                std::lock_guard ownerLock(owner->waiterMutex);
+
+                // The waiter needs to be repositioned in the owner's waiters as its priority may have changed since it was inserted
+                auto &ownerWaiters{owner->waiters};
+                auto it{std::find(ownerWaiters.begin(), ownerWaiters.end(), waiter)};
+                if (it == ownerWaiters.end())
+                    return; // The waiter was handed ownership or moved to another owner concurrently, the unlocking thread recalculates priorities in that case
+                ownerWaiters.erase(it);
+                ownerWaiters.insert(std::upper_bound(ownerWaiters.begin(), ownerWaiters.end(), waiter->priority.load(), KThread::IsHigherPriority), waiter);
+
+                if (!owner->RecalculatePriority())
+                    return; // The rest of the chain is unaffected if the owner's priority didn't change
+            }
+
+            // The owner may be scheduled behind lower priority threads on its core, this moves it ahead of them
+            state.scheduler->UpdatePriority(owner);
+            waiter = owner;
         }
     }
 }
@@ -19,13 +19,13 @@ namespace skyline {
         class KThread : public KSyncObject, public std::enable_shared_from_this<KThread> {
           private:
             KProcess *parent;
-            std::thread thread; //!< If this KThread is backed by a host thread then this'll hold it
-            pthread_t pthread{}; //!< The pthread_t for the host thread running this guest thread
+            pthread_t pthread{}; //!< The pthread_t for the host thread running this guest thread, this is a pooled host thread unless the thread was started on the calling thread
             timer_t preemptionTimer{}; //!< A kernel timer used for preemption interrupts
+            timer_t profilerTimer{}; //!< A kernel timer used for sampling the thread by the guest profiler, this is only created while profiling
 
             /**
              * @brief Entry function any guest threads, sets up necessary context and jumps into guest code from the calling thread
-             * @note This function also serves as the entry point for host threads created in StartThread
+             * @note This function also serves as the entry point for pooled host threads dispatched by Start
              */
             void StartThread();
 
@@ -47,6 +47,7 @@ namespace skyline {
             void *stackTop; //!< The top of the guest's stack, this is set to the initial guest stack pointer
 
             std::condition_variable scheduleCondition; //!< Signalled to wake the thread when it's scheduled or its resident core changes
+            RunQueue::Node runQueueNode; //!< The state of this thread in its resident core's queue or the parked queue, it can only be in one of them at a time
             std::atomic<i8> basePriority; //!< The priority of the thread for the scheduler without any priority-inheritance
             std::atomic<i8> priority; //!< The priority of the thread for the scheduler including priority-inheritance
 
@@ -68,8 +69,8 @@ namespace skyline {
             std::shared_ptr<KThread> waitThread; //!< The thread which this thread is waiting on
             std::list<std::shared_ptr<type::KThread>> waiters; //!< A queue of threads waiting on this thread sorted by priority
 
-            bool isCancellable{false}; //!< If the thread is currently in a position where it's cancellable
-            bool cancelSync{false}; //!< Whether to cancel the SvcWaitSynchronization call this thread currently is in/the next one it joins
+            std::atomic<bool> isCancellable{false}; //!< If the thread is currently in a position where it's cancellable, this is the wake token of SvcWaitSynchronization that's claimed by whoever wakes the thread
+            std::atomic<bool> cancelSync{false}; //!< Whether to cancel the SvcWaitSynchronization call this thread currently is in/the next one it joins
             type::KSyncObject *wakeObject{}; //!< A pointer to the synchronization object responsible for waking this thread up
 
             KThread(const DeviceState &state, KHandle handle, KProcess *parent, size_t id, void *entry, u64 argument, void *stackTop, i8 priority, u8 idealCore);
@@ -77,7 +78,7 @@ namespace skyline {
             ~KThread();
 
             /**
-             * @param self If the calling thread should jump directly into guest code or if a new thread should be created for it
+             * @param self If the calling thread should jump directly into guest code or if it should be run on a pooled host thread
              * @note If the thread is already running then this does nothing
              * @note 'stack' will be created if it wasn't set prior to calling this
              */
@@ -104,7 +105,14 @@ namespace skyline {
             void DisarmPreemptionTimer();
 
             /**
-             * @brief Recursively updates the priority for any threads this thread might be waiting on
+             * @brief Sets the priority of this thread to the higher of its base priority and the priority of its highest priority waiter
+             * @return If the priority of the thread changed, the scheduler needs to be updated if so
+             * @note The waiter mutex of this thread must be locked by the calling thread
+             */
+            bool RecalculatePriority();
+
+            /**
+             * @brief Propagates the priority of this thread along the chain of threads it's waiting on, updating the scheduler for every owner whose priority changes
              * @note PI is performed by temporarily upgrading a thread's priority if a thread waiting on it has a higher priority to prevent priority inversion
              */
             void UpdatePriorityInheritance();
@@ -16,8 +16,7 @@ namespace skyline::kernel::type {
          * @note 'ptr' needs to be in guest-reserved address space
          */
         KTransferMemory(const DeviceState &state, u8 *ptr, size_t size, memory::Permission permission, memory::MemoryState memState = memory::states::TransferMemory)
-            : KSharedMemory(state, size, memState, KType::KTransferMemory) {
-            std::memcpy(host.ptr, ptr, size);
+            : KSharedMemory(state, ptr, size, memState, KType::KTransferMemory) {
             Map(ptr, size, permission);
         }
     };
@@ -3,7 +3,7 @@
 
 #pragma once
 
-#include <common.h>
+#include <nce/patch_cache.h>
 
 namespace skyline::loader {
     /**
@@ -14,8 +14,17 @@ namespace skyline::loader {
          * @brief The contents and offset of an executable segment
          */
         struct Segment {
-            std::vector<u8> contents; //!< The raw contents of the segment
+            std::vector<u8> contents; //!< The raw contents of the segment, this is unused if the segment has a reader
             size_t offset; //!< The offset from the base address to load the segment at
+            std::function<void(span<u8>)> reader; //!< An optional function which writes the contents of the segment directly into guest memory during loading, this avoids staging segments which don't need to be inspected prior to loading
+            size_t readerSize{}; //!< The size of the segment in memory when it has a reader, any memory past the contents written by the reader is zero
+
+            /**
+             * @return The size of the segment in memory
+             */
+            size_t Size() const {
+                return reader ? readerSize : contents.size();
+            }
         };
 
         Segment text; //!< The .text segment container
@@ -30,5 +39,10 @@ namespace skyline::loader {
 
         RelativeSegment dynsym; //!< The .dynsym segment relative to .rodata
         RelativeSegment dynstr; //!< The .dynstr segment relative to .rodata
+
+        std::array<u64, 4> buildId{}; //!< The build ID of the executable, this is zero if the executable doesn't have one
+
+        std::optional<nce::PatchCache::Entry> cachedPatch; //!< The patch data from the patch cache, this and patch are resolved by Loader::PrepareExecutable
+        std::optional<nce::NCE::PatchData> patch; //!< The patch data from scanning .text, this is only set if it wasn't cached
     };
 }
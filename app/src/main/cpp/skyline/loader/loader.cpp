@@ -4,18 +4,26 @@
 #include <dlfcn.h>
 #include <cxxabi.h>
 #include <nce.h>
+#include <nce/patch_cache.h>
 #include <os.h>
 #include <kernel/types/KProcess.h>
 #include <kernel/memory.h>
 #include "loader.h"
 
 namespace skyline::loader {
+    void Loader::PrepareExecutable(const DeviceState &state, Executable &executable) {
+        nce::PatchCache patchCache{state.os->appFilesPath + "nce_cache/"};
+        executable.cachedPatch = patchCache.Lookup(executable.buildId, executable.text.contents);
+        if (!executable.cachedPatch)
+            executable.patch = state.nce->GetPatchData(executable.text.contents);
+    }
+
     Loader::ExecutableLoadInfo Loader::LoadExecutable(const std::shared_ptr<kernel::type::KProcess> &process, const DeviceState &state, Executable &executable, size_t offset, const std::string &name) {
         u8 *base{reinterpret_cast<u8 *>(process->memory.base.address + offset)};
 
         u64 textSize{executable.text.contents.size()};
-        u64 roSize{executable.ro.contents.size()};
-        u64 dataSize{executable.data.contents.size() + executable.bssSize};
+        u64 roSize{executable.ro.Size()};
+        u64 dataSize{executable.data.Size() + executable.bssSize};
 
         if (!util::IsPageAligned(textSize) || !util::IsPageAligned(roSize) || !util::IsPageAligned(dataSize))
             throw exception("LoadProcessData: Sections are not aligned with page size: 0x{:X}, 0x{:X}, 0x{:X}", textSize, roSize, dataSize);
@@ -23,7 +31,12 @@ namespace skyline::loader {
         if (!util::IsPageAligned(executable.text.offset) || !util::IsPageAligned(executable.ro.offset) || !util::IsPageAligned(executable.data.offset))
             throw exception("LoadProcessData: Section offsets are not aligned with page size: 0x{:X}, 0x{:X}, 0x{:X}", executable.text.offset, executable.ro.offset, executable.data.offset);
 
-        auto patch{state.nce->GetPatchData(executable.text.contents)};
+        if (!executable.cachedPatch && !executable.patch)
+            PrepareExecutable(state, executable);
+
+        nce::PatchCache patchCache{state.os->appFilesPath + "nce_cache/"};
+        auto &cachedPatch{executable.cachedPatch};
+        const auto &patch{cachedPatch ? cachedPatch->patch : *executable.patch};
         auto size{patch.size + textSize + roSize + dataSize};
 
         process->NewHandle<kernel::type::KPrivateMemory>(base, patch.size, memory::Permission{false, false, false}, memory::states::Reserved); // ---
@@ -38,10 +51,40 @@ namespace skyline::loader {
         process->NewHandle<kernel::type::KPrivateMemory>(base + patch.size + executable.data.offset, dataSize, memory::Permission{true, true, false}, memory::states::CodeMutable); // RW-
         Logger::Debug("Successfully mapped section .data + .bss @ 0x{:X}, Size = 0x{:X}", base + patch.size + executable.data.offset, dataSize);
 
-        state.nce->PatchCode(executable.text.contents, reinterpret_cast<u32 *>(base), patch.size, patch.offsets);
+        // Segments with readers are written directly into guest memory, this is done concurrently with patching .text as they're independent
+        std::exception_ptr readerException;
+        std::thread readerThread;
+        if (executable.ro.reader || executable.data.reader) {
+            readerThread = std::thread([&]() {
+                try {
+                    if (executable.ro.reader)
+                        executable.ro.reader(span(base + patch.size + executable.ro.offset, roSize));
+                    if (executable.data.reader)
+                        executable.data.reader(span(base + patch.size + executable.data.offset, dataSize - executable.bssSize));
+                } catch (...) {
+                    readerException = std::current_exception();
+                }
+            });
+        }
+
+        if (cachedPatch) {
+            state.nce->RestorePatchedCode(executable.text.contents, reinterpret_cast<u32 *>(base), cachedPatch->section, patch.offsets, cachedPatch->instructions);
+            Logger::Debug("Restored patched code from cache for {}", name);
+        } else {
+            state.nce->PatchCode(executable.text.contents, reinterpret_cast<u32 *>(base), patch.size, patch.offsets);
+            patchCache.Store(executable.buildId, executable.text.contents, base, patch);
+        }
         std::memcpy(base + patch.size + executable.text.offset, executable.text.contents.data(), textSize);
-        std::memcpy(base + patch.size + executable.ro.offset, executable.ro.contents.data(), roSize);
-        std::memcpy(base + patch.size + executable.data.offset, executable.data.contents.data(), dataSize - executable.bssSize);
+        if (!executable.ro.reader)
+            std::memcpy(base + patch.size + executable.ro.offset, executable.ro.contents.data(), roSize);
+        if (!executable.data.reader)
+            std::memcpy(base + patch.size + executable.data.offset, executable.data.contents.data(), dataSize - executable.bssSize);
+
+        if (readerThread.joinable())
+            readerThread.join();
+        if (readerException)
+            std::rethrow_exception(readerException);
+        kernel::MemoryManager::Populate(span(base + patch.size + executable.data.offset + (dataSize - executable.bssSize), executable.bssSize)); // .bss isn't touched by the copy, we populate it so it doesn't fault in one page at a time during startup
 
         auto rodataOffset{base + patch.size + executable.ro.offset};
         ExecutableSymbolicInfo symbolicInfo{
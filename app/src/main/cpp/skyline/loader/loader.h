@@ -74,6 +74,12 @@ namespace skyline::loader {
             void *entry; //!< The entry point of the loaded executable
         };
 
+        /**
+         * @brief Resolves the patch data for an executable from the patch cache or by scanning its .text segment
+         * @note This doesn't depend on where the executable will be loaded so multiple executables can be prepared concurrently, LoadExecutable will prepare the executable if it hasn't been already
+         */
+        static void PrepareExecutable(const DeviceState &state, Executable &executable);
+
         /**
          * @brief Patches an executable and loads it into memory while setting up symbolic information
          * @param offset The offset from the base address that the executable should be placed at
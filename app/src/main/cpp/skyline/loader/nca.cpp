@@ -1,13 +1,15 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <common/thread_pool.h>
 #include <kernel/types/KProcess.h>
 #include <vfs/npdm.h>
 #include "nso.h"
 #include "nca.h"
 
 namespace skyline::loader {
-    NcaLoader::NcaLoader(std::shared_ptr<vfs::Backing> backing, std::shared_ptr<crypto::KeyStore> keyStore) : nca(std::move(backing), std::move(keyStore)) {
+    NcaLoader::NcaLoader(std::shared_ptr<vfs::Backing> backing, std::shared_ptr<crypto::KeyStore> keyStore, size_t sectorCacheSize) : nca(std::move(backing), std::move(keyStore), false, sectorCacheSize) {
+        nca.OpenSections();
         if (nca.exeFs == nullptr)
             throw exception("Only NCAs with an ExeFS can be loaded directly");
     }
@@ -19,25 +21,29 @@ namespace skyline::loader {
         if (!exeFs->FileExists("rtld"))
             throw exception("Cannot load an ExeFS that doesn't contain rtld");
 
-        auto nsoFile{exeFs->OpenFile("rtld")};
+        std::vector<std::string> names;
+        for (const auto &nso : {"rtld", "main", "subsdk0", "subsdk1", "subsdk2", "subsdk3", "subsdk4", "subsdk5", "subsdk6", "subsdk7", "sdk"})
+            if (exeFs->FileExists(nso))
+                names.emplace_back(nso);
+
+        // All NSOs are read, decompressed and scanned for patching concurrently as that doesn't depend on where they're loaded, only loading them into memory has to be done in order
+        std::vector<Executable> executables(names.size());
+        ThreadPool::Get().ParallelFor(names.size(), [&](size_t i) {
+            executables[i] = NsoLoader::ReadNso(exeFs->OpenFile(names[i]), state);
+        });
 
         state.process->memory.InitializeVmm(process->npdm.meta.flags.type);
 
-        auto loadInfo{NsoLoader::LoadNso(loader, nsoFile, process, state, 0, "rtld.nso")};
+        auto loadInfo{loader->LoadExecutable(process, state, executables.front(), 0, "rtld.nso")};
         u64 offset{loadInfo.size};
         u8 *base{loadInfo.base};
         void *entry{loadInfo.entry};
 
         Logger::Info("Loaded 'rtld.nso' at 0x{:X} (.text @ 0x{:X})", base, entry);
 
-        for (const auto &nso : {"main", "subsdk0", "subsdk1", "subsdk2", "subsdk3", "subsdk4", "subsdk5", "subsdk6", "subsdk7", "sdk"}) {
-            if (exeFs->FileExists(nso))
-                nsoFile = exeFs->OpenFile(nso);
-            else
-                continue;
-
-            loadInfo = NsoLoader::LoadNso(loader, nsoFile, process, state, offset, nso + std::string(".nso"));
-            Logger::Info("Loaded '{}.nso' at 0x{:X} (.text @ 0x{:X})", nso, base + offset, loadInfo.entry);
+        for (size_t i{1}; i < names.size(); i++) {
+            loadInfo = loader->LoadExecutable(process, state, executables[i], offset, names[i] + ".nso");
+            Logger::Info("Loaded '{}.nso' at 0x{:X} (.text @ 0x{:X})", names[i], base + offset, loadInfo.entry);
             offset += loadInfo.size;
         }
 
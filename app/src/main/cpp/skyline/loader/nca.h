@@ -16,7 +16,10 @@ namespace skyline::loader {
         vfs::NCA nca; //!< The backing NCA of the loader
 
       public:
-        NcaLoader(std::shared_ptr<vfs::Backing> backing, std::shared_ptr<crypto::KeyStore> keyStore);
+        /**
+         * @param sectorCacheSize The size of the cache of decrypted NCA sections in bytes, caching is disabled if this is 0
+         */
+        NcaLoader(std::shared_ptr<vfs::Backing> backing, std::shared_ptr<crypto::KeyStore> keyStore, size_t sectorCacheSize = 0);
 
         /**
          * @brief Loads an ExeFS into memory and processes it accordingly for execution
@@ -14,22 +14,28 @@ namespace skyline::loader {
             throw exception("Invalid NSO magic! 0x{0:X}", magic);
     }
 
-    std::vector<u8> NsoLoader::GetSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize) {
-        std::vector<u8> outputBuffer(segment.decompressedSize);
+    void NsoLoader::ReadSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize, span<u8> output) {
+        output = output.first(segment.decompressedSize);
 
         if (compressedSize) {
-            std::vector<u8> compressedBuffer(compressedSize);
-            backing->Read(compressedBuffer, segment.fileOffset);
-
-            LZ4_decompress_safe(reinterpret_cast<char *>(compressedBuffer.data()), reinterpret_cast<char *>(outputBuffer.data()), static_cast<int>(compressedSize), static_cast<int>(segment.decompressedSize));
+            // The compressed data is decompressed directly out of the backing when it's in memory
+            std::vector<u8> compressedBuffer;
+            auto compressed{backing->ReadView(segment.fileOffset, compressedSize)};
+            if (compressed.empty()) {
+                compressedBuffer.resize(compressedSize);
+                backing->Read(compressedBuffer, segment.fileOffset);
+                compressed = compressedBuffer;
+            }
+
+            auto decompressedSize{LZ4_decompress_safe(reinterpret_cast<const char *>(compressed.data()), reinterpret_cast<char *>(output.data()), static_cast<int>(compressedSize), static_cast<int>(segment.decompressedSize))};
+            if (decompressedSize != static_cast<int>(segment.decompressedSize))
+                throw exception("Failed to decompress NSO segment: {}/{}", decompressedSize, segment.decompressedSize);
         } else {
-            backing->Read(outputBuffer, segment.fileOffset);
+            backing->Read(output, segment.fileOffset);
         }
-
-        return outputBuffer;
     }
 
-    Loader::ExecutableLoadInfo NsoLoader::LoadNso(Loader *loader, const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<kernel::type::KProcess> &process, const DeviceState &state, size_t offset, const std::string &name) {
+    Executable NsoLoader::ReadNso(const std::shared_ptr<vfs::Backing> &backing, const DeviceState &state) {
         auto header{backing->Read<NsoHeader>()};
 
         if (header.magic != util::MakeMagic<u32>("NSO0"))
@@ -37,25 +43,37 @@ namespace skyline::loader {
 
         Executable executable{};
 
-        executable.text.contents = GetSegment(backing, header.text, header.flags.textCompressed ? header.textCompressedSize : 0);
-        executable.text.contents.resize(util::AlignUp(executable.text.contents.size(), PAGE_SIZE));
+        executable.text.contents.resize(util::AlignUp(header.text.decompressedSize, PAGE_SIZE));
+        ReadSegment(backing, header.text, header.flags.textCompressed ? header.textCompressedSize : 0, executable.text.contents);
         executable.text.offset = header.text.memoryOffset;
+        executable.buildId = header.buildId;
+        Loader::PrepareExecutable(state, executable);
 
-        executable.ro.contents = GetSegment(backing, header.ro, header.flags.roCompressed ? header.roCompressedSize : 0);
-        executable.ro.contents.resize(util::AlignUp(executable.ro.contents.size(), PAGE_SIZE));
+        executable.ro.reader = [backing, segment = header.ro, compressedSize = header.flags.roCompressed ? header.roCompressedSize : 0](span<u8> output) {
+            ReadSegment(backing, segment, compressedSize, output);
+        };
+        executable.ro.readerSize = util::AlignUp(header.ro.decompressedSize, PAGE_SIZE);
         executable.ro.offset = header.ro.memoryOffset;
 
-        executable.data.contents = GetSegment(backing, header.data, header.flags.dataCompressed ? header.dataCompressedSize : 0);
+        executable.data.reader = [backing, segment = header.data, compressedSize = header.flags.dataCompressed ? header.dataCompressedSize : 0](span<u8> output) {
+            ReadSegment(backing, segment, compressedSize, output);
+        };
+        executable.data.readerSize = header.data.decompressedSize;
         executable.data.offset = header.data.memoryOffset;
 
         // Data and BSS are aligned together
-        executable.bssSize = util::AlignUp(executable.data.contents.size() + header.bssSize, PAGE_SIZE) - executable.data.contents.size();
+        executable.bssSize = util::AlignUp(executable.data.readerSize + header.bssSize, PAGE_SIZE) - executable.data.readerSize;
 
         if (header.dynsym.offset + header.dynsym.size <= header.ro.decompressedSize && header.dynstr.offset + header.dynstr.size <= header.ro.decompressedSize) {
             executable.dynsym = {header.dynsym.offset, header.dynsym.size};
             executable.dynstr = {header.dynstr.offset, header.dynstr.size};
         }
 
+        return executable;
+    }
+
+    Loader::ExecutableLoadInfo NsoLoader::LoadNso(Loader *loader, const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<kernel::type::KProcess> &process, const DeviceState &state, size_t offset, const std::string &name) {
+        auto executable{ReadNso(backing, state)};
         return loader->LoadExecutable(process, state, executable, offset, name);
     }
 
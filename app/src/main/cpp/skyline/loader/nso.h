@@ -73,13 +73,20 @@ namespace skyline::loader {
          * @brief Reads the specified segment from the backing and decompresses it if needed
          * @param segment The header of the segment to read
          * @param compressedSize The compressed size of the segment, 0 if the segment is not compressed
-         * @return A buffer containing the data of the requested segment
+         * @param output The buffer to write the segment into, this must be at least as large as the decompressed segment
          */
-        static std::vector<u8> GetSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize);
+        static void ReadSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize, span<u8> output);
 
       public:
         NsoLoader(std::shared_ptr<vfs::Backing> backing);
 
+        /**
+         * @brief Reads an NSO and prepares it for being loaded, only .text is decompressed as it needs to be scanned for instructions to patch while .rodata and .data are decompressed directly into guest memory while loading
+         * @param backing The backing that the NSO is contained within
+         * @note This doesn't depend on where the NSO will be loaded so multiple NSOs can be read concurrently
+         */
+        static Executable ReadNso(const std::shared_ptr<vfs::Backing> &backing, const DeviceState &state);
+
         /**
          * @brief Loads an NSO into memory, offset by the given amount
          * @param backing The backing that the NSO is contained within
@@ -22,21 +22,36 @@ namespace skyline::loader {
         }
     }
 
-    NspLoader::NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) : nsp(std::make_shared<vfs::PartitionFileSystem>(backing)) {
+    NspLoader::NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, size_t sectorCacheSize, bool metadataOnly) : nsp(std::make_shared<vfs::PartitionFileSystem>(backing)) {
         ExtractTickets(nsp, keyStore);
 
+        bool programFound{};
         auto root{nsp->OpenDirectory("", {false, true})};
         for (const auto &entry : root->Read()) {
             if (entry.name.substr(entry.name.find_last_of('.') + 1) != "nca")
                 continue;
 
             try {
-                auto nca{vfs::NCA(nsp->OpenFile(entry.name), keyStore)};
-
-                if (nca.contentType == vfs::NcaContentType::Program && nca.romFs != nullptr && nca.exeFs != nullptr)
-                    programNca = std::move(nca);
-                else if (nca.contentType == vfs::NcaContentType::Control && nca.romFs != nullptr)
-                    controlNca = std::move(nca);
+                auto nca{vfs::NCA(nsp->OpenFile(entry.name), keyStore, false, sectorCacheSize)};
+
+                // Only the header is parsed at this point, sections are opened solely for the NCAs we need
+                if (nca.contentType == vfs::NcaContentType::Program) {
+                    if (metadataOnly) {
+                        // The program sections aren't opened for metadata but their keys are validated so titles which can't be launched fail to load here
+                        nca.ValidateKeys();
+                        programFound = true;
+                    } else {
+                        nca.OpenSections();
+                        if (nca.romFs != nullptr && nca.exeFs != nullptr) {
+                            programNca = std::move(nca);
+                            programFound = true;
+                        }
+                    }
+                } else if (nca.contentType == vfs::NcaContentType::Control) {
+                    nca.OpenSections();
+                    if (nca.romFs != nullptr)
+                        controlNca = std::move(nca);
+                }
             } catch (const loader_exception &e) {
                 throw loader_exception(e.error);
             } catch (const std::exception &e) {
@@ -44,15 +59,39 @@ namespace skyline::loader {
             }
         }
 
-        if (!programNca || !controlNca)
+        if (!programFound || !controlNca)
             throw exception("Incomplete NSP file");
 
-        romFs = programNca->romFs;
+        if (programNca)
+            romFs = programNca->romFs;
         controlRomFs = std::make_shared<vfs::RomFileSystem>(controlNca->romFs);
         nacp.emplace(controlRomFs->OpenFile("control.nacp"));
     }
 
+    std::shared_ptr<vfs::Backing> NspLoader::CreateDecryptedView(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) {
+        auto nsp{std::make_shared<vfs::PartitionFileSystem>(backing)};
+        ExtractTickets(nsp, keyStore);
+
+        std::vector<vfs::OverlayBacking::Overlay> overlays;
+        auto root{nsp->OpenDirectory("", {false, true})};
+        for (const auto &entry : root->Read()) {
+            if (entry.name.substr(entry.name.find_last_of('.') + 1) != "nca")
+                continue;
+
+            size_t ncaOffset{nsp->GetFileOffset(entry.name)};
+            for (auto &overlay : vfs::NCA(nsp->OpenFile(entry.name), keyStore).GetDecryptedOverlays()) {
+                overlay.offset += ncaOffset;
+                overlays.push_back(std::move(overlay));
+            }
+        }
+
+        return std::make_shared<vfs::OverlayBacking>(backing, std::move(overlays));
+    }
+
     void *NspLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> &process, const DeviceState &state) {
+        if (!programNca)
+            throw exception("Cannot load an NSP which was only opened for its metadata");
+
         process->npdm = vfs::NPDM(programNca->exeFs->OpenFile("main.npdm"));
         return NcaLoader::LoadExeFs(this, programNca->exeFs, process, state);
     }
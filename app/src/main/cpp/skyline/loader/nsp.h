@@ -22,7 +22,16 @@ namespace skyline::loader {
         std::optional<vfs::NCA> controlNca; //!< The main control NCA within the NSP
 
       public:
-        NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+        /**
+         * @param sectorCacheSize The size of the cache of decrypted NCA sections in bytes, caching is disabled if this is 0
+         * @param metadataOnly If only the control NCA should be opened for the NACP and icon, the resulting loader can't load the application but the presence of the program NCA and its keys is still validated
+         */
+        NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, size_t sectorCacheSize = 0, bool metadataOnly = false);
+
+        /**
+         * @brief Creates a view of an NSP with the headers and sections of all NCAs in it decrypted, this view is loaded without any keys and compresses far better than the original
+         */
+        static std::shared_ptr<vfs::Backing> CreateDecryptedView(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
 
         std::vector<u8> GetIcon(language::ApplicationLanguage language) override;
 
@@ -8,7 +8,7 @@
 #include "xci.h"
 
 namespace skyline::loader {
-    XciLoader::XciLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) {
+    XciLoader::XciLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, size_t sectorCacheSize, bool metadataOnly) {
         header = backing->Read<GamecardHeader>();
 
         if (header.magic != util::MakeMagic<u32>("HEAD"))
@@ -29,6 +29,7 @@ namespace skyline::loader {
                 logo = entryDir;
         }
 
+        bool programFound{};
         if (secure) {
             root = secure->OpenDirectory("", {false, true});
             for (const auto &entry : root->Read()) {
@@ -36,12 +37,26 @@ namespace skyline::loader {
                     continue;
 
                 try {
-                    auto nca{vfs::NCA(secure->OpenFile(entry.name), keyStore, true)};
-
-                    if (nca.contentType == vfs::NcaContentType::Program && nca.romFs != nullptr && nca.exeFs != nullptr)
-                        programNca = std::move(nca);
-                    else if (nca.contentType == vfs::NcaContentType::Control && nca.romFs != nullptr)
-                        controlNca = std::move(nca);
+                    auto nca{vfs::NCA(secure->OpenFile(entry.name), keyStore, true, sectorCacheSize)};
+
+                    // Only the header is parsed at this point, sections are opened solely for the NCAs we need
+                    if (nca.contentType == vfs::NcaContentType::Program) {
+                        if (metadataOnly) {
+                            // The program sections aren't opened for metadata but their keys are validated so titles which can't be launched fail to load here
+                            nca.ValidateKeys();
+                            programFound = true;
+                        } else {
+                            nca.OpenSections();
+                            if (nca.romFs != nullptr && nca.exeFs != nullptr) {
+                                programNca = std::move(nca);
+                                programFound = true;
+                            }
+                        }
+                    } else if (nca.contentType == vfs::NcaContentType::Control) {
+                        nca.OpenSections();
+                        if (nca.romFs != nullptr)
+                            controlNca = std::move(nca);
+                    }
                 } catch (const loader_exception &e) {
                     throw loader_exception(e.error);
                 } catch (const std::exception &e) {
@@ -52,15 +67,19 @@ namespace skyline::loader {
             throw exception("Corrupted secure partition");
         }
 
-        if (!programNca || !controlNca)
+        if (!programFound || !controlNca)
             throw exception("Incomplete XCI file");
 
-        romFs = programNca->romFs;
+        if (programNca)
+            romFs = programNca->romFs;
         controlRomFs = std::make_shared<vfs::RomFileSystem>(controlNca->romFs);
         nacp.emplace(controlRomFs->OpenFile("control.nacp"));
     }
 
     void *XciLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> &process, const DeviceState &state) {
+        if (!programNca)
+            throw exception("Cannot load an XCI which was only opened for its metadata");
+
         process->npdm = vfs::NPDM(programNca->exeFs->OpenFile("main.npdm"));
         return NcaLoader::LoadExeFs(this, programNca->exeFs, process, state);
     }
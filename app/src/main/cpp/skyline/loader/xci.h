@@ -115,7 +115,11 @@ namespace skyline::loader {
         std::optional<vfs::NCA> controlNca; //!< The main control NCA within the secure partition
 
       public:
-        XciLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+        /**
+         * @param sectorCacheSize The size of the cache of decrypted NCA sections in bytes, caching is disabled if this is 0
+         * @param metadataOnly If only the control NCA should be opened for the NACP and icon, the resulting loader can't load the application but the presence of the program NCA and its keys is still validated
+         */
+        XciLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, size_t sectorCacheSize = 0, bool metadataOnly = false);
 
         std::vector<u8> GetIcon(language::ApplicationLanguage language) override;
 
@@ -5,10 +5,13 @@
 #include <unistd.h>
 #include "common/signal.h"
 #include "common/trace.h"
+#include "common/flight_recorder.h"
+#include "common/thread_pool.h"
 #include "os.h"
 #include "jvm.h"
 #include "kernel/types/KProcess.h"
 #include "kernel/svc.h"
+#include "kernel/svc_statistics.h"
 #include "nce/guest.h"
 #include "nce/instructions.h"
 #include "nce.h"
@@ -28,7 +31,11 @@ namespace skyline::nce {
         try {
             if (svc) [[likely]] {
                 TRACE_EVENT("kernel", perfetto::StaticString{svc.name});
+                trace::FlightRecorder::Record(trace::FlightRecorder::EventType::SvcEnter, svcId);
+                u64 startTicks{util::GetTimeTicks()};
                 (svc.function)(state);
+                kernel::svc::SvcStatistics::Record(svcId, startTicks, util::GetTimeTicks());
+                trace::FlightRecorder::Record(trace::FlightRecorder::EventType::SvcExit, svcId);
             } else {
                 throw exception("Unimplemented SVC 0x{:X}", svcId);
             }
@@ -152,54 +159,125 @@ namespace skyline::nce {
     constexpr u32 CntpctEl0{0x5F01};        // ID of CNTPCT_EL0 in MRS
     constexpr u32 CntvctEl0{0x5F02};        // ID of CNTVCT_EL0 in MRS
     constexpr u32 TegraX1Freq{19200000};    // The clock frequency of the Tegra X1 (19.2 MHz)
+    constexpr u8 ZeroRegister{31};          // The encoding of XZR as a destination register
+    constexpr u32 Nop{0xD503201F};          // A NOP instruction
+
+    NCE::CounterRescale NCE::GetCounterRescale() {
+        static CounterRescale rescale{[] {
+            u64 frequency;
+            asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+
+            // The shift is chosen to be the smallest which keeps the scale below 1.0 in 0.64 fixed-point, this retains the most precision
+            u8 shift{};
+            while ((frequency << shift) <= TegraX1Freq)
+                shift++;
+
+            return CounterRescale{
+                .scale = static_cast<u64>((static_cast<u128>(TegraX1Freq) << (64 - shift)) / frequency),
+                .shift = shift,
+            };
+        }()};
+        return rescale;
+    }
 
-    NCE::PatchData NCE::GetPatchData(const std::vector<u8> &text) {
-        size_t size{guest::SaveCtxSize + guest::LoadCtxSize + MainSvcTrampolineSize};
-        std::vector<size_t> offsets;
+    constexpr size_t MinimumScanChunkSize{0x40000}; //!< The minimum amount of instructions scanned by a single thread in GetPatchData
+    constexpr size_t MinimumPatchChunkSize{0x2000}; //!< The minimum amount of instructions patched by a single thread in PatchCode
+
+    /**
+     * @return The amount of chunks a range should be split into for it to be processed concurrently with ForEachChunk
+     */
+    static size_t GetChunkCount(size_t count, size_t minimumChunkSize) {
+        return std::clamp<size_t>(count / minimumChunkSize, 1, ThreadPool::Get().GetWorkerCount());
+    }
+
+    /**
+     * @brief Splits the range [0, count) into contiguous chunks which are processed concurrently on the thread pool
+     * @param function A function which is called with the index of the chunk alongside the first and last (exclusive) index in the chunk
+     * @note The calling thread processes chunks itself, a single chunk is processed without involving the pool
+     */
+    template<typename Function>
+    static void ForEachChunk(size_t count, size_t chunkCount, Function function) {
+        size_t chunkSize{(count + chunkCount - 1) / chunkCount};
+        ThreadPool::Get().ParallelFor(chunkCount, [&](size_t chunk) {
+            function(chunk, std::min(chunk * chunkSize, count), std::min((chunk + 1) * chunkSize, count));
+        });
+    }
+
+    /**
+     * @return The leaf function for an SVC alongside its size or a null function pointer if the SVC doesn't have one
+     */
+    static std::pair<void (*)(), size_t> GetLeafSvc(u32 svcId) {
+        if (svcId >= kernel::svc::SvcTable.size())
+            return {};
+        const auto &descriptor{kernel::svc::SvcTable[svcId]};
+        return {descriptor.leafFunction, descriptor.leafSize};
+    }
+
+    /**
+     * @return The size of the trampoline for an instruction in 32-bit instructions or std::nullopt if the instruction doesn't need to be patched
+     * @note Instructions which are rewritten in-place without a trampoline have a size of 0
+     */
+    static std::optional<size_t> GetTrampolineSize(const u32 *instruction, bool rescaleClock) {
+        auto svc{*reinterpret_cast<const instructions::Svc *>(instruction)};
+        auto mrs{*reinterpret_cast<const instructions::Mrs *>(instruction)};
+        auto msr{*reinterpret_cast<const instructions::Msr *>(instruction)};
+
+        if (svc.Verify()) {
+            auto [leafFunction, leafSize]{GetLeafSvc(svc.value)};
+            return 7 + (leafFunction ? leafSize + 1 : 0);
+        } else if (mrs.Verify()) {
+            if (mrs.srcReg == TpidrroEl0 || mrs.srcReg == TpidrEl0) {
+                return (mrs.destReg != ZeroRegister) ? 3 : 0;
+            } else {
+                if (rescaleClock) {
+                    if (mrs.srcReg == CntpctEl0)
+                        return (mrs.destReg != ZeroRegister) ? (NCE::GetCounterRescale().shift ? 8 : 7) : 0;
+                    else if (mrs.srcReg == CntfrqEl0)
+                        return 3;
+                } else if (mrs.srcReg == CntpctEl0) {
+                    return 0;
+                }
+            }
+        } else if (msr.Verify() && msr.destReg == TpidrEl0) {
+            return 6;
+        }
+        return std::nullopt;
+    }
 
+    NCE::PatchData NCE::GetPatchData(const std::vector<u8> &text) {
         u64 frequency;
         asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
         bool rescaleClock{frequency != TegraX1Freq};
 
-        auto start{reinterpret_cast<const u32 *>(text.data())}, end{reinterpret_cast<const u32 *>(text.data() + text.size())};
-        for (const u32 *instruction{start}; instruction < end; instruction++) {
-            auto svc{*reinterpret_cast<const instructions::Svc *>(instruction)};
-            auto mrs{*reinterpret_cast<const instructions::Mrs *>(instruction)};
-            auto msr{*reinterpret_cast<const instructions::Msr *>(instruction)};
-            auto instructionOffset{static_cast<size_t>(instruction - start)};
-
-            if (svc.Verify()) {
-                size += 7;
-                offsets.push_back(instructionOffset);
-            } else if (mrs.Verify()) {
-                if (mrs.srcReg == TpidrroEl0 || mrs.srcReg == TpidrEl0) {
-                    size += ((mrs.destReg != registers::X0) ? 6 : 3);
-                    offsets.push_back(instructionOffset);
-                } else {
-                    if (rescaleClock) {
-                        if (mrs.srcReg == CntpctEl0) {
-                            size += guest::RescaleClockSize + 3;
-                            offsets.push_back(instructionOffset);
-                        } else if (mrs.srcReg == CntfrqEl0) {
-                            size += 3;
-                            offsets.push_back(instructionOffset);
-                        }
-                    } else if (mrs.srcReg == CntpctEl0) {
-                        offsets.push_back(instructionOffset);
-                    }
+        // The scan is split into chunks which are processed concurrently, the offsets of each chunk are sorted and chunks are contiguous so they can just be concatenated
+        auto start{reinterpret_cast<const u32 *>(text.data())};
+        size_t count{text.size() / sizeof(u32)}, chunkCount{GetChunkCount(count, MinimumScanChunkSize)};
+        std::vector<PatchData> chunks(chunkCount);
+        ForEachChunk(count, chunkCount, [&](size_t chunk, size_t first, size_t last) {
+            auto &data{chunks[chunk]};
+            for (size_t offset{first}; offset < last; offset++) {
+                if (auto trampolineSize{GetTrampolineSize(start + offset, rescaleClock)}) {
+                    data.size += *trampolineSize;
+                    data.offsets.push_back(offset);
                 }
-            } else if (msr.Verify() && msr.destReg == TpidrEl0) {
-                size += 6;
-                offsets.push_back(instructionOffset);
             }
+        });
+
+        size_t size{guest::SaveCtxSize + guest::LoadCtxSize + MainSvcTrampolineSize}, offsetCount{};
+        for (const auto &chunk : chunks) {
+            size += chunk.size;
+            offsetCount += chunk.offsets.size();
         }
-        return {util::AlignUp(size * sizeof(u32), PAGE_SIZE), offsets};
-    }
 
-    void NCE::PatchCode(std::vector<u8> &text, u32 *patch, size_t patchSize, const std::vector<size_t> &offsets) {
-        u32 *start{patch};
-        u32 *end{patch + (patchSize / sizeof(u32))};
+        std::vector<size_t> offsets;
+        offsets.reserve(offsetCount);
+        for (const auto &chunk : chunks)
+            offsets.insert(offsets.end(), chunk.offsets.begin(), chunk.offsets.end());
+
+        return {util::AlignUp(size * sizeof(u32), PAGE_SIZE), std::move(offsets)};
+    }
 
+    u32 *NCE::WriteSharedTrampolines(u32 *patch) {
         std::memcpy(patch, reinterpret_cast<void *>(&guest::SaveCtx), guest::SaveCtxSize * sizeof(u32));
         patch += guest::SaveCtxSize;
 
@@ -240,119 +318,182 @@ namespace skyline::nce {
         std::memcpy(patch, reinterpret_cast<void *>(&guest::LoadCtx), guest::LoadCtxSize * sizeof(u32));
         patch += guest::LoadCtxSize;
 
-        u64 frequency;
-        asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
-        bool rescaleClock{frequency != TegraX1Freq};
+        return patch;
+    }
 
-        for (auto offset : offsets) {
-            u32 *instruction{reinterpret_cast<u32 *>(text.data()) + offset};
-            auto svc{*reinterpret_cast<instructions::Svc *>(instruction)};
-            auto mrs{*reinterpret_cast<instructions::Mrs *>(instruction)};
-            auto msr{*reinterpret_cast<instructions::Msr *>(instruction)};
-            auto endOffset{[&] { return static_cast<size_t>(end - patch); }};
-            auto startOffset{[&] { return static_cast<size_t>(start - patch); }};
-
-            if (svc.Verify()) {
-                /* Per-SVC Trampoline */
-                /* Rewrite SVC with B to trampoline */
-                *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+    /**
+     * @brief Writes the trampoline for a single instruction and rewrites the instruction to branch to it
+     * @param instruction A pointer to the instruction in .text, this must be at the specified offset from the start of .text
+     * @param patch A pointer to where the trampoline should be written, it's advanced past the trampoline
+     * @param start A pointer to the start of the .patch section
+     * @param end A pointer to the end of the .patch section, this directly precedes .text
+     */
+    static void PatchInstruction(u32 *instruction, size_t offset, u32 *&patch, u32 *start, u32 *end, bool rescaleClock) {
+        auto svc{*reinterpret_cast<instructions::Svc *>(instruction)};
+        auto mrs{*reinterpret_cast<instructions::Mrs *>(instruction)};
+        auto msr{*reinterpret_cast<instructions::Msr *>(instruction)};
+        auto endOffset{[&] { return static_cast<size_t>(end - patch); }};
+        auto startOffset{[&] { return static_cast<size_t>(start - patch); }};
+
+        if (svc.Verify()) {
+            /* Per-SVC Trampoline */
+            /* Rewrite SVC with B to trampoline */
+            *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+
+            auto [leafFunction, leafSize]{GetLeafSvc(svc.value)};
+            if (leafFunction) {
+                /* Inline Leaf SVC, this falls through to returning or branches past the return to the regular trampoline */
+                std::memcpy(patch, reinterpret_cast<void *>(leafFunction), leafSize * sizeof(u32));
+                patch += leafSize;
 
-                /* Save Context */
-                *patch++ = 0xF81F0FFE; // STR LR, [SP, #-16]!
-                *patch = instructions::BL(static_cast<i32>(startOffset())).raw;
+                *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
                 patch++;
+            }
 
-                /* Jump to main SVC trampoline */
-                *patch++ = instructions::Movz(registers::W0, static_cast<u16>(svc.value)).raw;
-                *patch = instructions::BL(static_cast<i32>(startOffset() + guest::SaveCtxSize)).raw;
-                patch++;
+            /* Save Context */
+            *patch++ = 0xF81F0FFE; // STR LR, [SP, #-16]!
+            *patch = instructions::BL(static_cast<i32>(startOffset())).raw;
+            patch++;
+
+            /* Jump to main SVC trampoline */
+            *patch++ = instructions::Movz(registers::W0, static_cast<u16>(svc.value)).raw;
+            *patch = instructions::BL(static_cast<i32>(startOffset() + guest::SaveCtxSize)).raw;
+            patch++;
+
+            /* Restore Context and Return */
+            *patch = instructions::BL(static_cast<i32>(startOffset() + guest::SaveCtxSize + MainSvcTrampolineSize)).raw;
+            patch++;
+            *patch++ = 0xF84107FE; // LDR LR, [SP], #16
+            *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
+            patch++;
+        } else if (mrs.Verify()) {
+            if (mrs.srcReg == TpidrroEl0 || mrs.srcReg == TpidrEl0) {
+                /* Emulated TLS Register Load */
+                if (mrs.destReg == ZeroRegister) {
+                    // A load into XZR has no effect, we can't use it as a scratch register so the instruction is replaced with a NOP
+                    *instruction = Nop;
+                    return;
+                }
 
-                /* Restore Context and Return */
-                *patch = instructions::BL(static_cast<i32>(startOffset() + guest::SaveCtxSize + MainSvcTrampolineSize)).raw;
-                patch++;
-                *patch++ = 0xF84107FE; // LDR LR, [SP], #16
+                /* Rewrite MRS with B to trampoline */
+                *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+
+                /* Retrieve emulated TLS register from ThreadContext using the destination register as a scratch register */
+                *patch++ = 0xD53BD040 | mrs.destReg; // MRS XOUT, TPIDR_EL0
+                if (mrs.srcReg == TpidrroEl0)
+                    *patch++ = 0xF9415800 | (mrs.destReg << 5) | mrs.destReg; // LDR XOUT, [XOUT, #0x2B0] (ThreadContext::tpidrroEl0)
+                else
+                    *patch++ = 0xF9415C00 | (mrs.destReg << 5) | mrs.destReg; // LDR XOUT, [XOUT, #0x2B8] (ThreadContext::tpidrEl0)
+
+                /* Return */
                 *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
                 patch++;
-            } else if (mrs.Verify()) {
-                if (mrs.srcReg == TpidrroEl0 || mrs.srcReg == TpidrEl0) {
-                    /* Emulated TLS Register Load */
-                    /* Rewrite MRS with B to trampoline */
-                    *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
-
-                    /* Allocate Scratch Register */
-                    if (mrs.destReg != registers::X0)
-                        *patch++ = 0xF81F0FE0; // STR X0, [SP, #-16]!
-
-                    /* Retrieve emulated TLS register from ThreadContext */
-                    *patch++ = 0xD53BD040; // MRS X0, TPIDR_EL0
-                    if (mrs.srcReg == TpidrroEl0)
-                        *patch++ = 0xF9415800; // LDR X0, [X0, #0x2B0] (ThreadContext::tpidrroEl0)
-                    else
-                        *patch++ = 0xF9415C00; // LDR X0, [X0, #0x2B8] (ThreadContext::tpidrEl0)
-
-                    /* Restore Scratch Register and Return */
-                    if (mrs.destReg != registers::X0) {
-                        *patch++ = instructions::Mov(registers::X(mrs.destReg), registers::X0).raw;
-                        *patch++ = 0xF84107E0; // LDR X0, [SP], #16
-                    }
-                    *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
-                    patch++;
-                } else {
-                    if (rescaleClock) {
-                        if (mrs.srcReg == CntpctEl0) {
-                            /* Physical Counter Load Emulation (With Rescaling) */
-                            /* Rewrite MRS with B to trampoline */
-                            *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
-
-                            /* Rescale host clock */
-                            std::memcpy(patch, reinterpret_cast<void *>(&guest::RescaleClock), guest::RescaleClockSize * sizeof(u32));
-                            patch += guest::RescaleClockSize;
-
-                            /* Load result from stack into destination register */
-                            instructions::Ldr ldr(0xF94003E0); // LDR XOUT, [SP]
-                            ldr.destReg = mrs.destReg;
-                            *patch++ = ldr.raw;
-
-                            /* Free 32B stack allocation by RescaleClock and Return */
-                            *patch++ = {0x910083FF}; // ADD SP, SP, #32
-                            *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
-                            patch++;
-                        } else if (mrs.srcReg == CntfrqEl0) {
-                            /* Physical Counter Frequency Load Emulation */
-                            /* Rewrite MRS with B to trampoline */
-                            *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
-
-                            /* Write back Tegra X1 Counter Frequency and Return */
-                            for (const auto &mov : instructions::MoveRegister(registers::X(mrs.destReg), TegraX1Freq))
-                                *patch++ = mov;
-                            *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
-                            patch++;
+            } else {
+                if (rescaleClock) {
+                    if (mrs.srcReg == CntpctEl0) {
+                        /* Physical Counter Load Emulation (With Rescaling) */
+                        if (mrs.destReg == ZeroRegister) {
+                            *instruction = Nop;
+                            return;
                         }
-                    } else if (mrs.srcReg == CntpctEl0) {
-                        /* Physical Counter Load Emulation (Without Rescaling) */
-                        // We just convert CNTPCT_EL0 -> CNTVCT_EL0 as Linux doesn't allow access to the physical counter
-                        *instruction = instructions::Mrs(CntvctEl0, registers::X(mrs.destReg)).raw;
+
+                        /* Rewrite MRS with B to trampoline */
+                        *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+
+                        /* Allocate Scratch Register */
+                        u8 scratch{mrs.destReg != registers::X0 ? registers::X0 : registers::X1};
+                        *patch++ = 0xF81F0FE0 | scratch; // STR XSCRATCH, [SP, #-16]!
+
+                        /* Rescale host clock with the scale factor from ThreadContext */
+                        *patch++ = instructions::Mrs(CntvctEl0, registers::X(scratch)).raw;
+                        *patch++ = 0xD53BD040 | mrs.destReg; // MRS XOUT, TPIDR_EL0
+                        *patch++ = 0xF9416C00 | (mrs.destReg << 5) | mrs.destReg; // LDR XOUT, [XOUT, #0x2D8] (ThreadContext::counterScale)
+                        *patch++ = 0x9BC07C00 | (mrs.destReg << 16) | (scratch << 5) | mrs.destReg; // UMULH XOUT, XSCRATCH, XOUT
+
+                        auto shift{NCE::GetCounterRescale().shift};
+                        if (shift)
+                            *patch++ = 0xD3400000 | (((64 - shift) & 0x3F) << 16) | ((63 - shift) << 10) | (mrs.destReg << 5) | mrs.destReg; // LSL XOUT, XOUT, #SHIFT
+
+                        /* Restore Scratch Register and Return */
+                        *patch++ = 0xF84107E0 | scratch; // LDR XSCRATCH, [SP], #16
+                        *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
+                        patch++;
+                    } else if (mrs.srcReg == CntfrqEl0) {
+                        /* Physical Counter Frequency Load Emulation */
+                        /* Rewrite MRS with B to trampoline */
+                        *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+
+                        /* Write back Tegra X1 Counter Frequency and Return */
+                        for (const auto &mov : instructions::MoveRegister(registers::X(mrs.destReg), TegraX1Freq))
+                            *patch++ = mov;
+                        *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
+                        patch++;
                     }
+                } else if (mrs.srcReg == CntpctEl0) {
+                    /* Physical Counter Load Emulation (Without Rescaling) */
+                    // We just convert CNTPCT_EL0 -> CNTVCT_EL0 as Linux doesn't allow access to the physical counter
+                    *instruction = instructions::Mrs(CntvctEl0, registers::X(mrs.destReg)).raw;
                 }
-            } else if (msr.Verify() && msr.destReg == TpidrEl0) {
-                /* Emulated TLS Register Store */
-                /* Rewrite MSR with B to trampoline */
-                *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+            }
+        } else if (msr.Verify() && msr.destReg == TpidrEl0) {
+            /* Emulated TLS Register Store */
+            /* Rewrite MSR with B to trampoline */
+            *instruction = instructions::B(static_cast<i32>(endOffset() + offset), true).raw;
+
+            /* Allocate Scratch Registers */
+            bool x0x1{mrs.srcReg != registers::X0 && mrs.srcReg != registers::X1};
+            *patch++ = x0x1 ? 0xA9BF07E0 : 0xA9BF0FE2; // STP X(0/2), X(1/3), [SP, #-16]!
+
+            /* Store new TLS value into ThreadContext */
+            *patch++ = x0x1 ? 0xD53BD040 : 0xD53BD042; // MRS X(0/2), TPIDR_EL0
+            *patch++ = instructions::Mov(x0x1 ? registers::X1 : registers::X3, registers::X(msr.srcReg)).raw;
+            *patch++ = x0x1 ? 0xF9015C01 : 0xF9015C03; // STR X(1/3), [X0, #0x4B8] (ThreadContext::tpidrEl0)
+
+            /* Restore Scratch Registers and Return */
+            *patch++ = x0x1 ? 0xA8C107E0 : 0xA8C10FE2; // LDP X(0/2), X(1/3), [SP], #16
+            *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
+            patch++;
+        }
+    }
 
-                /* Allocate Scratch Registers */
-                bool x0x1{mrs.srcReg != registers::X0 && mrs.srcReg != registers::X1};
-                *patch++ = x0x1 ? 0xA9BF07E0 : 0xA9BF0FE2; // STP X(0/2), X(1/3), [SP, #-16]!
+    void NCE::PatchCode(std::vector<u8> &text, u32 *patch, size_t patchSize, const std::vector<size_t> &offsets) {
+        u32 *start{patch};
+        u32 *end{patch + (patchSize / sizeof(u32))};
 
-                /* Store new TLS value into ThreadContext */
-                *patch++ = x0x1 ? 0xD53BD040 : 0xD53BD042; // MRS X(0/2), TPIDR_EL0
-                *patch++ = instructions::Mov(x0x1 ? registers::X1 : registers::X3, registers::X(msr.srcReg)).raw;
-                *patch++ = x0x1 ? 0xF9015C01 : 0xF9015C03; // STR X(1/3), [X0, #0x4B8] (ThreadContext::tpidrEl0)
+        patch = WriteSharedTrampolines(patch);
 
-                /* Restore Scratch Registers and Return */
-                *patch++ = x0x1 ? 0xA8C107E0 : 0xA8C10FE2; // LDP X(0/2), X(1/3), [SP], #16
-                *patch = instructions::B(static_cast<i32>(endOffset() + offset + 1)).raw;
-                patch++;
-            }
+        u64 frequency;
+        asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+        bool rescaleClock{frequency != TegraX1Freq};
+
+        // Offsets are split into chunks that are patched concurrently, the location of the trampolines for every chunk is determined by the total size of the trampolines in all prior chunks
+        auto code{reinterpret_cast<u32 *>(text.data())};
+        size_t chunkCount{GetChunkCount(offsets.size(), MinimumPatchChunkSize)};
+        std::vector<size_t> chunkSizes(chunkCount);
+        ForEachChunk(offsets.size(), chunkCount, [&](size_t chunk, size_t first, size_t last) {
+            for (size_t index{first}; index < last; index++)
+                chunkSizes[chunk] += GetTrampolineSize(code + offsets[index], rescaleClock).value_or(0);
+        });
+
+        std::vector<u32 *> chunkPatches(chunkCount);
+        for (size_t chunk{}; chunk < chunkCount; chunk++) {
+            chunkPatches[chunk] = patch;
+            patch += chunkSizes[chunk];
         }
+
+        ForEachChunk(offsets.size(), chunkCount, [&](size_t chunk, size_t first, size_t last) {
+            u32 *chunkPatch{chunkPatches[chunk]};
+            for (size_t index{first}; index < last; index++)
+                PatchInstruction(code + offsets[index], offsets[index], chunkPatch, start, end, rescaleClock);
+        });
+    }
+
+    void NCE::RestorePatchedCode(std::vector<u8> &text, u32 *patch, span<const u8> section, const std::vector<size_t> &offsets, span<const u32> instructions) {
+        std::memcpy(patch, section.data(), section.size());
+        WriteSharedTrampolines(patch);
+
+        auto code{reinterpret_cast<u32 *>(text.data())};
+        for (size_t index{}; index < offsets.size(); index++)
+            code[offsets[index]] = instructions[index];
     }
 }
@@ -16,6 +16,12 @@ namespace skyline::nce {
 
         static void SvcHandler(u16 svcId, ThreadContext *ctx);
 
+        /**
+         * @brief Writes the trampolines shared by all patches (SaveCtx, the main SVC trampoline and LoadCtx) to the start of the .patch section
+         * @return A pointer to the end of the shared trampolines
+         */
+        static u32 *WriteSharedTrampolines(u32 *patch);
+
       public:
         /**
          * @brief An exception which causes the throwing thread to exit alongside all threads optionally
@@ -36,6 +42,19 @@ namespace skyline::nce {
 
         NCE(const DeviceState &state);
 
+        /**
+         * @brief The parameters for rescaling the host counter to the frequency of the Tegra X1 counter, it's done as `(UMULH(HostTicks, scale) << shift)`
+         */
+        struct CounterRescale {
+            u64 scale; //!< The ratio of the Tegra X1 counter frequency to the host counter frequency in 0.64 fixed-point, this is pre-divided by 2^shift
+            u8 shift;
+        };
+
+        /**
+         * @return The rescaling parameters for the host counter, these are only calculated once
+         */
+        static CounterRescale GetCounterRescale();
+
         struct PatchData {
             size_t size; //!< Size of the .patch section
             std::vector<size_t> offsets; //!< Offsets in .text of instructions that need to be patched
@@ -48,5 +67,13 @@ namespace skyline::nce {
          * @param patch A pointer to the .patch section which should be exactly patchSize in size and located before the .text section
          */
         static void PatchCode(std::vector<u8> &text, u32 *patch, size_t patchSize, const std::vector<size_t> &offsets);
+
+        /**
+         * @brief Restores a .patch section and the mutated code from a previous invocation of PatchCode, this avoids regenerating all trampolines
+         * @param section The contents of the .patch section written by PatchCode, this should be exactly patchSize in size
+         * @param instructions The patched instruction at each offset in .text
+         * @note The shared trampolines at the start of the .patch section are regenerated as they contain host addresses
+         */
+        static void RestorePatchedCode(std::vector<u8> &text, u32 *patch, span<const u8> section, const std::vector<size_t> &offsets, span<const u32> instructions);
     };
 }
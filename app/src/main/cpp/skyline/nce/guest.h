@@ -100,12 +100,16 @@ namespace skyline {
             u8 *tpidrEl0; //!< Emulated HOS TPIDR_EL0
             const DeviceState *state;
             u64 magic{constant::SkyTlsMagic};
+            u64 threadId; //!< The ID of the guest thread, this is accessed directly by leaf SVCs
+            u64 counterScale; //!< The scale factor for rescaling the host counter to Tegra X1 levels, see NCE::CounterRescale
         };
+        static_assert(offsetof(ThreadContext, threadId) == 0x2D0); // These offsets are hardcoded into guest code and trampolines
+        static_assert(offsetof(ThreadContext, counterScale) == 0x2D8);
 
         namespace guest {
+            constexpr u32 TrampolineAbiVersion{3}; //!< The version of the trampoline ABI, this must be incremented on any change to the layout of trampolines or ThreadContext as it invalidates persistently cached patches
             constexpr size_t SaveCtxSize{39}; //!< The size of the SaveCtx function in 32-bit ARMv8 instructions
             constexpr size_t LoadCtxSize{39}; //!< The size of the LoadCtx function in 32-bit ARMv8 instructions
-            constexpr size_t RescaleClockSize{16}; //!< The size of the RescaleClock function in 32-bit ARMv8 instructions
 
             /**
              * @brief Saves the context from CPU registers into TLS
@@ -119,11 +123,18 @@ namespace skyline {
              */
             extern "C" void LoadCtx(void);
 
+            constexpr size_t SvcGetSystemTickLeafSize{8}; //!< The size of the SvcGetSystemTickLeaf function in 32-bit ARMv8 instructions
+            constexpr size_t SvcGetThreadIdLeafSize{11}; //!< The size of the SvcGetThreadIdLeaf function in 32-bit ARMv8 instructions
+
+            /**
+             * @brief A leaf implementation of svcGetSystemTick which rescales the host clock to Tegra X1 levels
+             */
+            extern "C" __noreturn void SvcGetSystemTickLeaf(void);
+
             /**
-             * @brief Rescales the host clock to Tegra X1 levels
-             * @note Output is on stack with the stack pointer offset 32B from the initial point
+             * @brief A leaf implementation of svcGetThreadId for the current thread pseudo-handle, any other handle falls back to the regular SVC trampoline
              */
-            extern "C" __noreturn void RescaleClock(void);
+            extern "C" __noreturn void SvcGetThreadIdLeaf(void);
         }
     }
 }
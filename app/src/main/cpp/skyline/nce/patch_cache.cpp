@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <vfs/os_filesystem.h>
+#include <kernel/svc.h>
+#include "guest.h"
+#include "patch_cache.h"
+
+namespace skyline::nce {
+    PatchCache::PatchCache(const std::string &path) {
+        try {
+            cacheFileSystem = std::make_shared<vfs::OsFileSystem>(path);
+        } catch (const std::exception &e) {
+            Logger::Warn("Patch cache is unavailable: {}", e.what());
+        }
+    }
+
+    std::string PatchCache::GetEntryName(const std::array<u64, 4> &buildId) {
+        return fmt::format("{:016X}{:016X}{:016X}{:016X}.patch", buildId[0], buildId[1], buildId[2], buildId[3]);
+    }
+
+    u64 PatchCache::GetAbiHash() {
+        auto hashCode{[](void (*function)(), size_t size) {
+            return util::Hash(std::string_view(reinterpret_cast<const char *>(function), size * sizeof(u32)));
+        }};
+        u64 hash{hashCode(&guest::SaveCtx, guest::SaveCtxSize) ^ (hashCode(&guest::LoadCtx, guest::LoadCtxSize) << 1) ^ guest::TrampolineAbiVersion};
+        for (const auto &descriptor : kernel::svc::SvcTable)
+            if (descriptor.leafFunction)
+                hash = (hash << 1) ^ hashCode(descriptor.leafFunction, descriptor.leafSize);
+        return hash;
+    }
+
+    std::optional<PatchCache::Entry> PatchCache::Lookup(const std::array<u64, 4> &buildId, const std::vector<u8> &text) {
+        if (!cacheFileSystem || buildId == std::array<u64, 4>{})
+            return std::nullopt;
+
+        auto name{GetEntryName(buildId)};
+        try {
+            if (!cacheFileSystem->FileExists(name))
+                return std::nullopt;
+
+            auto backing{cacheFileSystem->OpenFile(name)};
+            auto header{backing->Read<CacheHeader>()};
+
+            u64 frequency;
+            asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+            if (header.magic != CacheHeader{}.magic || header.abiVersion != guest::TrampolineAbiVersion || header.abiHash != GetAbiHash() || header.hostFrequency != frequency || header.buildId != buildId || header.textSize != text.size()) {
+                Logger::Debug("Discarding stale patch cache entry: {}", name);
+                return std::nullopt;
+            }
+
+            Entry entry{
+                .patch = {.size = header.patchSize},
+                .instructions = std::vector<u32>(header.offsetCount),
+                .section = std::vector<u8>(header.patchSize),
+            };
+
+            std::vector<u32> offsets(header.offsetCount);
+            size_t offset{sizeof(CacheHeader)};
+            backing->Read(span(offsets), offset);
+            offset += offsets.size() * sizeof(u32);
+            backing->Read(span(entry.instructions), offset);
+            offset += entry.instructions.size() * sizeof(u32);
+            backing->Read(span(entry.section), offset);
+
+            entry.patch.offsets.reserve(offsets.size());
+            for (auto instructionOffset : offsets) {
+                if (instructionOffset >= text.size() / sizeof(u32))
+                    throw exception("Patch offset out of bounds: 0x{:X}", instructionOffset);
+                entry.patch.offsets.push_back(instructionOffset);
+            }
+
+            return entry;
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to read patch cache entry {}: {}", name, e.what());
+            return std::nullopt;
+        }
+    }
+
+    void PatchCache::Store(const std::array<u64, 4> &buildId, const std::vector<u8> &patchedText, const u8 *section, const NCE::PatchData &patch) {
+        if (!cacheFileSystem || buildId == std::array<u64, 4>{})
+            return;
+
+        u64 frequency;
+        asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+
+        CacheHeader header{
+            .abiVersion = guest::TrampolineAbiVersion,
+            .offsetCount = static_cast<u32>(patch.offsets.size()),
+            .abiHash = GetAbiHash(),
+            .hostFrequency = frequency,
+            .buildId = buildId,
+            .textSize = patchedText.size(),
+            .patchSize = patch.size,
+        };
+
+        std::vector<u8> buffer(sizeof(CacheHeader) + (patch.offsets.size() * sizeof(u32) * 2) + patch.size);
+        std::memcpy(buffer.data(), &header, sizeof(CacheHeader));
+
+        auto offsets{reinterpret_cast<u32 *>(buffer.data() + sizeof(CacheHeader))};
+        auto instructions{offsets + patch.offsets.size()};
+        auto text{reinterpret_cast<const u32 *>(patchedText.data())};
+        for (size_t index{}; index < patch.offsets.size(); index++) {
+            offsets[index] = static_cast<u32>(patch.offsets[index]);
+            instructions[index] = text[patch.offsets[index]];
+        }
+        std::memcpy(instructions + patch.offsets.size(), section, patch.size);
+
+        auto name{GetEntryName(buildId)};
+        try {
+            if (!cacheFileSystem->CreateFile(name, buffer.size()))
+                throw exception("Failed to create file");
+            cacheFileSystem->OpenFile(name, {false, true, false})->Write(buffer);
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to write patch cache entry {}: {}", name, e.what());
+        }
+    }
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <vfs/filesystem.h>
+#include <nce.h>
+
+namespace skyline::nce {
+    /**
+     * @brief A persistent on-disk cache of the patch data and the generated .patch section for executables, keyed by their build ID
+     * @note This allows warm boots to skip scanning and patching the entirety of .text which is rather expensive for larger titles
+     */
+    class PatchCache {
+      private:
+        std::shared_ptr<vfs::FileSystem> cacheFileSystem; //!< The filesystem containing all cache entries, this is nullptr if the cache is unavailable
+
+        /**
+         * @brief The header of a cache entry, it's followed by the instruction offsets (u32), the patched instructions (u32) and the contents of the .patch section
+         */
+        struct CacheHeader {
+            u64 magic{util::MakeMagic<u64>("SKYNCEPC")};
+            u32 abiVersion; //!< The value of guest::TrampolineAbiVersion at the time of the cache being written
+            u32 offsetCount; //!< The amount of patched instructions
+            u64 abiHash; //!< A hash of the guest code copied into the .patch section, this catches any changes that weren't accompanied by an ABI version bump
+            u64 hostFrequency; //!< The frequency of the host counter, this determines if the clock is rescaled by the patches
+            std::array<u64, 4> buildId; //!< The build ID of the executable
+            u64 textSize; //!< The size of the unpatched .text section
+            u64 patchSize; //!< The size of the .patch section
+        };
+
+        static std::string GetEntryName(const std::array<u64, 4> &buildId);
+
+        /**
+         * @return A hash of all the guest code that is copied into the .patch section alongside the trampoline ABI version
+         */
+        static u64 GetAbiHash();
+
+      public:
+        /**
+         * @brief A cached copy of the patch data for an executable
+         */
+        struct Entry {
+            NCE::PatchData patch;
+            std::vector<u32> instructions; //!< The patched instructions corresponding to each offset in patch.offsets
+            std::vector<u8> section; //!< The contents of the .patch section
+        };
+
+        /**
+         * @param path The path to the directory in which cache entries should be stored
+         */
+        PatchCache(const std::string &path);
+
+        /**
+         * @param buildId The build ID of the executable, a zero build ID isn't cached as it isn't unique
+         * @param text The unpatched .text section of the executable
+         * @return The cached patch data for the executable if it was found and is still valid
+         */
+        std::optional<Entry> Lookup(const std::array<u64, 4> &buildId, const std::vector<u8> &text);
+
+        /**
+         * @brief Writes the patch data for an executable into the cache
+         * @param patchedText The .text section after being patched with PatchCode
+         * @param section A pointer to the .patch section, this should be patch.size in size
+         */
+        void Store(const std::array<u64, 4> &buildId, const std::vector<u8> &patchedText, const u8 *section, const NCE::PatchData &patch);
+    };
+}
@@ -1,15 +1,21 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <sys/stat.h>
+#include <common/settings.h>
+#include <common/guest_profiler.h>
 #include "nce.h"
 #include "nce/guest.h"
 #include "kernel/types/KProcess.h"
-#include "vfs/os_backing.h"
+#include "vfs/mapped_backing.h"
+#include "vfs/compressed_backing.h"
+#include "vfs/access_recording_backing.h"
 #include "loader/nro.h"
 #include "loader/nso.h"
 #include "loader/nca.h"
 #include "loader/nsp.h"
 #include "loader/xci.h"
+#include "gpu.h"
 #include "os.h"
 
 namespace skyline::kernel {
@@ -27,36 +33,61 @@ namespace skyline::kernel {
           serviceManager(state),
           systemLanguage(systemLanguage) {}
 
-    void OS::Execute(int romFd, loader::RomFormat romType) {
-        auto romFile{std::make_shared<vfs::OsBacking>(romFd)};
+    std::shared_ptr<loader::Loader> OS::CreateLoader(int romFd, loader::RomFormat romType, const std::string &appFilesPath, size_t sectorCacheSize) {
+        auto romFile{vfs::CompressedBacking::Open(vfs::MappedBacking::Open(romFd))};
         auto keyStore{std::make_shared<crypto::KeyStore>(appFilesPath)};
 
-        state.loader = [&]() -> std::shared_ptr<loader::Loader> {
+        auto loader{[&]() -> std::shared_ptr<loader::Loader> {
             switch (romType) {
                 case loader::RomFormat::NRO:
                     return std::make_shared<loader::NroLoader>(std::move(romFile));
                 case loader::RomFormat::NSO:
                     return std::make_shared<loader::NsoLoader>(std::move(romFile));
                 case loader::RomFormat::NCA:
-                    return std::make_shared<loader::NcaLoader>(std::move(romFile), std::move(keyStore));
+                    return std::make_shared<loader::NcaLoader>(std::move(romFile), std::move(keyStore), sectorCacheSize);
                 case loader::RomFormat::NSP:
-                    return std::make_shared<loader::NspLoader>(romFile, keyStore);
+                    return std::make_shared<loader::NspLoader>(romFile, keyStore, sectorCacheSize);
                 case loader::RomFormat::XCI:
-                    return std::make_shared<loader::XciLoader>(romFile, keyStore);
+                    return std::make_shared<loader::XciLoader>(romFile, keyStore, sectorCacheSize);
                 default:
                     throw exception("Unsupported ROM extension.");
             }
-        }();
+        }()};
+
+        // Reads from the RomFS during the start of a session are recorded so they can be prefetched into the sector cache on the next launch of the title
+        if (loader->romFs && loader->nacp && sectorCacheSize)
+            loader->romFs = std::make_shared<vfs::AccessRecordingBacking>(loader->romFs, appFilesPath + "io_records/", loader->nacp->nacpContents.saveDataOwnerId, sectorCacheSize);
+
+        return loader;
+    }
+
+    void OS::Execute(std::shared_ptr<loader::Loader> loader) {
+        state.loader = std::move(loader);
 
         auto &process{state.process};
         process = std::make_shared<kernel::type::KProcess>(state);
         auto entry{state.loader->LoadProcessData(process, state)};
+        u64 titleId{state.loader->nacp ? state.loader->nacp->nacpContents.saveDataOwnerId : 0};
+        state.gpu->pipelineCache.Open(appFilesPath + "pipeline_cache/", titleId);
+        state.gpu->shaderCache.Open(appFilesPath + "shader_cache/", titleId);
         process->InitializeHeapTls();
         auto thread{process->CreateThread(entry)};
         if (thread) {
+            trace::GuestProfiler::ScopedStop profilerStop;
+            if (state.settings->guestProfiling)
+                trace::GuestProfiler::Start();
+
             Logger::Debug("Starting main HOS thread");
             thread->Start(true);
             process->Kill(true, true, true);
+
+            if (trace::GuestProfiler::IsActive()) {
+                // The profile is written while the executables are still loaded as they're required to symbolize it
+                auto directory{appFilesPath + "guest_profiles/"};
+                if (mkdir(directory.c_str(), 0755) && errno != EEXIST)
+                    throw exception("Failed to create guest profile directory '{}': {}", directory, strerror(errno));
+                trace::GuestProfiler::Stop(*state.loader, fmt::format("{}{}.folded", directory, util::GetTimeNs()));
+            }
         }
     }
 }
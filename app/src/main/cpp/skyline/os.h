@@ -35,10 +35,17 @@ namespace skyline::kernel {
         );
 
         /**
-         * @brief Execute a particular ROM file
+         * @brief Opens and parses a ROM file, this doesn't depend on any emulator state so it can be done concurrently with the construction of the OS
          * @param romFd A FD to the ROM file to execute
          * @param romType The type of the ROM file
+         * @param appFilesPath The full path to the app's files directory
+         * @param sectorCacheSize The size of the cache of decrypted NCA sections in bytes, this is also the limit on the size of recorded RomFS reads
          */
-        void Execute(int romFd, loader::RomFormat romType);
+        static std::shared_ptr<loader::Loader> CreateLoader(int romFd, loader::RomFormat romType, const std::string &appFilesPath, size_t sectorCacheSize);
+
+        /**
+         * @brief Execute a ROM file that has been opened with CreateLoader
+         */
+        void Execute(std::shared_ptr<loader::Loader> loader);
     };
 }
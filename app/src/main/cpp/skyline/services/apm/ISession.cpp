@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <common/settings.h>
+#include <common/performance_hint.h>
 #include "ISession.h"
 
 namespace skyline::service::apm {
@@ -10,6 +12,8 @@ namespace skyline::service::apm {
         auto mode{request.Pop<u32>()};
         auto config{request.Pop<u32>()};
         performanceConfig.at(mode) = config;
+        if (mode == static_cast<u32>(state.settings->operationMode))
+            PerformanceHint::SetBoost((config & BoostConfigurationMask) == BoostConfiguration);
         Logger::Info("Performance configuration set to 0x{:X} ({})", config, mode ? "Docked" : "Handheld");
         return {};
     }
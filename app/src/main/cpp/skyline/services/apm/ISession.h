@@ -12,12 +12,14 @@ namespace skyline::service::apm {
     class ISession : public BaseService {
       private:
         std::array<u32, 2> performanceConfig{0x00010000, 0x00020001}; //!< The performance config for both handheld(0) and docked(1) mode
+        static constexpr u32 BoostConfigurationMask{0xFFFF0000};
+        static constexpr u32 BoostConfiguration{0x92220000}; //!< The upper half of configurations which boost the CPU to 1785MHz, games use these during loading screens
 
       public:
         ISession(const DeviceState &state, ServiceManager &manager);
 
         /**
-         * @brief Sets PerformanceConfig to the given arguments, it doesn't affect anything else
+         * @brief Sets PerformanceConfig to the given arguments, a boost configuration for the current operation mode has the host raise clocks through the performance hint session
          * @url https://switchbrew.org/wiki/PPC_services#SetPerformanceConfiguration
          */
         Result SetPerformanceConfiguration(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
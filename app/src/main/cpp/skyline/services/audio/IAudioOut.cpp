@@ -18,7 +18,7 @@ namespace skyline::service::audio {
     }
 
     Result IAudioOut::GetAudioOutState(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        response.Push(static_cast<u32>(track->playbackState));
+        response.Push(static_cast<u32>(track->playbackState.load()));
         return {};
     }
 
@@ -48,10 +48,11 @@ namespace skyline::service::audio {
 
         span samples(data.sampleBuffer, data.sampleSize / sizeof(i16));
         if (sampleRate != constant::SampleRate) {
-            auto resampledBuffer{resampler.ResampleBuffer(samples, static_cast<double>(sampleRate) / constant::SampleRate, channelCount)};
-            track->AppendBuffer(tag, resampledBuffer);
+            auto ratio{static_cast<double>(sampleRate) / constant::SampleRate};
+            resampledBuffer.resize(skyline::audio::Resampler::GetOutputSize(samples.size(), ratio, channelCount));
+            track->AppendBuffer(tag, span(resampledBuffer).first(resampler.ResampleBuffer(samples, resampledBuffer, ratio, channelCount)), true);
         } else {
-            track->AppendBuffer(tag, samples);
+            track->AppendBuffer(tag, samples); // The guest can't reuse the buffer until it's released so it's played directly from guest memory
         }
 
         return {};
@@ -65,13 +66,10 @@ namespace skyline::service::audio {
     }
 
     Result IAudioOut::GetReleasedAudioOutBuffer(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        auto maxCount{static_cast<u32>(request.outputBuf.at(0).size() >> 3)};
-        auto releasedBuffers{track->GetReleasedBuffers(maxCount)};
-        auto count{static_cast<u32>(releasedBuffers.size())};
-
-        // Fill rest of output buffer with zeros
-        releasedBuffers.resize(maxCount, 0);
-        request.outputBuf.at(0).copy_from(releasedBuffers);
+        // The identifiers are written into the output buffer directly and the rest of it is filled with zeros
+        auto releasedBuffers{request.outputBuf.at(0).cast<u64, std::dynamic_extent, true>()};
+        auto count{track->GetReleasedBuffers(releasedBuffers)};
+        std::fill(releasedBuffers.begin() + count, releasedBuffers.end(), 0);
 
         response.Push<u32>(count);
         return {};
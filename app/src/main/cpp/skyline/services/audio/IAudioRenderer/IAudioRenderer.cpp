@@ -1,29 +1,64 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <common/signal.h>
+#include <common/thread_pool.h>
 #include <kernel/types/KProcess.h>
 #include "IAudioRenderer.h"
 
 namespace skyline::service::audio::IAudioRenderer {
     IAudioRenderer::IAudioRenderer(const DeviceState &state, ServiceManager &manager, AudioRendererParameters &parameters)
         : systemEvent(std::make_shared<type::KEvent>(state, true)), parameters(parameters), BaseService(state, manager) {
-        track = state.audio->OpenTrack(constant::ChannelCount, constant::SampleRate, [&]() { systemEvent->Signal(); });
+        track = state.audio->OpenTrack(constant::ChannelCount, constant::SampleRate, []() {}); // Released buffers are polled by the renderer thread
         track->Start();
 
         memoryPools.resize(parameters.effectCount + parameters.voiceCount * 4);
         effects.resize(parameters.effectCount);
         voices.resize(parameters.voiceCount, Voice(state));
+        voiceTimings.resize(parameters.voiceCount);
 
         // Fill track with empty samples that we will triple buffer
-        track->AppendBuffer(0);
-        track->AppendBuffer(1);
-        track->AppendBuffer(2);
+        for (u64 tag{}; tag < SampleBufferCount; tag++)
+            track->AppendBuffer(tag);
+
+        // Mixing is only spread across a few threads as the remaining cores are likely to be occupied by the guest or the GPU
+        mixAccumulators.resize(std::min(ThreadPool::Get().GetWorkerCount() / 2, MaxMixPartitions - 1) + 1);
+
+        rendererThread = std::thread(&IAudioRenderer::RendererThread, this);
     }
 
     IAudioRenderer::~IAudioRenderer() {
+        {
+            std::lock_guard lock(rendererMutex);
+            rendererExiting = true;
+        }
+        rendererCondition.notify_all();
+        rendererThread.join();
+
         state.audio->CloseTrack(track);
     }
 
+    void IAudioRenderer::RendererThread() {
+        pthread_setname_np(pthread_self(), "AudioRenderer");
+
+        try {
+            std::unique_lock lock(rendererMutex);
+            auto wakeTime{std::chrono::steady_clock::now()};
+            while (!rendererExiting) {
+                if (UpdateAudio())
+                    systemEvent->Signal();
+
+                // The next period is relative to the prior one rather than to when rendering finished so rendering time doesn't cause drift
+                wakeTime += RenderPeriod;
+                rendererCondition.wait_until(lock, wakeTime, [this]() { return rendererExiting; });
+            }
+        } catch (const std::exception &e) {
+            Logger::Error(e.what());
+            signal::BlockSignal({SIGINT});
+            state.process->Kill(false);
+        }
+    }
+
     Result IAudioRenderer::GetSampleRate(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         response.Push<u32>(parameters.sampleRate);
         return {};
@@ -52,6 +87,8 @@ namespace skyline::service::audio::IAudioRenderer {
         input += sizeof(UpdateDataHeader);
         input += inputHeader.behaviorSize; // Unused
 
+        std::lock_guard lock(rendererMutex);
+
         span memoryPoolsIn(reinterpret_cast<MemoryPoolIn *>(input), memoryPools.size());
         input += inputHeader.memoryPoolSize;
         for (size_t i{}; i < memoryPools.size(); i++)
@@ -68,7 +105,8 @@ namespace skyline::service::audio::IAudioRenderer {
         for (u32 i{}; i < effectsIn.size(); i++)
             effects[i].ProcessInput(effectsIn[i]);
 
-        UpdateAudio();
+        if (parameters.performanceManagerCount > 0 && request.outputBuf.size() > 1)
+            performanceManager.WriteHistory(request.outputBuf[1], revisionInfo.UsesPerformanceMetricDataFormatV2());
 
         UpdateDataHeader outputHeader{
             .revision = constant::RevMagic,
@@ -114,51 +152,90 @@ namespace skyline::service::audio::IAudioRenderer {
             output += sizeof(EffectOut);
         }
 
+        output += outputHeader.sinkSize;
+        *reinterpret_cast<PerformanceManagerOut *>(output) = performanceManager.output;
+
         return {};
     }
 
-    void IAudioRenderer::UpdateAudio() {
-        auto released{track->GetReleasedBuffers(2)};
+    bool IAudioRenderer::UpdateAudio() {
+        std::array<u64, 2> releasedBuffers;
+        auto released{span(releasedBuffers).first(track->GetReleasedBuffers(releasedBuffers))};
 
         for (auto &tag : released) {
-            MixFinalBuffer();
+            performanceManager.BeginFrame();
+            auto &sampleBuffer{sampleBuffers[tag]};
+            MixFinalBuffer(sampleBuffer);
+
+            auto sinkStartTime{util::GetTimeNs()};
             track->AppendBuffer(tag, sampleBuffer);
+            performanceManager.AddEntry(PerformanceEntryType::Sink, 0, sinkStartTime, util::GetTimeNs());
+            performanceManager.EndFrame();
         }
+
+        return !released.empty();
     }
 
-    void IAudioRenderer::MixFinalBuffer() {
-        u32 writtenSamples{};
+    void IAudioRenderer::MixVoice(Voice &voice, MixBuffer &accumulator) {
+        auto &timing{voiceTimings[static_cast<size_t>(&voice - voices.data())]};
+        timing.startTime = util::GetTimeNs();
+
+        u32 bufferOffset{};
+        u32 pendingSamples{constant::MixBufferSize};
+
+        while (pendingSamples > 0) {
+            u32 voiceBufferOffset{};
+            u32 voiceBufferSize{};
+            auto &voiceSamples{voice.GetBufferData(pendingSamples, voiceBufferOffset, voiceBufferSize)};
 
-        for (auto &voice : voices) {
-            if (!voice.Playable())
-                continue;
+            if (voiceBufferSize == 0)
+                break;
 
-            u32 bufferOffset{};
-            u32 pendingSamples{constant::MixBufferSize};
+            pendingSamples -= voiceBufferSize / constant::ChannelCount;
 
-            while (pendingSamples > 0) {
-                u32 voiceBufferOffset{};
-                u32 voiceBufferSize{};
-                auto &voiceSamples{voice.GetBufferData(pendingSamples, voiceBufferOffset, voiceBufferSize)};
+            for (auto index{voiceBufferOffset}; index < voiceBufferOffset + voiceBufferSize; index++)
+                accumulator[bufferOffset++] += static_cast<i32>(voiceSamples[index] * voice.volume);
+        }
 
-                if (voiceBufferSize == 0)
-                    break;
+        timing.endTime = util::GetTimeNs();
+    }
 
-                pendingSamples -= voiceBufferSize / constant::ChannelCount;
+    void IAudioRenderer::MixPartition(size_t partition, size_t partitionCount) {
+        auto &accumulator{mixAccumulators[partition]};
+        accumulator.fill(0);
 
-                for (auto index{voiceBufferOffset}; index < voiceBufferOffset + voiceBufferSize; index++) {
-                    if (writtenSamples == bufferOffset) {
-                        sampleBuffer[bufferOffset] = skyline::audio::Saturate<i16, i32>(voiceSamples[index] * voice.volume);
+        // Voices are strided across partitions rather than split into contiguous ranges as games tend to allocate voices of the same kind next to each other
+        for (size_t index{partition}; index < playableVoices.size(); index += partitionCount)
+            MixVoice(*playableVoices[index], accumulator);
+    }
 
-                        writtenSamples++;
-                    } else {
-                        sampleBuffer[bufferOffset] = skyline::audio::Saturate<i16, i32>(sampleBuffer[bufferOffset] + (voiceSamples[index] * voice.volume));
-                    }
+    void IAudioRenderer::MixFinalBuffer(span<i16> sampleBuffer) {
+        auto mixStartTime{util::GetTimeNs()};
+
+        playableVoices.clear();
+        for (auto &voice : voices)
+            if (voice.Playable())
+                playableVoices.push_back(&voice);
+
+        size_t partitionCount{std::clamp<size_t>(playableVoices.size() / MinVoicesPerPartition, 1, mixAccumulators.size())};
+        // The renderer thread mixes partitions itself rather than idling, the rest are mixed on performance cores as audio has a hard deadline
+        ThreadPool::Get().ParallelFor(partitionCount, [&](size_t partition) {
+            MixPartition(partition, partitionCount);
+        }, ThreadPool::Priority::High);
+
+        // The accumulators of all partitions are summed and saturated to the output format, 4 samples at a time
+        for (size_t index{}; index < sampleBuffer.size(); index += 4) {
+            int32x4_t sum{vld1q_s32(mixAccumulators[0].data() + index)};
+            for (size_t partition{1}; partition < partitionCount; partition++)
+                sum = vqaddq_s32(sum, vld1q_s32(mixAccumulators[partition].data() + index));
+            vst1_s16(sampleBuffer.data() + index, vqmovn_s32(sum));
+        }
 
-                    bufferOffset++;
-                }
-            }
+        for (auto voice : playableVoices) {
+            const auto &timing{voiceTimings[static_cast<size_t>(voice - voices.data())]};
+            performanceManager.AddEntry(PerformanceEntryType::Voice, voice->nodeId, timing.startTime, timing.endTime);
         }
+        performanceManager.AddEntry(PerformanceEntryType::FinalMix, 0, mixStartTime, util::GetTimeNs());
     }
 
     Result IAudioRenderer::Start(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
@@ -3,10 +3,12 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <services/serviceman.h>
 #include <audio.h>
 #include "memory_pool.h"
 #include "effect.h"
+#include "performance.h"
 #include "voice.h"
 #include "revision_info.h"
 
@@ -69,19 +71,59 @@ namespace skyline {
             std::vector<MemoryPool> memoryPools;
             std::vector<Effect> effects;
             std::vector<Voice> voices;
-            std::array<i16, constant::MixBufferSize * constant::ChannelCount> sampleBuffer{}; //!< The final output data that is appended to the stream
+            PerformanceManager performanceManager; //!< Records the processing time of rendered frames, this must only be accessed with `rendererMutex` held
+            static constexpr size_t SampleBufferCount{3}; //!< The amount of buffers the output is triple buffered with, these're identified by their tag in the track
+            std::array<std::array<i16, constant::MixBufferSize * constant::ChannelCount>, SampleBufferCount> sampleBuffers{}; //!< The final output data of every buffer, these're appended to the track without copying and only written to again once they're released
             skyline::audio::AudioOutState playbackState{skyline::audio::AudioOutState::Stopped};
 
+            static constexpr std::chrono::milliseconds RenderPeriod{5}; //!< The period at which the renderer thread runs, this matches the period of the ADSP's renderer
+            std::mutex rendererMutex; //!< Synchronizes the renderer thread with RequestUpdate, this protects the memory pools, voices and effects
+            std::condition_variable rendererCondition; //!< Wakes the renderer thread when it needs to exit
+            bool rendererExiting{}; //!< If the renderer thread should exit, this must only be accessed with `rendererMutex` held
+            std::thread rendererThread; //!< A thread which mixes voices into the track on a fixed period independently of the guest calling RequestUpdate
+
+            using MixBuffer = std::array<i32, constant::MixBufferSize * constant::ChannelCount>; //!< A buffer which voices are accumulated into at a higher precision than the output prior to being saturated
+
+            static constexpr size_t MaxMixPartitions{4}; //!< The maximum amount of partitions voices are split into, these are mixed concurrently on the renderer thread and the thread pool
+            static constexpr size_t MinVoicesPerPartition{8}; //!< The minimum amount of voices in a partition, mixing fewer voices than this on a worker costs more in synchronization than it saves
+            std::vector<Voice *> playableVoices; //!< The voices being mixed in the current buffer, this is only written by the renderer thread while no partitions are being mixed
+            /**
+             * @brief The time at which a voice was mixed in the current buffer in nanoseconds
+             */
+            struct VoiceTiming {
+                i64 startTime;
+                i64 endTime;
+            };
+            std::vector<VoiceTiming> voiceTimings; //!< The timing of every voice in the current buffer, this is indexed in the same way as `voices`
+            std::vector<MixBuffer> mixAccumulators; //!< The accumulator of each partition, the amount of these determines the maximum amount of partitions
+
+            /**
+             * @brief Accumulates a buffer worth of samples from a voice into the supplied accumulator and records the time taken to do so
+             */
+            void MixVoice(Voice &voice, MixBuffer &accumulator);
+
+            /**
+             * @brief Mixes every voice in a partition into the partition's accumulator, voices are assigned to partitions in a strided manner
+             */
+            void MixPartition(size_t partition, size_t partitionCount);
+
             /**
-             * @brief Obtains new sample data from voices and mixes it together into the sample buffer
-             * @return The amount of samples present in the buffer
+             * @brief Obtains new sample data from voices and mixes it together into the supplied sample buffer, voices are partitioned across the thread pool when there are enough of them
+             * @note `rendererMutex` MUST be locked when calling this
              */
-            void MixFinalBuffer();
+            void MixFinalBuffer(span<i16> sampleBuffer);
 
             /**
              * @brief Appends all released buffers with new mixed sample data
+             * @return If any buffers were appended
+             * @note `rendererMutex` MUST be locked when calling this
+             */
+            bool UpdateAudio();
+
+            /**
+             * @brief The entry point of the renderer thread, this updates the audio every render period till the renderer is destroyed
              */
-            void UpdateAudio();
+            void RendererThread();
 
           public:
             /**
@@ -90,7 +132,7 @@ namespace skyline {
             IAudioRenderer(const DeviceState &state, ServiceManager &manager, AudioRendererParameters &parameters);
 
             /**
-             * @brief Closes the audio track
+             * @brief Stops the renderer thread and closes the audio track
              */
             ~IAudioRenderer();
 
@@ -119,7 +161,7 @@ namespace skyline {
             Result GetState(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
             /**
-             * @brief Updates the audio renderer state and appends new data to playback buffers
+             * @brief Exchanges the parameters and status of the memory pools, voices and effects with the renderer thread
              */
             Result RequestUpdate(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
@@ -134,7 +176,7 @@ namespace skyline {
             Result Stop(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
             /**
-             * @brief Returns a handle to the sample release KEvent
+             * @brief Returns a handle to the KEvent that is signalled whenever the renderer thread has rendered a buffer
              */
             Result QuerySystemEvent(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/trace.h>
+#include "performance.h"
+
+namespace skyline::service::audio::IAudioRenderer {
+    constexpr u32 PerformanceMagic{util::MakeMagic<u32>("PERF")};
+
+    /**
+     * @return The duration between the supplied times in microseconds
+     */
+    static u32 ToMicroseconds(i64 startTime, i64 endTime) {
+        return static_cast<u32>(std::max<i64>(endTime - startTime, 0) / 1000);
+    }
+
+    void PerformanceManager::BeginFrame() {
+        entries.clear();
+        frameStartTime = util::GetTimeNs();
+    }
+
+    void PerformanceManager::AddEntry(PerformanceEntryType type, u32 nodeId, i64 startTime, i64 endTime) {
+        entries.push_back(Entry{type, nodeId, startTime, endTime});
+    }
+
+    void PerformanceManager::EndFrame() {
+        frameEndTime = util::GetTimeNs();
+        frameIndex++;
+
+        u32 voiceTime{}, mixTime{}, sinkTime{};
+        for (const auto &entry : entries) {
+            u32 time{ToMicroseconds(entry.startTime, entry.endTime)};
+            if (entry.type == PerformanceEntryType::Voice)
+                voiceTime += time;
+            else if (entry.type == PerformanceEntryType::FinalMix || entry.type == PerformanceEntryType::SubMix)
+                mixTime += time;
+            else if (entry.type == PerformanceEntryType::Sink)
+                sinkTime += time;
+        }
+
+        TRACE_COUNTER("service", perfetto::CounterTrack("Audio Render Time"), ToMicroseconds(frameStartTime, frameEndTime));
+        TRACE_COUNTER("service", perfetto::CounterTrack("Audio Voice Time"), voiceTime);
+        TRACE_COUNTER("service", perfetto::CounterTrack("Audio Mix Time"), mixTime);
+        TRACE_COUNTER("service", perfetto::CounterTrack("Audio Sink Time"), sinkTime);
+    }
+
+    template<typename FrameHeader, typename PerformanceEntry>
+    static size_t WriteFrame(span<u8> buffer, u32 frameIndex, i64 frameStartTime, i64 frameEndTime, auto &entries) {
+        size_t frameSize{sizeof(FrameHeader) + (entries.size() * sizeof(PerformanceEntry))};
+        if (buffer.size() < frameSize)
+            return 0;
+
+        FrameHeader header{
+            .magic = PerformanceMagic,
+            .entryCount = static_cast<u32>(entries.size()),
+            .nextOffset = static_cast<u32>(frameSize),
+            .totalProcessingTime = ToMicroseconds(frameStartTime, frameEndTime),
+        };
+        header.frameIndex = frameIndex;
+        if constexpr (std::is_same_v<FrameHeader, PerformanceFrameHeaderV2>)
+            header.startTime = static_cast<u64>(frameStartTime / 1000);
+        buffer.as<FrameHeader, true>() = header;
+
+        auto output{reinterpret_cast<PerformanceEntry *>(buffer.data() + sizeof(FrameHeader))};
+        for (const auto &entry : entries)
+            *output++ = PerformanceEntry{
+                .nodeId = entry.nodeId,
+                .startTime = ToMicroseconds(frameStartTime, entry.startTime),
+                .processingTime = ToMicroseconds(entry.startTime, entry.endTime),
+                .type = entry.type,
+            };
+
+        return frameSize;
+    }
+
+    void PerformanceManager::WriteHistory(span<u8> buffer, bool formatV2) {
+        output.historySize = 0;
+        if (frameIndex == writtenFrameIndex)
+            return; // No frames have been rendered since the last update
+
+        if (formatV2)
+            output.historySize = static_cast<u32>(WriteFrame<PerformanceFrameHeaderV2, PerformanceEntryV2>(buffer, frameIndex, frameStartTime, frameEndTime, entries));
+        else
+            output.historySize = static_cast<u32>(WriteFrame<PerformanceFrameHeaderV1, PerformanceEntryV1>(buffer, frameIndex, frameStartTime, frameEndTime, entries));
+
+        if (output.historySize)
+            writtenFrameIndex = frameIndex;
+    }
+}
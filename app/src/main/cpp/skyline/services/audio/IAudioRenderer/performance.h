@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::service::audio::IAudioRenderer {
+    enum class PerformanceEntryType : u8 {
+        Invalid = 0,
+        Voice = 1,
+        SubMix = 2,
+        FinalMix = 3,
+        Sink = 4,
+    };
+
+    /**
+     * @brief The header of a single rendered frame in the performance history prior to revision 5
+     */
+    struct PerformanceFrameHeaderV1 {
+        u32 magic; //!< "PERF"
+        u32 entryCount;
+        u32 detailCount;
+        u32 nextOffset; //!< The offset of the next frame's header from this one
+        u32 totalProcessingTime; //!< The time taken to render the frame in microseconds
+        u32 frameIndex;
+    };
+    static_assert(sizeof(PerformanceFrameHeaderV1) == 0x18);
+
+    /**
+     * @brief The header of a single rendered frame in the performance history from revision 5 onwards
+     */
+    struct PerformanceFrameHeaderV2 {
+        u32 magic; //!< "PERF"
+        u32 entryCount;
+        u32 detailCount;
+        u32 nextOffset; //!< The offset of the next frame's header from this one
+        u32 totalProcessingTime; //!< The time taken to render the frame in microseconds
+        u32 voicesDropped;
+        u64 startTime; //!< The time at which rendering of the frame started in microseconds
+        u32 frameIndex;
+        bool renderTimeExceeded;
+        u8 _pad0_[0xB];
+    };
+    static_assert(sizeof(PerformanceFrameHeaderV2) == 0x30);
+
+    struct PerformanceEntryV1 {
+        u32 nodeId;
+        u32 startTime; //!< The time at which processing of the node started in microseconds relative to the start of the frame
+        u32 processingTime; //!< The time taken to process the node in microseconds
+        PerformanceEntryType type;
+        u8 _pad0_[0x3];
+    };
+    static_assert(sizeof(PerformanceEntryV1) == 0x10);
+
+    struct PerformanceEntryV2 {
+        u32 nodeId;
+        u32 startTime; //!< The time at which processing of the node started in microseconds relative to the start of the frame
+        u32 processingTime; //!< The time taken to process the node in microseconds
+        PerformanceEntryType type;
+        u8 _pad0_[0xB];
+    };
+    static_assert(sizeof(PerformanceEntryV2) == 0x18);
+
+    /**
+     * @brief Returned to inform the guest of the amount of data written into the performance buffer
+     */
+    struct PerformanceManagerOut {
+        u32 historySize;
+        u32 _pad0_[3];
+    };
+    static_assert(sizeof(PerformanceManagerOut) == 0x10);
+
+    /**
+     * @brief The PerformanceManager class records the time taken to process every node of a rendered frame, this is reported to the guest in the performance buffer of RequestUpdate and as Perfetto counters
+     */
+    class PerformanceManager {
+      private:
+        struct Entry {
+            PerformanceEntryType type;
+            u32 nodeId;
+            i64 startTime; //!< The time at which processing of the node started in nanoseconds
+            i64 endTime; //!< The time at which processing of the node ended in nanoseconds
+        };
+
+        std::vector<Entry> entries; //!< The entries of the frame which is being rendered or was most recently rendered
+        i64 frameStartTime{}; //!< The time at which rendering of the frame started in nanoseconds
+        i64 frameEndTime{};
+        u32 frameIndex{}; //!< The index of the most recently rendered frame
+        u32 writtenFrameIndex{}; //!< The index of the most recently rendered frame that was written into the guest's performance buffer
+
+      public:
+        PerformanceManagerOut output{};
+
+        /**
+         * @brief Discards the entries of the prior frame and starts timing a new frame
+         */
+        void BeginFrame();
+
+        /**
+         * @brief Records the processing time of a node in the current frame
+         */
+        void AddEntry(PerformanceEntryType type, u32 nodeId, i64 startTime, i64 endTime);
+
+        /**
+         * @brief Finishes timing the current frame and publishes its timing as Perfetto counters
+         */
+        void EndFrame();
+
+        /**
+         * @brief Writes the most recently rendered frame into the guest's performance buffer if it hasn't been written yet
+         * @param formatV2 If the revision 5 performance metrics format should be used
+         */
+        void WriteHistory(span<u8> buffer, bool formatV2);
+    };
+}
@@ -29,6 +29,8 @@ namespace skyline::service::audio::IAudioRenderer {
         if (!acquired)
             return;
 
+        nodeId = input.nodeId;
+
         if (input.firstUpdate) {
             if (input.format != skyline::audio::AudioFormat::Int16 && input.format != skyline::audio::AudioFormat::ADPCM)
                 throw exception("Unsupported voice PCM format: {}", input.format);
@@ -69,15 +71,20 @@ namespace skyline::service::audio::IAudioRenderer {
                 span(samples).copy_from(buffer);
                 break;
             case skyline::audio::AudioFormat::ADPCM: {
-                samples = adpcmDecoder->Decode(buffer);
+                samples.resize(skyline::audio::AdpcmDecoder::GetOutputSize(buffer.size()));
+                adpcmDecoder->Decode(buffer, samples);
                 break;
             }
             default:
                 throw exception("Unsupported PCM format used by Voice: {}", format);
         }
 
-        if (sampleRate != constant::SampleRate)
-            samples = resampler.ResampleBuffer(samples, static_cast<double>(sampleRate) / constant::SampleRate, channelCount);
+        if (sampleRate != constant::SampleRate) {
+            auto ratio{static_cast<double>(sampleRate) / constant::SampleRate};
+            resampledSamples.resize(skyline::audio::Resampler::GetOutputSize(samples.size(), ratio, channelCount));
+            resampler.ResampleBuffer(samples, resampledSamples, ratio, channelCount);
+            std::swap(samples, resampledSamples);
+        }
 
         if (channelCount == 1 && constant::ChannelCount != channelCount) {
             auto originalSize{samples.size()};
@@ -77,6 +77,7 @@ namespace skyline::service::audio::IAudioRenderer {
         const DeviceState &state;
         std::array<WaveBuffer, 4> waveBuffers;
         std::vector<i16> samples; //!< A vector containing processed sample data
+        std::vector<i16> resampledSamples; //!< A vector which samples are resampled into prior to being swapped with `samples`, this retains its allocation across wave buffers
         skyline::audio::Resampler resampler; //!< The resampler object used for changing the sample rate of a wave buffer's stream
         std::optional<skyline::audio::AdpcmDecoder> adpcmDecoder;
 
@@ -103,6 +104,7 @@ namespace skyline::service::audio::IAudioRenderer {
       public:
         VoiceOut output{};
         float volume{};
+        u32 nodeId{}; //!< The ID of the voice's node in the audio graph, this is used to identify it in performance entries
 
         Voice(const DeviceState &state);
 
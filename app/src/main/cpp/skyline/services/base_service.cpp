@@ -3,7 +3,9 @@
 
 #include <cxxabi.h>
 #include <common/trace.h>
+#include <common/flight_recorder.h>
 #include "base_service.h"
+#include "service_statistics.h"
 
 namespace skyline::service {
     const std::string &BaseService::GetName() {
@@ -20,17 +22,36 @@ namespace skyline::service {
     }
 
     Result service::BaseService::HandleRequest(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        struct CachedFunction {
+            u64 instanceId;
+            u32 id;
+            ServiceFunctionDescriptor function;
+        };
+        constexpr size_t FunctionCacheSize{8}; //!< The amount of entries in the direct-mapped function cache, this must be a power of 2
+        static thread_local std::array<CachedFunction, FunctionCacheSize> functionCache{};
+
+        u32 id{request.payload->value};
+        auto &cached{functionCache[(instanceId ^ id) & (FunctionCacheSize - 1)]};
         ServiceFunctionDescriptor function;
-        try {
-            function = GetServiceFunction(request.payload->value);
-            Logger::DebugNoPrefix("Service: {}", function.name);
-        } catch (const std::out_of_range &) {
-            Logger::Warn("Cannot find function in service '{0}': 0x{1:X} ({1})", GetName(), static_cast<u32>(request.payload->value));
-            return {};
+        if (cached.instanceId == instanceId && cached.id == id) [[likely]] {
+            function = cached.function;
+        } else {
+            try {
+                function = GetServiceFunction(id);
+            } catch (const std::out_of_range &) {
+                Logger::Warn("Cannot find function in service '{0}': 0x{1:X} ({1})", GetName(), id);
+                return {};
+            }
+            cached = {instanceId, id, function};
         }
+        Logger::DebugNoPrefix("Service: {}", function.name);
         TRACE_EVENT("service", perfetto::StaticString{function.name});
+        trace::FlightRecorder::Record(trace::FlightRecorder::EventType::IpcRequest, id, reinterpret_cast<u64>(function.name));
         try {
-            return function(session, request, response);
+            u64 startTicks{util::GetTimeTicks()};
+            auto result{function(session, request, response)};
+            ServiceStatistics::Record(function.name, startTicks, util::GetTimeTicks());
+            return result;
         } catch (const std::exception &e) {
             throw exception("{} (Service: {})", e.what(), function.name);
         }
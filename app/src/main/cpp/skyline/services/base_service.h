@@ -43,6 +43,8 @@ namespace skyline::service {
     class BaseService {
       private:
         std::string name; //!< The name of the service, it's only assigned after GetName is called and shouldn't be used directly
+        static inline std::atomic<u64> nextInstanceId{1};
+        u64 instanceId{nextInstanceId.fetch_add(1, std::memory_order_relaxed)}; //!< A unique identifier for this service object, the function cache is keyed by this rather than the address as addresses may be reused
 
       protected:
         const DeviceState &state;
@@ -83,6 +85,7 @@ namespace skyline::service {
 
         /**
          * @brief Handles an IPC Request to a service
+         * @note The resolved function is cached in a small thread-local cache keyed by the service object and command ID, so repeated calls skip GetServiceFunction
          */
         Result HandleRequest(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
     };
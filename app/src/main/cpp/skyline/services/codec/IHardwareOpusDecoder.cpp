@@ -11,19 +11,39 @@ namespace skyline::service::codec {
         return util::AlignUp(static_cast<u32>(frameSize * channelCount / (OpusFullbandSampleRate / sampleRate)), 0x40);
     }
 
+    u32 CalculateDecoderStateSize(i32 streamCount, i32 stereoStreamCount) {
+        auto size{opus_multistream_decoder_get_size(streamCount, stereoStreamCount)};
+        if (!size)
+            throw exception("Invalid Opus stream configuration: {} streams ({} stereo)", streamCount, stereoStreamCount);
+        return static_cast<u32>(size);
+    }
+
     IHardwareOpusDecoder::IHardwareOpusDecoder(const DeviceState &state, ServiceManager &manager, i32 sampleRate, i32 channelCount, u32 workBufferSize, KHandle workBufferHandle)
+        : IHardwareOpusDecoder(state, manager, MultiStreamParameters{
+            .sampleRate = sampleRate,
+            .channelCount = channelCount,
+            .streamCount = 1,
+            .stereoStreamCount = channelCount == 2 ? 1 : 0,
+            .mappings = {0, 1},
+        }, workBufferSize, workBufferHandle) {}
+
+    IHardwareOpusDecoder::IHardwareOpusDecoder(const DeviceState &state, ServiceManager &manager, const MultiStreamParameters &parameters, u32 workBufferSize, KHandle workBufferHandle)
         : BaseService(state, manager),
-          sampleRate(sampleRate),
-          channelCount(channelCount),
+          sampleRate(parameters.sampleRate),
+          channelCount(parameters.channelCount),
           workBuffer(state.process->GetHandle<kernel::type::KTransferMemory>(workBufferHandle)),
-          decoderOutputBufferSize(CalculateOutBufferSize(sampleRate, channelCount, MaxFrameSizeNormal)) {
-        if (workBufferSize < decoderOutputBufferSize)
-            throw exception("Work Buffer doesn't have adequate space for Opus Decoder: 0x{:X} (Required: 0x{:X})", workBufferSize, decoderOutputBufferSize);
+          decoderOutputBufferSize(CalculateOutBufferSize(parameters.sampleRate, parameters.channelCount, MaxFrameSizeNormal)) {
+        if (parameters.channelCount <= 0 || parameters.channelCount > static_cast<i32>(parameters.mappings.size()))
+            throw exception("Invalid Opus channel count: {}", parameters.channelCount);
+
+        u32 decoderStateSize{CalculateDecoderStateSize(parameters.streamCount, parameters.stereoStreamCount)};
+        if (workBufferSize < decoderStateSize || workBuffer->host.size < decoderStateSize)
+            throw exception("Work Buffer doesn't have adequate space for Opus Decoder: 0x{:X} (Required: 0x{:X})", workBufferSize, decoderStateSize);
 
-        // We utilize the guest-supplied work buffer for allocating the OpusDecoder object into
-        decoderState = reinterpret_cast<OpusDecoder *>(workBuffer->host.ptr);
+        // We utilize the guest-supplied work buffer for allocating the OpusMSDecoder object into, this avoids any host allocations for decoder states
+        decoderState = reinterpret_cast<OpusMSDecoder *>(workBuffer->host.ptr);
 
-        if (int result = opus_decoder_init(decoderState, sampleRate, channelCount) != OPUS_OK)
+        if (int result{opus_multistream_decoder_init(decoderState, sampleRate, channelCount, parameters.streamCount, parameters.stereoStreamCount, parameters.mappings.data())}; result != OPUS_OK)
             throw OpusException(result);
     }
 
@@ -44,7 +64,7 @@ namespace skyline::service::codec {
     }
 
     void IHardwareOpusDecoder::ResetContext() {
-        opus_decoder_ctl(decoderState, OPUS_RESET_STATE);
+        opus_multistream_decoder_ctl(decoderState, OPUS_RESET_STATE);
     }
 
     Result IHardwareOpusDecoder::DecodeInterleavedImpl(ipc::IpcRequest &request, ipc::IpcResponse &response, bool writeDecodeTime) {
@@ -63,7 +83,9 @@ namespace skyline::service::codec {
         auto sampleDataIn = dataIn.subspan(sizeof(OpusDataHeader));
 
         auto perfTimer{timesrv::TimeSpanType::FromNanoseconds(util::GetTimeNs())};
-        i32 decodedCount{opus_decode(decoderState, sampleDataIn.data(), opusPacketSize, dataOut.data(), static_cast<int>(decoderOutputBufferSize), false)};
+        // The frame size is limited by the output buffer rather than the maximum frame size as libopus writes all decoded samples directly into it
+        auto maxFrameSize{std::min(static_cast<i32>(dataOut.size() / static_cast<size_t>(channelCount)), MaxFrameSizeNormal)};
+        i32 decodedCount{opus_multistream_decode(decoderState, sampleDataIn.data(), opusPacketSize, dataOut.data(), maxFrameSize, false)};
         perfTimer = timesrv::TimeSpanType::FromNanoseconds(util::GetTimeNs()) - perfTimer;
 
         if (decodedCount < 0)
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <opus.h>
+#include <opus_multistream.h>
 
 #include <common.h>
 #include <services/base_service.h>
@@ -20,6 +21,24 @@ namespace skyline::service::codec {
     static constexpr i32 MaxFrameSizeEx{static_cast<u32>(OpusFullbandSampleRate * 0.120f)}; //!< 120ms frame size limit for ex decoders added in 12.0.0
     static constexpr u32 MaxInputBufferSize{0x600}; //!< Maximum allocated size of the input buffer
 
+    /**
+     * @brief Initialization parameters for the Opus multi-stream decoder
+     * @see opus_multistream_decoder_init()
+     */
+    struct MultiStreamParameters {
+        i32 sampleRate;
+        i32 channelCount;
+        i32 streamCount;
+        i32 stereoStreamCount;
+        std::array<u8, 0x100> mappings; //!< Array of channel mappings
+    };
+    static_assert(sizeof(MultiStreamParameters) == 0x110);
+
+    /**
+     * @return The size of the decoder state for an Opus stream with the given parameters
+     */
+    u32 CalculateDecoderStateSize(i32 streamCount, i32 stereoStreamCount);
+
     /**
      * @note The Switch has a HW Opus Decoder which this service would interface with, we emulate it using libopus with CPU-decoding
      * @url https://switchbrew.org/wiki/Audio_services#IHardwareOpusDecoder
@@ -27,7 +46,7 @@ namespace skyline::service::codec {
     class IHardwareOpusDecoder : public BaseService {
       private:
         std::shared_ptr<kernel::type::KTransferMemory> workBuffer;
-        OpusDecoder *decoderState{};
+        OpusMSDecoder *decoderState{}; //!< A multi-stream decoder is used for all streams as it has no overhead for single stream packets, this allows for a single decode path
         i32 sampleRate;
         i32 channelCount;
         u32 decoderOutputBufferSize;
@@ -58,8 +77,16 @@ namespace skyline::service::codec {
         Result DecodeInterleavedImpl(ipc::IpcRequest &request, ipc::IpcResponse &response, bool writeDecodeTime = false);
 
       public:
+        /**
+         * @brief Creates a decoder for a single stream
+         */
         IHardwareOpusDecoder(const DeviceState &state, ServiceManager &manager, i32 sampleRate, i32 channelCount, u32 workBufferSize, KHandle workBufferHandle);
 
+        /**
+         * @brief Creates a decoder for multiple streams with the supplied channel mappings
+         */
+        IHardwareOpusDecoder(const DeviceState &state, ServiceManager &manager, const MultiStreamParameters &parameters, u32 workBufferSize, KHandle workBufferHandle);
+
         /**
          * @brief Decodes the Opus source data, returns decoded data size and decoded sample count
          * @url https://switchbrew.org/wiki/Audio_services#DecodeInterleavedOld
@@ -79,11 +106,16 @@ namespace skyline::service::codec {
          */
         Result DecodeInterleaved(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
+        // The ForMultiStream variants of commands are identical to their single stream counterparts as all decoders are multi-stream decoders
         SERVICE_DECL(
             SFUNC(0x0, IHardwareOpusDecoder, DecodeInterleavedOld),
+            SFUNC(0x1, IHardwareOpusDecoder, DecodeInterleavedOld),
             SFUNC(0x4, IHardwareOpusDecoder, DecodeInterleavedWithPerfOld),
+            SFUNC(0x5, IHardwareOpusDecoder, DecodeInterleavedWithPerfOld),
             SFUNC(0x6, IHardwareOpusDecoder, DecodeInterleaved), // DecodeInterleavedWithPerfAndResetOld is effectively the same as DecodeInterleaved
+            SFUNC(0x7, IHardwareOpusDecoder, DecodeInterleaved),
             SFUNC(0x8, IHardwareOpusDecoder, DecodeInterleaved),
+            SFUNC(0x9, IHardwareOpusDecoder, DecodeInterleaved),
         )
     };
 
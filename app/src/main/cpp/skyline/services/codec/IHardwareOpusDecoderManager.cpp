@@ -7,8 +7,8 @@
 #include "IHardwareOpusDecoder.h"
 
 namespace skyline::service::codec {
-    static u32 CalculateBufferSize(i32 sampleRate, i32 channelCount) {
-        u32 requiredSize{static_cast<u32>(opus_decoder_get_size(channelCount))};
+    static u32 CalculateBufferSize(i32 sampleRate, i32 channelCount, i32 streamCount, i32 stereoStreamCount) {
+        u32 requiredSize{CalculateDecoderStateSize(streamCount, stereoStreamCount)};
         requiredSize += MaxInputBufferSize + CalculateOutBufferSize(sampleRate, channelCount, MaxFrameSizeNormal);
         return requiredSize;
     }
@@ -29,7 +29,25 @@ namespace skyline::service::codec {
         i32 sampleRate{request.Pop<i32>()};
         i32 channelCount{request.Pop<i32>()};
 
-        response.Push<u32>(CalculateBufferSize(sampleRate, channelCount));
+        response.Push<u32>(CalculateBufferSize(sampleRate, channelCount, 1, channelCount == 2 ? 1 : 0));
+        return {};
+    }
+
+    Result IHardwareOpusDecoderManager::OpenHardwareOpusDecoderForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &parameters{request.inputBuf.at(0).as<MultiStreamParameters>()};
+        u32 workBufferSize{request.Pop<u32>()};
+        KHandle workBuffer{request.copyHandles.at(0)};
+
+        Logger::Debug("Creating multi-stream Opus decoder: Sample rate: {}, Channel count: {}, Stream count: {} ({} stereo), Work buffer handle: 0x{:X} (Size: 0x{:X})", parameters.sampleRate, parameters.channelCount, parameters.streamCount, parameters.stereoStreamCount, workBuffer, workBufferSize);
+
+        manager.RegisterService(std::make_shared<IHardwareOpusDecoder>(state, manager, parameters, workBufferSize, workBuffer), session, response);
+        return {};
+    }
+
+    Result IHardwareOpusDecoderManager::GetWorkBufferSizeForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &parameters{request.inputBuf.at(0).as<MultiStreamParameters>()};
+
+        response.Push<u32>(CalculateBufferSize(parameters.sampleRate, parameters.channelCount, parameters.streamCount, parameters.stereoStreamCount));
         return {};
     }
 }
@@ -6,19 +6,6 @@
 #include <services/base_service.h>
 
 namespace skyline::service::codec {
-    /**
-     * @brief Initialization parameters for the Opus multi-stream decoder
-     * @see opus_multistream_decoder_init()
-     */
-    struct MultiStreamParameters {
-        i32 sampleRate;
-        i32 channelCount;
-        i32 streamCount;
-        i32 stereoStreamCount;
-        std::array<u8, 0x100> mappings; //!< Array of channel mappings
-    };
-    static_assert(sizeof(MultiStreamParameters) == 0x110);
-
     /**
      * @brief Manages all instances of IHardwareOpusDecoder
      * @url https://switchbrew.org/wiki/Audio_services#hwopus
@@ -39,9 +26,23 @@ namespace skyline::service::codec {
          */
         Result GetWorkBufferSize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
+        /**
+         * @brief Returns an IHardwareOpusDecoder object which decodes multi-stream Opus packets
+         * @url https://switchbrew.org/wiki/Audio_services#OpenHardwareOpusDecoderForMultiStream
+         */
+        Result OpenHardwareOpusDecoderForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the required size for a multi-stream decoder's work buffer
+         * @url https://switchbrew.org/wiki/Audio_services#GetWorkBufferSizeForMultiStream
+         */
+        Result GetWorkBufferSizeForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
         SERVICE_DECL(
             SFUNC(0x0, IHardwareOpusDecoderManager, OpenHardwareOpusDecoder),
             SFUNC(0x1, IHardwareOpusDecoderManager, GetWorkBufferSize),
+            SFUNC(0x2, IHardwareOpusDecoderManager, OpenHardwareOpusDecoderForMultiStream),
+            SFUNC(0x3, IHardwareOpusDecoderManager, GetWorkBufferSizeForMultiStream),
         )
     };
 }
@@ -24,20 +24,25 @@ namespace skyline::service::fssrv {
     IDirectory::IDirectory(std::shared_ptr<vfs::Directory> backing, std::shared_ptr<vfs::FileSystem> backingFs, const DeviceState &state, ServiceManager &manager) : backing(std::move(backing)), backingFs(std::move(backingFs)), BaseService(state, manager) {}
 
     Result IDirectory::Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        auto entries{backing->Read()};
         auto outputEntries{request.outputBuf.at(0).cast<DirectoryEntry, std::dynamic_extent, true>()};
         size_t i{};
 
-        for (; i < std::min(entries.size(), outputEntries.size()); i++) {
-            auto &entry{entries.at(i)};
-
-            outputEntries[i] = {
-                .type = entry.type,
-                .attributes.directory = (entry.type == vfs::Directory::EntryType::Directory),
-                .size = entry.size,
+        // Entries are streamed directly into the output buffer, the directory's cursor persists across calls so subsequent reads continue where this one left off
+        for (; i < outputEntries.size(); i++) {
+            auto entry{backing->ReadNext()};
+            if (!entry)
+                break;
+
+            auto &outputEntry{outputEntries[i]};
+            outputEntry = {
+                .attributes.directory = (entry->type == vfs::Directory::EntryType::Directory),
+                .type = entry->type,
+                .size = entry->size,
             };
 
-            span(outputEntries[i].name).copy_from(entry.name);
+            // The name is always null-terminated as the entry was zero-initialized above
+            std::string_view name{entry->name.substr(0, outputEntry.name.size() - 1)};
+            std::memcpy(outputEntry.name.data(), name.data(), name.size());
         }
 
         response.Push<u64>(i);
@@ -2,6 +2,7 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include "results.h"
+#include "io_scheduler.h"
 #include "IFile.h"
 
 namespace skyline::service::fssrv {
@@ -25,7 +26,22 @@ namespace skyline::service::fssrv {
             return result::InvalidSize;
         }
 
-        response.Push<u64>(backing->ReadUnchecked(request.outputBuf.at(0), static_cast<size_t>(offset)));
+        auto output{request.outputBuf.at(0)};
+        if (static_cast<size_t>(offset) < backing->size) {
+            // Backings with their contents in memory are copied from directly rather than going through the read path of every backing they're layered on
+            size_t readSize{std::min(output.size(), backing->size - static_cast<size_t>(offset))};
+            auto view{backing->ReadView(static_cast<size_t>(offset), readSize)};
+            if (!view.empty()) {
+                output.copy_from(view, readSize);
+                response.Push<u64>(readSize);
+                return {};
+            }
+        }
+
+        if (output.size() >= IoScheduler::MinAsyncReadSize)
+            response.Push<u64>(IoScheduler::Get().Read(backing, output, static_cast<size_t>(offset)));
+        else
+            response.Push<u64>(backing->ReadUnchecked(output, static_cast<size_t>(offset)));
         return {};
     }
 
@@ -59,6 +75,7 @@ namespace skyline::service::fssrv {
     }
 
     Result IFile::Flush(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        backing->Flush();
         return {};
     }
 
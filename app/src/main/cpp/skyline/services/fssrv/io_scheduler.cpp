@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/trace.h>
+#include <common/host_affinity.h>
+#include "io_scheduler.h"
+
+namespace skyline::service::fssrv {
+    IoScheduler::IoScheduler() {
+        for (size_t i{}; i < WorkerCount; i++)
+            std::thread(&IoScheduler::Run, this).detach();
+    }
+
+    IoScheduler &IoScheduler::Get() {
+        static auto *scheduler{new IoScheduler()}; // The scheduler is intentionally leaked as detached workers wait on it for the lifetime of the process
+        return *scheduler;
+    }
+
+    void IoScheduler::Run() {
+        pthread_setname_np(pthread_self(), "IoScheduler");
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Background);
+
+        std::vector<ReadRequest *> batch;
+        std::unique_lock lock(mutex);
+        while (true) {
+            requestCondition.wait(lock, [this]() { return !requests.empty(); });
+
+            auto first{requests.front()};
+            size_t start{first->offset}, end{first->offset + first->output.size()};
+            auto it{std::next(requests.begin())};
+            for (; it != requests.end(); it++) {
+                auto request{*it};
+                size_t requestEnd{request->offset + request->output.size()};
+                if (request->backing != first->backing || request->offset > end || std::max(end, requestEnd) - start > MaxCoalescedSize)
+                    break;
+                end = std::max(end, requestEnd);
+            }
+
+            batch.assign(requests.begin(), it);
+            requests.erase(requests.begin(), it);
+            lock.unlock();
+
+            Service(batch, start, end);
+
+            lock.lock();
+            for (auto request : batch)
+                request->complete = true;
+            batch.clear();
+            completionCondition.notify_all();
+        }
+    }
+
+    void IoScheduler::Service(span<ReadRequest *> batch, size_t start, size_t end) {
+        TRACE_EVENT("service", "IoScheduler::Service", "requests", batch.size(), "size", end - start);
+
+        auto &backing{batch.front()->backing};
+        try {
+            if (batch.size() == 1) {
+                batch.front()->readSize = backing->ReadUnchecked(batch.front()->output, start);
+                return;
+            }
+
+            std::vector<u8> buffer(end - start);
+            size_t bufferSize{backing->ReadUnchecked(buffer, start)};
+            for (auto request : batch) {
+                size_t bufferOffset{request->offset - start};
+                request->readSize = bufferOffset < bufferSize ? std::min(request->output.size(), bufferSize - bufferOffset) : 0;
+                std::memcpy(request->output.data(), buffer.data() + bufferOffset, request->readSize);
+            }
+        } catch (...) {
+            for (auto request : batch)
+                request->exception = std::current_exception();
+        }
+    }
+
+    size_t IoScheduler::Read(const std::shared_ptr<vfs::Backing> &backing, span<u8> output, size_t offset) {
+        ReadRequest request{backing, output, offset};
+
+        std::unique_lock lock(mutex);
+        requests.insert(std::upper_bound(requests.begin(), requests.end(), &request, [](ReadRequest *lhs, ReadRequest *rhs) {
+            return std::tie(lhs->backing, lhs->offset) < std::tie(rhs->backing, rhs->offset);
+        }), &request);
+        requestCondition.notify_one();
+
+        completionCondition.wait(lock, [&request]() { return request.complete; });
+        lock.unlock();
+
+        if (request.exception)
+            std::rethrow_exception(request.exception);
+        return request.readSize;
+    }
+}
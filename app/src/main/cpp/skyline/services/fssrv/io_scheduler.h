@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <vfs/backing.h>
+
+namespace skyline::service::fssrv {
+    /**
+     * @brief The IoScheduler class services file reads from guest threads on a pool of I/O workers
+     * @note Pending reads are sorted by backing and offset, the lowest one is serviced first and any pending reads that are adjacent to or overlap it on the same backing are coalesced into a single read
+     */
+    class IoScheduler {
+      private:
+        struct ReadRequest {
+            std::shared_ptr<vfs::Backing> backing;
+            span<u8> output;
+            size_t offset;
+            size_t readSize{}; //!< The amount of bytes that were read into the output
+            std::exception_ptr exception; //!< An exception which was thrown while servicing the read
+            bool complete{}; //!< If the request has been serviced, this is protected by the scheduler's mutex
+        };
+
+        static constexpr size_t WorkerCount{2};
+        static constexpr size_t MaxCoalescedSize{0x400000}; //!< The maximum size of a read which requests are coalesced into
+
+        std::mutex mutex;
+        std::condition_variable requestCondition; //!< Signalled on a request being queued
+        std::condition_variable completionCondition; //!< Signalled on any requests being completed
+        std::vector<ReadRequest *> requests; //!< Pending requests sorted by their backing and offset
+
+        IoScheduler();
+
+        void Run();
+
+        /**
+         * @brief Services a batch of adjacent requests on the same backing with a single read
+         * @param start The offset of the first request in the batch
+         * @param end The end offset of the request which extends the furthest
+         */
+        static void Service(span<ReadRequest *> batch, size_t start, size_t end);
+
+      public:
+        static constexpr size_t MinAsyncReadSize{0x4000}; //!< Reads smaller than this are cheaper to perform directly than to hand off to a worker
+
+        static IoScheduler &Get();
+
+        /**
+         * @brief Reads data from the backing on an I/O worker and blocks until the read has completed
+         * @return The amount of bytes read, this is the same as Backing::ReadUnchecked
+         * @note Guest threads are already descheduled from their core for the duration of an IPC request so blocking here doesn't stall any other guest thread
+         */
+        size_t Read(const std::shared_ptr<vfs::Backing> &backing, span<u8> output, size_t offset);
+    };
+}
@@ -53,10 +53,14 @@ namespace skyline::service::glue {
 
     Result ITimeZoneService::LoadTimeZoneRule(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         auto locationName{span(request.Pop<timesrv::LocationName>()).as_string(true)};
+        auto ruleOut{request.outputBuf.at(0)};
+        if (timesrvCore.timeZoneManager.GetCachedTimeZoneRule(locationName, ruleOut))
+            return {};
+
         auto timeZoneBinaryFile{state.os->assetFileSystem->OpenFile(fmt::format("tzdata/zoneinfo/{}", locationName))};
         std::vector<u8> timeZoneBinaryBuffer(timeZoneBinaryFile->size);
         timeZoneBinaryFile->Read(timeZoneBinaryBuffer);
-        return core->ParseTimeZoneBinary(timeZoneBinaryBuffer, request.outputBuf.at(0));
+        return timesrvCore.timeZoneManager.ParseAndCacheTimeZoneRule(locationName, timeZoneBinaryBuffer, ruleOut);
     }
 
     Result ITimeZoneService::GetTimeZoneRuleVersion(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
@@ -3,15 +3,36 @@
 // Copyright © 2005 The Android Open Source Project
 // Copyright © 2019-2020 Ryujinx Team and Contributors
 
+#include <common/settings.h>
 #include <gpu.h>
 #include <gpu/texture/format.h>
 #include <soc.h>
 #include <services/nvdrv/devices/nvmap.h>
+#include <services/nvdrv/core/syncpoint_manager.h>
 #include <services/common/fence.h>
 #include "GraphicBufferProducer.h"
 
 namespace skyline::service::hosbinder {
-    GraphicBufferProducer::GraphicBufferProducer(const DeviceState &state, nvdrv::core::NvMap &nvMap) : state(state), bufferEvent(std::make_shared<kernel::type::KEvent>(state, true)), nvMap(nvMap) {}
+    GraphicBufferProducer::GraphicBufferProducer(const DeviceState &state, nvdrv::core::NvMap &nvMap, nvdrv::core::SyncpointManager &syncpointManager) : state(state), bufferEvent(std::make_shared<kernel::type::KEvent>(state, true)), nvMap(nvMap), syncpointManager(syncpointManager) {}
+
+    GraphicBufferProducer::~GraphicBufferProducer() {
+        for (auto &slot : queue)
+            if (slot.presentFence.id)
+                syncpointManager.FreeSyncpoint(slot.presentFence.id);
+    }
+
+    /**
+     * @brief Increments a syncpoint once the fence cycle it's attached to has been signalled
+     */
+    struct SyncpointIncrement : public gpu::FenceCycleDependency {
+        soc::host1x::Syncpoint &syncpoint;
+
+        SyncpointIncrement(soc::host1x::Syncpoint &syncpoint) : syncpoint(syncpoint) {}
+
+        ~SyncpointIncrement() {
+            syncpoint.Increment();
+        }
+    };
 
     void GraphicBufferProducer::FreeGraphicBufferNvMap(GraphicBuffer &buffer) {
         auto surface{buffer.graphicHandle.surfaces.at(0)};
@@ -19,6 +40,81 @@ namespace skyline::service::hosbinder {
         nvMap.FreeHandle(nvMapHandleId, true);
     }
 
+    void GraphicBufferProducer::CreateTexture(BufferSlot &buffer) {
+        auto &graphicBuffer{*buffer.graphicBuffer};
+
+        auto &handle{graphicBuffer.graphicHandle};
+        if (handle.magic != NvGraphicHandle::Magic)
+            throw exception("Unexpected NvGraphicHandle magic: {}", handle.surfaceCount);
+        else if (handle.surfaceCount < 1)
+            throw exception("At least one surface is required in a buffer: {}", handle.surfaceCount);
+        else if (handle.surfaceCount > 1)
+            throw exception("Multi-planar surfaces are not supported: {}", handle.surfaceCount);
+
+        gpu::texture::Format format;
+        switch (handle.format) {
+            case AndroidPixelFormat::RGBA8888:
+            case AndroidPixelFormat::RGBX8888:
+                format = gpu::format::R8G8B8A8Unorm;
+                break;
+
+            case AndroidPixelFormat::RGB565:
+                format = gpu::format::R5G6B5Unorm;
+                break;
+
+            default:
+                throw exception("Unknown format in buffer: '{}' ({})", ToString(handle.format), static_cast<u32>(handle.format));
+        }
+
+        auto &surface{graphicBuffer.graphicHandle.surfaces.at(0)};
+        if (surface.scanFormat != NvDisplayScanFormat::Progressive)
+            throw exception("Non-Progressive surfaces are not supported: {}", ToString(surface.scanFormat));
+
+        // Duplicate the handle so it can't be freed by the guest
+        auto nvMapHandleObj{nvMap.GetHandle(surface.nvmapHandle ? surface.nvmapHandle : handle.nvmapId)};
+        if (auto err{nvMapHandleObj->Duplicate(true)}; err != PosixResult::Success)
+            throw exception("Failed to duplicate graphic buffer NvMap handle: {}!", static_cast<i32>(err));
+
+        if (surface.size > (nvMapHandleObj->origSize - surface.offset))
+            throw exception("Surface doesn't fit into NvMap mapping of size 0x{:X} when mapped at 0x{:X} -> 0x{:X}", nvMapHandleObj->origSize, surface.offset, surface.offset + surface.size);
+
+        gpu::texture::TileConfig tileConfig{};
+        if (surface.layout == NvSurfaceLayout::Blocklinear) {
+            tileConfig = {
+                .mode = gpu::texture::TileMode::Block,
+                .blockHeight = static_cast<u8>(1U << surface.blockHeightLog2),
+                .blockDepth = 1,
+            };
+        } else if (surface.layout == NvSurfaceLayout::Pitch) {
+            tileConfig = {
+                .mode = gpu::texture::TileMode::Pitch,
+                .pitch = surface.pitch,
+            };
+        } else if (surface.layout == NvSurfaceLayout::Tiled) {
+            throw exception("Legacy 16Bx16 tiled surfaces are not supported");
+        }
+
+        gpu::GuestTexture guestTexture(span<u8>(nvMapHandleObj->GetPointer() + surface.offset, surface.size), gpu::texture::Dimensions(surface.width, surface.height), format, tileConfig, gpu::texture::TextureType::e2D);
+        // Buffers which may be composited directly are created at the render scale with presentable backing so render targets aliasing them resolve to the same texture
+        bool presentable{state.settings->zeroCopyPresentation};
+        buffer.texture = state.gpu->texture.FindOrCreate(guestTexture, presentable ? state.settings->renderScale : 1.0f, presentable).backing;
+    }
+
+    void GraphicBufferProducer::ReplaceGraphicBuffer(BufferSlot &buffer, const GraphicBuffer *graphicBuffer) {
+        if (buffer.texture) {
+            if (graphicBuffer && std::memcmp(&buffer.graphicBuffer->graphicHandle, &graphicBuffer->graphicHandle, sizeof(NvGraphicHandle)) == 0) {
+                // The texture only depends on the surface in the handle, it can be retained if the guest rebinds the slot to the same surface
+                *buffer.graphicBuffer = *graphicBuffer;
+                return;
+            }
+
+            buffer.texture = {};
+            FreeGraphicBufferNvMap(*buffer.graphicBuffer);
+        }
+
+        buffer.graphicBuffer = graphicBuffer ? std::make_unique<GraphicBuffer>(*graphicBuffer) : nullptr;
+    }
+
     u32 GraphicBufferProducer::GetPendingBufferCount() {
         u32 count{};
         for (auto it{queue.begin()}, end{it + activeSlotCount}; it < end; it++)
@@ -69,9 +165,7 @@ namespace skyline::service::hosbinder {
             for (auto &slot : queue) {
                 slot.state = BufferState::Free;
                 slot.frameNumber = std::numeric_limits<u32>::max();
-                if (std::exchange(slot.texture, {}))
-                    FreeGraphicBufferNvMap(*slot.graphicBuffer);
-                slot.graphicBuffer = nullptr;
+                ReplaceGraphicBuffer(slot, nullptr);
             }
         } else if (preallocatedBufferCount < count) {
             Logger::Warn("Setting the active slot count ({}) higher than the amount of slots with preallocated buffers ({})", count, preallocatedBufferCount);
@@ -143,8 +237,19 @@ namespace skyline::service::hosbinder {
             return AndroidStatus::NoInit;
         }
 
+        if (buffer->texture)
+            state.gpu->presentation.WaitForRelease(*buffer->texture); // The compositor may still be reading from a buffer that it was handed directly
+
         buffer->state = BufferState::Dequeued;
-        fence = AndroidFence{}; // We just let the presentation engine return a buffer which is ready to be written into, there is no need for further synchronization
+        fence = AndroidFence{};
+        if (buffer->presentFence.id) {
+            // The host GPU may still be reading from the buffer for its last present, rather than blocking we hand the guest a fence for it to wait on prior to rendering into the buffer
+            syncpointManager.UpdateMin(buffer->presentFence.id);
+            if (!syncpointManager.IsFenceSignalled(buffer->presentFence)) {
+                fence.fenceCount = 1;
+                fence.fences[0] = buffer->presentFence;
+            }
+        }
 
         Logger::Debug("#{} - Dimensions: {}x{}, Format: {}, Usage: 0x{:X}, Is Async: {}", slot, width, height, ToString(format), usage, async);
         return AndroidStatus::Ok;
@@ -168,9 +273,7 @@ namespace skyline::service::hosbinder {
 
         bufferSlot.state = BufferState::Free;
         bufferSlot.frameNumber = std::numeric_limits<u32>::max();
-        if (std::exchange(bufferSlot.texture, {}))
-            FreeGraphicBufferNvMap(*bufferSlot.graphicBuffer);
-        bufferSlot.graphicBuffer = nullptr;
+        ReplaceGraphicBuffer(bufferSlot, nullptr);
 
         bufferEvent->Signal();
 
@@ -241,9 +344,7 @@ namespace skyline::service::hosbinder {
         bufferSlot->state = BufferState::Dequeued;
         bufferSlot->wasBufferRequested = true;
         bufferSlot->isPreallocated = false;
-        if (std::exchange(bufferSlot->texture, {}))
-            FreeGraphicBufferNvMap(*bufferSlot->graphicBuffer);
-        bufferSlot->graphicBuffer = std::make_unique<GraphicBuffer>(graphicBuffer);
+        ReplaceGraphicBuffer(*bufferSlot, &graphicBuffer);
 
         slot = static_cast<u8>(std::distance(queue.begin(), bufferSlot));
 
@@ -291,60 +392,7 @@ namespace skyline::service::hosbinder {
         if (!buffer.texture) [[unlikely]] {
             // We lazily create a texture if one isn't present at queue time, this allows us to look up the texture in the texture cache
             // If we deterministically know that the texture is written by the CPU then we can allocate a CPU-shared host texture for fast uploads
-
-            auto &handle{graphicBuffer.graphicHandle};
-            if (handle.magic != NvGraphicHandle::Magic)
-                throw exception("Unexpected NvGraphicHandle magic: {}", handle.surfaceCount);
-            else if (handle.surfaceCount < 1)
-                throw exception("At least one surface is required in a buffer: {}", handle.surfaceCount);
-            else if (handle.surfaceCount > 1)
-                throw exception("Multi-planar surfaces are not supported: {}", handle.surfaceCount);
-
-            gpu::texture::Format format;
-            switch (handle.format) {
-                case AndroidPixelFormat::RGBA8888:
-                case AndroidPixelFormat::RGBX8888:
-                    format = gpu::format::R8G8B8A8Unorm;
-                    break;
-
-                case AndroidPixelFormat::RGB565:
-                    format = gpu::format::R5G6B5Unorm;
-                    break;
-
-                default:
-                    throw exception("Unknown format in buffer: '{}' ({})", ToString(handle.format), static_cast<u32>(handle.format));
-            }
-
-            auto &surface{graphicBuffer.graphicHandle.surfaces.at(0)};
-            if (surface.scanFormat != NvDisplayScanFormat::Progressive)
-                throw exception("Non-Progressive surfaces are not supported: {}", ToString(surface.scanFormat));
-
-            // Duplicate the handle so it can't be freed by the guest
-            auto nvMapHandleObj{nvMap.GetHandle(surface.nvmapHandle ? surface.nvmapHandle : handle.nvmapId)};
-            if (auto err{nvMapHandleObj->Duplicate(true)}; err != PosixResult::Success)
-                throw exception("Failed to duplicate graphic buffer NvMap handle: {}!", static_cast<i32>(err));
-
-            if (surface.size > (nvMapHandleObj->origSize - surface.offset))
-                throw exception("Surface doesn't fit into NvMap mapping of size 0x{:X} when mapped at 0x{:X} -> 0x{:X}", nvMapHandleObj->origSize, surface.offset, surface.offset + surface.size);
-
-            gpu::texture::TileConfig tileConfig{};
-            if (surface.layout == NvSurfaceLayout::Blocklinear) {
-                tileConfig = {
-                    .mode = gpu::texture::TileMode::Block,
-                    .blockHeight = static_cast<u8>(1U << surface.blockHeightLog2),
-                    .blockDepth = 1,
-                };
-            } else if (surface.layout == NvSurfaceLayout::Pitch) {
-                tileConfig = {
-                    .mode = gpu::texture::TileMode::Pitch,
-                    .pitch = surface.pitch,
-                };
-            } else if (surface.layout == NvSurfaceLayout::Tiled) {
-                throw exception("Legacy 16Bx16 tiled surfaces are not supported");
-            }
-
-            gpu::GuestTexture guestTexture(span<u8>(nvMapHandleObj->GetPointer() + surface.offset, surface.size), gpu::texture::Dimensions(surface.width, surface.height), format, tileConfig, gpu::texture::TextureType::e2D);
-            buffer.texture = state.gpu->texture.FindOrCreate(guestTexture).backing;
+            CreateTexture(buffer);
         }
 
         switch (transform) {
@@ -384,13 +432,16 @@ namespace skyline::service::hosbinder {
         fence.Wait(state.soc->host1x);
 
         {
-            auto &texture{buffer.texture};
-            std::scoped_lock textureLock(*texture);
-            texture->SynchronizeHost();
-            u64 frameId;
-            state.gpu->presentation.Present(texture, isAutoTimestamp ? 0 : timestamp, swapInterval, crop, scalingMode, transform, frameId);
+            std::scoped_lock textureLock(*buffer.texture);
+            buffer.texture->SynchronizeHost();
         }
 
+        // The frame is presented asynchronously by the present thread, the guest is handed a fence on the next dequeue of the buffer which is signalled once the host is done reading from it
+        if (!buffer.presentFence.id)
+            buffer.presentFence.id = syncpointManager.AllocateSyncpoint(false);
+        buffer.presentFence.threshold = syncpointManager.IncrementSyncpointMaxExt(buffer.presentFence.id, 1);
+        state.gpu->presentation.Present(buffer.texture, isAutoTimestamp ? 0 : timestamp, swapInterval, crop, scalingMode, transform, std::make_shared<SyncpointIncrement>(state.soc->host1x.syncpoints.at(buffer.presentFence.id)));
+
         buffer.frameNumber = ++frameNumber;
         buffer.state = BufferState::Free;
         bufferEvent->Signal();
@@ -528,9 +579,7 @@ namespace skyline::service::hosbinder {
         for (auto &slot : queue) {
             slot.state = BufferState::Free;
             slot.frameNumber = std::numeric_limits<u32>::max();
-            if (std::exchange(slot.texture, {}))
-                FreeGraphicBufferNvMap(*slot.graphicBuffer);
-            slot.graphicBuffer = nullptr;
+            ReplaceGraphicBuffer(slot, nullptr);
         }
 
         Logger::Debug("API: {}", ToString(api));
@@ -548,10 +597,8 @@ namespace skyline::service::hosbinder {
         buffer.state = BufferState::Free;
         buffer.frameNumber = 0;
         buffer.wasBufferRequested = false;
-        if (std::exchange(buffer.texture, {}))
-            FreeGraphicBufferNvMap(*buffer.graphicBuffer);
+        ReplaceGraphicBuffer(buffer, graphicBuffer);
         buffer.isPreallocated = graphicBuffer != nullptr;
-        buffer.graphicBuffer = graphicBuffer ? std::make_unique<GraphicBuffer>(*graphicBuffer) : nullptr;
 
         if (graphicBuffer) {
             if (graphicBuffer->magic != GraphicBuffer::Magic)
@@ -573,6 +620,9 @@ namespace skyline::service::hosbinder {
             else if (surface.layout == NvSurfaceLayout::Tiled)
                 throw exception("Legacy 16Bx16 tiled surfaces are not supported");
 
+            if (state.settings->zeroCopyPresentation && !buffer.texture)
+                CreateTexture(buffer); // The texture must be created prior to the guest rendering into the buffer for it to be presentable without a copy
+
             Logger::Debug("#{} - Dimensions: {}x{} [Stride: {}], Format: {}, Layout: {}, {}: {}, Usage: 0x{:X}, NvMap {}: {}, Buffer Start/End: 0x{:X} -> 0x{:X}", slot, surface.width, surface.height, handle.stride, ToString(handle.format), ToString(surface.layout), surface.layout == NvSurfaceLayout::Blocklinear ? "Block Height" : "Pitch", surface.layout == NvSurfaceLayout::Blocklinear ? 1U << surface.blockHeightLog2 : surface.pitch, graphicBuffer->usage, surface.nvmapHandle ? "Handle" : "ID", surface.nvmapHandle ? surface.nvmapHandle : handle.nvmapId, surface.offset, surface.offset + surface.size);
         } else {
             Logger::Debug("#{} - No GraphicBuffer", slot);
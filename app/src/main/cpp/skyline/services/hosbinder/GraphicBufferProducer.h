@@ -16,6 +16,7 @@ namespace skyline::gpu {
 
 namespace skyline::service::nvdrv::core {
     class NvMap;
+    class SyncpointManager;
 }
 
 namespace skyline::service::hosbinder {
@@ -44,8 +45,9 @@ namespace skyline::service::hosbinder {
         u64 frameNumber{}; //!< The amount of frames that have been queued using this slot
         bool wasBufferRequested{}; //!< If GraphicBufferProducer::RequestBuffer has been called with this buffer
         bool isPreallocated{}; //!< If this slot's graphic buffer has been preallocated or attached
-        std::shared_ptr<gpu::Texture> texture{};
+        std::shared_ptr<gpu::Texture> texture{}; //!< The texture bound to the surface of the graphic buffer, it's created once and reused till the slot's surface changes
         std::unique_ptr<GraphicBuffer> graphicBuffer{};
+        nvdrv::Fence presentFence{}; //!< A fence on a syncpoint owned by the slot which is signalled once the host GPU has finished presenting the slot's last queued frame, its ID is 0 if no syncpoint has been allocated
     };
 
     /**
@@ -71,9 +73,21 @@ namespace skyline::service::hosbinder {
         NativeWindowApi connectedApi{NativeWindowApi::None}; //!< The API that the producer is currently connected to
         u64 frameNumber{}; //!< The amount of frames that have been presented so far
         nvdrv::core::NvMap &nvMap;
+        nvdrv::core::SyncpointManager &syncpointManager;
 
         void FreeGraphicBufferNvMap(GraphicBuffer &buffer);
 
+        /**
+         * @brief Creates the host texture for the GraphicBuffer in a slot, the NvMap handle backing it is duplicated so it must be freed with FreeGraphicBufferNvMap alongside the texture
+         */
+        void CreateTexture(BufferSlot &buffer);
+
+        /**
+         * @brief Replaces the GraphicBuffer in a slot, its texture is retained if the new buffer has the same NvGraphicHandle so it stays bound across the slot being rebound to the same surface
+         * @param graphicBuffer The new GraphicBuffer or nullptr to clear the slot
+         */
+        void ReplaceGraphicBuffer(BufferSlot &buffer, const GraphicBuffer *graphicBuffer);
+
         /**
          * @return The amount of buffers which have been queued onto the consumer
          */
@@ -187,7 +201,9 @@ namespace skyline::service::hosbinder {
             SetPreallocatedBuffer = 14, //!< A transaction specific to HOS, see the implementation for a description of its functionality
         };
 
-        GraphicBufferProducer(const DeviceState &state, nvdrv::core::NvMap &nvmap);
+        GraphicBufferProducer(const DeviceState &state, nvdrv::core::NvMap &nvmap, nvdrv::core::SyncpointManager &syncpointManager);
+
+        ~GraphicBufferProducer();
 
         /**
          * @brief The handler for Binder IPC transactions with IGraphicBufferProducer
@@ -7,7 +7,7 @@
 #include "GraphicBufferProducer.h"
 
 namespace skyline::service::hosbinder {
-    IHOSBinderDriver::IHOSBinderDriver(const DeviceState &state, ServiceManager &manager, nvdrv::core::NvMap &nvMap) : BaseService(state, manager), nvMap(nvMap) {}
+    IHOSBinderDriver::IHOSBinderDriver(const DeviceState &state, ServiceManager &manager, nvdrv::core::NvMap &nvMap, nvdrv::core::SyncpointManager &syncpointManager) : BaseService(state, manager), nvMap(nvMap), syncpointManager(syncpointManager) {}
 
     Result IHOSBinderDriver::TransactParcel(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         // We opted for just supporting a single layer and display as it's what basically all games use and wasting cycles on it is pointless
@@ -20,8 +20,9 @@ namespace skyline::service::hosbinder {
 
         auto code{request.Pop<GraphicBufferProducer::TransactionCode>()};
 
+        // Both parcels are used in place from the IPC buffers to avoid any copies of them on every frame
         Parcel in(request.inputBuf.at(0), state, true);
-        Parcel out(state);
+        Parcel out(state, request.outputBuf.at(0));
 
         if (!layer)
             throw exception("Transacting parcel with non-existant layer");
@@ -122,7 +123,7 @@ namespace skyline::service::hosbinder {
 
         layerStrongReferenceCount = InitialStrongReferenceCount;
         layerWeakReferenceCount = 0;
-        layer.emplace(state, nvMap);
+        layer.emplace(state, nvMap, syncpointManager);
 
         return DefaultLayerId;
     }
@@ -43,9 +43,10 @@ namespace skyline::service::hosbinder {
         std::optional<GraphicBufferProducer> layer; //!< The IGraphicBufferProducer backing the layer (NativeWindow)
 
         nvdrv::core::NvMap &nvMap;
+        nvdrv::core::SyncpointManager &syncpointManager;
 
       public:
-        IHOSBinderDriver(const DeviceState &state, ServiceManager &manager, nvdrv::core::NvMap &nvMap);
+        IHOSBinderDriver(const DeviceState &state, ServiceManager &manager, nvdrv::core::NvMap &nvMap, nvdrv::core::SyncpointManager &syncpointManager);
 
         /**
          * @brief Emulates the transaction of parcels between a IGraphicBufferProducer and the application
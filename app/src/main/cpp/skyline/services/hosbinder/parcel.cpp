@@ -11,22 +11,28 @@ namespace skyline::service::hosbinder {
             throw exception("The size of the parcel according to the header exceeds the specified size");
 
         constexpr u8 tokenLength{0x50}; // The length of the token on BufferQueue parcels
+        u32 skipLength{hasToken ? tokenLength : 0U};
 
-        data.resize(header.dataSize - (hasToken ? tokenLength : 0));
-        std::memcpy(data.data(), buffer.data() + header.dataOffset + (hasToken ? tokenLength : 0), header.dataSize - (hasToken ? tokenLength : 0));
+        if (static_cast<u64>(header.dataOffset) + header.dataSize > buffer.size() || static_cast<u64>(header.objectsOffset) + header.objectsSize > buffer.size() || header.dataSize < skipLength)
+            throw exception("The data or objects of the parcel are outside of the buffer");
 
-        objects.resize(header.objectsSize);
-        std::memcpy(objects.data(), buffer.data() + header.objectsOffset, header.objectsSize);
+        data = buffer.subspan(header.dataOffset + skipLength, header.dataSize - skipLength);
+        objects = buffer.subspan(header.objectsOffset, header.objectsSize);
+    }
+
+    Parcel::Parcel(const DeviceState &state, span<u8> outputBuffer) : state(state), outputBuffer(outputBuffer) {
+        if (outputBuffer.size() < sizeof(ParcelHeader))
+            throw exception("The output buffer is too small to contain the parcel header: 0x{:X}", outputBuffer.size());
     }
 
     Parcel::Parcel(const DeviceState &state) : state(state) {}
 
     u64 Parcel::WriteParcel(span<u8> buffer) {
-        header.dataSize = static_cast<u32>(data.size());
+        header.dataSize = static_cast<u32>(dataSize);
         header.dataOffset = sizeof(ParcelHeader);
 
-        header.objectsSize = static_cast<u32>(objects.size());
-        header.objectsOffset = static_cast<u32>(sizeof(ParcelHeader) + data.size());
+        header.objectsSize = static_cast<u32>(objectsSize);
+        header.objectsOffset = static_cast<u32>(sizeof(ParcelHeader) + dataSize);
 
         auto totalSize{sizeof(ParcelHeader) + header.dataSize + header.objectsSize};
 
@@ -34,8 +40,9 @@ namespace skyline::service::hosbinder {
             throw exception("The size of the parcel exceeds maxSize");
 
         buffer.as<ParcelHeader>() = header;
-        std::memcpy(buffer.data() + header.dataOffset, data.data(), data.size());
-        std::memcpy(buffer.data() + header.objectsOffset, objects.data(), objects.size());
+        if (buffer.data() != outputBuffer.data())
+            std::memcpy(buffer.data() + header.dataOffset, GetDataBuffer().data(), dataSize);
+        std::memcpy(buffer.data() + header.objectsOffset, inlineObjects.data(), objectsSize);
 
         return totalSize;
     }
@@ -8,6 +8,7 @@
 namespace skyline::service::hosbinder {
     /**
      * @brief This allows easy access and efficient serialization of an Android Parcel object
+     * @note Input parcels are parsed in place from the IPC buffer and output parcels are either serialized in place into the IPC buffer or into inline storage, neither allocates on the heap
      * @url https://switchbrew.org/wiki/Display_services#Parcel
      */
     class Parcel {
@@ -20,22 +21,43 @@ namespace skyline::service::hosbinder {
         } header{};
         static_assert(sizeof(ParcelHeader) == 0x10);
 
+        static constexpr size_t InlineDataCapacity{0x100}; //!< The capacity of the data of output parcels without an output buffer, this fits the data of all parcels that are created by HOS services
+        static constexpr size_t InlineObjectsCapacity{0x10}; //!< The capacity of the objects of output parcels, these can't be written in place as their offset depends on the final size of the data
+
         const DeviceState &state;
+        span<u8> outputBuffer; //!< The IPC buffer that the data of an output parcel is written into in place, the data is written directly after the header
+        size_t dataSize{}; //!< The size of the data written to an output parcel
+        size_t objectsSize{}; //!< The size of the objects written to an output parcel
+        std::array<u8, InlineDataCapacity> inlineData; //!< The data of an output parcel without an output buffer
+        std::array<u8, InlineObjectsCapacity> inlineObjects; //!< The objects of an output parcel
+
+        /**
+         * @return The storage that the data of an output parcel is written into
+         */
+        span<u8> GetDataBuffer() {
+            return !outputBuffer.empty() ? outputBuffer.subspan(sizeof(ParcelHeader)) : span<u8>(inlineData);
+        }
 
       public:
-        std::vector<u8> data;
-        std::vector<u8> objects;
+        span<u8> data; //!< The data of an input parcel inside the IPC buffer
+        span<u8> objects; //!< The objects of an input parcel inside the IPC buffer
         size_t dataOffset{}; //!< The offset of the data read from the parcel
 
         /**
-         * @brief This constructor fills in the Parcel object with data from a IPC buffer
+         * @brief This constructor parses an input parcel in place from an IPC buffer, it must outlive the parcel
          * @param buffer The buffer that contains the parcel
          * @param hasToken If the parcel starts with a token, it's skipped if this flag is true
          */
         Parcel(span<u8> buffer, const DeviceState &state, bool hasToken = false);
 
         /**
-         * @brief This constructor is used to create an empty parcel then write to a process
+         * @brief This constructor is used to create an empty output parcel which is serialized in place into the supplied IPC buffer
+         * @note WriteParcel must be called with the same buffer to finish serialization
+         */
+        Parcel(const DeviceState &state, span<u8> outputBuffer);
+
+        /**
+         * @brief This constructor is used to create an empty output parcel with inline storage then write to a process
          */
         Parcel(const DeviceState &state);
 
@@ -67,9 +89,11 @@ namespace skyline::service::hosbinder {
 
         template<typename ValueType>
         void Push(const ValueType &value) {
-            auto offset{data.size()};
-            data.resize(offset + sizeof(ValueType));
-            std::memcpy(data.data() + offset, &value, sizeof(ValueType));
+            auto buffer{GetDataBuffer()};
+            if (dataSize + sizeof(ValueType) > buffer.size())
+                throw exception("Pushing 0x{:X} bytes to a parcel with 0x{:X} bytes of data exceeds its capacity: 0x{:X}", sizeof(ValueType), dataSize, buffer.size());
+            std::memcpy(buffer.data() + dataSize, &value, sizeof(ValueType));
+            dataSize += sizeof(ValueType);
         }
 
         /**
@@ -97,13 +121,14 @@ namespace skyline::service::hosbinder {
 
         template<typename ObjectType>
         void PushObject(const ObjectType &object) {
-            auto offset{objects.size()};
-            objects.resize(offset + sizeof(ObjectType));
-            std::memcpy(objects.data() + offset, &object, sizeof(ObjectType));
+            if (objectsSize + sizeof(ObjectType) > inlineObjects.size())
+                throw exception("Pushing 0x{:X} bytes to a parcel with 0x{:X} bytes of objects exceeds its capacity: 0x{:X}", sizeof(ObjectType), objectsSize, inlineObjects.size());
+            std::memcpy(inlineObjects.data() + objectsSize, &object, sizeof(ObjectType));
+            objectsSize += sizeof(ObjectType);
         }
 
         /**
-         * @param buffer The buffer to write the flattened Parcel into
+         * @param buffer The buffer to write the flattened Parcel into, the data isn't copied if this is the output buffer of the parcel
          * @return The total size of the Parcel
          */
         u64 WriteParcel(span<u8> buffer);
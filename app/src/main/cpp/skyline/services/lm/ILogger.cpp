@@ -2,21 +2,14 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <sstream>
+#include <common/settings.h>
 #include "ILogger.h"
 
 namespace skyline::service::lm {
     ILogger::ILogger(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
-    Result ILogger::Log(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        auto inputBuffer{request.inputBuf.at(0)};
-        struct Data {
-            u64 pid;
-            u64 threadContext;
-            u16 flags;
-            LogLevel level;
-            u8 verbosity;
-            u32 payloadLength;
-        } &data = inputBuffer.as<Data>();
+    std::string ILogger::DecodePacket(std::string_view packet) {
+        span<u8> inputBuffer{span<char>(packet).cast<u8>()};
 
         struct LogMessage {
             std::string_view message;
@@ -30,7 +23,7 @@ namespace skyline::service::lm {
             std::string_view program;
         } logMessage{};
 
-        u64 offset{sizeof(Data)};
+        u64 offset{sizeof(PacketHeader)};
         while ((offset + sizeof(LogFieldType) + sizeof(u8)) < inputBuffer.size()) { // The length of the last field sometimes doesn't add up to the buffer size, so we need to terminate the loop when we can't pop the type and length off the buffer
             auto fieldType{inputBuffer.subspan(offset++).as<LogFieldType>()};
             auto length{inputBuffer.subspan(offset++).as<u8>()};
@@ -85,20 +78,6 @@ namespace skyline::service::lm {
             break;
         }
 
-        Logger::LogLevel hostLevel{[&data]() {
-            switch (data.level) {
-                case LogLevel::Trace:
-                    return Logger::LogLevel::Debug;
-                case LogLevel::Info:
-                    return Logger::LogLevel::Info;
-                case LogLevel::Warning:
-                    return Logger::LogLevel::Warn;
-                case LogLevel::Error:
-                case LogLevel::Critical:
-                    return Logger::LogLevel::Error;
-            }
-        }()};
-
         std::ostringstream message;
         if (!logMessage.filename.empty())
             message << logMessage.filename << ':';
@@ -120,10 +99,36 @@ namespace skyline::service::lm {
             message << ' ' << logMessage.message;
         }
         if (logMessage.dropCount)
-            message << " (Dropped Messages: " << logMessage.time << ')';
+            message << " (Dropped Messages: " << logMessage.dropCount << ')';
+
+        return message.str();
+    }
+
+    Result ILogger::Log(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        if (!state.settings->guestLogging)
+            return {};
+
+        auto inputBuffer{request.inputBuf.at(0)};
+        auto &header{inputBuffer.as<PacketHeader>()};
+        Logger::LogLevel hostLevel{[&header]() {
+            switch (header.level) {
+                case LogLevel::Trace:
+                    return Logger::LogLevel::Debug;
+                case LogLevel::Info:
+                    return Logger::LogLevel::Info;
+                case LogLevel::Warning:
+                    return Logger::LogLevel::Warn;
+                case LogLevel::Error:
+                case LogLevel::Critical:
+                    return Logger::LogLevel::Error;
+            }
+        }()};
 
-        Logger::Write(hostLevel, message.str());
+        if (hostLevel > Logger::MaxLevel || hostLevel > Logger::configLevel)
+            return {};
 
+        // The packet is only copied here, decoding its fields and formatting the message is deferred to the writer thread of the logger
+        Logger::WriteDeferred(hostLevel, std::string(inputBuffer.as_string()), &ILogger::DecodePacket);
         return {};
     }
 
@@ -34,11 +34,29 @@ namespace skyline::service::lm {
             Critical,
         };
 
+        /**
+         * @brief The header of a log packet which is followed by a stream of fields encoded as type-length-value
+         */
+        struct PacketHeader {
+            u64 pid;
+            u64 threadContext;
+            u16 flags;
+            LogLevel level;
+            u8 verbosity;
+            u32 payloadLength;
+        };
+
+        /**
+         * @brief Decodes the fields of a log packet into a message, this is run on the writer thread of the logger
+         */
+        static std::string DecodePacket(std::string_view packet);
+
       public:
         ILogger(const DeviceState &state, ServiceManager &manager);
 
         /**
          * @brief Prints a message to the log
+         * @note The packet is queued to the logger without being decoded and is dropped entirely if guest logging is disabled or its level isn't logged
          * @url https://switchbrew.org/wiki/Log_services#Log
          */
         Result Log(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
@@ -22,10 +22,8 @@ namespace skyline::service::nvdrv {
           ctx(SessionContext{.perms = perms}) {}
 
     Result INvDrvServices::Open(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        constexpr FileDescriptor SessionFdLimit{std::numeric_limits<u64>::digits * 2}; //!< Nvdrv uses two 64 bit variables to store a bitset
-
         auto path{request.inputBuf.at(0).as_string(true)};
-        if (path.empty() || nextFdIndex == SessionFdLimit) {
+        if (path.empty() || nextFdIndex == FileDescriptorLimit) {
             response.Push<FileDescriptor>(InvalidFileDescriptor);
             return NVRESULT(NvResult::FileOperationFailed);
         }
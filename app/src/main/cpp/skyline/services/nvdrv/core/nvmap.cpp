@@ -58,18 +58,55 @@ namespace skyline::service::nvdrv::core {
 
     NvMap::NvMap(const DeviceState &state) : state(state), smmuAllocator(PAGE_SIZE) {}
 
+    NvMap::~NvMap() {
+        // Handles in the unmap queue hold a reference to themselves which must be dropped for them to be destroyed
+        while (unmapQueueHead)
+            EraseUnmapQueue(*unmapQueueHead);
+    }
+
     void NvMap::AddHandle(std::shared_ptr<Handle> handleDesc) {
-        std::scoped_lock lock(handlesLock);
+        auto &shard{GetHandleShard(handleDesc->id)};
+        std::scoped_lock lock(shard.writeLock);
+
+        auto map{std::make_shared<HandleMap>(*shard.map)};
+        map->emplace(handleDesc->id, std::move(handleDesc));
+        std::atomic_store_explicit(&shard.map, std::shared_ptr<const HandleMap>{std::move(map)}, std::memory_order_release);
+    }
 
-        handles.emplace(handleDesc->id, std::move(handleDesc));
+    void NvMap::PushUnmapQueue(std::shared_ptr<Handle> handle) {
+        auto &node{handle->unmapQueueNode};
+        node.previous = unmapQueueTail;
+        node.next = nullptr;
+        if (unmapQueueTail)
+            unmapQueueTail->unmapQueueNode.next = handle.get();
+        else
+            unmapQueueHead = handle.get();
+        unmapQueueTail = handle.get();
+        node.self = std::move(handle);
+    }
+
+    std::shared_ptr<NvMap::Handle> NvMap::EraseUnmapQueue(Handle &handle) {
+        auto &node{handle.unmapQueueNode};
+        if (!node.self)
+            return nullptr;
+
+        if (node.previous)
+            node.previous->unmapQueueNode.next = node.next;
+        else
+            unmapQueueHead = node.next;
+
+        if (node.next)
+            node.next->unmapQueueNode.previous = node.previous;
+        else
+            unmapQueueTail = node.previous;
+
+        node.previous = node.next = nullptr;
+        return std::move(node.self);
     }
 
     void NvMap::UnmapHandle(Handle &handleDesc) {
-        // Remove pending unmap queue entry if needed
-        if (handleDesc.unmapQueueEntry) {
-            unmapQueue.erase(*handleDesc.unmapQueueEntry);
-            handleDesc.unmapQueueEntry.reset();
-        }
+        // Remove pending unmap queue entry if needed, the caller holds a reference to the handle so the queue's reference can be dropped immediately
+        EraseUnmapQueue(handleDesc);
 
         // Free and unmap the handle from the SMMU
         state.soc->smmu.Unmap(handleDesc.pinVirtAddress, static_cast<u32>(handleDesc.alignedSize));
@@ -81,11 +118,14 @@ namespace skyline::service::nvdrv::core {
     bool NvMap::TryRemoveHandle(const Handle &handleDesc) {
         // No dupes left, we can remove from handle map
         if (handleDesc.dupes == 0 && handleDesc.internalDupes == 0) {
-            std::scoped_lock lock(handlesLock);
+            auto &shard{GetHandleShard(handleDesc.id)};
+            std::scoped_lock lock(shard.writeLock);
 
-            auto it{handles.find(handleDesc.id)};
-            if (it != handles.end())
-                handles.erase(it);
+            if (shard.map->contains(handleDesc.id)) {
+                auto map{std::make_shared<HandleMap>(*shard.map)};
+                map->erase(handleDesc.id);
+                std::atomic_store_explicit(&shard.map, std::shared_ptr<const HandleMap>{std::move(map)}, std::memory_order_release);
+            }
 
             return true;
         } else {
@@ -104,16 +144,6 @@ namespace skyline::service::nvdrv::core {
         return handleDesc;
     }
 
-    std::shared_ptr<NvMap::Handle> NvMap::GetHandle(Handle::Id handle) {
-        std::scoped_lock lock(handlesLock);
-
-        try {
-            return handles.at(handle);
-        } catch (std::out_of_range &e) {
-            return nullptr;
-        }
-    }
-
     u32 NvMap::PinHandle(NvMap::Handle::Id handle) {
         auto handleDesc{GetHandle(handle)};
         if (!handleDesc) [[unlikely]]
@@ -125,10 +155,7 @@ namespace skyline::service::nvdrv::core {
             {
                 // Lock now to prevent our queue entry from being removed for allocation in-between the following check and erase
                 std::scoped_lock queueLock(unmapQueueLock);
-                if (handleDesc->unmapQueueEntry) {
-                    unmapQueue.erase(*handleDesc->unmapQueueEntry);
-                    handleDesc->unmapQueueEntry.reset();
-
+                if (EraseUnmapQueue(*handleDesc)) {
                     handleDesc->pins++;
                     return handleDesc->pinVirtAddress;
                 }
@@ -139,10 +166,11 @@ namespace skyline::service::nvdrv::core {
             while (!(address = smmuAllocator.Allocate(static_cast<u32>(handleDesc->alignedSize)))) {
                 // Free handles until the allocation succeeds
                 std::scoped_lock queueLock(unmapQueueLock);
-                if (auto freeHandleDesc{unmapQueue.front()}) {
+                if (unmapQueueHead) {
                     // Handles in the unmap queue are guaranteed not to be pinned so don't bother checking if they are before unmapping
+                    auto freeHandleDesc{unmapQueueHead->unmapQueueNode.self}; // A reference is held as unmapping drops the queue's reference
                     std::scoped_lock freeLock(freeHandleDesc->mutex);
-                    if (handleDesc->pinVirtAddress)
+                    if (freeHandleDesc->pinVirtAddress)
                         UnmapHandle(*freeHandleDesc);
                 } else {
                     throw exception("Ran out of SMMU address space!");
@@ -169,8 +197,7 @@ namespace skyline::service::nvdrv::core {
             std::scoped_lock queueLock(unmapQueueLock);
 
             // Add to the unmap queue allowing this handle's memory to be freed if needed
-            unmapQueue.push_back(handleDesc);
-            handleDesc->unmapQueueEntry = std::prev(unmapQueue.end());
+            PushUnmapQueue(handleDesc);
         }
     }
 
@@ -3,7 +3,6 @@
 
 #pragma once
 
-#include <queue>
 #include <common.h>
 #include <common/address_space.h>
 #include <services/common/result.h>
@@ -33,7 +32,15 @@ namespace skyline::service::nvdrv::core {
 
             i32 pins{};
             u32 pinVirtAddress{};
-            std::optional<typeof(std::list<std::shared_ptr<Handle>>::iterator)> unmapQueueEntry{};
+
+            /**
+             * @brief The intrusive state of a handle which is in the unmap queue, this must only be accessed with `unmapQueueLock` held
+             */
+            struct UnmapQueueNode {
+                Handle *previous{}; //!< The handle which was unpinned prior to this one
+                Handle *next{}; //!< The handle which was unpinned after this one
+                std::shared_ptr<Handle> self; //!< A reference to the handle which keeps it alive while it's in the queue, this is nullptr if it isn't in the queue
+            } unmapQueueNode{};
 
             struct Flags {
                 bool mapUncached : 1; //!< If the handle should be mapped as uncached
@@ -79,17 +86,46 @@ namespace skyline::service::nvdrv::core {
         const DeviceState &state;
 
         FlatAllocator<u32, 0, 32> smmuAllocator;
-        std::list<std::shared_ptr<Handle>> unmapQueue;
-        std::mutex unmapQueueLock; //!< Protects access to `unmapQueue`
+        Handle *unmapQueueHead{}; //!< The least recently unpinned handle in the unmap queue, this is the first to be unmapped when SMMU space runs out
+        Handle *unmapQueueTail{}; //!< The most recently unpinned handle in the unmap queue
+        std::mutex unmapQueueLock; //!< Protects access to the unmap queue
 
-        std::unordered_map<Handle::Id, std::shared_ptr<Handle>> handles; //!< Main owning map of handles
-        std::mutex handlesLock; //!< Protects access to `handles`
+        using HandleMap = std::unordered_map<Handle::Id, std::shared_ptr<Handle>>;
+
+        /**
+         * @brief A shard of the owning map of handles, it's copied on every write so lookups can atomically load the current map without taking any locks
+         * @note Handles are created and freed rarely compared to how often they're looked up, the copy is kept small by sharding the handles
+         */
+        struct HandleShard {
+            std::shared_ptr<const HandleMap> map{std::make_shared<HandleMap>()}; //!< This must only be accessed with atomic shared_ptr operations
+            std::mutex writeLock; //!< Serializes writers to the shard, this isn't held by readers
+        };
+
+        static constexpr size_t HandleShardCount{16};
+        std::array<HandleShard, HandleShardCount> handleShards;
 
         static constexpr u32 HandleIdIncrement{4}; //!< Each new handle ID is an increment of 4 from the previous
         std::atomic<u32> nextHandleId{HandleIdIncrement};
 
+        HandleShard &GetHandleShard(Handle::Id id) {
+            return handleShards[(id / HandleIdIncrement) % HandleShardCount];
+        }
+
         void AddHandle(std::shared_ptr<Handle> handle);
 
+        /**
+         * @brief Appends a handle to the back of the unmap queue
+         * @note `unmapQueueLock` MUST be locked when calling this
+         */
+        void PushUnmapQueue(std::shared_ptr<Handle> handle);
+
+        /**
+         * @brief Removes a handle from the unmap queue if it's in it
+         * @note `unmapQueueLock` MUST be locked when calling this
+         * @return The queue's reference to the handle or nullptr if it wasn't in the queue, this should be destroyed after the handle's mutex has been unlocked
+         */
+        std::shared_ptr<Handle> EraseUnmapQueue(Handle &handle);
+
         /**
          * @brief Unmaps and frees the SMMU memory region a handle is mapped to
          * @note Both `unmapQueueLock` and `handleDesc.mutex` MUST be locked when calling this
@@ -115,12 +151,21 @@ namespace skyline::service::nvdrv::core {
 
         NvMap(const DeviceState &state);
 
+        ~NvMap();
+
         /**
          * @brief Creates an unallocated handle of the given size
          */
         [[nodiscard]] PosixResultValue<std::shared_ptr<Handle>> CreateHandle(u64 size);
 
-        std::shared_ptr<Handle> GetHandle(Handle::Id handle);
+        /**
+         * @note This doesn't take any locks, it's safe to call concurrently with handles being created and freed
+         */
+        std::shared_ptr<Handle> GetHandle(Handle::Id handle) {
+            auto map{std::atomic_load_explicit(&GetHandleShard(handle).map, std::memory_order_acquire)};
+            auto it{map->find(handle)};
+            return it != map->end() ? it->second : nullptr;
+        }
 
         /**
          * @brief Maps a handle into the SMMU address space
@@ -44,6 +44,14 @@ namespace skyline::service::nvdrv::core {
         return ReserveSyncpoint(FindFreeSyncpoint(), clientManaged);
     }
 
+    void SyncpointManager::FreeSyncpoint(u32 id) {
+        std::lock_guard lock(reservationLock);
+        if (!syncpoints.at(id).reserved)
+            throw exception("Cannot free an unreserved syncpoint!");
+
+        syncpoints.at(id).reserved = false;
+    }
+
     bool SyncpointManager::IsSyncpointAllocated(u32 id) {
         return (id <= soc::host1x::SyncpointCount) && syncpoints[id].reserved;
     }
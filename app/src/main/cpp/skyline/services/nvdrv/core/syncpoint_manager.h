@@ -76,6 +76,11 @@ namespace skyline::service::nvdrv::core {
          */
         u32 AllocateSyncpoint(bool clientManaged);
 
+        /**
+         * @brief Releases a syncpoint reserved with AllocateSyncpoint so it can be reused
+         */
+        void FreeSyncpoint(u32 id);
+
         /**
          * @url https://github.com/Jetson-TX1-AndroidTV/android_kernel_jetson_tx1_hdmi_primary/blob/8f74a72394efb871cb3f886a3de2998cd7ff2990/drivers/gpu/host1x/syncpt.c#L259
          */
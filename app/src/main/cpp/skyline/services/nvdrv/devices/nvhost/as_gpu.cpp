@@ -25,23 +25,23 @@ namespace skyline::service::nvdrv::device::nvhost {
         if  (!vm.initialised)
             return PosixResult::InvalidArgument;
 
-        try {
-            std::shared_lock gpuLock(driver.deviceMutex);
-            auto &gpuCh{dynamic_cast<GpuChannel &>(*driver.devices.at(channelFd))};
+        std::shared_lock gpuLock(driver.deviceMutex);
+        auto device{driver.GetDeviceLocked(channelFd)};
+        if (!device) {
+            Logger::Warn("Attempting to bind AS to an invalid channel: {}", channelFd);
+            return PosixResult::InvalidArgument;
+        }
 
-            std::scoped_lock channelLock(gpuCh.channelMutex);
+        auto &gpuCh{dynamic_cast<GpuChannel &>(*device)};
+        std::scoped_lock channelLock(gpuCh.channelMutex);
 
-            if (gpuCh.asCtx) {
-                Logger::Warn("Attempting to bind multiple ASes to a single GPU channel");
-                return PosixResult::InvalidArgument;
-            }
-            
-            gpuCh.asCtx = asCtx;
-            gpuCh.asAllocator = vm.smallPageAllocator;
-        } catch (const std::out_of_range &e) {
-            Logger::Warn("Attempting to bind AS to an invalid channel: {}", channelFd);
+        if (gpuCh.asCtx) {
+            Logger::Warn("Attempting to bind multiple ASes to a single GPU channel");
             return PosixResult::InvalidArgument;
         }
+
+        gpuCh.asCtx = asCtx;
+        gpuCh.asAllocator = vm.smallPageAllocator;
         
         return PosixResult::Success;
     }
@@ -335,6 +335,10 @@ namespace skyline::service::nvdrv::device::nvhost {
         if (!vm.initialised)
             return PosixResult::InvalidArgument;
 
+        std::vector<GMMU::MapEntry> mapEntries;
+        mapEntries.reserve(entries.size());
+
+        // All entries are validated prior to touching the GMMU so they can be applied in a single batch
         for (const auto &entry : entries) {
             u64 virtAddr{static_cast<u64>(entry.asOffsetBigPages) << vm.bigPageSizeBits};
             u64 size{static_cast<u64>(entry.bigPages) << vm.bigPageSizeBits};
@@ -351,8 +355,11 @@ namespace skyline::service::nvdrv::device::nvhost {
                 return PosixResult::InvalidArgument;
             }
 
+            if (!size)
+                continue;
+
             if (!entry.handle) {
-                asCtx->gmmu.Map(virtAddr, GMMU::SparsePlaceholderAddress(), size, {true});
+                mapEntries.push_back({virtAddr, GMMU::SparsePlaceholderAddress(), size, {true}});
             } else {
                 auto h{core.nvMap.GetHandle(entry.handle)};
                 if (!h)
@@ -360,10 +367,21 @@ namespace skyline::service::nvdrv::device::nvhost {
 
                 u8 *cpuPtr{reinterpret_cast<u8 *>(h->address + (static_cast<u64>(entry.handleOffsetBigPages) << vm.bigPageSizeBits))};
 
-                asCtx->gmmu.Map(virtAddr, cpuPtr, size);
+                mapEntries.push_back({virtAddr, cpuPtr, size});
             }
         }
 
+        // Entries are applied in order by the guest so later ones take precedence over any earlier ones they overlap, a batch can only be used when there's no overlap
+        std::vector<GMMU::MapEntry> sortedEntries{mapEntries};
+        std::stable_sort(sortedEntries.begin(), sortedEntries.end(), [](const auto &lhs, const auto &rhs) { return lhs.virt < rhs.virt; });
+
+        if (std::adjacent_find(sortedEntries.begin(), sortedEntries.end(), [](const auto &previous, const auto &next) { return next.virt < previous.virt + previous.size; }) == sortedEntries.end()) {
+            asCtx->gmmu.MapBatch(sortedEntries);
+        } else {
+            for (const auto &entry : mapEntries)
+                asCtx->gmmu.Map(entry.virt, entry.phys, entry.size, entry.extraInfo);
+        }
+
         return PosixResult::Success;
     }
 
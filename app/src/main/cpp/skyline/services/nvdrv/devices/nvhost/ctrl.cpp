@@ -22,10 +22,16 @@ namespace skyline::service::nvdrv::device::nvhost {
         waiterHandle = {};
     }
 
-    void Ctrl::SyncpointEvent::RegisterWaiter(soc::host1x::Host1x &host1x, const Fence &pFence) {
+    bool Ctrl::SyncpointEvent::RegisterWaiter(soc::host1x::Host1x &host1x, const Fence &pFence) {
         fence = pFence;
         state = State::Waiting;
         waiterHandle = host1x.syncpoints.at(fence.id).RegisterWaiter(fence.threshold, [this] { Signal(); });
+        if (waiterHandle)
+            return true;
+
+        // The threshold was reached prior to the waiter being registered and the callback was run inline, the KEvent is reset as the guest won't be waiting on it
+        event->ResetSignal();
+        return false;
     }
 
     bool Ctrl::SyncpointEvent::IsInUse() {
@@ -122,7 +128,11 @@ namespace skyline::service::nvdrv::device::nvhost {
 
         if (!event->IsInUse()) {
             Logger::Debug("Waiting on syncpoint event: {} with fence: ({}, {})", slot, fence.id, fence.threshold);
-            event->RegisterWaiter(state.soc->host1x, fence);
+            if (!event->RegisterWaiter(state.soc->host1x, fence)) {
+                // The fence expired while we were setting up the event, there's no need for the guest to wait on it
+                value.val = core.syncpointManager.UpdateMin(fence.id);
+                return PosixResult::Success;
+            }
 
             value.val = 0;
 
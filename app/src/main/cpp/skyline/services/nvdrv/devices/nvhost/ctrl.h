@@ -66,10 +66,11 @@ namespace skyline::service::nvdrv::device::nvhost {
             void Cancel(soc::host1x::Host1x &host1x);
 
             /**
-             * @brief Asynchronously waits on a syncpoint event using the given fence
+             * @brief Asynchronously waits on a syncpoint event using the given fence, the KEvent is signalled from the syncpoint callback once it's reached
+             * @return If a waiter was registered, this is false if the fence had already been reached in which case the KEvent isn't left signalled
              * @note Accesses to this function for a specific event should be locked
              */
-            void RegisterWaiter(soc::host1x::Host1x &host1x, const Fence &fence);
+            bool RegisterWaiter(soc::host1x::Host1x &host1x, const Fence &fence);
 
             bool IsInUse();
         };
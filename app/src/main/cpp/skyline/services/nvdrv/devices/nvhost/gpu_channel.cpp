@@ -153,6 +153,12 @@ namespace skyline::service::nvdrv::device::nvhost {
 
     PosixResult GpuChannel::SetPriority(In<u32> priority) {
         Logger::Debug("priority: {}", priority);
+
+        std::scoped_lock lock(channelMutex);
+        channelPriority = priority;
+        if (channelCtx)
+            channelCtx->gpfifo.SetPriority(priority);
+
         return PosixResult::Success;
     }
 
@@ -171,6 +177,7 @@ namespace skyline::service::nvdrv::device::nvhost {
         }
 
         channelCtx = std::make_unique<soc::gm20b::ChannelContext>(state, asCtx, numEntries);
+        channelCtx->gpfifo.SetPriority(channelPriority);
 
         fence = core.syncpointManager.GetSyncpointFence(channelSyncpoint);
 
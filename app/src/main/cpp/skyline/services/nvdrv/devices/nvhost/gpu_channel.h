@@ -18,6 +18,7 @@ namespace skyline::service::nvdrv::device::nvhost {
       private:
         u32 channelSyncpoint{}; //!< The syncpoint for submissions allocated to this channel in `AllocGpfifo`
         u64 channelUserData{};
+        u32 channelPriority{soc::gm20b::ChannelGpfifo::MediumPriority}; //!< The priority of the channel's GPFIFO, this is stored so it can be applied to the GPFIFO when it's allocated
         std::mutex channelMutex;
         std::shared_ptr<type::KEvent> smExceptionBreakpointIntReportEvent;
         std::shared_ptr<type::KEvent> smExceptionBreakpointPauseReportEvent;
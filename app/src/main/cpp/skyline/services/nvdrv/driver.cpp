@@ -14,6 +14,9 @@ namespace skyline::service::nvdrv {
 
     NvResult Driver::OpenDevice(std::string_view path, FileDescriptor fd, const SessionContext &ctx) {
         Logger::Debug("Opening NvDrv device ({}): {}", fd, path);
+        if (fd < 0 || fd >= FileDescriptorLimit)
+            return NvResult::FileOperationFailed;
+
         auto pathHash{util::Hash(path)};
 
         #define DEVICE_SWITCH(cases) \
@@ -23,12 +26,12 @@ namespace skyline::service::nvdrv {
                     break;           \
             }
 
-        #define DEVICE_CASE(path, object, ...)                                                                     \
-            case util::Hash(path):                                                                                 \
-                {                                                                                                  \
-                    std::unique_lock lock(deviceMutex);                                                            \
-                    devices.emplace(fd, std::make_unique<device::object>(state, *this, core, ctx, ##__VA_ARGS__)); \
-                    return NvResult::Success;                                                                      \
+        #define DEVICE_CASE(path, object, ...)                                                                                   \
+            case util::Hash(path):                                                                                               \
+                {                                                                                                                \
+                    std::unique_lock lock(deviceMutex);                                                                          \
+                    devices[static_cast<size_t>(fd)] = std::make_unique<device::object>(state, *this, core, ctx, ##__VA_ARGS__); \
+                    return NvResult::Success;                                                                                    \
                 }
 
         DEVICE_SWITCH(
@@ -84,55 +87,52 @@ namespace skyline::service::nvdrv {
     }
 
     NvResult Driver::Ioctl(FileDescriptor fd, IoctlDescriptor cmd, span<u8> buffer) {
-        Logger::Debug("fd: {}, cmd: 0x{:X}, device: {}", fd, cmd.raw, devices.at(fd)->GetName());
-
-        try {
-            std::shared_lock lock(deviceMutex);
-            return ConvertResult(devices.at(fd)->Ioctl(cmd, buffer));
-        } catch (const std::out_of_range &) {
+        std::shared_lock lock(deviceMutex);
+        auto device{GetDeviceLocked(fd)};
+        if (!device)
             throw exception("Ioctl was called with invalid fd: {}", fd);
-        }
+
+        Logger::Debug("fd: {}, cmd: 0x{:X}, device: {}", fd, cmd.raw, device->GetName());
+        return ConvertResult(device->Ioctl(cmd, buffer));
     }
 
     NvResult Driver::Ioctl2(FileDescriptor fd, IoctlDescriptor cmd, span<u8> buffer, span<u8> inlineBuffer) {
-        Logger::Debug("fd: {}, cmd: 0x{:X}, device: {}", fd, cmd.raw, devices.at(fd)->GetName());
-
-        try {
-            std::shared_lock lock(deviceMutex);
-            return ConvertResult(devices.at(fd)->Ioctl2(cmd, buffer, inlineBuffer));
-        } catch (const std::out_of_range &) {
+        std::shared_lock lock(deviceMutex);
+        auto device{GetDeviceLocked(fd)};
+        if (!device)
             throw exception("Ioctl2 was called with invalid fd: {}", fd);
-        }
+
+        Logger::Debug("fd: {}, cmd: 0x{:X}, device: {}", fd, cmd.raw, device->GetName());
+        return ConvertResult(device->Ioctl2(cmd, buffer, inlineBuffer));
     }
 
     NvResult Driver::Ioctl3(FileDescriptor fd, IoctlDescriptor cmd, span<u8> buffer, span<u8> inlineBuffer) {
-        Logger::Debug("fd: {}, cmd: 0x{:X}, device: {}", fd, cmd.raw, devices.at(fd)->GetName());
-
-        try {
-            std::shared_lock lock(deviceMutex);
-            return ConvertResult(devices.at(fd)->Ioctl3(cmd, buffer, inlineBuffer));
-        } catch (const std::out_of_range &) {
+        std::shared_lock lock(deviceMutex);
+        auto device{GetDeviceLocked(fd)};
+        if (!device)
             throw exception("Ioctl3 was called with invalid fd: {}", fd);
-        }
+
+        Logger::Debug("fd: {}, cmd: 0x{:X}, device: {}", fd, cmd.raw, device->GetName());
+        return ConvertResult(device->Ioctl3(cmd, buffer, inlineBuffer));
     }
 
     void Driver::CloseDevice(FileDescriptor fd) {
-        try {
-            std::unique_lock lock(deviceMutex);
-            devices.erase(fd);
-        } catch (const std::out_of_range &) {
-            Logger::Warn("Trying to close invalid fd: {}");
+        std::unique_lock lock(deviceMutex);
+        if (!GetDeviceLocked(fd)) {
+            Logger::Warn("Trying to close invalid fd: {}", fd);
+            return;
         }
+
+        devices[static_cast<size_t>(fd)].reset();
     }
 
     std::shared_ptr<kernel::type::KEvent> Driver::QueryEvent(FileDescriptor fd, u32 eventId) {
-        Logger::Debug("fd: {}, eventId: 0x{:X}, device: {}", fd, eventId, devices.at(fd)->GetName());
-
-        try {
-            std::shared_lock lock(deviceMutex);
-            return devices.at(fd)->QueryEvent(eventId);
-        } catch (const std::exception &) {
+        std::shared_lock lock(deviceMutex);
+        auto device{GetDeviceLocked(fd)};
+        if (!device)
             throw exception("QueryEvent was called with invalid fd: {}", fd);
-        }
+
+        Logger::Debug("fd: {}, eventId: 0x{:X}, device: {}", fd, eventId, device->GetName());
+        return device->QueryEvent(eventId);
     }
 }
@@ -21,7 +21,15 @@ namespace skyline::service::nvdrv {
         const DeviceState &state;
 
         std::shared_mutex deviceMutex; //!< Protects access to `devices`
-        std::unordered_map<FileDescriptor, std::unique_ptr<device::NvDevice>> devices;
+        std::array<std::unique_ptr<device::NvDevice>, FileDescriptorLimit> devices; //!< The device that every fd refers to, fds are small sequential indices so they directly index this rather than being looked up in a map on every IOCTL
+
+        /**
+         * @return The device specified by `fd` or nullptr if the fd is invalid
+         * @note `deviceMutex` MUST be locked when calling this
+         */
+        device::NvDevice *GetDeviceLocked(FileDescriptor fd) {
+            return (fd >= 0 && fd < FileDescriptorLimit) ? devices[static_cast<size_t>(fd)].get() : nullptr;
+        }
 
         friend device::nvhost::AsGpu; // For channel address space binding
 
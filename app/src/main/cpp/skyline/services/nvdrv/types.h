@@ -8,6 +8,7 @@
 namespace skyline::service::nvdrv {
     using FileDescriptor = i32;
     constexpr FileDescriptor InvalidFileDescriptor{-1};
+    constexpr FileDescriptor FileDescriptorLimit{std::numeric_limits<u64>::digits * 2}; //!< Nvdrv uses two 64 bit variables to store a bitset of open fds
 
     struct SessionPermissions {
         bool AccessGpu;
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "service_statistics.h"
+
+namespace skyline::service {
+    namespace {
+        std::mutex GlobalMutex; //!< Synchronizes all accesses to GlobalFunctions and PreviousFunctions
+        std::unordered_map<std::string_view, ServiceStatistics::FunctionStatistics> GlobalFunctions; //!< The global totals keyed by name as SFUNC_BASE functions may have multiple copies of the same name string
+        std::unordered_map<std::string_view, ServiceStatistics::FunctionStatistics> PreviousFunctions; //!< The totals at the time of the last summary with sinceLastSummary set
+
+        u64 TicksToNs(u64 ticks) {
+            static const u64 frequency{[] {
+                u64 frequency;
+                asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+                return frequency;
+            }()};
+            return ((ticks / frequency) * constant::NsInSecond) + (((ticks % frequency) * constant::NsInSecond) / frequency);
+        }
+    }
+
+    void ServiceStatistics::Flush(ThreadStatistics &statistics, u64 nowTicks) {
+        statistics.lastFlushTicks = nowTicks;
+
+        std::scoped_lock lock{GlobalMutex};
+        for (auto &[name, local] : statistics.functions) {
+            if (!local.count)
+                continue;
+
+            auto &global{GlobalFunctions[name]};
+            global.count += local.count;
+            global.totalTicks += local.totalTicks;
+            global.maxTicks = std::max(global.maxTicks, local.maxTicks);
+            local = {}; // The entry is retained so the next call to the function from this thread doesn't allocate
+        }
+    }
+
+    std::string ServiceStatistics::GetSummary(size_t count, bool sinceLastSummary) {
+        std::vector<std::pair<std::string_view, FunctionStatistics>> functions;
+        {
+            std::scoped_lock lock{GlobalMutex};
+            functions.reserve(GlobalFunctions.size());
+            for (const auto &[name, global] : GlobalFunctions) {
+                auto delta{global};
+                if (sinceLastSummary) {
+                    auto &previous{PreviousFunctions[name]};
+                    delta.count -= previous.count;
+                    delta.totalTicks -= previous.totalTicks;
+                    previous = global;
+                }
+                if (delta.count)
+                    functions.emplace_back(name, delta);
+            }
+        }
+
+        count = std::min(count, functions.size());
+        std::partial_sort(functions.begin(), functions.begin() + static_cast<ssize_t>(count), functions.end(), [](const auto &a, const auto &b) {
+            return a.second.totalTicks > b.second.totalTicks;
+        });
+
+        auto toUs{[](u64 ticks) { return static_cast<double>(TicksToNs(ticks)) / constant::NsInMicrosecond; }};
+        std::string summary;
+        for (size_t index{}; index < count; index++) {
+            const auto &[name, function]{functions[index]};
+            if (!summary.empty())
+                summary += '\n';
+            summary += fmt::format("{}: {} calls, {:.1f}us total, {:.1f}us avg, {:.1f}us max", name, function.count, toUs(function.totalTicks), toUs(function.totalTicks / function.count), toUs(function.maxTicks));
+        }
+        return summary;
+    }
+}
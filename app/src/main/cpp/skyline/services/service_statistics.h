@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::service {
+    /**
+     * @brief Always-on per-function call counts and wall time for HLE service functions keyed by their SFUNC name, these are accumulated into thread-local maps in BaseService::HandleRequest and are periodically merged into global totals
+     */
+    class ServiceStatistics {
+      public:
+        /**
+         * @brief The aggregated statistics of a single service function
+         */
+        struct FunctionStatistics {
+            u64 count; //!< The amount of times the function was called
+            u64 totalTicks; //!< The total amount of host counter ticks spent in the function
+            u64 maxTicks; //!< The largest amount of host counter ticks spent in a single call
+        };
+
+      private:
+        /**
+         * @brief The minimum interval at which thread-local statistics are merged into the global totals in host counter ticks, this is 100ms
+         */
+        static inline const u64 FlushIntervalTicks{[] {
+            u64 frequency;
+            asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+            return frequency / 10;
+        }()};
+
+        /**
+         * @brief The statistics accumulated by a single thread since its last flush
+         * @note Functions are keyed by the address of their static name string, this only allocates on the first call to a function from a thread in between flushes
+         */
+        struct ThreadStatistics {
+            u64 lastFlushTicks; //!< The host counter value at the time of the last flush
+            std::unordered_map<const char *, FunctionStatistics> functions;
+        };
+
+        static inline thread_local ThreadStatistics localStatistics{};
+
+        /**
+         * @brief Merges the supplied thread-local statistics into the global totals and resets them
+         */
+        static void Flush(ThreadStatistics &statistics, u64 nowTicks);
+
+      public:
+        /**
+         * @brief Records a single call to a service function into the calling thread's statistics
+         * @param name The static "Class::Function" name string of the function
+         * @param startTicks The host counter value at the start of the call
+         * @param endTicks The host counter value at the end of the call
+         */
+        static void Record(const char *name, u64 startTicks, u64 endTicks) {
+            auto &statistics{localStatistics};
+            auto &function{statistics.functions[name]};
+            u64 ticks{endTicks - startTicks};
+            function.count++;
+            function.totalTicks += ticks;
+            function.maxTicks = std::max(function.maxTicks, ticks);
+
+            if (endTicks - statistics.lastFlushTicks >= FlushIntervalTicks) [[unlikely]]
+                Flush(statistics, endTicks);
+        }
+
+        /**
+         * @return A human-readable summary of the service functions which the most time has been spent in
+         * @param count The maximum amount of functions to include in the summary
+         * @param sinceLastSummary If the summary should only cover calls made since the last call with this set rather than all calls, the maximum call duration is always cumulative
+         */
+        static std::string GetSummary(size_t count, bool sinceLastSummary = true);
+    };
+}
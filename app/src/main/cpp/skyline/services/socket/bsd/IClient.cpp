@@ -1,10 +1,193 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include "IClient.h"
 
 namespace skyline::service::socket {
-    IClient::IClient(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
+    /**
+     * @brief The BSD layout of sockaddr_in which is used by the guest, it differs from the host layout in having a length byte prior to a single byte family
+     */
+    struct BsdSockAddrIn {
+        u8 length;
+        u8 family;
+        u16 port; //!< The port in network byte order
+        u32 address; //!< The IPv4 address in network byte order
+        std::array<u8, 8> _pad0_;
+    };
+    static_assert(sizeof(BsdSockAddrIn) == 0x10);
+
+    /**
+     * @brief Converts a guest BSD socket address into a host socket address
+     * @return If the guest address is a valid IPv4 address
+     */
+    static bool ToHostAddress(span<u8> guest, sockaddr_in &host) {
+        if (guest.size() < sizeof(BsdSockAddrIn))
+            return false;
+
+        auto &address{guest.as<BsdSockAddrIn>()};
+        host = sockaddr_in{
+            .sin_family = address.family,
+            .sin_port = address.port,
+            .sin_addr = {.s_addr = address.address},
+        };
+        return true;
+    }
+
+    /**
+     * @brief Writes a host socket address into a guest buffer in the BSD layout
+     * @return The size of the written address
+     */
+    static u32 FromHostAddress(const sockaddr_in &host, span<u8> guest) {
+        BsdSockAddrIn address{
+            .length = sizeof(BsdSockAddrIn),
+            .family = static_cast<u8>(host.sin_family),
+            .port = host.sin_port,
+            .address = host.sin_addr.s_addr,
+        };
+        size_t size{std::min(guest.size(), sizeof(BsdSockAddrIn))};
+        std::memcpy(guest.data(), &address, size);
+        return static_cast<u32>(size);
+    }
+
+    namespace bsd {
+        constexpr u32 MsgOob{0x1};
+        constexpr u32 MsgPeek{0x2};
+        constexpr u32 MsgDontRoute{0x4};
+        constexpr u32 MsgWaitAll{0x40};
+        constexpr u32 MsgDontWait{0x80};
+
+        constexpr i32 SockNonBlock{0x20000000};
+        constexpr i32 SockCloExec{0x10000000};
+
+        constexpr i32 OptionNonBlock{0x4}; //!< O_NONBLOCK
+        constexpr i32 SolSocket{0xFFFF};
+    }
+
+    /**
+     * @brief Converts guest BSD message flags into host message flags
+     * @param dontWait Set to true if the guest requested the call to not wait
+     */
+    static int ToHostMessageFlags(u32 flags, bool &dontWait) {
+        dontWait = flags & bsd::MsgDontWait;
+        return ((flags & bsd::MsgOob) ? MSG_OOB : 0) |
+            ((flags & bsd::MsgPeek) ? MSG_PEEK : 0) |
+            ((flags & bsd::MsgDontRoute) ? MSG_DONTROUTE : 0) |
+            ((flags & bsd::MsgWaitAll) ? MSG_WAITALL : 0) |
+            MSG_DONTWAIT | MSG_NOSIGNAL; // Host sockets never block and must not raise SIGPIPE
+    }
+
+    /**
+     * @brief Converts a guest socket option into a host socket option, options at levels other than SOL_SOCKET share their values with the host
+     * @return If the option is supported
+     */
+    static bool ToHostSocketOption(i32 &level, i32 &option) {
+        if (level != bsd::SolSocket)
+            return true;
+
+        level = SOL_SOCKET;
+        switch (option) {
+            case 0x4:
+                option = SO_REUSEADDR;
+                return true;
+            case 0x8:
+                option = SO_KEEPALIVE;
+                return true;
+            case 0x20:
+                option = SO_BROADCAST;
+                return true;
+            case 0x80:
+                option = SO_LINGER;
+                return true;
+            case 0x100:
+                option = SO_OOBINLINE;
+                return true;
+            case 0x200:
+                option = SO_REUSEPORT;
+                return true;
+            case 0x1001:
+                option = SO_SNDBUF;
+                return true;
+            case 0x1002:
+                option = SO_RCVBUF;
+                return true;
+            case 0x1003:
+                option = SO_SNDLOWAT;
+                return true;
+            case 0x1004:
+                option = SO_RCVLOWAT;
+                return true;
+            case 0x1007:
+                option = SO_ERROR;
+                return true;
+            case 0x1008:
+                option = SO_TYPE;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Pushes the return value of a BSD call alongside the errno, which is only non-zero when the call failed
+     */
+    static void PushBsdResult(ipc::IpcResponse &response, i64 value) {
+        response.Push<i32>(static_cast<i32>(value));
+        response.Push<u32>(value < 0 ? static_cast<u32>(errno) : 0);
+    }
+
+    /**
+     * @brief Pushes a failed BSD call with the supplied errno
+     */
+    static void PushBsdError(ipc::IpcResponse &response, int error) {
+        response.Push<i32>(-1);
+        response.Push<u32>(static_cast<u32>(error));
+    }
+
+    IClient::IClient(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager), reactor(state) {}
+
+    IClient::~IClient() {
+        for (auto &socket : sockets) {
+            if (socket) {
+                reactor.Remove(socket->fd);
+                close(socket->fd);
+            }
+        }
+    }
+
+    std::optional<IClient::HostSocket> IClient::GetSocket(i32 fd) {
+        std::lock_guard lock(socketMutex);
+        if (fd < 0 || static_cast<size_t>(fd) >= sockets.size())
+            return std::nullopt;
+        return sockets[static_cast<size_t>(fd)];
+    }
+
+    i32 IClient::InsertSocket(HostSocket socket) {
+        std::lock_guard lock(socketMutex);
+        auto it{std::find(sockets.begin(), sockets.end(), std::nullopt)};
+        if (it != sockets.end()) {
+            *it = socket;
+            return static_cast<i32>(std::distance(sockets.begin(), it));
+        }
+
+        sockets.emplace_back(socket);
+        return static_cast<i32>(sockets.size() - 1);
+    }
+
+    template<typename Operation>
+    auto IClient::BlockingCall(const HostSocket &socket, bool nonBlocking, short events, Operation operation) -> decltype(operation()) {
+        while (true) {
+            auto result{operation()};
+            if (result >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK) || nonBlocking)
+                return result;
+
+            pollfd pollFd{.fd = socket.fd, .events = events};
+            if (reactor.Poll(span<pollfd>(pollFd), std::chrono::nanoseconds(-1)) < 0)
+                return -1;
+        }
+    }
 
     Result IClient::RegisterClient(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         response.Push<u32>(0);
@@ -14,4 +197,375 @@ namespace skyline::service::socket {
     Result IClient::StartMonitoring(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         return {};
     }
+
+    Result IClient::Socket(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto domain{request.Pop<i32>()};
+        auto type{request.Pop<i32>()};
+        auto protocol{request.Pop<i32>()};
+
+        int fd{::socket(domain, (type & ~(bsd::SockNonBlock | bsd::SockCloExec)) | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol)};
+        if (fd < 0) {
+            PushBsdResult(response, fd);
+            return {};
+        }
+
+        reactor.Add(fd);
+        PushBsdResult(response, InsertSocket(HostSocket{.fd = fd, .nonBlocking = static_cast<bool>(type & bsd::SockNonBlock)}));
+        return {};
+    }
+
+    Result IClient::Poll(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto count{request.Pop<u32>()};
+        auto timeout{request.Pop<i32>()};
+
+        auto guestFds{request.inputBuf.at(0).cast<pollfd>()};
+        auto outputFds{request.outputBuf.at(0).cast<pollfd>()};
+        if (guestFds.size() < count || outputFds.size() < count) {
+            PushBsdError(response, EINVAL);
+            return {};
+        }
+
+        // Guest descriptors are translated into host descriptors, invalid ones are set to be ignored by poll and reported as POLLNVAL afterwards
+        std::vector<pollfd> hostFds(count);
+        for (u32 index{}; index < count; index++) {
+            const auto &guestFd{guestFds[index]};
+            auto socket{GetSocket(guestFd.fd)};
+            hostFds[index] = pollfd{.fd = socket ? socket->fd : -1, .events = guestFd.events};
+        }
+
+        auto result{reactor.Poll(hostFds, timeout < 0 ? std::chrono::nanoseconds(-1) : std::chrono::milliseconds(timeout))};
+
+        for (u32 index{}; index < count; index++) {
+            outputFds[index] = guestFds[index];
+            if (hostFds[index].fd >= 0) {
+                outputFds[index].revents = hostFds[index].revents;
+            } else if (guestFds[index].fd >= 0) {
+                outputFds[index].revents = POLLNVAL;
+                result += result >= 0;
+            }
+        }
+
+        PushBsdResult(response, result);
+        return {};
+    }
+
+    Result IClient::Recv(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto socket{GetSocket(fd)};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        bool dontWait;
+        auto flags{ToHostMessageFlags(request.Pop<u32>(), dontWait)};
+        auto buffer{request.outputBuf.at(0)};
+        PushBsdResult(response, BlockingCall(*socket, socket->nonBlocking || dontWait, POLLIN, [&]() {
+            return recv(socket->fd, buffer.data(), buffer.size(), flags);
+        }));
+        return {};
+    }
+
+    Result IClient::RecvFrom(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto socket{GetSocket(fd)};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        bool dontWait;
+        auto flags{ToHostMessageFlags(request.Pop<u32>(), dontWait)};
+        auto buffer{request.outputBuf.at(0)};
+        sockaddr_in address{};
+        socklen_t addressLength{sizeof(address)};
+        auto result{BlockingCall(*socket, socket->nonBlocking || dontWait, POLLIN, [&]() {
+            return recvfrom(socket->fd, buffer.data(), buffer.size(), flags, reinterpret_cast<sockaddr *>(&address), &addressLength);
+        })};
+        int error{errno};
+
+        u32 guestAddressLength{};
+        if (result >= 0 && request.outputBuf.size() > 1 && addressLength)
+            guestAddressLength = FromHostAddress(address, request.outputBuf[1]);
+
+        errno = error;
+        PushBsdResult(response, result);
+        response.Push<u32>(guestAddressLength);
+        return {};
+    }
+
+    Result IClient::Send(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto socket{GetSocket(fd)};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        bool dontWait;
+        auto flags{ToHostMessageFlags(request.Pop<u32>(), dontWait)};
+        auto buffer{request.inputBuf.at(0)};
+        PushBsdResult(response, BlockingCall(*socket, socket->nonBlocking || dontWait, POLLOUT, [&]() {
+            return send(socket->fd, buffer.data(), buffer.size(), flags);
+        }));
+        return {};
+    }
+
+    Result IClient::SendTo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto socket{GetSocket(fd)};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        bool dontWait;
+        auto flags{ToHostMessageFlags(request.Pop<u32>(), dontWait)};
+
+        // Pointer (X) buffers are ordered before A buffers, a large payload in an A buffer comes after the address in an X buffer
+        auto buffer{request.inputBuf.at(0)};
+        span<u8> guestAddress{};
+        if (request.inputBuf.size() > 1) {
+            guestAddress = request.inputBuf[1];
+            if (guestAddress.size() != sizeof(BsdSockAddrIn) && buffer.size() == sizeof(BsdSockAddrIn))
+                std::swap(buffer, guestAddress);
+        }
+
+        sockaddr_in address{};
+        bool hasAddress{ToHostAddress(guestAddress, address)};
+        PushBsdResult(response, BlockingCall(*socket, socket->nonBlocking || dontWait, POLLOUT, [&]() {
+            return sendto(socket->fd, buffer.data(), buffer.size(), flags, hasAddress ? reinterpret_cast<sockaddr *>(&address) : nullptr, hasAddress ? sizeof(address) : 0);
+        }));
+        return {};
+    }
+
+    Result IClient::Accept(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto socket{GetSocket(fd)};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        sockaddr_in address{};
+        socklen_t addressLength{sizeof(address)};
+        int acceptedFd{BlockingCall(*socket, socket->nonBlocking, POLLIN, [&]() {
+            return accept4(socket->fd, reinterpret_cast<sockaddr *>(&address), &addressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        })};
+        if (acceptedFd < 0) {
+            PushBsdResult(response, acceptedFd);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        reactor.Add(acceptedFd);
+        PushBsdResult(response, InsertSocket(HostSocket{.fd = acceptedFd}));
+        response.Push<u32>(request.outputBuf.empty() ? 0 : FromHostAddress(address, request.outputBuf[0]));
+        return {};
+    }
+
+    Result IClient::Bind(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        sockaddr_in address{};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+        } else if (request.inputBuf.empty() || !ToHostAddress(request.inputBuf[0], address)) {
+            PushBsdError(response, EINVAL);
+        } else {
+            PushBsdResult(response, bind(socket->fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)));
+        }
+        return {};
+    }
+
+    Result IClient::Connect(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        sockaddr_in address{};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        } else if (request.inputBuf.empty() || !ToHostAddress(request.inputBuf[0], address)) {
+            PushBsdError(response, EINVAL);
+            return {};
+        }
+
+        int result{connect(socket->fd, reinterpret_cast<sockaddr *>(&address), sizeof(address))};
+        if (result < 0 && errno == EINPROGRESS && !socket->nonBlocking) {
+            // A connection on a blocking socket completes when the socket becomes writable, the result of it is retrieved from SO_ERROR
+            pollfd pollFd{.fd = socket->fd, .events = POLLOUT};
+            if ((result = reactor.Poll(span<pollfd>(pollFd), std::chrono::nanoseconds(-1))) >= 0) {
+                int error{};
+                socklen_t errorLength{sizeof(error)};
+                getsockopt(socket->fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+                errno = error;
+                result = error ? -1 : 0;
+            }
+        }
+
+        PushBsdResult(response, result);
+        return {};
+    }
+
+    Result IClient::GetPeerName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        sockaddr_in address{};
+        socklen_t addressLength{sizeof(address)};
+        int result{getpeername(socket->fd, reinterpret_cast<sockaddr *>(&address), &addressLength)};
+        PushBsdResult(response, result);
+        response.Push<u32>((result < 0 || request.outputBuf.empty()) ? 0 : FromHostAddress(address, request.outputBuf[0]));
+        return {};
+    }
+
+    Result IClient::GetSockName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        sockaddr_in address{};
+        socklen_t addressLength{sizeof(address)};
+        int result{getsockname(socket->fd, reinterpret_cast<sockaddr *>(&address), &addressLength)};
+        PushBsdResult(response, result);
+        response.Push<u32>((result < 0 || request.outputBuf.empty()) ? 0 : FromHostAddress(address, request.outputBuf[0]));
+        return {};
+    }
+
+    Result IClient::GetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto level{request.Pop<i32>()};
+        auto option{request.Pop<i32>()};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            response.Push<u32>(0);
+            return {};
+        } else if (!ToHostSocketOption(level, option) || request.outputBuf.empty()) {
+            PushBsdError(response, ENOPROTOOPT);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        auto buffer{request.outputBuf[0]};
+        auto length{static_cast<socklen_t>(buffer.size())};
+        int result{getsockopt(socket->fd, level, option, buffer.data(), &length)};
+        PushBsdResult(response, result);
+        response.Push<u32>(result < 0 ? 0 : length);
+        return {};
+    }
+
+    Result IClient::Listen(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto backlog{request.Pop<i32>()};
+        if (!socket)
+            PushBsdError(response, EBADF);
+        else
+            PushBsdResult(response, listen(socket->fd, backlog));
+        return {};
+    }
+
+    Result IClient::Fcntl(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto command{request.Pop<i32>()};
+        auto argument{request.Pop<i32>()};
+
+        std::lock_guard lock(socketMutex);
+        if (fd < 0 || static_cast<size_t>(fd) >= sockets.size() || !sockets[static_cast<size_t>(fd)]) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        // Host sockets are always non-blocking, only the guest's view of the flag is tracked
+        auto &socket{*sockets[static_cast<size_t>(fd)]};
+        if (command == F_GETFL) {
+            PushBsdResult(response, socket.nonBlocking ? bsd::OptionNonBlock : 0);
+        } else if (command == F_SETFL) {
+            socket.nonBlocking = argument & bsd::OptionNonBlock;
+            PushBsdResult(response, 0);
+        } else {
+            PushBsdError(response, EINVAL);
+        }
+        return {};
+    }
+
+    Result IClient::SetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto level{request.Pop<i32>()};
+        auto option{request.Pop<i32>()};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+        } else if (!ToHostSocketOption(level, option) || request.inputBuf.empty()) {
+            PushBsdError(response, ENOPROTOOPT);
+        } else {
+            auto buffer{request.inputBuf[0]};
+            PushBsdResult(response, setsockopt(socket->fd, level, option, buffer.data(), static_cast<socklen_t>(buffer.size())));
+        }
+        return {};
+    }
+
+    Result IClient::Shutdown(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto how{request.Pop<i32>()};
+        if (!socket)
+            PushBsdError(response, EBADF);
+        else
+            PushBsdResult(response, shutdown(socket->fd, how));
+        return {};
+    }
+
+    Result IClient::Write(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        auto buffer{request.inputBuf.at(0)};
+        PushBsdResult(response, BlockingCall(*socket, socket->nonBlocking, POLLOUT, [&]() {
+            return send(socket->fd, buffer.data(), buffer.size(), MSG_NOSIGNAL);
+        }));
+        return {};
+    }
+
+    Result IClient::Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        auto buffer{request.outputBuf.at(0)};
+        PushBsdResult(response, BlockingCall(*socket, socket->nonBlocking, POLLIN, [&]() {
+            return read(socket->fd, buffer.data(), buffer.size());
+        }));
+        return {};
+    }
+
+    Result IClient::Close(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+
+        std::optional<HostSocket> socket;
+        {
+            std::lock_guard lock(socketMutex);
+            if (fd >= 0 && static_cast<size_t>(fd) < sockets.size())
+                socket = std::exchange(sockets[static_cast<size_t>(fd)], std::nullopt);
+        }
+
+        if (!socket) {
+            PushBsdError(response, EBADF);
+            return {};
+        }
+
+        // Any threads waiting on the socket are woken after it's unregistered, they observe it being closed as POLLNVAL
+        reactor.Remove(socket->fd);
+        PushBsdResult(response, close(socket->fd));
+        return {};
+    }
 }
@@ -4,16 +4,47 @@
 #pragma once
 
 #include <services/serviceman.h>
+#include "socket_reactor.h"
 
 namespace skyline::service::socket {
     /**
      * @brief IClient or bsd:u is used by applications create network sockets
+     * @note All host sockets are non-blocking, guest calls on blocking sockets wait on the socket reactor so they don't hold up the calling thread's core
      * @url https://switchbrew.org/wiki/Sockets_services#bsd:u.2C_bsd:s
      */
     class IClient : public BaseService {
+      private:
+        struct HostSocket {
+            int fd; //!< The host socket
+            bool nonBlocking; //!< If the guest has put the socket into non-blocking mode, calls on it return EAGAIN rather than waiting
+        };
+
+        SocketReactor reactor;
+        std::mutex socketMutex; //!< Synchronizes access to the socket table
+        std::vector<std::optional<HostSocket>> sockets; //!< A table of sockets indexed by their guest file descriptor
+
+        /**
+         * @return A copy of the socket with the supplied guest file descriptor or std::nullopt if there's no such socket
+         */
+        std::optional<HostSocket> GetSocket(i32 fd);
+
+        /**
+         * @return The guest file descriptor of the inserted socket
+         */
+        i32 InsertSocket(HostSocket socket);
+
+        /**
+         * @brief Repeatedly calls a non-blocking host socket operation till it doesn't fail with EAGAIN, waiting for the supplied events on the socket between calls
+         * @return The return value of the last call to the operation, errno is set if it's negative
+         */
+        template<typename Operation>
+        auto BlockingCall(const HostSocket &socket, bool nonBlocking, short events, Operation operation) -> decltype(operation());
+
       public:
         IClient(const DeviceState &state, ServiceManager &manager);
 
+        ~IClient();
+
         /**
          * @brief Initializes a socket client with the given parameters
          * @url https://switchbrew.org/wiki/Sockets_services#Initialize
@@ -25,9 +56,123 @@ namespace skyline::service::socket {
          */
         Result StartMonitoring(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Socket
+         */
+        Result Socket(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Poll
+         */
+        Result Poll(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Recv
+         */
+        Result Recv(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#RecvFrom
+         */
+        Result RecvFrom(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Send
+         */
+        Result Send(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#SendTo
+         */
+        Result SendTo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Accept
+         */
+        Result Accept(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Bind
+         */
+        Result Bind(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Connect
+         */
+        Result Connect(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#GetPeerName
+         */
+        Result GetPeerName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#GetSockName
+         */
+        Result GetSockName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#GetSockOpt
+         */
+        Result GetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Listen
+         */
+        Result Listen(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Fcntl
+         */
+        Result Fcntl(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#SetSockOpt
+         */
+        Result SetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Shutdown
+         */
+        Result Shutdown(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Write
+         */
+        Result Write(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Read
+         */
+        Result Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @url https://switchbrew.org/wiki/Sockets_services#Close
+         */
+        Result Close(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
         SERVICE_DECL(
             SFUNC(0x0, IClient, RegisterClient),
-            SFUNC(0x1, IClient, StartMonitoring)
+            SFUNC(0x1, IClient, StartMonitoring),
+            SFUNC(0x2, IClient, Socket),
+            SFUNC(0x6, IClient, Poll),
+            SFUNC(0x8, IClient, Recv),
+            SFUNC(0x9, IClient, RecvFrom),
+            SFUNC(0xA, IClient, Send),
+            SFUNC(0xB, IClient, SendTo),
+            SFUNC(0xC, IClient, Accept),
+            SFUNC(0xD, IClient, Bind),
+            SFUNC(0xE, IClient, Connect),
+            SFUNC(0xF, IClient, GetPeerName),
+            SFUNC(0x10, IClient, GetSockName),
+            SFUNC(0x11, IClient, GetSockOpt),
+            SFUNC(0x12, IClient, Listen),
+            SFUNC(0x14, IClient, Fcntl),
+            SFUNC(0x15, IClient, SetSockOpt),
+            SFUNC(0x16, IClient, Shutdown),
+            SFUNC(0x18, IClient, Write),
+            SFUNC(0x19, IClient, Read),
+            SFUNC(0x1A, IClient, Close)
         )
     };
 }
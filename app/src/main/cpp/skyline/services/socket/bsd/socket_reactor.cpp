@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <kernel/types/KProcess.h>
+#include "socket_reactor.h"
+
+namespace skyline::service::socket {
+    SocketReactor::SocketReactor(const DeviceState &state) : state(state) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0)
+            throw exception("Failed to create the socket reactor's epoll instance: {}", strerror(errno));
+
+        wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakeFd < 0)
+            throw exception("Failed to create the socket reactor's eventfd: {}", strerror(errno));
+
+        epoll_event event{.events = EPOLLIN, .data = {.fd = wakeFd}};
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0)
+            throw exception("Failed to register the socket reactor's eventfd: {}", strerror(errno));
+
+        thread = std::thread(&SocketReactor::Run, this);
+    }
+
+    SocketReactor::~SocketReactor() {
+        eventfd_write(wakeFd, 1);
+        if (thread.joinable())
+            thread.join();
+
+        close(wakeFd);
+        close(epollFd);
+    }
+
+    void SocketReactor::Run() {
+        pthread_setname_np(pthread_self(), "BSD-Reactor");
+
+        std::array<epoll_event, 64> events;
+        while (true) {
+            int count{epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1)};
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                Logger::Error("Socket reactor failed to wait on events: {}", strerror(errno));
+                return;
+            }
+
+            std::lock_guard lock(mutex);
+            for (const auto &event : span(events).first(static_cast<size_t>(count))) {
+                if (event.data.fd == wakeFd)
+                    return;
+                Wake(event.data.fd);
+            }
+        }
+    }
+
+    void SocketReactor::Wake(int fd) {
+        auto it{waiters.find(fd)};
+        if (it == waiters.end())
+            return;
+
+        for (auto waiter : it->second) {
+            waiter->woken = true;
+            waiter->condition.notify_one();
+        }
+    }
+
+    void SocketReactor::Unregister(Waiter &waiter, span<pollfd> fds) {
+        for (const auto &pollFd : fds) {
+            auto it{waiters.find(pollFd.fd)};
+            if (it == waiters.end())
+                continue;
+
+            std::erase(it->second, &waiter);
+            if (it->second.empty())
+                waiters.erase(it);
+        }
+    }
+
+    void SocketReactor::Add(int fd) {
+        epoll_event event{.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET, .data = {.fd = fd}};
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+            throw exception("Failed to register socket with the reactor: {}", strerror(errno));
+    }
+
+    void SocketReactor::Remove(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+
+        std::lock_guard lock(mutex);
+        Wake(fd);
+    }
+
+    int SocketReactor::Poll(span<pollfd> fds, std::chrono::nanoseconds timeout) {
+        i64 deadline{timeout.count() < 0 ? std::numeric_limits<i64>::max() : util::GetTimeNs() + timeout.count()};
+        while (true) {
+            int ready{poll(fds.data(), fds.size(), 0)};
+            i64 remaining{deadline - util::GetTimeNs()};
+            if (ready != 0 || remaining <= 0)
+                return ready;
+
+            Waiter waiter;
+            std::unique_lock lock(mutex);
+            for (const auto &pollFd : fds)
+                if (pollFd.fd >= 0)
+                    waiters[pollFd.fd].push_back(&waiter);
+
+            // Any edge between the prior poll and registering the waiter would be lost, readiness is rechecked now that any further edges will wake it
+            ready = poll(fds.data(), fds.size(), 0);
+            if (ready != 0) {
+                Unregister(waiter, fds);
+                return ready;
+            }
+
+            // The guest thread isn't in the scheduler's queue while the host thread blocks here, it's only inserted back by the caller after we return so it can't be inserted twice
+            if (timeout.count() < 0)
+                waiter.condition.wait(lock, [&]() { return waiter.woken; });
+            else
+                waiter.condition.wait_for(lock, std::chrono::nanoseconds(remaining), [&]() { return waiter.woken; });
+
+            Unregister(waiter, fds);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <poll.h>
+#include <condition_variable>
+#include <common.h>
+
+namespace skyline::service::socket {
+    /**
+     * @brief An epoll-driven reactor which wakes guest threads waiting on host socket readiness, the waiting threads are descheduled so their cores can run other threads in the meantime
+     * @note Sockets are registered for all events in edge-triggered mode once, waiters recheck readiness with a non-blocking poll after registering so they can't miss an edge
+     */
+    class SocketReactor {
+      private:
+        const DeviceState &state;
+        int epollFd;
+        int wakeFd; //!< An eventfd which is signalled to stop the reactor thread
+        std::thread thread;
+
+        struct Waiter {
+            std::condition_variable condition; //!< Signalled when any of the sockets being waited on has an event
+            bool woken{}; //!< If any of the sockets being waited on has had an event since the waiter was registered
+        };
+
+        std::mutex mutex; //!< Synchronizes the waiters
+        std::unordered_map<int, std::vector<Waiter *>> waiters; //!< The waiters on every host socket
+
+        void Run();
+
+        /**
+         * @brief Signals all waiters on the supplied host socket
+         * @note The mutex must be locked by the calling thread
+         */
+        void Wake(int fd);
+
+        /**
+         * @note The mutex must be locked by the calling thread
+         */
+        void Unregister(Waiter &waiter, span<pollfd> fds);
+
+      public:
+        SocketReactor(const DeviceState &state);
+
+        ~SocketReactor();
+
+        /**
+         * @brief Registers a non-blocking host socket with the reactor
+         */
+        void Add(int fd);
+
+        /**
+         * @brief Unregisters a host socket prior to it being closed, any threads waiting on it are woken to observe it being closed
+         */
+        void Remove(int fd);
+
+        /**
+         * @brief Waits for any of the supplied host sockets to become ready with the same semantics as poll(2)
+         * @param timeout The maximum duration to wait for, a negative duration waits indefinitely
+         * @return The return value of poll(2), errno is set if it's negative
+         * @note The calling thread must already be removed from the scheduler, as it is in HLE handlers under SchedulerScopedLock which inserts it back once the handler returns
+         */
+        int Poll(span<pollfd> fds, std::chrono::nanoseconds timeout);
+    };
+}
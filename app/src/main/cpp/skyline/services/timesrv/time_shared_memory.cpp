@@ -30,14 +30,17 @@ namespace skyline::service::timesrv::core {
 
     /**
      * @brief Time Shared Memory uses a double buffered format that alternates context data writes, this is a helper to simplify that
+     * @note This is a seqlock, the guest reads the item indexed by the update count and retries if the count changed while it was reading
      */
     template<typename T>
     static void UpdateTimeSharedMemoryItem(u32 &updateCount, std::array<T, 2> &item, const T &newValue) {
-        u32 newCount{updateCount + 1};
+        std::atomic_ref count{updateCount};
+        u32 newCount{count.load(std::memory_order_relaxed) + 1};
+        // A reader of the update prior to the last one may still be reading this item, the last update count must be visible before it's overwritten
+        std::atomic_thread_fence(std::memory_order_release);
         item[newCount & 1] = newValue;
         // The item value must be updated prior to updateCount to prevent reading in an invalid item value
-        std::atomic_thread_fence(std::memory_order_release);
-        updateCount = newCount;
+        count.store(newCount, std::memory_order_release);
     }
 
     /**
@@ -45,14 +48,15 @@ namespace skyline::service::timesrv::core {
      */
     template<typename T>
     static T ReadTimeSharedMemoryItem(u32 &updateCount, std::array<T, 2> &item) {
+        std::atomic_ref count{updateCount};
         u32 checkUpdateCount{};
         T out{};
 
         do {
-            checkUpdateCount = updateCount;
-            out = item[updateCount & 1];
-            std::atomic_thread_fence(std::memory_order_consume);
-        } while (checkUpdateCount != updateCount);
+            checkUpdateCount = count.load(std::memory_order_acquire);
+            out = item[checkUpdateCount & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (checkUpdateCount != count.load(std::memory_order_relaxed));
 
         return out;
     }
@@ -5,6 +5,15 @@
 #include "timezone_manager.h"
 
 namespace skyline::service::timesrv::core {
+    constexpr PosixTime SecondsPerDay{60 * 60 * 24};
+
+    TimeZoneManager::~TimeZoneManager() {
+        if (rule)
+            tz_tzfree(rule);
+        for (auto &[name, cachedRule] : ruleCache)
+            tz_tzfree(cachedRule);
+    }
+
     Result TimeZoneManager::Setup(std::string_view pLocationName, const SteadyClockTimePoint &pUpdateTime, int pLocationCount, std::array<u8, 0x10> pBinaryVersion, span<u8> binary) {
         SetNewLocation(pLocationName, binary);
         SetUpdateTime(pUpdateTime);
@@ -27,10 +36,15 @@ namespace skyline::service::timesrv::core {
     Result TimeZoneManager::SetNewLocation(std::string_view pLocationName, span<u8> binary) {
         std::lock_guard lock(mutex);
 
-        rule = tz_tzalloc(binary.data(), static_cast<long>(binary.size()));
-        if (!rule)
+        auto newRule{tz_tzalloc(binary.data(), static_cast<long>(binary.size()))};
+        if (!newRule)
             return result::RuleConversionFailed;
 
+        if (rule)
+            tz_tzfree(rule);
+        rule = newRule;
+        calendarDayCache.valid = false;
+
         span(locationName).copy_from(pLocationName);
 
         return {};
@@ -88,6 +102,30 @@ namespace skyline::service::timesrv::core {
         return {};
     }
 
+    bool TimeZoneManager::GetCachedTimeZoneRule(std::string_view pLocationName, span<u8> ruleOut) {
+        std::lock_guard lock(ruleCacheMutex);
+        auto it{ruleCache.find(std::string(pLocationName))};
+        if (it == ruleCache.end())
+            return false;
+
+        memcpy(ruleOut.data(), it->second, ruleOut.size_bytes());
+        return true;
+    }
+
+    Result TimeZoneManager::ParseAndCacheTimeZoneRule(std::string_view pLocationName, span<u8> binary, span<u8> ruleOut) {
+        auto ruleObj{tz_tzalloc(binary.data(), static_cast<long>(binary.size()))};
+        if (!ruleObj)
+            return result::RuleConversionFailed;
+
+        memcpy(ruleOut.data(), ruleObj, ruleOut.size_bytes());
+
+        std::lock_guard lock(ruleCacheMutex);
+        auto [it, inserted]{ruleCache.try_emplace(std::string(pLocationName), ruleObj)};
+        if (!inserted)
+            tz_tzfree(ruleObj); // Another thread raced us to parsing the same location
+        return {};
+    }
+
     ResultValue<FullCalendarTime> TimeZoneManager::ToCalendarTime(tz_timezone_t pRule, PosixTime posixTime) {
         struct tm tmp{};
         auto posixCalendarTime{tz_localtime_rz(pRule, &posixTime, &tmp)};
@@ -116,6 +154,39 @@ namespace skyline::service::timesrv::core {
         return out;
     }
 
+    ResultValue<FullCalendarTime> TimeZoneManager::ToCalendarTimeWithMyRule(PosixTime posixTime) {
+        std::lock_guard lock(mutex);
+
+        if (calendarDayCache.valid && posixTime >= calendarDayCache.dayStart && posixTime < calendarDayCache.dayStart + SecondsPerDay) {
+            auto secondOfDay{posixTime - calendarDayCache.dayStart};
+            auto out{calendarDayCache.calendarTime};
+            out.calendarTime.hour = static_cast<u8>(secondOfDay / (60 * 60));
+            out.calendarTime.minute = static_cast<u8>((secondOfDay / 60) % 60);
+            out.calendarTime.second = static_cast<u8>(secondOfDay % 60);
+            return out;
+        }
+
+        auto calendarTime{ToCalendarTime(rule, posixTime)};
+        if (!calendarTime)
+            return calendarTime;
+
+        // tzcode's rule is opaque so the offset period is found by probing both ends of the local day, the day is only cached if the offset is the same at both
+        auto &time{calendarTime->calendarTime};
+        PosixTime dayStart{posixTime - (time.hour * 60 * 60 + time.minute * 60 + time.second)};
+        auto startTime{ToCalendarTime(rule, dayStart)}, endTime{ToCalendarTime(rule, dayStart + SecondsPerDay - 1)};
+        auto isSameOffset{[&](ResultValue<FullCalendarTime> &other) {
+            return other && other->additionalInfo.gmtOffset == calendarTime->additionalInfo.gmtOffset && other->additionalInfo.dst == calendarTime->additionalInfo.dst && other->calendarTime.day == time.day;
+        }};
+
+        calendarDayCache.valid = isSameOffset(startTime) && isSameOffset(endTime);
+        if (calendarDayCache.valid) {
+            calendarDayCache.dayStart = dayStart;
+            calendarDayCache.calendarTime = *startTime;
+        }
+
+        return calendarTime;
+    }
+
     ResultValue<PosixTime> TimeZoneManager::ToPosixTime(tz_timezone_t pRule, CalendarTime calendarTime) {
         struct tm posixCalendarTime{
             .tm_year = calendarTime.year,
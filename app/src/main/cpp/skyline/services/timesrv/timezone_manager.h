@@ -21,11 +21,25 @@ namespace skyline::service::timesrv::core {
         std::array<u8, 0x10> binaryVersion{}; //!< The version of the tzdata package
         LocationName locationName{}; //!< Name of the currently selected location
 
+        std::mutex ruleCacheMutex;
+        std::unordered_map<std::string, tz_timezone_t> ruleCache; //!< Parsed rules of locations which have been loaded by applications, keyed by location name
+
+        /**
+         * @brief The calendar time of a local day during which the current location's UTC offset doesn't change, conversions within it only need to offset the time of day
+         */
+        struct CalendarDayCache {
+            PosixTime dayStart{}; //!< The POSIX time at the start of the local day
+            FullCalendarTime calendarTime{}; //!< The calendar time at the start of the day
+            bool valid{};
+        } calendarDayCache; //!< Protected by the manager's mutex
+
         void MarkInitialized() {
             initialized = true;
         }
 
       public:
+        ~TimeZoneManager();
+
         bool IsInitialized() {
             return initialized;
         }
@@ -59,6 +73,17 @@ namespace skyline::service::timesrv::core {
          */
         static Result ParseTimeZoneBinary(span<u8> binary, span<u8> ruleOut);
 
+        /**
+         * @brief Copies the cached rule of the supplied location into ruleOut
+         * @return If a rule for the location was cached
+         */
+        bool GetCachedTimeZoneRule(std::string_view pLocationName, span<u8> ruleOut);
+
+        /**
+         * @brief Parses a raw TZIF2 file into ruleOut and caches the rule for future loads of the same location
+         */
+        Result ParseAndCacheTimeZoneRule(std::string_view pLocationName, span<u8> binary, span<u8> ruleOut);
+
         /**
          * @brief Converts a POSIX time to a calendar time using the given rule
          */
@@ -66,10 +91,9 @@ namespace skyline::service::timesrv::core {
 
         /**
          * @brief Converts a POSIX to a calendar time using the current location's rule
+         * @note Conversions within the same local day as the prior conversion skip tzcode if the UTC offset is constant throughout the day
          */
-        ResultValue<FullCalendarTime> ToCalendarTimeWithMyRule(PosixTime posixTime) {
-            return ToCalendarTime(rule, posixTime);
-        }
+        ResultValue<FullCalendarTime> ToCalendarTimeWithMyRule(PosixTime posixTime);
 
         /**
          * @brief Converts a calendar time to a POSIX time using the given rule
@@ -80,6 +104,7 @@ namespace skyline::service::timesrv::core {
          * @brief Converts a calendar time to a POSIX time using the current location's rule
          */
         ResultValue<PosixTime> ToPosixTimeWithMyRule(CalendarTime calendarTime) {
+            std::lock_guard lock(mutex);
             return ToPosixTime(rule, calendarTime);
         }
     };
@@ -5,6 +5,9 @@
 
 #include <gpu/interconnect/command_executor.h>
 #include "engines/engine.h"
+#include "engines/fermi_2d.h"
+#include "engines/kepler_memory.h"
+#include "engines/maxwell_dma.h"
 #include "gpfifo.h"
 
 namespace skyline::soc::gm20b {
@@ -21,11 +24,11 @@ namespace skyline::soc::gm20b {
     struct ChannelContext {
         std::shared_ptr<AddressSpaceContext> asCtx;
         gpu::interconnect::CommandExecutor executor;
-        engine::Engine fermi2D;
+        engine::Fermi2D fermi2D;
         std::unique_ptr<engine::maxwell3d::Maxwell3D> maxwell3D; //!< TODO: fix this once graphics context is moved into a cpp file
         engine::Engine maxwellCompute;
-        engine::Engine maxwellDma;
-        engine::Engine keplerMemory;
+        engine::MaxwellDma maxwellDma;
+        engine::KeplerMemory keplerMemory;
         ChannelGpfifo gpfifo;
 
         ChannelContext(const DeviceState &state, std::shared_ptr<AddressSpaceContext> asCtx, size_t numEntries);
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::soc::gm20b::engine {
+    /**
+     * @brief The layout of a block-linear surface as it's described to the copy engines, this is used to address surfaces in guest memory directly
+     * @note Reference on Block-linear tiling: https://gist.github.com/PixelyIon/d9c35050af0ef5690566ca9f0965bc32
+     */
+    struct BlockLinearLayout {
+        static constexpr u32 SectorWidth{16}; //!< The width of a sector in bytes, bytes inside a sector are always contiguous
+        static constexpr u32 GobWidth{64}; //!< The width of a GOB in bytes
+        static constexpr u32 GobHeight{8}; //!< The height of a GOB in lines
+        static constexpr u32 GobSize{GobWidth * GobHeight}; //!< The size of a GOB in bytes
+
+        u32 width; //!< The width of the surface in bytes
+        u32 height; //!< The height of the surface in lines
+        u32 blockHeightLog2; //!< The height of a block in GOBs with log2 encoding
+        u32 blockDepthLog2; //!< The depth of a block in GOBs with log2 encoding
+
+        /**
+         * @return The size of a single slice of blocks in bytes
+         */
+        constexpr size_t GetSliceSize() const {
+            u32 robHeight{GobHeight << blockHeightLog2}; // The height of a single ROB (Row of Blocks) in lines
+            return static_cast<size_t>(util::AlignUp(width, GobWidth) / GobWidth) * (util::AlignUp(height, robHeight) / robHeight) * (GobSize << blockHeightLog2 << blockDepthLog2);
+        }
+
+        /**
+         * @return The size of the surface in bytes up to the end of the last slice of blocks that contains the supplied Z coordinate
+         */
+        constexpr size_t GetSize(u32 z) const {
+            return GetSliceSize() * ((z >> blockDepthLog2) + 1);
+        }
+
+        /**
+         * @return The offset of a byte in the surface relative to the start of the surface
+         */
+        constexpr size_t GetOffset(u32 x, u32 y, u32 z) const {
+            u32 blockHeight{1U << blockHeightLog2}, blockDepth{1U << blockDepthLog2};
+            u32 robHeight{GobHeight * blockHeight};
+            u32 robWidth{util::AlignUp(width, GobWidth) / GobWidth}; // The width of a ROB in blocks
+            u32 sliceRobs{util::AlignUp(height, robHeight) / robHeight}; // The amount of ROBs in a single slice of blocks
+            size_t blockSize{static_cast<size_t>(GobSize) * blockHeight * blockDepth};
+
+            size_t blockIndex{(static_cast<size_t>(z / blockDepth) * sliceRobs + (y / robHeight)) * robWidth + (x / GobWidth)};
+            size_t gobOffset{(((z % blockDepth) * blockHeight) + ((y % robHeight) / GobHeight)) * GobSize};
+            size_t sectorOffset{((x % GobWidth) / 32) * 256 + ((y % GobHeight) / 2) * 64 + ((x % 32) / SectorWidth) * 32 + (y % 2) * SectorWidth + (x % SectorWidth)};
+            return blockIndex * blockSize + gobOffset + sectorOffset;
+        }
+    };
+}
@@ -25,6 +25,17 @@ namespace skyline::soc::gm20b {
             void CallMethod(u32 method, u32 argument, bool lastCall) {
                 Logger::Warn("Called method in unimplemented engine: 0x{:X} args: 0x{:X}", method, argument);
             };
+
+            /**
+             * @brief Calls an engine method with multiple arguments from a single pushbuffer method header
+             * @param incrementing If the method should be incremented for each argument (IncMethod) or if all arguments go to the same method (NonIncMethod)
+             * @param lastCall If the last argument is the last call of the method header
+             * @note Engines which shadow CallMethod must shadow this as well as it isn't virtual, the default implementation calls CallMethod for every argument
+             */
+            void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall) {
+                for (size_t index{}; index < arguments.size(); index++)
+                    CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index], lastCall && index == arguments.size() - 1);
+            }
         };
     }
 }
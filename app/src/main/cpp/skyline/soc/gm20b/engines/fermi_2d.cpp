@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <gpu/interconnect/graphics_context.h>
+#include <soc/gm20b/channel.h>
+#include <soc/gm20b/gmmu.h>
+#include "fermi_2d.h"
+
+namespace skyline::soc::gm20b::engine {
+    Fermi2D::Fermi2D(const DeviceState &state, ChannelContext &channelCtx) : Engine(state), channelCtx(channelCtx) {}
+
+    void Fermi2D::CallMethod(u32 method, u32 argument, bool lastCall) {
+        if (method >= RegisterCount) {
+            Logger::Warn("Called method outside of Fermi 2D registers: 0x{:X} args: 0x{:X}", method, argument);
+            return;
+        }
+
+        registers.raw[method] = argument;
+
+        #define FERMI2D_OFFSET(field) (sizeof(typeof(Registers::field)) - sizeof(typeof(*Registers::field))) / sizeof(u32)
+        #define FERMI2D_STRUCT_OFFSET(field, member) FERMI2D_OFFSET(field) + U32_OFFSET(typeof(*Registers::field), member)
+
+        if (method == FERMI2D_STRUCT_OFFSET(pixelsFromMemory, srcY0) + 1)
+            Blit();
+
+        #undef FERMI2D_OFFSET
+        #undef FERMI2D_STRUCT_OFFSET
+    }
+
+    std::optional<gpu::GuestTexture> Fermi2D::GetGuestTexture(const Registers::Surface &surface) {
+        auto format{gpu::interconnect::GraphicsContext::GetRenderTargetFormat(surface.format)};
+        if (!format)
+            return std::nullopt;
+
+        gpu::texture::Dimensions dimensions{surface.width, surface.height, 1};
+        gpu::texture::TileConfig tileConfig{};
+        size_t size;
+        if (surface.memoryLayout == Registers::MemoryLayout::Pitch) {
+            tileConfig = gpu::texture::TileConfig{
+                .mode = gpu::texture::TileMode::Pitch,
+                .pitch = surface.pitch,
+            };
+            size = static_cast<size_t>(surface.pitch) * surface.height;
+        } else {
+            tileConfig = gpu::texture::TileConfig{
+                .mode = gpu::texture::TileMode::Block,
+                .blockHeight = static_cast<u8>(1U << surface.blockSize.heightLog2),
+                .blockDepth = static_cast<u8>(1U << surface.blockSize.depthLog2),
+            };
+            size = format->GetSize(dimensions); // This matches the size used for render targets so their textures are found rather than recreated
+        }
+
+        auto mappings{channelCtx.asCtx->gmmu.TranslateRange(surface.address.Pack(), size)};
+        return gpu::GuestTexture{gpu::GuestTexture::Mappings(mappings.begin(), mappings.end()), dimensions, format, tileConfig, gpu::texture::TextureType::e2D};
+    }
+
+    /**
+     * @brief Records a barrier which transitions the supplied subresource of an image between its layout and the layout used for a transfer
+     * @param toTransfer If the image is being transitioned into the transfer layout rather than back into its own layout
+     */
+    static void TransferBarrier(vk::raii::CommandBuffer &commandBuffer, vk::Image image, const vk::ImageSubresourceRange &range, vk::ImageLayout layout, vk::ImageLayout transferLayout, bool toTransfer) {
+        commandBuffer.pipelineBarrier(toTransfer ? vk::PipelineStageFlagBits::eAllCommands : vk::PipelineStageFlagBits::eTransfer, toTransfer ? vk::PipelineStageFlagBits::eTransfer : vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, vk::ImageMemoryBarrier{
+            .image = image,
+            .srcAccessMask = toTransfer ? (vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite) : (vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite),
+            .dstAccessMask = toTransfer ? (vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite) : (vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite),
+            .oldLayout = toTransfer ? layout : transferLayout,
+            .newLayout = toTransfer ? transferLayout : layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .subresourceRange = range,
+        });
+    }
+
+    void Fermi2D::Blit() {
+        auto &src{*registers.src}, &dst{*registers.dst};
+        auto &pixels{*registers.pixelsFromMemory};
+
+        auto srcGuest{GetGuestTexture(src)}, dstGuest{GetGuestTexture(dst)};
+        if (!srcGuest || !dstGuest) {
+            Logger::Warn("Unsupported 2D engine surface format: Source: 0x{:X}, Destination: 0x{:X}", static_cast<u32>(src.format), static_cast<u32>(dst.format));
+            return;
+        }
+
+        // Source coordinates are in 32.32 fixed point, they're rounded to the nearest texel edge as host blits can't address fractions of texels
+        i64 srcX0{pixels.srcX0}, srcY0{pixels.srcY0};
+        if (registers.sampleMode->origin == Registers::SampleMode::Origin::Center) {
+            srcX0 -= pixels.duDx / 2;
+            srcY0 -= pixels.dvDy / 2;
+        }
+        i64 srcX1{srcX0 + pixels.duDx * pixels.dstWidth}, srcY1{srcY0 + pixels.dvDy * pixels.dstHeight};
+        auto toTexel{[](i64 fixed) { return static_cast<i32>((fixed + (1LL << 31)) >> 32); }};
+
+        auto &gpu{*state.gpu};
+        auto srcView{gpu.texture.FindOrCreate(*srcGuest)};
+        auto dstView{gpu.texture.FindOrCreate(*dstGuest)};
+        auto srcTexture{srcView.backing}, dstTexture{dstView.backing};
+
+        // Guest coordinates are scaled to the host resolution of the textures and clamped to their bounds
+        auto toHostOffset{[](const gpu::Texture &texture, i32 x, i32 y) {
+            auto &guestDimensions{texture.guest->dimensions};
+            return vk::Offset3D{
+                std::clamp(static_cast<i32>(static_cast<i64>(x) * texture.dimensions.width / guestDimensions.width), 0, static_cast<i32>(texture.dimensions.width)),
+                std::clamp(static_cast<i32>(static_cast<i64>(y) * texture.dimensions.height / guestDimensions.height), 0, static_cast<i32>(texture.dimensions.height)),
+                0,
+            };
+        }};
+        std::array<vk::Offset3D, 2> srcOffsets{toHostOffset(*srcTexture, toTexel(srcX0), toTexel(srcY0)), toHostOffset(*srcTexture, toTexel(srcX1), toTexel(srcY1))};
+        std::array<vk::Offset3D, 2> dstOffsets{toHostOffset(*dstTexture, pixels.dstX0, pixels.dstY0), toHostOffset(*dstTexture, pixels.dstX0 + pixels.dstWidth, pixels.dstY0 + pixels.dstHeight)};
+        srcOffsets[1].z = dstOffsets[1].z = 1;
+
+        if (srcOffsets[0].x == srcOffsets[1].x || srcOffsets[0].y == srcOffsets[1].y || dstOffsets[0].x == dstOffsets[1].x || dstOffsets[0].y == dstOffsets[1].y)
+            return; // The blit is entirely outside of either texture
+
+        // A copy is sufficient when the blit doesn't scale, flip or convert the contents, it's cheaper and doesn't require blit support for the format
+        bool copy{srcView.format == dstView.format && srcOffsets[1].x - srcOffsets[0].x == dstOffsets[1].x - dstOffsets[0].x && srcOffsets[1].y - srcOffsets[0].y == dstOffsets[1].y - dstOffsets[0].y && srcOffsets[1].x > srcOffsets[0].x && srcOffsets[1].y > srcOffsets[0].y};
+        auto filter{registers.sampleMode->filter == Registers::SampleMode::Filter::Bilinear ? vk::Filter::eLinear : vk::Filter::eNearest};
+
+        std::unique_lock srcLock(*srcTexture, std::defer_lock), dstLock(*dstTexture, std::defer_lock);
+        if (srcTexture == dstTexture)
+            srcLock.lock();
+        else
+            std::lock(srcLock, dstLock);
+        srcTexture->WaitOnBacking();
+        dstTexture->WaitOnBacking();
+
+        channelCtx.executor.AttachTexture(srcTexture.get());
+        channelCtx.executor.AttachTexture(dstTexture.get());
+        channelCtx.executor.AddOutsideRpCommand([srcTexture, dstTexture, srcRange = srcView.range, dstRange = dstView.range, srcOffsets, dstOffsets, copy, filter](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<gpu::FenceCycle> &, gpu::GPU &) {
+            // An image can only be in a single layout, blits within the same image need to use the general layout for both sides
+            bool sameTexture{srcTexture == dstTexture};
+            auto srcTransferLayout{sameTexture ? vk::ImageLayout::eGeneral : vk::ImageLayout::eTransferSrcOptimal};
+            auto dstTransferLayout{sameTexture ? vk::ImageLayout::eGeneral : vk::ImageLayout::eTransferDstOptimal};
+
+            // The layouts are only read at recording time as synchronizing the textures with the guest prior to this might have transitioned them
+            auto srcBacking{srcTexture->GetBacking()}, dstBacking{dstTexture->GetBacking()};
+            auto srcLayout{srcTexture->layout};
+            auto dstLayout{dstTexture->layout != vk::ImageLayout::eUndefined ? dstTexture->layout : dstTransferLayout};
+
+            vk::ImageSubresourceRange srcSubresource{srcRange.aspectMask, srcRange.baseMipLevel, 1, srcRange.baseArrayLayer, 1};
+            vk::ImageSubresourceRange dstSubresource{dstRange.aspectMask, dstRange.baseMipLevel, 1, dstRange.baseArrayLayer, 1};
+            TransferBarrier(commandBuffer, srcBacking, srcSubresource, srcLayout, srcTransferLayout, true);
+            if (!sameTexture)
+                TransferBarrier(commandBuffer, dstBacking, dstSubresource, dstTexture->layout, dstTransferLayout, true);
+
+            vk::ImageSubresourceLayers srcLayers{srcRange.aspectMask, srcRange.baseMipLevel, srcRange.baseArrayLayer, 1};
+            vk::ImageSubresourceLayers dstLayers{dstRange.aspectMask, dstRange.baseMipLevel, dstRange.baseArrayLayer, 1};
+            if (copy)
+                commandBuffer.copyImage(srcBacking, srcTransferLayout, dstBacking, dstTransferLayout, vk::ImageCopy{
+                    .srcSubresource = srcLayers,
+                    .srcOffset = srcOffsets[0],
+                    .dstSubresource = dstLayers,
+                    .dstOffset = dstOffsets[0],
+                    .extent = vk::Extent3D{static_cast<u32>(srcOffsets[1].x - srcOffsets[0].x), static_cast<u32>(srcOffsets[1].y - srcOffsets[0].y), 1},
+                });
+            else
+                commandBuffer.blitImage(srcBacking, srcTransferLayout, dstBacking, dstTransferLayout, vk::ImageBlit{
+                    .srcSubresource = srcLayers,
+                    .srcOffsets = srcOffsets,
+                    .dstSubresource = dstLayers,
+                    .dstOffsets = dstOffsets,
+                }, filter);
+
+            TransferBarrier(commandBuffer, srcBacking, srcSubresource, srcLayout, srcTransferLayout, false);
+            if (!sameTexture) {
+                TransferBarrier(commandBuffer, dstBacking, dstSubresource, dstLayout, dstTransferLayout, false);
+                dstTexture->layout = dstLayout;
+            }
+        });
+    }
+}
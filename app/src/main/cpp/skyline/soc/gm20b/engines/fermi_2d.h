@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <gpu/texture/texture.h>
+#include "engine.h"
+#include "maxwell/types.h"
+
+namespace skyline::soc::gm20b {
+    struct ChannelContext;
+}
+
+namespace skyline::soc::gm20b::engine {
+    /**
+     * @brief The Fermi 2D engine is used by applications for copying, scaling and converting the format of surfaces
+     * @note Blits are resolved to host textures and done on the GPU with a copy when no scaling or conversion is involved and with a blit otherwise
+     * @url https://github.com/NVIDIA/open-gpu-doc/blob/master/classes/twod/cl902d.h
+     */
+    class Fermi2D : public Engine {
+      public:
+        static constexpr u32 RegisterCount{0x258}; //!< The number of Fermi 2D registers
+
+        #pragma pack(push, 1)
+        union Registers {
+            std::array<u32, RegisterCount> raw;
+
+            template<size_t Offset, typename Type>
+            using Register = util::OffsetMember<Offset, Type, u32>;
+
+            enum class MemoryLayout : u32 {
+                BlockLinear = 0,
+                Pitch = 1,
+            };
+
+            struct Surface {
+                maxwell3d::type::RenderTarget::ColorFormat format; //!< The format of the surface, this uses the same encoding as render targets
+                MemoryLayout memoryLayout;
+                struct {
+                    u32 widthLog2 : 4; //!< The width of a block in GOBs, this is always 1 on the Tegra X1
+                    u32 heightLog2 : 4; //!< The height of a block in GOBs
+                    u32 depthLog2 : 4; //!< The depth of a block in GOBs
+                    u32 _pad_ : 20;
+                } blockSize;
+                u32 depth;
+                u32 layer;
+                u32 pitch; //!< The pitch of the surface in bytes, this is only used for pitch surfaces
+                u32 width;
+                u32 height;
+                maxwell3d::type::Address address;
+            };
+            static_assert(sizeof(Surface) == sizeof(u32) * 0xA);
+
+            Register<0x80, Surface> dst;
+            Register<0x8C, Surface> src;
+
+            struct SampleMode {
+                enum class Origin : u32 {
+                    Center = 0, //!< Source coordinates are relative to the center of texels
+                    Corner = 1, //!< Source coordinates are relative to the top-left corner of texels
+                };
+
+                enum class Filter : u32 {
+                    Point = 0,
+                    Bilinear = 1,
+                };
+
+                Origin origin : 1;
+                u32 _pad0_ : 3;
+                Filter filter : 1;
+                u32 _pad1_ : 27;
+            };
+            static_assert(sizeof(SampleMode) == sizeof(u32));
+
+            Register<0x223, SampleMode> sampleMode;
+
+            /**
+             * @brief The region of the blit, all source coordinates are in 32.32 fixed point
+             * @note A write to the integer part of srcY0 triggers the blit
+             */
+            struct PixelsFromMemory {
+                i32 dstX0; // 0x22C
+                i32 dstY0; // 0x22D
+                i32 dstWidth; // 0x22E
+                i32 dstHeight; // 0x22F
+                i64 duDx; //!< The amount of source texels stepped over for every destination texel horizontally
+                i64 dvDy; //!< The amount of source texels stepped over for every destination texel vertically
+                i64 srcX0; // 0x234
+                i64 srcY0; // 0x236
+            };
+            static_assert(sizeof(PixelsFromMemory) == sizeof(u32) * 0xC);
+
+            Register<0x22C, PixelsFromMemory> pixelsFromMemory;
+        };
+        static_assert(sizeof(Registers) == (RegisterCount * sizeof(u32)));
+        #pragma pack(pop)
+
+      private:
+        ChannelContext &channelCtx;
+
+        /**
+         * @return The guest texture corresponding to the supplied surface or std::nullopt if the surface's format isn't supported
+         */
+        std::optional<gpu::GuestTexture> GetGuestTexture(const Registers::Surface &surface);
+
+        /**
+         * @brief Blits the source surface onto the destination surface as described by the registers, this is triggered by a write to the integer part of srcY0
+         */
+        void Blit();
+
+      public:
+        Registers registers{};
+
+        Fermi2D(const DeviceState &state, ChannelContext &channelCtx);
+
+        void CallMethod(u32 method, u32 argument, bool lastCall);
+
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall) {
+            for (size_t index{}; index < arguments.size(); index++)
+                CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index], lastCall && index == arguments.size() - 1);
+        }
+    };
+}
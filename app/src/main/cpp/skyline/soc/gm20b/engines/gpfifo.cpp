@@ -28,8 +28,11 @@ namespace skyline::soc::gm20b::engine {
             GPFIFO_STRUCT_CASE(syncpoint, action, {
                 if (action.operation == Registers::SyncpointOperation::Incr) {
                     Logger::Debug("Increment syncpoint: {}", +action.index);
+                    // The syncpoint is only incremented once all prior work has completed on the GPU
+                    channelCtx.executor.AddCompletionCallback([&syncpoint = state.soc->host1x.syncpoints.at(action.index)]() {
+                        syncpoint.Increment();
+                    });
                     channelCtx.executor.Execute();
-                    state.soc->host1x.syncpoints.at(action.index).Increment();
                 } else if (action.operation == Registers::SyncpointOperation::Wait) {
                     Logger::Debug("Wait syncpoint: {}, thresh: {}", +action.index, registers.syncpoint.payload);
 
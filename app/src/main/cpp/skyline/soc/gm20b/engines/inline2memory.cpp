@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <soc/gm20b/channel.h>
+#include <soc/gm20b/gmmu.h>
+#include "block_linear.h"
+#include "inline2memory.h"
+
+namespace skyline::soc::gm20b::engine {
+    InlineToMemory::InlineToMemory(const DeviceState &state, ChannelContext &channelCtx) : state(state), channelCtx(channelCtx) {}
+
+    void InlineToMemory::Complete() {
+        auto &gmmu{channelCtx.asCtx->gmmu};
+        auto &gpu{*state.gpu};
+        auto data{span(payload).cast<u8>().first(payloadSize)};
+        u64 address{launch.offsetOut.Pack()};
+
+        // Textures on the written pages are invalidated prior to the write so it doesn't fault, buffers are updated with the written range after it
+        auto write{[&](u64 virt, span<u8> source) {
+            auto mappings{gmmu.TranslateRange(virt, source.size())};
+            for (const auto &mapping : mappings)
+                gpu.writeTracker.InvalidateRange(mapping);
+
+            gmmu.Write(virt, source.data(), source.size());
+
+            for (const auto &mapping : mappings)
+                gpu.buffer.SynchronizeRange(mapping);
+        }};
+
+        if (launch.launchDma.dstMemoryLayout == Registers::LaunchDma::MemoryLayout::Pitch) {
+            u32 lineLength{launch.lineLengthIn};
+            if (launch.lineCount <= 1 || launch.pitchOut == lineLength) {
+                write(address, data);
+            } else {
+                for (u32 line{}; line < launch.lineCount; line++)
+                    write(address + static_cast<u64>(line) * launch.pitchOut, data.subspan(static_cast<size_t>(line) * lineLength, lineLength));
+            }
+            return;
+        }
+
+        BlockLinearLayout layout{launch.dstWidth, launch.dstHeight, launch.dstBlockSize.heightLog2, launch.dstBlockSize.depthLog2};
+        auto forEachRun{[&](auto function) {
+            u32 lineLength{launch.lineLengthIn}, z{launch.dstLayer};
+            for (u32 line{}; line < launch.lineCount; line++) {
+                u32 y{launch.dstOriginY + line};
+                for (u32 x{launch.dstOriginX}, end{launch.dstOriginX + lineLength}; x < end;) {
+                    u32 run{std::min(BlockLinearLayout::SectorWidth - (x % BlockLinearLayout::SectorWidth), end - x)}; // Bytes are only contiguous inside a sector
+                    function(layout.GetOffset(x, y, z), static_cast<size_t>(line) * lineLength + (x - launch.dstOriginX), run);
+                    x += run;
+                }
+            }
+        }};
+
+        // The extent of the upload in the surface is determined first so the data can be swizzled into a copy of it which is written back with a single write
+        size_t begin{std::numeric_limits<size_t>::max()}, end{};
+        forEachRun([&](size_t offset, size_t, u32 run) {
+            begin = std::min(begin, offset);
+            end = std::max(end, offset + run);
+        });
+        if (begin >= end)
+            return;
+
+        std::vector<u8> surface(end - begin);
+        gmmu.Read(surface.data(), address + begin, surface.size());
+        forEachRun([&](size_t offset, size_t linearOffset, u32 run) {
+            std::memcpy(surface.data() + (offset - begin), data.data() + linearOffset, run);
+        });
+        write(address + begin, surface);
+    }
+
+    void InlineToMemory::Launch(const Registers &registers) {
+        if (!payload.empty())
+            Logger::Warn("Launching an I2M upload prior to the previous one completing: {}/{} bytes", payload.size() * sizeof(u32), payloadSize);
+
+        launch = registers;
+        payloadSize = static_cast<size_t>(launch.lineLengthIn) * launch.lineCount;
+        payload.clear();
+        payload.reserve(util::AlignUp(payloadSize, sizeof(u32)) / sizeof(u32));
+    }
+
+    void InlineToMemory::LoadInlineData(span<u32> data) {
+        size_t remaining{util::AlignUp(payloadSize, sizeof(u32)) / sizeof(u32) - payload.size()};
+        if (data.size() > remaining) {
+            Logger::Warn("Ignoring {} words of I2M data past the end of the upload", data.size() - remaining);
+            data = data.first(remaining);
+        }
+
+        payload.insert(payload.end(), data.begin(), data.end());
+        if (payloadSize && payload.size() * sizeof(u32) >= payloadSize) {
+            Complete();
+            payload.clear();
+            payloadSize = 0;
+        }
+    }
+}
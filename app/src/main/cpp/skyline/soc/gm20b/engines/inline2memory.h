@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "engine.h"
+#include "maxwell/types.h"
+
+namespace skyline::soc::gm20b {
+    struct ChannelContext;
+}
+
+namespace skyline::soc::gm20b::engine {
+    /**
+     * @brief Handles inline uploads from the pushbuffer to memory (I2M), these are supported by the Kepler Memory engine and the Maxwell 3D engine with an identical set of registers
+     * @note The entire payload is collected prior to being written to guest memory with a single write, the texture and buffer managers are notified of the exact range that was written rather than detecting it themselves
+     * @url https://github.com/NVIDIA/open-gpu-doc/blob/master/classes/memory_to_memory_format/cla040.h
+     */
+    class InlineToMemory {
+      public:
+        #pragma pack(push, 1)
+        struct Registers {
+            union LaunchDma {
+                enum class MemoryLayout : u8 {
+                    BlockLinear = 0,
+                    Pitch = 1,
+                };
+
+                u32 raw;
+                struct {
+                    MemoryLayout dstMemoryLayout : 1;
+                    u32 _pad_ : 31;
+                };
+            };
+            static_assert(sizeof(LaunchDma) == sizeof(u32));
+
+            u32 lineLengthIn; // 0x60
+            u32 lineCount; // 0x61
+            maxwell3d::type::Address offsetOut; // 0x62
+            u32 pitchOut; // 0x64
+            struct {
+                u32 widthLog2 : 4; //!< The width of a block in GOBs, this is always 1 on the Tegra X1
+                u32 heightLog2 : 4; //!< The height of a block in GOBs
+                u32 depthLog2 : 4; //!< The depth of a block in GOBs
+                u32 _pad_ : 20;
+            } dstBlockSize; // 0x65
+            u32 dstWidth; // 0x66
+            u32 dstHeight; // 0x67
+            u32 dstDepth; // 0x68
+            u32 dstLayer; // 0x69
+            u32 dstOriginX; // 0x6A
+            u32 dstOriginY; // 0x6B
+            LaunchDma launchDma; // 0x6C
+            u32 loadInlineData; // 0x6D
+        };
+        static_assert(sizeof(Registers) == (0xE * sizeof(u32)));
+        #pragma pack(pop)
+
+        static constexpr u32 RegisterOffset{0x60}; //!< The offset of the I2M registers in all engines which support I2M
+        static constexpr u32 LaunchDmaMethod{RegisterOffset + U32_OFFSET(Registers, launchDma)};
+        static constexpr u32 LoadInlineDataMethod{RegisterOffset + U32_OFFSET(Registers, loadInlineData)};
+
+      private:
+        const DeviceState &state;
+        ChannelContext &channelCtx;
+        Registers launch{}; //!< A copy of the registers at the time the current upload was launched
+        std::vector<u32> payload; //!< The data of the current upload received so far
+        size_t payloadSize{}; //!< The size of the current upload in bytes
+
+        /**
+         * @brief Writes the payload of the current upload to guest memory
+         */
+        void Complete();
+
+      public:
+        InlineToMemory(const DeviceState &state, ChannelContext &channelCtx);
+
+        /**
+         * @brief Starts a new upload with the supplied registers, this is triggered by a write to LaunchDma
+         */
+        void Launch(const Registers &registers);
+
+        /**
+         * @brief Appends data to the current upload, the upload is completed once all of its data has been received
+         * @note This should be called with all arguments of a method header at once rather than one at a time where possible
+         */
+        void LoadInlineData(span<u32> data);
+    };
+}
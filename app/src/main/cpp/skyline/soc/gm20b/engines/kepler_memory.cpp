@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "kepler_memory.h"
+
+namespace skyline::soc::gm20b::engine {
+    KeplerMemory::KeplerMemory(const DeviceState &state, ChannelContext &channelCtx) : Engine(state), inlineToMemory(state, channelCtx) {}
+
+    void KeplerMemory::CallMethod(u32 method, u32 argument, bool lastCall) {
+        if (method >= RegisterCount) {
+            Logger::Warn("Called method outside of Kepler Memory registers: 0x{:X} args: 0x{:X}", method, argument);
+            return;
+        }
+
+        registers.raw[method] = argument;
+
+        if (method == InlineToMemory::LaunchDmaMethod)
+            inlineToMemory.Launch(*registers.i2m);
+        else if (method == InlineToMemory::LoadInlineDataMethod)
+            inlineToMemory.LoadInlineData(span<u32>(argument));
+    }
+
+    void KeplerMemory::CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall) {
+        if (method == InlineToMemory::LoadInlineDataMethod && !incrementing) {
+            inlineToMemory.LoadInlineData(arguments);
+            return;
+        }
+
+        for (size_t index{}; index < arguments.size(); index++)
+            CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index], lastCall && index == arguments.size() - 1);
+    }
+}
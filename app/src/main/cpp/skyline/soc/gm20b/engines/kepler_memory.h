@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "engine.h"
+#include "inline2memory.h"
+
+namespace skyline::soc::gm20b::engine {
+    /**
+     * @brief The Kepler Memory engine is used by applications for uploading data inline from the pushbuffer to memory
+     * @url https://github.com/NVIDIA/open-gpu-doc/blob/master/classes/memory_to_memory_format/cla040.h
+     */
+    class KeplerMemory : public Engine {
+      public:
+        static constexpr u32 RegisterCount{0x7F}; //!< The number of Kepler Memory registers
+
+        #pragma pack(push, 1)
+        union Registers {
+            std::array<u32, RegisterCount> raw;
+
+            template<size_t Offset, typename Type>
+            using Register = util::OffsetMember<Offset, Type, u32>;
+
+            Register<InlineToMemory::RegisterOffset, InlineToMemory::Registers> i2m;
+        };
+        static_assert(sizeof(Registers) == (RegisterCount * sizeof(u32)));
+        #pragma pack(pop)
+
+      private:
+        InlineToMemory inlineToMemory;
+
+      public:
+        Registers registers{};
+
+        KeplerMemory(const DeviceState &state, ChannelContext &channelCtx);
+
+        void CallMethod(u32 method, u32 argument, bool lastCall);
+
+        /**
+         * @brief Calls a method with multiple arguments, inline data is passed to the upload in a single span rather than one word at a time
+         */
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall);
+    };
+}
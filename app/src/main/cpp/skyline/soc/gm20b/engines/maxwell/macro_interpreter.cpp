@@ -1,11 +1,12 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <unordered_set>
 #include <common/address_space.h>
 #include <soc/gm20b/engines/maxwell_3d.h>
 
 namespace skyline::soc::gm20b::engine::maxwell3d {
-    void MacroInterpreter::Execute(size_t offset, const std::vector<u32> &args) {
+    void MacroInterpreter::Execute(size_t offset, span<const u32> args) {
         // Reset the interpreter state
         registers = {};
         carryFlag = false;
@@ -16,7 +17,231 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         // The first argument is stored in register 1
         registers[1] = *argument++;
 
-        while (Step());
+        if (auto compiled{GetCompiledMacro(offset)}) [[likely]]
+            ExecuteCompiled(*compiled);
+        else
+            while (Step());
+    }
+
+    template<MacroInterpreter::Opcode::Operation Operation, MacroInterpreter::Opcode::AssignmentOperation AssignmentOperation, MacroInterpreter::Opcode::AluOperation AluOperation>
+    void MacroInterpreter::ExecuteOpcode(MacroInterpreter &interpreter, const CompiledOpcode &opcode) {
+        auto &registers{interpreter.registers};
+        u32 result;
+        if constexpr (Operation == Opcode::Operation::AluRegister) {
+            result = interpreter.HandleAlu(AluOperation, registers[opcode.srcA], registers[opcode.srcB]);
+        } else if constexpr (Operation == Opcode::Operation::AddImmediate) {
+            result = static_cast<u32>(static_cast<i32>(registers[opcode.srcA]) + opcode.immediate);
+        } else if constexpr (Operation == Opcode::Operation::BitfieldReplace) {
+            u32 src{(registers[opcode.srcB] >> opcode.srcBit) & opcode.mask};
+            result = (registers[opcode.srcA] & ~(opcode.mask << opcode.destBit)) | (src << opcode.destBit);
+        } else if constexpr (Operation == Opcode::Operation::BitfieldExtractShiftLeftImmediate) {
+            result = ((registers[opcode.srcB] >> registers[opcode.srcA]) & opcode.mask) << opcode.destBit;
+        } else if constexpr (Operation == Opcode::Operation::BitfieldExtractShiftLeftRegister) {
+            result = ((registers[opcode.srcB] >> opcode.srcBit) & opcode.mask) << registers[opcode.srcA];
+        } else if constexpr (Operation == Opcode::Operation::ReadImmediate) {
+            result = interpreter.maxwell3D.registers.raw[static_cast<size_t>(static_cast<i32>(registers[opcode.srcA]) + opcode.immediate)];
+        }
+
+        interpreter.HandleAssignment(AssignmentOperation, opcode.dest, result);
+    }
+
+    template<MacroInterpreter::Opcode::Operation Operation, MacroInterpreter::Opcode::AluOperation AluOperation>
+    MacroInterpreter::CompiledOpcode::Handler MacroInterpreter::GetHandler(Opcode::AssignmentOperation assignmentOperation) {
+        #define ASSIGNMENT_CASE(name) \
+            case Opcode::AssignmentOperation::name: \
+                return &ExecuteOpcode<Operation, Opcode::AssignmentOperation::name, AluOperation>
+
+        switch (assignmentOperation) {
+            ASSIGNMENT_CASE(IgnoreAndFetch);
+            ASSIGNMENT_CASE(Move);
+            ASSIGNMENT_CASE(MoveAndSetMethod);
+            ASSIGNMENT_CASE(FetchAndSend);
+            ASSIGNMENT_CASE(MoveAndSend);
+            ASSIGNMENT_CASE(FetchAndSetMethod);
+            ASSIGNMENT_CASE(MoveAndSetMethodThenFetchAndSend);
+            ASSIGNMENT_CASE(MoveAndSetMethodThenSendHigh);
+            default:
+                return nullptr;
+        }
+
+        #undef ASSIGNMENT_CASE
+    }
+
+    MacroInterpreter::CompiledOpcode::Handler MacroInterpreter::GetAluHandler(Opcode::AluOperation aluOperation, Opcode::AssignmentOperation assignmentOperation) {
+        #define ALU_CASE(name) \
+            case Opcode::AluOperation::name: \
+                return GetHandler<Opcode::Operation::AluRegister, Opcode::AluOperation::name>(assignmentOperation)
+
+        switch (aluOperation) {
+            ALU_CASE(Add);
+            ALU_CASE(AddWithCarry);
+            ALU_CASE(Subtract);
+            ALU_CASE(SubtractWithBorrow);
+            ALU_CASE(BitwiseXor);
+            ALU_CASE(BitwiseOr);
+            ALU_CASE(BitwiseAnd);
+            ALU_CASE(BitwiseAndNot);
+            ALU_CASE(BitwiseNand);
+            default:
+                return nullptr;
+        }
+
+        #undef ALU_CASE
+    }
+
+    MacroInterpreter::CompiledMacro *MacroInterpreter::Compile(size_t offset) {
+        const auto &code{maxwell3D.macroCode};
+
+        // Find the range of instructions reachable from the entry point, the successors of instructions only reachable as the delay slot of an exit aren't followed
+        enum class Reachability : u8 {
+            None,
+            DelaySlot, //!< The instruction is only reachable as the delay slot of an exit
+            Full,
+        };
+        std::vector<Reachability> reachability(code.size());
+        std::vector<std::pair<size_t, Reachability>> pending{{offset, Reachability::Full}};
+        size_t end{offset};
+        while (!pending.empty()) {
+            auto [index, reached]{pending.back()};
+            pending.pop_back();
+
+            if (index >= code.size())
+                return nullptr;
+            if (reachability[index] >= reached)
+                continue;
+            reachability[index] = reached;
+            end = std::max(end, index + 1);
+
+            if (reached == Reachability::DelaySlot)
+                continue;
+
+            Opcode opcode{code[index]};
+            if (opcode.operation == Opcode::Operation::Branch) {
+                // Branches to before the entry point are exceedingly rare and are left to the interpreter
+                auto target{static_cast<ssize_t>(index) + opcode.immediate};
+                if (target < static_cast<ssize_t>(offset))
+                    return nullptr;
+                pending.emplace_back(static_cast<size_t>(target), Reachability::Full);
+                pending.emplace_back(index + 1, Reachability::Full);
+            } else {
+                pending.emplace_back(index + 1, opcode.exit ? Reachability::DelaySlot : Reachability::Full);
+            }
+        }
+
+        // Reuse an existing compilation of identical code, this is common as games tend to re-upload the same macros
+        span<const u32> macroCode(code.data() + offset, end - offset);
+        size_t hash{util::Hash(std::string_view(reinterpret_cast<const char *>(macroCode.data()), macroCode.size_bytes()))};
+        auto [first, last]{compiledMacros.equal_range(hash)};
+        for (auto it{first}; it != last; it++)
+            if (std::equal(macroCode.begin(), macroCode.end(), it->second->code.begin(), it->second->code.end()))
+                return it->second.get();
+
+        auto macro{std::make_unique<CompiledMacro>()};
+        macro->code.assign(macroCode.begin(), macroCode.end());
+        macro->opcodes.reserve(macroCode.size());
+        for (size_t index{}; index < macroCode.size(); index++) {
+            Opcode opcode{macroCode[index]};
+            CompiledOpcode compiled{
+                .immediate = opcode.immediate,
+                .mask = opcode.bitfield.GetMask(),
+                .dest = opcode.dest,
+                .srcA = opcode.srcA,
+                .srcB = opcode.srcB,
+                .srcBit = opcode.bitfield.srcBit,
+                .destBit = opcode.bitfield.destBit,
+                .noDelay = opcode.noDelay,
+                .exit = static_cast<bool>(opcode.exit),
+            };
+
+            switch (opcode.operation) {
+                case Opcode::Operation::AluRegister:
+                    compiled.handler = GetAluHandler(opcode.aluOperation, opcode.assignmentOperation);
+                    break;
+                case Opcode::Operation::AddImmediate:
+                    compiled.handler = GetHandler<Opcode::Operation::AddImmediate>(opcode.assignmentOperation);
+                    break;
+                case Opcode::Operation::BitfieldReplace:
+                    compiled.handler = GetHandler<Opcode::Operation::BitfieldReplace>(opcode.assignmentOperation);
+                    break;
+                case Opcode::Operation::BitfieldExtractShiftLeftImmediate:
+                    compiled.handler = GetHandler<Opcode::Operation::BitfieldExtractShiftLeftImmediate>(opcode.assignmentOperation);
+                    break;
+                case Opcode::Operation::BitfieldExtractShiftLeftRegister:
+                    compiled.handler = GetHandler<Opcode::Operation::BitfieldExtractShiftLeftRegister>(opcode.assignmentOperation);
+                    break;
+                case Opcode::Operation::ReadImmediate:
+                    compiled.handler = GetHandler<Opcode::Operation::ReadImmediate>(opcode.assignmentOperation);
+                    break;
+                case Opcode::Operation::Branch:
+                    compiled.isBranch = true;
+                    compiled.branchOnZero = opcode.branchCondition == Opcode::BranchCondition::Zero;
+                    compiled.target = static_cast<u32>(static_cast<ssize_t>(index) + opcode.immediate);
+                    break;
+                default:
+                    break;
+            }
+
+            // Unreachable instructions inside the range may be garbage, only reachable ones need to be valid
+            if (!compiled.isBranch && !compiled.handler && reachability[offset + index] != Reachability::None) {
+                Logger::Debug("Falling back to interpreting macro at 0x{:X} due to unsupported opcode: 0x{:08X}", offset, opcode.raw);
+                return nullptr;
+            }
+
+            macro->opcodes.push_back(compiled);
+        }
+
+        // Macros referenced by the offset cache are still in macro memory and must be retained, the rest are only kept around for re-uploads
+        if (compiledMacros.size() >= MaxCompiledMacroCount) [[unlikely]] {
+            std::unordered_set<CompiledMacro *> liveMacros;
+            for (const auto &[macroOffset, liveMacro] : offsetCache)
+                liveMacros.insert(liveMacro);
+            std::erase_if(compiledMacros, [&liveMacros](const auto &entry) {
+                return !liveMacros.contains(entry.second.get());
+            });
+        }
+
+        auto compiledMacro{macro.get()};
+        compiledMacros.emplace(hash, std::move(macro));
+        return compiledMacro;
+    }
+
+    MacroInterpreter::CompiledMacro *MacroInterpreter::GetCompiledMacro(size_t offset) {
+        auto it{offsetCache.find(offset)};
+        if (it != offsetCache.end()) [[likely]]
+            return it->second;
+
+        return offsetCache.emplace(offset, Compile(offset)).first->second;
+    }
+
+    void MacroInterpreter::ExecuteCompiled(const CompiledMacro &macro) {
+        const CompiledOpcode *opcodes{macro.opcodes.data()};
+        auto runDelaySlot{[&](const CompiledOpcode &delayOpcode) {
+            if (delayOpcode.isBranch)
+                throw exception("Cannot branch while inside a delay slot");
+            delayOpcode.handler(*this, delayOpcode);
+        }};
+
+        size_t index{};
+        while (true) {
+            const auto &compiled{opcodes[index]};
+            if (compiled.isBranch) {
+                if ((registers[compiled.srcA] == 0) == compiled.branchOnZero) {
+                    if (!compiled.noDelay)
+                        runDelaySlot(opcodes[index + 1]);
+                    index = compiled.target;
+                    continue;
+                }
+            } else {
+                compiled.handler(*this, compiled);
+            }
+
+            if (compiled.exit) {
+                runDelaySlot(opcodes[index + 1]);
+                return;
+            }
+
+            index++;
+        }
     }
 
     __attribute__((always_inline)) bool MacroInterpreter::Step(Opcode *delayedOpcode) {
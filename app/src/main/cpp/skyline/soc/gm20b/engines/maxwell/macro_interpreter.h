@@ -111,6 +111,69 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         MethodAddress methodAddress{};
         bool carryFlag{}; //!< A flag representing if an arithmetic operation has set the most significant bit
 
+        /**
+         * @brief A single pre-decoded macro instruction, all fields are extracted from the opcode at compile time and the handler is specialized on the operation so execution doesn't need to decode anything
+         */
+        struct CompiledOpcode {
+            using Handler = void (*)(MacroInterpreter &, const CompiledOpcode &);
+
+            Handler handler{}; //!< The function which executes the instruction, this is nullptr for branches
+            i32 immediate{};
+            u32 mask{}; //!< The mask of the bitfield operand
+            u32 target{}; //!< The index of the branch target within the compiled macro
+            u8 dest{};
+            u8 srcA{};
+            u8 srcB{};
+            u8 srcBit{};
+            u8 destBit{};
+            bool isBranch{};
+            bool branchOnZero{};
+            bool noDelay{};
+            bool exit{};
+        };
+
+        /**
+         * @brief A macro that has been compiled from macro memory starting at a specific offset
+         */
+        struct CompiledMacro {
+            std::vector<u32> code; //!< A copy of the code the macro was compiled from, this is used to rule out hash collisions
+            std::vector<CompiledOpcode> opcodes; //!< The compiled instructions, the first instruction is the entry point of the macro
+        };
+
+        std::unordered_map<size_t, CompiledMacro *> offsetCache; //!< A map from a macro's offset in macro memory to its compiled form or nullptr if it couldn't be compiled, this is cleared on any write to macro memory
+        static constexpr size_t MaxCompiledMacroCount{256}; //!< The amount of compiled macros after which any that aren't in macro memory anymore are dropped, this bounds the cache for games which continuously upload new macros
+        std::unordered_multimap<size_t, std::unique_ptr<CompiledMacro>> compiledMacros; //!< All macros that have been compiled keyed by the hash of their code, these are retained across invalidations so re-uploading an identical macro doesn't recompile it
+
+        /**
+         * @brief Executes a single compiled non-branch instruction, this is specialized on all of the decoded operations so they're resolved at compile time
+         */
+        template<Opcode::Operation Operation, Opcode::AssignmentOperation AssignmentOperation, Opcode::AluOperation AluOperation>
+        static void ExecuteOpcode(MacroInterpreter &interpreter, const CompiledOpcode &opcode);
+
+        /**
+         * @return The handler for an instruction with the supplied operations or nullptr if they're invalid
+         */
+        template<Opcode::Operation Operation, Opcode::AluOperation AluOperation = Opcode::AluOperation::Add>
+        static CompiledOpcode::Handler GetHandler(Opcode::AssignmentOperation assignmentOperation);
+
+        static CompiledOpcode::Handler GetAluHandler(Opcode::AluOperation aluOperation, Opcode::AssignmentOperation assignmentOperation);
+
+        /**
+         * @brief Compiles all instructions which are reachable from the supplied offset in macro memory
+         * @return The compiled macro or nullptr if it contains any instructions that can't be compiled, these are left to the interpreter
+         */
+        CompiledMacro *Compile(size_t offset);
+
+        /**
+         * @return The compiled form of the macro at the supplied offset, compiling it if necessary or nullptr if it can't be compiled
+         */
+        CompiledMacro *GetCompiledMacro(size_t offset);
+
+        /**
+         * @brief Runs a compiled macro till it exits
+         */
+        void ExecuteCompiled(const CompiledMacro &macro);
+
         /**
          * @brief Steps forward one macro instruction, including delay slots
          * @param delayedOpcode The target opcode to be jumped to after executing the instruction
@@ -143,6 +206,14 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         /**
          * @brief Executes a GPU macro from macro memory with the given arguments
          */
-        void Execute(size_t offset, const std::vector<u32> &args);
+        void Execute(size_t offset, span<const u32> args);
+
+        /**
+         * @brief Invalidates the lookup of compiled macros by their offset, this must be called whenever macro memory is written to
+         */
+        void InvalidateCompiledMacros() {
+            if (!offsetCache.empty()) [[unlikely]]
+                offsetCache.clear();
+        }
     };
 }
@@ -525,5 +525,45 @@ namespace skyline::soc::gm20b::engine::maxwell3d::type {
     };
     static_assert(sizeof(SemaphoreInfo) == sizeof(u32));
 
+    constexpr static size_t ShaderStageCount{5}; //!< Amount of graphics pipeline stages on Maxwell 3D, this is the array size for any per-stage bindings
+    constexpr static size_t PerStageConstantBufferCount{18}; //!< Maximum amount of constant buffers that can be bound to a single pipeline stage
+    constexpr static size_t ConstantBufferUpdateSize{16}; //!< Amount of registers which write their value to the selected constant buffer
+
+    /**
+     * @brief The constant buffer that inline updates are written to and that is bound by a write to the constant buffer bind register of a stage
+     */
+    struct ConstantBufferSelector {
+        u32 size; //!< The size of the constant buffer in bytes
+        Address address;
+    };
+    static_assert(sizeof(ConstantBufferSelector) == sizeof(u32) * 3);
+
+    /**
+     * @brief Writes to any of the data registers write the value to the selected constant buffer at the offset, the offset is incremented by the size of the value after every write
+     */
+    struct ConstantBufferUpdate {
+        u32 offset; //!< The offset in bytes into the selected constant buffer
+        std::array<u32, ConstantBufferUpdateSize> data;
+    };
+    static_assert(sizeof(ConstantBufferUpdate) == sizeof(u32) * (ConstantBufferUpdateSize + 1));
+
+    struct ConstantBufferBind {
+        u32 valid : 1; //!< If the selected constant buffer is bound to the index rather than the index being unbound
+        u32 _pad0_ : 3;
+        u32 index : 5; //!< The index of the constant buffer binding in the stage
+        u32 _pad1_ : 23;
+    };
+    static_assert(sizeof(ConstantBufferBind) == sizeof(u32));
+
+    /**
+     * @brief The binding registers of a single pipeline stage
+     */
+    struct BindGroup {
+        std::array<u32, 4> _pad0_;
+        ConstantBufferBind constantBuffer;
+        std::array<u32, 3> _pad1_;
+    };
+    static_assert(sizeof(BindGroup) == sizeof(u32) * 8);
+
     #pragma pack(pop)
 }
@@ -3,11 +3,12 @@
 // Copyright © 2018-2020 fincs (https://github.com/devkitPro/deko3d)
 
 #include <boost/preprocessor/repeat.hpp>
+#include <common/settings.h>
 #include "maxwell_3d.h"
 #include <soc.h>
 
 namespace skyline::soc::gm20b::engine::maxwell3d {
-    Maxwell3D::Maxwell3D(const DeviceState &state, ChannelContext &channelCtx, gpu::interconnect::CommandExecutor &executor) : Engine(state), macroInterpreter(*this), context(*state.gpu, channelCtx, executor), channelCtx(channelCtx) {
+    Maxwell3D::Maxwell3D(const DeviceState &state, ChannelContext &channelCtx, gpu::interconnect::CommandExecutor &executor) : Engine(state), macroInterpreter(*this), context(*state.gpu, channelCtx, executor, state.settings->renderScale), inlineToMemory(state, channelCtx), channelCtx(channelCtx) {
         ResetRegs();
     }
 
@@ -75,6 +76,131 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         registers.viewportTransformEnable = true;
     }
 
+    void Maxwell3D::AppendMacroArguments(span<u32> arguments) {
+        auto &pending{macroInvocation.arguments};
+        if (pending.empty()) {
+            pending = arguments;
+        } else if (pending.data() != macroInvocation.argumentBuffer.data() && pending.end() == arguments.begin()) {
+            pending = span(pending.data(), pending.size() + arguments.size());
+        } else {
+            auto &buffer{macroInvocation.argumentBuffer};
+            if (pending.data() != buffer.data())
+                buffer.assign(pending.begin(), pending.end());
+            buffer.insert(buffer.end(), arguments.begin(), arguments.end());
+            pending = span(buffer.data(), buffer.size());
+        }
+    }
+
+    void Maxwell3D::AppendMacroArgument(u32 argument) {
+        auto &pending{macroInvocation.arguments};
+        auto &buffer{macroInvocation.argumentBuffer};
+        if (pending.data() != buffer.data())
+            buffer.assign(pending.begin(), pending.end());
+        buffer.push_back(argument);
+        pending = span(buffer.data(), buffer.size());
+    }
+
+    void Maxwell3D::FlushMacro() {
+        macroInterpreter.Execute(macroPositions[static_cast<size_t>(macroInvocation.index)], macroInvocation.arguments);
+        macroInvocation.arguments = {};
+        macroInvocation.argumentBuffer.clear();
+        macroInvocation.index = -1;
+    }
+
+    void Maxwell3D::FlushDirtyState() {
+        if (dirtyGroups.none()) [[likely]]
+            return;
+
+        // The dirty groups are reset prior to applying them so a side effect which throws isn't repeated on every subsequent flush
+        auto dirty{dirtyGroups};
+        dirtyGroups.reset();
+
+        for (size_t index{}; index < type::RenderTargetCount; index++) {
+            if (!dirty.test(DirtyGroup::RenderTarget + index))
+                continue;
+
+            // The tile mode and format need to be applied prior to the width as its interpretation depends on both of them
+            const auto &renderTarget{registers.renderTargets[index]};
+            context.SetRenderTargetAddressHigh(index, renderTarget.address.high);
+            context.SetRenderTargetAddressLow(index, renderTarget.address.low);
+            context.SetRenderTargetTileMode(index, renderTarget.tileMode);
+            context.SetRenderTargetFormat(index, renderTarget.format);
+            context.SetRenderTargetWidth(index, renderTarget.width);
+            context.SetRenderTargetHeight(index, renderTarget.height);
+            context.SetRenderTargetArrayMode(index, renderTarget.arrayMode);
+            context.SetRenderTargetLayerStride(index, renderTarget.layerStrideLsr2);
+            context.SetRenderTargetBaseLayer(index, renderTarget.baseLayer);
+        }
+
+        for (size_t index{}; index < type::ViewportCount; index++) {
+            if (dirty.test(DirtyGroup::Viewport + index)) {
+                const auto &transform{registers.viewportTransforms[index]};
+                context.SetViewportX(index, transform.scaleX, transform.translateX);
+                context.SetViewportY(index, transform.scaleY, transform.translateY);
+                context.SetViewportZ(index, transform.scaleZ, transform.translateZ);
+            }
+
+            if (dirty.test(DirtyGroup::Scissor + index)) {
+                const auto &scissor{registers.scissors[index]};
+                if (scissor.enable) {
+                    context.SetScissorHorizontal(index, scissor.horizontal);
+                    context.SetScissorVertical(index, scissor.vertical);
+                } else {
+                    context.SetScissor(index, std::nullopt);
+                }
+            }
+        }
+
+        if (dirty.test(DirtyGroup::ClearColor))
+            for (size_t index{}; index < registers.clearColorValue->size(); index++)
+                context.UpdateClearColorValue(index, registers.clearColorValue[index]);
+
+        if (dirty.test(DirtyGroup::RenderTargetControl))
+            context.UpdateRenderTargetControl(*registers.renderTargetControl);
+    }
+
+    void Maxwell3D::UpdateConstantBuffer(span<u32> data) {
+        auto &selector{*registers.constantBufferSelector};
+        auto &offset{registers.constantBufferUpdate->offset};
+        context.UpdateConstantBuffer(selector.address.Pack(), selector.size, offset, data);
+        offset += static_cast<u32>(data.size_bytes());
+    }
+
+    void Maxwell3D::CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall) {
+        // Arguments to a single macro are appended in bulk without going through CallMethod, these are viewed in the pushbuffer directly when the start of the macro (an even method) is immediately followed by its parameters (odd methods)
+        if (method >= RegisterCount) [[unlikely]] {
+            bool isStart{!(method & 1)};
+            if (isStart ? arguments.size() == 1 : (macroInvocation.index != -1 && (!incrementing || arguments.size() == 1))) {
+                if (isStart) {
+                    if (macroInvocation.index != -1)
+                        FlushMacro();
+                    macroInvocation.index = ((method - RegisterCount) >> 1) % macroPositions.size();
+                }
+
+                AppendMacroArguments(arguments);
+                if (lastCall)
+                    FlushMacro();
+                return;
+            }
+        } else if (method == InlineToMemory::LoadInlineDataMethod && !incrementing) {
+            // Inline data is passed to the upload in a single span rather than one word at a time
+            inlineToMemory.LoadInlineData(arguments);
+            return;
+        } else if (method >= ConstantBufferUpdateDataMethod && method < ConstantBufferUpdateDataMethod + type::ConstantBufferUpdateSize) {
+            // Every data register writes at the current update offset so consecutive writes to them are applied as a single update, regardless of the method incrementing
+            size_t count{incrementing ? std::min<size_t>(arguments.size(), ConstantBufferUpdateDataMethod + type::ConstantBufferUpdateSize - method) : arguments.size()};
+            UpdateConstantBuffer(arguments.first(count));
+            if (count == arguments.size())
+                return;
+
+            method += static_cast<u32>(count);
+            arguments = arguments.subspan(count);
+        }
+
+        for (size_t index{}; index < arguments.size(); index++)
+            CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index], lastCall && index == arguments.size() - 1);
+    }
+
     void Maxwell3D::CallMethod(u32 method, u32 argument, bool lastCall) {
         Logger::Debug("Called method in Maxwell 3D: 0x{:X} args: 0x{:X}", method, argument);
 
@@ -82,24 +208,19 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         if (method >= RegisterCount) [[unlikely]] {
             // Starting a new macro at index 'method - RegisterCount'
             if (!(method & 1)) {
-                if (macroInvocation.index != -1) {
-                    // Flush the current macro as we are switching to another one
-                    macroInterpreter.Execute(macroPositions[static_cast<size_t>(macroInvocation.index)], macroInvocation.arguments);
-                    macroInvocation.arguments.clear();
-                }
+                // Flush the current macro as we are switching to another one
+                if (macroInvocation.index != -1)
+                    FlushMacro();
 
                 // Setup for the new macro index
                 macroInvocation.index = ((method - RegisterCount) >> 1) % macroPositions.size();
             }
 
-            macroInvocation.arguments.emplace_back(argument);
+            AppendMacroArgument(argument);
 
             // Flush macro after all of the data in the method call has been sent
-            if (lastCall && macroInvocation.index != -1) {
-                macroInterpreter.Execute(macroPositions[static_cast<size_t>(macroInvocation.index)], macroInvocation.arguments);
-                macroInvocation.arguments.clear();
-                macroInvocation.index = -1;
-            }
+            if (lastCall && macroInvocation.index != -1)
+                FlushMacro();
 
             // Bail out early
             return;
@@ -136,6 +257,18 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         bool redundant{registers.raw[method] == argument};
         registers.raw[method] = argument;
 
+        // I2M methods have side effects regardless of the value written so they must be handled prior to redundant writes being skipped
+        if (method == InlineToMemory::LaunchDmaMethod) {
+            inlineToMemory.Launch(*registers.i2m);
+            return;
+        } else if (method == InlineToMemory::LoadInlineDataMethod) {
+            inlineToMemory.LoadInlineData(span<u32>(argument));
+            return;
+        } else if (method >= ConstantBufferUpdateDataMethod && method < ConstantBufferUpdateDataMethod + type::ConstantBufferUpdateSize) {
+            UpdateConstantBuffer(span<u32>(argument));
+            return;
+        }
+
         if (!redundant) {
             switch (method) {
                 MAXWELL3D_STRUCT_CASE(mme, shadowRamControl, {
@@ -144,79 +277,79 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
 
                 #define RENDER_TARGET_ARRAY(z, index, data)                               \
                 MAXWELL3D_ARRAY_STRUCT_STRUCT_CASE(renderTargets, index, address, high, { \
-                    context.SetRenderTargetAddressHigh(index, high);                      \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_STRUCT_CASE(renderTargets, index, address, low, {  \
-                    context.SetRenderTargetAddressLow(index, low);                        \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, width, {                \
-                    context.SetRenderTargetWidth(index, width);                           \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, height, {               \
-                    context.SetRenderTargetHeight(index, height);                         \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, format, {               \
-                    context.SetRenderTargetFormat(index, format);                         \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, tileMode, {             \
-                    context.SetRenderTargetTileMode(index, tileMode);                     \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, arrayMode, {            \
-                    context.SetRenderTargetArrayMode(index, arrayMode);                   \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, layerStrideLsr2, {      \
-                    context.SetRenderTargetLayerStride(index, layerStrideLsr2);           \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })                                                                        \
                 MAXWELL3D_ARRAY_STRUCT_CASE(renderTargets, index, baseLayer, {            \
-                    context.SetRenderTargetBaseLayer(index, baseLayer);                   \
+                    dirtyGroups.set(DirtyGroup::RenderTarget + index);                    \
                 })
 
                 BOOST_PP_REPEAT(8, RENDER_TARGET_ARRAY, 0)
                 static_assert(type::RenderTargetCount == 8 && type::RenderTargetCount < BOOST_PP_LIMIT_REPEAT);
                 #undef RENDER_TARGET_ARRAY
 
-                #define VIEWPORT_TRANSFORM_CALLBACKS(z, index, data)                                      \
-                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, scaleX, {                          \
-                    context.SetViewportX(index, scaleX, registers.viewportTransforms[index].translateX);  \
-                })                                                                                        \
-                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, translateX, {                      \
-                    context.SetViewportX(index, registers.viewportTransforms[index].scaleX, translateX);  \
-                })                                                                                        \
-                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, scaleY, {                          \
-                    context.SetViewportY(index, scaleY, registers.viewportTransforms[index].translateY);  \
-                })                                                                                        \
-                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, translateY, {                      \
-                    context.SetViewportY(index, registers.viewportTransforms[index].scaleY, translateY);  \
-                })                                                                                        \
-                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, scaleZ, {                          \
-                    context.SetViewportZ(index, scaleZ, registers.viewportTransforms[index].translateZ);  \
-                })                                                                                        \
-                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, translateZ, {                      \
-                    context.SetViewportZ(index, registers.viewportTransforms[index].scaleZ, translateZ);  \
+                #define VIEWPORT_TRANSFORM_CALLBACKS(z, index, data)                 \
+                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, scaleX, {     \
+                    dirtyGroups.set(DirtyGroup::Viewport + index);                   \
+                })                                                                   \
+                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, translateX, { \
+                    dirtyGroups.set(DirtyGroup::Viewport + index);                   \
+                })                                                                   \
+                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, scaleY, {     \
+                    dirtyGroups.set(DirtyGroup::Viewport + index);                   \
+                })                                                                   \
+                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, translateY, { \
+                    dirtyGroups.set(DirtyGroup::Viewport + index);                   \
+                })                                                                   \
+                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, scaleZ, {     \
+                    dirtyGroups.set(DirtyGroup::Viewport + index);                   \
+                })                                                                   \
+                MAXWELL3D_ARRAY_STRUCT_CASE(viewportTransforms, index, translateZ, { \
+                    dirtyGroups.set(DirtyGroup::Viewport + index);                   \
                 })
 
                 BOOST_PP_REPEAT(16, VIEWPORT_TRANSFORM_CALLBACKS, 0)
                 static_assert(type::ViewportCount == 16 && type::ViewportCount < BOOST_PP_LIMIT_REPEAT);
                 #undef VIEWPORT_TRANSFORM_CALLBACKS
 
-                #define COLOR_CLEAR_CALLBACKS(z, index, data)              \
-                MAXWELL3D_ARRAY_CASE(clearColorValue, index, {             \
-                    context.UpdateClearColorValue(index, clearColorValue); \
+                #define COLOR_CLEAR_CALLBACKS(z, index, data)  \
+                MAXWELL3D_ARRAY_CASE(clearColorValue, index, { \
+                    dirtyGroups.set(DirtyGroup::ClearColor);   \
                 })
 
                 BOOST_PP_REPEAT(4, COLOR_CLEAR_CALLBACKS, 0)
                 static_assert(4 < BOOST_PP_LIMIT_REPEAT);
                 #undef COLOR_CLEAR_CALLBACKS
 
-                #define SCISSOR_CALLBACKS(z, index, data)                                                           \
-                MAXWELL3D_ARRAY_STRUCT_CASE(scissors, index, enable, {                                              \
-                    context.SetScissor(index, enable ? registers.scissors[index] : std::optional<type::Scissor>{}); \
-                })                                                                                                  \
-                MAXWELL3D_ARRAY_STRUCT_CASE(scissors, index, horizontal, {                                          \
-                    context.SetScissorHorizontal(index, horizontal);                                                \
-                })                                                                                                  \
-                MAXWELL3D_ARRAY_STRUCT_CASE(scissors, index, vertical, {                                            \
-                    context.SetScissorVertical(index, vertical);                                                    \
+                #define SCISSOR_CALLBACKS(z, index, data)                  \
+                MAXWELL3D_ARRAY_STRUCT_CASE(scissors, index, enable, {     \
+                    dirtyGroups.set(DirtyGroup::Scissor + index);          \
+                })                                                         \
+                MAXWELL3D_ARRAY_STRUCT_CASE(scissors, index, horizontal, { \
+                    dirtyGroups.set(DirtyGroup::Scissor + index);          \
+                })                                                         \
+                MAXWELL3D_ARRAY_STRUCT_CASE(scissors, index, vertical, {   \
+                    dirtyGroups.set(DirtyGroup::Scissor + index);          \
                 })
 
                 BOOST_PP_REPEAT(16, SCISSOR_CALLBACKS, 0)
@@ -224,7 +357,7 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
                 #undef SCISSOR_CALLBACKS
 
                 MAXWELL3D_CASE(renderTargetControl, {
-                    context.UpdateRenderTargetControl(renderTargetControl);
+                    dirtyGroups.set(DirtyGroup::RenderTargetControl);
                 })
             }
         }
@@ -235,6 +368,7 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
                     throw exception("Macro memory is full!");
 
                 macroCode[registers.mme->instructionRamPointer++] = instructionRamLoad;
+                macroInterpreter.InvalidateCompiledMacros();
 
                 // Wraparound writes
                 registers.mme->instructionRamPointer %= macroCode.size();
@@ -249,11 +383,14 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
 
             MAXWELL3D_CASE(syncpointAction, {
                 Logger::Debug("Increment syncpoint: {}", static_cast<u16>(syncpointAction.id));
+                channelCtx.executor.AddCompletionCallback([&syncpoint = state.soc->host1x.syncpoints.at(syncpointAction.id)]() {
+                    syncpoint.Increment();
+                });
                 channelCtx.executor.Execute();
-                state.soc->host1x.syncpoints.at(syncpointAction.id).Increment();
             })
 
             MAXWELL3D_CASE(clearBuffers, {
+                FlushDirtyState();
                 context.ClearBuffers(clearBuffers);
             })
 
@@ -282,6 +419,19 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
                 }
             })
 
+            #define CONSTANT_BUFFER_BIND_CALLBACKS(z, index, data)                                                   \
+            MAXWELL3D_ARRAY_STRUCT_CASE(bindGroups, index, constantBuffer, {                                         \
+                auto &selector{*registers.constantBufferSelector};                                                   \
+                if (constantBuffer.valid)                                                                            \
+                    context.BindConstantBuffer(index, constantBuffer.index, selector.address.Pack(), selector.size); \
+                else                                                                                                 \
+                    context.UnbindConstantBuffer(index, constantBuffer.index);                                       \
+            })
+
+            BOOST_PP_REPEAT(5, CONSTANT_BUFFER_BIND_CALLBACKS, 0)
+            static_assert(type::ShaderStageCount == 5 && type::ShaderStageCount < BOOST_PP_LIMIT_REPEAT);
+            #undef CONSTANT_BUFFER_BIND_CALLBACKS
+
             MAXWELL3D_ARRAY_CASE(firmwareCall, 4, {
                 registers.raw[0xD00] = 1;
             })
@@ -305,28 +455,31 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
     }
 
     void Maxwell3D::WriteSemaphoreResult(u64 result) {
-        struct FourWordResult {
-            u64 value;
-            u64 timestamp;
-        };
-
-        switch (registers.semaphore->info.structureSize) {
-            case type::SemaphoreInfo::StructureSize::OneWord:
-                channelCtx.asCtx->gmmu.Write<u32>(registers.semaphore->address.Pack(), static_cast<u32>(result));
-                break;
-
-            case type::SemaphoreInfo::StructureSize::FourWords: {
-                // Convert the current nanosecond time to GPU ticks
-                constexpr i64 NsToTickNumerator{384};
-                constexpr i64 NsToTickDenominator{625};
-
-                i64 nsTime{util::GetTimeNs()};
-                i64 timestamp{(nsTime / NsToTickDenominator) * NsToTickNumerator + ((nsTime % NsToTickDenominator) * NsToTickNumerator) / NsToTickDenominator};
-
-                channelCtx.asCtx->gmmu.Write<FourWordResult>(registers.semaphore->address.Pack(),
-                                                             FourWordResult{result, static_cast<u64>(timestamp)});
-                break;
+        // The result is only written back once all prior work has completed so the GPFIFO doesn't need to wait on the pending commands for it
+        channelCtx.executor.AddCompletionCallback([&gmmu = channelCtx.asCtx->gmmu, address = registers.semaphore->address.Pack(), structureSize = registers.semaphore->info.structureSize, result]() {
+            struct FourWordResult {
+                u64 value;
+                u64 timestamp;
+            };
+
+            switch (structureSize) {
+                case type::SemaphoreInfo::StructureSize::OneWord:
+                    gmmu.Write<u32>(address, static_cast<u32>(result));
+                    break;
+
+                case type::SemaphoreInfo::StructureSize::FourWords: {
+                    // Convert the current nanosecond time to GPU ticks
+                    constexpr i64 NsToTickNumerator{384};
+                    constexpr i64 NsToTickDenominator{625};
+
+                    i64 nsTime{util::GetTimeNs()};
+                    i64 timestamp{(nsTime / NsToTickDenominator) * NsToTickNumerator + ((nsTime % NsToTickDenominator) * NsToTickNumerator) / NsToTickDenominator};
+
+                    gmmu.Write<FourWordResult>(address, FourWordResult{result, static_cast<u64>(timestamp)});
+                    break;
+                }
             }
-        }
+        });
+        channelCtx.executor.Execute(); // The guest may spin on the semaphore without a syncpoint that would otherwise flush the pending commands, it'd never be written in that case
     }
 }
@@ -6,6 +6,7 @@
 
 #include <gpu/interconnect/graphics_context.h>
 #include "engine.h"
+#include "inline2memory.h"
 #include "maxwell/macro_interpreter.h"
 
 namespace skyline::soc::gm20b {
@@ -22,21 +23,65 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
 
         struct {
             i32 index{-1};
-            std::vector<u32> arguments;
+            span<u32> arguments; //!< The arguments to the macro, this views the pushbuffer directly when all arguments are contiguous in it and the argument buffer otherwise
+            boost::container::small_vector<u32, 0x10> argumentBuffer; //!< A buffer for arguments which aren't contiguous in the pushbuffer, such as those of methods split across multiple GpEntries
         } macroInvocation{}; //!< Data for a macro that is pending execution
 
         MacroInterpreter macroInterpreter;
 
         gpu::interconnect::GraphicsContext context;
 
+        InlineToMemory inlineToMemory;
+
+        /**
+         * @brief The groups of registers which have side effects on the graphics context, writes to them only mark their group as dirty and the side effects are applied once from the final register values prior to the state being used
+         */
+        struct DirtyGroup {
+            static constexpr size_t RenderTarget{0}; //!< The group of the first render target, every render target has its own group
+            static constexpr size_t Viewport{RenderTarget + type::RenderTargetCount}; //!< The group of the first viewport transform
+            static constexpr size_t Scissor{Viewport + type::ViewportCount}; //!< The group of the first scissor
+            static constexpr size_t ClearColor{Scissor + type::ViewportCount};
+            static constexpr size_t RenderTargetControl{ClearColor + 1};
+            static constexpr size_t Count{RenderTargetControl + 1};
+        };
+
+        std::bitset<DirtyGroup::Count> dirtyGroups; //!< The register groups which have been written to since their side effects were last applied
+
         /**
          * @brief Writes back a semaphore result to the guest with an auto-generated timestamp (if required)
          * @note If the semaphore is OneWord then the result will be downcasted to a 32-bit unsigned integer
          */
         void WriteSemaphoreResult(u64 result);
 
+        /**
+         * @brief Applies the side effects of all dirty register groups to the graphics context, this must be called prior to any usage of the context's state
+         */
+        void FlushDirtyState();
+
+        /**
+         * @brief Appends arguments from the pushbuffer to the pending macro, these are viewed in-place if they directly follow the prior arguments
+         * @note The arguments must stay valid till the macro is flushed
+         */
+        void AppendMacroArguments(span<u32> arguments);
+
+        /**
+         * @brief Appends a single argument to the pending macro by copying it into the argument buffer
+         */
+        void AppendMacroArgument(u32 argument);
+
+        /**
+         * @brief Executes the pending macro with all arguments accumulated so far and resets the invocation
+         */
+        void FlushMacro();
+
+        /**
+         * @brief Writes the supplied data to the selected constant buffer at the current update offset and advances the offset past it
+         */
+        void UpdateConstantBuffer(span<u32> data);
+
       public:
         static constexpr u32 RegisterCount{0xE00}; //!< The number of Maxwell 3D registers
+        static constexpr u32 ConstantBufferUpdateDataMethod{0x8E4}; //!< The method of the first constant buffer update data register
 
         /**
          * @url https://github.com/devkitPro/deko3d/blob/master/source/maxwell/engine_3d.def
@@ -61,6 +106,8 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
             };
             Register<0x45, MME> mme;
 
+            Register<InlineToMemory::RegisterOffset, InlineToMemory::Registers> i2m;
+
             Register<0xB2, type::SyncpointAction> syncpointAction;
 
             Register<0xDF, u32> rasterizerEnable;
@@ -201,6 +248,9 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
 
             Register<0x780, std::array<type::Blend, type::RenderTargetCount>> independentBlend;
             Register<0x8C0, u32[0x20]> firmwareCall;
+            Register<0x8E0, type::ConstantBufferSelector> constantBufferSelector;
+            Register<0x8E3, type::ConstantBufferUpdate> constantBufferUpdate;
+            Register<0x904, std::array<type::BindGroup, type::ShaderStageCount>> bindGroups;
         };
         static_assert(sizeof(Registers) == (RegisterCount * sizeof(u32)));
         #pragma pack(pop)
@@ -220,5 +270,10 @@ namespace skyline::soc::gm20b::engine::maxwell3d {
         void ResetRegs();
 
         void CallMethod(u32 method, u32 argument, bool lastCall);
+
+        /**
+         * @brief Calls a method with multiple arguments, arguments to a macro are appended to the pending invocation in bulk rather than one at a time
+         */
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall);
     };
 }
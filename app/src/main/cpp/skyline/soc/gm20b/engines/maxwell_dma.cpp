@@ -0,0 +1,430 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <soc/gm20b/channel.h>
+#include <soc/gm20b/gmmu.h>
+#include "block_linear.h"
+#include "maxwell_dma.h"
+
+namespace skyline::soc::gm20b::engine {
+    using Surface = MaxwellDma::Registers::Surface;
+
+    MaxwellDma::MaxwellDma(const DeviceState &state, ChannelContext &channelCtx) : Engine(state), channelCtx(channelCtx) {}
+
+    void MaxwellDma::CallMethod(u32 method, u32 argument, bool lastCall) {
+        if (method >= RegisterCount) {
+            Logger::Warn("Called method outside of Maxwell DMA registers: 0x{:X} args: 0x{:X}", method, argument);
+            return;
+        }
+
+        registers.raw[method] = argument;
+
+        #define MAXWELL_DMA_OFFSET(field) (sizeof(typeof(Registers::field)) - sizeof(typeof(*Registers::field))) / sizeof(u32)
+
+        if (method == MAXWELL_DMA_OFFSET(launchDma))
+            LaunchDma();
+
+        #undef MAXWELL_DMA_OFFSET
+    }
+
+    void MaxwellDma::LaunchDma() {
+        auto launch{*registers.launchDma};
+        if (launch.dataTransferType != Registers::LaunchDma::DataTransferType::None) {
+            u32 lineLength{*registers.lineLengthIn};
+            if (launch.remapEnable) {
+                channelCtx.executor.ExecuteAndWait(); // The CPU copies below must be ordered after any prior GPU work which writes back to the guest memory they access
+                CopyRemappedThroughGmmu(lineLength);
+            } else if (!CopyTextureToTexture(lineLength) && !CopyBufferToTexture(lineLength)) {
+                channelCtx.executor.ExecuteAndWait();
+                CopyThroughGmmu(lineLength);
+            }
+        }
+
+        ReleaseSemaphore();
+    }
+
+    /**
+     * @return A pre-existing texture which has the supplied block-linear surface as its first mapping and a layout that matches it, nullptr if there's none
+     */
+    static std::shared_ptr<gpu::Texture> FindSurfaceTexture(gpu::GPU &gpu, GMMU &gmmu, u64 address, const Surface &surface) {
+        auto mapping{gmmu.TranslateContiguous(address, 1)};
+        if (mapping.empty())
+            return nullptr;
+
+        auto texture{gpu.texture.Find(mapping.data())};
+        if (!texture)
+            return nullptr;
+
+        auto &guest{*texture->guest};
+        auto &tileConfig{guest.tileConfig};
+        if (tileConfig.mode != gpu::texture::TileMode::Block || tileConfig.blockHeight != (1U << surface.blockSize.heightLog2) || tileConfig.blockDepth != (1U << surface.blockSize.depthLog2))
+            return nullptr;
+
+        if (guest.format->IsCompressed() || guest.format->vkAspect != vk::ImageAspectFlagBits::eColor || guest.dimensions.width * guest.format->bpb != surface.width || guest.dimensions.height != surface.height)
+            return nullptr;
+
+        if (guest.dimensions.depth > 1 ? surface.layer >= guest.dimensions.depth : surface.layer != 0)
+            return nullptr; // Layers of array textures aren't contiguous with the first layer, we only handle the first one
+
+        return texture;
+    }
+
+    /**
+     * @return The region of the texture covered by a copy from/to the supplied surface, std::nullopt if the copy doesn't exactly cover whole texels inside the texture
+     */
+    static std::optional<std::pair<vk::Offset3D, vk::Extent3D>> GetTextureRegion(const gpu::Texture &texture, const Surface &surface, u32 lineLength, u32 lineCount) {
+        u32 bpb{texture.format->bpb};
+        if (surface.origin.x % bpb || lineLength % bpb)
+            return std::nullopt;
+
+        vk::Offset3D offset{static_cast<i32>(surface.origin.x / bpb), static_cast<i32>(surface.origin.y), static_cast<i32>(texture.dimensions.depth > 1 ? surface.layer : 0)};
+        vk::Extent3D extent{lineLength / bpb, lineCount, 1};
+        if (offset.x + extent.width > texture.dimensions.width || offset.y + extent.height > texture.dimensions.height)
+            return std::nullopt;
+
+        return std::make_pair(offset, extent);
+    }
+
+    bool MaxwellDma::CopyTextureToTexture(u32 lineLength) {
+        auto launch{*registers.launchDma};
+        if (launch.srcMemoryLayout != Registers::MemoryLayout::BlockLinear || launch.dstMemoryLayout != Registers::MemoryLayout::BlockLinear)
+            return false;
+
+        auto &gpu{*state.gpu};
+        auto &gmmu{channelCtx.asCtx->gmmu};
+        auto srcTexture{FindSurfaceTexture(gpu, gmmu, registers.offsetIn->Pack(), *registers.srcSurface)};
+        if (!srcTexture)
+            return false;
+        auto dstTexture{FindSurfaceTexture(gpu, gmmu, registers.offsetOut->Pack(), *registers.dstSurface)};
+        if (!dstTexture || dstTexture == srcTexture || !srcTexture->format->IsCompatible(*dstTexture->format))
+            return false;
+
+        u32 lineCount{launch.multiLineEnable ? *registers.lineCount : 1};
+        auto srcRegion{GetTextureRegion(*srcTexture, *registers.srcSurface, lineLength, lineCount)};
+        auto dstRegion{GetTextureRegion(*dstTexture, *registers.dstSurface, lineLength, lineCount)};
+        if (!srcRegion || !dstRegion)
+            return false;
+
+        std::scoped_lock lock(*srcTexture, *dstTexture);
+        srcTexture->WaitOnBacking();
+        dstTexture->WaitOnBacking();
+
+        channelCtx.executor.AttachTexture(srcTexture.get());
+        channelCtx.executor.AttachTexture(dstTexture.get());
+        channelCtx.executor.AddOutsideRpCommand([srcTexture, dstTexture, srcOffset = srcRegion->first, dstOffset = dstRegion->first, extent = srcRegion->second](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<gpu::FenceCycle> &, gpu::GPU &) {
+            // The layouts are only read at recording time as synchronizing the textures with the guest prior to this might have transitioned them, guest threads may access them concurrently so the textures are locked
+            std::scoped_lock lock(*srcTexture, *dstTexture);
+            vk::ImageSubresourceRange subresource{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1,
+            };
+            auto srcBacking{srcTexture->GetBacking()}, dstBacking{dstTexture->GetBacking()};
+            auto dstLayout{dstTexture->layout != vk::ImageLayout::eUndefined ? dstTexture->layout : vk::ImageLayout::eTransferDstOptimal};
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, vk::ImageMemoryBarrier{
+                .image = srcBacking,
+                .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
+                .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+                .oldLayout = srcTexture->layout,
+                .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = subresource,
+            });
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, vk::ImageMemoryBarrier{
+                .image = dstBacking,
+                .srcAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+                .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .oldLayout = dstTexture->layout,
+                .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = subresource,
+            });
+
+            vk::ImageSubresourceLayers subresourceLayers{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .layerCount = 1,
+            };
+            commandBuffer.copyImage(srcBacking, vk::ImageLayout::eTransferSrcOptimal, dstBacking, vk::ImageLayout::eTransferDstOptimal, vk::ImageCopy{
+                .srcSubresource = subresourceLayers,
+                .srcOffset = srcOffset,
+                .dstSubresource = subresourceLayers,
+                .dstOffset = dstOffset,
+                .extent = extent,
+            });
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, vk::ImageMemoryBarrier{
+                .image = srcBacking,
+                .srcAccessMask = vk::AccessFlagBits::eTransferRead,
+                .dstAccessMask = vk::AccessFlagBits::eMemoryWrite,
+                .oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+                .newLayout = srcTexture->layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = subresource,
+            });
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, vk::ImageMemoryBarrier{
+                .image = dstBacking,
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+                .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                .newLayout = dstLayout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = subresource,
+            });
+            dstTexture->layout = dstLayout;
+        });
+
+        return true;
+    }
+
+    bool MaxwellDma::CopyBufferToTexture(u32 lineLength) {
+        auto launch{*registers.launchDma};
+        if (launch.srcMemoryLayout != Registers::MemoryLayout::Pitch || launch.dstMemoryLayout != Registers::MemoryLayout::BlockLinear)
+            return false;
+
+        auto &gpu{*state.gpu};
+        auto &gmmu{channelCtx.asCtx->gmmu};
+        auto dstTexture{FindSurfaceTexture(gpu, gmmu, registers.offsetOut->Pack(), *registers.dstSurface)};
+        if (!dstTexture)
+            return false;
+
+        u32 lineCount{launch.multiLineEnable ? *registers.lineCount : 1};
+        u32 pitch{launch.multiLineEnable ? *registers.pitchIn : lineLength};
+        u32 bpb{dstTexture->format->bpb};
+        auto dstRegion{GetTextureRegion(*dstTexture, *registers.dstSurface, lineLength, lineCount)};
+        if (!dstRegion || pitch % bpb)
+            return false;
+
+        auto srcMapping{gmmu.TranslateContiguous(registers.offsetIn->Pack(), static_cast<u64>(pitch) * (lineCount - 1) + lineLength)};
+        if (srcMapping.empty())
+            return false;
+
+        auto srcView{gpu.buffer.Find(srcMapping)};
+        if (!srcView.buffer || (srcView.buffer->offset + srcView.offset) % std::max<u32>(bpb, 4))
+            return false; // Vulkan requires the buffer offset of a copy to be aligned to the texel size and to 4 bytes
+
+        std::scoped_lock lock(*dstTexture);
+        dstTexture->WaitOnBacking();
+
+        channelCtx.executor.AttachBuffer(srcView);
+        channelCtx.executor.AttachTexture(dstTexture.get());
+        channelCtx.executor.AddOutsideRpCommand([srcBuffer = srcView.buffer, bufferOffset = srcView.offset, rowLength = pitch / bpb, dstTexture, dstOffset = dstRegion->first, extent = dstRegion->second](vk::raii::CommandBuffer &commandBuffer, const std::shared_ptr<gpu::FenceCycle> &, gpu::GPU &) {
+            std::scoped_lock lock(*dstTexture); // The layout is read and written at recording time while guest threads may access the texture concurrently
+            vk::ImageSubresourceRange subresource{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1,
+            };
+            auto dstBacking{dstTexture->GetBacking()};
+            auto dstLayout{dstTexture->layout != vk::ImageLayout::eUndefined ? dstTexture->layout : vk::ImageLayout::eTransferDstOptimal};
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, vk::ImageMemoryBarrier{
+                .image = dstBacking,
+                .srcAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+                .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .oldLayout = dstTexture->layout,
+                .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = subresource,
+            });
+
+            commandBuffer.copyBufferToImage(srcBuffer->backing, dstBacking, vk::ImageLayout::eTransferDstOptimal, vk::BufferImageCopy{
+                .bufferOffset = srcBuffer->offset + bufferOffset,
+                .bufferRowLength = rowLength,
+                .imageSubresource = {
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .layerCount = 1,
+                },
+                .imageOffset = dstOffset,
+                .imageExtent = extent,
+            });
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, vk::ImageMemoryBarrier{
+                .image = dstBacking,
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+                .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                .newLayout = dstLayout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = subresource,
+            });
+            dstTexture->layout = dstLayout;
+        });
+
+        return true;
+    }
+
+    /**
+     * @brief Accesses a block-linear surface in place when it's contiguous in guest memory or through a temporary copy otherwise
+     * @param function A function which is called with a span covering the surface from its start
+     */
+    template<bool Write, typename Function>
+    static void AccessBlockLinear(GMMU &gmmu, u64 address, size_t size, Function function) {
+        auto mapping{gmmu.TranslateContiguous(address, size)};
+        if (!mapping.empty()) {
+            function(mapping);
+            return;
+        }
+
+        std::vector<u8> surface(size);
+        gmmu.Read(surface.data(), address, size);
+        function(span<u8>(surface));
+        if constexpr (Write)
+            gmmu.Write(address, surface.data(), size);
+    }
+
+    /**
+     * @brief Reads lines from guest memory into tightly packed linear memory or writes them from it to guest memory, block-linear surfaces are (de)swizzled a sector at a time
+     * @param elementSize The size of the unit that the width and X origin of the surface are in, this is only larger than a byte when remapping
+     */
+    template<bool Write>
+    static void TransferLines(GMMU &gmmu, MaxwellDma::Registers::MemoryLayout layout, u64 address, u32 pitch, const Surface &surface, u32 elementSize, u8 *linear, u32 lineLength, u32 lineCount) {
+        if (layout == MaxwellDma::Registers::MemoryLayout::Pitch) {
+            for (u32 line{}; line < lineCount; line++, linear += lineLength) {
+                if constexpr (Write)
+                    gmmu.Write(address + static_cast<u64>(line) * pitch, linear, lineLength);
+                else
+                    gmmu.Read(linear, address + static_cast<u64>(line) * pitch, lineLength);
+            }
+            return;
+        }
+
+        BlockLinearLayout blockLinearLayout{surface.width * elementSize, surface.height, surface.blockSize.heightLog2, surface.blockSize.depthLog2};
+        u32 originX{surface.origin.x * elementSize}, z{surface.layer};
+        AccessBlockLinear<Write>(gmmu, address, blockLinearLayout.GetSize(z), [&](span<u8> blockLinear) {
+            for (u32 line{}; line < lineCount; line++) {
+                u32 y{surface.origin.y + line};
+                for (u32 x{originX}, end{originX + lineLength}; x < end;) {
+                    u32 run{std::min(BlockLinearLayout::SectorWidth - (x % BlockLinearLayout::SectorWidth), end - x)}; // Bytes are only contiguous inside a sector
+                    size_t offset{blockLinearLayout.GetOffset(x, y, z)};
+                    if (offset + run <= blockLinear.size()) {
+                        if constexpr (Write)
+                            std::memcpy(blockLinear.data() + offset, linear, run);
+                        else
+                            std::memcpy(linear, blockLinear.data() + offset, run);
+                    }
+
+                    x += run;
+                    linear += run;
+                }
+            }
+        });
+    }
+
+    void MaxwellDma::CopyThroughGmmu(u32 lineLength) {
+        auto launch{*registers.launchDma};
+        auto &gmmu{channelCtx.asCtx->gmmu};
+        u64 srcAddress{registers.offsetIn->Pack()}, dstAddress{registers.offsetOut->Pack()};
+
+        if (!launch.multiLineEnable && launch.srcMemoryLayout == Registers::MemoryLayout::Pitch && launch.dstMemoryLayout == Registers::MemoryLayout::Pitch) {
+            // A 1D copy, this is commonly used for copying buffers and doesn't need any staging if both sides are contiguous
+            auto srcMapping{gmmu.TranslateContiguous(srcAddress, lineLength)}, dstMapping{gmmu.TranslateContiguous(dstAddress, lineLength)};
+            if (!srcMapping.empty() && !dstMapping.empty()) {
+                std::memmove(dstMapping.data(), srcMapping.data(), lineLength);
+            } else {
+                std::vector<u8> staging(lineLength);
+                gmmu.Read(staging.data(), srcAddress, lineLength);
+                gmmu.Write(dstAddress, staging.data(), lineLength);
+            }
+            return;
+        }
+
+        u32 lineCount{launch.multiLineEnable ? *registers.lineCount : 1};
+        std::vector<u8> staging(static_cast<size_t>(lineLength) * lineCount);
+        TransferLines<false>(gmmu, launch.srcMemoryLayout, srcAddress, *registers.pitchIn, *registers.srcSurface, 1, staging.data(), lineLength, lineCount);
+        TransferLines<true>(gmmu, launch.dstMemoryLayout, dstAddress, *registers.pitchOut, *registers.dstSurface, 1, staging.data(), lineLength, lineCount);
+    }
+
+    void MaxwellDma::CopyRemappedThroughGmmu(u32 lineLength) {
+        using Component = Registers::Remap::Component;
+
+        auto launch{*registers.launchDma};
+        auto &gmmu{channelCtx.asCtx->gmmu};
+        auto remap{*registers.remap};
+        u32 componentSize{remap.components.componentSizeMinusOne + 1U};
+        u32 srcComponents{remap.components.srcComponentCountMinusOne + 1U}, dstComponents{remap.components.dstComponentCountMinusOne + 1U};
+        u32 srcElementSize{componentSize * srcComponents}, dstElementSize{componentSize * dstComponents};
+        u32 lineCount{launch.multiLineEnable ? *registers.lineCount : 1};
+        size_t elementCount{static_cast<size_t>(lineLength) * lineCount};
+
+        std::array<Component, 4> selects{remap.components.dstX, remap.components.dstY, remap.components.dstZ, remap.components.dstW};
+        auto dstSelects{span(selects).first(dstComponents)};
+
+        // The source is only read when a component is sourced from it, this is not the case for clears which only use the constants
+        std::vector<u8> src;
+        if (std::any_of(dstSelects.begin(), dstSelects.end(), [](Component select) { return select <= Component::SrcW; })) {
+            src.resize(elementCount * srcElementSize);
+            TransferLines<false>(gmmu, launch.srcMemoryLayout, registers.offsetIn->Pack(), *registers.pitchIn, *registers.srcSurface, srcElementSize, src.data(), lineLength * srcElementSize, lineCount);
+        }
+
+        // Components which aren't written need to retain their contents in the destination
+        std::vector<u8> dst(elementCount * dstElementSize);
+        if (std::find(dstSelects.begin(), dstSelects.end(), Component::None) != dstSelects.end())
+            TransferLines<false>(gmmu, launch.dstMemoryLayout, registers.offsetOut->Pack(), *registers.pitchOut, *registers.dstSurface, dstElementSize, dst.data(), lineLength * dstElementSize, lineCount);
+
+        for (size_t element{}; element < elementCount; element++) {
+            for (u32 component{}; component < dstComponents; component++) {
+                u8 *output{dst.data() + element * dstElementSize + component * componentSize};
+                switch (auto select{dstSelects[component]}; select) {
+                    case Component::SrcX:
+                    case Component::SrcY:
+                    case Component::SrcZ:
+                    case Component::SrcW:
+                        if (static_cast<u32>(select) < srcComponents)
+                            std::memcpy(output, src.data() + element * srcElementSize + static_cast<u32>(select) * componentSize, componentSize);
+                        break;
+
+                    case Component::ConstA:
+                        std::memcpy(output, &remap.constA, componentSize);
+                        break;
+
+                    case Component::ConstB:
+                        std::memcpy(output, &remap.constB, componentSize);
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+        }
+
+        TransferLines<true>(gmmu, launch.dstMemoryLayout, registers.offsetOut->Pack(), *registers.pitchOut, *registers.dstSurface, dstElementSize, dst.data(), lineLength * dstElementSize, lineCount);
+    }
+
+    void MaxwellDma::ReleaseSemaphore() {
+        auto semaphoreType{registers.launchDma->semaphoreType};
+        if (semaphoreType == Registers::LaunchDma::SemaphoreType::None)
+            return;
+
+        // The semaphore is only released once all prior work has completed, this includes any copies done on the GPU
+        channelCtx.executor.AddCompletionCallback([&gmmu = channelCtx.asCtx->gmmu, address = registers.semaphore->address.Pack(), payload = registers.semaphore->payload, semaphoreType]() {
+            struct FourWordResult {
+                u64 value;
+                u64 timestamp;
+            };
+
+            if (semaphoreType == Registers::LaunchDma::SemaphoreType::ReleaseFourWord) {
+                // Convert the current nanosecond time to GPU ticks
+                constexpr i64 NsToTickNumerator{384};
+                constexpr i64 NsToTickDenominator{625};
+
+                i64 nsTime{util::GetTimeNs()};
+                i64 timestamp{(nsTime / NsToTickDenominator) * NsToTickNumerator + ((nsTime % NsToTickDenominator) * NsToTickNumerator) / NsToTickDenominator};
+
+                gmmu.Write<FourWordResult>(address, FourWordResult{payload, static_cast<u64>(timestamp)});
+            } else {
+                gmmu.Write<u32>(address, payload);
+            }
+        });
+        channelCtx.executor.Execute(); // The guest may poll the semaphore without a syncpoint that would otherwise flush the pending commands, it'd never be released in that case
+    }
+}
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "engine.h"
+#include "maxwell/types.h"
+
+namespace skyline::soc::gm20b {
+    struct ChannelContext;
+}
+
+namespace skyline::soc::gm20b::engine {
+    /**
+     * @brief The Maxwell DMA engine handles copies between linear, pitch-linear and block-linear memory, these are used by applications for uploading buffers and textures alongside converting between layouts
+     * @note Copies between textures or from a buffer into a texture which are known to the host are done on the GPU, all other copies are done on the CPU through the GMMU
+     * @url https://github.com/NVIDIA/open-gpu-doc/blob/master/classes/dma-copy/clb0b5.h
+     */
+    class MaxwellDma : public Engine {
+      public:
+        static constexpr u32 RegisterCount{0x1D0}; //!< The number of Maxwell DMA registers
+
+        #pragma pack(push, 1)
+        union Registers {
+            std::array<u32, RegisterCount> raw;
+
+            template<size_t Offset, typename Type>
+            using Register = util::OffsetMember<Offset, Type, u32>;
+
+            enum class MemoryLayout : u8 {
+                BlockLinear = 0,
+                Pitch = 1,
+            };
+
+            union LaunchDma {
+                enum class DataTransferType : u8 {
+                    None = 0,
+                    Pipelined = 1,
+                    NonPipelined = 2,
+                };
+
+                enum class SemaphoreType : u8 {
+                    None = 0,
+                    ReleaseOneWord = 1,
+                    ReleaseFourWord = 2,
+                };
+
+                u32 raw;
+                struct {
+                    DataTransferType dataTransferType : 2;
+                    bool flushEnable : 1;
+                    SemaphoreType semaphoreType : 2;
+                    u8 interruptType : 2;
+                    MemoryLayout srcMemoryLayout : 1;
+                    MemoryLayout dstMemoryLayout : 1;
+                    bool multiLineEnable : 1;
+                    bool remapEnable : 1;
+                    bool forceRmwDisable : 1;
+                    bool srcPhysical : 1;
+                    bool dstPhysical : 1;
+                    u32 _pad_ : 18;
+                };
+            };
+            static_assert(sizeof(LaunchDma) == sizeof(u32));
+
+            struct Remap {
+                enum class Component : u8 {
+                    SrcX = 0,
+                    SrcY = 1,
+                    SrcZ = 2,
+                    SrcW = 3,
+                    ConstA = 4,
+                    ConstB = 5,
+                    None = 6,
+                };
+
+                u32 constA; // 0x1C0
+                u32 constB; // 0x1C1
+                struct {
+                    Component dstX : 3;
+                    u8 _pad0_ : 1;
+                    Component dstY : 3;
+                    u8 _pad1_ : 1;
+                    Component dstZ : 3;
+                    u8 _pad2_ : 1;
+                    Component dstW : 3;
+                    u8 _pad3_ : 1;
+                    u8 componentSizeMinusOne : 2;
+                    u8 _pad4_ : 2;
+                    u8 srcComponentCountMinusOne : 2;
+                    u8 _pad5_ : 2;
+                    u8 dstComponentCountMinusOne : 2;
+                    u8 _pad6_ : 6;
+                } components; // 0x1C2
+            };
+            static_assert(sizeof(Remap) == sizeof(u32) * 3);
+
+            /**
+             * @brief The layout of a block-linear surface, these are ignored for pitch-linear surfaces
+             */
+            struct Surface {
+                struct {
+                    u8 widthLog2 : 4; //!< The width of a block in GOBs, this is always 1 on the Tegra X1
+                    u8 heightLog2 : 4; //!< The height of a block in GOBs
+                    u8 depthLog2 : 4; //!< The depth of a block in GOBs
+                    u8 gobHeight : 4; //!< The height of a GOB, this is always 8 lines on the Tegra X1
+                    u16 _pad_;
+                } blockSize;
+                u32 width; //!< The width of the surface in bytes
+                u32 height;
+                u32 depth;
+                u32 layer;
+                struct {
+                    u16 x; //!< The X origin of the copy in bytes
+                    u16 y;
+                } origin;
+            };
+            static_assert(sizeof(Surface) == sizeof(u32) * 6);
+
+            struct Semaphore {
+                maxwell3d::type::Address address; // 0x90
+                u32 payload; // 0x92
+            };
+            Register<0x90, Semaphore> semaphore;
+
+            Register<0xC0, LaunchDma> launchDma;
+
+            Register<0x100, maxwell3d::type::Address> offsetIn;
+            Register<0x102, maxwell3d::type::Address> offsetOut;
+            Register<0x104, u32> pitchIn;
+            Register<0x105, u32> pitchOut;
+            Register<0x106, u32> lineLengthIn; //!< The length of a line in bytes or in remapped elements if remapping is enabled
+            Register<0x107, u32> lineCount;
+
+            Register<0x1C0, Remap> remap;
+            Register<0x1C3, Surface> dstSurface;
+            Register<0x1CA, Surface> srcSurface;
+        };
+        static_assert(sizeof(Registers) == (RegisterCount * sizeof(u32)));
+        #pragma pack(pop)
+
+      private:
+        ChannelContext &channelCtx;
+
+        /**
+         * @brief Executes the copy described by the registers, this is triggered by a write to LaunchDma
+         */
+        void LaunchDma();
+
+        /**
+         * @brief Copies between two textures known to the host on the GPU
+         * @return If the copy could be done on the GPU, the caller must fall back to a CPU copy otherwise
+         */
+        bool CopyTextureToTexture(u32 lineLength);
+
+        /**
+         * @brief Copies from a pitch-linear buffer known to the host into a block-linear texture known to the host on the GPU
+         * @return If the copy could be done on the GPU, the caller must fall back to a CPU copy otherwise
+         */
+        bool CopyBufferToTexture(u32 lineLength);
+
+        /**
+         * @brief Copies between any combination of layouts on the CPU through the GMMU
+         */
+        void CopyThroughGmmu(u32 lineLength);
+
+        /**
+         * @brief Copies between any combination of layouts on the CPU with the components of every element remapped, this is used by applications to clear memory with a constant
+         * @param lineLength The length of a line in elements
+         */
+        void CopyRemappedThroughGmmu(u32 lineLength);
+
+        /**
+         * @brief Releases the semaphore if requested once all prior work on the channel has completed
+         */
+        void ReleaseSemaphore();
+
+      public:
+        Registers registers{};
+
+        MaxwellDma(const DeviceState &state, ChannelContext &channelCtx);
+
+        void CallMethod(u32 method, u32 argument, bool lastCall);
+
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing, bool lastCall) {
+            for (size_t index{}; index < arguments.size(); index++)
+                CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index], lastCall && index == arguments.size() - 1);
+        }
+    };
+}
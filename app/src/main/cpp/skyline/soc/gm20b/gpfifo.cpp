@@ -1,7 +1,12 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <common/signal.h>
+#include <common/flight_recorder.h>
+#include <common/host_affinity.h>
+#include <common/performance_hint.h>
 #include <loader/loader.h>
 #include <kernel/types/KProcess.h>
 #include <soc.h>
@@ -59,21 +64,40 @@ namespace skyline::soc::gm20b {
     };
     static_assert(sizeof(PushBufferMethodHeader) == sizeof(u32));
 
+    namespace {
+        std::unique_ptr<GpfifoCapture> CreateCapture(const DeviceState &state) {
+            if (!state.settings->captureGpfifo)
+                return nullptr;
+
+            auto directory{state.os->appFilesPath + "gpfifo_captures/"};
+            if (mkdir(directory.c_str(), 0755) && errno != EEXIST)
+                throw exception("Failed to create GPFIFO capture directory '{}': {}", directory, strerror(errno));
+
+            auto path{fmt::format("{}{}.gcap", directory, util::GetTimeNs())};
+            Logger::Info("Capturing GPFIFO entries to {}", path);
+            return std::make_unique<GpfifoCapture>(path);
+        }
+    }
+
     ChannelGpfifo::ChannelGpfifo(const DeviceState &state, ChannelContext &channelCtx, size_t numEntries) :
         state(state),
         gpfifoEngine(state, channelCtx),
         channelCtx(channelCtx),
         gpEntries(numEntries),
+        capture(CreateCapture(state)),
         thread(std::thread(&ChannelGpfifo::Run, this)) {}
 
-    void ChannelGpfifo::Send(u32 method, u32 argument, u32 subChannel, bool lastCall) {
+    namespace {
         constexpr u32 ThreeDSubChannel{0};
         constexpr u32 ComputeSubChannel{1};
         constexpr u32 Inline2MemorySubChannel{2};
         constexpr u32 TwoDSubChannel{3};
         constexpr u32 CopySubChannel{4}; // HW forces a memory flush on a switch from this subchannel to others
+    }
 
+    void ChannelGpfifo::Send(u32 method, u32 argument, u32 subChannel, bool lastCall) {
         Logger::Debug("Called GPU method - method: 0x{:X} argument: 0x{:X} subchannel: 0x{:X} last: {}", method, argument, subChannel, lastCall);
+        methodCount++;
 
         if (method < engine::GPFIFO::RegisterCount) {
             gpfifoEngine.CallMethod(method, argument, lastCall);
@@ -100,7 +124,43 @@ namespace skyline::soc::gm20b {
         }
     }
 
+    void ChannelGpfifo::SendBatch(u32 method, span<u32> arguments, u32 subChannel, bool incrementing, bool lastCall) {
+        Logger::Debug("Called GPU method batch - method: 0x{:X} count: {} subchannel: 0x{:X} incrementing: {} last: {}", method, arguments.size(), subChannel, incrementing, lastCall);
+
+        if (method < engine::GPFIFO::RegisterCount) {
+            for (size_t index{}; index < arguments.size(); index++)
+                Send(incrementing ? method + static_cast<u32>(index) : method, arguments[index], subChannel, lastCall && index == arguments.size() - 1);
+            return;
+        }
+
+        methodCount += arguments.size();
+        switch (subChannel) {
+            case ThreeDSubChannel:
+                channelCtx.maxwell3D->CallMethodBatch(method, arguments, incrementing, lastCall);
+                break;
+            case ComputeSubChannel:
+                channelCtx.maxwellCompute.CallMethodBatch(method, arguments, incrementing, lastCall);
+                break;
+            case Inline2MemorySubChannel:
+                channelCtx.keplerMemory.CallMethodBatch(method, arguments, incrementing, lastCall);
+                break;
+            case TwoDSubChannel:
+                channelCtx.fermi2D.CallMethodBatch(method, arguments, incrementing, lastCall);
+                break;
+            case CopySubChannel:
+                channelCtx.maxwellDma.CallMethodBatch(method, arguments, incrementing, lastCall);
+                break;
+            default:
+                throw exception("Tried to call into a software subchannel: {}!", subChannel);
+        }
+    }
+
     void ChannelGpfifo::Process(GpEntry gpEntry) {
+        trace::FlightRecorder::Record(trace::FlightRecorder::EventType::GpfifoEntry, util::BitCast<u64>(gpEntry));
+
+        if (capture && !gpEntry.size) [[unlikely]]
+            capture->Record(util::BitCast<u64>(gpEntry), {});
+
         if (!gpEntry.size) {
             // This is a GPFIFO control entry, all control entries have a zero length and contain no pushbuffers
             switch (gpEntry.opcode) {
@@ -112,17 +172,25 @@ namespace skyline::soc::gm20b {
             }
         }
 
-        pushBufferData.resize(gpEntry.size);
-        channelCtx.asCtx->gmmu.Read<u32>(pushBufferData, gpEntry.Address());
+        // The pushbuffer is parsed in place when it's contiguous in host memory, it's only copied out when it's split across multiple mappings
+        span<u32> pushBuffer{channelCtx.asCtx->gmmu.TranslateContiguous(gpEntry.Address(), gpEntry.size * sizeof(u32)).cast<u32>()};
+        if (pushBuffer.empty()) {
+            pushBufferData.resize(gpEntry.size);
+            channelCtx.asCtx->gmmu.Read<u32>(pushBufferData, gpEntry.Address());
+            pushBuffer = span(pushBufferData);
+        }
+
+        if (capture) [[unlikely]]
+            capture->Record(util::BitCast<u64>(gpEntry), pushBuffer);
 
         // There will be at least one entry here
-        auto entry{pushBufferData.begin()};
+        auto entry{pushBuffer.begin()};
 
         // Executes the current split method, returning once execution is finished or the current GpEntry has reached its end
         auto resumeSplitMethod{[&](){
             switch (resumeState.state) {
                 case MethodResumeState::State::Inc:
-                    while (entry != pushBufferData.end() && resumeState.remaining)
+                    while (entry != pushBuffer.end() && resumeState.remaining)
                         Send(resumeState.address++, *(entry++), resumeState.subChannel, --resumeState.remaining == 0);
 
                     break;
@@ -133,7 +201,7 @@ namespace skyline::soc::gm20b {
                     resumeState.state = MethodResumeState::State::NonInc;
                     [[fallthrough]];
                 case MethodResumeState::State::NonInc:
-                    while (entry != pushBufferData.end() && resumeState.remaining)
+                    while (entry != pushBuffer.end() && resumeState.remaining)
                         Send(resumeState.address, *(entry++), resumeState.subChannel, --resumeState.remaining == 0);
 
                     break;
@@ -145,7 +213,7 @@ namespace skyline::soc::gm20b {
             resumeSplitMethod();
 
         // Process more methods if the entries are still not all used up after handling resuming
-        for (; entry != pushBufferData.end(); entry++) {
+        for (; entry != pushBuffer.end(); entry++) {
             // An entry containing all zeroes is a NOP, skip over it
             if (*entry == 0)
                 continue;
@@ -153,7 +221,14 @@ namespace skyline::soc::gm20b {
             PushBufferMethodHeader methodHeader{.raw = *entry};
 
             // Needed in order to check for methods split across multiple GpEntries
-            auto remainingEntries{std::distance(entry, pushBufferData.end()) - 1};
+            auto remainingEntries{std::distance(entry, pushBuffer.end()) - 1};
+
+            // Returns the supplied amount of method arguments following the current entry and advances past them
+            auto getArguments{[&](u32 count) {
+                auto arguments{pushBuffer.subspan(static_cast<size_t>(std::distance(pushBuffer.begin(), entry)) + 1, count)};
+                entry += count;
+                return arguments;
+            }};
 
             // Handles storing state and initial execution for methods that are split across multiple GpEntries
             auto startSplitMethod{[&](auto methodState) {
@@ -173,8 +248,8 @@ namespace skyline::soc::gm20b {
             switch (methodHeader.secOp) {
                 case PushBufferMethodHeader::SecOp::IncMethod:
                     if (remainingEntries >= methodHeader.methodCount) {
-                        for (u32 i{}; i < methodHeader.methodCount; i++)
-                            Send(methodHeader.methodAddress + i, *++entry, methodHeader.methodSubChannel, i == methodHeader.methodCount - 1);
+                        if (methodHeader.methodCount)
+                            SendBatch(methodHeader.methodAddress, getArguments(methodHeader.methodCount), methodHeader.methodSubChannel, true, true);
 
                         break;
                     } else {
@@ -183,8 +258,8 @@ namespace skyline::soc::gm20b {
                     }
                 case PushBufferMethodHeader::SecOp::NonIncMethod:
                     if (remainingEntries >= methodHeader.methodCount) {
-                        for (u32 i{}; i < methodHeader.methodCount; i++)
-                            Send(methodHeader.methodAddress, *++entry, methodHeader.methodSubChannel, i == methodHeader.methodCount - 1);
+                        if (methodHeader.methodCount)
+                            SendBatch(methodHeader.methodAddress, getArguments(methodHeader.methodCount), methodHeader.methodSubChannel, false, true);
 
                         break;
                     } else {
@@ -193,8 +268,12 @@ namespace skyline::soc::gm20b {
                     }
                 case PushBufferMethodHeader::SecOp::OneInc:
                     if (remainingEntries >= methodHeader.methodCount) {
-                        for (u32 i{}; i < methodHeader.methodCount; i++)
-                            Send(methodHeader.methodAddress + (i ? 1 : 0), *++entry, methodHeader.methodSubChannel, i == methodHeader.methodCount - 1);
+                        if (methodHeader.methodCount) {
+                            // The first argument goes to the method itself and all subsequent arguments go to the method after it, both are sent as batches so engines can view them contiguously in the pushbuffer
+                            SendBatch(methodHeader.methodAddress, getArguments(1), methodHeader.methodSubChannel, false, methodHeader.methodCount == 1);
+                            if (methodHeader.methodCount > 1)
+                                SendBatch(methodHeader.methodAddress + 1, getArguments(methodHeader.methodCount - 1), methodHeader.methodSubChannel, false, true);
+                        }
 
                         break;
                     } else {
@@ -214,14 +293,27 @@ namespace skyline::soc::gm20b {
         }
     }
 
+    void ChannelGpfifo::ApplyNiceness() {
+        if (auto tid{threadId.load()}) {
+            auto value{niceness.load()};
+            if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), value) == -1)
+                Logger::Warn("Failed to set GPFIFO thread niceness to {}: {}", value, strerror(errno));
+        }
+    }
+
     void ChannelGpfifo::Run() {
         pthread_setname_np(pthread_self(), "GPFIFO");
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Emulation);
+        threadId = gettid();
+        ApplyNiceness();
+        PerformanceHint::RegisterCurrentThread();
         try {
             signal::SetSignalHandler({SIGINT, SIGILL, SIGTRAP, SIGBUS, SIGFPE, SIGSEGV}, signal::ExceptionalSignalHandler);
 
             gpEntries.Process([this](GpEntry gpEntry) {
                 Logger::Debug("Processing pushbuffer: 0x{:X}, Size: 0x{:X}", gpEntry.Address(), +gpEntry.size);
                 Process(gpEntry);
+                TotalMethodCount.fetch_add(std::exchange(methodCount, 0), std::memory_order_relaxed);
             });
         } catch (const signal::SignalException &e) {
             if (e.signal != SIGINT) {
@@ -234,14 +326,25 @@ namespace skyline::soc::gm20b {
             signal::BlockSignal({SIGINT});
             state.process->Kill(false);
         }
+        PerformanceHint::UnregisterCurrentThread();
     }
 
     void ChannelGpfifo::Push(span<GpEntry> entries) {
         gpEntries.Append(entries);
+        TRACE_COUNTER("gpu", "GPFIFO Queue Depth", gpEntries.Size());
     }
 
     void ChannelGpfifo::Push(GpEntry entry) {
         gpEntries.Push(entry);
+        TRACE_COUNTER("gpu", "GPFIFO Queue Depth", gpEntries.Size());
+    }
+
+    void ChannelGpfifo::SetPriority(u32 priority) {
+        // Only channels below high priority are deprioritized as raising the priority of a thread above the default isn't permitted for applications, the niceness is capped to stay within the range of normal threads
+        constexpr int NicenessPerStep{2};
+        auto steps{static_cast<int>((HighPriority - std::clamp(priority, LowPriority, HighPriority)) / (MediumPriority - LowPriority))};
+        niceness = steps * NicenessPerStep;
+        ApplyNiceness();
     }
 
     ChannelGpfifo::~ChannelGpfifo() {
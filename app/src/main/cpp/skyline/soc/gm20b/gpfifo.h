@@ -3,8 +3,9 @@
 
 #pragma once
 
-#include <common/circular_queue.h>
+#include <common/spsc_queue.h>
 #include "engines/gpfifo.h"
+#include "gpfifo_capture.h"
 
 namespace skyline::soc::gm20b {
     struct ChannelContext;
@@ -91,9 +92,13 @@ namespace skyline::soc::gm20b {
         const DeviceState &state;
         ChannelContext &channelCtx;
         engine::GPFIFO gpfifoEngine; //!< The engine for processing GPFIFO method calls
-        CircularQueue<GpEntry> gpEntries;
+        SpscQueue<GpEntry> gpEntries; //!< The GpEntries pending processing, these are only pushed by the channel's nvhost-gpu device with its mutex held
+        std::atomic<pid_t> threadId{}; //!< The kernel thread ID of the processing thread, this is 0 till the thread has started
+        std::atomic<int> niceness{}; //!< The niceness the processing thread should run at, this is derived from the channel's priority
+        std::unique_ptr<GpfifoCapture> capture; //!< The capture that all processed GpEntries are recorded into, this is nullptr unless GPFIFO capturing is enabled
         std::thread thread; //!< The thread that manages processing of pushbuffers
-        std::vector<u32> pushBufferData; //!< Persistent vector storing pushbuffer data to avoid constant reallocations
+        std::vector<u32> pushBufferData; //!< Persistent vector storing pushbuffer data to avoid constant reallocations, this is only used for pushbuffers which aren't contiguous in host memory
+        u64 methodCount{}; //!< The amount of methods sent since the last GpEntry was processed, this is accumulated locally so the hot path doesn't touch the shared total
 
         /**
          * @brief Holds the required state in order to resume a method started from one call to `Process` in another
@@ -120,18 +125,31 @@ namespace skyline::soc::gm20b {
          */
         void Send(u32 method, u32 argument, u32 subchannel, bool lastCall);
 
+        /**
+         * @brief Sends all arguments of a single method header to the GPU hardware, the subchannel is only dispatched on once for the entire batch
+         * @param incrementing If the method should be incremented for each argument or if all arguments go to the same method
+         */
+        void SendBatch(u32 method, span<u32> arguments, u32 subChannel, bool incrementing, bool lastCall);
+
 
         /**
          * @brief Processes the pushbuffer contained within the given GpEntry, calling methods as needed
          */
         void Process(GpEntry gpEntry);
 
+        /**
+         * @brief Applies the current niceness to the processing thread if it has started
+         */
+        void ApplyNiceness();
+
         /**
          * @brief Executes all pending entries in the FIFO and polls for more
          */
         void Run();
 
       public:
+        static inline std::atomic<u64> TotalMethodCount{}; //!< The amount of methods sent by all channels over the lifetime of the process, this is reported at the end of benchmark runs
+
         /**
          * @param numEntries The number of gpEntries to allocate space for in the FIFO
          */
@@ -148,5 +166,15 @@ namespace skyline::soc::gm20b {
          * @brief Pushes a single entry to the FIFO, these commands will be executed on calls to 'Process'
          */
         void Push(GpEntry entries);
+
+        /**
+         * @brief Sets the host scheduling priority of the processing thread based on the supplied channel priority, this allows the host to prioritize the main rendering channel over lower priority channels
+         * @param priority The nvgpu channel priority, this is one of LowPriority, MediumPriority or HighPriority
+         */
+        void SetPriority(u32 priority);
+
+        static constexpr u32 LowPriority{50};
+        static constexpr u32 MediumPriority{100};
+        static constexpr u32 HighPriority{150};
     };
 }
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "gpfifo_capture.h"
+
+namespace skyline::soc::gm20b {
+    GpfifoCapture::GpfifoCapture(const std::string &path) : fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) {
+        if (fd < 0)
+            throw exception("Failed to open GPFIFO capture file '{}': {}", path, strerror(errno));
+
+        buffer.reserve(FlushThreshold);
+        FileHeader header{};
+        buffer.insert(buffer.end(), reinterpret_cast<u8 *>(&header), reinterpret_cast<u8 *>(&header) + sizeof(FileHeader));
+    }
+
+    GpfifoCapture::~GpfifoCapture() {
+        Flush();
+        close(fd);
+    }
+
+    void GpfifoCapture::Flush() {
+        for (size_t offset{}; offset < buffer.size();) {
+            auto written{write(fd, buffer.data() + offset, buffer.size() - offset)};
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                Logger::Warn("Failed to write to GPFIFO capture: {}", strerror(errno));
+                break;
+            }
+            offset += static_cast<size_t>(written);
+        }
+        buffer.clear();
+    }
+
+    void GpfifoCapture::Record(u64 entry, span<const u32> pushBuffer) {
+        buffer.insert(buffer.end(), reinterpret_cast<u8 *>(&entry), reinterpret_cast<u8 *>(&entry) + sizeof(entry));
+        auto bytes{pushBuffer.cast<const u8>()};
+        buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+
+        if (buffer.size() >= FlushThreshold)
+            Flush();
+    }
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::soc::gm20b {
+    /**
+     * @brief Records every GpEntry processed by a channel alongside the pushbuffer words it references into a file, these can be replayed against the GPFIFO and engines to measure the throughput of pushbuffer decoding in isolation
+     * @note Macro uploads and all other method arguments are inline in the pushbuffer so they're contained in the capture, any memory that methods reference indirectly is not
+     */
+    class GpfifoCapture {
+      public:
+        /**
+         * @brief The header at the start of a capture file, it's followed by a sequence of records which are a raw GpEntry (u64) followed by the pushbuffer words it references (u32)
+         */
+        struct FileHeader {
+            u32 magic{util::MakeMagic<u32>("GCAP")};
+            u32 version{1};
+        };
+
+      private:
+        static constexpr size_t FlushThreshold{4 * 1024 * 1024}; //!< The amount of bytes that are buffered before they're written out to the file
+
+        int fd;
+        std::vector<u8> buffer; //!< Records which haven't been written to the file yet
+
+        void Flush();
+
+      public:
+        /**
+         * @param path The path of the capture file, any existing file is overwritten
+         */
+        GpfifoCapture(const std::string &path);
+
+        ~GpfifoCapture();
+
+        /**
+         * @brief Appends a GpEntry and its pushbuffer contents to the capture
+         * @param entry The raw value of the GpEntry
+         */
+        void Record(u64 entry, span<const u32> pushBuffer);
+    };
+}
@@ -19,5 +19,14 @@ namespace skyline::soc::host1x {
         Host1xClass(SyncpointSet &syncpoints);
 
         void CallMethod(u32 method, u32 argument);
+
+        /**
+         * @brief Calls a method with multiple arguments from a single opcode
+         * @param incrementing If the method should be incremented for each argument or if all arguments go to the same method
+         */
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing) {
+            for (size_t index{}; index < arguments.size(); index++)
+                CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index]);
+        }
     };
 }
@@ -7,7 +7,49 @@ namespace skyline::soc::host1x {
     NvDecClass::NvDecClass(std::function<void()> opDoneCallback)
         : opDoneCallback(std::move(opDoneCallback)) {}
 
+    void NvDecClass::Execute() {
+        Logger::Debug("NVDEC execute: codec: {}, picture info: 0x{:X}, bitstream: 0x{:X}, frame: {}, luma: 0x{:X}, chroma: 0x{:X}",
+                      static_cast<u32>(registers.codecId), ToAddress(registers.pictureInfoOffset), ToAddress(registers.bitstreamOffset), registers.frameNumber,
+                      ToAddress(registers.surfaceLumaOffsets[0]), ToAddress(registers.surfaceChromaOffsets[0]));
+
+        switch (registers.codecId) {
+            case CodecId::H264:
+            case CodecId::Vp8:
+            case CodecId::H265:
+            case CodecId::Vp9:
+                Logger::Warn("Decoding with NVDEC codec 0x{:X} isn't implemented", static_cast<u32>(registers.codecId));
+                break;
+            default:
+                Logger::Warn("Execute called on NVDEC with an invalid codec: 0x{:X}", static_cast<u32>(registers.codecId));
+                break;
+        }
+
+        // The guest must not be left waiting on the frame regardless of if it was decoded, it'll be shown as whatever the output surfaces already contained
+        opDoneCallback();
+    }
+
     void NvDecClass::CallMethod(u32 method, u32 argument) {
-        Logger::Warn("Unknown NVDEC class method called: 0x{:X} argument: 0x{:X}", method, argument);
+        if (method >= RegisterCount) {
+            Logger::Warn("Unknown NVDEC class method called: 0x{:X} argument: 0x{:X}", method, argument);
+            return;
+        }
+
+        registers.raw[method] = argument;
+
+        if (method == offsetof(Registers, execute) / sizeof(u32))
+            Execute();
+    }
+
+    void NvDecClass::CallMethodBatch(u32 method, span<u32> arguments, bool incrementing) {
+        constexpr u32 ExecuteMethod{offsetof(Registers, execute) / sizeof(u32)};
+        if (incrementing && method + arguments.size() <= RegisterCount && (method > ExecuteMethod || method + arguments.size() <= ExecuteMethod)) {
+            // The run doesn't cover Execute so we only need to update the registers
+            std::copy(arguments.begin(), arguments.end(), registers.raw.begin() + method);
+        } else if (!incrementing && method < RegisterCount && method != ExecuteMethod) {
+            registers.raw[method] = arguments.back(); // Only the last write persists as the register has no side effects
+        } else {
+            for (size_t index{}; index < arguments.size(); index++)
+                CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index]);
+        }
     }
 }
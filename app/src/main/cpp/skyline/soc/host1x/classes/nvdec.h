@@ -10,12 +10,76 @@ namespace skyline::soc::host1x {
      * @brief The NVDEC Host1x class implements hardware accelerated video decoding for the VP9/VP8/H264/VC1 codecs
      */
     class NvDecClass {
+      public:
+        static constexpr u32 RegisterCount{0x178}; //!< The number of NVDEC methods that can be called through the THI
+
+        /**
+         * @brief The codecs which can be selected through SetCodecId
+         */
+        enum class CodecId : u32 {
+            None = 0x0,
+            H264 = 0x3,
+            Vp8 = 0x5,
+            H265 = 0x7,
+            Vp9 = 0x9,
+        };
+
       private:
         std::function<void()> opDoneCallback;
 
+        /**
+         * @brief The NVDEC method interface, all offsets are SMMU addresses shifted right by 8 bits
+         */
+        #pragma pack(push, 1)
+        union Registers {
+            std::array<u32, RegisterCount> raw;
+
+            struct {
+                u32 _pad0_[0x80];
+                CodecId codecId; // 0x80
+                u32 _pad1_[0x3F];
+                u32 execute; // 0xC0
+                u32 _pad2_[0x3F];
+                u32 controlParams; // 0x100
+                u32 pictureInfoOffset; // 0x101
+                u32 bitstreamOffset; // 0x102
+                u32 frameNumber; // 0x103
+                u32 h264SliceDataOffsets; // 0x104
+                u32 h264MvDumpOffset; // 0x105
+                u32 _pad3_[0x3];
+                u32 frameStatsOffset; // 0x109
+                u32 h264LastSurfaceLumaOffset; // 0x10A
+                u32 h264LastSurfaceChromaOffset; // 0x10B
+                std::array<u32, 0x11> surfaceLumaOffsets; // 0x10C
+                std::array<u32, 0x11> surfaceChromaOffsets; // 0x11D
+            };
+        } registers{};
+        static_assert(sizeof(Registers) == (RegisterCount * sizeof(u32)));
+        static_assert(offsetof(Registers, execute) == (0xC0 * sizeof(u32)));
+        static_assert(offsetof(Registers, surfaceChromaOffsets) == (0x11D * sizeof(u32)));
+        #pragma pack(pop)
+
+        /**
+         * @return The SMMU address corresponding to an offset register
+         */
+        static constexpr u64 ToAddress(u32 offset) {
+            return static_cast<u64>(offset) << 8;
+        }
+
+        /**
+         * @brief Decodes a single frame using the state in the registers then reports the operation as done
+         */
+        void Execute();
+
       public:
         NvDecClass(std::function<void()> opDoneCallback);
 
         void CallMethod(u32 method, u32 argument);
+
+        /**
+         * @brief Calls a method with multiple arguments, the registers are written in bulk and only methods with side effects are handled individually
+         * @param incrementing If the method should be incremented for each argument or if all arguments go to the same method
+         */
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing);
     };
 }
@@ -7,7 +7,38 @@ namespace skyline::soc::host1x {
     VicClass::VicClass(std::function<void()> opDoneCallback)
         : opDoneCallback(std::move(opDoneCallback)) {}
 
+    void VicClass::Execute() {
+        Logger::Debug("VIC execute: config: 0x{:X}, output luma: 0x{:X}, output chroma: 0x{:X}",
+                      ToAddress(registers.configStructOffset), ToAddress(registers.outputSurfaceLumaOffset), ToAddress(registers.outputSurfaceChromaOffset));
+
+        Logger::Warn("VIC surface composition isn't implemented");
+
+        // The guest must not be left waiting on the composition regardless of it being performed
+        opDoneCallback();
+    }
+
     void VicClass::CallMethod(u32 method, u32 argument) {
-        Logger::Warn("Unknown VIC class method called: 0x{:X} argument: 0x{:X}", method, argument);
+        if (method >= RegisterCount) {
+            Logger::Warn("Unknown VIC class method called: 0x{:X} argument: 0x{:X}", method, argument);
+            return;
+        }
+
+        registers.raw[method] = argument;
+
+        if (method == offsetof(Registers, execute) / sizeof(u32))
+            Execute();
+    }
+
+    void VicClass::CallMethodBatch(u32 method, span<u32> arguments, bool incrementing) {
+        constexpr u32 ExecuteMethod{offsetof(Registers, execute) / sizeof(u32)};
+        if (incrementing && method + arguments.size() <= RegisterCount && (method > ExecuteMethod || method + arguments.size() <= ExecuteMethod)) {
+            // The run doesn't cover Execute so we only need to update the registers
+            std::copy(arguments.begin(), arguments.end(), registers.raw.begin() + method);
+        } else if (!incrementing && method < RegisterCount && method != ExecuteMethod) {
+            registers.raw[method] = arguments.back(); // Only the last write persists as the register has no side effects
+        } else {
+            for (size_t index{}; index < arguments.size(); index++)
+                CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index]);
+        }
     }
 }
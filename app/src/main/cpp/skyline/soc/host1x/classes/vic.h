@@ -10,12 +10,57 @@ namespace skyline::soc::host1x {
      * @brief The VIC Host1x class implements hardware accelerated image operations
      */
     class VicClass {
+      public:
+        static constexpr u32 RegisterCount{0x200}; //!< The number of VIC methods that can be called through the THI
+
       private:
         std::function<void()> opDoneCallback;
 
+        /**
+         * @brief The VIC method interface, all offsets are SMMU addresses shifted right by 8 bits
+         */
+        #pragma pack(push, 1)
+        union Registers {
+            std::array<u32, RegisterCount> raw;
+
+            struct {
+                u32 _pad0_[0xC0];
+                u32 execute; // 0xC0
+                u32 _pad1_[0x100];
+                u32 controlParams; // 0x1C1
+                u32 configStructOffset; // 0x1C2
+                u32 _pad2_[0x5];
+                u32 outputSurfaceLumaOffset; // 0x1C8
+                u32 outputSurfaceChromaOffset; // 0x1C9
+                u32 outputSurfaceChromaUnusedOffset; // 0x1CA
+            };
+        } registers{};
+        static_assert(sizeof(Registers) == (RegisterCount * sizeof(u32)));
+        static_assert(offsetof(Registers, configStructOffset) == (0x1C2 * sizeof(u32)));
+        static_assert(offsetof(Registers, outputSurfaceChromaUnusedOffset) == (0x1CA * sizeof(u32)));
+        #pragma pack(pop)
+
+        /**
+         * @return The SMMU address corresponding to an offset register
+         */
+        static constexpr u64 ToAddress(u32 offset) {
+            return static_cast<u64>(offset) << 8;
+        }
+
+        /**
+         * @brief Composites the configured slots into the output surface then reports the operation as done
+         */
+        void Execute();
+
       public:
         VicClass(std::function<void()> opDoneCallback);
 
         void CallMethod(u32 method, u32 argument);
+
+        /**
+         * @brief Calls a method with multiple arguments, the registers are written in bulk and only methods with side effects are handled individually
+         * @param incrementing If the method should be incremented for each argument or if all arguments go to the same method
+         */
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing);
     };
 }
@@ -2,6 +2,7 @@
 // Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <common/signal.h>
+#include <common/host_affinity.h>
 #include <loader/loader.h>
 #include <kernel/types/KProcess.h>
 #include <soc.h>
@@ -65,36 +66,66 @@ namespace skyline::soc::host1x {
         }
     }
 
+    void ChannelCommandFifo::SendBatch(ClassId targetClass, u32 method, span<u32> arguments, bool incrementing) {
+        Logger::Verbose("Calling method batch in class: 0x{:X}, method: 0x{:X}, count: {}, incrementing: {}", targetClass, method, arguments.size(), incrementing);
+
+        switch (targetClass) {
+            case ClassId::Host1x:
+                host1XClass.CallMethodBatch(method, arguments, incrementing);
+                break;
+            case ClassId::NvDec:
+                nvDecClass.CallMethodBatch(method, arguments, incrementing);
+                break;
+            case ClassId::VIC:
+                vicClass.CallMethodBatch(method, arguments, incrementing);
+                break;
+            default:
+                Logger::Error("Sending method batch to unimplemented class: 0x{:X}", targetClass);
+                break;
+        }
+    }
+
     void ChannelCommandFifo::Process(span<u32> gather) {
         ClassId targetClass{ClassId::Host1x};
 
-        for (auto entry{gather.begin()}; entry != gather.end(); entry++) {
-            ChannelCommandFifoMethodHeader methodHeader{.raw = *entry};
+        size_t index{};
+        auto getArguments{[&](size_t count) {
+            if (index + count > gather.size())
+                throw exception("Host1x command FIFO method arguments exceed the gather: 0x{:X} + 0x{:X} > 0x{:X}", index, count, gather.size());
+
+            auto arguments{gather.subspan(index, count)};
+            index += count;
+            return arguments;
+        }};
+
+        // Sends the arguments for every set bit in the mask to consecutive methods, runs of contiguous bits are sent as a single batch
+        auto sendMasked{[&](u32 method, u32 mask) {
+            while (mask) {
+                u32 offset{static_cast<u32>(std::countr_zero(mask))};
+                u32 count{static_cast<u32>(std::countr_one(mask >> offset))};
+                SendBatch(targetClass, method + offset, getArguments(count), true);
+                mask &= ~(((1U << count) - 1) << offset);
+            }
+        }};
+
+        while (index < gather.size()) {
+            ChannelCommandFifoMethodHeader methodHeader{.raw = gather[index++]};
 
             switch (methodHeader.opcode) {
                 case Host1xOpcode::SetClass:
                     targetClass = methodHeader.classId;
-
-                    for (u32 i{}; i < std::numeric_limits<u8>::max(); i++)
-                        if (methodHeader.classMethodMask & (1 << i))
-                            Send(targetClass, methodHeader.methodAddress + i, *++entry);
-
+                    sendMasked(methodHeader.methodAddress, methodHeader.classMethodMask);
                     break;
                 case Host1xOpcode::Incr:
-                    for (u32 i{}; i < methodHeader.methodCount; i++)
-                        Send(targetClass, methodHeader.methodAddress + i, *++entry);
-
+                    if (methodHeader.methodCount)
+                        SendBatch(targetClass, methodHeader.methodAddress, getArguments(methodHeader.methodCount), true);
                     break;
                 case Host1xOpcode::NonIncr:
-                    for (u32 i{}; i < methodHeader.methodCount; i++)
-                        Send(targetClass, methodHeader.methodAddress, *++entry);
-
+                    if (methodHeader.methodCount)
+                        SendBatch(targetClass, methodHeader.methodAddress, getArguments(methodHeader.methodCount), false);
                     break;
                 case Host1xOpcode::Mask:
-                    for (u32 i{}; i < std::numeric_limits<u16>::digits; i++)
-                        if (methodHeader.offsetMask & (1 << i))
-                            Send(targetClass, methodHeader.methodAddress + i, *++entry);
-
+                    sendMasked(methodHeader.methodAddress, methodHeader.offsetMask);
                     break;
                 case Host1xOpcode::Imm:
                     Send(targetClass, methodHeader.methodAddress, methodHeader.immdData);
@@ -114,6 +145,7 @@ namespace skyline::soc::host1x {
 
     void ChannelCommandFifo::Run() {
         pthread_setname_np(pthread_self(), "ChannelCommandFifo");
+        HostAffinity::PinCurrentThread(HostAffinity::ThreadClass::Emulation);
         try {
             signal::SetSignalHandler({SIGINT, SIGILL, SIGTRAP, SIGBUS, SIGFPE, SIGSEGV}, signal::ExceptionalSignalHandler);
 
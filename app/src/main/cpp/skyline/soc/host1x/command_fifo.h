@@ -4,7 +4,7 @@
 #pragma once
 
 #include <common.h>
-#include <common/circular_queue.h>
+#include <common/mpmc_queue.h>
 #include "syncpoint.h"
 #include "classes/class.h"
 #include "classes/host1x.h"
@@ -22,7 +22,7 @@ namespace skyline::soc::host1x {
         const DeviceState &state;
 
         static constexpr size_t GatherQueueSize{0x1000}; //!< Maximum size of the gather queue, this value is arbritary
-        CircularQueue<span<u32>> gatherQueue;
+        MpmcQueue<span<u32>> gatherQueue; //!< Gathers pushed by any thread submitting to the channel which are pending processing
         std::thread thread; //!< The thread that manages processing of pushbuffers within gathers
         std::mutex threadStartMutex; //!< Protects the thread from being started multiple times
 
@@ -35,6 +35,12 @@ namespace skyline::soc::host1x {
          */
         void Send(ClassId targetClass, u32 method, u32 argument);
 
+        /**
+         * @brief Sends the arguments of a single opcode to the target class, the class is only resolved once for all of them
+         * @param incrementing If the method should be incremented for each argument or if all arguments go to the same method
+         */
+        void SendBatch(ClassId targetClass, u32 method, span<u32> arguments, bool incrementing);
+
         /**
          * @brief Processes the pushbuffer contained within the given gather, calling methods as needed
          */
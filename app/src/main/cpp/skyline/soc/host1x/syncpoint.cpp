@@ -2,9 +2,90 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 // Copyright © 2020 Ryujinx Team and Contributors
 
+#include <common/flight_recorder.h>
+#include <common/trace.h>
 #include "syncpoint.h"
 
 namespace skyline::soc::host1x {
+    /**
+     * @brief Moves the waiter at the supplied index towards the root of the heap till its parent has a lower or equal threshold
+     */
+    template<typename WaiterType>
+    static void SiftUp(std::vector<WaiterType *> &heap, size_t index) {
+        auto waiter{heap[index]};
+        while (index) {
+            size_t parent{(index - 1) / 2};
+            if (heap[parent]->threshold <= waiter->threshold)
+                break;
+
+            heap[index] = heap[parent];
+            heap[index]->heapIndex = index;
+            index = parent;
+        }
+
+        heap[index] = waiter;
+        waiter->heapIndex = index;
+    }
+
+    /**
+     * @brief Moves the waiter at the supplied index towards the leaves of the heap till both of its children have a higher or equal threshold
+     */
+    template<typename WaiterType>
+    static void SiftDown(std::vector<WaiterType *> &heap, size_t index) {
+        auto waiter{heap[index]};
+        while (true) {
+            size_t child{(index * 2) + 1};
+            if (child >= heap.size())
+                break;
+
+            if (child + 1 < heap.size() && heap[child + 1]->threshold < heap[child]->threshold)
+                child++;
+
+            if (waiter->threshold <= heap[child]->threshold)
+                break;
+
+            heap[index] = heap[child];
+            heap[index]->heapIndex = index;
+            index = child;
+        }
+
+        heap[index] = waiter;
+        waiter->heapIndex = index;
+    }
+
+    static std::atomic<i64> totalWaiterCount{}; //!< The amount of waiters queued across all syncpoints, this is only used for tracing
+
+    /**
+     * @brief Adjusts the total waiter count by the supplied amount and emits the updated value to the trace
+     */
+    static void UpdateWaiterCount(i64 delta) {
+        TRACE_COUNTER("gpu", "Syncpoint Waiters", totalWaiterCount.fetch_add(delta, std::memory_order_relaxed) + delta);
+    }
+
+    void Syncpoint::PushWaiter(Waiter *waiter) {
+        waiters.push_back(waiter);
+        SiftUp(waiters, waiters.size() - 1);
+        nextThreshold.store(waiters.front()->threshold);
+        UpdateWaiterCount(1);
+    }
+
+    void Syncpoint::EraseWaiter(Waiter *waiter) {
+        size_t index{waiter->heapIndex};
+        waiter->heapIndex = Waiter::NotQueued;
+
+        auto last{waiters.back()};
+        waiters.pop_back();
+        if (last != waiter) {
+            // Fill the hole with the last waiter and restore the heap property around it, it can only need to move in one direction
+            waiters[index] = last;
+            SiftUp(waiters, index);
+            SiftDown(waiters, last->heapIndex);
+        }
+
+        nextThreshold.store(waiters.empty() ? std::numeric_limits<u32>::max() : waiters.front()->threshold);
+        UpdateWaiterCount(-1);
+    }
+
     Syncpoint::WaiterHandle Syncpoint::RegisterWaiter(u32 threshold, const std::function<void()> &callback) {
         if (value.load(std::memory_order_acquire) >= threshold) {
             // (Fast path) We don't need to wait on the mutex and can just get away with atomics
@@ -12,68 +93,98 @@ namespace skyline::soc::host1x {
             return {};
         }
 
-        std::scoped_lock lock(mutex);
-        if (value.load(std::memory_order_acquire) >= threshold) {
-            callback();
-            return {};
+        auto waiter{std::make_shared<Waiter>(threshold, callback)};
+        {
+            std::scoped_lock lock(mutex);
+            waiter->self = waiter;
+            PushWaiter(waiter.get());
+
+            // An increment that raced with the insertion might not have observed the new nextThreshold, we need to dispatch the waiter ourselves in that case
+            // This relies on both sides using sequentially consistent operations as each one stores before loading what the other side stores
+            if (value.load() < threshold)
+                return waiter;
+
+            EraseWaiter(waiter.get());
+            waiter->self.reset();
         }
 
-        auto it{waiters.begin()};
-        while (it != waiters.end() && threshold >= it->threshold)
-            it++;
-        return waiters.emplace(it, threshold, callback);
+        callback();
+        return {};
     }
 
     void Syncpoint::DeregisterWaiter(WaiterHandle waiter) {
-        std::scoped_lock lock(mutex);
-        // We want to ensure the iterator still exists prior to erasing it
-        // Otherwise, if an invalid iterator was passed in then it could lead to UB
-        // It is important to avoid UB in that case since the deregister isn't called from a locked context
-        for (auto it{waiters.begin()}; it != waiters.end(); it++)
-            if (it == waiter)
-                waiters.erase(it);
+        if (!waiter)
+            return;
+
+        {
+            std::scoped_lock lock(mutex);
+            if (waiter->heapIndex != Waiter::NotQueued) {
+                EraseWaiter(waiter.get());
+                waiter->self.reset();
+                return;
+            }
+        }
+
+        // The waiter was already dequeued, we need to wait for its callback to finish as the caller may destroy anything it refers to after returning
+        while (waiter->dispatching.load(std::memory_order_acquire))
+            std::this_thread::yield();
     }
 
     u32 Syncpoint::Increment() {
-        auto readValue{value.fetch_add(1, std::memory_order_acq_rel) + 1}; // We don't want to constantly do redundant atomic loads
+        auto readValue{value.fetch_add(1) + 1}; // We don't want to constantly do redundant atomic loads
+        trace::FlightRecorder::Record(trace::FlightRecorder::EventType::FenceSignal, reinterpret_cast<u64>(this), readValue);
+        if (readValue < nextThreshold.load())
+            return readValue; // (Fast path) No waiter has been reached so we don't need to lock the mutex
 
-        std::scoped_lock lock(mutex);
+        boost::container::small_vector<std::shared_ptr<Waiter>, 8> reachedWaiters;
         bool signalCondition{};
-        auto it{waiters.begin()};
-        while (it != waiters.end() && readValue >= it->threshold) {
-            auto &waiter{*it};
-            if (waiter.callback)
-                waiter.callback();
-            else
-                signalCondition = true;
-            it++;
+        {
+            std::scoped_lock lock(mutex);
+            auto currentValue{value.load(std::memory_order_acquire)}; // Other increments may have occurred since ours, we can dispatch their waiters too
+            while (!waiters.empty() && currentValue >= waiters.front()->threshold) {
+                auto waiter{waiters.front()};
+                EraseWaiter(waiter);
+                if (waiter->callback) {
+                    waiter->dispatching.store(true, std::memory_order_relaxed);
+                    reachedWaiters.push_back(std::move(waiter->self));
+                } else {
+                    signalCondition = true;
+                }
+            }
         }
 
-        waiters.erase(waiters.begin(), it);
-
         if (signalCondition)
             incrementCondition.notify_all();
 
+        // Callbacks are run without the mutex held so they can't contend with other increments or registrations
+        for (const auto &waiter : reachedWaiters) {
+            waiter->callback();
+            waiter->dispatching.store(false, std::memory_order_release);
+        }
+
         return readValue;
     }
 
     bool Syncpoint::Wait(u32 threshold, std::chrono::steady_clock::duration timeout) {
         if (value.load(std::memory_order_acquire) >= threshold)
             // (Fast Path) We don't need to wait on the mutex and can just get away with atomics
-            return {};
+            return true;
 
+        Waiter waiter{threshold, nullptr};
         std::unique_lock lock(mutex);
-        auto it{waiters.begin()};
-        while (it != waiters.end() && threshold >= it->threshold)
-            it++;
-        waiters.emplace(it, threshold, nullptr);
+        PushWaiter(&waiter);
 
-        if (timeout == std::chrono::steady_clock::duration::max()) {
-            incrementCondition.wait(lock, [&] { return value.load(std::memory_order_relaxed) >= threshold; });
-            return true;
-        } else {
-            return incrementCondition.wait_for(lock, timeout, [&] { return value.load(std::memory_order_relaxed) >= threshold; });
-        }
+        auto predicate{[&] { return value.load() >= threshold; }};
+        bool reached{true};
+        if (timeout == std::chrono::steady_clock::duration::max())
+            incrementCondition.wait(lock, predicate);
+        else
+            reached = incrementCondition.wait_for(lock, timeout, predicate);
+
+        // The waiter will still be queued if the predicate was satisfied without an increment dequeuing it or the wait timed out
+        if (waiter.heapIndex != Waiter::NotQueued)
+            EraseWaiter(&waiter);
+
+        return reached;
     }
 }
-
@@ -19,14 +19,37 @@ namespace skyline::soc::host1x {
         std::mutex mutex; //!< Synchronizes insertions and deletions of waiters alongside locking the increment condition
         std::condition_variable incrementCondition; //!< Signalled on thresholds for waiters which are tied to Wait(...)
 
+        /**
+         * @brief A single waiter on the syncpoint, these are intrusively tracked by a min-heap ordered by their threshold
+         */
         struct Waiter {
+            static constexpr size_t NotQueued{std::numeric_limits<size_t>::max()};
+
             u32 threshold; //!< The syncpoint value to wait on to be reached
             std::function<void()> callback; //!< The callback to do after the wait has ended, refers to cvar signal when nullptr
+            size_t heapIndex{NotQueued}; //!< The index of the waiter in the heap, NotQueued if it isn't in the heap
+            std::shared_ptr<Waiter> self; //!< A reference to the waiter held while it's in the heap, this is moved out when it's dequeued for dispatch
+            std::atomic<bool> dispatching{}; //!< If the callback has been dequeued but has not finished running yet
 
             Waiter(u32 threshold, std::function<void()> callback) : threshold(threshold), callback(std::move(callback)) {}
         };
-        std::list<Waiter> waiters; //!< A linked list of all waiters, it's sorted in ascending order by threshold
 
+        std::vector<Waiter *> waiters; //!< A binary min-heap of all queued waiters, ordered by their threshold
+        std::atomic<u32> nextThreshold{std::numeric_limits<u32>::max()}; //!< The lowest threshold of any queued waiter, increments below this don't need to lock the mutex
+
+        /**
+         * @brief Inserts a waiter into the heap and updates nextThreshold
+         * @note 'mutex' **must** be locked prior to calling this
+         */
+        void PushWaiter(Waiter *waiter);
+
+        /**
+         * @brief Removes a queued waiter from the heap and updates nextThreshold
+         * @note 'mutex' **must** be locked prior to calling this
+         */
+        void EraseWaiter(Waiter *waiter);
+
+      public:
       public:
         /**
          * @return The value of the syncpoint, retrieved in an atomically safe manner
@@ -35,7 +58,7 @@ namespace skyline::soc::host1x {
             return value.load(std::memory_order_acquire);
         }
 
-        using WaiterHandle = decltype(waiters)::iterator; //!< Aliasing an iterator to a Waiter as an opaque handle
+        using WaiterHandle = std::shared_ptr<Waiter>; //!< An opaque handle to a registered waiter
 
         /**
          * @brief Registers a new waiter with a callback that will be called when the syncpoint reaches the target threshold
@@ -46,11 +69,13 @@ namespace skyline::soc::host1x {
 
         /**
          * @note If the supplied handle is invalid then the function will do nothing
+         * @note If the callback is concurrently being run then this will block till it has returned, it must not be called from within the callback
          */
         void DeregisterWaiter(WaiterHandle waiter);
 
         /**
          * @return The new value of the syncpoint after the increment
+         * @note This is lock-free unless a waiter is reached, callbacks of any reached waiters are run on the calling thread
          */
         u32 Increment();
 
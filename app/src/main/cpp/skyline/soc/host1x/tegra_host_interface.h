@@ -18,6 +18,9 @@ namespace skyline::soc::host1x {
         SyncpointSet &syncpoints;
         ClassType deviceClass; //!< The device class behind the THI, such as NVDEC or VIC
 
+        static constexpr u32 Method0MethodId{0x10}; //!< Sets the method to be called on the device class upon a call to Method1, see TRM '15.5.6 NV_PVIC_THI_METHOD0'
+        static constexpr u32 Method1MethodId{0x11}; //!< Calls the method set by Method1 with the supplied argument, see TRM '15.5.7 NV_PVIC_THI_METHOD1"
+
         u32 storedMethod{}; //!< Method that will be used for deviceClass.CallMethod, set using Method0
 
         std::queue<u32> incrQueue; //!< Queue of syncpoint IDs to be incremented when a device operation is finished, the same syncpoint may be held multiple times within the queue
@@ -41,9 +44,6 @@ namespace skyline::soc::host1x {
               syncpoints(syncpoints) {}
 
         void CallMethod(u32 method, u32 argument)  {
-            constexpr u32 Method0MethodId{0x10}; //!< Sets the method to be called on the device class upon a call to Method1, see TRM '15.5.6 NV_PVIC_THI_METHOD0'
-            constexpr u32 Method1MethodId{0x11}; //!< Calls the method set by Method1 with the supplied argument, see TRM '15.5.7 NV_PVIC_THI_METHOD1"
-
             switch (method) {
                 case IncrementSyncpointMethodId: {
                     IncrementSyncpointMethod incrSyncpoint{.raw = argument};
@@ -55,9 +55,14 @@ namespace skyline::soc::host1x {
                             break;
                         case IncrementSyncpointMethod::Condition::OpDone:
                             Logger::Debug("Queue syncpoint for OpDone: {}", incrSyncpoint.index);
-                            incrQueue.push(incrSyncpoint.index);
+                            {
+                                std::scoped_lock lock(incrMutex);
+                                incrQueue.push(incrSyncpoint.index);
+                            }
 
-                            SubmitPendingIncrs(); // FIXME: immediately submit the incrs as classes are not yet implemented
+                            // All classes execute their operations synchronously in CallMethod, so any operation prior to this has already been reported as done
+                            SubmitPendingIncrs();
+                            break;
                         default:
                             Logger::Warn("Unimplemented syncpoint condition: {}", static_cast<u8>(incrSyncpoint.condition));
                             break;
@@ -75,5 +80,19 @@ namespace skyline::soc::host1x {
                     break;
             }
         }
+
+        /**
+         * @brief Calls a method with multiple arguments from a single opcode, repeated Method1 calls are passed to the device class in bulk
+         * @param incrementing If the method should be incremented for each argument or if all arguments go to the same method
+         */
+        void CallMethodBatch(u32 method, span<u32> arguments, bool incrementing) {
+            if (!incrementing && method == Method1MethodId) {
+                deviceClass.CallMethodBatch(storedMethod, arguments, false);
+                return;
+            }
+
+            for (size_t index{}; index < arguments.size(); index++)
+                CallMethod(incrementing ? method + static_cast<u32>(index) : method, arguments[index]);
+        }
     };
 }
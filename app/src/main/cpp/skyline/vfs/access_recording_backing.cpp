@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/trace.h>
+#include "os_filesystem.h"
+#include "access_recording_backing.h"
+
+namespace skyline::vfs {
+    AccessRecordingBacking::AccessRecordingBacking(std::shared_ptr<Backing> pBacking, const std::string &recordPath, u64 titleId, size_t sectorCacheSize)
+        : Backing(pBacking->mode, pBacking->size),
+          backing(std::move(pBacking)),
+          name(fmt::format("{:016X}.bin", titleId)),
+          maxPages(sectorCacheSize / PageSize),
+          recordEnd(std::chrono::steady_clock::now() + RecordDuration) {
+        try {
+            recordFileSystem = std::make_shared<OsFileSystem>(recordPath);
+        } catch (const std::exception &e) {
+            Logger::Warn("I/O access records are unavailable: {}", e.what());
+            recording = false;
+            return;
+        }
+
+        try {
+            if (recordFileSystem->FileExists(name)) {
+                auto recordBacking{recordFileSystem->OpenFile(name)};
+                auto header{recordBacking->Read<RecordHeader>()};
+                if (header.magic != RecordHeader{}.magic || header.backingSize != size || header.pageCount * sizeof(u32) != recordBacking->size - sizeof(RecordHeader)) {
+                    Logger::Info("Discarding I/O access record for a different backing: {}", name);
+                } else {
+                    std::vector<u32> prefetchPages(std::min<size_t>(header.pageCount, maxPages));
+                    recordBacking->Read(span(prefetchPages), sizeof(RecordHeader));
+                    Logger::Info("Prefetching {} pages from I/O access record {}", prefetchPages.size(), name);
+                    prefetchThread = std::thread(&AccessRecordingBacking::PrefetchThread, this, std::move(prefetchPages));
+                }
+            }
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to read I/O access record {}: {}", name, e.what());
+        }
+    }
+
+    AccessRecordingBacking::~AccessRecordingBacking() {
+        exiting = true;
+        if (prefetchThread.joinable())
+            prefetchThread.join();
+
+        if (recording.exchange(false))
+            Save();
+    }
+
+    void AccessRecordingBacking::PrefetchThread(std::vector<u32> prefetchPages) {
+        pthread_setname_np(pthread_self(), "IoPrefetch");
+        TRACE_EVENT("service", "AccessRecordingBacking::Prefetch", "pages", prefetchPages.size());
+
+        std::vector<u8> buffer(PageSize);
+        for (u32 page : prefetchPages) {
+            if (exiting)
+                return;
+
+            size_t offset{static_cast<size_t>(page) * PageSize};
+            if (offset >= size)
+                continue;
+
+            try {
+                backing->Read(span(buffer).first(std::min(PageSize, size - offset)), offset);
+            } catch (const std::exception &e) {
+                Logger::Warn("Failed to prefetch page 0x{:X}: {}", page, e.what());
+                return;
+            }
+        }
+    }
+
+    void AccessRecordingBacking::Record(size_t offset, size_t readSize) {
+        if (!recording || !readSize)
+            return;
+
+        if (std::chrono::steady_clock::now() >= recordEnd) {
+            if (recording.exchange(false))
+                Save();
+            return;
+        }
+
+        std::scoped_lock lock{mutex};
+        for (size_t page{offset / PageSize}, lastPage{(offset + readSize - 1) / PageSize}; page <= lastPage && pages.size() < maxPages; page++)
+            if (recordedPages.emplace(static_cast<u32>(page)).second)
+                pages.push_back(static_cast<u32>(page));
+    }
+
+    void AccessRecordingBacking::Save() {
+        std::scoped_lock lock{mutex};
+        if (!recordFileSystem || pages.empty())
+            return;
+
+        try {
+            RecordHeader header{
+                .backingSize = size,
+                .pageCount = static_cast<u32>(pages.size()),
+            };
+
+            std::vector<u8> buffer(sizeof(RecordHeader) + (pages.size() * sizeof(u32)));
+            std::memcpy(buffer.data(), &header, sizeof(RecordHeader));
+            std::memcpy(buffer.data() + sizeof(RecordHeader), pages.data(), pages.size() * sizeof(u32));
+
+            if (!recordFileSystem->CreateFile(name, buffer.size()))
+                throw exception("Failed to create file");
+            recordFileSystem->OpenFile(name, {false, true, false})->Write(buffer);
+            Logger::Info("Saved {} pages to I/O access record {}", pages.size(), name);
+        } catch (const std::exception &e) {
+            Logger::Warn("Failed to write I/O access record {}: {}", name, e.what());
+        }
+    }
+
+    size_t AccessRecordingBacking::ReadImpl(span<u8> output, size_t offset) {
+        Record(offset, output.size());
+        return backing->ReadUnchecked(output, offset);
+    }
+
+    span<u8> AccessRecordingBacking::ReadViewImpl(size_t offset, size_t viewSize) {
+        auto view{backing->ReadView(offset, viewSize)};
+        if (!view.empty())
+            Record(offset, viewSize);
+        return view;
+    }
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <unordered_set>
+#include "filesystem.h"
+#include "sector_cache.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The AccessRecordingBacking class records which pages of a backing are read at the start of a session and prefetches the pages recorded during the prior session of the same title in the background
+     * @note Prefetching works by reading pages through the underlying backing so its sector cache is populated ahead of the guest, it has no effect on backings without a sector cache
+     */
+    class AccessRecordingBacking : public Backing {
+      private:
+        /**
+         * @brief The header of a record file, it's followed by the indices of all recorded pages in the order they were first read
+         */
+        struct RecordHeader {
+            u64 magic{util::MakeMagic<u64>("SKYIOREC")};
+            u64 backingSize; //!< The size of the backing when it was recorded, records for a backing of a different size are discarded
+            u32 pageCount;
+            u32 _pad_;
+        };
+
+        static constexpr size_t PageSize{SectorCache::PageSize};
+        static constexpr std::chrono::seconds RecordDuration{90}; //!< The duration from the start of a session for which reads are recorded, this covers the boot sequence and initial loading screens
+
+        std::shared_ptr<Backing> backing;
+        std::shared_ptr<vfs::FileSystem> recordFileSystem; //!< The filesystem containing the record file, this is nullptr if records are unavailable
+        std::string name; //!< The name of the record file in the filesystem
+        size_t maxPages; //!< The maximum amount of pages that are recorded, this is the capacity of the sector cache as any further prefetched pages would evict earlier ones
+
+        std::mutex mutex; //!< Synchronizes recording pages
+        std::vector<u32> pages; //!< The indices of all recorded pages in the order they were first read
+        std::unordered_set<u32> recordedPages; //!< A set of all recorded pages to avoid duplicate entries
+        std::chrono::steady_clock::time_point recordEnd; //!< The point in time after which reads are no longer recorded
+        std::atomic<bool> recording{true};
+
+        std::atomic<bool> exiting{}; //!< If the prefetch thread should stop prefetching
+        std::thread prefetchThread;
+
+        void PrefetchThread(std::vector<u32> prefetchPages);
+
+        /**
+         * @brief Records all pages touched by a read and stops recording once the recording duration has elapsed
+         */
+        void Record(size_t offset, size_t size);
+
+        /**
+         * @brief Writes the recorded pages to disk, this replaces the record of the prior session
+         */
+        void Save();
+
+      protected:
+        size_t ReadImpl(span<u8> output, size_t offset) override;
+
+        span<u8> ReadViewImpl(size_t offset, size_t size) override;
+
+      public:
+        /**
+         * @param recordPath The path to the directory in which records are stored
+         * @param titleId The ID of the title the backing belongs to
+         * @param sectorCacheSize The capacity of the sector cache which backs the supplied backing in bytes
+         */
+        AccessRecordingBacking(std::shared_ptr<Backing> backing, const std::string &recordPath, u64 titleId, size_t sectorCacheSize);
+
+        /**
+         * @note The recorded pages are saved if recording hadn't finished yet
+         */
+        ~AccessRecordingBacking();
+    };
+}
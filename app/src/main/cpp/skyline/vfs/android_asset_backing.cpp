@@ -27,4 +27,14 @@ namespace skyline::vfs {
 
         return static_cast<size_t>(result);
     }
+
+    span<u8> AndroidAssetBacking::ReadViewImpl(size_t offset, size_t size) {
+        if (!buffer) {
+            buffer = static_cast<u8 *>(const_cast<void *>(AAsset_getBuffer(asset)));
+            if (!buffer)
+                return {};
+        }
+
+        return {buffer + offset, size};
+    }
 }
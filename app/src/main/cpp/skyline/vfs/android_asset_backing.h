@@ -16,10 +16,13 @@ namespace skyline::vfs {
     class AndroidAssetBacking : public Backing {
       private:
         AAsset *asset; //!< The NDK AAsset object we abstract
+        u8 *buffer{}; //!< The entire contents of the asset, this is only retrieved on the first view as it may require decompressing the asset into memory
 
       protected:
         size_t ReadImpl(span<u8> output, size_t offset) override;
 
+        span<u8> ReadViewImpl(size_t offset, size_t size) override;
+
       public:
         AndroidAssetBacking(AAsset *asset, Mode mode = {true, false, false});
 
@@ -14,6 +14,10 @@ namespace skyline::vfs {
       protected:
         virtual size_t ReadImpl(span <u8> output, size_t offset) = 0;
 
+        virtual span<u8> ReadViewImpl(size_t offset, size_t size) {
+            return {};
+        }
+
         virtual size_t WriteImpl(span <u8> input, size_t offset) {
             throw exception("This backing does not support being written to");
         }
@@ -22,6 +26,8 @@ namespace skyline::vfs {
             throw exception("This backing does not support being resized");
         }
 
+        virtual void FlushImpl() {}
+
       public:
         union Mode {
             struct {
@@ -80,6 +86,23 @@ namespace skyline::vfs {
             return size;
         };
 
+        /**
+         * @brief Borrows a view of bytes in the backing without copying them, this is only supported by backings which have their contents resident in memory
+         * @param offset The offset to start the view at
+         * @param viewSize The size of the view
+         * @return A view which is valid for the lifetime of the backing or an empty span if the backing doesn't support views, in which case Read must be used
+         * @note The view must not be written to as it may be backed by read-only memory
+         */
+        span<u8> ReadView(size_t offset, size_t viewSize) {
+            if (!mode.read)
+                throw exception("Attempting to read a backing that is not readable");
+
+            if (offset > size || (size - offset) < viewSize)
+                throw exception("Trying to view past the end of a backing: 0x{:X}/0x{:X} (Offset: 0x{:X})", viewSize, size, offset);
+
+            return ReadViewImpl(offset, viewSize);
+        }
+
         /**
          * @brief Implicit casting for reading into spans of different types
          */
@@ -139,5 +162,12 @@ namespace skyline::vfs {
         void Resize(size_t pSize) {
             ResizeImpl(pSize);
         }
+
+        /**
+         * @brief Writes any data buffered by the backing out to its underlying storage
+         */
+        void Flush() {
+            FlushImpl();
+        }
     };
 }
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <lz4.h>
+#include <lz4hc.h>
+#include "compressed_backing.h"
+
+namespace skyline::vfs {
+    CompressedBacking::CompressedBacking(std::shared_ptr<Backing> pBacking) : Backing({true, false, false}), backing(std::move(pBacking)) {
+        header = backing->Read<ImageHeader>();
+        if (header.magic != ImageHeader{}.magic || header.version != ImageHeader{}.version)
+            throw exception("Invalid compressed image header");
+        if (!header.blockSize || header.blockSize > LZ4_MAX_INPUT_SIZE)
+            throw exception("Invalid compressed image block size: 0x{:X}", header.blockSize);
+
+        // The bounds are checked without any arithmetic that a corrupted header could overflow
+        size_t blockCount{(header.imageSize / header.blockSize) + ((header.imageSize % header.blockSize) ? 1 : 0)};
+        if (header.seekTableOffset > backing->size || blockCount >= (backing->size - header.seekTableOffset) / sizeof(u64))
+            throw exception("Compressed image seek table is out of bounds");
+
+        seekTable.resize(blockCount + 1);
+        backing->Read(span(seekTable), header.seekTableOffset);
+
+        // Every read trusts the seek table, blocks must be laid out in order between the header and the seek table and can't be larger than they are uncompressed
+        if (seekTable.front() < sizeof(ImageHeader) || seekTable.back() > header.seekTableOffset)
+            throw exception("Compressed image blocks are out of bounds: 0x{:X} - 0x{:X}", seekTable.front(), seekTable.back());
+        for (size_t index{}; index < blockCount; index++)
+            if (seekTable[index + 1] < seekTable[index] || seekTable[index + 1] - seekTable[index] > GetBlockSize(index))
+                throw exception("Compressed image seek table entry for block {} is invalid: 0x{:X} - 0x{:X}", index, seekTable[index], seekTable[index + 1]);
+        size = header.imageSize;
+    }
+
+    std::shared_ptr<Backing> CompressedBacking::Open(std::shared_ptr<Backing> backing) {
+        if (backing->size >= sizeof(ImageHeader) && backing->Read<u64>() == ImageHeader{}.magic)
+            return std::make_shared<CompressedBacking>(std::move(backing));
+        return backing;
+    }
+
+    size_t CompressedBacking::GetBlockSize(size_t index) const {
+        return std::min<size_t>(header.blockSize, header.imageSize - (index * header.blockSize));
+    }
+
+    void CompressedBacking::DecompressBlock(size_t index, span<u8> output) {
+        size_t blockSize{GetBlockSize(index)};
+        size_t compressedOffset{seekTable[index]}, compressedSize{seekTable[index + 1] - seekTable[index]};
+
+        // Blocks which don't compress are stored as-is, they're the only ones which have a compressed size equal to their uncompressed size
+        if (compressedSize == blockSize) {
+            backing->Read(output.first(blockSize), compressedOffset);
+            return;
+        }
+
+        std::vector<u8> compressedBuffer;
+        auto compressed{backing->ReadView(compressedOffset, compressedSize)};
+        if (compressed.empty()) {
+            compressedBuffer.resize(compressedSize);
+            backing->Read(span(compressedBuffer), compressedOffset);
+            compressed = compressedBuffer;
+        }
+
+        auto decompressedSize{LZ4_decompress_safe(reinterpret_cast<const char *>(compressed.data()), reinterpret_cast<char *>(output.data()), static_cast<int>(compressedSize), static_cast<int>(blockSize))};
+        if (decompressedSize != static_cast<int>(blockSize))
+            throw exception("Failed to decompress block {}: {}", index, decompressedSize);
+    }
+
+    size_t CompressedBacking::ReadImpl(span<u8> output, size_t offset) {
+        if (offset >= size)
+            return 0;
+        output = output.first(std::min(output.size(), size - offset));
+
+        size_t blockIndex{offset / header.blockSize}, blockOffset{offset % header.blockSize};
+        for (size_t outputOffset{}; outputOffset < output.size(); blockIndex++, blockOffset = 0) {
+            size_t blockSize{GetBlockSize(blockIndex)};
+            size_t copySize{std::min(blockSize - blockOffset, output.size() - outputOffset)};
+            auto blockOutput{output.subspan(outputOffset, copySize)};
+
+            if (copySize == blockSize) {
+                // Entire blocks are decompressed straight into the output without going through the cache
+                DecompressBlock(blockIndex, blockOutput);
+            } else {
+                std::scoped_lock lock{mutex};
+                auto it{std::find_if(cachedBlocks.begin(), cachedBlocks.end(), [blockIndex](const CachedBlock &block) { return block.index == blockIndex; })};
+                if (it == cachedBlocks.end()) {
+                    std::vector<u8> data(blockSize);
+                    DecompressBlock(blockIndex, data);
+                    if (cachedBlocks.size() >= CachedBlockCount)
+                        cachedBlocks.pop_back();
+                    cachedBlocks.push_front(CachedBlock{blockIndex, std::move(data)});
+                } else if (it != cachedBlocks.begin()) {
+                    cachedBlocks.splice(cachedBlocks.begin(), cachedBlocks, it);
+                }
+
+                blockOutput.copy_from(span(cachedBlocks.front().data).subspan(blockOffset, copySize));
+            }
+
+            outputOffset += copySize;
+        }
+
+        return output.size();
+    }
+
+    void CompressedBacking::Compress(Backing &input, Backing &output, const std::function<void(size_t)> &progress, size_t blockSize) {
+        ImageHeader imageHeader{
+            .blockSize = static_cast<u32>(blockSize),
+            .imageSize = input.size,
+        };
+
+        size_t blockCount{(input.size + blockSize - 1) / blockSize};
+        std::vector<u64> outputSeekTable;
+        outputSeekTable.reserve(blockCount + 1);
+
+        std::vector<u8> block(blockSize), compressed(static_cast<size_t>(LZ4_compressBound(static_cast<int>(blockSize))));
+        size_t outputOffset{sizeof(ImageHeader)};
+        for (size_t index{}; index < blockCount; index++) {
+            size_t offset{index * blockSize}, currentSize{std::min(blockSize, input.size - offset)};
+            auto currentBlock{span(block).first(currentSize)};
+            input.Read(currentBlock, offset);
+
+            // Blocks are stored uncompressed if compression doesn't reduce their size at all
+            auto compressedSize{LZ4_compress_HC(reinterpret_cast<const char *>(currentBlock.data()), reinterpret_cast<char *>(compressed.data()), static_cast<int>(currentSize), static_cast<int>(compressed.size()), LZ4HC_CLEVEL_DEFAULT)};
+            outputSeekTable.push_back(outputOffset);
+            if (compressedSize > 0 && static_cast<size_t>(compressedSize) < currentSize)
+                outputOffset += output.Write(span(compressed).first(static_cast<size_t>(compressedSize)), outputOffset);
+            else
+                outputOffset += output.Write(currentBlock, outputOffset);
+
+            if (progress)
+                progress(offset + currentSize);
+        }
+        outputSeekTable.push_back(outputOffset);
+
+        imageHeader.seekTableOffset = outputOffset;
+        outputOffset += output.Write(span(outputSeekTable).cast<u8>(), outputOffset);
+        output.WriteObject(imageHeader, 0);
+
+        if (output.size > outputOffset)
+            output.Resize(outputOffset); // Any stale data from a previous image would otherwise trail the seek table
+    }
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The CompressedBacking class provides access to an image which is split into independently LZ4-compressed blocks, only the blocks touched by a read are decompressed
+     * @note The image starts with a header, it's followed by all blocks and a seek table containing the offset of every block and the end of the last one
+     */
+    class CompressedBacking : public Backing {
+      private:
+        struct ImageHeader {
+            u64 magic{util::MakeMagic<u64>("SKYCMPIM")};
+            u32 version{1};
+            u32 blockSize; //!< The uncompressed size of every block but the last one
+            u64 imageSize; //!< The uncompressed size of the image
+            u64 seekTableOffset; //!< The offset of the seek table which has an entry for every block and an entry for the end of the last block
+        };
+        static_assert(sizeof(ImageHeader) == 0x20);
+
+        static constexpr size_t DefaultBlockSize{0x10000}; //!< The block size used for compression, this balances the compression ratio against the amount of data decompressed for small reads
+        static constexpr size_t CachedBlockCount{8}; //!< The amount of most recently decompressed blocks that are kept around, this avoids decompressing a block again for sequential reads smaller than it
+
+        /**
+         * @brief A decompressed block, these are kept in a small LRU list
+         */
+        struct CachedBlock {
+            size_t index;
+            std::vector<u8> data;
+        };
+
+        std::shared_ptr<Backing> backing;
+        ImageHeader header;
+        std::vector<u64> seekTable;
+        std::mutex mutex; //!< Synchronizes access to the cached blocks
+        std::list<CachedBlock> cachedBlocks; //!< Recently decompressed blocks from the most to the least recently used
+
+        /**
+         * @return The uncompressed size of the block
+         */
+        size_t GetBlockSize(size_t index) const;
+
+        /**
+         * @brief Decompresses the block into the output which must be at least as large as the block
+         */
+        void DecompressBlock(size_t index, span<u8> output);
+
+      protected:
+        size_t ReadImpl(span<u8> output, size_t offset) override;
+
+      public:
+        CompressedBacking(std::shared_ptr<Backing> backing);
+
+        /**
+         * @return A CompressedBacking of the backing if it's a compressed image or the backing itself otherwise
+         */
+        static std::shared_ptr<Backing> Open(std::shared_ptr<Backing> backing);
+
+        /**
+         * @brief Writes a compressed image of the input backing to the output backing
+         * @param progress A callback with the amount of bytes of the input that have been compressed so far, it may be empty
+         */
+        static void Compress(Backing &input, Backing &output, const std::function<void(size_t)> &progress = {}, size_t blockSize = DefaultBlockSize);
+    };
+}
@@ -1,58 +1,125 @@
-// SPDX-License-Identifier: MPL-2.0
-// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
-
-#include "ctr_encrypted_backing.h"
-
-namespace skyline::vfs {
-    constexpr size_t SectorSize{0x10};
-
-    CtrEncryptedBacking::CtrEncryptedBacking(crypto::KeyStore::Key128 ctr, crypto::KeyStore::Key128 key, std::shared_ptr<Backing> backing, size_t baseOffset) : Backing({true, false, false}, backing->size), ctr(ctr), cipher(key, MBEDTLS_CIPHER_AES_128_CTR), backing(std::move(backing)), baseOffset(baseOffset) {
-        if (mode.write || mode.append)
-            throw exception("Cannot open a CtrEncryptedBacking as writable");
-    }
-
-    void CtrEncryptedBacking::UpdateCtr(u64 offset) {
-        offset >>= 4;
-        size_t le{util::SwapEndianness(offset)};
-        std::memcpy(ctr.data() + 8, &le, 8);
-        cipher.SetIV(ctr);
-    }
-
-    size_t CtrEncryptedBacking::ReadImpl(span<u8> output, size_t offset) {
-        size_t size{output.size()};
-        if (size == 0)
-            return 0;
-
-        size_t sectorOffset{offset % SectorSize};
-        if (sectorOffset == 0) {
-            size_t read{backing->ReadUnchecked(output, offset)};
-            if (read != size)
-                return 0;
-            {
-                std::lock_guard guard(mutex);
-                UpdateCtr(baseOffset + offset);
-                cipher.Decrypt(output);
-            }
-            return size;
-        }
-
-        size_t sectorStart{offset - sectorOffset};
-        std::vector<u8> blockBuf(SectorSize);
-        size_t read{backing->ReadUnchecked(blockBuf, sectorStart)};
-        if (read != SectorSize)
-            return 0;
-        {
-            std::lock_guard guard(mutex);
-            UpdateCtr(baseOffset + sectorStart);
-            cipher.Decrypt(blockBuf);
-        }
-        if (size + sectorOffset < SectorSize) {
-            std::memcpy(output.data(), blockBuf.data() + sectorOffset, size);
-            return size;
-        }
-
-        size_t readInBlock{SectorSize - sectorOffset};
-        std::memcpy(output.data(), blockBuf.data() + sectorOffset, readInBlock);
-        return readInBlock + ReadUnchecked(output.subspan(readInBlock), offset + readInBlock);
-    }
-}
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/thread_pool.h>
+#include "ctr_encrypted_backing.h"
+
+namespace skyline::vfs {
+    constexpr size_t SectorSize{0x10};
+    constexpr size_t ParallelChunkSize{0x40000}; //!< The size of a chunk of a parallel read which is read and decrypted by a single worker
+    constexpr size_t ParallelReadThreshold{ParallelChunkSize * 4}; //!< The minimum size of a read for it to be split into chunks
+
+    CtrEncryptedBacking::CtrEncryptedBacking(crypto::KeyStore::Key128 ctr, crypto::KeyStore::Key128 key, std::shared_ptr<Backing> backing, size_t baseOffset, std::shared_ptr<SectorCache> cache) : Backing({true, false, false}, backing->size), ctr(ctr), key(key), cipher(key, MBEDTLS_CIPHER_AES_128_CTR), backing(std::move(backing)), baseOffset(baseOffset), cache(std::move(cache)) {
+        if (mode.write || mode.append)
+            throw exception("Cannot open a CtrEncryptedBacking as writable");
+    }
+
+    crypto::KeyStore::Key128 CtrEncryptedBacking::GetCtr(u64 offset) const {
+        auto blockCtr{ctr};
+        offset >>= 4;
+        size_t le{util::SwapEndianness(offset)};
+        std::memcpy(blockCtr.data() + 8, &le, 8);
+        return blockCtr;
+    }
+
+    void CtrEncryptedBacking::UpdateCtr(u64 offset) {
+        cipher.SetIV(GetCtr(offset));
+    }
+
+    size_t CtrEncryptedBacking::DecryptParallel(span<u8> output, size_t offset) {
+        std::atomic<bool> failed{}; // If any chunk couldn't be read completely
+        ThreadPool::Get().ParallelFor(util::AlignUp(output.size(), ParallelChunkSize) / ParallelChunkSize, [&](size_t chunk) {
+            size_t chunkOffset{chunk * ParallelChunkSize};
+            auto chunkOutput{output.subspan(chunkOffset, std::min(ParallelChunkSize, output.size() - chunkOffset))};
+            if (backing->ReadUnchecked(chunkOutput, offset + chunkOffset) != chunkOutput.size()) {
+                failed.store(true, std::memory_order_relaxed);
+                return;
+            }
+
+            crypto::AesCipher chunkCipher(key, MBEDTLS_CIPHER_AES_128_CTR);
+            chunkCipher.SetIV(GetCtr(baseOffset + offset + chunkOffset));
+            chunkCipher.Decrypt(chunkOutput);
+        });
+        return failed.load(std::memory_order_relaxed) ? 0 : output.size();
+    }
+
+    size_t CtrEncryptedBacking::ReadImpl(span<u8> output, size_t offset) {
+        // Large reads are likely to be streaming data which won't be repeated and would evict hot pages from the cache, they're decrypted directly in parallel instead
+        if (cache && output.size() < std::min(cache->GetCapacity(), ParallelReadThreshold))
+            return ReadCached(output, offset);
+        return DecryptUncached(output, offset);
+    }
+
+    size_t CtrEncryptedBacking::ReadCached(span<u8> output, size_t offset) {
+        if (offset >= size)
+            return 0;
+        output = output.first(std::min(output.size(), size - offset));
+
+        size_t read{};
+        while (read < output.size()) {
+            size_t position{offset + read};
+            size_t pageStart{util::AlignDown(position, SectorCache::PageSize)};
+
+            auto page{cache->Lookup(baseOffset + pageStart)};
+            if (!page) {
+                std::vector<u8> data(std::min(SectorCache::PageSize, size - pageStart));
+                if (backing->ReadUnchecked(data, pageStart) != data.size())
+                    return read;
+                {
+                    std::lock_guard guard(mutex);
+                    UpdateCtr(baseOffset + pageStart);
+                    cipher.Decrypt(data);
+                }
+                page = cache->Insert(baseOffset + pageStart, std::move(data));
+            }
+
+            size_t pageOffset{position - pageStart};
+            size_t copySize{std::min(page->size() - pageOffset, output.size() - read)};
+            std::memcpy(output.data() + read, page->data() + pageOffset, copySize);
+            read += copySize;
+        }
+
+        return read;
+    }
+
+    size_t CtrEncryptedBacking::DecryptUncached(span<u8> output, size_t offset) {
+        size_t size{output.size()};
+        if (size == 0)
+            return 0;
+
+        size_t sectorOffset{offset % SectorSize};
+        if (sectorOffset == 0) {
+            if (size >= ParallelReadThreshold)
+                return DecryptParallel(output, offset);
+
+            size_t read{backing->ReadUnchecked(output, offset)};
+            if (read != size)
+                return 0;
+            {
+                std::lock_guard guard(mutex);
+                UpdateCtr(baseOffset + offset);
+                cipher.Decrypt(output);
+            }
+            return size;
+        }
+
+        size_t sectorStart{offset - sectorOffset};
+        std::array<u8, SectorSize> blockBuf;
+        size_t read{backing->ReadUnchecked(blockBuf, sectorStart)};
+        if (read != SectorSize)
+            return 0;
+        {
+            std::lock_guard guard(mutex);
+            UpdateCtr(baseOffset + sectorStart);
+            cipher.Decrypt(blockBuf);
+        }
+        if (size + sectorOffset < SectorSize) {
+            std::memcpy(output.data(), blockBuf.data() + sectorOffset, size);
+            return size;
+        }
+
+        size_t readInBlock{SectorSize - sectorOffset};
+        std::memcpy(output.data(), blockBuf.data() + sectorOffset, readInBlock);
+        return readInBlock + DecryptUncached(output.subspan(readInBlock), offset + readInBlock);
+    }
+}
@@ -6,6 +6,7 @@
 #include <crypto/aes_cipher.h>
 #include <crypto/key_store.h>
 #include "backing.h"
+#include "sector_cache.h"
 
 namespace skyline::vfs {
     /**
@@ -13,21 +14,48 @@ namespace skyline::vfs {
      */
     class CtrEncryptedBacking : public Backing {
       private:
-        crypto::KeyStore::Key128 ctr;
+        const crypto::KeyStore::Key128 ctr; //!< The base counter, it's never modified so GetCtr can be called concurrently without holding the mutex
+        crypto::KeyStore::Key128 key; //!< The key is retained to create ciphers for parallel decryption which each require their own counter state
         crypto::AesCipher cipher;
         std::shared_ptr<Backing> backing;
         std::mutex mutex; //!< Synchronize all AES-CTR cipher state modifications
         size_t baseOffset; //!< The offset of the backing into the file is used to calculate the IV
+        std::shared_ptr<SectorCache> cache; //!< An optional cache of decrypted pages shared with the other sections of the NCA
 
         /**
-         * @brief Calculates IV based on the offset
+         * @brief Decrypts data from the backing into the output directly
+         */
+        size_t DecryptUncached(span<u8> output, size_t offset);
+
+        /**
+         * @brief Reads data through the sector cache, decrypting and caching any pages that aren't cached
+         */
+        size_t ReadCached(span<u8> output, size_t offset);
+
+        /**
+         * @return The IV for the block at the supplied offset
+         */
+        crypto::KeyStore::Key128 GetCtr(u64 offset) const;
+
+        /**
+         * @brief Sets the IV of the shared cipher based on the offset
+         * @note The mutex **must** be locked prior to calling this
          */
         void UpdateCtr(u64 offset);
 
+        /**
+         * @brief Splits a large sector-aligned read into chunks which are read and decrypted concurrently by a pool of workers alongside the calling thread
+         * @note As chunks are claimed in order, I/O for upcoming chunks is in flight while earlier ones are being decrypted which keeps the storage busy
+         */
+        size_t DecryptParallel(span<u8> output, size_t offset);
+
       protected:
         size_t ReadImpl(span<u8> output, size_t offset) override;
 
       public:
-        CtrEncryptedBacking(crypto::KeyStore::Key128 ctr, crypto::KeyStore::Key128 key, std::shared_ptr<Backing> backing, size_t baseOffset);
+        /**
+         * @param cache A cache of decrypted pages, if this is null then all reads will be decrypted on demand
+         */
+        CtrEncryptedBacking(crypto::KeyStore::Key128 ctr, crypto::KeyStore::Key128 key, std::shared_ptr<Backing> backing, size_t baseOffset, std::shared_ptr<SectorCache> cache = nullptr);
     };
 }
@@ -22,6 +22,15 @@ namespace skyline::vfs {
             size_t size; //!< 0 if a directory
         };
 
+        /**
+         * @brief A non-owning variant of Entry, the name is only valid till the directory is read again
+         */
+        struct EntryView {
+            std::string_view name;
+            EntryType type;
+            size_t size; //!< 0 if a directory
+        };
+
         /**
          * @brief A descriptor for what will be returned when reading a directories contents
          */
@@ -34,6 +43,11 @@ namespace skyline::vfs {
         };
         static_assert(sizeof(ListMode) == 0x4);
 
+      private:
+        std::optional<std::vector<Entry>> entries; //!< All entries in the directory, this is only used by the default implementation of ReadNext
+        size_t entryCursor{}; //!< The index of the next entry to be returned by the default implementation of ReadNext
+
+      public:
         ListMode listMode;
 
         Directory(ListMode listMode) : listMode(listMode) {}
@@ -50,5 +64,21 @@ namespace skyline::vfs {
          * @return A vector containing each entry
          */
         virtual std::vector<Entry> Read() = 0;
+
+        /**
+         * @brief Reads the next entry in the directory and advances the directory's cursor, this streams the contents of the directory rather than materializing them all at once
+         * @return The next entry or std::nullopt if all entries have been read
+         * @note The default implementation reads all entries on the first call, directories which can stream their contents should override this
+         */
+        virtual std::optional<EntryView> ReadNext() {
+            if (!entries)
+                entries = Read();
+
+            if (entryCursor >= entries->size())
+                return std::nullopt;
+
+            auto &entry{(*entries)[entryCursor++]};
+            return EntryView{entry.name, entry.type, entry.size};
+        }
     };
 }
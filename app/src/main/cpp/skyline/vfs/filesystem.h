@@ -28,6 +28,8 @@ namespace skyline::vfs {
             throw exception("This filesystem does not support opening directories");
         };
 
+        virtual void CommitImpl() {}
+
       public:
         FileSystem() = default;
 
@@ -140,5 +142,12 @@ namespace skyline::vfs {
 
             return dir;
         };
+
+        /**
+         * @brief Writes out any changes to the filesystem which are buffered in memory
+         */
+        void Commit() {
+            CommitImpl();
+        }
     };
 }
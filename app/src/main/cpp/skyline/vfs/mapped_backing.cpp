@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "os_backing.h"
+#include "mapped_backing.h"
+
+namespace skyline::vfs {
+    MappedBacking::MappedBacking(int fd) : Backing({true, false, false}) {
+        struct stat fileInfo;
+        if (fstat(fd, &fileInfo))
+            throw exception("Failed to stat fd: {}", strerror(errno));
+        if (!S_ISREG(fileInfo.st_mode) || fileInfo.st_size == 0)
+            throw exception("Cannot map an FD which isn't a non-empty regular file");
+
+        size = static_cast<size_t>(fileInfo.st_size);
+        mapping = static_cast<u8 *>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+        if (mapping == MAP_FAILED)
+            throw exception("Failed to map fd: {}", strerror(errno));
+
+        // Most reads are small and scattered across the file while parsing filesystems, the kernel's readahead around each fault would mostly be wasted I/O
+        madvise(mapping, size, MADV_RANDOM);
+    }
+
+    MappedBacking::~MappedBacking() {
+        munmap(mapping, size);
+    }
+
+    size_t MappedBacking::ReadImpl(span<u8> output, size_t offset) {
+        if (offset >= size)
+            return 0;
+
+        size_t readSize{std::min(output.size(), size - offset)};
+        if (readSize >= WillNeedThreshold) {
+            // Large reads are read in by the kernel asynchronously rather than faulting in one page at a time as they're copied
+            auto alignedStart{util::AlignDown(reinterpret_cast<uintptr_t>(mapping + offset), PAGE_SIZE)};
+            madvise(reinterpret_cast<void *>(alignedStart), reinterpret_cast<uintptr_t>(mapping + offset + readSize) - alignedStart, MADV_WILLNEED);
+        }
+
+        std::memcpy(output.data(), mapping + offset, readSize);
+        return readSize;
+    }
+
+    span<u8> MappedBacking::ReadViewImpl(size_t offset, size_t size) {
+        return {mapping + offset, size};
+    }
+
+    std::shared_ptr<Backing> MappedBacking::Open(int fd) {
+        try {
+            return std::make_shared<MappedBacking>(fd);
+        } catch (const exception &e) {
+            Logger::Warn("Falling back to reading the file directly: {}", e.what());
+            return std::make_shared<OsBacking>(fd);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief A read-only backing for a physical linux file which is memory-mapped, this turns reads into copies from the page cache without a syscall for each read
+     * @note This is intended for large files which are read frequently such as ROMs, files which can't be mapped should use an OsBacking instead
+     */
+    class MappedBacking : public Backing {
+      private:
+        static constexpr size_t WillNeedThreshold{0x10000}; //!< The size of a read after which the kernel is advised to read it in ahead of it being copied
+
+        u8 *mapping; //!< The mapping of the file into our address space
+
+      protected:
+        size_t ReadImpl(span<u8> output, size_t offset) override;
+
+        span<u8> ReadViewImpl(size_t offset, size_t size) override;
+
+      public:
+        /**
+         * @param fd The file descriptor of the backing, it may be closed after the backing has been created
+         */
+        MappedBacking(int fd);
+
+        ~MappedBacking();
+
+        /**
+         * @return A MappedBacking for the file or an OsBacking if it can't be mapped, which is the case for certain files provided by content providers
+         */
+        static std::shared_ptr<Backing> Open(int fd);
+    };
+}
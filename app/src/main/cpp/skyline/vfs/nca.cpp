@@ -14,7 +14,7 @@
 namespace skyline::vfs {
     using namespace loader;
 
-    NCA::NCA(std::shared_ptr<vfs::Backing> pBacking, std::shared_ptr<crypto::KeyStore> pKeyStore, bool pUseKeyArea) : backing(std::move(pBacking)), keyStore(std::move(pKeyStore)), useKeyArea(pUseKeyArea) {
+    NCA::NCA(std::shared_ptr<vfs::Backing> pBacking, std::shared_ptr<crypto::KeyStore> pKeyStore, bool pUseKeyArea, size_t sectorCacheSize) : backing(std::move(pBacking)), keyStore(std::move(pKeyStore)), useKeyArea(pUseKeyArea) {
         header = backing->Read<NcaHeader>();
 
         if (header.magic != util::MakeMagic<u32>("NCA3")) {
@@ -31,9 +31,39 @@ namespace skyline::vfs {
             encrypted = true;
         }
 
+        if (sectorCacheSize)
+            sectorCache = std::make_shared<SectorCache>(sectorCacheSize);
+
         contentType = header.contentType;
         rightsIdEmpty = header.rightsId == crypto::KeyStore::Key128{};
+    }
+
+    std::vector<OverlayBacking::Overlay> NCA::GetDecryptedOverlays() {
+        std::vector<OverlayBacking::Overlay> overlays;
+        if (!encrypted)
+            return overlays;
+
+        // An NCA with a plaintext header is treated as entirely unencrypted so only the header needs to be written in plaintext alongside the sections
+        std::vector<u8> headerBuffer(sizeof(NcaHeader));
+        std::memcpy(headerBuffer.data(), &header, sizeof(NcaHeader));
+        overlays.push_back({.offset = 0, .buffer = std::move(headerBuffer)});
+
+        for (size_t i{}; i < header.sectionHeaders.size(); i++) {
+            auto &sectionEntry{header.fsEntries.at(i)};
+            if (sectionEntry.endOffset <= sectionEntry.startOffset)
+                continue;
+
+            size_t offset{static_cast<size_t>(sectionEntry.startOffset) * constant::MediaUnitSize}, size{static_cast<size_t>(sectionEntry.endOffset - sectionEntry.startOffset) * constant::MediaUnitSize};
+            auto sectionBacking{CreateBacking(header.sectionHeaders.at(i), std::make_shared<RegionBacking>(backing, offset, size), offset)};
+            if (!sectionBacking)
+                throw exception("Cannot decrypt NCA section {} with encryption type {}", i, static_cast<u8>(header.sectionHeaders.at(i).encryptionType));
+            overlays.push_back({.offset = offset, .backing = std::move(sectionBacking)});
+        }
+
+        return overlays;
+    }
 
+    void NCA::OpenSections() {
         for (size_t i{}; i < header.sectionHeaders.size(); i++) {
             auto &sectionHeader{header.sectionHeaders.at(i)};
             auto &sectionEntry{header.fsEntries.at(i)};
@@ -45,6 +75,25 @@ namespace skyline::vfs {
         }
     }
 
+    void NCA::ValidateKeys() {
+        if (!encrypted)
+            return;
+
+        for (size_t i{}; i < header.sectionHeaders.size(); i++) {
+            auto &sectionHeader{header.sectionHeaders.at(i)};
+            auto &sectionEntry{header.fsEntries.at(i)};
+            if (sectionEntry.endOffset <= sectionEntry.startOffset)
+                continue;
+
+            if (sectionHeader.encryptionType == NcaSectionEncryptionType::CTR || sectionHeader.encryptionType == NcaSectionEncryptionType::BKTR) {
+                if (!(rightsIdEmpty || useKeyArea))
+                    GetTitleKey();
+                else
+                    GetKeyAreaKey(sectionHeader.encryptionType);
+            }
+        }
+    }
+
     void NCA::ReadPfs0(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry) {
         size_t offset{static_cast<size_t>(entry.startOffset) * constant::MediaUnitSize + sectionHeader.sha256HashInfo.pfs0Offset};
         size_t size{constant::MediaUnitSize * static_cast<size_t>(entry.endOffset - entry.startOffset)};
@@ -86,7 +135,7 @@ namespace skyline::vfs {
                 std::memcpy(ctr.data(), &secureValueLE, 4);
                 std::memcpy(ctr.data() + 4, &generationLE, 4);
 
-                return std::make_shared<CtrEncryptedBacking>(ctr, key, std::move(rawBacking), offset);
+                return std::make_shared<CtrEncryptedBacking>(ctr, key, std::move(rawBacking), offset, sectorCache);
             }
             default:
                 return nullptr;
@@ -111,9 +160,7 @@ namespace skyline::vfs {
         if (!titleKek)
             throw loader_exception(LoaderResult::MissingTitleKek);
 
-        crypto::AesCipher cipher(*titleKek, MBEDTLS_CIPHER_AES_128_ECB);
-        cipher.Decrypt(*titleKey);
-        return *titleKey;
+        return keyStore->DecryptKey(*titleKek, *titleKey);
     }
 
     crypto::KeyStore::Key128 NCA::GetKeyAreaKey(NCA::NcaSectionEncryptionType type) {
@@ -138,10 +185,7 @@ namespace skyline::vfs {
                     throw exception("Unsupported NcaSectionEncryptionType");
             }
 
-            crypto::KeyStore::Key128 decryptedKeyArea;
-            crypto::AesCipher cipher(*keyArea, MBEDTLS_CIPHER_AES_128_ECB);
-            cipher.Decrypt(decryptedKeyArea.data(), header.encryptedKeyArea[keyAreaIndex].data(), decryptedKeyArea.size());
-            return decryptedKeyArea;
+            return keyStore->DecryptKey(*keyArea, header.encryptedKeyArea[keyAreaIndex]);
         }};
 
         switch (header.keyAreaEncryptionKeyType) {
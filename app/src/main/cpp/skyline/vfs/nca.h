@@ -6,6 +6,8 @@
 #include <crypto/key_store.h>
 #include <crypto/aes_cipher.h>
 #include "filesystem.h"
+#include "overlay_backing.h"
+#include "sector_cache.h"
 
 namespace skyline {
     namespace constant {
@@ -174,6 +176,7 @@ namespace skyline {
             bool encrypted{false};
             bool rightsIdEmpty;
             bool useKeyArea;
+            std::shared_ptr<SectorCache> sectorCache; //!< A cache of decrypted pages shared by all encrypted sections, this is null if caching is disabled
 
             void ReadPfs0(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry);
 
@@ -194,7 +197,27 @@ namespace skyline {
             std::shared_ptr<Backing> romFs; //!< The backing for this NCA's RomFS section
             NcaContentType contentType; //!< The content type of the NCA
 
-            NCA(std::shared_ptr<vfs::Backing> backing, std::shared_ptr<crypto::KeyStore> keyStore, bool useKeyArea = false);
+            /**
+             * @brief Parses the NCA header, the sections are only opened by OpenSections() so NCAs can be filtered by their content type without decrypting any section headers
+             * @param sectorCacheSize The size of the cache of decrypted sections in bytes, caching is disabled if this is 0
+             */
+            NCA(std::shared_ptr<vfs::Backing> backing, std::shared_ptr<crypto::KeyStore> keyStore, bool useKeyArea = false, size_t sectorCacheSize = 0);
+
+            /**
+             * @brief Opens the filesystems of all PFS0 and RomFS sections in the NCA
+             */
+            void OpenSections();
+
+            /**
+             * @brief Ensures that the keys required to decrypt every section of the NCA are present without opening any of them
+             * @note A loader_exception with the missing key is thrown if any aren't present
+             */
+            void ValidateKeys();
+
+            /**
+             * @return Overlays which replace the header and all sections of the NCA with their decrypted contents, an NCA with these applied has a plaintext header and is loaded without any keys
+             */
+            std::vector<OverlayBacking::Overlay> GetDecryptedOverlays();
         };
     }
 }
@@ -22,6 +22,13 @@ namespace skyline::vfs {
 
     size_t OsBacking::ReadImpl(span<u8> output, size_t offset) {
         auto ret{pread64(fd, output.data(), output.size(), static_cast<off64_t>(offset))};
+        if (ret < 0 && errno == EFAULT) {
+            // The output may be guest memory which was write-protected by the host to track writes to it, the kernel doesn't raise a fault for that so we read into a bounce buffer and copy it from userspace instead
+            std::vector<u8> buffer(output.size());
+            ret = pread64(fd, buffer.data(), buffer.size(), static_cast<off64_t>(offset));
+            if (ret > 0)
+                std::memcpy(output.data(), buffer.data(), static_cast<size_t>(ret));
+        }
         if (ret < 0)
             throw exception("Failed to read from fd: {}", strerror(errno));
 
@@ -6,10 +6,11 @@
 #include <dirent.h>
 #include <unistd.h>
 #include "os_backing.h"
+#include "write_back_backing.h"
 #include "os_filesystem.h"
 
 namespace skyline::vfs {
-    OsFileSystem::OsFileSystem(const std::string &basePath) : FileSystem(), basePath(basePath.ends_with('/') ? basePath : basePath + '/') {
+    OsFileSystem::OsFileSystem(const std::string &basePath, bool writeBack) : FileSystem(), basePath(basePath.ends_with('/') ? basePath : basePath + '/'), writeBack(writeBack) {
         if (!DirectoryExists(basePath))
             if (!CreateDirectory(basePath, true))
                 throw exception("Error creating the OS filesystem backing directory");
@@ -17,6 +18,8 @@ namespace skyline::vfs {
 
     bool OsFileSystem::CreateFileImpl(const std::string &path, size_t size) {
         auto fullPath{basePath + path};
+        if (writeBack && WriteBackCache::Get().Resize(fullPath, size))
+            return true; // The file already exists and is open with buffered writes, truncating it on disk would be undone by them
 
         // Create a directory that will hold the file
         CreateDirectory(fullPath.substr(0, fullPath.find_last_of('/')), true);
@@ -59,6 +62,10 @@ namespace skyline::vfs {
     }
 
     std::shared_ptr<Backing> OsFileSystem::OpenFileImpl(const std::string &path, Backing::Mode mode) {
+        // Readers also go through the cache so they observe writes which haven't been written back yet
+        if (writeBack)
+            return WriteBackCache::Get().Open(basePath + path, mode);
+
         int fd{open((basePath + path).c_str(), (mode.read && mode.write) ? O_RDWR : (mode.write ? O_WRONLY : O_RDONLY))};
         if (fd < 0)
             throw exception("Failed to open file at '{}': {}", path, strerror(errno));
@@ -85,8 +92,42 @@ namespace skyline::vfs {
         return std::make_shared<OsFileSystemDirectory>(basePath + path, listMode);
     }
 
+    void OsFileSystem::CommitImpl() {
+        if (writeBack)
+            WriteBackCache::Get().Flush(basePath);
+    }
+
     OsFileSystemDirectory::OsFileSystemDirectory(std::string path, Directory::ListMode listMode) : Directory(listMode), path(std::move(path)) {}
 
+    OsFileSystemDirectory::~OsFileSystemDirectory() {
+        if (directory)
+            closedir(directory);
+    }
+
+    std::optional<Directory::EntryView> OsFileSystemDirectory::ReadNext() {
+        if (!listMode.file && !listMode.directory)
+            return std::nullopt;
+
+        if (!directory && !(directory = opendir(path.c_str())))
+            throw exception("Failed to open directory: {}, error: {}", path, strerror(errno));
+
+        struct dirent *entry;
+        while ((entry = readdir(directory))) {
+            // The entry is stat-ed relative to the directory stream to avoid building a path for every entry
+            struct stat entryInfo;
+            if (fstatat(dirfd(directory), entry->d_name, &entryInfo, 0))
+                throw exception("Failed to stat directory entry: {}, error: {}", entry->d_name, strerror(errno));
+
+            std::string_view name(entry->d_name);
+            if (S_ISDIR(entryInfo.st_mode) && listMode.directory && (name != ".") && (name != ".."))
+                return EntryView{name, Directory::EntryType::Directory, 0};
+            else if (S_ISREG(entryInfo.st_mode) && listMode.file)
+                return EntryView{name, Directory::EntryType::File, static_cast<size_t>(entryInfo.st_size)};
+        }
+
+        return std::nullopt;
+    }
+
     std::vector<Directory::Entry> OsFileSystemDirectory::Read() {
         if (!listMode.file && !listMode.directory)
             return {};
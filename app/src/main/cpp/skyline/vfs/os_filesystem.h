@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <dirent.h>
 #include "filesystem.h"
 
 namespace skyline::vfs {
@@ -12,6 +13,7 @@ namespace skyline::vfs {
     class OsFileSystem : public FileSystem {
       private:
         std::string basePath; //!< The base path for filesystem operations
+        bool writeBack; //!< If writable files are opened through WriteBackCache rather than being written through to the disk
 
       protected:
         bool CreateFileImpl(const std::string &path, size_t size) override;
@@ -24,8 +26,13 @@ namespace skyline::vfs {
 
         std::shared_ptr<Directory> OpenDirectoryImpl(const std::string &path, Directory::ListMode listMode) override;
 
+        void CommitImpl() override;
+
       public:
-        OsFileSystem(const std::string &basePath);
+        /**
+         * @param writeBack If writes to files should be buffered in memory till they're flushed, the filesystem is committed or the file is closed, this is used for save data which is frequently written in small chunks
+         */
+        OsFileSystem(const std::string &basePath, bool writeBack = false);
     };
 
     /**
@@ -34,10 +41,15 @@ namespace skyline::vfs {
     class OsFileSystemDirectory : public Directory {
       private:
         std::string path;
+        DIR *directory{}; //!< The directory stream used by ReadNext, this is opened on the first call to it
 
       public:
         OsFileSystemDirectory(std::string path, ListMode listMode);
 
+        ~OsFileSystemDirectory();
+
         std::vector<Entry> Read();
+
+        std::optional<EntryView> ReadNext() override;
     };
 }
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The OverlayBacking class provides a view of a backing with certain regions replaced by the contents of other backings or buffers
+     */
+    class OverlayBacking : public Backing {
+      public:
+        /**
+         * @brief A region of the base backing which is replaced, this is sourced from a backing if one is supplied or from the buffer otherwise
+         */
+        struct Overlay {
+            size_t offset; //!< The offset of the region in the base backing
+            std::shared_ptr<Backing> backing;
+            std::vector<u8> buffer;
+
+            size_t Size() const {
+                return backing ? backing->size : buffer.size();
+            }
+        };
+
+      private:
+        std::shared_ptr<Backing> backing; //!< The base backing
+        std::vector<Overlay> overlays; //!< All overlays sorted by their offset, these must not overlap
+
+      protected:
+        size_t ReadImpl(span<u8> output, size_t offset) override {
+            size_t readSize{backing->ReadUnchecked(output, offset)}, end{offset + readSize};
+
+            for (auto &overlay : overlays) {
+                size_t overlayEnd{overlay.offset + overlay.Size()};
+                if (overlayEnd <= offset)
+                    continue;
+                if (overlay.offset >= end)
+                    break;
+
+                size_t copyStart{std::max(offset, overlay.offset)}, copyEnd{std::min(end, overlayEnd)};
+                auto copyOutput{output.subspan(copyStart - offset, copyEnd - copyStart)};
+                if (overlay.backing)
+                    overlay.backing->Read(copyOutput, copyStart - overlay.offset);
+                else
+                    copyOutput.copy_from(span(overlay.buffer).subspan(copyStart - overlay.offset, copyOutput.size()));
+            }
+
+            return readSize;
+        }
+
+      public:
+        OverlayBacking(std::shared_ptr<Backing> pBacking, std::vector<Overlay> pOverlays) : Backing({true, false, false}, pBacking->size), backing(std::move(pBacking)), overlays(std::move(pOverlays)) {
+            std::sort(overlays.begin(), overlays.end(), [](const Overlay &a, const Overlay &b) { return a.offset < b.offset; });
+        }
+    };
+}
@@ -40,6 +40,13 @@ namespace skyline::vfs {
         }
     }
 
+    size_t PartitionFileSystem::GetFileOffset(const std::string &path) {
+        auto it{fileMap.find(path)};
+        if (it == fileMap.end())
+            throw exception("Failed to find file: {}", path);
+        return fileDataOffset + it->second.offset;
+    }
+
     std::optional<Directory::EntryType> PartitionFileSystem::GetEntryTypeImpl(const std::string &path) {
         if (fileMap.count(path))
             return Directory::EntryType::File;
@@ -67,4 +74,12 @@ namespace skyline::vfs {
         else
             return std::vector<Entry>();
     }
+
+    std::optional<Directory::EntryView> PartitionFileSystemDirectory::ReadNext() {
+        if (!listMode.file || fileCursor >= fileList.size())
+            return std::nullopt;
+
+        auto &entry{fileList[fileCursor++]};
+        return EntryView{entry.name, entry.type, entry.size};
+    }
 }
@@ -48,6 +48,11 @@ namespace skyline::vfs {
 
       public:
         PartitionFileSystem(const std::shared_ptr<Backing> &backing);
+
+        /**
+         * @return The offset of the file's contents in the backing of the filesystem
+         */
+        size_t GetFileOffset(const std::string &path);
     };
 
     /**
@@ -56,10 +61,13 @@ namespace skyline::vfs {
     class PartitionFileSystemDirectory : public Directory {
       private:
         std::vector<Entry> fileList; //!< A list of every file in the PFS root directory
+        size_t fileCursor{}; //!< The index of the next file to be returned by ReadNext
 
       public:
         PartitionFileSystemDirectory(std::vector<Entry> fileList, ListMode listMode);
 
         std::vector<Entry> Read();
+
+        std::optional<EntryView> ReadNext() override;
     };
 }
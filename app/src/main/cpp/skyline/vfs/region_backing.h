@@ -19,6 +19,10 @@ namespace skyline::vfs {
             return backing->ReadUnchecked(output, baseOffset + offset);
         }
 
+        span<u8> ReadViewImpl(size_t offset, size_t size) override {
+            return backing->ReadView(baseOffset + offset, size);
+        }
+
       public:
         /**
          * @param file The backing to create the RegionBacking from
@@ -5,78 +5,142 @@
 #include "rom_filesystem.h"
 
 namespace skyline::vfs {
+    namespace {
+        /**
+         * @brief Reads the name of an entry, this avoids an intermediate copy if the backing supports views
+         */
+        std::string ReadName(Backing &backing, size_t offset, size_t size) {
+            auto view{backing.ReadView(offset, size)};
+            if (!view.empty())
+                return std::string(reinterpret_cast<const char *>(view.data()), size);
+
+            std::string name(size, '\0');
+            backing.Read(span(name.data(), size), offset);
+            return name;
+        }
+    }
+
     RomFileSystem::RomFileSystem(std::shared_ptr<Backing> pBacking) : FileSystem(), backing(std::move(pBacking)) {
         header = backing->Read<RomFsHeader>();
-        TraverseDirectory(0, "");
     }
 
-    void RomFileSystem::TraverseFiles(u32 offset, const std::string &path) {
-        RomFsFileEntry entry;
-        do {
-            entry = backing->Read<RomFsFileEntry>(header.fileMetaTableOffset + offset);
-
-            if (entry.nameSize) {
-                std::vector<char> name(entry.nameSize);
-                backing->Read(span(name), header.fileMetaTableOffset + offset + sizeof(RomFsFileEntry));
+    template<typename EntryType>
+    std::optional<std::pair<u32, EntryType>> RomFileSystem::FindEntry(u32 parentOffset, std::string_view name, u64 hashTableOffset, u64 hashTableSize, u64 metaTableOffset) {
+        size_t bucketCount{hashTableSize / sizeof(u32)};
+        if (!bucketCount)
+            return std::nullopt;
+
+        // This is the hash function used by HOS to place entries in buckets, it's seeded by the offset of the parent directory so identically named entries in different directories are spread out
+        u32 hash{parentOffset ^ 123456789};
+        for (char character : name) {
+            hash = std::rotr(hash, 5);
+            hash ^= static_cast<u8>(character);
+        }
 
-                std::string fullPath{path + (path.empty() ? "" : "/") + std::string(name.data(), entry.nameSize)};
-                fileMap.emplace(fullPath, entry);
-            }
+        auto offset{backing->Read<u32>(hashTableOffset + (hash % bucketCount) * sizeof(u32))};
+        while (offset != constant::RomFsEmptyEntry) {
+            auto entry{backing->Read<EntryType>(metaTableOffset + offset)};
+            if (entry.parentOffset == parentOffset && entry.nameSize == name.size() && ReadName(*backing, metaTableOffset + offset + sizeof(EntryType), entry.nameSize) == name)
+                return std::make_pair(offset, entry);
+            offset = entry.hashSiblingOffset;
+        }
 
-            offset = entry.siblingOffset;
-        } while (offset != constant::RomFsEmptyEntry);
+        return std::nullopt;
     }
 
-    void RomFileSystem::TraverseDirectory(u32 offset, const std::string &path) {
-        auto entry{backing->Read<RomFsDirectoryEntry>(header.dirMetaTableOffset + offset)};
-
-        std::string childPath(path);
-        if (entry.nameSize) {
-            std::vector<char> name(entry.nameSize);
-            backing->Read(span(name), header.dirMetaTableOffset + offset + sizeof(RomFsDirectoryEntry));
-            childPath = path + (path.empty() ? "" : "/") + std::string(name.data(), entry.nameSize);
+    std::optional<std::pair<u32, RomFileSystem::RomFsDirectoryEntry>> RomFileSystem::FindDirectory(std::string_view path) {
+        u32 offset{}; // The root directory is always the first directory entry
+        auto entry{backing->Read<RomFsDirectoryEntry>(header.dirMetaTableOffset)};
+
+        while (!path.empty()) {
+            auto separator{path.find('/')};
+            auto name{path.substr(0, separator)};
+            path = separator == std::string_view::npos ? std::string_view{} : path.substr(separator + 1);
+            if (name.empty())
+                continue;
+
+            auto child{FindEntry<RomFsDirectoryEntry>(offset, name, header.dirHashTableOffset, header.dirHashTableSize, header.dirMetaTableOffset)};
+            if (!child)
+                return std::nullopt;
+            std::tie(offset, entry) = *child;
         }
 
-        directoryMap.emplace(childPath, entry);
-
-        if (entry.fileOffset != constant::RomFsEmptyEntry)
-            TraverseFiles(entry.fileOffset, childPath);
+        return std::make_pair(offset, entry);
+    }
 
-        if (entry.childOffset != constant::RomFsEmptyEntry)
-            TraverseDirectory(entry.childOffset, childPath);
+    std::optional<RomFileSystem::RomFsFileEntry> RomFileSystem::FindFile(std::string_view path) {
+        u32 parentOffset{};
+        auto separator{path.rfind('/')};
+        if (separator != std::string_view::npos) {
+            auto directory{FindDirectory(path.substr(0, separator))};
+            if (!directory)
+                return std::nullopt;
+            parentOffset = directory->first;
+            path = path.substr(separator + 1);
+        }
 
-        if (entry.siblingOffset != constant::RomFsEmptyEntry)
-            TraverseDirectory(entry.siblingOffset, path);
+        auto file{FindEntry<RomFsFileEntry>(parentOffset, path, header.fileHashTableOffset, header.fileHashTableSize, header.fileMetaTableOffset)};
+        if (!file)
+            return std::nullopt;
+        return file->second;
     }
 
     std::shared_ptr<Backing> RomFileSystem::OpenFileImpl(const std::string &path, Backing::Mode mode) {
-        try {
-            const auto &entry{fileMap.at(path)};
-            return std::make_shared<RegionBacking>(backing, header.dataOffset + entry.offset, entry.size, mode);
-        } catch (std::out_of_range &e) {
+        auto entry{FindFile(path)};
+        if (!entry)
             return nullptr;
-        }
+        return std::make_shared<RegionBacking>(backing, header.dataOffset + entry->offset, entry->size, mode);
     }
 
     std::optional<Directory::EntryType> RomFileSystem::GetEntryTypeImpl(const std::string &path) {
-        if (fileMap.count(path))
+        if (FindFile(path))
             return Directory::EntryType::File;
-        else if (directoryMap.count(path))
+        else if (FindDirectory(path))
             return Directory::EntryType::Directory;
 
         return std::nullopt;
     }
 
     std::shared_ptr<Directory> RomFileSystem::OpenDirectoryImpl(const std::string &path, Directory::ListMode listMode) {
-        try {
-            auto &entry{directoryMap.at(path)};
-            return std::make_shared<RomFileSystemDirectory>(backing, header, entry, listMode);
-        } catch (std::out_of_range &e) {
+        auto entry{FindDirectory(path)};
+        if (!entry)
             return nullptr;
-        }
+        return std::make_shared<RomFileSystemDirectory>(backing, header, entry->second, listMode);
     }
 
-    RomFileSystemDirectory::RomFileSystemDirectory(std::shared_ptr<Backing> backing, const RomFileSystem::RomFsHeader &header, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode) : Directory(listMode), backing(std::move(backing)), header(header), ownEntry(ownEntry) {}
+    RomFileSystemDirectory::RomFileSystemDirectory(std::shared_ptr<Backing> backing, const RomFileSystem::RomFsHeader &header, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode) : Directory(listMode), backing(std::move(backing)), header(header), ownEntry(ownEntry), fileCursor(listMode.file ? ownEntry.fileOffset : constant::RomFsEmptyEntry), directoryCursor(listMode.directory ? ownEntry.childOffset : constant::RomFsEmptyEntry) {}
+
+    std::string_view RomFileSystemDirectory::ReadEntryName(size_t offset, size_t size) {
+        auto view{backing->ReadView(offset, size)};
+        if (!view.empty())
+            return std::string_view(reinterpret_cast<const char *>(view.data()), size);
+
+        nameBuffer.resize(size);
+        backing->Read(span(nameBuffer.data(), size), offset);
+        return nameBuffer;
+    }
+
+    std::optional<Directory::EntryView> RomFileSystemDirectory::ReadNext() {
+        while (fileCursor != constant::RomFsEmptyEntry) {
+            size_t entryOffset{header.fileMetaTableOffset + fileCursor};
+            auto romFsFileEntry{backing->Read<RomFileSystem::RomFsFileEntry>(entryOffset)};
+            fileCursor = romFsFileEntry.siblingOffset;
+
+            if (romFsFileEntry.nameSize)
+                return EntryView{ReadEntryName(entryOffset + sizeof(RomFileSystem::RomFsFileEntry), romFsFileEntry.nameSize), EntryType::File, romFsFileEntry.size};
+        }
+
+        while (directoryCursor != constant::RomFsEmptyEntry) {
+            size_t entryOffset{header.dirMetaTableOffset + directoryCursor};
+            auto romFsDirectoryEntry{backing->Read<RomFileSystem::RomFsDirectoryEntry>(entryOffset)};
+            directoryCursor = romFsDirectoryEntry.siblingOffset;
+
+            if (romFsDirectoryEntry.nameSize)
+                return EntryView{ReadEntryName(entryOffset + sizeof(RomFileSystem::RomFsDirectoryEntry), romFsDirectoryEntry.nameSize), EntryType::Directory, 0};
+        }
+
+        return std::nullopt;
+    }
 
     std::vector<RomFileSystemDirectory::Entry> RomFileSystemDirectory::Read() {
         std::vector<Entry> contents;
@@ -89,10 +153,8 @@ namespace skyline::vfs {
                 romFsFileEntry = backing->Read<RomFileSystem::RomFsFileEntry>(header.fileMetaTableOffset + offset);
 
                 if (romFsFileEntry.nameSize) {
-                    std::vector<char> name(romFsFileEntry.nameSize);
-                    backing->Read(span(name), header.fileMetaTableOffset + offset + sizeof(RomFileSystem::RomFsFileEntry));
-
-                    contents.emplace_back(Entry{std::string(name.data(), romFsFileEntry.nameSize), EntryType::File, romFsFileEntry.size});
+                    auto name{ReadName(*backing, header.fileMetaTableOffset + offset + sizeof(RomFileSystem::RomFsFileEntry), romFsFileEntry.nameSize)};
+                    contents.emplace_back(Entry{std::move(name), EntryType::File, romFsFileEntry.size});
                 }
 
                 offset = romFsFileEntry.siblingOffset;
@@ -107,10 +169,8 @@ namespace skyline::vfs {
                 romFsDirectoryEntry = backing->Read<RomFileSystem::RomFsDirectoryEntry>(header.dirMetaTableOffset + offset);
 
                 if (romFsDirectoryEntry.nameSize) {
-                    std::vector<char> name(romFsDirectoryEntry.nameSize);
-                    backing->Read(span(name), header.dirMetaTableOffset + offset + sizeof(RomFileSystem::RomFsDirectoryEntry));
-
-                    contents.emplace_back(Entry{std::string(name.data(), romFsDirectoryEntry.nameSize), EntryType::Directory});
+                    auto name{ReadName(*backing, header.dirMetaTableOffset + offset + sizeof(RomFileSystem::RomFsDirectoryEntry), romFsDirectoryEntry.nameSize)};
+                    contents.emplace_back(Entry{std::move(name), EntryType::Directory});
                 }
 
                 offset = romFsDirectoryEntry.siblingOffset;
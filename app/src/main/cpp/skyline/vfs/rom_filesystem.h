@@ -18,20 +18,6 @@ namespace skyline {
           private:
             std::shared_ptr<Backing> backing;
 
-            /**
-             * @brief Traverses the sibling files of the given file and adds them to the file map
-             * @param offset The offset of the file entry to traverses the siblings of
-             * @param path The path to the parent directory of the supplied file entry
-             */
-            void TraverseFiles(u32 offset, const std::string &path);
-
-            /**
-             * @brief Traverses the directories within the given directory, adds them to the directory map and calls TraverseFiles on them
-             * @param offset The offset of the directory entry to traverses the directories in
-             * @param path The path to the supplied directory entry
-             */
-            void TraverseDirectory(u32 offset, const std::string &path);
-
           protected:
             std::shared_ptr<Backing> OpenFileImpl(const std::string &path, Backing::Mode mode) override;
 
@@ -59,7 +45,7 @@ namespace skyline {
                 u32 siblingOffset; //!< The offset from the directory metadata base of a sibling directory
                 u32 childOffset; //!< The offset from the directory metadata base of a child directory
                 u32 fileOffset; //!< The offset from the file metadata base of a child file
-                u32 hash; //!< The hash of the directory
+                u32 hashSiblingOffset; //!< The offset from the directory metadata base of the next directory in the same hash bucket
                 u32 nameSize; //!< The size of the directory's name in bytes
             };
 
@@ -68,13 +54,31 @@ namespace skyline {
                 u32 siblingOffset; //!< The offset from the file metadata base of a sibling file
                 u64 offset; //!< The offset from the file data base of the file contents
                 u64 size; //!< The size of the file in bytes
-                u32 hash; //!< The hash of the file
+                u32 hashSiblingOffset; //!< The offset from the file metadata base of the next file in the same hash bucket
                 u32 nameSize; //!< The size of the file's name in bytes
             };
 
-            std::unordered_map<std::string, RomFsFileEntry> fileMap; //!< A map that maps file names to their corresponding entry
-            std::unordered_map<std::string, RomFsDirectoryEntry> directoryMap; //!< A map that maps directory names to their corresponding entry
+          private:
+            /**
+             * @brief Looks up an entry with the supplied parent and name in one of the on-disk hash tables
+             * @param hashTableOffset The offset of the hash table which is an array of offsets into the metadata table of the first entry in each bucket
+             * @return The offset of the entry into the metadata table and the entry itself if it was found
+             */
+            template<typename EntryType>
+            std::optional<std::pair<u32, EntryType>> FindEntry(u32 parentOffset, std::string_view name, u64 hashTableOffset, u64 hashTableSize, u64 metaTableOffset);
+
+            /**
+             * @brief Walks the supplied path one component at a time from the root directory
+             * @return The offset of the directory entry into the metadata table and the entry itself if it was found
+             */
+            std::optional<std::pair<u32, RomFsDirectoryEntry>> FindDirectory(std::string_view path);
+
+            std::optional<RomFsFileEntry> FindFile(std::string_view path);
 
+          public:
+            /**
+             * @note No index of the filesystem is built, lookups use the hash tables in the RomFS metadata so nothing is traversed up front
+             */
             RomFileSystem(std::shared_ptr<Backing> backing);
         };
 
@@ -86,11 +90,21 @@ namespace skyline {
             RomFileSystem::RomFsDirectoryEntry ownEntry; //!< This directory's entry in the RomFS header
             RomFileSystem::RomFsHeader header; //!< A header of this files parent RomFS image
             std::shared_ptr<Backing> backing;
+            u32 fileCursor; //!< The offset of the next file entry to be returned by ReadNext
+            u32 directoryCursor; //!< The offset of the next directory entry to be returned by ReadNext, directories are returned after all files
+            std::string nameBuffer; //!< A buffer for the name of the last entry returned by ReadNext if the backing doesn't support views, it's reused to avoid an allocation per entry
+
+            /**
+             * @return A view of the name of an entry which is valid till the next call
+             */
+            std::string_view ReadEntryName(size_t offset, size_t size);
 
           public:
             RomFileSystemDirectory(std::shared_ptr<Backing> backing, const RomFileSystem::RomFsHeader &header, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode);
 
             std::vector<Entry> Read();
+
+            std::optional<EntryView> ReadNext() override;
         };
     }
 }
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <common/memory_accounting.h>
+#include "sector_cache.h"
+
+namespace skyline::vfs {
+    SectorCache::SectorCache(size_t capacity) : capacity(capacity) {}
+
+    SectorCache::~SectorCache() {
+        MemoryAccounting::Update(MemoryAccounting::Category::SectorCache, -static_cast<i64>(cachedSize));
+    }
+
+    SectorCache::Page SectorCache::Lookup(u64 offset) {
+        std::scoped_lock lock(mutex);
+        auto it{pages.find(offset)};
+        if (it == pages.end())
+            return nullptr;
+
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->page;
+    }
+
+    SectorCache::Page SectorCache::Insert(u64 offset, std::vector<u8> &&data) {
+        auto page{std::make_shared<const std::vector<u8>>(std::move(data))};
+
+        std::scoped_lock lock(mutex);
+        auto it{pages.find(offset)};
+        if (it != pages.end()) {
+            // Another thread could've decrypted the same page concurrently, we just keep the existing one
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->page;
+        }
+
+        size_t previousSize{cachedSize};
+        while (!lru.empty() && cachedSize + page->size() > capacity) {
+            auto &entry{lru.back()};
+            cachedSize -= entry.page->size();
+            pages.erase(entry.offset);
+            lru.pop_back();
+        }
+
+        lru.push_front(LruEntry{offset, page});
+        pages.emplace(offset, lru.begin());
+        cachedSize += page->size();
+        MemoryAccounting::Update(MemoryAccounting::Category::SectorCache, static_cast<i64>(cachedSize) - static_cast<i64>(previousSize));
+        return page;
+    }
+}
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::vfs {
+    /**
+     * @brief An LRU cache of decrypted pages which is shared across all encrypted sections of an NCA, this avoids decrypting hot regions of a filesystem on every access
+     * @note Pages are keyed by their offset into the NCA which is unique across all sections as they never overlap
+     */
+    class SectorCache {
+      public:
+        static constexpr size_t PageSize{0x4000}; //!< The size of a single cached page, this is a multiple of the AES block size
+        using Page = std::shared_ptr<const std::vector<u8>>; //!< A page is reference counted so it can be copied out of after it has been evicted
+
+      private:
+        /**
+         * @brief An entry in the LRU list of pages
+         */
+        struct LruEntry {
+            u64 offset; //!< The offset of the page into the NCA
+            Page page;
+        };
+
+        std::mutex mutex; //!< Synchronizes all access to the cache as it's shared across backings
+        std::list<LruEntry> lru; //!< All cached pages ordered from the most to the least recently used
+        std::unordered_map<u64, std::list<LruEntry>::iterator> pages; //!< A map from the offset of a page to its entry in the LRU list
+        size_t capacity; //!< The maximum size of all cached pages in bytes
+        size_t cachedSize{}; //!< The total size of all cached pages in bytes
+
+      public:
+        /**
+         * @param capacity The maximum size of all cached pages in bytes
+         */
+        SectorCache(size_t capacity);
+
+        ~SectorCache();
+
+        size_t GetCapacity() const {
+            return capacity;
+        }
+
+        /**
+         * @return The page at the supplied offset or nullptr if it isn't cached
+         */
+        Page Lookup(u64 offset);
+
+        /**
+         * @brief Inserts a page into the cache, evicting the least recently used pages till the cache is within its capacity
+         * @return The page which was inserted
+         */
+        Page Insert(u64 offset, std::vector<u8> &&data);
+    };
+}
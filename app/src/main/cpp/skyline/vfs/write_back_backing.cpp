@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "write_back_backing.h"
+
+namespace skyline::vfs {
+    WriteBackFile::WriteBackFile(std::string pPath) : path(std::move(pPath)) {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw exception("Failed to open file at '{}': {}", path, strerror(errno));
+
+        struct stat fileInfo;
+        if (fstat(fd, &fileInfo)) {
+            close(fd);
+            throw exception("Failed to stat fd: {}", strerror(errno));
+        }
+
+        size = diskSize = static_cast<size_t>(fileInfo.st_size);
+    }
+
+    WriteBackFile::~WriteBackFile() {
+        try {
+            FlushLocked();
+        } catch (const std::exception &e) {
+            Logger::Error("Failed to flush '{}' on closing it: {}", path, e.what());
+        }
+        close(fd);
+    }
+
+    size_t WriteBackFile::Read(span<u8> output, size_t offset) {
+        std::scoped_lock lock{mutex};
+        if (offset >= size)
+            return 0;
+
+        size_t readSize{std::min(output.size(), size - offset)}, end{offset + readSize};
+        output = output.first(readSize);
+
+        // Data that hasn't been written back is read from the disk and anything past its valid prefix is zero
+        size_t diskReadSize{offset < diskSize ? std::min(readSize, diskSize - offset) : 0};
+        if (diskReadSize) {
+            auto ret{pread64(fd, output.data(), diskReadSize, static_cast<off64_t>(offset))};
+            if (ret < 0 && errno == EFAULT) {
+                // See OsBacking::ReadImpl, the output may be write-protected guest memory
+                std::vector<u8> buffer(diskReadSize);
+                ret = pread64(fd, buffer.data(), buffer.size(), static_cast<off64_t>(offset));
+                if (ret > 0)
+                    std::memcpy(output.data(), buffer.data(), static_cast<size_t>(ret));
+            }
+            if (ret < 0)
+                throw exception("Failed to read from fd: {}", strerror(errno));
+            diskReadSize = static_cast<size_t>(ret);
+        }
+        std::memset(output.data() + diskReadSize, 0, readSize - diskReadSize);
+
+        auto it{extents.upper_bound(offset)};
+        if (it != extents.begin())
+            it = std::prev(it);
+        for (; it != extents.end() && it->first < end; it++) {
+            size_t extentEnd{it->first + it->second.size()};
+            if (extentEnd <= offset)
+                continue;
+
+            size_t copyStart{std::max(offset, it->first)}, copyEnd{std::min(end, extentEnd)};
+            std::memcpy(output.data() + (copyStart - offset), it->second.data() + (copyStart - it->first), copyEnd - copyStart);
+        }
+
+        return readSize;
+    }
+
+    size_t WriteBackFile::Write(span<u8> input, size_t offset) {
+        if (input.empty())
+            return 0;
+
+        std::scoped_lock lock{mutex};
+        size_t end{offset + input.size()};
+
+        // The write goes into the extent which overlaps or touches its start, a new extent is only created if there's none
+        // Writes past the end of an extent grow it in place, sequential writes only copy their own data as the extent's storage grows geometrically
+        auto base{extents.upper_bound(offset)};
+        if (base != extents.begin() && std::prev(base)->first + std::prev(base)->second.size() >= offset)
+            base = std::prev(base);
+        else
+            base = extents.emplace_hint(base, offset, std::vector<u8>{});
+
+        auto &data{base->second};
+        size_t baseOffset{base->first}, baseSize{data.size()};
+        size_t mergedEnd{std::max(end, baseOffset + baseSize)};
+
+        // Any following extents which overlap or touch the written range are merged into the base extent, only their data past the write is retained
+        auto last{std::next(base)};
+        for (; last != extents.end() && last->first <= end; last++) {
+            mergedEnd = std::max(mergedEnd, last->first + last->second.size());
+            bufferedSize -= last->second.size();
+        }
+
+        if (mergedEnd - baseOffset > baseSize)
+            data.resize(mergedEnd - baseOffset);
+        if (last != std::next(base)) {
+            auto &lastMerged{*std::prev(last)};
+            size_t lastEnd{lastMerged.first + lastMerged.second.size()};
+            if (lastEnd > end)
+                std::memcpy(data.data() + (end - baseOffset), lastMerged.second.data() + (end - lastMerged.first), lastEnd - end);
+            extents.erase(std::next(base), last);
+        }
+        std::memcpy(data.data() + (offset - baseOffset), input.data(), input.size());
+
+        bufferedSize += data.size() - baseSize;
+        size = std::max(size, end);
+        dirty = true;
+
+        if (bufferedSize >= MaxBufferedSize)
+            FlushLocked();
+
+        return input.size();
+    }
+
+    void WriteBackFile::Resize(size_t newSize) {
+        std::scoped_lock lock{mutex};
+        if (newSize < size) {
+            // Any data past the new size must read as zero if the file is extended again
+            diskSize = std::min(diskSize, newSize);
+
+            auto it{extents.lower_bound(newSize)};
+            for (auto erased{it}; erased != extents.end(); erased++)
+                bufferedSize -= erased->second.size();
+            extents.erase(it, extents.end());
+
+            if (!extents.empty()) {
+                auto &[lastOffset, lastExtent]{*extents.rbegin()};
+                if (lastOffset + lastExtent.size() > newSize) {
+                    bufferedSize -= lastExtent.size() - (newSize - lastOffset);
+                    lastExtent.resize(newSize - lastOffset);
+                }
+            }
+        }
+
+        size = newSize;
+        dirty = true;
+    }
+
+    void WriteBackFile::Flush() {
+        std::scoped_lock lock{mutex};
+        FlushLocked();
+    }
+
+    void WriteBackFile::FlushLocked() {
+        if (!dirty)
+            return;
+
+        auto temporaryPath{path + ".tmp"};
+        int temporaryFd{open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR)};
+        if (temporaryFd < 0)
+            throw exception("Failed to create temporary file at '{}': {}", temporaryPath, strerror(errno));
+
+        try {
+            off_t copyOffset{};
+            while (static_cast<size_t>(copyOffset) < diskSize) {
+                auto ret{sendfile(temporaryFd, fd, &copyOffset, diskSize - static_cast<size_t>(copyOffset))};
+                if (ret <= 0)
+                    throw exception("Failed to copy file contents: {}", ret < 0 ? strerror(errno) : "Unexpected end of file");
+            }
+
+            if (ftruncate(temporaryFd, static_cast<off_t>(size)))
+                throw exception("Failed to resize file: {}", strerror(errno));
+
+            for (const auto &[offset, extent] : extents) {
+                size_t written{};
+                while (written < extent.size()) {
+                    auto ret{pwrite64(temporaryFd, extent.data() + written, extent.size() - written, static_cast<off64_t>(offset + written))};
+                    if (ret < 0)
+                        throw exception("Failed to write to fd: {}", strerror(errno));
+                    written += static_cast<size_t>(ret);
+                }
+            }
+
+            // All buffered writes only reach the disk with a single sync, the rename after it ensures the file is either entirely old or new after a crash
+            if (fsync(temporaryFd))
+                throw exception("Failed to sync file: {}", strerror(errno));
+        } catch (...) {
+            close(temporaryFd);
+            unlink(temporaryPath.c_str());
+            throw;
+        }
+        close(temporaryFd);
+
+        if (rename(temporaryPath.c_str(), path.c_str()))
+            throw exception("Failed to replace '{}': {}", path, strerror(errno));
+
+        int newFd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (newFd < 0)
+            throw exception("Failed to reopen file at '{}': {}", path, strerror(errno));
+        close(fd);
+        fd = newFd;
+
+        diskSize = size;
+        extents.clear();
+        bufferedSize = 0;
+        dirty = false;
+    }
+
+    WriteBackBacking::WriteBackBacking(std::shared_ptr<WriteBackFile> pFile, Mode mode) : Backing(mode, pFile->size), file(std::move(pFile)) {}
+
+    size_t WriteBackBacking::ReadImpl(span<u8> output, size_t offset) {
+        return file->Read(output, offset);
+    }
+
+    size_t WriteBackBacking::WriteImpl(span<u8> input, size_t offset) {
+        auto written{file->Write(input, offset)};
+        size = file->size;
+        return written;
+    }
+
+    void WriteBackBacking::ResizeImpl(size_t pSize) {
+        file->Resize(pSize);
+        size = pSize;
+    }
+
+    void WriteBackBacking::FlushImpl() {
+        file->Flush();
+    }
+
+    WriteBackCache &WriteBackCache::Get() {
+        static auto *cache{new WriteBackCache()}; // The cache is intentionally leaked as files may be closed during static destruction
+        return *cache;
+    }
+
+    std::shared_ptr<Backing> WriteBackCache::Open(const std::string &path, Backing::Mode mode) {
+        std::scoped_lock lock{mutex};
+        auto &entry{files[path]};
+        auto file{entry.lock()};
+        if (!file) {
+            file = std::make_shared<WriteBackFile>(path);
+            entry = file;
+        }
+
+        return std::make_shared<WriteBackBacking>(std::move(file), mode);
+    }
+
+    bool WriteBackCache::Resize(const std::string &path, size_t size) {
+        std::shared_ptr<WriteBackFile> file;
+        {
+            std::scoped_lock lock{mutex};
+            auto it{files.find(path)};
+            if (it == files.end() || !(file = it->second.lock()))
+                return false;
+        }
+
+        file->Resize(size);
+        return true;
+    }
+
+    void WriteBackCache::Flush(std::string_view prefix) {
+        std::vector<std::shared_ptr<WriteBackFile>> openFiles;
+        {
+            std::scoped_lock lock{mutex};
+            for (auto it{files.begin()}; it != files.end();) {
+                if (auto file{it->second.lock()}) {
+                    if (it->first.starts_with(prefix))
+                        openFiles.push_back(std::move(file));
+                    it++;
+                } else {
+                    it = files.erase(it);
+                }
+            }
+        }
+
+        for (const auto &file : openFiles)
+            file->Flush();
+    }
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The state of a file that is opened with write-back caching, this is shared by all backings opened for the same path
+     */
+    class WriteBackFile {
+      private:
+        static constexpr size_t MaxBufferedSize{0x800000}; //!< The amount of buffered data after which the file is flushed regardless of the guest
+
+        std::mutex mutex;
+        std::string path;
+        int fd; //!< A read-only FD to the file on disk, this is reopened after every flush as the file is replaced
+        size_t diskSize; //!< The size of the prefix of the file on disk which is still valid, any data after this is either buffered or zero
+        std::map<size_t, std::vector<u8>> extents; //!< Buffered writes keyed by their offset, extents never overlap or touch as adjacent writes are merged into the extent preceding them
+        size_t bufferedSize{}; //!< The total size of all buffered extents
+        bool dirty{}; //!< If the file has been written to or resized since it was last flushed
+
+        void FlushLocked();
+
+      public:
+        size_t size; //!< The size of the file including any buffered writes
+
+        WriteBackFile(std::string path);
+
+        /**
+         * @note The file is flushed prior to being closed
+         */
+        ~WriteBackFile();
+
+        size_t Read(span<u8> output, size_t offset);
+
+        size_t Write(span<u8> input, size_t offset);
+
+        void Resize(size_t newSize);
+
+        /**
+         * @brief Writes all buffered data to a temporary file which atomically replaces the file once it has been synced to disk
+         */
+        void Flush();
+
+        const std::string &GetPath() const {
+            return path;
+        }
+    };
+
+    /**
+     * @brief The WriteBackBacking class buffers writes to a file in memory and merges them prior to writing them out on a flush
+     * @note All backings opened for the same path through WriteBackCache share their buffered writes
+     */
+    class WriteBackBacking : public Backing {
+      private:
+        std::shared_ptr<WriteBackFile> file;
+
+      protected:
+        size_t ReadImpl(span<u8> output, size_t offset) override;
+
+        size_t WriteImpl(span<u8> input, size_t offset) override;
+
+        void ResizeImpl(size_t pSize) override;
+
+        void FlushImpl() override;
+
+      public:
+        WriteBackBacking(std::shared_ptr<WriteBackFile> file, Mode mode);
+    };
+
+    /**
+     * @brief A registry of all files opened with write-back caching, this ensures every path maps to a single WriteBackFile
+     */
+    class WriteBackCache {
+      private:
+        std::mutex mutex;
+        std::unordered_map<std::string, std::weak_ptr<WriteBackFile>> files;
+
+      public:
+        static WriteBackCache &Get();
+
+        std::shared_ptr<Backing> Open(const std::string &path, Backing::Mode mode);
+
+        /**
+         * @brief Resizes the file at the supplied path through its buffered state if it's open, changes to the file on disk would otherwise be overwritten by the buffered state on its next flush
+         * @return If the file was open and has been resized, it needs to be resized on disk otherwise
+         */
+        bool Resize(const std::string &path, size_t size);
+
+        /**
+         * @brief Flushes all open files with a path that starts with the supplied prefix
+         */
+        void Flush(std::string_view prefix = {});
+    };
+}
@@ -11,10 +11,14 @@ import android.content.pm.ShortcutInfo
 import android.content.pm.ShortcutManager
 import android.graphics.drawable.Icon
 import android.os.Bundle
+import android.os.Handler
+import android.os.Looper
 import android.view.KeyEvent
 import android.view.LayoutInflater
 import android.view.View
 import android.view.ViewGroup
+import android.widget.Toast
+import androidx.activity.result.contract.ActivityResultContracts
 import androidx.core.content.ContextCompat
 import androidx.core.graphics.drawable.toBitmap
 import com.google.android.material.bottomsheet.BottomSheetBehavior
@@ -22,6 +26,8 @@ import com.google.android.material.bottomsheet.BottomSheetDialogFragment
 import emu.skyline.data.AppItem
 import emu.skyline.databinding.AppDialogBinding
 import emu.skyline.loader.LoaderResult
+import emu.skyline.loader.RomCompressor
+import kotlin.concurrent.thread
 
 /**
  * This dialog is used to show extra game metadata and provide extra options such as pinning the game to the home screen
@@ -45,6 +51,24 @@ class AppDialog : BottomSheetDialogFragment() {
 
     private val item by lazy { requireArguments().getSerializable("item") as AppItem }
 
+    /**
+     * This writes a compressed image of the ROM to the document picked by the user, the conversion is done on a background thread as it can take minutes for larger ROMs
+     */
+    private val compressDocument = registerForActivityResult(ActivityResultContracts.CreateDocument()) { output ->
+        output ?: return@registerForActivityResult
+
+        val context = requireContext().applicationContext
+        val format = item.format
+        val input = item.uri
+        Toast.makeText(context, getString(R.string.compress_started), Toast.LENGTH_SHORT).show()
+        thread(name = "RomCompressor") {
+            val result = RomCompressor.compress(context, format, input, output)
+            Handler(Looper.getMainLooper()).post {
+                Toast.makeText(context, context.getString(if (result == LoaderResult.Success) R.string.compress_success else R.string.compress_failed), Toast.LENGTH_LONG).show()
+            }
+        }
+    }
+
     /**
      * This inflates the layout of the dialog after initial view creation
      */
@@ -100,5 +124,10 @@ class AppDialog : BottomSheetDialogFragment() {
 
             shortcutManager.requestPinShortcut(info.build(), null)
         }
+
+        binding.gameCompress.isEnabled = item.loaderResult == LoaderResult.Success
+        binding.gameCompress.setOnClickListener {
+            compressDocument.launch(item.title + ".skc." + item.format.name.lowercase())
+        }
     }
 }
@@ -23,6 +23,7 @@ import emu.skyline.input.*
 import emu.skyline.loader.getRomFormat
 import emu.skyline.utils.Settings
 import java.io.File
+import java.nio.ByteBuffer
 import javax.inject.Inject
 import kotlin.math.abs
 
@@ -32,6 +33,11 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
         private val Tag = EmulationActivity::class.java.simpleName
         val ReturnToMainTag = "returnToMain"
 
+        /**
+         * The amount of frames to run the ROM for before stopping emulation and reporting statistics, this allows unattended benchmark runs to be started with `adb shell am start`
+         */
+        val BenchmarkFramesTag = "benchmarkFrames"
+
         /**
          * The Kotlin thread on which emulation code executes
          */
@@ -71,8 +77,9 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
      * @param preferenceFd The file descriptor of the Preference XML
      * @param appFilesPath The full path to the app files directory
      * @param assetManager The asset manager used for accessing app assets
+     * @param benchmarkFrames The amount of frames after which emulation is stopped for a benchmark run or 0 to run normally
      */
-    private external fun executeApplication(romUri : String, romType : Int, romFd : Int, preferenceFd : Int, language : Int, appFilesPath : String, assetManager : AssetManager)
+    private external fun executeApplication(romUri : String, romType : Int, romFd : Int, preferenceFd : Int, language : Int, appFilesPath : String, assetManager : AssetManager, benchmarkFrames : Int)
 
     /**
      * @param join If the function should only return after all the threads join or immediately
@@ -93,12 +100,40 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
      */
     private external fun changeAudioStatus(play : Boolean)
 
+    /**
+     * This writes back any save data which is buffered in memory, it's called when the activity is paused as the app may be killed while in the background
+     */
+    private external fun flushSaveData()
+
+    /**
+     * This changes the present mode of the swapchain, the swapchain is recreated if the mode changes
+     *
+     * @param mode The VkPresentModeKHR to use if it's supported, the closest supported mode is used otherwise
+     */
+    private external fun setPresentMode(mode : Int)
+
     var fps : Int = 0
     var averageFrametime : Float = 0.0f
     var averageFrametimeDeviation : Float = 0.0f
+    var frametimeP50 : Float = 0.0f
+    var frametimeP99 : Float = 0.0f
+    var cpuTime : Float = 0.0f
+    var gpuTime : Float = 0.0f
+    var gpuTimeP99 : Float = 0.0f
+    var presentLatency : Float = 0.0f
+    var audioLatency : Float = 0.0f
+    var svcStatistics : String = ""
+    var serviceStatistics : String = ""
+    var memoryStatistics : String = ""
 
     /**
-     * Writes the current performance statistics into [fps], [averageFrametime] and [averageFrametimeDeviation] fields
+     * Writes the current performance statistics into [fps], [averageFrametime], [averageFrametimeDeviation], [frametimeP50], [frametimeP99], [cpuTime], [gpuTime], [gpuTimeP99], [presentLatency], [audioLatency], [svcStatistics], [serviceStatistics] and [memoryStatistics] fields
+     * @note [cpuTime] and [gpuTime] are the average time spent submitting and executing GPU work per frame, one of them being close to the frametime indicates what a title is bound by
+     * @note [presentLatency] is 0 if the device doesn't support measuring it
+     * @note [audioLatency] is the output latency of the audio stream, it's 0 if it can't be measured
+     * @note [svcStatistics] is a summary of the SVCs which took the most time since the previous call
+     * @note [serviceStatistics] is a summary of the HLE service functions which took the most time since the previous call
+     * @note [memoryStatistics] is a summary of the host memory used by every subsystem
      */
     private external fun updatePerformanceStatistics()
 
@@ -120,29 +155,16 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
     private external fun updateControllers()
 
     /**
-     * This sets the state of the buttons specified in the mask on a specific controller
+     * This passes the state of all guest input to libskyline which queues any changes since the last call
      *
-     * @param index The index of the controller this is directed to
-     * @param mask The mask of the button that are being set
-     * @param pressed If the buttons are being pressed or released
+     * @param snapshot A direct buffer laid out as skyline::input::InputSnapshot in C++
      */
-    private external fun setButtonState(index : Int, mask : Long, pressed : Boolean)
+    private external fun commitInputState(snapshot : ByteBuffer)
 
     /**
-     * This sets the value of a specific axis on a specific controller
-     *
-     * @param index The index of the controller this is directed to
-     * @param axis The ID of the axis that is being modified
-     * @param value The value to set the axis to
-     */
-    private external fun setAxisValue(index : Int, axis : Int, value : Int)
-
-    /**
-     * This sets the values of the points on the guest touch-screen
-     *
-     * @param points An array of skyline::input::TouchScreenPoint in C++ represented as integers
+     * The state of all guest input, this batches input events into a single [commitInputState] call
      */
-    private external fun setTouchState(points : IntArray)
+    private val inputSnapshot = InputSnapshot { commitInputState(it) }
 
     /**
      * This initializes all of the controllers from [InputManager] on the guest
@@ -204,6 +226,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
 
         shouldFinish = true
         returnToMain = intent.getBooleanExtra(ReturnToMainTag, false)
+        val benchmarkFrames = intent.getIntExtra(BenchmarkFramesTag, 0)
 
         val rom = intent.data!!
         val romType = getRomFormat(rom, contentResolver).ordinal
@@ -211,7 +234,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
         val preferenceFd = ParcelFileDescriptor.open(File("${applicationInfo.dataDir}/shared_prefs/${applicationInfo.packageName}_preferences.xml"), ParcelFileDescriptor.MODE_READ_WRITE)
 
         emulationThread = Thread {
-            executeApplication(rom.toString(), romType, romFd.detachFd(), preferenceFd.detachFd(), settings.systemLanguage, applicationContext.filesDir.canonicalPath + "/", assets)
+            executeApplication(rom.toString(), romType, romFd.detachFd(), preferenceFd.detachFd(), settings.systemLanguage, applicationContext.filesDir.canonicalPath + "/", assets, benchmarkFrames)
             returnFromEmulation()
         }
 
@@ -248,7 +271,13 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
                 postDelayed(object : Runnable {
                     override fun run() {
                         updatePerformanceStatistics()
-                        text = "$fps FPS\n${"%.1f".format(averageFrametime)}±${"%.2f".format(averageFrametimeDeviation)}ms"
+                        text = "$fps FPS\n${"%.1f".format(averageFrametime)}±${"%.2f".format(averageFrametimeDeviation)}ms" +
+                            "\nP50 ${"%.1f".format(frametimeP50)}ms P99 ${"%.1f".format(frametimeP99)}ms" +
+                            "\nCPU ${"%.1f".format(cpuTime)}ms GPU ${"%.1f".format(gpuTime)}ms (P99 ${"%.1f".format(gpuTimeP99)}ms)" +
+                            (if (presentLatency != 0.0f) "\nLatency ${"%.1f".format(presentLatency)}ms" else "") +
+                            (if (audioLatency != 0.0f) "\nAudio ${"%.1f".format(audioLatency)}ms" else "") +
+                            (if (serviceStatistics.isNotEmpty()) "\n$serviceStatistics" else "") +
+                            if (memoryStatistics.isNotEmpty()) "\n$memoryStatistics" else ""
                         postDelayed(this, 250)
                     }
                 }, 250)
@@ -286,12 +315,14 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
         super.onPause()
 
         changeAudioStatus(false)
+        flushSaveData()
     }
 
     override fun onResume() {
         super.onResume()
 
         changeAudioStatus(true)
+        setPresentMode(settings.presentMode)
 
         if (Build.VERSION.SDK_INT < Build.VERSION_CODES.R) {
             @Suppress("DEPRECATION")
@@ -361,12 +392,12 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
         return when (val guestEvent = inputManager.eventMap[KeyHostEvent(event.device.descriptor, event.keyCode)]) {
             is ButtonGuestEvent -> {
                 if (guestEvent.button != ButtonId.Menu)
-                    setButtonState(guestEvent.id, guestEvent.button.value(), action.state)
+                    inputSnapshot.setButtonState(guestEvent.id, guestEvent.button.value(), action.state)
                 true
             }
 
             is AxisGuestEvent -> {
-                setAxisValue(guestEvent.id, guestEvent.axis.ordinal, (if (action == ButtonState.Pressed) if (guestEvent.polarity) Short.MAX_VALUE else Short.MIN_VALUE else 0).toInt())
+                inputSnapshot.setAxisValue(guestEvent.id, guestEvent.axis.ordinal, (if (action == ButtonState.Pressed) if (guestEvent.polarity) Short.MAX_VALUE else Short.MIN_VALUE else 0).toInt())
                 true
             }
 
@@ -411,7 +442,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
                         when (guestEvent) {
                             is ButtonGuestEvent -> {
                                 if (guestEvent.button != ButtonId.Menu)
-                                    setButtonState(guestEvent.id, guestEvent.button.value(), if (abs(value) >= guestEvent.threshold) ButtonState.Pressed.state else ButtonState.Released.state)
+                                    inputSnapshot.setButtonState(guestEvent.id, guestEvent.button.value(), if (abs(value) >= guestEvent.threshold) ButtonState.Pressed.state else ButtonState.Released.state)
                             }
 
                             is AxisGuestEvent -> {
@@ -419,7 +450,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
                                 value = if (polarity) abs(value) else -abs(value)
                                 value = if (guestEvent.axis == AxisId.LX || guestEvent.axis == AxisId.RX) value else -value
 
-                                setAxisValue(guestEvent.id, guestEvent.axis.ordinal, (value * Short.MAX_VALUE).toInt())
+                                inputSnapshot.setAxisValue(guestEvent.id, guestEvent.axis.ordinal, (value * Short.MAX_VALUE).toInt())
                             }
                         }
                     }
@@ -438,33 +469,27 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
 
     @SuppressLint("ClickableViewAccessibility")
     override fun onTouch(view : View, event : MotionEvent) : Boolean {
-        val count = if (event.action != MotionEvent.ACTION_UP && event.action != MotionEvent.ACTION_CANCEL) event.pointerCount else 0
-        val points = IntArray(count * 5) // This is an array of skyline::input::TouchScreenPoint in C++ as that allows for efficient transfer of values to it
-        var offset = 0
+        val count = if (event.action != MotionEvent.ACTION_UP && event.action != MotionEvent.ACTION_CANCEL) event.pointerCount.coerceAtMost(InputSnapshot.MaxTouchPoints) else 0
+        val pointer = MotionEvent.PointerCoords()
         for (index in 0 until count) {
-            val pointer = MotionEvent.PointerCoords()
             event.getPointerCoords(index, pointer)
 
             val x = 0f.coerceAtLeast(pointer.x * 1280 / view.width).toInt()
             val y = 0f.coerceAtLeast(pointer.y * 720 / view.height).toInt()
 
-            points[offset++] = x
-            points[offset++] = y
-            points[offset++] = pointer.touchMinor.toInt()
-            points[offset++] = pointer.touchMajor.toInt()
-            points[offset++] = (pointer.orientation * 180 / Math.PI).toInt()
+            inputSnapshot.setTouchPoint(index, x, y, pointer.touchMinor.toInt(), pointer.touchMajor.toInt(), (pointer.orientation * 180 / Math.PI).toInt())
         }
 
-        setTouchState(points)
+        inputSnapshot.setTouchPointCount(count)
 
         return true
     }
 
-    private fun onButtonStateChanged(buttonId : ButtonId, state : ButtonState) = setButtonState(0, buttonId.value(), state.state)
+    private fun onButtonStateChanged(buttonId : ButtonId, state : ButtonState) = inputSnapshot.setButtonState(0, buttonId.value(), state.state)
 
     private fun onStickStateChanged(stickId : StickId, position : PointF) {
-        setAxisValue(0, stickId.xAxis.ordinal, (position.x * Short.MAX_VALUE).toInt())
-        setAxisValue(0, stickId.yAxis.ordinal, (-position.y * Short.MAX_VALUE).toInt()) // Y is inverted, since drawing starts from top left
+        inputSnapshot.setAxisValue(0, stickId.xAxis.ordinal, (position.x * Short.MAX_VALUE).toInt())
+        inputSnapshot.setAxisValue(0, stickId.yAxis.ordinal, (-position.y * Short.MAX_VALUE).toInt()) // Y is inverted, since drawing starts from top left
     }
 
     @SuppressLint("WrongConstant")
@@ -133,11 +133,20 @@ class MainActivity : AppCompatActivity() {
                 val file = applicationContext.filesDir.resolve("emulation.sklog")
                 if (file.length() != 0L) {
                     val uri = FileProvider.getUriForFile(this@MainActivity, "skyline.emu.fileprovider", file)
-                    val intent = Intent(Intent.ACTION_SEND)
-                        .setType("text/plain")
-                        .addFlags(Intent.FLAG_GRANT_READ_URI_PERMISSION)
-                        .setData(uri)
-                        .putExtra(Intent.EXTRA_STREAM, uri)
+                    val flightRecording = applicationContext.filesDir.resolve("emulation.skfr")
+                    val intent = if (flightRecording.length() != 0L) {
+                        // The flight recording is shared alongside the log as it provides a timeline of the last events prior to a crash or exit
+                        Intent(Intent.ACTION_SEND_MULTIPLE)
+                            .setType("*/*")
+                            .addFlags(Intent.FLAG_GRANT_READ_URI_PERMISSION)
+                            .putParcelableArrayListExtra(Intent.EXTRA_STREAM, arrayListOf(uri, FileProvider.getUriForFile(this@MainActivity, "skyline.emu.fileprovider", flightRecording)))
+                    } else {
+                        Intent(Intent.ACTION_SEND)
+                            .setType("text/plain")
+                            .addFlags(Intent.FLAG_GRANT_READ_URI_PERMISSION)
+                            .setData(uri)
+                            .putExtra(Intent.EXTRA_STREAM, uri)
+                    }
                     startActivity(Intent.createChooser(intent, getString(R.string.log_share_prompt)))
                 } else {
                     Snackbar.make(this@MainActivity.findViewById(android.R.id.content), getString(R.string.logs_not_found), Snackbar.LENGTH_SHORT).show()
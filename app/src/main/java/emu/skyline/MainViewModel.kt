@@ -48,10 +48,15 @@ class MainViewModel @Inject constructor(@ApplicationContext context : Context, p
         val romsFile = File(getApplication<SkylineApplication>().filesDir.canonicalPath + "/roms.bin")
 
         viewModelScope.launch(Dispatchers.IO) {
-            if (loadFromFile && romsFile.exists()) {
+            var cachedEntries : HashMap<RomFormat, ArrayList<AppEntry>>? = null
+            if (romsFile.exists()) {
                 try {
-                    state = MainState.Loaded(fromFile(romsFile))
-                    return@launch
+                    val entries = fromFile<HashMap<RomFormat, ArrayList<AppEntry>>>(romsFile)
+                    if (loadFromFile) {
+                        state = MainState.Loaded(entries)
+                        return@launch
+                    }
+                    cachedEntries = entries
                 } catch (e : Exception) {
                     Log.w(TAG, "Ran into exception while loading: ${e.message}")
                 }
@@ -63,7 +68,7 @@ class MainViewModel @Inject constructor(@ApplicationContext context : Context, p
             } else {
                 try {
                     KeyReader.importFromLocation(context, searchLocation)
-                    val romElements = romProvider.loadRoms(searchLocation, systemLanguage)
+                    val romElements = romProvider.loadRoms(searchLocation, systemLanguage, cachedEntries)
                     romElements.toFile(romsFile)
                     MainState.Loaded(romElements)
                 } catch (e : Exception) {
@@ -6,6 +6,7 @@ import android.net.Uri
 import androidx.documentfile.provider.DocumentFile
 import dagger.hilt.android.qualifiers.ApplicationContext
 import emu.skyline.loader.AppEntry
+import emu.skyline.loader.LoaderResult
 import emu.skyline.loader.RomFile
 import emu.skyline.loader.RomFormat
 import emu.skyline.loader.RomFormat.*
@@ -16,23 +17,36 @@ import javax.inject.Singleton
 class RomProvider @Inject constructor(@ApplicationContext private val context : Context) {
     /**
      * This adds all files in [directory] with [extension] as an entry using [RomFile] to load metadata
+     * @param cachedEntries Entries from a previous scan, these are reused for unchanged files rather than parsing them again
      */
     @SuppressLint("DefaultLocale")
-    private fun addEntries(fileFormats : Map<String, RomFormat>, directory : DocumentFile, entries : HashMap<RomFormat, ArrayList<AppEntry>>, systemLanguage : Int) {
+    private fun addEntries(fileFormats : Map<String, RomFormat>, directory : DocumentFile, entries : HashMap<RomFormat, ArrayList<AppEntry>>, systemLanguage : Int, cachedEntries : Map<Uri, AppEntry>) {
         directory.listFiles().forEach { file ->
             if (file.isDirectory) {
-                addEntries(fileFormats, file, entries, systemLanguage)
+                addEntries(fileFormats, file, entries, systemLanguage, cachedEntries)
             } else {
-                fileFormats[file.name?.substringAfterLast(".")?.lowercase()]?.let { romFormat->
-                    entries.getOrPut(romFormat, { arrayListOf() }).add(RomFile(context, romFormat, file.uri, systemLanguage).appEntry)
+                fileFormats[file.name?.substringAfterLast(".")?.lowercase()]?.let { romFormat ->
+                    val fileSize = file.length()
+                    val lastModified = file.lastModified()
+                    val entry = cachedEntries[file.uri]?.takeIf { it.loaderResult == LoaderResult.Success && it.fileSize == fileSize && it.lastModified == lastModified && it.systemLanguage == systemLanguage }
+                        ?: RomFile(context, romFormat, file.uri, systemLanguage).appEntry.apply {
+                            this.fileSize = fileSize
+                            this.lastModified = lastModified
+                            this.systemLanguage = systemLanguage
+                        }
+                    entries.getOrPut(romFormat, { arrayListOf() }).add(entry)
                 }
             }
         }
     }
 
-    fun loadRoms(searchLocation : Uri, systemLanguage : Int) = DocumentFile.fromTreeUri(context, searchLocation)!!.let { documentFile ->
+    /**
+     * @param cachedEntries The entries from a previous scan, if any
+     */
+    fun loadRoms(searchLocation : Uri, systemLanguage : Int, cachedEntries : HashMap<RomFormat, ArrayList<AppEntry>>? = null) = DocumentFile.fromTreeUri(context, searchLocation)!!.let { documentFile ->
+        val cachedEntryMap = cachedEntries?.values?.flatten()?.associateBy { it.uri } ?: emptyMap()
         hashMapOf<RomFormat, ArrayList<AppEntry>>().apply {
-            addEntries(mapOf("nro" to NRO, "nso" to NSO, "nca" to NCA, "nsp" to NSP, "xci" to XCI), documentFile, this, systemLanguage)
+            addEntries(mapOf("nro" to NRO, "nso" to NSO, "nca" to NCA, "nsp" to NSP, "xci" to XCI), documentFile, this, systemLanguage, cachedEntryMap)
         }
     }
 }
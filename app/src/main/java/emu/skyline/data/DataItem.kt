@@ -39,6 +39,11 @@ data class AppItem(private val meta : AppEntry) : DataItem() {
      */
     val uri get() = meta.uri
 
+    /**
+     * The format of the application's image file
+     */
+    val format get() = meta.format
+
     val loaderResult get() = meta.loaderResult
 
     fun loaderResultString(context : Context) = context.getString(when (meta.loaderResult) {
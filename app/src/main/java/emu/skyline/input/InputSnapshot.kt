@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ * Copyright © 2021 Skyline Team and Contributors (https://github.com/skyline-emu/)
+ */
+
+package emu.skyline.input
+
+import android.os.Handler
+import android.os.Looper
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * This holds the state of all guest controllers and the touch-screen in a direct [ByteBuffer] which is laid out as skyline::input::InputSnapshot in C++, any amount of input events are batched into a single JNI call that commits the buffer
+ *
+ * @param commit A function that passes the buffer to libskyline, it's called on the main thread after all pending input events have been dispatched
+ */
+class InputSnapshot(private val commit : (ByteBuffer) -> Unit) {
+    companion object {
+        private const val ControllerCount = 8
+        private const val ControllerSize = 24 // A u64 of buttons followed by an i32 for each axis
+        private const val AxesOffset = 8
+        private const val TouchCountOffset = ControllerCount * ControllerSize
+        private const val TouchPointsOffset = TouchCountOffset + 4
+        private const val TouchPointSize = 5 * 4 // skyline::input::TouchScreenPoint is five i32s
+        private const val Size = 0x208
+
+        const val MaxTouchPoints = 16
+    }
+
+    private val buffer = ByteBuffer.allocateDirect(Size).order(ByteOrder.nativeOrder())
+
+    /**
+     * The buttons on each controller which have been pressed since the last commit
+     */
+    private val uncommittedPresses = LongArray(ControllerCount)
+
+    private val handler = Handler(Looper.getMainLooper())
+    private var commitPending = false
+    private val commitRunnable = Runnable { commitNow() }
+
+    /**
+     * This commits the buffer immediately rather than waiting for all pending input events to be dispatched
+     */
+    private fun commitNow() {
+        handler.removeCallbacks(commitRunnable)
+        commitPending = false
+        uncommittedPresses.fill(0)
+        commit(buffer)
+    }
+
+    private fun scheduleCommit() {
+        if (!commitPending) {
+            commitPending = true
+            handler.post(commitRunnable)
+        }
+    }
+
+    /**
+     * This sets the state of the buttons specified in the mask on a specific controller
+     *
+     * @param index The index of the controller this is directed to
+     * @param mask The mask of the button that are being set
+     * @param pressed If the buttons are being pressed or released
+     */
+    fun setButtonState(index : Int, mask : Long, pressed : Boolean) {
+        val offset = index * ControllerSize
+        if (pressed) {
+            buffer.putLong(offset, buffer.getLong(offset) or mask)
+            uncommittedPresses[index] = uncommittedPresses[index] or mask
+        } else {
+            if (uncommittedPresses[index] and mask != 0L)
+                commitNow() // The press needs to be committed prior to the release or the guest would never observe it
+
+            buffer.putLong(offset, buffer.getLong(offset) and mask.inv())
+        }
+
+        scheduleCommit()
+    }
+
+    /**
+     * This sets the value of a specific axis on a specific controller
+     *
+     * @param index The index of the controller this is directed to
+     * @param axis The ID of the axis that is being modified
+     * @param value The value to set the axis to
+     */
+    fun setAxisValue(index : Int, axis : Int, value : Int) {
+        buffer.putInt(index * ControllerSize + AxesOffset + axis * 4, value)
+        scheduleCommit()
+    }
+
+    /**
+     * This sets the values of a point on the guest touch-screen, the point is only used if it's below the count set by [setTouchPointCount]
+     */
+    fun setTouchPoint(index : Int, x : Int, y : Int, minor : Int, major : Int, angle : Int) {
+        if (index >= MaxTouchPoints)
+            return
+
+        val offset = TouchPointsOffset + index * TouchPointSize
+        buffer.putInt(offset, x)
+        buffer.putInt(offset + 4, y)
+        buffer.putInt(offset + 8, minor)
+        buffer.putInt(offset + 12, major)
+        buffer.putInt(offset + 16, angle)
+    }
+
+    /**
+     * This sets the amount of points on the guest touch-screen
+     */
+    fun setTouchPointCount(count : Int) {
+        buffer.putInt(TouchCountOffset, count.coerceAtMost(MaxTouchPoints))
+        scheduleCommit()
+    }
+}
@@ -70,6 +70,13 @@ data class AppEntry(var name : String, var author : String?, var icon : Bitmap?,
         cursor.getString(nameIndex)
     }!!.dropLast(format.name.length + 1), null, null, format, uri, loaderResult)
 
+    /**
+     * The size and last modification time of the ROM file alongside the system language used to read its metadata, an entry is reused on rescans while these match
+     */
+    var fileSize = 0L
+    var lastModified = 0L
+    var systemLanguage = -1
+
     private fun writeObject(output : ObjectOutputStream) {
         output.writeUTF(name)
         output.writeObject(format)
@@ -78,6 +85,9 @@ data class AppEntry(var name : String, var author : String?, var icon : Bitmap?,
         if (author != null)
             output.writeUTF(author)
         output.writeInt(loaderResult.value)
+        output.writeLong(fileSize)
+        output.writeLong(lastModified)
+        output.writeInt(systemLanguage)
         output.writeBoolean(icon != null)
         icon?.let {
             @Suppress("DEPRECATION")
@@ -95,6 +105,9 @@ data class AppEntry(var name : String, var author : String?, var icon : Bitmap?,
         if (input.readBoolean())
             author = input.readUTF()
         loaderResult = LoaderResult.get(input.readInt())
+        fileSize = input.readLong()
+        lastModified = input.readLong()
+        systemLanguage = input.readInt()
         if (input.readBoolean())
             icon = BitmapFactory.decodeStream(input)
     }
@@ -149,3 +162,26 @@ internal class RomFile(context : Context, format : RomFormat, uri : Uri, systemL
      */
     private external fun populate(format : Int, romFd : Int, appFilesPath : String, systemLanguage : Int) : Int
 }
+
+/**
+ * This is used to convert ROMs into block-compressed images which libskyline can load directly
+ */
+internal object RomCompressor {
+    /**
+     * Writes a compressed image of a ROM to [outputFd], NSPs and NCAs are stored decrypted so they don't need to be decrypted at runtime
+     * @param format The format of the ROM
+     * @param romFd A file descriptor of the ROM
+     * @param outputFd A writable file descriptor which the compressed image is written to
+     * @param appFilesPath Path to internal app data storage, needed to read imported keys
+     * @return The [LoaderResult] of the conversion
+     */
+    external fun compress(format : Int, romFd : Int, outputFd : Int, appFilesPath : String) : Int
+
+    fun compress(context : Context, format : RomFormat, input : Uri, output : Uri) : LoaderResult {
+        context.contentResolver.openFileDescriptor(input, "r")!!.use { romFile ->
+            context.contentResolver.openFileDescriptor(output, "rw")!!.use { outputFile ->
+                return LoaderResult.get(compress(format.ordinal, romFile.fd, outputFile.fd, context.filesDir.canonicalPath + "/"))
+            }
+        }
+    }
+}
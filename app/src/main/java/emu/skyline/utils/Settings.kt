@@ -40,5 +40,7 @@ class Settings @Inject constructor(@ApplicationContext private val context : Con
 
     var aspectRatio by sharedPreferences(context, 0)
 
+    var presentMode by sharedPreferences(context, 2)
+
     var systemLanguage by sharedPreferences(context, 1)
 }